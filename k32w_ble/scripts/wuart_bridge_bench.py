@@ -0,0 +1,383 @@
+#!/usr/bin/env python3
+###############################################################################
+#
+# Copyright 2022 NXP
+# All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+###############################################################################
+
+# Measure the UART link between the RT106F and the wireless uart application with a pseudo terminal pair standing in
+# for the wire. The host end writes packets the way SLN_BLEWUARTSendPacket frames them, the module end is a model of
+# wireless_uart.c: it reads the stream, sends it to the air in GATT writes of --mtu bytes and writes what the air
+# sends back to the host. Both ends pace their writes to the baud rate of the link.
+#
+#   legacy  115200 bps, the stream goes to the air 7 ms after the last byte or when a write is full, the status of
+#           the module is written as the header, a 10 ms wait and the body
+#   bridge  the host asks for --baud with a control packet after the READY status, the stream goes to the air when a
+#           packet ends or a write is full, the status is written in one piece
+#
+# up is host to air, down is air to host, latency is from the last byte written by the sender to the packet being
+# complete on the other side.
+
+import argparse
+import os
+import select
+import struct
+import sys
+import threading
+import time
+import tty
+import zlib
+
+TU_MAGIC = b'\x53\x79\x4c'
+HEADER = struct.Struct('<3sBIIIII')
+HEADER_LEN = HEADER.size
+
+BRIDGE_CONTROL = 0xfe
+FIRMWARE_RESPONSE = 0xff
+LINK_FLOW_CONTROL = 1 << 31
+
+DEFAULT_BAUD = 115200
+LEGACY_FLUSH_S = 0.007
+LEGACY_STATUS_GAP_S = 0.010
+
+# Bytes written to the pseudo terminal at a time, small enough to keep the pacing smooth
+SLICE = 64
+
+
+def frame(ptype, pkt_id, body=b'', reserved=0):
+    head = struct.pack('<3sBIIII', TU_MAGIC, ptype, len(body), pkt_id, zlib.crc32(body) if body else 0, reserved)
+    return head + struct.pack('<I', zlib.crc32(head)) + body
+
+
+def parse_header(data):
+    magic, ptype, length, pkt_id, crc, reserved, tu_crc = HEADER.unpack(data)
+    if magic != TU_MAGIC or zlib.crc32(data[:HEADER_LEN - 4]) != tu_crc:
+        return None
+    return ptype, length, pkt_id, crc, reserved
+
+
+class Link:
+    '''One end of the wire, writes are paced to the baud rate the way a UART shifts them out'''
+
+    def __init__(self, fd, baud):
+        self.fd = fd
+        self.baud = baud
+        self.busy_until = 0.0
+        self.lock = threading.Lock()
+
+    def write(self, data):
+        with self.lock:
+            for i in range(0, len(data), SLICE):
+                part = data[i:i + SLICE]
+                start = max(time.perf_counter(), self.busy_until)
+                self.busy_until = start + len(part) * 10.0 / self.baud
+                os.write(self.fd, part)
+                delay = self.busy_until - time.perf_counter()
+                if delay > 0:
+                    time.sleep(delay)
+            return self.busy_until
+
+    def drain(self):
+        with self.lock:
+            delay = self.busy_until - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+
+
+class FrameReader:
+    '''Splits a byte stream into packets, bytes outside of a packet are skipped'''
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        packets = []
+        while True:
+            start = self.buf.find(TU_MAGIC)
+            if start < 0:
+                del self.buf[:max(0, len(self.buf) - len(TU_MAGIC) + 1)]
+                return packets
+            del self.buf[:start]
+            if len(self.buf) < HEADER_LEN:
+                return packets
+            header = parse_header(bytes(self.buf[:HEADER_LEN]))
+            if header is None:
+                del self.buf[:1]
+                continue
+            if len(self.buf) < HEADER_LEN + header[1]:
+                return packets
+            body = bytes(self.buf[HEADER_LEN:HEADER_LEN + header[1]])
+            del self.buf[:HEADER_LEN + header[1]]
+            packets.append((header, body))
+
+
+class Module(threading.Thread):
+    '''Model of the UART side of wireless_uart.c'''
+
+    def __init__(self, fd, mode, mtu, max_baud, air_write_s):
+        super().__init__(daemon=True)
+        self.fd = fd
+        self.mode = mode
+        self.mtu = mtu
+        self.max_baud = max_baud
+        self.air_write_s = air_write_s
+        self.link = Link(fd, DEFAULT_BAUD)
+        self.air = []           # (time, bytes) of every GATT write
+        self.stop = False
+        # bridge parser, the same stages as BleApp_BridgeRxFeed
+        self.header = bytearray()
+        self.body_left = 0
+        self.control = None
+        self.chunk = bytearray()
+
+    def send_air(self):
+        if self.chunk:
+            if self.air_write_s:
+                time.sleep(self.air_write_s)
+            self.air.append((time.perf_counter(), len(self.chunk)))
+            self.chunk = bytearray()
+
+    def forward(self, data):
+        while data:
+            if len(self.chunk) >= self.mtu:
+                self.send_air()
+            count = min(len(data), self.mtu - len(self.chunk))
+            self.chunk += data[:count]
+            data = data[count:]
+
+    def write_status(self, status):
+        offer = self.max_baud if self.mode == 'bridge' else 0
+        packet = frame(FIRMWARE_RESPONSE, 0xffffffff, status + b'00:60:37:12:34:56', offer)
+        if self.mode == 'bridge':
+            return self.link.write(packet)
+        self.link.write(packet[:HEADER_LEN])
+        time.sleep(LEGACY_STATUS_GAP_S)
+        return self.link.write(packet[HEADER_LEN:])
+
+    def control_request(self, pkt_id, request):
+        baud = request & ~LINK_FLOW_CONTROL
+        accepted = baud if DEFAULT_BAUD <= baud <= self.max_baud else 0
+        self.link.write(frame(BRIDGE_CONTROL, pkt_id, reserved=accepted))
+        self.link.drain()
+        if accepted:
+            self.link.baud = accepted
+
+    def feed_bridge(self, data):
+        i = 0
+        while i < len(data):
+            if self.control is not None:
+                count = min(len(data) - i, 4 - len(self.control))
+                self.control += data[i:i + count]
+                i += count
+                if len(self.control) == 4:
+                    pkt_id = struct.unpack_from('<I', self.header, 8)[0]
+                    self.control_request(pkt_id, struct.unpack('<I', self.control)[0])
+                    self.control = None
+                    self.header = bytearray()
+            elif self.body_left:
+                count = min(len(data) - i, self.body_left)
+                self.forward(data[i:i + count])
+                i += count
+                self.body_left -= count
+                if self.body_left == 0:
+                    self.send_air()
+            else:
+                self.header.append(data[i])
+                i += 1
+                n = len(self.header)
+                if n <= len(TU_MAGIC) and self.header[n - 1] != TU_MAGIC[n - 1]:
+                    self.forward(bytes(self.header))
+                    self.header = bytearray()
+                elif n == HEADER_LEN:
+                    header = parse_header(bytes(self.header))
+                    if header is None:
+                        self.forward(bytes(self.header))
+                        self.header = bytearray()
+                    elif header[0] == BRIDGE_CONTROL and header[1] == 4:
+                        self.control = bytearray()
+                    else:
+                        self.send_air()
+                        self.forward(bytes(self.header))
+                        self.header = bytearray()
+                        self.body_left = header[1]
+                        if self.body_left == 0:
+                            self.send_air()
+        if not self.header and not self.body_left and self.control is None:
+            self.send_air()
+
+    def run(self):
+        last = None
+        while not self.stop:
+            timeout = 0.05
+            if self.mode == 'legacy' and self.chunk:
+                timeout = max(0.0, last + LEGACY_FLUSH_S - time.perf_counter())
+            ready, _, _ = select.select([self.fd], [], [], timeout)
+            if not ready:
+                if self.mode == 'legacy':
+                    self.send_air()
+                continue
+            data = os.read(self.fd, 4096)
+            last = time.perf_counter()
+            if self.mode == 'bridge':
+                self.feed_bridge(data)
+            else:
+                self.forward(data)
+                if len(self.chunk) >= self.mtu:
+                    self.send_air()
+
+
+class Host(threading.Thread):
+    '''Reader of the RT106F end, collects the packets written by the module'''
+
+    def __init__(self, fd):
+        super().__init__(daemon=True)
+        self.fd = fd
+        self.reader = FrameReader()
+        self.packets = []       # (time, header, body)
+        self.event = threading.Event()
+        self.stop = False
+
+    def run(self):
+        while not self.stop:
+            ready, _, _ = select.select([self.fd], [], [], 0.05)
+            if not ready:
+                continue
+            data = os.read(self.fd, 4096)
+            now = time.perf_counter()
+            for header, body in self.reader.feed(data):
+                self.packets.append((now, header, body))
+                self.event.set()
+
+    def wait(self, ptype, timeout=2.0):
+        end = time.perf_counter() + timeout
+        while time.perf_counter() < end:
+            for p in self.packets:
+                if p[1][0] == ptype:
+                    self.packets.remove(p)
+                    return p
+            self.event.clear()
+            self.event.wait(0.01)
+        return None
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p))] if values else 0.0
+
+
+def report(name, nbytes, start, end, latencies):
+    elapsed = max(end - start, 1e-9)
+    print('  %-7s %8.1f kB/s  latency mean %6.2f ms  p99 %6.2f ms  (%d packets, %d bytes)'
+          % (name, nbytes / elapsed / 1000.0, 1000.0 * sum(latencies) / len(latencies),
+             1000.0 * percentile(latencies, 0.99), len(latencies), nbytes))
+
+
+def bench(mode, args):
+    host_fd, module_fd = os.openpty()
+    tty.setraw(host_fd)
+    tty.setraw(module_fd)
+
+    module = Module(module_fd, mode, args.mtu, args.baud, args.air_write_us / 1e6)
+    host = Host(host_fd)
+    link = Link(host_fd, DEFAULT_BAUD)
+    module.start()
+    host.start()
+    print('%s:' % mode)
+
+    try:
+        # status of the module and, in bridge mode, the link request
+        start = time.perf_counter()
+        module.write_status(b'BLE-READY_')
+        status = host.wait(FIRMWARE_RESPONSE)
+        if status is None:
+            raise RuntimeError('no READY status')
+        print('  status  %.2f ms from the first byte' % (1000.0 * (status[0] - start)))
+
+        offer = status[1][4]
+        if mode == 'bridge' and offer:
+            start = time.perf_counter()
+            request = min(args.baud, offer & ~LINK_FLOW_CONTROL)
+            link.write(frame(BRIDGE_CONTROL, 0, struct.pack('<I', request)))
+            answer = host.wait(BRIDGE_CONTROL)
+            if answer is None or answer[1][4] == 0:
+                raise RuntimeError('link request refused')
+            link.baud = answer[1][4] & ~LINK_FLOW_CONTROL
+            print('  link    %d bps, agreed in %.2f ms' % (link.baud, 1000.0 * (time.perf_counter() - start)))
+
+        # up: packets of the host to the air
+        body = bytes((i * 7 + 1) & 0xFF or 1 for i in range(args.size))
+        ends = []
+        offsets = []
+        total = 0
+        start = time.perf_counter()
+        for i in range(args.count):
+            packet = frame(i % 32, i, body)
+            total += len(packet)
+            offsets.append(total)
+            ends.append(link.write(packet))
+        deadline = time.perf_counter() + 2.0
+        while sum(n for _, n in module.air) < total and time.perf_counter() < deadline:
+            time.sleep(0.005)
+
+        latencies = []
+        done = 0
+        j = 0
+        for t, n in module.air:
+            done += n
+            while j < len(offsets) and offsets[j] <= done:
+                latencies.append(max(0.0, t - ends[j]))
+                j += 1
+        if j < len(offsets):
+            raise RuntimeError('%d of %d packets reached the air' % (j, len(offsets)))
+        report('up', total, start, module.air[-1][0], latencies)
+
+        # down: packets of the air to the host, written in GATT sized pieces as they arrive
+        host.packets = []
+        ends = []
+        start = time.perf_counter()
+        for i in range(args.count):
+            packet = frame((i % 32) | 1, i, body)
+            for k in range(0, len(packet), args.mtu):
+                end = module.link.write(packet[k:k + args.mtu])
+            ends.append(end)
+        deadline = time.perf_counter() + 2.0
+        while len(host.packets) < args.count and time.perf_counter() < deadline:
+            time.sleep(0.005)
+        got = {p[1][2]: p[0] for p in host.packets}
+        if len(got) < args.count:
+            raise RuntimeError('%d of %d packets reached the host' % (len(got), args.count))
+        latencies = [max(0.0, got[i] - ends[i]) for i in range(args.count)]
+        report('down', args.count * (HEADER_LEN + args.size), start, max(got.values()), latencies)
+    finally:
+        module.stop = True
+        host.stop = True
+        module.join()
+        host.join()
+        os.close(host_fd)
+        os.close(module_fd)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Measure the wireless uart link on a pseudo terminal pair')
+    parser.add_argument('--mode', choices=['legacy', 'bridge', 'both'], default='both')
+    parser.add_argument('--baud', type=int, default=1000000, help='rate asked for in bridge mode')
+    parser.add_argument('--count', type=int, default=50, help='packets sent each way')
+    parser.add_argument('--size', type=int, default=1024, help='packet body size, a face feature is about 1 kB')
+    parser.add_argument('--mtu', type=int, default=244, help='GATT write size, gAttMaxWriteDataSize_d(gAttMaxMtu_c)')
+    parser.add_argument('--air-write-us', type=int, default=0, help='time taken by a GATT write, 0 for the link only')
+    args = parser.parse_args()
+
+    try:
+        for mode in (['legacy', 'bridge'] if args.mode == 'both' else [args.mode]):
+            bench(mode, args)
+    except (OSError, RuntimeError) as e:
+        print('error: %s' % e, file=sys.stderr)
+        return 2
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
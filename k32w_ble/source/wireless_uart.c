@@ -36,6 +36,7 @@
 #endif
 
 #include "board.h"
+#include "fsl_usart.h"
 
 /* BLE Host Stack */
 #include "gatt_interface.h"
@@ -101,6 +102,12 @@
 #define BLE_WUART_READY     "BLE-READY_"
 #define BLE_WUART_CONNECTED "BLE-CONNECTED_"
 
+#define BLE_WUART_HEADER_LENGTH         24
+#define BLE_WUART_BRIDGE_CONTROL        0xfe    /* link control packet, consumed here and never sent to the air */
+#define BLE_WUART_FIRMWARE_RESPONSE     0xff    /* status of the module, READY or CONNECTED */
+#define BLE_WUART_BRIDGE_FLOW_CONTROL   (0x80000000UL) /* RTS/CTS flag of the link words */
+#define BLE_WUART_BRIDGE_BAUD_MASK      (0x7FFFFFFFUL)
+
 /************************************************************************************
  *************************************************************************************
  * Private macros
@@ -117,6 +124,29 @@
 #define mAppUartFlushIntervalInMs_c       (7)     /* Flush Timeout in Ms */
 #endif
 
+/* Bridge mode: the host link only carries framed packets. The stream from the host is parsed as it arrives and sent
+ * to the air when a packet ends or fills a write, packets to the host go out header and body in one write, and the
+ * host can move the link to a higher baud rate with a control packet */
+#ifndef gAppUartBridge_d
+#define gAppUartBridge_d                1
+#endif
+
+/* Highest baud rate offered to the host in the READY and CONNECTED status */
+#ifndef gAppUartBridgeMaxBaudRate_c
+#define gAppUartBridgeMaxBaudRate_c     (1000000U)
+#endif
+
+#define mAppUartBridgeUsart_c           USART0  /* APP_SERIAL_INTERFACE_INSTANCE */
+
+/* Ask the peers for the longest link layer packets and the 2M PHY, and exchange the MTU in the peripheral role too
+ * since the module writes to the peer as a GATT client. Bulk transfers of the host then stream at link speed */
+#ifndef gAppBulkLink_d
+#define gAppBulkLink_d                  1
+#endif
+
+/* The stream from the host is flushed to the air by a timer, unless the bridge flushes it on packet boundaries */
+#define mAppUartFlushTimer_d            (((cPWR_FullPowerDownMode==0) || gPWR_SerialUartRxWakeup) && !gAppUartBridge_d)
+
 #define mBatteryLevelReportInterval_c   (10)    /* battery level report interval in seconds  */
 
 #define mTemperatureReportInterval_c    (10)    /* temperature measurement interval in seconds */
@@ -168,6 +198,29 @@ typedef enum {
     gAdcMeasureBatteryLevel_c           = BIT2,  /* Battery level measurement */
 } gAdcMeasure_t;
 
+#if gAppUartBridge_d
+typedef enum bridgeRxStage_tag
+{
+    mBridgeRxHeader_c,      /* collecting a transfer unit */
+    mBridgeRxBody_c,        /* sending a packet body to the air */
+    mBridgeRxControl_c      /* collecting the body of a control packet */
+} bridgeRxStage_t;
+
+typedef struct bridgeRx_tag
+{
+    uint8_t  aHeader[BLE_WUART_HEADER_LENGTH];
+    uint8_t  headerLen;
+    uint8_t  stage;
+    bool_t   forward;                       /* a peer is running, else the packets are dropped */
+    uint32_t bodyLeft;
+    uint8_t  aControl[sizeof(uint32_t)];
+    uint8_t  controlLen;
+    uint16_t chunkLen;
+    uint8_t  aChunk[mAppUartBufferSize_c];  /* bytes waiting for a packet boundary or a full write */
+    uint8_t  aRead[mAppUartBufferSize_c];
+} bridgeRx_t;
+#endif
+
 /************************************************************************************
  *************************************************************************************
  * Private memory declarations
@@ -199,7 +252,7 @@ static bool_t      mBasValidClientList[gAppMaxConnections_c] = {FALSE};
 static basConfig_t mBasServiceConfig = {(uint16_t)service_battery, 0, mBasValidClientList, gAppMaxConnections_c};
 
 static tmrTimerID_t mAppTimerId = gTmrInvalidTimerID_c;
-#if (cPWR_FullPowerDownMode==0) || gPWR_SerialUartRxWakeup
+#if mAppUartFlushTimer_d
 static tmrTimerID_t mUartStreamFlushTimerId = gTmrInvalidTimerID_c;
 #endif
 #if (cPWR_FullPowerDownMode==0)
@@ -217,6 +270,11 @@ static uint16_t mAppUartBufferSize = mAppUartBufferSize_c;
 static volatile bool_t mAppUartNewLine = FALSE;
 static volatile bool_t mAppDapaPending = FALSE;
 
+#if gAppUartBridge_d
+static bridgeRx_t mBridgeRx;
+static uint32_t mAppUartLink = gAppBaudRate_c;   /* baud rate and flow control agreed with the host */
+#endif
+
 #if (gKBD_KeysCount_c == 1)
 static uint8_t mSwitchPressCnt = 0;
 #endif
@@ -295,7 +353,7 @@ static bool_t BleApp_CheckScanEvent(gapScannedDevice_t *pData);
 static void ScanningTimerCallback(void *pParam);
 #endif
 
-#if (cPWR_FullPowerDownMode==0) || gPWR_SerialUartRxWakeup
+#if mAppUartFlushTimer_d
 static void UartStreamFlushTimerCallback(void *pData);
 #endif
 
@@ -318,6 +376,15 @@ static void Uart_TxCallBack(void *pBuffer);
 static void BleApp_FlushUartStream(void *pParam);
 static void BleApp_ReceivedUartStream(deviceId_t peerDeviceId, uint8_t *pStream, uint16_t streamLength);
 
+static void BleApp_WriteFrame(uint8_t type, uint32_t pkt_id, uint32_t result, uint8_t *pData, uint32_t len,
+                              bool_t sync);
+static void BleApp_WriteStatus(const char *pStatus);
+static void BleApp_UpdateUartBufferSize(void);
+#if gAppUartBridge_d
+static void BleApp_BridgeSetLink(uint32_t link);
+static void BleApp_BridgeRxFeed(const uint8_t *pData, uint16_t len);
+#endif
+
 #if defined(gUseControllerNotifications_c) && (gUseControllerNotifications_c)
 static void BleApp_HandleControllerNotification(bleNotificationEvent_t *pNotificationEvent);
 
@@ -341,7 +408,6 @@ static void BleAppDrv_DeInit(void);
 * \brief    Initializes application specific functionality before the BLE stack init.
 *
 ********************************************************************************** */
-#define BLE_WUART_HEADER_LENGTH 24
 static const uint8_t TU_MAGIC[] = {0x53, 0x79, 0x4c};
 
 static uint32_t table[0x100];
@@ -355,7 +421,6 @@ uint32_t crc32_for_byte(uint32_t r)
 
 void crc32(const void *data, size_t n_bytes, uint32_t* crc)
 {
-    memset(table, 0x00, sizeof(table));
     if(!*table)
         for(size_t i = 0; i < 0x100; ++i)
             table[i] = crc32_for_byte(i);
@@ -509,49 +574,17 @@ void BleApp_HandleKeys(key_event_t events)
             }
 #else
             OSA_TimeDelay(20);
+#if gAppUartBridge_d
+            /* the host asks for the status after it restarted, talk to it at the default rate again */
+            BleApp_BridgeSetLink(gAppBaudRate_c);
+#endif
             if (mAdvState.advOn == TRUE)
             {
-                char adv_name[18];
-                uint8_t htUnit[BLE_WUART_HEADER_LENGTH] = {0};
-                uint8_t htData[sizeof(BLE_WUART_READY) + sizeof(adv_name)] = {0};
-
-                sprintf(adv_name, "%02X:%02X:%02X:%02X:%02X:%02X",
-                        maBleDeviceAddress[5],
-                        maBleDeviceAddress[4],
-                        maBleDeviceAddress[3],
-                        maBleDeviceAddress[2],
-                        maBleDeviceAddress[1],
-                        maBleDeviceAddress[0]);
-                memcpy(htData, BLE_WUART_READY, strlen(BLE_WUART_READY));
-                strncat((char *)htData, adv_name, sizeof(adv_name));
-
-                SLN_BLEWUARTCreateHeader(htUnit, (uint8_t *)htData, strlen((char *)htData),
-                        0xff, 0xffffffff, 0);
-                (void)Serial_SyncWrite(gAppSerMgrIf, htUnit, BLE_WUART_HEADER_LENGTH);
-                OSA_TimeDelay(10);
-                (void)Serial_Print(gAppSerMgrIf, (char *)htData, gAllowToBlock_d);
+                BleApp_WriteStatus(BLE_WUART_READY);
             }
             else
             {
-                char adv_name[18];
-                uint8_t htUnit[BLE_WUART_HEADER_LENGTH] = {0};
-                uint8_t htData[sizeof(BLE_WUART_CONNECTED) + sizeof(adv_name)] = {0};
-
-                sprintf(adv_name, "%02X:%02X:%02X:%02X:%02X:%02X",
-                        maBleDeviceAddress[5],
-                        maBleDeviceAddress[4],
-                        maBleDeviceAddress[3],
-                        maBleDeviceAddress[2],
-                        maBleDeviceAddress[1],
-                        maBleDeviceAddress[0]);
-                memcpy(htData, BLE_WUART_CONNECTED, strlen(BLE_WUART_CONNECTED));
-                strncat((char *)htData, adv_name, sizeof(adv_name));
-
-                SLN_BLEWUARTCreateHeader(htUnit, (uint8_t *)htData, strlen((char *)htData),
-                        0xff, 0xffffffff, 0);
-                (void)Serial_SyncWrite(gAppSerMgrIf, htUnit, BLE_WUART_HEADER_LENGTH);
-                OSA_TimeDelay(10);
-                (void)Serial_Print(gAppSerMgrIf, (char *)htData, gAllowToBlock_d);
+                BleApp_WriteStatus(BLE_WUART_CONNECTED);
             }
 #endif
             break;
@@ -635,24 +668,8 @@ void BleApp_GenericCallback(gapGenericEvent_t *pGenericEvent)
         case gAdvertisingParametersSetupComplete_c:
         {
             char adv_name[18];
-            uint8_t htUnit[BLE_WUART_HEADER_LENGTH] = {0};
-            uint8_t htData[sizeof(BLE_WUART_READY) + sizeof(adv_name)] = {0};
-
-            sprintf(adv_name, "%02X:%02X:%02X:%02X:%02X:%02X",
-                    maBleDeviceAddress[5],
-                    maBleDeviceAddress[4],
-                    maBleDeviceAddress[3],
-                    maBleDeviceAddress[2],
-                    maBleDeviceAddress[1],
-                    maBleDeviceAddress[0]);
-            memcpy(htData, BLE_WUART_READY, strlen(BLE_WUART_READY));
-            strncat((char *)htData, adv_name, sizeof(adv_name));
-
-            SLN_BLEWUARTCreateHeader(htUnit, (uint8_t *)htData, strlen((char *)htData),
-                    0xff, 0xffffffff, 0);
-            (void)Serial_SyncWrite(gAppSerMgrIf, htUnit, BLE_WUART_HEADER_LENGTH);
-            OSA_TimeDelay(10);
-            (void)Serial_Print(gAppSerMgrIf, (char *)htData, gAllowToBlock_d);
+
+            BleApp_WriteStatus(BLE_WUART_READY);
 
             sprintf(adv_name, "VN%02X%02X%02X", maBleDeviceAddress[2], maBleDeviceAddress[1], maBleDeviceAddress[0]);
             advScanStruct[2].aData = (uint8_t *)adv_name;
@@ -681,6 +698,18 @@ void BleApp_GenericCallback(gapGenericEvent_t *pGenericEvent)
         break;
 #endif
 
+#if gAppBulkLink_d
+        case gLePhyEvent_c:
+        {
+            if (pGenericEvent->eventData.phyEvent.phyEventType == gPhyUpdateComplete_c)
+            {
+                APP_DEBUG_TRACE("Phy tx %d rx %d\r\n", pGenericEvent->eventData.phyEvent.txPhy,
+                                pGenericEvent->eventData.phyEvent.rxPhy);
+            }
+        }
+        break;
+#endif
+
         default:
         {
             ; /* No action required */
@@ -715,7 +744,13 @@ static void BleAppDrv_Init(bool reinit)
 
         SerialInterface_Reinit(gAppSerMgrIf);
 
+#if gAppUartBridge_d
+        /* keep the link agreed with the host */
+        Serial_SetBaudRate(gAppSerMgrIf, mAppUartLink & BLE_WUART_BRIDGE_BAUD_MASK);
+        USART_EnableCTS(mAppUartBridgeUsart_c, (mAppUartLink & BLE_WUART_BRIDGE_FLOW_CONTROL) != 0U);
+#else
         Serial_SetBaudRate(gAppSerMgrIf,  gAppBaudRate_c); /* might be 9600kbps just as well */
+#endif
 
 #if gKeyBoardSupported_d
         KBD_PrepareExitLowPower();
@@ -735,6 +770,10 @@ static void BleAppDrv_Init(bool reinit)
         Serial_InitInterface(&gAppSerMgrIf, APP_SERIAL_INTERFACE_TYPE, APP_SERIAL_INTERFACE_INSTANCE);
 
         Serial_SetBaudRate(gAppSerMgrIf, gAppBaudRate_c);
+#if gAppUartBridge_d
+        /* RTS/CTS are only used once the host asked for them */
+        USART_EnableCTS(mAppUartBridgeUsart_c, false);
+#endif
 
         /* Install Controller Events Callback handler */
         Serial_SetRxCallBack(gAppSerMgrIf, Uart_RxCallBack, NULL);
@@ -854,7 +893,7 @@ static void BleApp_Config(void)
 
     /* Allocate application timer */
     mAppTimerId = TMR_AllocateTimer();
-#if (cPWR_FullPowerDownMode==0) || gPWR_SerialUartRxWakeup
+#if mAppUartFlushTimer_d
     mUartStreamFlushTimerId = TMR_AllocateTimer();
 #endif
 #ifndef CPU_JN518X
@@ -1026,6 +1065,14 @@ static void BleApp_ConnectionCallback(deviceId_t peerDeviceId, gapConnectionEven
         {
             /* Save peer device ID */
             maPeerInformation[peerDeviceId].deviceId = peerDeviceId;
+            BleApp_UpdateUartBufferSize();
+
+#if gAppBulkLink_d
+            /* the peer may refuse, the link then keeps the default packet length and PHY */
+            (void)Gap_UpdateLeDataLength(peerDeviceId, gBleMaxTxOctets_c, gBleMaxTxTime_c);
+            (void)Gap_LeSetPhy(FALSE, peerDeviceId, 0, gLePhy2MFlag_c, gLePhy2MFlag_c,
+                               (uint16_t)gLeCodingNoPreference_c);
+#endif
 
             /* Advertising stops when connected */
 #if gWuart_PeripheralRole_c == 1
@@ -1087,25 +1134,7 @@ static void BleApp_ConnectionCallback(deviceId_t peerDeviceId, gapConnectionEven
 
 #endif /* gAppUseBonding_d*/
 #endif /* gAppUsePairing_d */
-            char adv_name[18];
-            uint8_t htUnit[BLE_WUART_HEADER_LENGTH] = {0};
-            uint8_t htData[sizeof(BLE_WUART_CONNECTED) + sizeof(adv_name)] = {0};
-
-            sprintf(adv_name, "%02X:%02X:%02X:%02X:%02X:%02X",
-                    maBleDeviceAddress[5],
-                    maBleDeviceAddress[4],
-                    maBleDeviceAddress[3],
-                    maBleDeviceAddress[2],
-                    maBleDeviceAddress[1],
-                    maBleDeviceAddress[0]);
-            memcpy(htData, BLE_WUART_CONNECTED, strlen(BLE_WUART_CONNECTED));
-            strncat((char *)htData, adv_name, sizeof(adv_name));
-
-            SLN_BLEWUARTCreateHeader(htUnit, (uint8_t *)htData, strlen((char *)htData),
-                    0xff, 0xffffffff, 0);
-            (void)Serial_SyncWrite(gAppSerMgrIf, htUnit, BLE_WUART_HEADER_LENGTH);
-            OSA_TimeDelay(10);
-            (void)Serial_Print(gAppSerMgrIf, (char *)htData, gAllowToBlock_d);
+            BleApp_WriteStatus(BLE_WUART_CONNECTED);
 //            (void)Serial_PrintDec(gAppSerMgrIf, peerDeviceId);
 //
 //            if (mGapRole == gGapCentral_c)
@@ -1177,23 +1206,7 @@ static void BleApp_ConnectionCallback(deviceId_t peerDeviceId, gapConnectionEven
             maPeerInformation[peerDeviceId].deviceId = gInvalidDeviceId_c;
 
             /* recalculate minimum of maximum MTU's of all connected devices */
-            mAppUartBufferSize                       = mAppUartBufferSize_c;
-
-            for (uint8_t mPeerId = 0; mPeerId < (uint8_t)gAppMaxConnections_c; mPeerId++)
-            {
-                if (gInvalidDeviceId_c != maPeerInformation[mPeerId].deviceId)
-                {
-                    uint16_t tempMtu;
-
-                    (void)Gatt_GetMtu(mPeerId, &tempMtu);
-                    tempMtu = gAttMaxWriteDataSize_d(tempMtu);
-
-                    if (tempMtu < mAppUartBufferSize)
-                    {
-                        mAppUartBufferSize = tempMtu;
-                    }
-                }
-            }
+            BleApp_UpdateUartBufferSize();
 #ifndef  gWURolePeripheral_d
             if (mGapRole == gGapPeripheral_c)
 #endif
@@ -1244,6 +1257,16 @@ static void BleApp_ConnectionCallback(deviceId_t peerDeviceId, gapConnectionEven
 
 #endif /* gAppUsePairing_d */
 
+#if gAppBulkLink_d
+        case gConnEvtLeDataLengthChanged_c:
+        {
+            APP_DEBUG_TRACE("Data length tx %d rx %d\r\n",
+                            pConnectionEvent->eventData.leDataLengthChanged.maxTxOctets,
+                            pConnectionEvent->eventData.leDataLengthChanged.maxRxOctets);
+        }
+        break;
+#endif
+
         default:
         {
             ; /* No action required */
@@ -1364,7 +1387,6 @@ static void BleApp_GattServerCallback(
     deviceId_t deviceId,
     gattServerEvent_t *pServerEvent)
 {
-    uint16_t tempMtu = 0;
     APP_DEBUG_TRACE("%s Evt=%x\r\n", __FUNCTION__, pServerEvent);
     switch (pServerEvent->eventType)
     {
@@ -1382,10 +1404,7 @@ static void BleApp_GattServerCallback(
         case gEvtMtuChanged_c:
         {
             /* update stream length with minimum of  new MTU */
-            (void)Gatt_GetMtu(deviceId, &tempMtu);
-            tempMtu = gAttMaxWriteDataSize_d(tempMtu);
-
-            mAppUartBufferSize = mAppUartBufferSize <= tempMtu ? mAppUartBufferSize : tempMtu;
+            BleApp_UpdateUartBufferSize();
         }
         break;
 
@@ -1472,6 +1491,31 @@ static void BleApp_StoreServiceHandles(deviceId_t peerDeviceId, gattService_t *p
     }
 }
 
+/*! *********************************************************************************
+* \brief        Sets the size of the writes to the air to the smallest MTU of the
+*               connected peers, the MTU is the default one until it is exchanged.
+********************************************************************************** */
+static void BleApp_UpdateUartBufferSize(void)
+{
+    uint16_t tempMtu;
+
+    mAppUartBufferSize = mAppUartBufferSize_c;
+
+    for (uint8_t mPeerId = 0; mPeerId < (uint8_t)gAppMaxConnections_c; mPeerId++)
+    {
+        if ((gInvalidDeviceId_c != maPeerInformation[mPeerId].deviceId) &&
+            (gBleSuccess_c == Gatt_GetMtu(mPeerId, &tempMtu)))
+        {
+            tempMtu = gAttMaxWriteDataSize_d(tempMtu);
+
+            if (tempMtu < mAppUartBufferSize)
+            {
+                mAppUartBufferSize = tempMtu;
+            }
+        }
+    }
+}
+
 static void BleApp_SendUartStream(uint8_t *pRecvStream, uint8_t streamSize)
 {
     gattCharacteristic_t characteristic = {gGattCharPropNone_c, {0}, 0, 0};
@@ -1485,16 +1529,19 @@ static void BleApp_SendUartStream(uint8_t *pRecvStream, uint8_t streamSize)
         {
             SERIAL_DBG_LOG("peerId=%d streamSz=%d", mPeerId, streamSize);
             characteristic.value.handle = maPeerInformation[mPeerId].clientInfo.hUartStream;
-            (void)GattClient_WriteCharacteristicValue(mPeerId, &characteristic,
+            /* writes without response are not retried, the bulk transfers of the host resend what is not acked */
+            if (gBleSuccess_c != GattClient_WriteCharacteristicValue(mPeerId, &characteristic,
                     streamSize, pRecvStream, TRUE,
-                    FALSE, FALSE, NULL);
+                    FALSE, FALSE, NULL))
+            {
+                SERIAL_DBG_LOG("peerId=%d write of %d bytes dropped", mPeerId, streamSize);
+            }
         }
     }
 }
 
 void BleApp_StateMachineHandler(deviceId_t peerDeviceId, appEvent_t event)
 {
-    uint16_t tempMtu = 0;
     union
     {
         uint8_t     *pUuidArray;
@@ -1515,16 +1562,19 @@ void BleApp_StateMachineHandler(deviceId_t peerDeviceId, appEvent_t event)
         {
             if (event == mAppEvt_PeerConnected_c || event == mAppEvt_PairingComplete_c)
             {
-                /* Let the central device initiate the Exchange MTU procedure*/
+                /* Let the central device initiate the Exchange MTU procedure, or both in bulk mode */
+                bool_t exchangeMtu = (gAppBulkLink_d != 0);
+
 #ifndef gWURolePeripheral_d
-                if (mGapRole == gGapCentral_c)
+                exchangeMtu = exchangeMtu || (mGapRole == gGapCentral_c);
+#endif
+                if (exchangeMtu)
                 {
                     /* Moving to Exchange MTU State */
                     maPeerInformation[peerDeviceId].appState = mAppExchangeMtu_c;
                     (void)GattClient_ExchangeMtu(peerDeviceId, gAttMaxMtu_c);
                 }
                 else
-#endif
                 {
                     /* Moving to Service Discovery State*/
                     maPeerInformation[peerDeviceId].appState = mAppServiceDisc_c;
@@ -1543,10 +1593,7 @@ void BleApp_StateMachineHandler(deviceId_t peerDeviceId, appEvent_t event)
             if (event == mAppEvt_GattProcComplete_c)
             {
                 /* update stream length with minimum of maximum MTU's of connected devices */
-                (void)Gatt_GetMtu(peerDeviceId, &tempMtu);
-                tempMtu = gAttMaxWriteDataSize_d(tempMtu);
-
-                mAppUartBufferSize = mAppUartBufferSize <= tempMtu ? mAppUartBufferSize : tempMtu;
+                BleApp_UpdateUartBufferSize();
 
                 /* Moving to Service Discovery State*/
                 maPeerInformation[peerDeviceId].appState = mAppServiceDisc_c;
@@ -1679,11 +1726,285 @@ static void SwitchPressTimerCallback(void *pParam)
 }
 #endif
 
+/*! *********************************************************************************
+* \brief        Writes a packet to the host. The transfer unit and the packet body
+*               go out in one serial write, the body is not a string.
+*
+* \param[in]    type        Packet type.
+* \param[in]    pkt_id      Packet id.
+* \param[in]    result      Reserved word of the transfer unit.
+* \param[in]    pData       Packet body, NULL if len is 0.
+* \param[in]    len         Length of the packet body.
+* \param[in]    sync        Return once the packet is written.
+********************************************************************************** */
+static void BleApp_WriteFrame(uint8_t type, uint32_t pkt_id, uint32_t result, uint8_t *pData, uint32_t len,
+                              bool_t sync)
+{
+    uint8_t *pBuffer = MEM_BufferAlloc(BLE_WUART_HEADER_LENGTH + len);
+
+    if (NULL == pBuffer)
+    {
+        SERIAL_DBG_LOG("Allocation of a %d bytes packet failed", len);
+        return;
+    }
+
+    if (len > 0U)
+    {
+        FLib_MemCpy(pBuffer + BLE_WUART_HEADER_LENGTH, pData, len);
+    }
+    SLN_BLEWUARTCreateHeader(pBuffer, pBuffer + BLE_WUART_HEADER_LENGTH, len, type, pkt_id, result);
+
+    if (sync)
+    {
+        (void)Serial_SyncWrite(gAppSerMgrIf, pBuffer, (uint16_t)(BLE_WUART_HEADER_LENGTH + len));
+        (void)MEM_BufferFree(pBuffer);
+    }
+    else if (Serial_AsyncWrite(gAppSerMgrIf, pBuffer, (uint16_t)(BLE_WUART_HEADER_LENGTH + len), Uart_TxCallBack,
+                               pBuffer) != gSerial_Success_c)
+    {
+        (void)MEM_BufferFree(pBuffer);
+    }
+}
+
+/*! *********************************************************************************
+* \brief        Writes the status of the module and its address to the host. In
+*               bridge mode the reserved word offers the highest baud rate and the
+*               flow control the host may ask for.
+*
+* \param[in]    pStatus     BLE_WUART_READY or BLE_WUART_CONNECTED.
+********************************************************************************** */
+static void BleApp_WriteStatus(const char *pStatus)
+{
+    char     aStatus[sizeof(BLE_WUART_CONNECTED) + 18];
+    uint32_t link = 0;
+
+    (void)sprintf(aStatus, "%s%02X:%02X:%02X:%02X:%02X:%02X", pStatus,
+                  maBleDeviceAddress[5],
+                  maBleDeviceAddress[4],
+                  maBleDeviceAddress[3],
+                  maBleDeviceAddress[2],
+                  maBleDeviceAddress[1],
+                  maBleDeviceAddress[0]);
+
+#if gAppUartBridge_d
+    link = gAppUartBridgeMaxBaudRate_c;
+#if gUartHwFlowControl_d
+    link |= BLE_WUART_BRIDGE_FLOW_CONTROL;
+#endif
+#endif
+
+    BleApp_WriteFrame(BLE_WUART_FIRMWARE_RESPONSE, 0xffffffff, link, (uint8_t *)aStatus, strlen(aStatus), FALSE);
+}
+
+#if gAppUartBridge_d
+/*! *********************************************************************************
+* \brief        Moves the host link to a new baud rate and flow control, once the
+*               bytes already written have left the USART.
+*
+* \param[in]    link        Baud rate, with BLE_WUART_BRIDGE_FLOW_CONTROL for RTS/CTS.
+********************************************************************************** */
+static void BleApp_BridgeSetLink(uint32_t link)
+{
+    while (((USART_GetStatusFlags(mAppUartBridgeUsart_c) & (uint32_t)kUSART_TxFifoEmptyFlag) == 0U) ||
+           ((mAppUartBridgeUsart_c->STAT & USART_STAT_TXIDLE_MASK) == 0U))
+    {
+    }
+
+    mAppUartLink = link;
+    (void)Serial_SetBaudRate(gAppSerMgrIf, link & BLE_WUART_BRIDGE_BAUD_MASK);
+    USART_EnableCTS(mAppUartBridgeUsart_c, (link & BLE_WUART_BRIDGE_FLOW_CONTROL) != 0U);
+}
+
+/*! *********************************************************************************
+* \brief        Handles a control packet of the host. The body is the baud rate the
+*               host asks for, the answer carries the link accepted, 0 if refused,
+*               and is written at the current rate before the link is changed.
+*
+* \param[in]    pkt_id      Packet id of the request.
+* \param[in]    request     Baud rate, with BLE_WUART_BRIDGE_FLOW_CONTROL for RTS/CTS.
+********************************************************************************** */
+static void BleApp_BridgeControl(uint32_t pkt_id, uint32_t request)
+{
+    uint32_t baudRate = request & BLE_WUART_BRIDGE_BAUD_MASK;
+    uint32_t link     = 0;
+
+    if ((baudRate >= gAppBaudRate_c) && (baudRate <= gAppUartBridgeMaxBaudRate_c))
+    {
+        link = baudRate;
+#if gUartHwFlowControl_d
+        link |= request & BLE_WUART_BRIDGE_FLOW_CONTROL;
+#endif
+    }
+
+    BleApp_WriteFrame(BLE_WUART_BRIDGE_CONTROL, pkt_id, link, NULL, 0, TRUE);
+
+    if (link != 0U)
+    {
+        BleApp_BridgeSetLink(link);
+    }
+}
+
+/*! *********************************************************************************
+* \brief        Sends the bytes waiting for the air in one write to every peer.
+********************************************************************************** */
+static void BleApp_BridgeRxSend(void)
+{
+    bridgeRx_t *pRx = &mBridgeRx;
+
+    if ((pRx->chunkLen > 0U) && pRx->forward)
+    {
+        BleApp_SendUartStream(pRx->aChunk, (uint8_t)pRx->chunkLen);
+    }
+    pRx->chunkLen = 0;
+}
+
+/*! *********************************************************************************
+* \brief        Queues bytes for the air, full writes are sent right away.
+********************************************************************************** */
+static void BleApp_BridgeRxForward(const uint8_t *pData, uint32_t len)
+{
+    bridgeRx_t *pRx = &mBridgeRx;
+    uint32_t    count;
+
+    while (len > 0U)
+    {
+        if (pRx->chunkLen >= mAppUartBufferSize)
+        {
+            BleApp_BridgeRxSend();
+        }
+
+        count = mAppUartBufferSize - pRx->chunkLen;
+        count = (len < count) ? len : count;
+        FLib_MemCpy(&pRx->aChunk[pRx->chunkLen], pData, count);
+        pRx->chunkLen += (uint16_t)count;
+        pData += count;
+        len -= count;
+    }
+}
+
+/*! *********************************************************************************
+* \brief        Checks a transfer unit received from the host.
+********************************************************************************** */
+static bool_t BleApp_BridgeCheckHeader(const uint8_t *pHeader)
+{
+    uint32_t crc_res = 0;
+
+    crc32(pHeader, BLE_WUART_HEADER_LENGTH - 4, &crc_res);
+    return FLib_MemCmp(pHeader + BLE_WUART_HEADER_LENGTH - 4, &crc_res, sizeof(crc_res));
+}
+
+/*! *********************************************************************************
+* \brief        Parses the stream of the host. Packets are sent to the air when they
+*               end or fill a write, control packets are handled here. Bytes which
+*               are not part of a packet are passed through.
+*
+* \param[in]    pData       Bytes read from the host.
+* \param[in]    len         Number of bytes.
+********************************************************************************** */
+static void BleApp_BridgeRxFeed(const uint8_t *pData, uint16_t len)
+{
+    bridgeRx_t *pRx = &mBridgeRx;
+    uint16_t    used = 0;
+    uint32_t    count;
+    uint32_t    pktLen;
+
+    while (used < len)
+    {
+        switch (pRx->stage)
+        {
+            case mBridgeRxHeader_c:
+            {
+                pRx->aHeader[pRx->headerLen++] = pData[used++];
+
+                if ((pRx->headerLen <= sizeof(TU_MAGIC)) &&
+                    (pRx->aHeader[pRx->headerLen - 1U] != TU_MAGIC[pRx->headerLen - 1U]))
+                {
+                    BleApp_BridgeRxForward(pRx->aHeader, pRx->headerLen);
+                    pRx->headerLen = 0;
+                }
+                else if (pRx->headerLen == BLE_WUART_HEADER_LENGTH)
+                {
+                    pRx->headerLen = 0;
+                    FLib_MemCpy(&pktLen, &pRx->aHeader[4], sizeof(pktLen));
+
+                    if (!BleApp_BridgeCheckHeader(pRx->aHeader))
+                    {
+                        BleApp_BridgeRxForward(pRx->aHeader, BLE_WUART_HEADER_LENGTH);
+                    }
+                    else if ((pRx->aHeader[3] == BLE_WUART_BRIDGE_CONTROL) && (pktLen == sizeof(pRx->aControl)))
+                    {
+                        pRx->controlLen = 0;
+                        pRx->stage      = mBridgeRxControl_c;
+                    }
+                    else
+                    {
+                        /* a packet starts, the bytes before it go out on their own */
+                        BleApp_BridgeRxSend();
+                        BleApp_BridgeRxForward(pRx->aHeader, BLE_WUART_HEADER_LENGTH);
+                        pRx->bodyLeft = pktLen;
+                        pRx->stage    = mBridgeRxBody_c;
+                        if (pktLen == 0U)
+                        {
+                            BleApp_BridgeRxSend();
+                            pRx->stage = mBridgeRxHeader_c;
+                        }
+                    }
+                }
+                else
+                {
+                    ; /* No action required */
+                }
+            }
+            break;
+
+            case mBridgeRxBody_c:
+            {
+                count = (uint32_t)len - used;
+                count = (pRx->bodyLeft < count) ? pRx->bodyLeft : count;
+                BleApp_BridgeRxForward(&pData[used], count);
+                used += (uint16_t)count;
+                pRx->bodyLeft -= count;
+
+                if (pRx->bodyLeft == 0U)
+                {
+                    BleApp_BridgeRxSend();
+                    pRx->stage = mBridgeRxHeader_c;
+                }
+            }
+            break;
+
+            case mBridgeRxControl_c:
+            {
+                uint32_t request;
+                uint32_t pkt_id;
+
+                pRx->aControl[pRx->controlLen++] = pData[used++];
+                if (pRx->controlLen == sizeof(pRx->aControl))
+                {
+                    pRx->stage = mBridgeRxHeader_c;
+                    FLib_MemCpy(&request, pRx->aControl, sizeof(request));
+                    FLib_MemCpy(&pkt_id, &pRx->aHeader[8], sizeof(pkt_id));
+                    BleApp_BridgeControl(pkt_id, request);
+                }
+            }
+            break;
+
+            default:
+                pRx->headerLen = 0;
+                pRx->stage     = mBridgeRxHeader_c;
+                break;
+        }
+    }
+}
+#endif /* gAppUartBridge_d */
+
 static void BleApp_FlushUartStream(void *pParam)
 {
     uint8_t  mPeerId = 0;
     bool_t   mValidDevices = FALSE;
+#if !gAppUartBridge_d
     static int alloc_fail = 0;
+#endif
 
     /* Valid devices are in Running state */
     for (mPeerId = 0; mPeerId < (uint8_t)gAppMaxConnections_c; mPeerId++)
@@ -1696,6 +2017,29 @@ static void BleApp_FlushUartStream(void *pParam)
         }
     }
 
+#if gAppUartBridge_d
+    {
+        uint16_t bytesRead = 0;
+
+        /* cleared first, bytes arriving while the stream is read post a new flush */
+        mAppDapaPending = FALSE;
+        mBridgeRx.forward = mValidDevices;
+
+        do {
+            if (Serial_Read(gAppSerMgrIf, mBridgeRx.aRead, sizeof(mBridgeRx.aRead), &bytesRead) != gSerial_Success_c)
+            {
+                break;
+            }
+            BleApp_BridgeRxFeed(mBridgeRx.aRead, bytesRead);
+        } while (bytesRead == sizeof(mBridgeRx.aRead));
+
+        /* bytes outside of a packet are not held back */
+        if ((mBridgeRx.stage == (uint8_t)mBridgeRxHeader_c) && (mBridgeRx.headerLen == 0U))
+        {
+            BleApp_BridgeRxSend();
+        }
+    }
+#else
     if (mValidDevices)
     {
         bool_t continue_read = false;
@@ -1730,6 +2074,7 @@ static void BleApp_FlushUartStream(void *pParam)
     }
 
     mAppDapaPending = FALSE;
+#endif /* gAppUartBridge_d */
 }
 
 static void BleApp_ReceivedUartStream(deviceId_t peerDeviceId, uint8_t *pStream, uint16_t streamLength)
@@ -1780,7 +2125,7 @@ static void BleApp_ReceivedUartStream(deviceId_t peerDeviceId, uint8_t *pStream,
     previousDeviceId = peerDeviceId;
 }
 
-#if (cPWR_FullPowerDownMode==0) || gPWR_SerialUartRxWakeup
+#if mAppUartFlushTimer_d
 static void UartStreamFlushTimerCallback(void *pData)
 {
     if (!mAppDapaPending)
@@ -1798,13 +2143,21 @@ static void UartStreamFlushTimerCallback(void *pData)
 ********************************************************************************** */
 static void Uart_RxCallBack(void *pData)
 {
+#if gAppUartBridge_d
+    /* The stream is parsed as it arrives, packets are sent to the air when they end or fill a write */
+    if (!mAppDapaPending)
+    {
+        mAppDapaPending = TRUE;
+        (void)App_PostCallbackMessage(BleApp_FlushUartStream, NULL);
+    }
+#else
     uint16_t byteCount = 0;
 
     (void)Serial_RxBufferByteCount(gAppSerMgrIf, &byteCount);
 
     if (byteCount < mAppUartBufferSize)
     {
-#if (cPWR_FullPowerDownMode==0) || gPWR_SerialUartRxWakeup
+#if mAppUartFlushTimer_d
         /* Restart flush timer */
         (void)TMR_StartLowPowerTimer(mUartStreamFlushTimerId,
                                      gTmrLowPowerSingleShotMillisTimer_c,
@@ -1821,6 +2174,7 @@ static void Uart_RxCallBack(void *pData)
             (void)App_PostCallbackMessage(BleApp_FlushUartStream, NULL);
         }
     }
+#endif /* gAppUartBridge_d */
 }
 
 /*! *********************************************************************************
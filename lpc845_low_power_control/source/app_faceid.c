@@ -16,6 +16,8 @@
 #include "fsl_iocon.h"
 #include "fsl_usart.h"
 #include "fsl_gpio.h"
+#include "fsl_pint.h"
+#include "fsl_syscon.h"
 #include "peripherals.h"
 #include "board.h"
 #include "app_faceid.h"
@@ -23,9 +25,59 @@
 /*******************************************************************************
  * Definitions
  ******************************************************************************/
-#define FACEID_RX_BUFFER_SIZE 256
 #define FACEID_TX_BUFFER_SIZE 256
 
+/* The face module answers with lines "AT+KEY=VALUE\r\n". The uart interrupt decodes them into records, the task only
+ * handles complete records and the core sleeps in between */
+#define FACEID_KEY_MAX_LEN    12
+#define FACEID_VALUE_MAX_LEN  32
+#define FACEID_QUEUE_LEN      4 /* power of 2 */
+#define FACEID_RX_WAKEUP_PINT kPINT_PinInt1
+
+typedef enum _faceid_cmd
+{
+    kFACEID_CmdUnknown = 0,
+    kFACEID_CmdPowerOffRsp,
+    kFACEID_CmdFaceRes,
+    kFACEID_CmdFaceReg,
+    kFACEID_CmdFaceDreg,
+    kFACEID_CmdFaceDel,
+    kFACEID_CmdFaceRreg,
+    kFACEID_CmdFaceMode,
+} faceid_cmd_t;
+
+typedef enum _faceid_result
+{
+    kFACEID_ResultOther = 0, /* the value is a name or a number, see the record text */
+    kFACEID_ResultOk,
+    kFACEID_ResultFail,
+    kFACEID_ResultAck,
+    kFACEID_ResultNack,
+    kFACEID_ResultDuplicate,
+    kFACEID_ResultSuccess,
+} faceid_result_t;
+
+typedef enum _faceid_rx_state
+{
+    kFACEID_RxWaitStart = 0, /* skip up to the '+', so a line whose first bytes were lost while waking up is kept */
+    kFACEID_RxKey,
+    kFACEID_RxValue,
+    kFACEID_RxDiscard, /* bad byte or unknown key, skip up to the end of the line */
+} faceid_rx_state_t;
+
+typedef struct _faceid_record
+{
+    uint8_t cmd;
+    uint8_t result;
+    char value[FACEID_VALUE_MAX_LEN + 1];
+} faceid_record_t;
+
+typedef struct _faceid_name
+{
+    const char *name;
+    uint8_t id;
+} faceid_name_t;
+
 /*******************************************************************************
  * Prototypes
  ******************************************************************************/
@@ -33,43 +85,134 @@
 /*******************************************************************************
  * Variables
  ******************************************************************************/
-static volatile uint8_t g_FACEIDCmdStatus  = 0;
-static uint8_t g_CommandBuf[FACEID_RX_BUFFER_SIZE];
+static const faceid_name_t s_FACEIDCmds[] = {
+    {"PWOFFRSP", kFACEID_CmdPowerOffRsp}, {"FACERES", kFACEID_CmdFaceRes},   {"FACEREG", kFACEID_CmdFaceReg},
+    {"FACEDREG", kFACEID_CmdFaceDreg},    {"FACEDEL", kFACEID_CmdFaceDel},   {"FACERREG", kFACEID_CmdFaceRreg},
+    {"FACEMODE", kFACEID_CmdFaceMode},
+};
+
+static const faceid_name_t s_FACEIDResults[] = {
+    {"OK", kFACEID_ResultOk},     {"FAIL", kFACEID_ResultFail},           {"ACK", kFACEID_ResultAck},
+    {"NACK", kFACEID_ResultNack}, {"DUPLICATE", kFACEID_ResultDuplicate}, {"SUCCESS", kFACEID_ResultSuccess},
+};
 
-static uint8_t g_FACEIDRecvBuf[FACEID_RX_BUFFER_SIZE];
 static uint8_t g_FACEIDTxBuf[FACEID_TX_BUFFER_SIZE];
 
-static volatile uint16_t g_FACEIDrxIndex = 0; /* Index of the memory to save new arrived data. */
-static volatile uint8_t *g_FACEIDCmdCmp  = NULL;
+/* Written by the uart interrupt only */
+static faceid_rx_state_t g_FACEIDRxState = kFACEID_RxWaitStart;
+static char g_FACEIDRxKey[FACEID_KEY_MAX_LEN + 1];
+static uint8_t g_FACEIDRxLen = 0;
+static uint32_t g_FACEIDRxDropped = 0; /* lines lost to uart errors or a full queue */
+
+/* Records queue, filled by the uart interrupt and emptied by the task */
+static faceid_record_t g_FACEIDQueue[FACEID_QUEUE_LEN];
+static volatile uint8_t g_FACEIDQueueHead = 0;
+static volatile uint8_t g_FACEIDQueueTail = 0;
 
 /*******************************************************************************
  * Code
  ******************************************************************************/
 
-void FACEID_USART_IRQHANDLER(void)
+static uint8_t FACEID_Lookup(const faceid_name_t *names, uint32_t count, const char *str)
 {
-    uint8_t data;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (strcmp(names[i].name, str) == 0)
+        {
+            return names[i].id;
+        }
+    }
+
+    return 0;
+}
 
-    if (kUSART_RxReady & USART_GetStatusFlags(FACEID_PERIPHERAL))
+static void FACEID_RxByte(uint8_t data)
+{
+    faceid_record_t *record = &g_FACEIDQueue[g_FACEIDQueueHead];
+
+    if ((data == '\r') || (data == '\n'))
     {
-        data                               = USART_ReadByte(FACEID_PERIPHERAL);
-        g_FACEIDRecvBuf[g_FACEIDrxIndex++] = data;
-        if (g_FACEIDrxIndex == FACEID_RX_BUFFER_SIZE)
+        if (g_FACEIDRxState == kFACEID_RxValue)
         {
-            g_FACEIDrxIndex = 0;
-            memset(g_FACEIDRecvBuf,0,sizeof(g_FACEIDRecvBuf));
+            record->value[g_FACEIDRxLen] = '\0';
+            record->result = FACEID_Lookup(s_FACEIDResults, ARRAY_SIZE(s_FACEIDResults), record->value);
+            g_FACEIDQueueHead = (g_FACEIDQueueHead + 1) & (FACEID_QUEUE_LEN - 1);
         }
+        g_FACEIDRxState = kFACEID_RxWaitStart;
+        return;
+    }
 
-        if (g_FACEIDrxIndex >= 2 &&
-            ((g_FACEIDRecvBuf[g_FACEIDrxIndex - 2] == '\r' && g_FACEIDRecvBuf[g_FACEIDrxIndex - 1] == '\n') ||
-             (g_FACEIDRecvBuf[g_FACEIDrxIndex - 1] == '\r' && g_FACEIDRecvBuf[g_FACEIDrxIndex - 2] == '\n')))
+    switch (g_FACEIDRxState)
+    {
+        case kFACEID_RxWaitStart:
+            if (data == '+')
+            {
+                g_FACEIDRxLen   = 0;
+                g_FACEIDRxState = kFACEID_RxKey;
+            }
+            break;
+
+        case kFACEID_RxKey:
+            if (data == '=')
+            {
+                g_FACEIDRxKey[g_FACEIDRxLen] = '\0';
+                record->cmd     = FACEID_Lookup(s_FACEIDCmds, ARRAY_SIZE(s_FACEIDCmds), g_FACEIDRxKey);
+                g_FACEIDRxLen   = 0;
+                g_FACEIDRxState = kFACEID_RxValue;
+
+                if (record->cmd == kFACEID_CmdUnknown)
+                {
+                    g_FACEIDRxState = kFACEID_RxDiscard;
+                }
+                else if (((g_FACEIDQueueHead + 1) & (FACEID_QUEUE_LEN - 1)) == g_FACEIDQueueTail)
+                {
+                    g_FACEIDRxDropped++;
+                    g_FACEIDRxState = kFACEID_RxDiscard;
+                }
+            }
+            else if (g_FACEIDRxLen < FACEID_KEY_MAX_LEN)
+            {
+                g_FACEIDRxKey[g_FACEIDRxLen++] = toupper(data);
+            }
+            else
+            {
+                g_FACEIDRxState = kFACEID_RxDiscard;
+            }
+            break;
+
+        case kFACEID_RxValue:
+            /* longer values are cut, only names are that long */
+            if (g_FACEIDRxLen < FACEID_VALUE_MAX_LEN)
+            {
+                record->value[g_FACEIDRxLen++] = data;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void FACEID_USART_IRQHANDLER(void)
+{
+    uint32_t status = USART_GetStatusFlags(FACEID_PERIPHERAL);
+
+    if (status & (kUSART_FramErrorFlag | kUSART_RxNoiseFlag | kUSART_HardwareOverrunFlag))
+    {
+        /* the line is damaged, typically by a wake up in the middle of a byte */
+        USART_ClearStatusFlags(FACEID_PERIPHERAL,
+                               kUSART_FramErrorFlag | kUSART_RxNoiseFlag | kUSART_HardwareOverrunFlag);
+        if (g_FACEIDRxState != kFACEID_RxWaitStart)
         {
-            g_FACEIDCmdStatus = 1;
-            memcpy(g_CommandBuf,g_FACEIDRecvBuf,sizeof(g_FACEIDRecvBuf));
-            g_FACEIDrxIndex = 0;
-            memset(g_FACEIDRecvBuf,0,sizeof(g_FACEIDRecvBuf));
+            g_FACEIDRxDropped++;
+            g_FACEIDRxState = kFACEID_RxDiscard;
         }
     }
+
+    while (kUSART_RxReady & USART_GetStatusFlags(FACEID_PERIPHERAL))
+    {
+        FACEID_RxByte(USART_ReadByte(FACEID_PERIPHERAL));
+    }
 }
 
 /**
@@ -91,10 +234,14 @@ void APP_FACEID_Init(void)
 {
 
 	DisableIRQ(FACEID_USART_IRQN);
-    g_FACEIDCmdStatus = 0;
-    memset(g_CommandBuf,0,sizeof(g_CommandBuf));
+    g_FACEIDRxState   = kFACEID_RxWaitStart;
+    g_FACEIDQueueHead = 0;
+    g_FACEIDQueueTail = 0;
     EnableIRQ(FACEID_USART_IRQN);
 
+    /* the rx pin wakes the core from deep sleep, the first bytes of the line are lost */
+    SYSCON_AttachSignal(SYSCON, FACEID_RX_WAKEUP_PINT, kSYSCON_GpioPort1Pin9ToPintsel);
+    EnableDeepSleepIRQ(PIN_INT1_IRQn);
 
     //please don't move this delay
 	{
@@ -107,139 +254,75 @@ void APP_FACEID_Init(void)
     Board_PullFaceIdPwrCtlPin(1);
 }
 
-static char *strupr(char *str)
+/**
+ * @brief   Check if a command of the face module is waiting, call it with the interrupts disabled before sleeping
+ * @param   NULL
+ * @return  true if APP_FACEID_Task has a command to handle
+ */
+bool APP_FACEID_IsPending(void)
 {
-    char *orign = str;
-
-    for (; *str != '=' && *str != '\0'; str++)
-    {
-        *str = toupper(*str);
-    }
+    return (g_FACEIDQueueHead != g_FACEIDQueueTail);
+}
 
-    return orign;
+/**
+ * @brief   Wake the core from deep sleep on the start bit of the face module uart
+ * @param   enable -- true before entering deep sleep, false after
+ * @return  NULL
+ */
+void APP_FACEID_SetRxWakeup(bool enable)
+{
+    PINT_PinInterruptConfig(PINT_PERIPHERAL, FACEID_RX_WAKEUP_PINT,
+                            enable ? kPINT_PinIntEnableFallEdge : kPINT_PinIntEnableNone, NULL);
 }
 
 /**
  * @brief   FACE ID Tasks Loop
- * @param   NULL
+ * @param   record -- command decoded by the uart interrupt
  * @return  FACEID Task Status
  */
-uint32_t faceid_task(uint8_t *buf, uint32_t *ret)
+static uint32_t faceid_task(const faceid_record_t *record)
 {
-    strupr((char *)buf);
-
-#if 0
-    PRINTF("&&&& ");
-    PRINTF("%s\r\n", buf);
-#endif
-
-    /**************************** result   **************************************/
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+PWOFFRSP=ACK");
-    if (g_FACEIDCmdCmp != NULL)
+    switch (record->cmd)
     {
-        PRINTF("&&& AT+PWOFFRSP=ACK\r\n");
-        return FACEIDPWROFFACK;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+PWOFFRSP=NACK");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+PWOFFRSP=NACK\r\n");
-        return FACEIDPWROFFNACK;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACERES=FAIL");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+FACERES=FAIL\r\n");
-        return FACEIDUNVALIDE;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACERES=");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& %s", g_FACEIDCmdCmp);
-        return FACEIDVALIDE;
-    }
-
-    /**************************** registration  **************************************/
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACEREG=OK");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&&  AT+FACEREG=OK\r\n");
-        return 0;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACEREG=DUPLICATE");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+FACEREG=DUPLICATE\r\n");
-        return 0;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACEREG=FAIL");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&&  AT+FACEREG=FAIL\r\n");
-        return 0;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACEREG=");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&&  %s", g_FACEIDCmdCmp);
-        return 0;
-    }
-
-    /**************************** deregistration/delete  **************************************/
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACEDREG=OK");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+FACEDREG=OK\r\n");
-        return 0;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACEDEL=SUCCESS");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+FACEDEL=SUCCESS\r\n");
-        return 0;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACEDEL=FAIL");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+FACEDEL=FAIL\r\n");
-        return 0;
-    }
-
-    /**************************** remote registration  **************************************/
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACERREG=DUPLICATE");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+FACERREG=DUPLICATE\r\n");
-        return 0;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACERREG=OK");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+FACERREG=OK\r\n");
-        return 0;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACERREG=FAIL");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&& AT+FACERREG=FAIL\r\n");
-        return 0;
-    }
-
-    g_FACEIDCmdCmp = (volatile uint8_t *)strstr((const char *)buf, (const char *)"AT+FACERREG=");
-    if (g_FACEIDCmdCmp != NULL)
-    {
-        PRINTF("&&&  %s", g_FACEIDCmdCmp);
-        return 0;
+        /**************************** result   **************************************/
+        case kFACEID_CmdPowerOffRsp:
+            if (record->result == kFACEID_ResultAck)
+            {
+                PRINTF("&&& AT+PWOFFRSP=ACK\r\n");
+                return FACEIDPWROFFACK;
+            }
+            if (record->result == kFACEID_ResultNack)
+            {
+                PRINTF("&&& AT+PWOFFRSP=NACK\r\n");
+                return FACEIDPWROFFNACK;
+            }
+            break;
+
+        case kFACEID_CmdFaceRes:
+            PRINTF("&&& AT+FACERES=%s\r\n", record->value);
+            return (record->result == kFACEID_ResultFail) ? FACEIDUNVALIDE : FACEIDVALIDE;
+
+        /**************************** registration  **************************************/
+        case kFACEID_CmdFaceReg:
+            PRINTF("&&& AT+FACEREG=%s\r\n", record->value);
+            break;
+
+        /**************************** deregistration/delete  **************************************/
+        case kFACEID_CmdFaceDreg:
+            PRINTF("&&& AT+FACEDREG=%s\r\n", record->value);
+            break;
+
+        case kFACEID_CmdFaceDel:
+            PRINTF("&&& AT+FACEDEL=%s\r\n", record->value);
+            break;
+
+        /**************************** remote registration  **************************************/
+        case kFACEID_CmdFaceRreg:
+            PRINTF("&&& AT+FACERREG=%s\r\n", record->value);
+            break;
+
+        default:
+            break;
     }
 
     return 0;
@@ -252,23 +335,22 @@ uint32_t faceid_task(uint8_t *buf, uint32_t *ret)
  */
 uint8_t APP_FACEID_Task(void)
 {
-    uint32_t ret = FACEIDIDLE, value;
-	DisableIRQ(FACEID_USART_IRQN);
+    uint32_t ret;
 
-    if (g_FACEIDCmdStatus == 1)
-    {
-        ret = faceid_task((uint8_t *)g_CommandBuf, &value);
-        memset(g_CommandBuf, 0x00, sizeof(g_CommandBuf));
-        g_FACEIDCmdStatus = 0;
-        EnableIRQ(FACEID_USART_IRQN);
-    }
-    else
+    if (!APP_FACEID_IsPending())
     {
     	//there is no message comes from FaceID module
-    	EnableIRQ(FACEID_USART_IRQN);
     	return FACEIDIDLE;
     }
 
+    ret               = faceid_task(&g_FACEIDQueue[g_FACEIDQueueTail]);
+    g_FACEIDQueueTail = (g_FACEIDQueueTail + 1) & (FACEID_QUEUE_LEN - 1);
+
+    if (g_FACEIDRxDropped != 0)
+    {
+        PRINTF("&&& %d lines from the face module lost\r\n", g_FACEIDRxDropped);
+        g_FACEIDRxDropped = 0;
+    }
 
     if (ret == FACEIDVALIDE)
     {
@@ -37,5 +37,7 @@ extern uint8_t APP_FACEID_Task(void);
 extern void APP_FACEID_Deinit(void);
 extern uint8_t APP_FACEID_GetDeviceStatus(void);
 extern status_t APP_FACEID_RequestPowerOff(void);
+extern bool APP_FACEID_IsPending(void);
+extern void APP_FACEID_SetRxWakeup(bool enable);
 
 #endif /* __APP_FACEID_H__ */
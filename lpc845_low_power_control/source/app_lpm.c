@@ -0,0 +1,247 @@
+/*
+ * Copyright 2022 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "fsl_debug_console.h"
+#include "fsl_common.h"
+#include "fsl_power.h"
+#include "fsl_usart.h"
+#include "fsl_wkt.h"
+#include "peripherals.h"
+#include "board.h"
+#include "app_lpm.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define APP_LPM_RETAIN_MAGIC 0x4C504DU /* "LPM", in the 3 bytes of DPDCTRL kept through deep power down */
+
+/* Count loaded when no timeout is pending, the time is added up at each alarm */
+#define APP_LPM_FREE_RUN_TICKS (3600U * APP_LPM_TICKS_PER_SECOND)
+
+/* Count loaded before deep power down. The count left at wake up gives the time spent there, when it runs out after
+ * about 5 days the timer wakes the board up */
+#define APP_LPM_DPD_TICKS 0xFFFFFFFFU
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+static const char *const s_LpmStateName[kAPP_LPM_StateCount] = {"run", "sleep", "deep sleep", "deep power down"};
+
+static const uint32_t s_LpmStateCurrent[kAPP_LPM_StateCount] = {
+    APP_LPM_CURRENT_RUN_UA,
+    APP_LPM_CURRENT_SLEEP_UA,
+    APP_LPM_CURRENT_DEEP_SLEEP_UA,
+    APP_LPM_CURRENT_DEEP_POWER_DOWN_UA,
+};
+
+/* Time since the start, in ticks: s_LpmClock when s_LpmLoaded was loaded in the timer, plus the ticks counted since */
+static uint64_t s_LpmClock    = 0;
+static uint32_t s_LpmLoaded   = 0;
+static uint64_t s_LpmDeadline = 0;
+static volatile app_lpm_timer_callback_t s_LpmCallback = NULL;
+
+static app_lpm_state_t s_LpmState = kAPP_LPM_Run;
+static uint64_t s_LpmStateSince  = 0;
+static uint64_t s_LpmStateTicks[kAPP_LPM_StateCount];
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+/* The functions below are called with the interrupts disabled */
+static uint64_t APP_LPM_Now(void)
+{
+    return s_LpmClock + (s_LpmLoaded - WKT_GetCounterValue(WKT));
+}
+
+static void APP_LPM_Load(void)
+{
+    uint64_t now   = APP_LPM_Now();
+    uint32_t count = APP_LPM_FREE_RUN_TICKS;
+
+    if (s_LpmCallback != NULL)
+    {
+        count = (s_LpmDeadline > now) ? (uint32_t)MIN(s_LpmDeadline - now, (uint64_t)count) : 1U;
+    }
+
+    s_LpmClock  = now;
+    s_LpmLoaded = count;
+    WKT_StartTimer(WKT, count);
+}
+
+static void APP_LPM_SetState(app_lpm_state_t state)
+{
+    uint64_t now = APP_LPM_Now();
+
+    s_LpmStateTicks[s_LpmState] += now - s_LpmStateSince;
+    s_LpmStateSince = now;
+    s_LpmState      = state;
+}
+
+void TIMER_WKT_IRQHANDLER(void)
+{
+    app_lpm_timer_callback_t callback = NULL;
+
+    WKT_ClearStatusFlags(WKT, kWKT_AlarmFlag);
+
+    if ((s_LpmCallback != NULL) && (APP_LPM_Now() >= s_LpmDeadline))
+    {
+        callback      = s_LpmCallback;
+        s_LpmCallback = NULL;
+    }
+    APP_LPM_Load();
+
+    if (callback != NULL)
+    {
+        callback();
+    }
+    SDK_ISR_EXIT_BARRIER;
+}
+
+bool APP_LPM_Init(void)
+{
+    bool timerWakeup = false;
+    uint32_t left;
+
+    CLOCK_EnableClock(kCLOCK_Wkt);
+
+    if ((POWER_GetDeepPowerDownModeFlag() != 0U) && (POWER_GetRetainData(kPmu_GenReg4) == APP_LPM_RETAIN_MAGIC))
+    {
+        left        = WKT_GetCounterValue(WKT);
+        timerWakeup = (left == 0U);
+
+        s_LpmStateTicks[kAPP_LPM_Run] = (uint64_t)POWER_GetRetainData(kPmu_GenReg0) * APP_LPM_TICKS_PER_SECOND / 1000U;
+        s_LpmStateTicks[kAPP_LPM_Sleep] =
+            (uint64_t)POWER_GetRetainData(kPmu_GenReg1) * APP_LPM_TICKS_PER_SECOND / 1000U;
+        s_LpmStateTicks[kAPP_LPM_DeepSleep] =
+            (uint64_t)POWER_GetRetainData(kPmu_GenReg2) * APP_LPM_TICKS_PER_SECOND / 1000U;
+        s_LpmStateTicks[kAPP_LPM_DeepPowerDown] =
+            (uint64_t)POWER_GetRetainData(kPmu_GenReg3) * APP_LPM_TICKS_PER_SECOND + (APP_LPM_DPD_TICKS - left);
+    }
+
+    POWER_ClrDeepPowerDownModeFlag();
+    POWER_SetRetainData(kPmu_GenReg4, 0U);
+
+    return timerWakeup;
+}
+
+void APP_LPM_Start(void)
+{
+    wkt_config_t config = {.clockSource = kWKT_LowPowerClockSource};
+    uint32_t primask;
+
+    POWER_EnableLPO(true);
+    POWER_EnableLPOInDeepPowerDownMode(true);
+    WKT_Init(WKT, &config);
+
+    primask     = DisableGlobalIRQ();
+    s_LpmClock  = 0;
+    s_LpmLoaded = 0;
+    APP_LPM_Load();
+    s_LpmStateSince = 0;
+    s_LpmState      = kAPP_LPM_Run;
+    EnableGlobalIRQ(primask);
+
+    /* the timer and the presence sensor wake the core from deep sleep */
+    EnableDeepSleepIRQ(TIMER_WKT_IRQN);
+    EnableDeepSleepIRQ(PINT_PINT_0_IRQN);
+}
+
+void APP_LPM_StartTimer(uint32_t ms, app_lpm_timer_callback_t callback)
+{
+    uint32_t primask = DisableGlobalIRQ();
+
+    s_LpmDeadline = APP_LPM_Now() + (uint64_t)ms * APP_LPM_TICKS_PER_SECOND / 1000U;
+    s_LpmCallback = callback;
+    APP_LPM_Load();
+
+    EnableGlobalIRQ(primask);
+}
+
+void APP_LPM_StopTimer(void)
+{
+    uint32_t primask = DisableGlobalIRQ();
+
+    s_LpmCallback = NULL;
+    APP_LPM_Load();
+
+    EnableGlobalIRQ(primask);
+}
+
+void APP_LPM_Idle(void)
+{
+#if APP_LPM_IDLE_DEEP_SLEEP
+    /* the uarts stop with the clock, let them send their last byte */
+    while (!(USART_GetStatusFlags((USART_Type *)BOARD_DEBUG_USART_BASEADDR) & kUSART_TxIdleFlag))
+    {
+    }
+    while (!(USART_GetStatusFlags(FACEID_PERIPHERAL) & kUSART_TxIdleFlag))
+    {
+    }
+
+    APP_LPM_SetState(kAPP_LPM_DeepSleep);
+    POWER_WakeUpConfig(kPDAWAKECFG_Wakeup_FRO_OUT | kPDAWAKECFG_Wakeup_FRO | kPDAWAKECFG_Wakeup_FLASH, false);
+    POWER_EnterDeepSleep(0U);
+#else
+    APP_LPM_SetState(kAPP_LPM_Sleep);
+    POWER_EnterSleep();
+#endif
+    APP_LPM_SetState(kAPP_LPM_Run);
+}
+
+void APP_LPM_EnterDeepPowerDown(void)
+{
+    (void)DisableGlobalIRQ();
+
+    APP_LPM_SetState(kAPP_LPM_DeepPowerDown);
+    POWER_SetRetainData(kPmu_GenReg0,
+                        (uint32_t)(s_LpmStateTicks[kAPP_LPM_Run] * 1000U / APP_LPM_TICKS_PER_SECOND));
+    POWER_SetRetainData(kPmu_GenReg1,
+                        (uint32_t)(s_LpmStateTicks[kAPP_LPM_Sleep] * 1000U / APP_LPM_TICKS_PER_SECOND));
+    POWER_SetRetainData(kPmu_GenReg2,
+                        (uint32_t)(s_LpmStateTicks[kAPP_LPM_DeepSleep] * 1000U / APP_LPM_TICKS_PER_SECOND));
+    POWER_SetRetainData(kPmu_GenReg3,
+                        (uint32_t)(s_LpmStateTicks[kAPP_LPM_DeepPowerDown] / APP_LPM_TICKS_PER_SECOND));
+    POWER_SetRetainData(kPmu_GenReg4, APP_LPM_RETAIN_MAGIC);
+
+    WKT_StartTimer(WKT, APP_LPM_DPD_TICKS);
+    POWER_EnterDeepPowerDownMode();
+}
+
+void APP_LPM_Report(void)
+{
+    uint64_t ticks[kAPP_LPM_StateCount];
+    uint64_t total  = 0;
+    uint64_t energy = 0; /* uA x ticks */
+    uint32_t primask;
+    uint32_t permille;
+
+    primask = DisableGlobalIRQ();
+    APP_LPM_SetState(s_LpmState);
+    memcpy(ticks, s_LpmStateTicks, sizeof(ticks));
+    EnableGlobalIRQ(primask);
+
+    for (uint32_t i = 0; i < kAPP_LPM_StateCount; i++)
+    {
+        total += ticks[i];
+        energy += ticks[i] * s_LpmStateCurrent[i];
+    }
+
+    PRINTF("@@@ Power states since power up\r\n");
+    for (uint32_t i = 0; i < kAPP_LPM_StateCount; i++)
+    {
+        permille = (total != 0U) ? (uint32_t)(ticks[i] * 1000U / total) : 0U;
+        PRINTF("@@@   %-16s %8u.%03u s %3u.%u%% %8u uAh\r\n", s_LpmStateName[i],
+               (uint32_t)(ticks[i] / APP_LPM_TICKS_PER_SECOND),
+               (uint32_t)(ticks[i] % APP_LPM_TICKS_PER_SECOND * 1000U / APP_LPM_TICKS_PER_SECOND), permille / 10U,
+               permille % 10U,
+               (uint32_t)(ticks[i] * s_LpmStateCurrent[i] / (APP_LPM_TICKS_PER_SECOND * 3600U)));
+    }
+    PRINTF("@@@   average current %u uA\r\n", (total != 0U) ? (uint32_t)(energy / total) : 0U);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2022 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef __APP_LPM_H__
+#define __APP_LPM_H__
+
+#include "fsl_common.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/* The self wake-up timer runs from the low power oscillator in every power state, deep power down included. It keeps
+ * the time, times the states and raises the timeouts of the application */
+#define APP_LPM_TICKS_PER_SECOND 10000U
+
+/* Idle in deep sleep between the commands of the face module, 0 to idle in sleep */
+#ifndef APP_LPM_IDLE_DEEP_SLEEP
+#define APP_LPM_IDLE_DEEP_SLEEP 1
+#endif /* APP_LPM_IDLE_DEEP_SLEEP */
+
+/* Current drawn by the LPC845 in each state, in uA, for the energy report. Rough figures at 3.3 V with the FRO at
+ * 18 MHz, replace them with the measurements of the board */
+#ifndef APP_LPM_CURRENT_RUN_UA
+#define APP_LPM_CURRENT_RUN_UA 1500U
+#endif /* APP_LPM_CURRENT_RUN_UA */
+
+#ifndef APP_LPM_CURRENT_SLEEP_UA
+#define APP_LPM_CURRENT_SLEEP_UA 900U
+#endif /* APP_LPM_CURRENT_SLEEP_UA */
+
+#ifndef APP_LPM_CURRENT_DEEP_SLEEP_UA
+#define APP_LPM_CURRENT_DEEP_SLEEP_UA 150U
+#endif /* APP_LPM_CURRENT_DEEP_SLEEP_UA */
+
+#ifndef APP_LPM_CURRENT_DEEP_POWER_DOWN_UA
+#define APP_LPM_CURRENT_DEEP_POWER_DOWN_UA 1U
+#endif /* APP_LPM_CURRENT_DEEP_POWER_DOWN_UA */
+
+typedef enum _app_lpm_state
+{
+    kAPP_LPM_Run = 0,
+    kAPP_LPM_Sleep,
+    kAPP_LPM_DeepSleep,
+    kAPP_LPM_DeepPowerDown,
+    kAPP_LPM_StateCount,
+} app_lpm_state_t;
+
+typedef void (*app_lpm_timer_callback_t)(void);
+
+/* Read the time spent in deep power down, before the peripherals are initialized since they reset the timer.
+ * Return true when the timer itself woke the board, to go back to deep power down */
+extern bool APP_LPM_Init(void);
+/* Start the time keeping, after the peripherals are initialized */
+extern void APP_LPM_Start(void);
+/* Call the callback from the timer interrupt once ms have elapsed, a running timeout is replaced */
+extern void APP_LPM_StartTimer(uint32_t ms, app_lpm_timer_callback_t callback);
+extern void APP_LPM_StopTimer(void);
+/* Sleep until an interrupt. Call it with the interrupts disabled after checking there is nothing to do, the interrupt
+ * which woke the core runs once they are enabled again */
+extern void APP_LPM_Idle(void);
+/* Save the time of each state and enter deep power down, the board wakes up through a reset */
+extern void APP_LPM_EnterDeepPowerDown(void);
+/* Print the time and the energy of each state since the first power up */
+extern void APP_LPM_Report(void);
+
+#endif /* __APP_LPM_H__ */
@@ -39,7 +39,7 @@
 #include "fsl_debug_console.h"
 #include "app_faceid.h"
 #include "fsl_power.h"
-#include "fsl_ctimer.h"
+#include "app_lpm.h"
 
 #define RT_POWER_ON_DELAY_MS       100
 #define RT_POWER_ON_DURATION_MS    30000
@@ -56,10 +56,6 @@ typedef enum
 } lpc_state_t;
 
 
-#define CTIMER          CTIMER0         /* Timer 0 */
-#define CTIMER_MAT0_OUT kCTIMER_Match_0 /* Match output 0 */
-#define CTIMER_CLK_FREQ CLOCK_GetFreq(kCLOCK_CoreSysClk)
-
 static volatile bool is_human_detected = false;
 static volatile bool is_wkt_alarmed    = false;
 static volatile lpc_state_t lpc_state  = LPC_STATE_POWER_ON;
@@ -74,62 +70,41 @@ void pint_interrupt_callback(pint_pin_int_t pintr, uint32_t pmatch_status)
 }
 
 
-/*******************************************************************************
- * Prototypes
- ******************************************************************************/
-void ctimer_match0_callback(uint32_t flags);
-
-
-/* Array of function pointers for callback for each channel */
-ctimer_callback_t ctimer_callback_table[] = {
-    ctimer_match0_callback, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
-
-
-void ctimer_match0_callback(uint32_t flags)
+static void wkt_alarm_callback(void)
 {
 
     is_wkt_alarmed = true;
 
 }
 
-void CTimer_init()
+void Timer_start(uint32_t ms)
 {
-	ctimer_config_t config;
-	//CTimer code
-	CTIMER_GetDefaultConfig(&config);
 
-	CTIMER_Init(CTIMER, &config);
-
-	CTIMER_RegisterCallBack(CTIMER, &ctimer_callback_table[0], kCTIMER_SingleCallback);
+	is_wkt_alarmed = false;
+	APP_LPM_StartTimer(ms, wkt_alarm_callback);
 
 }
 
-
-void CTimer_start(uint32_t ms)
+/* Sleep until an interrupt gives the state machine something to do */
+static void LPC_Idle(void)
 {
-
-	ctimer_match_config_t matchConfig0;
-	/* Configuration 0 */
-	matchConfig0.enableCounterReset = true;
-	matchConfig0.enableCounterStop  = true;
-	//default timeout is 1 second
-	matchConfig0.matchValue         = CTIMER_CLK_FREQ/1000 * ms;
-	matchConfig0.outControl         = kCTIMER_Output_NoAction;
-	matchConfig0.outPinInitState    = false;
-	matchConfig0.enableInterrupt    = true;
-
-	//reset the counter
-//	CTIMER_StopTimer(CTIMER);
-	CTIMER_Reset(CTIMER);
-	CTIMER_SetupMatch(CTIMER, CTIMER_MAT0_OUT, &matchConfig0);
-	CTIMER_StartTimer(CTIMER);
-
+    __disable_irq();
+    if (!is_wkt_alarmed && !is_human_detected && !APP_FACEID_IsPending())
+    {
+        APP_FACEID_SetRxWakeup(true);
+        APP_LPM_Idle();
+        APP_FACEID_SetRxWakeup(false);
+    }
+    __enable_irq();
 }
 
 
 
 int main(void)
 {
+    /* Read the time spent in deep power down before the peripherals reset the wake-up timer */
+    bool is_time_wakeup = APP_LPM_Init();
+
     /* Init board hardware. */
     BOARD_InitBootPins();
 
@@ -149,9 +124,13 @@ int main(void)
     PRINTF("~~~~~~~~~~~~~~~~~~~~~~~~\r\n");
     PRINTF("\r\n");
 
-    CTimer_init();
+    APP_LPM_Start();
 
-//    lpc_state_t lpc_state  = LPC_STATE_POWER_ON;
+    if (is_time_wakeup)
+    {
+        /* nobody is there, the timer ran out */
+        lpc_state = LPC_STATE_DEEP_POWER_DOWN;
+    }
 
     while (1)
     {
@@ -163,17 +142,18 @@ int main(void)
 
                 APP_FACEID_Init();
                 is_human_detected = false;
-                is_wkt_alarmed = false;
-                CTimer_start(RT_POWER_ON_DELAY_MS);
-                while(!is_wkt_alarmed);
+                Timer_start(RT_POWER_ON_DELAY_MS);
+                while (!is_wkt_alarmed)
+                {
+                    LPC_Idle();
+                }
                 lpc_state = LPC_STATE_NORMAL_WORK;
                 break;
             }
             case LPC_STATE_NORMAL_WORK:
             {
                     PRINTF("@@@ FACEID is ready after %d ms delay\r\n", RT_POWER_ON_DELAY_MS);
-                    is_wkt_alarmed = false;
-                    CTimer_start(RT_POWER_ON_DURATION_MS);
+                    Timer_start(RT_POWER_ON_DURATION_MS);
                     PRINTF("@@@ Start %d ms timer for face rec\r\n", RT_POWER_ON_DURATION_MS);
                     while (!is_wkt_alarmed)
                     {
@@ -182,10 +162,12 @@ int main(void)
                             break;
                         }else if (is_human_detected)
                         {
-                        	CTIMER_StopTimer(CTIMER);
-                        	is_wkt_alarmed = false;
                         	is_human_detected = false;
-                        	CTimer_start(RT_POWER_ON_DURATION_MS);
+                        	Timer_start(RT_POWER_ON_DURATION_MS);
+                        }
+                        else
+                        {
+                            LPC_Idle();
                         }
                     }
 
@@ -200,9 +182,7 @@ int main(void)
                 APP_FACEID_RequestPowerOff();
                 Board_DisableFaceIDUartTx();
 
-				is_wkt_alarmed = false;
-				CTIMER_StopTimer(CTIMER);
-				CTimer_start(RT_POWER_OFF_RSP_WAIT_MS);
+				Timer_start(RT_POWER_OFF_RSP_WAIT_MS);
 
 
             	do{
@@ -213,6 +193,10 @@ int main(void)
 						{
 							break;
 						}
+						else if (ret == FACEIDIDLE)
+						{
+							LPC_Idle();
+						}
 						else
 						{
 							//for other cases, do nothing
@@ -220,6 +204,7 @@ int main(void)
 
             	}while(!is_wkt_alarmed);
 
+           		APP_LPM_StopTimer();
            		lpc_state = LPC_STATE_DEEP_POWER_DOWN;
             	break;
 
@@ -238,11 +223,12 @@ int main(void)
                 }else
                 {
 
+					APP_LPM_Report();
 					PRINTF("LPC enters into deep down power mode.\r\n");
 					/* prepare to enter low power mode */
 					Board_PreEnterLowPower();
 					/* Enter deep power down mode. */
-					POWER_EnterDeepPowerDownMode();
+					APP_LPM_EnterDeepPowerDown();
 					/* Restore the active mode configurations */
 					Board_LowPowerWakeup();
                 }
@@ -20,6 +20,7 @@
 #include "comms_message_handler_fwupdate_server.h"
 #include "comms_message_handler_fwupdate_common.h"
 #include "flash_ica_driver.h"
+#include "flash_ica_stream.h"
 #include "sln_flash_mgmt.h"
 #if BOOTLOADER_AWS_IOT_OTA_ENABLED
 #include "sln_ota.h"
@@ -75,10 +76,11 @@ static sln_comms_message_status_t processFwUpdateStartSelfCheckReq(void *clientI
 {
     cJSON *jsonMessage, *jsonError;
 
-    sln_comms_message_status_t status = kComms_Success;
-    int32_t imgType                   = FICA_IMG_TYPE_NONE;
-    int32_t ficaStatus                = SLN_FLASH_NO_ERROR;
-    bool savedCert                    = false;
+    sln_comms_message_status_t status                 = kComms_Success;
+    int32_t imgType                                   = FICA_IMG_TYPE_NONE;
+    int32_t ficaStatus                                = SLN_FLASH_NO_ERROR;
+    bool savedCert                                    = false;
+    sln_comms_fwupdate_job_desc_t *currentFwUpdateJob = getCurrentFwUpdateJob();
 
     /* Accept the image since it was a good transfer
      * and networking and services are all working.
@@ -145,8 +147,17 @@ static sln_comms_message_status_t processFwUpdateStartSelfCheckReq(void *clientI
 
         if (SLN_FLASH_NO_ERROR == ficaStatus)
         {
-            /*  Verify Image Signature */
-            ficaStatus = FICA_Verify_Signature(imgType);
+            /*  Verify Image Signature, from the digest taken while streaming when the image came in order */
+            if ((NULL != currentFwUpdateJob) && (SLN_FLASH_NO_ERROR == FICA_Stream_GetDigest(NULL, NULL)))
+            {
+                ficaStatus = FICA_Stream_VerifySignature(imgType, (uint8_t *)currentFwUpdateJob->signature,
+                                                         COMMS_FWUPDATE_MAX_SIGNATURE_SIZE);
+            }
+            else
+            {
+                /* No streamed digest, e.g. chunks came out of order, read the image back from flash */
+                ficaStatus = FICA_Verify_Signature(imgType);
+            }
         }
 
         configPRINTF(("Signature verification status: %d.\r\n", ficaStatus));
@@ -247,18 +258,33 @@ static sln_comms_message_status_t processFwUpdateStopReq(void *clientInstance, c
     /* Ensure the size that was indicated matches the number of bytes written */
     if (currentFwUpdateJob->imageSize == currentFwUpdateJob->dataWritten)
     {
-        fica_status = FICA_Save_Signature((uint8_t *)currentFwUpdateJob->signature);
+        /* Wait for the queued pages to reach the flash */
+        fica_status = FICA_Stream_Finalize();
         if (SLN_FLASH_NO_ERROR != fica_status)
         {
-            configPRINTF(("FICA_Save_Signature failed, error %d.\r\n", fica_status));
+            configPRINTF(("FICA_Stream_Finalize failed, error %d.\r\n", fica_status));
             status = kComms_FailedProcessing;
         }
 
-        fica_status = FICA_app_program_ext_finalize();
-        if (SLN_FLASH_NO_ERROR != fica_status)
+        /* A partially programmed image must not be marked as complete */
+        if (SLN_FLASH_NO_ERROR == fica_status)
         {
-            configPRINTF(("FICA_app_program_ext_finalize failed, error %d.\r\n", fica_status));
-            status = kComms_FailedProcessing;
+            fica_status = FICA_Save_Signature((uint8_t *)currentFwUpdateJob->signature);
+            if (SLN_FLASH_NO_ERROR != fica_status)
+            {
+                configPRINTF(("FICA_Save_Signature failed, error %d.\r\n", fica_status));
+                status = kComms_FailedProcessing;
+            }
+        }
+
+        if (SLN_FLASH_NO_ERROR == fica_status)
+        {
+            fica_status = FICA_app_program_ext_finalize();
+            if (SLN_FLASH_NO_ERROR != fica_status)
+            {
+                configPRINTF(("FICA_app_program_ext_finalize failed, error %d.\r\n", fica_status));
+                status = kComms_FailedProcessing;
+            }
         }
     }
     else
@@ -489,11 +515,11 @@ static sln_comms_message_status_t processFwUpdateBlockReq(void *clientInstance,
 
     if (kComms_Success == status)
     {
-        /* Write the data to flash */
-        fica_status = FICA_app_program_ext_abs(blockReq.offset, (void *)blockReq.data, blockReq.blockSize);
+        /* Queue the data for programming, the flash is written while the next block is received */
+        fica_status = FICA_Stream_Write(blockReq.offset, (void *)blockReq.data, blockReq.blockSize);
         if (SLN_FLASH_NO_ERROR != fica_status)
         {
-            configPRINTF(("FICA_app_program_ext_abs failed, error %d.\r\n", fica_status));
+            configPRINTF(("FICA_Stream_Write failed, error %d.\r\n", fica_status));
             status = kComms_FailedProcessing;
         }
 
@@ -579,12 +605,12 @@ sln_comms_message_status_t handleServerFwUpdateStartReq(uint32_t img_type)
     sln_comms_message_status_t status = kComms_Success;
     int32_t fica_ret                  = SLN_FLASH_NO_ERROR;
 
-    /* Create an entry for the new image */
-    fica_ret = FICA_app_program_ext_init(img_type,1);
+    /* Create an entry for the new image, the bank is erased ahead of the incoming blocks */
+    fica_ret = FICA_Stream_Init(img_type);
 
     if (SLN_FLASH_NO_ERROR != fica_ret)
     {
-        configPRINTF(("FICA_app_program_ext_init failed, error %d.\r\n", fica_ret));
+        configPRINTF(("FICA_Stream_Init failed, error %d.\r\n", fica_ret));
         status = kComms_FailedProcessing;
     }
 
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2021 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+#include <string.h>
+
+#include "board.h"
+#include "fsl_debug_console.h"
+
+/* FreeRTOS kernel includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "flash_ica_driver.h"
+#include "sln_flash.h"
+
+#include "boot_record.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define DWT_LAR_UNLOCK (0xC5ACCE55)
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static boot_record_t *const s_bootRecord = (boot_record_t *)BOOT_RECORD_ADDR;
+
+static uint32_t s_lastCycles = 0;
+static uint32_t s_lastUs     = 0;
+static bool s_logDeferred    = false;
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+static uint32_t BOOT_Crc32(const void *data, uint32_t len)
+{
+    const uint8_t *pdata = (const uint8_t *)data;
+    uint32_t crc         = 0xFFFFFFFF;
+
+    while (len--)
+    {
+        crc ^= *pdata++;
+        for (uint32_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (BOOT_CRC32_POLY & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+static bool BOOT_Record_IsValid(void)
+{
+    return ((s_bootRecord->magic == BOOT_RECORD_MAGIC) && (s_bootRecord->version == BOOT_RECORD_VERSION) &&
+            (s_bootRecord->crc == BOOT_Crc32(s_bootRecord, offsetof(boot_record_t, crc))));
+}
+
+/* The core clock changes during the board init, accumulate the elapsed time at the current clock */
+static uint32_t BOOT_Record_NowUs(void)
+{
+    uint32_t cycles = DWT->CYCCNT;
+
+    s_lastUs += (cycles - s_lastCycles) / (SystemCoreClock / 1000000U);
+    s_lastCycles = cycles;
+
+    return s_lastUs;
+}
+
+void BOOT_Record_Init(void)
+{
+    uint32_t bootCount = 1;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR    = DWT_LAR_UNLOCK;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    s_lastCycles = 0;
+    s_lastUs     = 0;
+
+    /* The OCRAM content is random after a power on */
+    if (BOOT_Record_IsValid())
+    {
+        bootCount = s_bootRecord->bootCount + 1;
+    }
+
+    memset(s_bootRecord, 0, offsetof(boot_record_t, log) + 1);
+    s_bootRecord->magic     = BOOT_RECORD_MAGIC;
+    s_bootRecord->version   = BOOT_RECORD_VERSION;
+    s_bootRecord->bootCount = bootCount;
+    s_bootRecord->imgType   = FICA_IMG_TYPE_NONE;
+
+    s_logDeferred = BOOT_DEFERRED_LOGGING;
+
+    BOOT_Record_Mark(kBootStage_Main);
+}
+
+void BOOT_Record_Mark(boot_stage_t stage)
+{
+    if (stage < kBootStage_Count)
+    {
+        s_bootRecord->stageUs[stage] = BOOT_Record_NowUs();
+    }
+}
+
+void BOOT_Record_Finalize(boot_path_t path, int32_t imgType, uint32_t appAddr)
+{
+    s_bootRecord->path    = path;
+    s_bootRecord->imgType = imgType;
+    s_bootRecord->appAddr = appAddr;
+
+    BOOT_Record_Mark(kBootStage_Jump);
+    s_bootRecord->jumpCycles = DWT->CYCCNT;
+
+    s_bootRecord->crc = BOOT_Crc32(s_bootRecord, offsetof(boot_record_t, crc));
+}
+
+bool BOOT_Record_Log(const char *line, uint32_t len)
+{
+    if (!s_logDeferred)
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    if (s_bootRecord->logLength + len < BOOT_RECORD_LOG_SIZE)
+    {
+        memcpy(&s_bootRecord->log[s_bootRecord->logLength], line, len);
+        s_bootRecord->logLength += len;
+        s_bootRecord->log[s_bootRecord->logLength] = '\0';
+    }
+    else
+    {
+        s_bootRecord->logDropped += len;
+    }
+    taskEXIT_CRITICAL();
+
+    return true;
+}
+
+void BOOT_Record_LogResume(void)
+{
+    if (s_logDeferred)
+    {
+        s_logDeferred = false;
+
+        if (s_bootRecord->logLength)
+        {
+            DbgConsole_Printf("%s", s_bootRecord->log);
+        }
+    }
+}
+
+bool BOOT_Cache_Get(int32_t *imgType, uint32_t *appAddr)
+{
+    const boot_cache_t *cache = (const boot_cache_t *)SLN_Flash_Get_Read_Address(FICA_START_ADDR + BOOT_CACHE_OFFSET);
+    const fica_t *fica        = (const fica_t *)SLN_Flash_Get_Read_Address(FICA_START_ADDR);
+    uint32_t startAddr        = 0;
+
+    if ((imgType == NULL) || (appAddr == NULL))
+    {
+        return false;
+    }
+
+    if ((cache->magic != BOOT_CACHE_MAGIC) || (cache->crc != BOOT_Crc32(cache, offsetof(boot_cache_t, crc))))
+    {
+        return false;
+    }
+
+    /* The FICA changed since the decision was cached */
+    if (cache->ficaCrc != BOOT_Crc32(fica, sizeof(fica_t)))
+    {
+        return false;
+    }
+
+    if ((cache->imgType != FICA_IMG_TYPE_APP_A) && (cache->imgType != FICA_IMG_TYPE_APP_B))
+    {
+        return false;
+    }
+
+    if ((FICA_get_app_img_start_addr(cache->imgType, &startAddr) != SLN_FLASH_NO_ERROR) ||
+        (startAddr != cache->appAddr))
+    {
+        return false;
+    }
+
+    /* The application was reprogrammed without a FICA update */
+    if (*(const uint32_t *)SLN_Flash_Get_Read_Address(startAddr + 4) != cache->resetVector)
+    {
+        return false;
+    }
+
+    *imgType = cache->imgType;
+    *appAddr = cache->appAddr;
+
+    return true;
+}
+
+void BOOT_Cache_Set(int32_t imgType, uint32_t appAddr)
+{
+    const uint32_t *slot = (const uint32_t *)SLN_Flash_Get_Read_Address(FICA_START_ADDR + BOOT_CACHE_OFFSET);
+    boot_cache_t cache;
+
+    /* Only an erased slot can be programmed, it is erased together with the FICA */
+    for (uint32_t i = 0; i < sizeof(boot_cache_t) / sizeof(uint32_t); i++)
+    {
+        if (slot[i] != 0xFFFFFFFF)
+        {
+            configPRINTF(("[WARNING] Boot cache slot is not erased\r\n"));
+            return;
+        }
+    }
+
+    cache.magic       = BOOT_CACHE_MAGIC;
+    cache.ficaCrc     = BOOT_Crc32((const void *)SLN_Flash_Get_Read_Address(FICA_START_ADDR), sizeof(fica_t));
+    cache.imgType     = imgType;
+    cache.appAddr     = appAddr;
+    cache.resetVector = *(const uint32_t *)SLN_Flash_Get_Read_Address(appAddr + 4);
+    cache.crc         = BOOT_Crc32(&cache, offsetof(boot_cache_t, crc));
+
+    if (SLN_Write_Flash_Page(FICA_START_ADDR + BOOT_CACHE_OFFSET, (uint8_t *)&cache, sizeof(boot_cache_t)) !=
+        kStatus_Success)
+    {
+        configPRINTF(("[WARNING] Boot cache write failed\r\n"));
+    }
+}
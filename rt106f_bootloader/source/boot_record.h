@@ -0,0 +1,101 @@
+/*
+ * Copyright 2021 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/**
+ * @file boot_record.h
+ * @brief Boot record shared with the application and cached boot decision
+ */
+
+#ifndef _BOOT_RECORD_H_
+#define _BOOT_RECORD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "boot_record_layout.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/* Bootloader log lines are kept in the boot record and printed by the application instead of the UART */
+#ifndef BOOT_DEFERRED_LOGGING
+#define BOOT_DEFERRED_LOGGING 1
+#endif /* BOOT_DEFERRED_LOGGING */
+
+/* Boot decision cache, programmed in the erased part of the FICA sector.
+ * Any FICA update erases the sector, which also drops the cache. */
+#define BOOT_CACHE_OFFSET (0x800)
+#define BOOT_CACHE_MAGIC  (0x43544F42) /* "BOTC" */
+
+/*! @brief Cached boot decision */
+typedef struct _boot_cache
+{
+    uint32_t magic;
+    uint32_t ficaCrc;     /*!< CRC32 of the FICA the decision was made with */
+    int32_t imgType;      /*!< Application image type */
+    uint32_t appAddr;     /*!< Application image offset in flash */
+    uint32_t resetVector; /*!< Application reset vector at the time of the decision */
+    uint32_t crc;         /*!< CRC32 of the fields above */
+} boot_cache_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Start the boot timestamps and reset the boot record, call first in main.
+ */
+void BOOT_Record_Init(void);
+
+/**
+ * @brief Timestamp a boot stage.
+ */
+void BOOT_Record_Mark(boot_stage_t stage);
+
+/**
+ * @brief Store the boot decision and seal the record for the application.
+ */
+void BOOT_Record_Finalize(boot_path_t path, int32_t imgType, uint32_t appAddr);
+
+/**
+ * @brief Append a formatted log line to the boot record.
+ *
+ * @returns true if the line was deferred to the application, false if it must be printed now
+ */
+bool BOOT_Record_Log(const char *line, uint32_t len);
+
+/**
+ * @brief Stop deferring the log lines and print the ones deferred so far.
+ * Used when the bootloader stays in an update mode.
+ */
+void BOOT_Record_LogResume(void);
+
+/**
+ * @brief Get the cached boot decision if it matches the current FICA and application.
+ *
+ * @returns true if imgType and appAddr were taken from the cache
+ */
+bool BOOT_Cache_Get(int32_t *imgType, uint32_t *appAddr);
+
+/**
+ * @brief Cache a boot decision made from the FICA.
+ */
+void BOOT_Cache_Set(int32_t imgType, uint32_t appAddr);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* _BOOT_RECORD_H_ */
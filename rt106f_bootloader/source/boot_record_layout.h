@@ -0,0 +1,70 @@
+/*
+ * Copyright 2021 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/**
+ * @file boot_record_layout.h
+ * @brief Layout of the boot record the bootloader leaves to the application. The application project links this
+ * file from the bootloader sources, a layout change needs a new BOOT_RECORD_VERSION.
+ */
+
+#ifndef _BOOT_RECORD_LAYOUT_H_
+#define _BOOT_RECORD_LAYOUT_H_
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/* Last 4 KB of SRAM_OCRAM_NCACHED, removed from the memory map of both the bootloader and the application */
+#define BOOT_RECORD_ADDR     (0x2027F000)
+#define BOOT_RECORD_SIZE     (0x1000)
+#define BOOT_RECORD_MAGIC    (0x54425253) /* "SRBT" */
+#define BOOT_RECORD_VERSION  (1)
+#define BOOT_RECORD_LOG_SIZE (BOOT_RECORD_SIZE - 64)
+#define BOOT_CRC32_POLY      (0xEDB88320) /* reflected CRC32 of the record and of the FICA */
+
+/*! @brief Boot stages, timestamps are in us since the bootloader main entry */
+typedef enum _boot_stage
+{
+    kBootStage_Main = 0,     /*!< Bootloader main entry */
+    kBootStage_HardwareInit, /*!< Board, flash, LED and buttons initialized */
+    kBootStage_Scheduler,    /*!< Bootloader task running */
+    kBootStage_UpdateCheck,  /*!< Update check done */
+    kBootStage_Decision,     /*!< Application address resolved */
+    kBootStage_Jump,         /*!< Jumping to the application */
+    kBootStage_Count
+} boot_stage_t;
+
+/*! @brief How the application address was resolved */
+typedef enum _boot_path
+{
+    kBootPath_Ica = 0, /*!< FICA read and validated */
+    kBootPath_Cached,  /*!< Cached decision matching the FICA */
+    kBootPath_Fallback /*!< No valid application, bootloader restarted */
+} boot_path_t;
+
+/*! @brief Boot record in no-init RAM, read by the application */
+typedef struct _boot_record
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bootCount;                 /*!< Boots since the RAM content was lost */
+    uint32_t path;                      /*!< boot_path_t of this boot */
+    int32_t imgType;                    /*!< Application image type booted */
+    uint32_t appAddr;                   /*!< Application image offset in flash */
+    uint32_t stageUs[kBootStage_Count]; /*!< Time of each boot stage */
+    uint32_t jumpCycles;                /*!< DWT cycle count at the jump, to continue the breakdown in the app */
+    uint32_t crc;                       /*!< CRC32 of the fields above, the log is not covered */
+    uint32_t logLength;                 /*!< Bytes used in log */
+    uint32_t logDropped;                /*!< Bytes of log lines that did not fit */
+    char log[BOOT_RECORD_LOG_SIZE];     /*!< Deferred bootloader log lines, NUL terminated */
+} boot_record_t;
+
+#endif /* _BOOT_RECORD_LAYOUT_H_ */
@@ -18,6 +18,7 @@
 
 #include "flash_ica_driver.h"
 
+#include "boot_record.h"
 #include "bootloader.h"
 #include "sln_rgb_led_driver.h"
 #include "sln_push_buttons_driver.h"
@@ -131,7 +132,9 @@ static void JumpToAddr(uint32_t appaddr)
 {
     appaddr += FLEXSPI_AMBA_BASE;
 
+#if !BOOT_DEFERRED_LOGGING
     vTaskDelay(portTICK_PERIOD_MS * 10);
+#endif /* !BOOT_DEFERRED_LOGGING */
 
     // Point entry point address to entry point call function
     appEntry = (app_entry_t)(SET_THUMB_ADDRESS((*(uint32_t *)(appaddr + 4))));
@@ -159,52 +162,47 @@ static void jumpToMainAppTask(void)
 #ifdef DEBUG_BOOTLOADER
     the_should_never_get_here_catch();
 #endif
-    int32_t status    = SLN_FLASH_NO_ERROR;
-    int32_t imgtype   = FICA_IMG_TYPE_NONE;
-    uint32_t appaddr  = 0;
-    bool doCtxRestore = false;
-
-    // Get Current Application Vector
-    status = FICA_GetCurAppStartType(&imgtype);
-
-    if (SLN_FLASH_NO_ERROR == status)
-    {
-        status = FICA_get_app_img_start_addr(imgtype, &appaddr);
-    }
+    int32_t status   = SLN_FLASH_NO_ERROR;
+    int32_t imgtype  = FICA_IMG_TYPE_NONE;
+    uint32_t appaddr = 0;
+    boot_path_t path = kBootPath_Cached;
 
-    /* Get the appaddress one last time in case we are booting into a different image */
-    if (SLN_FLASH_NO_ERROR == status)
+    /* Skip the FICA initialization when the decision for this FICA is cached */
+    if (!BOOT_Cache_Get(&imgtype, &appaddr))
     {
-        int32_t tmpImageType = FICA_IMG_TYPE_NONE;
-        int32_t imgStatus    = SLN_FLASH_NO_ERROR;
+        path = kBootPath_Ica;
 
-        imgStatus = FICA_GetCurAppStartType(&tmpImageType);
+        // Get Current Application Vector
+        status = FICA_GetCurAppStartType(&imgtype);
 
-        /* Update the FICA with the new imgtype */
-        if ((tmpImageType != imgtype) && (SLN_FLASH_NO_ERROR == imgStatus))
+        if (SLN_FLASH_NO_ERROR == status)
         {
-            status = FICA_SetCurAppStartType(imgtype);
-            if (status != SLN_FLASH_NO_ERROR)
-            {
-                configPRINTF(("[WARNING] FICA_SetCurAppStartType failed\r\n"));
-            }
+            status = FICA_get_app_img_start_addr(imgtype, &appaddr);
         }
 
-        status = FICA_get_app_img_start_addr(imgtype, &appaddr);
+        if (SLN_FLASH_NO_ERROR == status)
+        {
+            BOOT_Cache_Set(imgtype, appaddr);
+        }
     }
 
     if (SLN_FLASH_NO_ERROR != status)
     {
         // Boot back into itself
         appaddr = SCB->VTOR - FLEXSPI_AMBA_BASE;
+        path    = kBootPath_Fallback;
     }
 
+    BOOT_Record_Mark(kBootStage_Decision);
+
     configPRINTF(("Launching into application at 0x%X...\r\n", appaddr));
 
 #if ENABLE_LOGGING
+#if !BOOT_DEFERRED_LOGGING
     vTaskDelay(portTICK_PERIOD_MS * 100);
 
     DbgConsole_Flush();
+#endif /* !BOOT_DEFERRED_LOGGING */
 
     /* main app does not start correctly without this. why? */
     DbgConsole_Deinit();
@@ -212,6 +210,8 @@ static void jumpToMainAppTask(void)
     NVIC_DisableIRQ(BOARD_UART_IRQ);
 #endif /* ENABLE_LOGGING */
 
+    BOOT_Record_Finalize(path, imgtype, appaddr);
+
     RGB_LED_SetColor(LED_COLOR_OFF);
 
     JumpToAddr(appaddr);
@@ -235,9 +235,11 @@ void ReRunBootloader()
     status = FICA_GetCurBootStartAddr(&appaddr);
 
 #if ENABLE_LOGGING
+#if !BOOT_DEFERRED_LOGGING
     vTaskDelay(portTICK_PERIOD_MS * 100);
 
     DbgConsole_Flush();
+#endif /* !BOOT_DEFERRED_LOGGING */
 
     DbgConsole_Deinit();
 
@@ -259,6 +261,8 @@ void BootloaderMain(void *args)
     volatile bool isWait = false; // Boolean to force entry into wait states
     status_t status      = kStatus_Success;
 
+    BOOT_Record_Mark(kBootStage_Scheduler);
+
     configPRINTF(("\r\n\r\n*** BOOTLOADER v%d.%d.%d ***\r\n\r\n", localAppFirmwareVersion.u.x.ucMajor,
                   localAppFirmwareVersion.u.x.ucMinor, localAppFirmwareVersion.u.x.usBuild));
 
@@ -285,11 +289,16 @@ void BootloaderMain(void *args)
     /* This function call will return true if an update operation is needed */
     if (SLN_CheckForUpdate())
     {
+        /* The update mode logs to the console */
+        BOOT_Record_LogResume();
+
         /* Suspend here, otherwise the main function will
          * launch the target application while the update task starts */
         vTaskSuspend(NULL);
     }
 
+    BOOT_Record_Mark(kBootStage_UpdateCheck);
+
     configPRINTF(("Jumping to main application...\r\n"));
 
     RGB_LED_SetBrightnessColor(LED_BRIGHT_MEDIUM, LED_COLOR_OFF);
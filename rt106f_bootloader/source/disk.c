@@ -35,6 +35,7 @@
 
 #include "pin_mux.h"
 #include "flash_ica_driver.h"
+#include "flash_ica_stream.h"
 
 #include "sln_rgb_led_driver.h"
 #include "sln_msc_vfs.h"
@@ -164,8 +165,7 @@ usb_status_t USB_DeviceMscCallback(class_handle_t handle, uint32_t event, void *
         case kUSB_DeviceMscEventWriteResponse:
             lbaData = (usb_device_lba_app_struct_t *)param;
 
-            /* Write MSC data */
-            // status_t MSC_VFS_WriteResponse(uint32_t offset, uint32_t size, uint8_t *buffer)
+            /* Queue MSC data, programmed by the staging task */
             error = MSC_VFS_WriteResponse(lbaData->offset, lbaData->size, lbaData->buffer);
             break;
         case kUSB_DeviceMscEventWriteRequest:
@@ -177,12 +177,12 @@ usb_status_t USB_DeviceMscCallback(class_handle_t handle, uint32_t event, void *
 #endif
 
             /*offset is the write start address get from write command, refer to class driver*/
-            lbaData->buffer = g_msc.storageDisk + (lbaData->offset % 0x20) * LENGTH_OF_EACH_LBA;
+            lbaData->buffer = MSC_VFS_WriteRequest(lbaData->offset, lbaData->size);
             break;
         case kUSB_DeviceMscEventReadRequest:
             lbaData = (usb_device_lba_app_struct_t *)param;
             /*offset is the read start address get from read command, refer to class driver*/
-            lbaData->buffer = g_msc.storageDisk + (lbaData->offset % 0x20) * LENGTH_OF_EACH_LBA;
+            lbaData->buffer = g_msc.storageDisk + (lbaData->offset % MSC_VFS_META_WINDOW_LBAS) * LENGTH_OF_EACH_LBA;
             break;
         case kUSB_DeviceMscEventGetLbaInformation:
 
@@ -193,7 +193,7 @@ usb_status_t USB_DeviceMscCallback(class_handle_t handle, uint32_t event, void *
             lbaInformationStructure->logicalUnitInformations[0].totalLbaNumberSupports =
                 TOTAL_LOGICAL_ADDRESS_BLOCKS_NORMAL;
             lbaInformationStructure->logicalUnitInformations[0].bulkInBufferSize  = DISK_LOGICAL_SIZE_NORMAL;
-            lbaInformationStructure->logicalUnitInformations[0].bulkOutBufferSize = DISK_LOGICAL_SIZE_NORMAL;
+            lbaInformationStructure->logicalUnitInformations[0].bulkOutBufferSize = MSC_VFS_STAGE_SLOT_SIZE;
 
             break;
         case kUSB_DeviceMscEventTestUnitReady:
@@ -384,7 +384,7 @@ void USB_DeviceApplicationInit()
     g_msc.mscHandle    = (class_handle_t)NULL;
     g_msc.deviceHandle = NULL;
 
-    MSC_VFS_Init(&s_StorageDisk[0], &g_msc.application_task_handle, LENGTH_OF_EACH_LBA);
+    MSC_VFS_Init(&s_StorageDisk[0], sizeof(s_StorageDisk), &g_msc.application_task_handle, LENGTH_OF_EACH_LBA);
 
     g_msc.storageDisk = &s_StorageDisk[0];
 
@@ -443,8 +443,14 @@ void USB_Transfer_Finalize(void)
     if (TRANSFER_FINAL == transferState)
     {
         configPRINTF(("Final!\r\n"));
+        // Wait for the queued pages to be programmed
+        status = FICA_Stream_Finalize();
+
         // Finalize the new application by storing app specific info into FICA
-        status = FICA_app_program_ext_finalize(NULL);
+        if (SLN_FLASH_NO_ERROR == status)
+        {
+            status = FICA_app_program_ext_finalize(NULL);
+        }
 
         // Make the new app active by setting the reset vector
         if (SLN_FLASH_NO_ERROR == status)
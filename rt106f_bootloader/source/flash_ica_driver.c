@@ -198,6 +198,19 @@ int32_t FICA_app_program_ext_abs(uint32_t offset, uint8_t *bufptr, uint32_t writ
     return (IMG_EXT_NO_ERROR);
 }
 
+int32_t FICA_app_program_ext_set_len(uint32_t len)
+{
+    if (len > s_newAppImgMaxSize)
+        return (SLN_FLASH_ERROR);
+
+    if (len > s_newAppCurrLen)
+    {
+        s_newAppCurrLen = len;
+    }
+
+    return (SLN_FLASH_NO_ERROR);
+}
+
 int32_t FICA_app_program_ext_finalize()
 {
     int32_t status = SLN_FLASH_NO_ERROR;
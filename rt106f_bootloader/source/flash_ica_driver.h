@@ -68,6 +68,13 @@ int32_t FICA_app_program_ext_init(int32_t newimgtype, uint8_t erase);
  */
 int32_t FICA_app_program_ext_abs(uint32_t offset, uint8_t *pbuf, uint32_t len);
 
+/*!
+ * @brief Record the length of the image programmed outside of FICA_app_program_ext_abs
+ * Used by the streaming programming path so finalize writes the right image length
+ *
+ */
+int32_t FICA_app_program_ext_set_len(uint32_t len);
+
 /*!
  * @brief Finalize the program by verifying the Signature and writing image info
  *
@@ -0,0 +1,625 @@
+/*
+ * Copyright 2021 NXP
+ * All rights reserved.
+ *
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "fica_definition.h"
+#include "flash_ica_driver.h"
+#include "flash_ica_stream.h"
+#include "board.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+// Flash includes
+#include "sln_flash.h"
+#include "sln_flash_mgmt.h"
+#include "fsl_dcp.h"
+
+#include "mbedtls/pk.h"
+#include "mbedtls/x509_crt.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ * FICA Stream - pipelined image programming
+ *
+ * The receiver (USB MSD or OTW comms task) copies the incoming chunk into a ring of page buffers
+ * and returns immediately. A dedicated task erases the bank lazily, one 64 KB block ahead of the data
+ * where alignment allows, and programs the queued pages while the next chunk is being received.
+ * A chunk written over data already programmed goes through a read, erase and rewrite of its sectors.
+ * The image digest is updated with each in order chunk, so the signature check needs no second pass over flash.
+ */
+
+#ifndef APP_A_SIGNING_CERT
+#define APP_A_SIGNING_CERT "app_a_sign_cert.dat"
+#endif /* APP_A_SIGNING_CERT */
+
+#ifndef APP_B_SIGNING_CERT
+#define APP_B_SIGNING_CERT "app_b_sign_cert.dat"
+#endif /* APP_B_SIGNING_CERT */
+
+typedef struct _fica_stream_page
+{
+    uint32_t addr; /* Flash offset of the page, page aligned */
+    uint8_t data[EXT_FLASH_PROGRAM_PAGE];
+} fica_stream_page_t;
+
+typedef struct _fica_stream
+{
+    uint32_t bankStart;  /* Flash offset of the bank being programmed */
+    uint32_t bankSize;   /* Size of the bank being programmed */
+    uint32_t erasedEnd;  /* Bank offset up to which the flash has been erased */
+    uint32_t nextOffset; /* Bank offset expected by the next sequential write, end of the data written so far */
+    int32_t fillSlot;    /* Ring slot currently being assembled, -1 if none */
+    uint32_t nextSlot;   /* Next ring slot to hand to the receiver */
+    volatile int32_t status;
+    bool digestValid; /* The digest covers the whole image, false once a chunk came out of order */
+    bool digestDone;
+    uint32_t crc32;
+    uint8_t sha256[FICA_STREAM_SHA256_SIZE];
+    TickType_t startTick;
+} fica_stream_t;
+
+typedef struct _fica_stream_stats
+{
+    uint32_t sectorErases;      /* Number of 4 KB sector erases issued */
+    uint32_t blockErases;       /* Number of 64 KB block erases issued */
+    uint32_t pagePrograms;      /* Number of page programs issued from the ring */
+    uint32_t rmwWrites;         /* Out of order writes that fell back to read-modify-write */
+    uint32_t rewrites;          /* Sectors erased again to take data written over programmed flash */
+    uint32_t ringFullWaits;     /* Times the receiver had to wait for a free page buffer */
+    uint32_t bytesWritten;      /* Image bytes accepted */
+    uint32_t modelBusyMs;       /* Modeled flash busy time of the streamed update */
+    uint32_t modelLegacyBusyMs; /* Modeled flash busy time of bank erase + page program */
+    uint32_t elapsedMs;         /* Wall time from init to finalize */
+} fica_stream_stats_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+static void FICA_Stream_Task(void *arg);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static fica_stream_page_t s_streamRing[FICA_STREAM_RING_PAGES];
+static fica_stream_t s_stream;
+static fica_stream_stats_t s_streamStats;
+
+/* Sector being rewritten by an out of order write over programmed flash */
+static uint8_t s_streamSector[EXT_FLASH_ERASE_PAGE];
+
+static TaskHandle_t s_streamTaskHandle     = NULL;
+static QueueHandle_t s_streamReadyQueue    = NULL;
+static SemaphoreHandle_t s_streamFreeSlots = NULL;
+
+/* DCP hash context must not be cached, the DCP reads and writes it directly */
+AT_NONCACHEABLE_SECTION_ALIGN(static dcp_hash_ctx_t s_streamHashCtx, 4);
+static dcp_handle_t s_streamHashHandle = {
+    .channel = kDCP_Channel1, .keySlot = kDCP_KeySlot0, .swapConfig = kDCP_NoSwap};
+
+/* Signing certificate of the new image, NUL terminated for the PEM parser */
+static uint8_t s_streamCert[FICA_STREAM_CERT_MAX_SIZE];
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+#if FICA_STREAM_DIGEST_CRC32
+static uint32_t FICA_Stream_Crc32(uint32_t crc, const uint8_t *pbuf, uint32_t len)
+{
+    crc = ~crc;
+
+    while (len--)
+    {
+        crc ^= *pbuf++;
+
+        for (uint32_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+#endif /* FICA_STREAM_DIGEST_CRC32 */
+
+static uint32_t FICA_Stream_ModelEraseMs(uint32_t startaddr, uint32_t endaddr)
+{
+    uint32_t busyUs = 0;
+
+    for (uint32_t runaddr = startaddr; runaddr < endaddr;)
+    {
+#if defined(ERASE_BLOCK_SUPPORT)
+        if (!(runaddr & (EXT_FLASH_ERASE_BLOCK - 1)) && ((runaddr + EXT_FLASH_ERASE_BLOCK) <= endaddr))
+        {
+            busyUs += FICA_TIMING_BLOCK_ERASE_US;
+            runaddr += EXT_FLASH_ERASE_BLOCK;
+            continue;
+        }
+#endif /* ERASE_BLOCK_SUPPORT */
+        busyUs += FICA_TIMING_SECTOR_ERASE_US;
+        runaddr += EXT_FLASH_ERASE_PAGE;
+    }
+
+    return busyUs / 1000;
+}
+
+static int32_t FICA_Stream_EraseAhead(uint32_t endoffset)
+{
+    uint32_t runaddr;
+
+    if (endoffset > s_stream.bankSize)
+        return (SLN_FLASH_ERROR);
+
+    // Only erase what has not been erased yet, the erased area only grows
+    while (s_stream.erasedEnd < endoffset)
+    {
+        runaddr = s_stream.bankStart + s_stream.erasedEnd;
+
+#if defined(ERASE_BLOCK_SUPPORT)
+        // Erase a whole block ahead of the data when aligned, it is much faster than 16 sectors
+        if (!(runaddr & (EXT_FLASH_ERASE_BLOCK - 1)) &&
+            ((s_stream.erasedEnd + EXT_FLASH_ERASE_BLOCK) <= s_stream.bankSize))
+        {
+            if (SLN_Erase_Block(runaddr) != kStatus_Success)
+                return (SLN_FLASH_ERROR);
+
+            s_stream.erasedEnd += EXT_FLASH_ERASE_BLOCK;
+            s_streamStats.blockErases++;
+            s_streamStats.modelBusyMs += FICA_TIMING_BLOCK_ERASE_US / 1000;
+            continue;
+        }
+#endif /* ERASE_BLOCK_SUPPORT */
+
+        if (SLN_Erase_Sector(runaddr) != kStatus_Success)
+            return (SLN_FLASH_ERROR);
+
+        s_stream.erasedEnd += EXT_FLASH_ERASE_PAGE;
+        s_streamStats.sectorErases++;
+        s_streamStats.modelBusyMs += FICA_TIMING_SECTOR_ERASE_US / 1000;
+    }
+
+    return (SLN_FLASH_NO_ERROR);
+}
+
+/*
+ * Write a chunk over an area that may already hold data, e.g. a chunk sent again or one filling a gap left
+ * by a previous out of order write. The flash can only be programmed from the erased state, so the sectors
+ * whose target bytes are not erased anymore are read back, merged with the chunk, erased and programmed again.
+ */
+static int32_t FICA_Stream_Rewrite(uint32_t offset, uint8_t *pbuf, uint32_t len)
+{
+    uint32_t sectoroff;
+    uint32_t secstart;
+    uint32_t copylen;
+    bool erased;
+
+    while (len)
+    {
+        secstart  = offset - (offset % EXT_FLASH_ERASE_PAGE);
+        sectoroff = offset - secstart;
+        copylen   = (len < (EXT_FLASH_ERASE_PAGE - sectoroff)) ? len : (EXT_FLASH_ERASE_PAGE - sectoroff);
+
+        if (SLN_Read_Flash_At_Address(s_stream.bankStart + secstart, s_streamSector, EXT_FLASH_ERASE_PAGE) !=
+            SLN_FLASH_NO_ERROR)
+            return (SLN_FLASH_ERROR);
+
+        erased = true;
+        for (uint32_t i = sectoroff; erased && (i < sectoroff + copylen); i++)
+        {
+            erased = (0xFF == s_streamSector[i]);
+        }
+
+        if (erased)
+        {
+            // Nothing programmed there yet, program the chunk in place
+            if (FICA_app_program_ext_abs(offset, pbuf, copylen) != SLN_FLASH_NO_ERROR)
+                return (SLN_FLASH_ERROR);
+        }
+        else
+        {
+            memcpy(&s_streamSector[sectoroff], pbuf, copylen);
+
+            if (SLN_Erase_Sector(s_stream.bankStart + secstart) != kStatus_Success)
+                return (SLN_FLASH_ERROR);
+
+            s_streamStats.sectorErases++;
+            s_streamStats.rewrites++;
+            s_streamStats.modelBusyMs += FICA_TIMING_SECTOR_ERASE_US / 1000;
+
+            for (uint32_t pageoff = 0; pageoff < EXT_FLASH_ERASE_PAGE; pageoff += EXT_FLASH_PROGRAM_PAGE)
+            {
+                if (SLN_Write_Flash_At_Address(s_stream.bankStart + secstart + pageoff, &s_streamSector[pageoff]) !=
+                    kStatus_Success)
+                    return (SLN_FLASH_ERROR);
+            }
+            s_streamStats.modelBusyMs +=
+                (EXT_FLASH_ERASE_PAGE / EXT_FLASH_PROGRAM_PAGE) * FICA_TIMING_PAGE_PROGRAM_US / 1000;
+        }
+
+        offset += copylen;
+        pbuf += copylen;
+        len -= copylen;
+    }
+
+    return (SLN_FLASH_NO_ERROR);
+}
+
+static void FICA_Stream_Task(void *arg)
+{
+    uint32_t slot;
+    fica_stream_page_t *page;
+
+    while (1)
+    {
+        if (xQueueReceive(s_streamReadyQueue, &slot, portMAX_DELAY) != pdTRUE)
+            continue;
+
+        page = &s_streamRing[slot];
+
+        // Skip the remaining pages once an error was hit, just release the buffers
+        if (SLN_FLASH_NO_ERROR == s_stream.status)
+        {
+            s_stream.status = FICA_Stream_EraseAhead(page->addr + EXT_FLASH_PROGRAM_PAGE);
+        }
+
+        if (SLN_FLASH_NO_ERROR == s_stream.status)
+        {
+            if (SLN_Write_Flash_At_Address(s_stream.bankStart + page->addr, page->data) != kStatus_Success)
+            {
+                configPRINTF(("[FICA] Stream program failed at 0x%X\r\n", s_stream.bankStart + page->addr));
+                s_stream.status = SLN_FLASH_ERROR;
+            }
+            else
+            {
+                s_streamStats.pagePrograms++;
+            }
+        }
+
+        xSemaphoreGive(s_streamFreeSlots);
+    }
+}
+
+static int32_t FICA_Stream_SubmitFillSlot(void)
+{
+    uint32_t slot;
+
+    if (s_stream.fillSlot < 0)
+        return (SLN_FLASH_NO_ERROR);
+
+    slot              = (uint32_t)s_stream.fillSlot;
+    s_stream.fillSlot = -1;
+
+    if (xQueueSend(s_streamReadyQueue, &slot, portMAX_DELAY) != pdTRUE)
+        return (SLN_FLASH_ERROR);
+
+    return (SLN_FLASH_NO_ERROR);
+}
+
+int32_t FICA_Stream_Init(int32_t newimgtype)
+{
+    int32_t status = SLN_FLASH_NO_ERROR;
+
+    if (NULL == s_streamTaskHandle)
+    {
+        s_streamReadyQueue = xQueueCreate(FICA_STREAM_RING_PAGES, sizeof(uint32_t));
+        s_streamFreeSlots  = xSemaphoreCreateCounting(FICA_STREAM_RING_PAGES, FICA_STREAM_RING_PAGES);
+
+        if ((NULL == s_streamReadyQueue) || (NULL == s_streamFreeSlots) ||
+            (xTaskCreate(FICA_Stream_Task, "FICA_Stream_Task", FICA_STREAM_TASK_STACK, NULL,
+                         FICA_STREAM_TASK_PRIORITY, &s_streamTaskHandle) != pdPASS))
+        {
+            configPRINTF(("[FICA] Unable to create the stream programming task\r\n"));
+            return (SLN_FLASH_ERROR);
+        }
+    }
+    else
+    {
+        // A previous transfer may still have pages in flight
+        FICA_Stream_Flush();
+    }
+
+    memset(&s_stream, 0, sizeof(s_stream));
+    memset(&s_streamStats, 0, sizeof(s_streamStats));
+    s_stream.fillSlot    = -1;
+    s_stream.digestValid = true;
+    s_stream.startTick   = xTaskGetTickCount();
+
+    // Prepare the FICA for the new image, the bank is erased lazily while programming
+    status = FICA_app_program_ext_init(newimgtype, 0);
+
+    if (SLN_FLASH_NO_ERROR == status)
+    {
+        status = FICA_GetNewAppStartAddr(&s_stream.bankStart);
+    }
+
+    if (SLN_FLASH_NO_ERROR == status)
+    {
+        status = FICA_get_app_img_max_size(newimgtype, &s_stream.bankSize);
+    }
+
+    if (SLN_FLASH_NO_ERROR == status)
+    {
+        // Enable the DCP if nobody did it yet, it is used for the image digest
+        if (DCP->CTRL & DCP_CTRL_CLKGATE_MASK)
+        {
+            dcp_config_t dcpConfig;
+
+            DCP_GetDefaultConfig(&dcpConfig);
+            DCP_Init(DCP, &dcpConfig);
+        }
+
+        if (DCP_HASH_Init(DCP, &s_streamHashHandle, &s_streamHashCtx, kDCP_Sha256) != kStatus_Success)
+        {
+            s_stream.digestValid = false;
+        }
+    }
+
+    s_stream.status = status;
+
+    return status;
+}
+
+int32_t FICA_Stream_Write(uint32_t offset, uint8_t *pbuf, uint32_t len)
+{
+    int32_t status = SLN_FLASH_NO_ERROR;
+    fica_stream_page_t *page;
+    uint32_t pageoff;
+    uint32_t copylen;
+
+    if ((NULL == pbuf) || (0 == len) || ((offset + len) > s_stream.bankSize))
+        return (SLN_FLASH_ERROR);
+
+    if (SLN_FLASH_NO_ERROR != s_stream.status)
+        return (s_stream.status);
+
+    if (offset != s_stream.nextOffset)
+    {
+        // Out of order chunk, program it in place once the ring drained and the area is erased
+        s_stream.digestValid = false;
+        s_streamStats.rmwWrites++;
+
+        status = FICA_Stream_Flush();
+
+        if (SLN_FLASH_NO_ERROR == status)
+        {
+            status = FICA_Stream_EraseAhead(offset + len);
+        }
+
+        if (SLN_FLASH_NO_ERROR == status)
+        {
+            if (offset < s_stream.nextOffset)
+            {
+                // Going backwards, the area may hold data written earlier
+                status = FICA_Stream_Rewrite(offset, pbuf, len);
+            }
+            else
+            {
+                status = FICA_app_program_ext_abs(offset, pbuf, len);
+            }
+        }
+
+        if (SLN_FLASH_NO_ERROR == status)
+        {
+            // The ring only takes data past everything written so far, the flash there is still erased
+            if ((offset + len) > s_stream.nextOffset)
+            {
+                s_stream.nextOffset = offset + len;
+            }
+            s_streamStats.bytesWritten += len;
+            status = FICA_app_program_ext_set_len(s_stream.nextOffset);
+        }
+
+        return status;
+    }
+
+    if (s_stream.digestValid)
+    {
+        if (DCP_HASH_Update(DCP, &s_streamHashCtx, pbuf, len) != kStatus_Success)
+        {
+            s_stream.digestValid = false;
+        }
+#if FICA_STREAM_DIGEST_CRC32
+        s_stream.crc32 = FICA_Stream_Crc32(s_stream.crc32, pbuf, len);
+#endif /* FICA_STREAM_DIGEST_CRC32 */
+    }
+
+    while (len && (SLN_FLASH_NO_ERROR == status))
+    {
+        if (s_stream.fillSlot < 0)
+        {
+            // Wait for the programming task to release a page buffer
+            if (xSemaphoreTake(s_streamFreeSlots, 0) != pdTRUE)
+            {
+                s_streamStats.ringFullWaits++;
+                xSemaphoreTake(s_streamFreeSlots, portMAX_DELAY);
+            }
+
+            s_stream.fillSlot = s_stream.nextSlot;
+            s_stream.nextSlot = (s_stream.nextSlot + 1) % FICA_STREAM_RING_PAGES;
+
+            // Bytes not covered by this write stay 0xFF, which leaves the flash content untouched
+            page       = &s_streamRing[s_stream.fillSlot];
+            page->addr = offset - (offset % EXT_FLASH_PROGRAM_PAGE);
+            memset(page->data, 0xFF, EXT_FLASH_PROGRAM_PAGE);
+        }
+
+        page    = &s_streamRing[s_stream.fillSlot];
+        pageoff = offset - page->addr;
+        copylen = (len < (EXT_FLASH_PROGRAM_PAGE - pageoff)) ? len : (EXT_FLASH_PROGRAM_PAGE - pageoff);
+
+        memcpy(&page->data[pageoff], pbuf, copylen);
+
+        offset += copylen;
+        pbuf += copylen;
+        len -= copylen;
+
+        if ((pageoff + copylen) == EXT_FLASH_PROGRAM_PAGE)
+        {
+            status = FICA_Stream_SubmitFillSlot();
+        }
+    }
+
+    if (SLN_FLASH_NO_ERROR == status)
+    {
+        s_streamStats.bytesWritten += offset - s_stream.nextOffset;
+        s_stream.nextOffset = offset;
+        status              = FICA_app_program_ext_set_len(offset);
+    }
+
+    return status;
+}
+
+int32_t FICA_Stream_Flush(void)
+{
+    int32_t status = FICA_Stream_SubmitFillSlot();
+
+    if (NULL == s_streamFreeSlots)
+        return (SLN_FLASH_ERROR);
+
+    // All the slots are free once the programming task went through the queue
+    for (uint32_t slot = 0; slot < FICA_STREAM_RING_PAGES; slot++)
+    {
+        xSemaphoreTake(s_streamFreeSlots, portMAX_DELAY);
+    }
+
+    for (uint32_t slot = 0; slot < FICA_STREAM_RING_PAGES; slot++)
+    {
+        xSemaphoreGive(s_streamFreeSlots);
+    }
+
+    if (SLN_FLASH_NO_ERROR == status)
+    {
+        status = s_stream.status;
+    }
+
+    return status;
+}
+
+int32_t FICA_Stream_Finalize(void)
+{
+    int32_t status = FICA_Stream_Flush();
+    uint32_t pages = (s_stream.nextOffset + EXT_FLASH_PROGRAM_PAGE - 1) / EXT_FLASH_PROGRAM_PAGE;
+
+    if (s_stream.digestValid && !s_stream.digestDone)
+    {
+        size_t shaSize = sizeof(s_stream.sha256);
+
+        if (DCP_HASH_Finish(DCP, &s_streamHashCtx, s_stream.sha256, &shaSize) != kStatus_Success)
+        {
+            s_stream.digestValid = false;
+        }
+    }
+    s_stream.digestDone = true;
+
+    // A digest of an image that did not reach the flash cannot vouch for it
+    if (SLN_FLASH_NO_ERROR != status)
+    {
+        s_stream.digestValid = false;
+    }
+
+    s_streamStats.modelBusyMs += (s_streamStats.pagePrograms * FICA_TIMING_PAGE_PROGRAM_US) / 1000;
+    s_streamStats.modelLegacyBusyMs =
+        FICA_Stream_ModelEraseMs(s_stream.bankStart, s_stream.bankStart + s_stream.bankSize) +
+        (pages * FICA_TIMING_PAGE_PROGRAM_US) / 1000;
+    s_streamStats.elapsedMs = (xTaskGetTickCount() - s_stream.startTick) * portTICK_PERIOD_MS;
+
+    configPRINTF(("[FICA] Stream: %d bytes, %d blocks, %d sectors, %d pages, %d rmw (%d rewritten), %d waits in "
+                  "%d ms\r\n",
+                  s_streamStats.bytesWritten, s_streamStats.blockErases, s_streamStats.sectorErases,
+                  s_streamStats.pagePrograms, s_streamStats.rmwWrites, s_streamStats.rewrites,
+                  s_streamStats.ringFullWaits, s_streamStats.elapsedMs));
+    configPRINTF(("[FICA] Stream: modeled flash busy %d ms, legacy bank erase path %d ms\r\n",
+                  s_streamStats.modelBusyMs, s_streamStats.modelLegacyBusyMs));
+
+    return status;
+}
+
+int32_t FICA_Stream_GetDigest(uint8_t *sha256, uint32_t *crc32)
+{
+    if (!s_stream.digestDone || !s_stream.digestValid)
+        return (SLN_FLASH_ERROR);
+
+    if (NULL != sha256)
+    {
+        memcpy(sha256, s_stream.sha256, FICA_STREAM_SHA256_SIZE);
+    }
+
+    if (NULL != crc32)
+    {
+        *crc32 = s_stream.crc32;
+    }
+
+    return (SLN_FLASH_NO_ERROR);
+}
+
+int32_t FICA_Stream_VerifyDigest(const uint8_t *sha256)
+{
+    if ((NULL == sha256) || !s_stream.digestDone || !s_stream.digestValid)
+        return (SLN_FLASH_ERROR);
+
+    if (memcmp(sha256, s_stream.sha256, FICA_STREAM_SHA256_SIZE) != 0)
+        return (SLN_FLASH_ERROR);
+
+    return (SLN_FLASH_NO_ERROR);
+}
+
+int32_t FICA_Stream_VerifySignature(int32_t imgtype, const uint8_t *signature, uint32_t siglen)
+{
+    int32_t status   = SLN_FLASH_NO_ERROR;
+    uint32_t certLen = FICA_STREAM_CERT_MAX_SIZE - 1;
+    mbedtls_x509_crt cert;
+
+    if ((NULL == signature) || !s_stream.digestDone || !s_stream.digestValid)
+        return (SLN_FLASH_ERROR);
+
+    if ((FICA_IMG_TYPE_APP_A != imgtype) && (FICA_IMG_TYPE_APP_B != imgtype))
+        return (SLN_FLASH_ERROR);
+
+    // The signing certificate was verified and saved by FICA_Verify_Certificate and FICA_Save_Certificate
+    memset(s_streamCert, 0, sizeof(s_streamCert));
+    if (SLN_FLASH_MGMT_Read((FICA_IMG_TYPE_APP_A == imgtype) ? APP_A_SIGNING_CERT : APP_B_SIGNING_CERT,
+                            s_streamCert, &certLen) != SLN_FLASH_MGMT_OK)
+        return (SLN_FLASH_ERROR);
+
+    mbedtls_x509_crt_init(&cert);
+
+    // The PEM parser wants the terminating NUL counted in the length
+    if (mbedtls_x509_crt_parse(&cert, s_streamCert, strlen((char *)s_streamCert) + 1) != 0)
+    {
+        status = SLN_FLASH_ERROR;
+    }
+
+    if (SLN_FLASH_NO_ERROR == status)
+    {
+        // The signature buffer may be padded past the key size
+        if (siglen > mbedtls_pk_get_len(&cert.pk))
+        {
+            siglen = mbedtls_pk_get_len(&cert.pk);
+        }
+
+        // The image is signed over its SHA-256, which is the digest taken while it was streamed to flash
+        if (mbedtls_pk_verify(&cert.pk, MBEDTLS_MD_SHA256, s_stream.sha256, FICA_STREAM_SHA256_SIZE, signature,
+                              siglen) != 0)
+        {
+            status = SLN_FLASH_ERROR;
+        }
+    }
+
+    mbedtls_x509_crt_free(&cert);
+
+    return status;
+}
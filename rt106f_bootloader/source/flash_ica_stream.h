@@ -0,0 +1,118 @@
+/*
+ * Copyright 2021 NXP
+ * All rights reserved.
+ *
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _FICA_STREAM_H_
+#define _FICA_STREAM_H_
+
+/*!
+ * @addtogroup flash_ica
+ * @{
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "flash_ica_driver.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/* Number of flash pages that can be queued for programming while the next chunk is received */
+#ifndef FICA_STREAM_RING_PAGES
+#define FICA_STREAM_RING_PAGES 16
+#endif /* FICA_STREAM_RING_PAGES */
+
+/* Priority of the page programming task, must be above the receiving (USB/comms) tasks */
+#ifndef FICA_STREAM_TASK_PRIORITY
+#define FICA_STREAM_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#endif /* FICA_STREAM_TASK_PRIORITY */
+
+#define FICA_STREAM_TASK_STACK 512
+
+/* Comment out to skip the CRC32 computed alongside the SHA-256 image digest */
+#define FICA_STREAM_DIGEST_CRC32 1
+
+#define FICA_STREAM_SHA256_SIZE 32
+
+/* Room for the PEM signing certificate read back to check the image signature */
+#ifndef FICA_STREAM_CERT_MAX_SIZE
+#define FICA_STREAM_CERT_MAX_SIZE 2048
+#endif /* FICA_STREAM_CERT_MAX_SIZE */
+
+/*
+ * Flash timing model (typical W25Q256JV datasheet values).
+ * Used to estimate flash busy time of the streamed update versus the legacy full bank erase.
+ */
+#define FICA_TIMING_SECTOR_ERASE_US 45000
+#define FICA_TIMING_BLOCK_ERASE_US  150000
+#define FICA_TIMING_PAGE_PROGRAM_US 400
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*!
+ * @brief Start a streamed image program for the given image type
+ * The bank is not erased up front, 64 KB blocks are erased lazily ahead of the data.
+ *
+ */
+int32_t FICA_Stream_Init(int32_t newimgtype);
+
+/*!
+ * @brief Queue image data for programming
+ * Sequential writes are assembled into pages and programmed in the background.
+ * Out of order writes flush the ring and fall back to FICA_app_program_ext_abs, the sectors written
+ * a second time are read back, erased and programmed again.
+ *
+ */
+int32_t FICA_Stream_Write(uint32_t offset, uint8_t *pbuf, uint32_t len);
+
+/*!
+ * @brief Wait for all queued pages to be programmed
+ *
+ */
+int32_t FICA_Stream_Flush(void);
+
+/*!
+ * @brief Flush the ring, close the image digest and log the programming statistics
+ * Must be called before FICA_app_program_ext_finalize.
+ *
+ */
+int32_t FICA_Stream_Finalize(void);
+
+/*!
+ * @brief Get the SHA-256 and CRC32 of the image computed while it was streamed
+ * Fails when the image was not received strictly in order or the programming failed.
+ *
+ */
+int32_t FICA_Stream_GetDigest(uint8_t *sha256, uint32_t *crc32);
+
+/*!
+ * @brief Compare the streamed image SHA-256 to an expected one
+ *
+ */
+int32_t FICA_Stream_VerifyDigest(const uint8_t *sha256);
+
+/*!
+ * @brief Verify the image signature against the streamed SHA-256, without reading the image back
+ * The signing certificate of the image type must have been verified and saved before.
+ *
+ */
+int32_t FICA_Stream_VerifySignature(int32_t imgtype, const uint8_t *signature, uint32_t siglen);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/*! @}*/
+
+#endif /* _FICA_STREAM_H_ */
@@ -32,6 +32,7 @@
 /* Logging includes. */
 #include "iot_logging_task.h"
 #include "logging_levels.h"
+#include "boot_record.h"
 
 /* Standard includes. */
 #include <stdio.h>
@@ -266,6 +267,14 @@ static void prvLoggingPrintfCommon( uint8_t usLoggingLevel,
             configASSERT( xLength > 0 );
         }
 
+        #if ( BOOT_DEFERRED_LOGGING == 1 )
+            /* Keep the line in the boot record, the application prints it. */
+            if( ( xLength > 0 ) && BOOT_Record_Log( pcPrintString, xLength ) )
+            {
+                xLength = 0;
+            }
+        #endif /* BOOT_DEFERRED_LOGGING */
+
         /* Only send the buffer to the logging task if it is
          * not empty. */
         if( xLength > 0 )
@@ -29,6 +29,7 @@
 
 #include "sln_flash.h"
 #include "sln_app_specific.h"
+#include "boot_record.h"
 #include "bootloader.h"
 
 /*******************************************************************************
@@ -72,6 +73,8 @@ void BusFault_Handler(void)
 
 int main(void)
 {
+    BOOT_Record_Init();
+
     /* Enable additional fault handlers */
     SCB->SHCSR |= (SCB_SHCSR_BUSFAULTENA_Msk | /*SCB_SHCSR_USGFAULTENA_Msk |*/ SCB_SHCSR_MEMFAULTENA_Msk);
 
@@ -86,6 +89,8 @@ int main(void)
     RGB_LED_Init();
     PUSH_BUTTONS_Init();
 
+    BOOT_Record_Mark(kBootStage_HardwareInit);
+
 #if ENABLE_LOGGING
     xLoggingTaskInitialize(LOGGING_STACK_SIZE, configMAX_PRIORITIES - 2, LOGGING_QUEUE_LENGTH);
 #endif /* ENABLE_LOGGING */
@@ -7,26 +7,84 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include "fsl_common.h"
 #include "sln_msc_vfs.h"
 #include "flash_ica_driver.h"
+#include "flash_ica_stream.h"
+#include "queue.h"
+#include "semphr.h"
 
 /*******************************************************************************
  * Definitions
  ******************************************************************************/
 
+/*
+ * MSD update pipeline
+ *
+ * The USB stack receives each write straight into a staging slot and returns to the host without
+ * waiting for the flash. The staging task then sorts the sectors: boot, FAT and root directory sectors
+ * update a shadow of the FAT, data sectors are mapped to an image offset through the cluster chain of
+ * the .BIN file and contiguous runs are handed to the FICA stream engine as one program.
+ * Because data is placed by cluster and not by arrival order, out of order host writes land correctly.
+ * Data sectors that can't be placed yet, written before the image vector table or before the FAT entries
+ * leading to them, are kept in a hold area and placed once the image start or the FAT tells where they go.
+ */
+
+#define MSC_VFS_SECTOR_SIZE         0x0200
+#define MSC_VFS_SECTORS_PER_CLUSTER 0x08
+#define MSC_VFS_RESERVED_SECTORS    0x0008
+#define MSC_VFS_NUM_FATS            0x02
+#define MSC_VFS_ROOT_ENTRIES        0x0200
+#define MSC_VFS_TOTAL_SECTORS       0x5000
+#define MSC_VFS_FAT_SECTORS         0x0008
+
+#define MSC_VFS_FAT_START_LBA  (MSC_VFS_RESERVED_SECTORS)
+#define MSC_VFS_ROOT_START_LBA (MSC_VFS_FAT_START_LBA + (MSC_VFS_NUM_FATS * MSC_VFS_FAT_SECTORS))
+#define MSC_VFS_ROOT_SECTORS   ((MSC_VFS_ROOT_ENTRIES * FAT_DIR_ENTRY_SIZE) / MSC_VFS_SECTOR_SIZE)
+#define MSC_VFS_DATA_START_LBA (MSC_VFS_ROOT_START_LBA + MSC_VFS_ROOT_SECTORS)
+#define MSC_VFS_CLUSTER_COUNT  ((MSC_VFS_TOTAL_SECTORS - MSC_VFS_DATA_START_LBA) / MSC_VFS_SECTORS_PER_CLUSTER)
+#define MSC_VFS_CLUSTER_SIZE   (MSC_VFS_SECTORS_PER_CLUSTER * MSC_VFS_SECTOR_SIZE)
+
+/* The FAT type is decided by the cluster count only, whatever the boot sector label says */
+#define MSC_VFS_IS_FAT12 (MSC_VFS_CLUSTER_COUNT < 4085)
+
+/* Results of MSC_VFS_ClusterIndex besides the position in the image chain */
+#define MSC_VFS_CLUSTER_FOREIGN (-1) /* The cluster is not part of the image */
+#define MSC_VFS_CLUSTER_UNKNOWN (-2) /* Neither the image start nor the FAT tell yet */
+
+typedef struct __msc_vfs_stage
+{
+    uint32_t lba;
+    uint32_t size;
+    uint8_t *buffer;
+} msc_vfs_stage_t;
+
+typedef struct __msc_vfs_image
+{
+    uint32_t firstCluster; /* Cluster holding the image vector table, 0 if not seen yet */
+    uint32_t dirCluster;   /* First cluster of the .BIN directory entry, 0 if not seen yet */
+    bool replay;           /* The image start or the FAT changed, the held sectors may be placed now */
+    uint32_t size;         /* Size of the .BIN directory entry, 0 if not seen yet */
+    uint32_t lastCluster;  /* Cache of the last cluster resolved through the chain */
+    uint32_t lastIndex;    /* Index in the chain of lastCluster */
+    bool guessedChain;     /* Some data was placed before its FAT entries were known */
+    uint32_t runOffset;    /* Pending coalesced program */
+    uint32_t runLength;
+    uint8_t *runData;
+} msc_vfs_image_t;
+
 /*******************************************************************************
  * Prototypes
  ******************************************************************************/
 
+static void MSC_VFS_Task(void *arg);
+
 /*******************************************************************************
  * Variables
  ******************************************************************************/
 
-static uint32_t s_startOffset = 0;
-static uint32_t s_fileLength  = 0;
-static uint32_t s_dataWritten = 0;
-static uint32_t s_lbaLength   = 0;
+static uint32_t s_lbaLength = 0;
 
 static msc_vfs_state_t s_transferState = TRANSFER_IDLE;
 
@@ -34,16 +92,38 @@ static TaskHandle_t *s_usbAppTaskHandle = NULL;
 
 static const char s_BinFileExtensionStr[] = "BIN";
 
+static uint8_t *s_storageDisk = NULL;
+static uint8_t *s_stageSlots  = NULL;
+static uint32_t s_stageCount  = 0;
+static uint32_t s_stageNext   = 0;
+
+static QueueHandle_t s_stageQueue         = NULL;
+static SemaphoreHandle_t s_stageFreeSlots = NULL;
+static TaskHandle_t s_vfsTaskHandle       = NULL;
+
+/* Shadow of the first FAT copy and of the image sectors already programmed */
+static uint8_t s_fatShadow[MSC_VFS_FAT_SECTORS * MSC_VFS_SECTOR_SIZE];
+static uint8_t s_sectorWritten[(MSC_VFS_TOTAL_SECTORS + 7) / 8];
+
+static msc_vfs_image_t s_image;
+static msc_vfs_stats_t s_vfsStats;
+
+/* Data sectors held until they can be placed, an entry is free when its lba is 0 */
+static uint8_t *s_heldData = NULL;
+static uint32_t s_heldLba[MSC_VFS_HOLD_SECTORS];
+static uint32_t s_heldSeq[MSC_VFS_HOLD_SECTORS];
+static uint32_t s_heldSeqNext = 0;
+
 static const fat_mbr_t s_fatMbrInit = {.jump_instr              = {0xEB, 0x3C, 0x90},
                                        .oem_name                = {'M', 'S', 'D', '0', 'S', '5', '.', '0'},
-                                       .bytes_per_sector        = 0x0200,
-                                       .sectors_per_cluster     = 0x08,
-                                       .reserved_sectors        = 0x0008,
-                                       .num_fats                = 0x02,
-                                       .root_entries            = 0x0200,
-                                       .num_logical_sectors     = 0x5000,
+                                       .bytes_per_sector        = MSC_VFS_SECTOR_SIZE,
+                                       .sectors_per_cluster     = MSC_VFS_SECTORS_PER_CLUSTER,
+                                       .reserved_sectors        = MSC_VFS_RESERVED_SECTORS,
+                                       .num_fats                = MSC_VFS_NUM_FATS,
+                                       .root_entries            = MSC_VFS_ROOT_ENTRIES,
+                                       .num_logical_sectors     = MSC_VFS_TOTAL_SECTORS,
                                        .media_type              = 0xf0,
-                                       .logical_sectors_per_fat = 0x0008,
+                                       .logical_sectors_per_fat = MSC_VFS_FAT_SECTORS,
                                        .sectors_per_track       = 0x003F,
                                        .num_heads               = 0x00FF,
                                        .hidden_sectors          = 0x00000000,
@@ -61,178 +141,575 @@ static const fat_mbr_t s_fatMbrInit = {.jump_instr              = {0xEB, 0x3C, 0
  * Code
  ******************************************************************************/
 
-status_t MSC_VFS_Init(uint8_t *storageDisk, TaskHandle_t *usbAppTask, uint32_t lbaLength)
+static void MSC_VFS_SetError(const char *reason)
 {
-    status_t status = kStatus_Fail;
+    if (TRANSFER_ERROR != s_transferState)
+    {
+        configPRINTF(("[Write Response] %s\r\n", reason));
 
-    if ((NULL != storageDisk) && (NULL != usbAppTask) && (0 != lbaLength))
+        s_transferState = TRANSFER_ERROR;
+
+        // Wake up application task to handle this error
+        vTaskResume(*s_usbAppTaskHandle);
+    }
+}
+
+static uint32_t MSC_VFS_FatEntry(uint32_t cluster)
+{
+    uint32_t entry = 0;
+
+#if MSC_VFS_IS_FAT12
+    uint32_t idx = cluster + (cluster / 2);
+
+    if ((idx + 1) < sizeof(s_fatShadow))
     {
-        status = kStatus_Success;
+        entry = s_fatShadow[idx] | (s_fatShadow[idx + 1] << 8);
+        entry = (cluster & 1) ? (entry >> 4) : (entry & 0x0FFF);
 
-        memcpy(&storageDisk[0], &s_fatMbrInit, sizeof(fat_mbr_t));
+        // Promote FAT12 reserved values so both FAT types share the end of chain check
+        if (entry >= 0x0FF8)
+        {
+            entry = FAT16_CLUSTER_EOC;
+        }
+    }
+#else
+    if (((cluster * 2) + 1) < sizeof(s_fatShadow))
+    {
+        entry = s_fatShadow[cluster * 2] | (s_fatShadow[(cluster * 2) + 1] << 8);
+    }
+#endif /* MSC_VFS_IS_FAT12 */
 
-        s_usbAppTaskHandle = usbAppTask;
+    return entry;
+}
 
-        s_lbaLength = lbaLength;
+static int32_t MSC_VFS_WalkChain(uint32_t cur, uint32_t idx, uint32_t cluster)
+{
+    uint32_t next;
 
-        s_fileLength    = 0;
-        s_dataWritten   = 0;
-        s_transferState = TRANSFER_IDLE;
+    while (cur != cluster)
+    {
+        next = MSC_VFS_FatEntry(cur);
+
+        if (0 == next)
+        {
+            // The host did not write this part of the FAT yet, assume a contiguous file from there
+            if (cluster < cur)
+                return MSC_VFS_CLUSTER_UNKNOWN;
+
+            s_image.guessedChain = true;
+            idx += cluster - cur;
+            break;
+        }
+
+        if ((next >= FAT16_CLUSTER_EOC) || (next < FAT_FIRST_DATA_CLUSTER) || (idx > MSC_VFS_CLUSTER_COUNT))
+            return MSC_VFS_CLUSTER_FOREIGN;
+
+        cur = next;
+        idx++;
     }
 
-    return status;
+    return (int32_t)idx;
 }
 
-msc_vfs_state_t MSC_VFS_GetTransferState(void)
+/*
+ * Returns the position of the cluster in the image chain, MSC_VFS_CLUSTER_FOREIGN if it does not belong to
+ * the image or MSC_VFS_CLUSTER_UNKNOWN if it can't be told yet. The chain is followed through the FAT from the
+ * first cluster of the .BIN directory entry, or from the vector table cluster while the entry is not written.
+ */
+static int32_t MSC_VFS_ClusterIndex(uint32_t cluster)
 {
-    return s_transferState;
+    uint32_t first = (0 != s_image.firstCluster) ? s_image.firstCluster : s_image.dirCluster;
+    int32_t idx    = MSC_VFS_CLUSTER_FOREIGN;
+
+    if (0 == first)
+        return MSC_VFS_CLUSTER_UNKNOWN;
+
+    // Most writes follow the previous one, resume the walk from the cached position
+    if ((s_image.lastCluster != 0) && (cluster >= s_image.lastCluster))
+    {
+        idx = MSC_VFS_WalkChain(s_image.lastCluster, s_image.lastIndex, cluster);
+    }
+
+    // The chain may go backwards, walk it again from the start
+    if (idx < 0)
+    {
+        idx = MSC_VFS_WalkChain(first, 0, cluster);
+    }
+
+    if (idx >= 0)
+    {
+        s_image.lastCluster = cluster;
+        s_image.lastIndex   = (uint32_t)idx;
+    }
+
+    return idx;
 }
 
-void MSC_VFS_SetTransferState(msc_vfs_state_t transferState)
+static bool MSC_VFS_IsChainContiguous(void)
 {
-    s_transferState = transferState;
+    uint32_t clusters = (s_image.size + MSC_VFS_CLUSTER_SIZE - 1) / MSC_VFS_CLUSTER_SIZE;
+    uint32_t entry;
+
+    for (uint32_t idx = 0; idx < clusters; idx++)
+    {
+        entry = MSC_VFS_FatEntry(s_image.firstCluster + idx);
+
+        if (0 == entry)
+        {
+            // Not known, nothing contradicts the contiguous placement
+            continue;
+        }
+
+        if ((idx + 1) < clusters)
+        {
+            if (entry != (s_image.firstCluster + idx + 1))
+                return false;
+        }
+        else if (entry < FAT16_CLUSTER_EOC)
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
-status_t MSC_VFS_WriteResponse(uint32_t offset, uint32_t size, uint8_t *buffer)
+static void MSC_VFS_StartImage(uint32_t cluster, uint8_t *buffer)
 {
-    int32_t flashError = SLN_FLASH_NO_ERROR;
-    status_t error     = kStatus_Success;
+    int32_t flashError     = SLN_FLASH_NO_ERROR;
+    uint32_t *resetHandler = (uint32_t *)(&buffer[4]);
+
+    // Determine the base programming address from the passed image reset vector
+    bool isFlash = ((FLASH_BYTE4_UPPER_NIBBLE & *resetHandler) == FLEXSPI_AMBA_BASE);
+    bool isValid = ((FLASH_BYTE3 & *resetHandler) == FICA_IMG_APP_A_ADDR) ||
+                   ((FLASH_BYTE3 & *resetHandler) == FICA_IMG_APP_B_ADDR);
 
-    if (0 != size)
+    if (isFlash && isValid)
     {
-        if (TRANSFER_IDLE == s_transferState)
+        int32_t currImgType  = FICA_IMG_TYPE_NONE;
+        uint32_t imgBaseAddr = (uint32_t)(*resetHandler & FLASH_BYTE3);
+
+        configPRINTF(("[Write Response] Reset Handler: 0x%X\r\n", *resetHandler));
+
+        flashError = FICA_GetImgTypeFromAddr(imgBaseAddr, &currImgType);
+
+        if ((FICA_IMG_TYPE_NONE >= currImgType) || (FICA_NUM_IMG_TYPES <= currImgType))
+        {
+            flashError = SLN_FLASH_ERROR;
+        }
+
+        if (SLN_FLASH_NO_ERROR == flashError)
         {
+            // Init FICA to be ready for the new application, the bank is erased ahead of the data
+            flashError = FICA_Stream_Init(currImgType);
+        }
+
+        if (SLN_FLASH_NO_ERROR != flashError)
+        {
+            MSC_VFS_SetError("Unable to begin transfer of file!");
+        }
+        else
+        {
+            s_image.firstCluster = cluster;
+            s_image.lastCluster  = cluster;
+            s_image.lastIndex    = 0;
+            s_image.replay       = true;
+            s_transferState      = TRANSFER_ACTIVE;
+        }
+    }
+}
 
-			for (uint32_t idx = 0; idx < size; idx++)
-			{
-				int ret = memcmp(&buffer[idx], s_BinFileExtensionStr,strlen(s_BinFileExtensionStr));
-				if (0 == ret &&
-					idx >= 8   /*name format is :  8 + 3 chars*/
-					&&strlen((char*)&buffer[idx - 8]) >= 11) /*file name must be a string*/
-				{
-					//file name format is: "***BIN"
-					char* cadidate = (char *)(&buffer[idx - 8]);
-					fat_file_t *file   = (fat_file_t *)cadidate;
-					if (file->size > 0 && file->size <= FICA_IMG_APP_A_SIZE && file->size <= FICA_IMG_APP_B_SIZE)
-					{
-						//there is no string end in file's name
-						char file_name[sizeof(file->name) + 1];
-						memcpy(file_name,file->name,sizeof(file->name));
-						file_name[sizeof(file->name)] = 0;
+static void MSC_VFS_TrackRootDir(uint8_t *buffer)
+{
+    for (uint32_t idx = 0; idx < MSC_VFS_SECTOR_SIZE; idx += FAT_DIR_ENTRY_SIZE)
+    {
+        fat_file_t *file = (fat_file_t *)&buffer[idx];
+
+        if (FAT_DIR_ENTRY_FREE == file->name[0])
+            break;
+
+        if ((FAT_DIR_ENTRY_DELETED == file->name[0]) || (FAT_ATTR_LFN == (file->attributes & FAT_ATTR_LFN)) ||
+            (file->attributes & (FAT_ATTR_VOLUME_ID | FAT_ATTR_DIRECTORY)))
+            continue;
 
-						configPRINTF(
-							("[Write Response] File Attributes: Name - %s, Size - %d\r\n", (const char *)file_name, file->size));
+        if (memcmp(&file->name[8], s_BinFileExtensionStr, strlen(s_BinFileExtensionStr)) != 0)
+            continue;
 
-						s_fileLength = file->size;
-						s_transferState = TRANSFER_START;
-						break;
-					}
+        // Another .BIN on the volume, only track the one holding the image
+        if ((0 != s_image.firstCluster) && (0 != file->first_cluster_lower) &&
+            (file->first_cluster_lower != s_image.firstCluster))
+            continue;
 
-				}
-			}
+        if ((0 == file->size) || (file->size > FICA_IMG_APP_A_SIZE) || (file->size > FICA_IMG_APP_B_SIZE))
+            continue;
 
-        }else if (TRANSFER_START == s_transferState)
+        if (file->size != s_image.size)
         {
-            // Determine the base programming address from the passed image reset vector
-        	uint32_t *resetHandler = (uint32_t *)(&buffer[4]);
+            // there is no string end in file's name
+            char file_name[sizeof(file->name) + 1];
+            memcpy(file_name, file->name, sizeof(file->name));
+            file_name[sizeof(file->name)] = 0;
 
-            bool isFlash = ((FLASH_BYTE4_UPPER_NIBBLE & *resetHandler) == FLEXSPI_AMBA_BASE);
-            bool isValid = ((FLASH_BYTE3 & *resetHandler) == FICA_IMG_APP_A_ADDR) ||
-                           ((FLASH_BYTE3 & *resetHandler) == FICA_IMG_APP_B_ADDR);
+            configPRINTF(("[Write Response] File Attributes: Name - %s, Size - %d\r\n", (const char *)file_name,
+                          file->size));
 
-            if (isFlash && isValid)
+            s_image.size = file->size;
+
+            if (TRANSFER_IDLE == s_transferState)
             {
-                int32_t currImgType  = FICA_IMG_TYPE_NONE;
-                uint32_t imgBaseAddr = (uint32_t)(*resetHandler & FLASH_BYTE3);
-
-
-                configPRINTF(("[Write Response] Reset Handler: 0x%X\r\n", *resetHandler));
-
-                flashError = FICA_GetImgTypeFromAddr(imgBaseAddr, &currImgType);
-
-                if ((FICA_IMG_TYPE_NONE >= currImgType) || (FICA_NUM_IMG_TYPES <= currImgType))
-                {
-                    flashError = SLN_FLASH_ERROR;
-                }
-
-                if (SLN_FLASH_NO_ERROR == flashError)
-                {
-                    // Rest of offsets coming in will be relative to the startoffset
-                    s_startOffset = offset;
-
-                    // Init FICA to be ready for the new application, erasing on received every packet
-                    flashError = FICA_app_program_ext_init(currImgType,0);
-                }
-
-                if (SLN_FLASH_NO_ERROR != flashError)
-                {
-                    error           = kStatus_Fail;
-                    s_transferState = TRANSFER_ERROR;
-                    configPRINTF(("[Write Response] Unable to begin transfer of file!\r\n"));
-
-                    // Wake up application task to handle this error
-                    vTaskResume(*s_usbAppTaskHandle);
-                }
-                else
-                {
-                	//this packet also need be programed
-                    s_transferState = TRANSFER_ACTIVE;
-                    goto write_packet;
-                }
+                s_transferState = TRANSFER_START;
             }
-        }else if (TRANSFER_ACTIVE == s_transferState)
+        }
+
+        // The image chain starts there, the sectors held for lack of it may be placed now
+        if ((0 != file->first_cluster_lower) && (file->first_cluster_lower != s_image.dirCluster))
+        {
+            s_image.dirCluster  = file->first_cluster_lower;
+            s_image.lastCluster = 0;
+            s_image.replay      = true;
+        }
+    }
+}
+
+static void MSC_VFS_TrackMeta(uint32_t lba, uint8_t *buffer)
+{
+    s_vfsStats.metaSectors++;
+
+    // Keep the sector so the host reads back what it wrote
+    memcpy(&s_storageDisk[(lba % MSC_VFS_META_WINDOW_LBAS) * s_lbaLength], buffer, s_lbaLength);
+
+    if ((lba >= MSC_VFS_FAT_START_LBA) && (lba < (MSC_VFS_FAT_START_LBA + MSC_VFS_FAT_SECTORS)))
+    {
+        memcpy(&s_fatShadow[(lba - MSC_VFS_FAT_START_LBA) * MSC_VFS_SECTOR_SIZE], buffer, MSC_VFS_SECTOR_SIZE);
+        s_image.replay = true;
+    }
+    else if ((lba >= MSC_VFS_ROOT_START_LBA) && (lba < MSC_VFS_DATA_START_LBA))
+    {
+        MSC_VFS_TrackRootDir(buffer);
+    }
+}
+
+static void MSC_VFS_FlushRun(void)
+{
+    if (0 != s_image.runLength)
+    {
+        if (TRANSFER_ACTIVE == s_transferState)
         {
-write_packet:
-            if (offset >= s_startOffset)
+            s_vfsStats.flashWrites++;
+
+            if (FICA_Stream_Write(s_image.runOffset, s_image.runData, s_image.runLength) != SLN_FLASH_NO_ERROR)
             {
-                uint32_t imgOffset, imgBaseAddr;
+                MSC_VFS_SetError("...save failed!!!");
+            }
+        }
+
+        s_image.runLength = 0;
+    }
+}
+
+/* Returns false if the sector can't be placed yet and has to be held */
+static bool MSC_VFS_PlaceData(uint32_t lba, uint8_t *buffer)
+{
+    uint32_t cluster = ((lba - MSC_VFS_DATA_START_LBA) / MSC_VFS_SECTORS_PER_CLUSTER) + FAT_FIRST_DATA_CLUSTER;
+    uint32_t sector  = (lba - MSC_VFS_DATA_START_LBA) % MSC_VFS_SECTORS_PER_CLUSTER;
+    uint32_t imgOffset;
+    uint32_t length = MSC_VFS_SECTOR_SIZE;
+    int32_t index   = MSC_VFS_ClusterIndex(cluster);
+
+    // The image starts with its vector table at the beginning of the first cluster of its chain
+    if ((0 == s_image.firstCluster) && (0 == sector) && ((0 == s_image.dirCluster) || (0 == index)) &&
+        ((TRANSFER_IDLE == s_transferState) || (TRANSFER_START == s_transferState)))
+    {
+        MSC_VFS_StartImage(cluster, buffer);
+        index = MSC_VFS_ClusterIndex(cluster);
+    }
+
+    if ((TRANSFER_IDLE == s_transferState) || (TRANSFER_START == s_transferState))
+    {
+        // Image data written ahead of the vector table, or not known to belong to the image yet
+        if (MSC_VFS_CLUSTER_FOREIGN != index)
+        {
+            MSC_VFS_FlushRun();
+            return false;
+        }
+    }
+    else if ((TRANSFER_ACTIVE == s_transferState) && (MSC_VFS_CLUSTER_UNKNOWN == index))
+    {
+        MSC_VFS_FlushRun();
+        return false;
+    }
 
-                // Calculate the image address for where to store this data
-                imgOffset = ((offset - s_startOffset) * s_lbaLength);
+    if ((index < 0) || (TRANSFER_ACTIVE != s_transferState))
+    {
+        s_vfsStats.ignoredSectors++;
+        MSC_VFS_FlushRun();
+        return true;
+    }
 
-                configPRINTF(("[Write Response] Saving %d of data to 0x%X...\r\n", size, imgOffset));
+    imgOffset = ((uint32_t)index * MSC_VFS_CLUSTER_SIZE) + (sector * MSC_VFS_SECTOR_SIZE);
+
+    if (0 != s_image.size)
+    {
+        if (imgOffset >= s_image.size)
+        {
+            // Cluster slack after the end of the file
+            s_vfsStats.ignoredSectors++;
+            MSC_VFS_FlushRun();
+            return true;
+        }
 
-                //erase the area before programming
-                assert(imgOffset%EXT_FLASH_ERASE_PAGE == 0);
+        length = MIN(length, s_image.size - imgOffset);
+    }
 
-                FICA_GetNewAppStartAddr(&imgBaseAddr);
-                flashError = FICA_Erase_Bank(imgBaseAddr + imgOffset, size);
+    if (!(s_sectorWritten[imgOffset / MSC_VFS_SECTOR_SIZE / 8] & (1 << ((imgOffset / MSC_VFS_SECTOR_SIZE) % 8))))
+    {
+        s_sectorWritten[imgOffset / MSC_VFS_SECTOR_SIZE / 8] |= (1 << ((imgOffset / MSC_VFS_SECTOR_SIZE) % 8));
+        s_vfsStats.imageBytes += length;
+    }
 
-                if (SLN_FLASH_NO_ERROR == flashError)
-                {
+    // Coalesce with the pending run when both the image offset and the staging data follow on
+    if ((0 != s_image.runLength) && ((s_image.runOffset + s_image.runLength) == imgOffset) &&
+        ((s_image.runData + s_image.runLength) == buffer))
+    {
+        s_image.runLength += length;
+    }
+    else
+    {
+        MSC_VFS_FlushRun();
 
-					// Write to external flash
-					flashError = FICA_app_program_ext_abs(imgOffset, buffer, size);
-                }
+        s_image.runOffset = imgOffset;
+        s_image.runData   = buffer;
+        s_image.runLength = length;
+    }
 
-                if (SLN_FLASH_NO_ERROR != flashError)
-                {
-                    error           = kStatus_Fail;
-                    s_transferState = TRANSFER_ERROR;
-                    configPRINTF(("[Write Response] ...save failed!!!\r\n", size, imgOffset));
+    return true;
+}
 
-                    // Wake up application task to handle this error
-                    vTaskResume(*s_usbAppTaskHandle);
-                }
-                else
-                {
-                    s_dataWritten += size;
-                    configPRINTF(("[Write Response] ...data saved!\r\n", size, imgOffset));
-                }
-            }
+static void MSC_VFS_Hold(uint32_t lba, uint8_t *buffer)
+{
+    uint32_t slot   = MSC_VFS_HOLD_SECTORS;
+    uint32_t oldest = 0;
+
+    for (uint32_t idx = 0; idx < MSC_VFS_HOLD_SECTORS; idx++)
+    {
+        // A sector written again replaces the held copy
+        if (lba == s_heldLba[idx])
+        {
+            slot = idx;
+            break;
+        }
+
+        if ((MSC_VFS_HOLD_SECTORS == slot) && (0 == s_heldLba[idx]))
+        {
+            slot = idx;
+        }
+
+        if ((0 != s_heldLba[idx]) && (s_heldSeq[idx] < s_heldSeq[oldest]))
+        {
+            oldest = idx;
+        }
+    }
+
+    if (MSC_VFS_HOLD_SECTORS == slot)
+    {
+        configPRINTF(("[Write Response] Hold area full, sector %d dropped\r\n", s_heldLba[oldest]));
+        s_vfsStats.droppedSectors++;
+        slot = oldest;
+    }
+
+    memcpy(&s_heldData[slot * MSC_VFS_SECTOR_SIZE], buffer, MSC_VFS_SECTOR_SIZE);
+    s_heldLba[slot] = lba;
+    s_heldSeq[slot] = s_heldSeqNext++;
+    s_vfsStats.heldSectors++;
+}
+
+static void MSC_VFS_TrackData(uint32_t lba, uint8_t *buffer)
+{
+    if (!MSC_VFS_PlaceData(lba, buffer))
+    {
+        MSC_VFS_Hold(lba, buffer);
+    }
+}
+
+/* Place the held sectors the image start or the FAT now tell the position of */
+static void MSC_VFS_Replay(void)
+{
+    bool placed[MSC_VFS_HOLD_SECTORS];
 
-            if ((s_fileLength > 0) && (s_dataWritten >= s_fileLength))
+    while (s_image.replay)
+    {
+        s_image.replay = false;
+
+        for (uint32_t idx = 0; idx < MSC_VFS_HOLD_SECTORS; idx++)
+        {
+            placed[idx] =
+                (0 != s_heldLba[idx]) && MSC_VFS_PlaceData(s_heldLba[idx], &s_heldData[idx * MSC_VFS_SECTOR_SIZE]);
+        }
+
+        // The hold entries are reused once their data reached the flash pipeline
+        MSC_VFS_FlushRun();
+
+        for (uint32_t idx = 0; idx < MSC_VFS_HOLD_SECTORS; idx++)
+        {
+            if (placed[idx])
             {
-                s_transferState = TRANSFER_FINAL;
+                s_heldLba[idx] = 0;
+            }
+        }
+    }
+}
+
+static void MSC_VFS_CheckComplete(void)
+{
+    if ((TRANSFER_ACTIVE != s_transferState) || (0 == s_image.size) || (s_vfsStats.imageBytes < s_image.size))
+        return;
+
+    if (s_image.guessedChain && !MSC_VFS_IsChainContiguous())
+    {
+        MSC_VFS_SetError("Fragmented file written before its FAT, unable to place the data!");
+        return;
+    }
+
+    configPRINTF(("[Write Response] ...%d bytes saved in %d programs!\r\n", s_vfsStats.imageBytes,
+                  s_vfsStats.flashWrites));
+
+    s_transferState = TRANSFER_FINAL;
+
+    // Wake up the application task to finalize transfer
+    vTaskResume(*s_usbAppTaskHandle);
+}
+
+static void MSC_VFS_Task(void *arg)
+{
+    msc_vfs_stage_t stage;
+    uint32_t lba;
+
+    while (1)
+    {
+        if (xQueueReceive(s_stageQueue, &stage, portMAX_DELAY) != pdTRUE)
+            continue;
 
-                // Wake up the application task to finalize transfer
-                vTaskResume(*s_usbAppTaskHandle);
+        lba = stage.lba;
+
+        for (uint32_t offset = 0; offset < stage.size; offset += s_lbaLength, lba++)
+        {
+            s_vfsStats.sectorsReceived++;
+
+            if (lba < MSC_VFS_DATA_START_LBA)
+            {
+                MSC_VFS_FlushRun();
+                MSC_VFS_TrackMeta(lba, &stage.buffer[offset]);
+            }
+            else
+            {
+                MSC_VFS_TrackData(lba, &stage.buffer[offset]);
             }
         }
+
+        // The staging slot is reused once its data reached the flash pipeline
+        MSC_VFS_FlushRun();
+        MSC_VFS_Replay();
+        MSC_VFS_CheckComplete();
+
+        xSemaphoreGive(s_stageFreeSlots);
     }
-    else
+}
+
+status_t MSC_VFS_Init(uint8_t *storageDisk, uint32_t storageSize, TaskHandle_t *usbAppTask, uint32_t lbaLength)
+{
+    status_t status = kStatus_Fail;
+
+    if ((NULL != storageDisk) && (NULL != usbAppTask) && (MSC_VFS_SECTOR_SIZE == lbaLength) &&
+        (storageSize > (((MSC_VFS_META_WINDOW_LBAS + MSC_VFS_HOLD_SECTORS) * lbaLength) + MSC_VFS_STAGE_SLOT_SIZE)))
+    {
+        status = kStatus_Success;
+
+        memcpy(&storageDisk[0], &s_fatMbrInit, sizeof(fat_mbr_t));
+
+        s_usbAppTaskHandle = usbAppTask;
+
+        s_lbaLength = lbaLength;
+
+        s_storageDisk = storageDisk;
+        s_heldData    = &storageDisk[MSC_VFS_META_WINDOW_LBAS * lbaLength];
+        s_stageSlots  = &s_heldData[MSC_VFS_HOLD_SECTORS * lbaLength];
+        s_stageCount  = (storageSize - ((MSC_VFS_META_WINDOW_LBAS + MSC_VFS_HOLD_SECTORS) * lbaLength)) /
+                       MSC_VFS_STAGE_SLOT_SIZE;
+        s_stageNext   = 0;
+
+        memset(&s_image, 0, sizeof(s_image));
+        memset(&s_vfsStats, 0, sizeof(s_vfsStats));
+        memset(s_fatShadow, 0, sizeof(s_fatShadow));
+        memset(s_sectorWritten, 0, sizeof(s_sectorWritten));
+        memset(s_heldLba, 0, sizeof(s_heldLba));
+        s_heldSeqNext = 0;
+
+        s_transferState = TRANSFER_IDLE;
+
+        s_stageQueue     = xQueueCreate(s_stageCount, sizeof(msc_vfs_stage_t));
+        s_stageFreeSlots = xSemaphoreCreateCounting(s_stageCount, s_stageCount);
+
+        if ((NULL == s_stageQueue) || (NULL == s_stageFreeSlots) ||
+            (xTaskCreate(MSC_VFS_Task, "MSC_VFS_Task", MSC_VFS_TASK_STACK, NULL, MSC_VFS_TASK_PRIORITY,
+                         &s_vfsTaskHandle) != pdPASS))
+        {
+            configPRINTF(("[MSC VFS] Unable to start the staging task\r\n"));
+            status = kStatus_Fail;
+        }
+    }
+
+    return status;
+}
+
+msc_vfs_state_t MSC_VFS_GetTransferState(void)
+{
+    return s_transferState;
+}
+
+void MSC_VFS_SetTransferState(msc_vfs_state_t transferState)
+{
+    s_transferState = transferState;
+}
+
+uint8_t *MSC_VFS_WriteRequest(uint32_t offset, uint32_t size)
+{
+    uint8_t *buffer = NULL;
+
+    assert(size <= MSC_VFS_STAGE_SLOT_SIZE);
+
+    // Backpressure: the host only waits when every slot is still queued for the flash
+    if (xSemaphoreTake(s_stageFreeSlots, 0) != pdTRUE)
+    {
+        s_vfsStats.slotWaits++;
+        xSemaphoreTake(s_stageFreeSlots, portMAX_DELAY);
+    }
+
+    buffer      = &s_stageSlots[s_stageNext * MSC_VFS_STAGE_SLOT_SIZE];
+    s_stageNext = (s_stageNext + 1) % s_stageCount;
+
+    return buffer;
+}
+
+status_t MSC_VFS_WriteResponse(uint32_t offset, uint32_t size, uint8_t *buffer)
+{
+    msc_vfs_stage_t stage = {.lba = offset, .size = size, .buffer = buffer};
+
+    if (0 == size)
     {
         configPRINTF(("[Write Response] Empty write response!\r\n"));
     }
-    return error;
+
+    // Cancelled transfers are queued as well so the slot is released in order
+    if (xQueueSend(s_stageQueue, &stage, portMAX_DELAY) != pdTRUE)
+        return kStatus_Fail;
+
+    return kStatus_Success;
+}
+
+void MSC_VFS_GetStats(msc_vfs_stats_t *stats)
+{
+    if (NULL != stats)
+    {
+        memcpy(stats, &s_vfsStats, sizeof(msc_vfs_stats_t));
+    }
 }
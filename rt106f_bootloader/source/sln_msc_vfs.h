@@ -20,6 +20,27 @@
 #define FLASH_BYTE4_UPPER_NIBBLE FICA_IMG_FLASH_MASK /* Used to ensure binary is using an address in flash */
 #define FLASH_BYTE3              FICA_IMG_BANK_START_ADDR_MASK /* Used to get start addr of a binary */
 
+/* Sectors at the start of the storage disk holding the last written FAT metadata, read back by the host */
+#define MSC_VFS_META_WINDOW_LBAS 0x20
+
+/* Size of one staging slot, the USB stack receives at most this much per transfer */
+#define MSC_VFS_STAGE_SLOT_SIZE (16 * 1024)
+
+/* Data sectors kept in RAM until they can be placed in the image, e.g. written before the vector table */
+#define MSC_VFS_HOLD_SECTORS 64
+
+#define MSC_VFS_TASK_STACK    1024
+#define MSC_VFS_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+
+#define FAT_DIR_ENTRY_SIZE     32
+#define FAT_DIR_ENTRY_FREE     0x00
+#define FAT_DIR_ENTRY_DELETED  0xE5
+#define FAT_ATTR_LFN           0x0F
+#define FAT_ATTR_VOLUME_ID     0x08
+#define FAT_ATTR_DIRECTORY     0x10
+#define FAT16_CLUSTER_EOC      0xFFF8
+#define FAT_FIRST_DATA_CLUSTER 2
+
 typedef enum __transfer_state
 {
     TRANSFER_IDLE,
@@ -75,10 +96,39 @@ typedef struct __attribute__((packed)) __fat_mbr
  * API
  ******************************************************************************/
 
-status_t MSC_VFS_Init(uint8_t *storageDisk, TaskHandle_t *usbAppTask, uint32_t lbaLength);
+typedef struct __msc_vfs_stats
+{
+    uint32_t sectorsReceived; /*!< Sectors handed over by the USB stack */
+    uint32_t metaSectors;     /*!< Boot, FAT and root directory sectors tracked by the shadow */
+    uint32_t imageBytes;      /*!< Unique image bytes programmed */
+    uint32_t ignoredSectors;  /*!< Data sectors outside of the image cluster chain */
+    uint32_t heldSectors;     /*!< Data sectors kept in RAM until their place in the image was known */
+    uint32_t droppedSectors;  /*!< Held sectors given up because the hold area was full */
+    uint32_t flashWrites;     /*!< Coalesced programs issued to the flash */
+    uint32_t slotWaits;       /*!< Write requests that waited for a free staging slot */
+} msc_vfs_stats_t;
 
+/*!
+ * @brief Initialize the MSD virtual file system and start the staging task
+ *
+ * The first MSC_VFS_META_WINDOW_LBAS sectors of storageDisk hold the FAT metadata, the next
+ * MSC_VFS_HOLD_SECTORS the data sectors not placed yet, the rest is split into MSC_VFS_STAGE_SLOT_SIZE
+ * slots that receive the USB sector writes.
+ */
+status_t MSC_VFS_Init(uint8_t *storageDisk, uint32_t storageSize, TaskHandle_t *usbAppTask, uint32_t lbaLength);
+
+/*!
+ * @brief Get a staging buffer for an incoming USB write, blocks until a slot is free
+ */
+uint8_t *MSC_VFS_WriteRequest(uint32_t offset, uint32_t size);
+
+/*!
+ * @brief Hand a received USB write to the staging task, returns without touching the flash
+ */
 status_t MSC_VFS_WriteResponse(uint32_t offset, uint32_t size, uint8_t *buffer);
 
+void MSC_VFS_GetStats(msc_vfs_stats_t *stats);
+
 msc_vfs_state_t MSC_VFS_GetTransferState(void);
 
 void MSC_VFS_SetTransferState(msc_vfs_state_t transferState);
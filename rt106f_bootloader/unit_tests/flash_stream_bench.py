@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2021 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Benchmark the image programming of the bootloader on a flash timing model.
+#
+# legacy: FICA_Erase_Bank erases the whole bank up front, then every received chunk is programmed by
+#         FICA_app_program_ext_abs before the next one is received, then FICA_Verify_Signature reads the image
+#         back from flash to hash it.
+# stream: FICA_Stream_* erases 64 KB blocks just ahead of the data and programs a ring of pages while the next
+#         chunk is received, the image SHA-256 is updated with each in order chunk and the signature is checked
+#         against it. Chunks received out of order flush the ring, and the image is then read back to be hashed.
+#
+# The flash timings and the ring size are read from source/flash_ica_stream.h, the flash geometry from
+# source/flash_config/sln_flash_config.h. The modeled flash busy time of both paths is the one
+# FICA_Stream_Finalize logs, the elapsed time adds the link and the overlap between the link and the flash.
+#
+# python3 flash_stream_bench.py                      compare both paths for the MSD and OTW links
+# python3 flash_stream_bench.py --reorder 0.05       with 5% of the chunks swapped with the next one
+# python3 flash_stream_bench.py --check              assert the streamed path is never slower
+
+import argparse
+import os
+import random
+import re
+import sys
+
+SOURCE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'source')
+
+# Update links: bytes per second of image data once decoded, and latency per chunk
+LINKS = {
+    # USB full speed mass storage, the VFS hands the staged runs of 32 KB to the stream
+    'msd': {'rate': 900 * 1024, 'chunk': 32 * 1024, 'latency_us': 1000},
+    # Comms handler over a 921600 baud uart, 4 KB blocks base64 encoded in a json message
+    'otw': {'rate': 921600 // 10 * 3 // 4, 'chunk': 4 * 1024, 'latency_us': 15000},
+}
+
+# FlexSPI read back and DCP SHA-256 throughput, bytes per second
+FLASH_READ_RATE = 50 * 1024 * 1024
+DCP_SHA256_RATE = 40 * 1024 * 1024
+
+# Bank A right after the bootloader, 6.5 MB on the 16 MB flash
+BANK_START = 0x200000
+BANK_SIZE = 0x680000
+
+
+def read_defines(path, names):
+    values = {}
+    with open(path) as header:
+        for line in header:
+            match = re.match(r'\s*#define\s+(\w+)\s+\(?(0x[0-9A-Fa-f]+|\d+)U?\)?', line)
+            if match and match.group(1) in names:
+                values[match.group(1)] = int(match.group(2), 0)
+    missing = [name for name in names if name not in values]
+    if missing:
+        raise SystemExit('%s: missing %s' % (path, ', '.join(missing)))
+    return values
+
+
+def load_model():
+    model = read_defines(os.path.join(SOURCE_DIR, 'flash_ica_stream.h'),
+                         ['FICA_TIMING_SECTOR_ERASE_US', 'FICA_TIMING_BLOCK_ERASE_US',
+                          'FICA_TIMING_PAGE_PROGRAM_US', 'FICA_STREAM_RING_PAGES'])
+    model.update(read_defines(os.path.join(SOURCE_DIR, 'flash_config', 'sln_flash_config.h'),
+                              ['FLASH_PAGE_SIZE', 'FLASH_SECTOR_SIZE', 'FLASH_BLOCK_SIZE']))
+    return model
+
+
+def erase_us(model, start, end):
+    # FICA_Stream_ModelEraseMs: blocks where aligned, sectors elsewhere
+    busy = 0
+    addr = start
+    while addr < end:
+        if not (addr % model['FLASH_BLOCK_SIZE']) and addr + model['FLASH_BLOCK_SIZE'] <= end:
+            busy += model['FICA_TIMING_BLOCK_ERASE_US']
+            addr += model['FLASH_BLOCK_SIZE']
+        else:
+            busy += model['FICA_TIMING_SECTOR_ERASE_US']
+            addr += model['FLASH_SECTOR_SIZE']
+    return busy
+
+
+def chunk_order(image_size, chunk, reorder, rng):
+    order = [(offset, min(chunk, image_size - offset)) for offset in range(0, image_size, chunk)]
+    index = 0
+    while index < len(order) - 1:
+        if rng.random() < reorder:
+            order[index], order[index + 1] = order[index + 1], order[index]
+            index += 1
+        index += 1
+    return order
+
+
+def receive_us(link, length):
+    return link['latency_us'] + length * 1000000 // link['rate']
+
+
+def run_legacy(model, link, order, image_size):
+    page = model['FLASH_PAGE_SIZE']
+    busy = erase_us(model, BANK_START, BANK_START + BANK_SIZE)
+    now = busy
+
+    for offset, length in order:
+        now += receive_us(link, length)
+        # FICA_app_program_ext_abs reads back the partial pages and programs page by page, nothing overlaps
+        pages = (offset % page + length + page - 1) // page
+        program = pages * model['FICA_TIMING_PAGE_PROGRAM_US'] + (page * 2 * 1000000 // FLASH_READ_RATE)
+        busy += program
+        now += program
+
+    # FICA_Verify_Signature hashes the image read back from flash
+    verify = image_size * 1000000 // FLASH_READ_RATE + image_size * 1000000 // DCP_SHA256_RATE
+    return {'elapsed_us': now + verify, 'busy_us': busy, 'verify_us': verify}
+
+
+class StreamModel:
+    def __init__(self, model):
+        self.model = model
+        self.erased_end = 0
+        self.flash_free = 0
+        self.busy = 0
+        # Time each ring slot is released by the programming task
+        self.slot_free = [0] * model['FICA_STREAM_RING_PAGES']
+        self.next_slot = 0
+        self.waits = 0
+
+    def erase_ahead(self, end):
+        # FICA_Stream_EraseAhead
+        cost = 0
+        while self.erased_end < end:
+            addr = BANK_START + self.erased_end
+            if not (addr % self.model['FLASH_BLOCK_SIZE']) and \
+                    self.erased_end + self.model['FLASH_BLOCK_SIZE'] <= BANK_SIZE:
+                cost += self.model['FICA_TIMING_BLOCK_ERASE_US']
+                self.erased_end += self.model['FLASH_BLOCK_SIZE']
+            else:
+                cost += self.model['FICA_TIMING_SECTOR_ERASE_US']
+                self.erased_end += self.model['FLASH_SECTOR_SIZE']
+        return cost
+
+    def queue_page(self, now, addr):
+        # The receiver waits for a free buffer, the task erases ahead and programs the page when the flash is free
+        slot = self.next_slot
+        self.next_slot = (slot + 1) % len(self.slot_free)
+        if self.slot_free[slot] > now:
+            self.waits += 1
+            now = self.slot_free[slot]
+        start = max(now, self.flash_free)
+        cost = self.erase_ahead(addr + self.model['FLASH_PAGE_SIZE']) + self.model['FICA_TIMING_PAGE_PROGRAM_US']
+        self.busy += cost
+        self.flash_free = start + cost
+        self.slot_free[slot] = self.flash_free
+        return now
+
+    def flush(self, now):
+        return max(now, self.flash_free)
+
+
+def run_stream(model, link, order, image_size):
+    page = model['FLASH_PAGE_SIZE']
+    stream = StreamModel(model)
+    next_offset = 0
+    digest_valid = True
+    now = 0
+
+    for offset, length in order:
+        now += receive_us(link, length)
+
+        if offset != next_offset:
+            # FICA_Stream_Write out of order: flush, erase ahead, program in place with the receiver waiting
+            digest_valid = False
+            now = stream.flush(now)
+            cost = stream.erase_ahead(offset + length)
+            pages = (offset % page + length + page - 1) // page
+            cost += pages * model['FICA_TIMING_PAGE_PROGRAM_US'] + (page * 2 * 1000000 // FLASH_READ_RATE)
+            stream.busy += cost
+            now += cost
+            stream.flash_free = now
+            next_offset = max(next_offset, offset + length)
+            continue
+
+        if digest_valid:
+            now += length * 1000000 // DCP_SHA256_RATE
+
+        for addr in range(offset - offset % page, offset + length, page):
+            now = stream.queue_page(now, addr)
+        next_offset = offset + length
+
+    # FICA_Stream_Finalize waits for the ring, the signature is checked on the streamed digest when it is valid
+    now = stream.flush(now)
+    verify = 0
+    if not digest_valid:
+        verify = image_size * 1000000 // FLASH_READ_RATE + image_size * 1000000 // DCP_SHA256_RATE
+    return {'elapsed_us': now + verify, 'busy_us': stream.busy, 'verify_us': verify, 'waits': stream.waits}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark the legacy and the streamed image programming')
+    parser.add_argument('--image', type=int, default=4 * 1024 * 1024, help='image size in bytes')
+    parser.add_argument('--link', choices=sorted(LINKS), action='append', help='update link, default all')
+    parser.add_argument('--reorder', type=float, default=0.0, help='probability a chunk is swapped with the next')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--check', action='store_true', help='fail if the streamed path is slower anywhere')
+    args = parser.parse_args()
+
+    if not 0 < args.image <= BANK_SIZE:
+        parser.error('the image must fit the %d bytes bank' % BANK_SIZE)
+
+    model = load_model()
+    print('timing: sector erase %d us, block erase %d us, page program %d us, ring of %d pages' %
+          (model['FICA_TIMING_SECTOR_ERASE_US'], model['FICA_TIMING_BLOCK_ERASE_US'],
+           model['FICA_TIMING_PAGE_PROGRAM_US'], model['FICA_STREAM_RING_PAGES']))
+    print('%-4s %-7s %10s %10s %10s %7s %8s' % ('link', 'path', 'elapsed ms', 'busy ms', 'verify ms', 'waits',
+                                                  'speedup'))
+
+    failed = False
+    for name in args.link or sorted(LINKS):
+        link = LINKS[name]
+        order = chunk_order(args.image, link['chunk'], args.reorder, random.Random(args.seed))
+        legacy = run_legacy(model, link, order, args.image)
+        stream = run_stream(model, link, order, args.image)
+        speedup = legacy['elapsed_us'] / stream['elapsed_us']
+
+        print('%-4s %-7s %10d %10d %10d %7s %8s' % (name, 'legacy', legacy['elapsed_us'] // 1000,
+                                                     legacy['busy_us'] // 1000, legacy['verify_us'] // 1000, '-', '-'))
+        print('%-4s %-7s %10d %10d %10d %7d %7.2fx' % (name, 'stream', stream['elapsed_us'] // 1000,
+                                                        stream['busy_us'] // 1000, stream['verify_us'] // 1000,
+                                                        stream['waits'], speedup))
+
+        if stream['elapsed_us'] > legacy['elapsed_us'] or stream['busy_us'] > legacy['busy_us']:
+            failed = True
+
+    if args.check and failed:
+        print('FAIL: the streamed path is slower than the legacy one')
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -84,6 +84,14 @@
     __attribute__((section(".bss.$SRAM_OCRAM_NCACHED,\"aw\",%nobits @"))) var __attribute__((aligned(alignbytes)))
 #define AT_NONCACHEABLE_SECTION_ALIGN_SDRAM(var, alignbytes) \
     __attribute__((section(".bss.$NCACHE_REGION,\"aw\",%nobits @"))) var __attribute__((aligned(alignbytes)))
+#define AT_CACHEABLE_SECTION_ALIGN_SDRAM(var, alignbytes) \
+    __attribute__((section(".bss.$BOARD_SDRAM,\"aw\",%nobits @"))) var __attribute__((aligned(alignbytes)))
+
+/* Camera and LCD frame buffers in cached SDRAM, the camera and display managers clean and invalidate them when the
+ * devices take them. Only enable it with the framework core built from the sources that do this cache maintenance */
+#ifndef ENABLE_CACHED_FRAME_BUFFERS
+#define ENABLE_CACHED_FRAME_BUFFERS 0
+#endif /* ENABLE_CACHED_FRAME_BUFFERS */
 
 
 /* OASIS definitions*/
@@ -101,8 +109,9 @@
 #define DISPLAY_LCDIF_IRQHandler LCDIF_IRQHandler
 
 /* BLE UART definitions*/
-#define BLE_UART_BASE  LPUART5
-#define BLE_UART_IRQn  LPUART5_IRQn
+#define BLE_UART_BASE       LPUART5
+#define BLE_UART_IRQn       LPUART5_IRQn
+#define BLE_UART_IRQHandler LPUART5_IRQHandler
 
 /*PWM definitions*/
 #define IR_PWM_BASE_ADDR       PWM4
@@ -131,4 +131,36 @@ void vLoggingPrintfInfo( const char * pcFormat,
 void vLoggingPrintfDebug( const char * pcFormat,
                           ... );
 
+/**
+ * @brief Record a log message at Info level without formatting it.
+ *
+ * Only the address of the format string, the time, the task name and the raw
+ * arguments are stored in a lock free ring, the logging task formats the
+ * message later.  Can be called from an interrupt.  When the ring is full the
+ * message is dropped and counted.
+ *
+ * @param[in] pcFormat The format string of the log message, it must stay valid.
+ * @param[in] ... The variadic list of parameters for the format
+ * specifiers in the @p pcFormat.
+ *
+ * @return pdFALSE if the message can not be deferred and must be formatted by
+ * the caller, which is the case for %s, floating point and 64 bit conversions.
+ */
+BaseType_t xLoggingPrintfDeferredInfo( const char * pcFormat,
+                                       ... );
+
+/**
+ * @brief Record a log message at Debug level without formatting it.
+ *
+ * See xLoggingPrintfDeferredInfo().
+ *
+ * @param[in] pcFormat The format string of the log message, it must stay valid.
+ * @param[in] ... The variadic list of parameters for the format
+ * specifiers in the @p pcFormat.
+ *
+ * @return pdFALSE if the message must be formatted by the caller.
+ */
+BaseType_t xLoggingPrintfDeferredDebug( const char * pcFormat,
+                                        ... );
+
 #endif /* AWS_LOGGING_TASK_H */
@@ -54,9 +54,20 @@
     #error configLOGGING_INCLUDE_TIME_AND_TASK_NAME must be defined in FreeRTOSConfig.h to use this logging file.  Set configLOGGING_INCLUDE_TIME_AND_TASK_NAME to 1 to prepend a time stamp, message number and the name of the calling task to each logged message.  Otherwise set to 0.
 #endif
 
+#ifndef configLOGGING_DEFERRED_LENGTH
+    #define configLOGGING_DEFERRED_LENGTH    0
+#endif
+
+#ifndef configLOGGING_DEFERRED_DRAIN_MS
+    #define configLOGGING_DEFERRED_DRAIN_MS    10
+#endif
+
 /* A block time of 0 just means don't block. */
 #define loggingDONT_BLOCK    0
 
+/* Arguments kept by a deferred log record, the drain passes all of them to snprintf(). */
+#define loggingDEFERRED_MAX_ARGS    8
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -73,6 +84,15 @@
  */
 static void prvLoggingTask( void * pvParameters );
 
+#if ( configLOGGING_DEFERRED_LENGTH > 0 )
+
+/*
+ * Format and output the deferred log records, called by the logging task.
+ */
+static void prvLoggingDrainDeferred( void );
+
+#endif
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -81,6 +101,47 @@ static void prvLoggingTask( void * pvParameters );
  */
 static QueueHandle_t xQueue = NULL;
 
+/*
+ * Number of the next log message, shared by the formatted and the deferred
+ * messages.
+ */
+static BaseType_t xMessageNumber = 0;
+
+/*-----------------------------------------------------------*/
+
+#if ( configLOGGING_DEFERRED_LENGTH > 0 )
+
+/*
+ * Deferred log records.  The caller only stores the address of the format
+ * string, which identifies the message, and the raw 32 bit arguments.  The
+ * text is formatted later by the logging task.
+ *
+ * The ring is a bounded multi producer queue: a producer reserves a slot by
+ * advancing ulDeferredHead with a compare and swap and publishes it by writing
+ * the slot sequence, so tasks and interrupts can record without a lock.
+ * Only the logging task consumes.
+ */
+typedef struct xLOGGING_RECORD
+{
+    volatile uint32_t ulSequence;
+    const char * pcFormat;
+    const char * pcTaskName;
+    uint32_t ulTimeUs;
+    uint8_t ucLevel;
+    uint8_t ucArgCount;
+    uint32_t ulArgs[ loggingDEFERRED_MAX_ARGS ];
+} LoggingRecord_t;
+
+static LoggingRecord_t xDeferredRing[ configLOGGING_DEFERRED_LENGTH ];
+static uint32_t ulDeferredHead = 0;
+static uint32_t ulDeferredTail = 0;
+static uint32_t ulDeferredDropped = 0;
+
+/* Only used by the logging task. */
+static char cDeferredString[ configLOGGING_MAX_MESSAGE_LENGTH ];
+
+#endif /* configLOGGING_DEFERRED_LENGTH > 0 */
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -99,6 +160,16 @@ BaseType_t xLoggingTaskInitialize( uint16_t usStackSize,
     /* Ensure the logging task has not been created already. */
     if( xQueue == NULL )
     {
+        #if ( configLOGGING_DEFERRED_LENGTH > 0 )
+            {
+                /* A slot is free for the producer whose position matches its sequence. */
+                for( uint32_t i = 0; i < configLOGGING_DEFERRED_LENGTH; i++ )
+                {
+                    xDeferredRing[ i ].ulSequence = i;
+                }
+            }
+        #endif
+
         /* Create the queue used to pass pointers to strings to the logging task. */
         xQueue = xQueueCreate( uxQueueLength, sizeof( char ** ) );
 
@@ -129,18 +200,81 @@ static void prvLoggingTask( void * pvParameters )
 
     for( ; ; )
     {
-        /* Block to wait for the next string to print. */
-        if( xQueueReceive( xQueue, &pcReceivedString, portMAX_DELAY ) == pdPASS )
-        {
-            configPRINT_STRING( pcReceivedString );
+        #if ( configLOGGING_DEFERRED_LENGTH > 0 )
+            {
+                BaseType_t xReceived = xQueueReceive( xQueue, &pcReceivedString, pdMS_TO_TICKS( configLOGGING_DEFERRED_DRAIN_MS ) );
 
-            vPortFree( ( void * ) pcReceivedString );
-        }
+                /* The deferred records are older than the string just received. */
+                prvLoggingDrainDeferred();
+
+                if( xReceived == pdPASS )
+                {
+                    configPRINT_STRING( pcReceivedString );
+
+                    vPortFree( ( void * ) pcReceivedString );
+                }
+            }
+        #else
+            {
+                /* Block to wait for the next string to print. */
+                if( xQueueReceive( xQueue, &pcReceivedString, portMAX_DELAY ) == pdPASS )
+                {
+                    configPRINT_STRING( pcReceivedString );
+
+                    vPortFree( ( void * ) pcReceivedString );
+                }
+            }
+        #endif /* configLOGGING_DEFERRED_LENGTH > 0 */
     }
 }
 
 /*-----------------------------------------------------------*/
 
+static const char * prvLoggingLevelString( uint8_t usLoggingLevel )
+{
+    const char *pcLevelString = "";
+
+    /* Choose the string for the log level metadata for the log message. */
+    switch( usLoggingLevel )
+    {
+        case LOG_ERROR:
+            pcLevelString = "E";
+            break;
+
+        case LOG_WARN:
+            pcLevelString = "W";
+            break;
+
+        case LOG_INFO:
+            pcLevelString = "I";
+            break;
+
+        case LOG_DEBUG:
+            pcLevelString = "D";
+    }
+
+    return pcLevelString;
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t prvLoggingPrintPrefix( char * pcPrintString,
+                                     uint8_t usLoggingLevel,
+                                     uint32_t time,
+                                     const char * pcTaskName )
+{
+    return snprintf( pcPrintString, configLOGGING_MAX_MESSAGE_LENGTH, "[%s][%s] [%3lu] [%5lu.%3lu.%3lu] [%20s]  ",
+                     g_coreName,
+                     prvLoggingLevelString( usLoggingLevel ),
+                     ( unsigned long ) xMessageNumber++,
+                     (time / 1000000),
+                     ((time / 1000) % 1000),
+                     (time % 1000),
+                     pcTaskName );
+}
+
+/*-----------------------------------------------------------*/
+
 static void prvLoggingPrintfCommon( uint8_t usLoggingLevel,
                                     const char * pcFile,
                                     size_t fileLineNo,
@@ -164,35 +298,8 @@ static void prvLoggingPrintfCommon( uint8_t usLoggingLevel,
 
     if( pcPrintString != NULL )
     {
-        const char *pcLevelString = "";
         size_t ulFormatLen = 0UL;
 
-        /* Choose the string for the log level metadata for the log message. */
-        switch( usLoggingLevel )
-        {
-            case LOG_ERROR:
-                pcLevelString = "E";
-                break;
-
-            case LOG_WARN:
-                pcLevelString = "W";
-                break;
-
-            case LOG_INFO:
-                pcLevelString = "I";
-                break;
-
-            case LOG_DEBUG:
-                pcLevelString = "D";
-        }
-
-        /* Add the chosen log level information as prefix for the message. */
-        /*if( pcLevelString != NULL )
-        {
-            xLength += snprintf( pcPrintString + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, "[%s] ", pcLevelString );
-            configASSERT( xLength > 0 );
-        }*/
-
         /* Add metadata of task name and tick time for a new log message. */
         if( strcmp( pcFormat, "\n" ) != 0 )
         {
@@ -201,7 +308,6 @@ static void prvLoggingPrintfCommon( uint8_t usLoggingLevel,
                 {
                     const char * pcTaskName;
                     const char * pcNoTask = "None";
-                    static BaseType_t xMessageNumber = 0;
                     uint32_t time = FWK_CurrentTimeUs();
 
                     /* Add a time stamp and the name of the calling task to the
@@ -215,14 +321,7 @@ static void prvLoggingPrintfCommon( uint8_t usLoggingLevel,
                         pcTaskName = pcNoTask;
                     }
 
-                    xLength += snprintf( pcPrintString, configLOGGING_MAX_MESSAGE_LENGTH, "[%s][%s] [%3lu] [%5lu.%3lu.%3lu] [%20s]  ",
-                                         g_coreName,
-                                         pcLevelString,
-                                         ( unsigned long ) xMessageNumber++,
-                                         (time / 1000000),
-                                         ((time / 1000) % 1000),
-                                         (time % 1000),
-                                         pcTaskName );
+                    xLength += prvLoggingPrintPrefix( pcPrintString, usLoggingLevel, time, pcTaskName );
                 }
             #endif /* if ( configLOGGING_INCLUDE_TIME_AND_TASK_NAME == 1 ) */
         }
@@ -418,3 +517,254 @@ void vLoggingPrint( const char * pcMessage )
         }
     }
 }
+
+/*-----------------------------------------------------------*/
+
+#if ( configLOGGING_DEFERRED_LENGTH > 0 )
+
+/*
+ * Count the arguments of a format string, or return -1 if a conversion does
+ * not take a 32 bit value.  Strings may not outlive the call and doubles do
+ * not fit in a slot, such messages are formatted by the caller.
+ */
+static int32_t prvLoggingDeferredArgCount( const char * pcFormat )
+{
+    int32_t lArgCount = 0;
+
+    while( *pcFormat != '\0' )
+    {
+        if( *pcFormat++ != '%' )
+        {
+            continue;
+        }
+
+        if( *pcFormat == '%' )
+        {
+            pcFormat++;
+            continue;
+        }
+
+        /* Flags, width and precision. */
+        while( ( strchr( "-+ #0123456789.", *pcFormat ) != NULL ) || ( *pcFormat == '*' ) )
+        {
+            if( *pcFormat == '\0' )
+            {
+                return -1;
+            }
+
+            if( *pcFormat == '*' )
+            {
+                lArgCount++;
+            }
+
+            pcFormat++;
+        }
+
+        /* Length modifiers up to the size of an int. */
+        while( ( *pcFormat == 'h' ) || ( *pcFormat == 'l' ) || ( *pcFormat == 'z' ) || ( *pcFormat == 't' ) )
+        {
+            if( ( pcFormat[ 0 ] == 'l' ) && ( pcFormat[ 1 ] == 'l' ) )
+            {
+                return -1;
+            }
+
+            pcFormat++;
+        }
+
+        if( ( *pcFormat == '\0' ) || ( strchr( "diouxXcp", *pcFormat ) == NULL ) )
+        {
+            return -1;
+        }
+
+        pcFormat++;
+        lArgCount++;
+    }
+
+    return ( lArgCount <= loggingDEFERRED_MAX_ARGS ) ? lArgCount : -1;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvLoggingRecordDeferred( uint8_t usLoggingLevel,
+                                            const char * pcFormat,
+                                            va_list args )
+{
+    LoggingRecord_t * pxRecord = NULL;
+    int32_t lArgCount = prvLoggingDeferredArgCount( pcFormat );
+    uint32_t ulPosition;
+
+    if( ( lArgCount < 0 ) || ( xQueue == NULL ) )
+    {
+        return pdFALSE;
+    }
+
+    ulPosition = __atomic_load_n( &ulDeferredHead, __ATOMIC_RELAXED );
+
+    for( ; ; )
+    {
+        pxRecord = &xDeferredRing[ ulPosition % configLOGGING_DEFERRED_LENGTH ];
+        int32_t lDiff = ( int32_t ) ( __atomic_load_n( &pxRecord->ulSequence, __ATOMIC_ACQUIRE ) - ulPosition );
+
+        if( lDiff == 0 )
+        {
+            /* On failure ulPosition is updated to the current head. */
+            if( __atomic_compare_exchange_n( &ulDeferredHead, &ulPosition, ulPosition + 1, pdFALSE, __ATOMIC_RELAXED,
+                                             __ATOMIC_RELAXED ) )
+            {
+                break;
+            }
+        }
+        else if( lDiff < 0 )
+        {
+            /* Ring full, the record is counted and dropped. */
+            __atomic_fetch_add( &ulDeferredDropped, 1, __ATOMIC_RELAXED );
+            return pdTRUE;
+        }
+        else
+        {
+            ulPosition = __atomic_load_n( &ulDeferredHead, __ATOMIC_RELAXED );
+        }
+    }
+
+    pxRecord->pcFormat = pcFormat;
+    pxRecord->ulTimeUs = FWK_CurrentTimeUs();
+    pxRecord->ucLevel = usLoggingLevel;
+    pxRecord->ucArgCount = ( uint8_t ) lArgCount;
+
+    if( xPortIsInsideInterrupt() )
+    {
+        pxRecord->pcTaskName = "ISR";
+    }
+    else if( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED )
+    {
+        pxRecord->pcTaskName = pcTaskGetName( NULL );
+    }
+    else
+    {
+        pxRecord->pcTaskName = "None";
+    }
+
+    for( int32_t i = 0; i < lArgCount; i++ )
+    {
+        pxRecord->ulArgs[ i ] = va_arg( args, uint32_t );
+    }
+
+    /* Publish the record to the logging task. */
+    __atomic_store_n( &pxRecord->ulSequence, ulPosition + 1, __ATOMIC_RELEASE );
+
+    return pdTRUE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvLoggingDrainDeferred( void )
+{
+    uint32_t ulDropped = __atomic_exchange_n( &ulDeferredDropped, 0, __ATOMIC_RELAXED );
+
+    if( ulDropped > 0 )
+    {
+        snprintf( cDeferredString, configLOGGING_MAX_MESSAGE_LENGTH, "[%s] %lu deferred log records dropped\r\n",
+                  g_coreName, ( unsigned long ) ulDropped );
+        configPRINT_STRING( cDeferredString );
+    }
+
+    for( ; ; )
+    {
+        LoggingRecord_t * pxRecord = &xDeferredRing[ ulDeferredTail % configLOGGING_DEFERRED_LENGTH ];
+        LoggingRecord_t xRecord;
+        size_t xLength = 0;
+        int32_t xLength2 = 0;
+        size_t ulFormatLen = 0UL;
+
+        if( __atomic_load_n( &pxRecord->ulSequence, __ATOMIC_ACQUIRE ) != ( ulDeferredTail + 1 ) )
+        {
+            break;
+        }
+
+        /* Release the slot before the slow output. */
+        xRecord = *pxRecord;
+        __atomic_store_n( &pxRecord->ulSequence, ulDeferredTail + configLOGGING_DEFERRED_LENGTH, __ATOMIC_RELEASE );
+        ulDeferredTail++;
+
+        #if ( configLOGGING_INCLUDE_TIME_AND_TASK_NAME == 1 )
+            {
+                xLength = prvLoggingPrintPrefix( cDeferredString, xRecord.ucLevel, xRecord.ulTimeUs, xRecord.pcTaskName );
+            }
+        #endif
+
+        /* Every conversion takes a 32 bit value, the unused slots are ignored. */
+        xLength2 = snprintf( cDeferredString + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, xRecord.pcFormat,
+                             xRecord.ulArgs[ 0 ], xRecord.ulArgs[ 1 ], xRecord.ulArgs[ 2 ], xRecord.ulArgs[ 3 ],
+                             xRecord.ulArgs[ 4 ], xRecord.ulArgs[ 5 ], xRecord.ulArgs[ 6 ], xRecord.ulArgs[ 7 ] );
+
+        if( xLength2 < 0 )
+        {
+            xLength2 = 0;
+            cDeferredString[ xLength ] = '\0';
+        }
+
+        xLength += ( size_t ) xLength2;
+
+        if( xLength > configLOGGING_MAX_MESSAGE_LENGTH - 3 )
+        {
+            xLength = configLOGGING_MAX_MESSAGE_LENGTH - 3;
+        }
+
+        ulFormatLen = strlen( xRecord.pcFormat );
+
+        if( ( ulFormatLen == 0 ) || ( xRecord.pcFormat[ ulFormatLen - 1 ] != '\n' ) )
+        {
+            strcpy( cDeferredString + xLength, "\r\n" );
+        }
+
+        configPRINT_STRING( cDeferredString );
+    }
+}
+
+#endif /* configLOGGING_DEFERRED_LENGTH > 0 */
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xLoggingPrintfDeferredInfo( const char * pcFormat,
+                                       ... )
+{
+    BaseType_t xReturn = pdFALSE;
+
+    #if ( configLOGGING_DEFERRED_LENGTH > 0 )
+        {
+            va_list args;
+
+            va_start( args, pcFormat );
+            xReturn = prvLoggingRecordDeferred( LOG_INFO, pcFormat, args );
+
+            va_end( args );
+        }
+    #else
+        ( void ) pcFormat;
+    #endif
+
+    return xReturn;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xLoggingPrintfDeferredDebug( const char * pcFormat,
+                                        ... )
+{
+    BaseType_t xReturn = pdFALSE;
+
+    #if ( configLOGGING_DEFERRED_LENGTH > 0 )
+        {
+            va_list args;
+
+            va_start( args, pcFormat );
+            xReturn = prvLoggingRecordDeferred( LOG_DEBUG, pcFormat, args );
+
+            va_end( args );
+        }
+    #else
+        ( void ) pcFormat;
+    #endif
+
+    return xReturn;
+}
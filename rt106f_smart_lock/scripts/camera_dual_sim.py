@@ -0,0 +1,320 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Simulate the sensor timing of the shared dual GC0308 camera (hal_camera_csi_shared_dual_gc0308.c) to compare the
+# frame rate each stream gets from the scheduler with the one of the synchronous switch it replaced.
+#
+# Both sensors run a free running frame clock of their own phase, the CSI receives the frames of the sensor whose
+# output is on. A frame is clean when that sensor alone was on for the whole frame, the others mix both sensors.
+#
+# legacy:    the camera manager dequeues every frame, switches the sensors over I2C in its own context after each
+#            valid frame and drops the next frame, whichever sensor it comes from
+# scheduler: the rules of _camera_frame_done, _camera_schedule_next and _camera_switch_task. The frame done interrupt
+#            drops the frames of a switch, the switch task writes the sensors
+#
+# The ratios, the frames dropped after a switch and the frame rate are read from source/app_config.h and the HAL.
+#
+# python3 camera_dual_sim.py                      legacy against the scheduler for a few RGB:IR ratios
+# python3 camera_dual_sim.py --ratio 0:1 --face-at-s 5 --face-ratio 1:1   IR only until a face, then both
+# python3 camera_dual_sim.py --check              fail if the scheduler is slower or delivers a mixed frame
+
+import argparse
+import heapq
+import os
+import random
+import re
+import sys
+
+SCRIPTS_DIR = os.path.dirname(os.path.abspath(__file__))
+APP_CONFIG = os.path.join(SCRIPTS_DIR, '..', 'source', 'app_config.h')
+HAL_FILE = os.path.join(SCRIPTS_DIR, '..', 'sln_framework', 'hal', 'camera', 'hal_camera_csi_shared_dual_gc0308.c')
+
+RGB, IR = 0, 1
+NAMES = ('RGB', 'IR')
+
+
+def read_config():
+    config = {}
+    with open(APP_CONFIG) as f:
+        for match in re.finditer(r'#define\s+CAMERA_CSI_SHARED_DUAL_(\w+)\s+(\d+)', f.read()):
+            config[match.group(1)] = int(match.group(2))
+    with open(HAL_FILE) as f:
+        source = f.read()
+    config['BUFFER_COUNT'] = int(re.search(r'#define\s+CAMERA_DEV_BUFFER_COUNT\s+(\d+)', source).group(1))
+    config['FPS'] = int(re.search(r'framePerSec\s*=\s*(\d+)', source).group(1))
+    missing = [n for n in ('IDLE_RGB_FRAMES', 'IDLE_IR_FRAMES', 'FACE_RGB_FRAMES', 'FACE_IR_FRAMES',
+                           'DISCARD_FRAMES') if n not in config]
+    if missing:
+        raise SystemExit('%s: missing CAMERA_CSI_SHARED_DUAL_%s' % (APP_CONFIG, ', '.join(missing)))
+    return config
+
+
+def parse_ratio(text):
+    rgb, ir = (int(v) for v in text.split(':'))
+    if rgb < 0 or ir < 0 or rgb + ir == 0:
+        raise argparse.ArgumentTypeError('a ratio is RGB:IR frames, not both 0')
+    return (rgb, ir)
+
+
+class Sensors:
+    '''Output of the two sensors over time, to tell the clean frames from the mixed ones'''
+
+    def __init__(self):
+        self.on = [False, False]
+        self.on_since = [0, 0]
+        self.off_since = [0, 0]
+
+    def set(self, sensor, on, now):
+        if self.on[sensor] != on:
+            self.on[sensor] = on
+            if on:
+                self.on_since[sensor] = now
+            else:
+                self.off_since[sensor] = now
+
+    def clean(self, sensor, start):
+        other = 1 - sensor
+        return self.on[sensor] and self.on_since[sensor] <= start and not self.on[other] and \
+            self.off_since[other] <= start
+
+
+class Sim:
+    def __init__(self, args, config, legacy, ratios, rng):
+        self.args = args
+        self.legacy = legacy
+        self.period = 1000000 // config['FPS']
+        self.discard_frames = config['DISCARD_FRAMES']
+        self.ring_size = config['BUFFER_COUNT']
+        self.ratios = [list(r) for r in ratios]  # idle, face
+        self.events = []
+        self.order = 0
+        self.sensors = Sensors()
+        self.sensors.set(RGB, True, 0)
+        self.free_buffers = config['BUFFER_COUNT']
+        self.manager_free = 0
+
+        # scheduler state, as in csi_shared_dual_scheduler_t
+        self.face = 0
+        self.current = RGB
+        self.run_left = self.ratios[0][RGB]
+        self.discard_left = self.discard_frames
+        self.switching = False
+        self.ready = []
+        # the legacy dequeue
+        self.valid = False
+        self.full = []
+
+        self.delivered = [0, 0]
+        self.discarded = [0, 0]
+        self.bad = 0  # delivered mixed, or tagged with the other sensor
+        self.csi_drops = 0
+        self.switches = 0
+        self.face_at = None
+        self.first_after_face = [None, None]
+
+        if not legacy and self.ratios[0][RGB] == 0:
+            # Init starts the RGB sensor, an IR only ratio switches after its first frame
+            self.run_left = 1
+        for sensor in (RGB, IR):
+            self.push(rng.randrange(self.period) + self.period, 'frame_end', sensor)
+
+    def push(self, when, kind, *data):
+        self.order += 1
+        heapq.heappush(self.events, (when, self.order, kind, data))
+
+    def run(self, duration_us, face_at_us=None):
+        if face_at_us is not None:
+            self.push(face_at_us, 'face')
+        while self.events:
+            now, _, kind, data = heapq.heappop(self.events)
+            if now > duration_us:
+                break
+            getattr(self, 'on_' + kind)(now, *data)
+        return self
+
+    def on_face(self, now):
+        # the vision algorithm reports a face, the ratio is used from the next switch decision
+        self.face = 1
+        self.face_at = now
+
+    def on_frame_end(self, now, sensor):
+        self.push(now + self.period, 'frame_end', sensor)
+        if not self.sensors.on[sensor]:
+            return
+        if self.free_buffers == 0:
+            self.csi_drops += 1
+            return
+        self.free_buffers -= 1
+        frame = (sensor, self.sensors.clean(sensor, now - self.period))
+        if self.legacy:
+            self.legacy_frame_done(now, frame)
+        else:
+            self.frame_done(now, frame)
+
+    def release_buffer(self, now):
+        self.free_buffers += 1
+
+    def on_release(self, now):
+        self.release_buffer(now)
+
+    def deliver(self, now, tag, frame):
+        sensor, clean = frame
+        self.delivered[tag] += 1
+        if not clean or sensor != tag:
+            self.bad += 1
+        if self.face_at is not None and self.first_after_face[tag] is None:
+            self.first_after_face[tag] = now - self.face_at
+
+    # _camera_frame_done, the frame done interrupt
+    def frame_done(self, now, frame):
+        camera = self.current
+        if self.switching or self.discard_left or len(self.ready) == self.ring_size:
+            if self.discard_left:
+                self.discard_left -= 1
+            self.discarded[camera] += 1
+            self.release_buffer(now)
+            return
+
+        self.ready.append((camera, frame))
+        if self.run_left > 0:
+            self.run_left -= 1
+        if self.run_left == 0:
+            self.schedule_next(now)
+        self.push(max(now + self.args.isr_to_task_us, self.manager_free), 'dequeue')
+        self.manager_free = max(now + self.args.isr_to_task_us, self.manager_free) + self.args.manager_us
+
+    # _camera_schedule_next
+    def schedule_next(self, now):
+        ratio = self.ratios[self.face]
+        next_camera = IR if self.current == RGB else RGB
+        if ratio[next_camera] == 0:
+            next_camera = self.current
+        self.run_left = ratio[next_camera]
+        if next_camera == self.current:
+            return
+        stop, start = self.current, next_camera
+        self.current = next_camera
+        self.switching = True
+        self.switches += 1
+        # the switch task has the highest priority, its writes are the I2C time
+        self.push(now + self.args.isr_to_task_us + self.args.i2c_us // 2, 'sensor', stop, False)
+        self.push(now + self.args.isr_to_task_us + self.args.i2c_us, 'sensor', start, True)
+        self.push(now + self.args.isr_to_task_us + self.args.i2c_us, 'switch_done')
+
+    def on_sensor(self, now, sensor, on):
+        self.sensors.set(sensor, on, now)
+
+    # _camera_switch_task, after its writes
+    def on_switch_done(self, now):
+        self.discard_left = self.discard_frames
+        self.switching = False
+
+    # HAL_CameraDev_CsiSharedDualGC0308_Dequeue called by the camera manager for a delivered frame
+    def on_dequeue(self, now):
+        camera, frame = self.ready.pop(0)
+        self.deliver(now, camera, frame)
+        self.push(now + self.args.hold_us, 'release')
+
+    # the legacy frame done interrupt signals every frame, the camera manager dequeues it
+    def legacy_frame_done(self, now, frame):
+        self.full.append(frame)
+        start = max(now + self.args.isr_to_task_us, self.manager_free)
+        self.manager_free = start + self.args.manager_us
+        self.push(start, 'legacy_dequeue')
+
+    def on_legacy_dequeue(self, now):
+        frame = self.full.pop(0)
+        camera = self.current
+        if not self.valid:
+            # the first frame after a switch is dropped, whichever sensor it comes from
+            self.valid = True
+            self.discarded[camera] += 1
+            self.push(now + self.args.manager_us, 'release')
+            return
+        self.deliver(now, camera, frame)
+        self.push(now + self.args.hold_us, 'release')
+
+        # camera_shared_dual_switch blocks the camera manager for the I2C writes
+        stop, start = camera, 1 - camera
+        switch_start = max(now + self.args.manager_us, self.manager_free)
+        self.push(switch_start + self.args.i2c_us // 2, 'sensor', stop, False)
+        self.push(switch_start + self.args.i2c_us, 'sensor', start, True)
+        self.manager_free = switch_start + self.args.i2c_us
+        self.current = start
+        self.valid = False
+        self.switches += 1
+
+
+def report(name, sim, seconds, legacy_fps):
+    fps = [d / seconds for d in sim.delivered]
+    gain = ('%7.2fx' % (sum(fps) / legacy_fps)) if legacy_fps else '%8s' % '-'
+    print('%-22s %7.1f %7.1f %9d %9d %8d %6d %6d %s' % (name, fps[RGB], fps[IR], sim.discarded[RGB],
+                                                       sim.discarded[IR], sim.switches, sim.bad, sim.csi_drops, gain))
+    return fps
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Simulate the sensor timing of the shared dual GC0308 camera')
+    parser.add_argument('--ratio', type=parse_ratio, action='append',
+                        help='RGB:IR frames of the scheduler, default the idle ratio of app_config.h and a few others')
+    parser.add_argument('--face-at-s', type=float, help='the vision algorithm reports a face at this time')
+    parser.add_argument('--face-ratio', type=parse_ratio, help='RGB:IR frames with a face, default app_config.h')
+    parser.add_argument('--duration-s', type=float, default=30.0)
+    parser.add_argument('--i2c-us', type=int, default=3000, help='sensor stop and start writes over I2C')
+    parser.add_argument('--isr-to-task-us', type=int, default=200, help='frame done interrupt to a task running')
+    parser.add_argument('--manager-us', type=int, default=2000, help='camera manager work for a frame')
+    parser.add_argument('--hold-us', type=int, default=20000, help='time the consumers hold a frame buffer')
+    parser.add_argument('--seed', type=int, default=1, help='phase of the sensor frame clocks')
+    parser.add_argument('--check', action='store_true', help='fail if the scheduler is slower than the legacy '
+                        'switch at 1:1 or delivers a mixed frame')
+    args = parser.parse_args()
+
+    config = read_config()
+    idle = (config['IDLE_RGB_FRAMES'], config['IDLE_IR_FRAMES'])
+    face = args.face_ratio or (config['FACE_RGB_FRAMES'], config['FACE_IR_FRAMES'])
+    ratios = args.ratio or [idle] + [r for r in ((1, 1), (2, 1), (1, 2), (0, 1)) if r != idle]
+    duration_us = int(args.duration_s * 1000000)
+    face_at_us = int(args.face_at_s * 1000000) if args.face_at_s is not None else None
+
+    print('%d fps sensors, %d frame buffers, %d frame dropped after a switch, I2C switch %d us'
+          % (config['FPS'], config['BUFFER_COUNT'], config['DISCARD_FRAMES'], args.i2c_us))
+    print('%-22s %7s %7s %9s %9s %8s %6s %6s %8s' % ('schedule', 'RGB fps', 'IR fps', 'RGB drop', 'IR drop',
+                                                     'switches', 'bad', 'lost', 'vs old'))
+
+    legacy = Sim(args, config, True, [(1, 1), (1, 1)], random.Random(args.seed)).run(duration_us)
+    legacy_fps = sum(report('legacy 1:1', legacy, args.duration_s, 0))
+
+    failed = False
+    for ratio in ratios:
+        sim = Sim(args, config, False, [ratio, face], random.Random(args.seed)).run(duration_us, face_at_us)
+        name = 'scheduler %d:%d' % ratio
+        if face_at_us is not None:
+            name += ' face %d:%d' % face
+        report(name, sim, args.duration_s, legacy_fps)
+        if face_at_us is not None:
+            print('%22s first RGB frame %s, first IR frame %s after the face' % ('', *(
+                ('%.0f ms' % (t / 1000.0)) if t is not None else 'never' for t in sim.first_after_face)))
+        if sim.bad:
+            failed = True
+        # the phase of the sensors moves the frames of a run by one, at the end of the run
+        if ratio == (1, 1) and sum(sim.delivered) + 2 < sum(legacy.delivered):
+            failed = True
+
+    if args.check and failed:
+        print('FAIL: the scheduler is slower than the legacy switch or delivered a mixed frame')
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
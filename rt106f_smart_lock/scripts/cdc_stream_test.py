@@ -0,0 +1,335 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Round trip the frame stream of the usb cdc display on a host. hal_display_usb_cdc_stream.c is built with the host
+# compiler and loaded with ctypes, frames are encoded with HAL_CdcStream_Encode and decoded both with
+# HAL_CdcStream_Decode and with the decoder of cdc_stream_viewer.py.
+#
+# exact:    built with CDC_STREAM_THRESHOLD 0, every decoded frame must be the source frame
+# settled:  built with the default threshold, a frame repeated must decode to the source, the sensor noise must cost
+#           less than a key frame
+# lz:       HAL_CdcStream_Compress and both decompressors on random and repetitive buffers
+# recovery: a key frame request and an output too small for the frame
+#
+# python3 cdc_stream_test.py              run all the cases, exit 1 if one fails
+# python3 cdc_stream_test.py --frames 500 --seed 7
+
+import argparse
+import ctypes
+import os
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+
+SCRIPTS_DIR = os.path.dirname(os.path.abspath(__file__))
+DISPLAY_DIR = os.path.join(SCRIPTS_DIR, '..', 'sln_framework', 'hal', 'display')
+sys.path.insert(0, SCRIPTS_DIR)
+import cdc_stream_viewer as viewer  # noqa: E402
+
+TILE = 16
+MAX_BPP = 3
+HASH_BITS = 10
+TILE_PARTS = 4
+HEADER_SIZE = 26
+
+# width, height, bytes per pixel, odd sizes leave partial tiles on the right and at the bottom
+SHAPES = [(64, 48, 1), (37, 23, 2), (50, 33, 3)]
+
+PROBE = r'''
+#include <stddef.h>
+#include <stdio.h>
+#include "hal_display_usb_cdc_stream.h"
+int main(void)
+{
+    printf("%u %u %u %u\n", (unsigned)sizeof(cdc_stream_encoder_t),
+           (unsigned)offsetof(cdc_stream_encoder_t, keyRequested), (unsigned)sizeof(cdc_stream_tile_t),
+           (unsigned)sizeof(cdc_stream_frame_info_t));
+    return 0;
+}
+'''
+
+
+class Tile(ctypes.Structure):
+    _fields_ = [('sentHash', ctypes.c_uint32), ('lastHash', ctypes.c_uint32),
+                ('sums', ctypes.c_uint16 * TILE_PARTS)]
+
+
+class Encoder(ctypes.Structure):
+    _fields_ = [('format', ctypes.c_uint8), ('srcFormat', ctypes.c_uint8), ('width', ctypes.c_int),
+                ('height', ctypes.c_int), ('pitch', ctypes.c_int), ('bytesPerPixel', ctypes.c_int),
+                ('tilesX', ctypes.c_int), ('tilesY', ctypes.c_int), ('pTiles', ctypes.POINTER(Tile)),
+                ('sinceKey', ctypes.c_uint32), ('keyRequested', ctypes.c_bool),
+                ('tile', ctypes.c_uint8 * (TILE * TILE * MAX_BPP)), ('hash', ctypes.c_uint16 * (1 << HASH_BITS))]
+
+
+class FrameInfo(ctypes.Structure):
+    _fields_ = [('format', ctypes.c_uint8), ('srcFormat', ctypes.c_uint8), ('version', ctypes.c_uint8),
+                ('width', ctypes.c_uint32), ('height', ctypes.c_uint32), ('sequence', ctypes.c_uint32),
+                ('payloadSize', ctypes.c_uint32), ('tileSize', ctypes.c_uint8), ('bytesPerPixel', ctypes.c_uint8),
+                ('flags', ctypes.c_uint8)]
+
+
+def build(workdir, name, defines):
+    '''Build the codec as a shared library, check the ctypes layouts against the compiler's'''
+    flags = ['-O2', '-Wall', '-I', DISPLAY_DIR] + ['-D%s' % d for d in defines]
+    lib = os.path.join(workdir, name + '.so')
+    probe = os.path.join(workdir, name + '_probe')
+    subprocess.check_call([CC, '-shared', '-fPIC', '-o', lib,
+                           os.path.join(DISPLAY_DIR, 'hal_display_usb_cdc_stream.c')] + flags)
+    subprocess.run([CC, '-x', 'c', '-', '-o', probe] + flags, input=PROBE.encode(), check=True)
+    layout = [int(v) for v in subprocess.check_output([probe]).split()]
+    expected = [ctypes.sizeof(Encoder), Encoder.keyRequested.offset, ctypes.sizeof(Tile), ctypes.sizeof(FrameInfo)]
+    if layout != expected:
+        raise SystemExit('%s: the structures of hal_display_usb_cdc_stream.h changed, %s != %s'
+                         % (name, layout, expected))
+
+    codec = ctypes.CDLL(lib)
+    codec.HAL_CdcStream_Compress.restype = ctypes.c_uint32
+    codec.HAL_CdcStream_Compress.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.c_char_p, ctypes.c_uint32,
+                                             ctypes.POINTER(ctypes.c_uint16)]
+    codec.HAL_CdcStream_Decompress.restype = ctypes.c_int32
+    codec.HAL_CdcStream_Decompress.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.c_char_p, ctypes.c_uint32]
+    codec.HAL_CdcStream_EncoderInit.argtypes = [ctypes.POINTER(Encoder), ctypes.c_uint8, ctypes.c_uint8,
+                                                ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                                ctypes.POINTER(Tile)]
+    codec.HAL_CdcStream_Encode.restype = ctypes.c_uint32
+    codec.HAL_CdcStream_Encode.argtypes = [ctypes.POINTER(Encoder), ctypes.c_char_p, ctypes.c_uint32,
+                                           ctypes.c_char_p, ctypes.c_uint32, ctypes.POINTER(ctypes.c_bool)]
+    codec.HAL_CdcStream_ParseHeader.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.POINTER(FrameInfo)]
+    codec.HAL_CdcStream_Decode.argtypes = [ctypes.POINTER(FrameInfo), ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int]
+    return codec
+
+
+class Stream:
+    '''An encoder and the two decoders, the C one and the one of the viewer'''
+
+    def __init__(self, codec, width, height, bpp):
+        self.codec = codec
+        self.width = width
+        self.height = height
+        self.bpp = bpp
+        tiles = ((width + TILE - 1) // TILE) * ((height + TILE - 1) // TILE)
+        self.tiles = (Tile * tiles)()
+        self.encoder = Encoder()
+        self.out_size = HEADER_SIZE + (tiles + 7) // 8 + tiles * 2 + width * height * bpp
+        self.out = ctypes.create_string_buffer(self.out_size)
+        self.c_frame = ctypes.create_string_buffer(width * height * bpp)
+        self.py_frame = bytearray(width * height * bpp)
+        self.sequence = 0
+        if codec.HAL_CdcStream_EncoderInit(ctypes.byref(self.encoder), 5, 5, width, height, width * bpp, bpp,
+                                           self.tiles) != 0:
+            raise SystemExit('HAL_CdcStream_EncoderInit failed for %dx%dx%d' % (width, height, bpp))
+
+    def send(self, frame, out_size=None):
+        '''Encode and decode a frame, return the message size and the key flag. Raise ValueError on a decoder
+        mismatch'''
+        key = ctypes.c_bool(False)
+        size = self.codec.HAL_CdcStream_Encode(ctypes.byref(self.encoder), bytes(frame), self.sequence, self.out,
+                                               out_size or self.out_size, ctypes.byref(key))
+        self.encoder.keyRequested = self.encoder.keyRequested and not key.value
+        if size == 0:
+            return 0, False
+        message = self.out.raw[:size]
+
+        info = FrameInfo()
+        if self.codec.HAL_CdcStream_ParseHeader(message, size, ctypes.byref(info)) != 0 or \
+                info.sequence != self.sequence or bool(info.flags & viewer.FLAG_KEY) != key.value:
+            raise ValueError('frame %d: bad header' % self.sequence)
+        self.sequence += 1
+
+        payload = message[HEADER_SIZE:]
+        if info.payloadSize != len(payload):
+            raise ValueError('frame %d: payload of %d bytes, %d sent' % (info.sequence, info.payloadSize,
+                                                                         len(payload)))
+        if self.codec.HAL_CdcStream_Decode(ctypes.byref(info), payload, self.c_frame, self.width * self.bpp) != 0:
+            raise ValueError('frame %d: HAL_CdcStream_Decode failed' % info.sequence)
+        viewer.apply_tiles(self.py_frame, self.width, self.height, self.bpp, info.tileSize, payload)
+        if self.c_frame.raw != bytes(self.py_frame):
+            raise ValueError('frame %d: the decoders disagree' % info.sequence)
+        return size, key.value
+
+    def decoded(self):
+        return bytes(self.py_frame)
+
+
+class Scene:
+    '''Frames with the changes seen on the display: boxes, thin lines, single pixels and the sensor noise'''
+
+    def __init__(self, width, height, bpp, rng):
+        self.width = width
+        self.height = height
+        self.bpp = bpp
+        self.rng = rng
+        self.frame = bytearray(rng.randrange(256) for _ in range(width * height * bpp))
+
+    def set(self, x, y, value):
+        pos = (y * self.width + x) * self.bpp
+        self.frame[pos:pos + self.bpp] = value
+
+    def box(self):
+        x0, y0 = self.rng.randrange(self.width), self.rng.randrange(self.height)
+        x1, y1 = self.rng.randrange(x0, self.width) + 1, self.rng.randrange(y0, self.height) + 1
+        value = bytes(self.rng.randrange(256) for _ in range(self.bpp))
+        for y in range(y0, y1):
+            for x in range(x0, x1):
+                self.set(x, y, value)
+
+    def line(self):
+        value = bytes(self.rng.randrange(256) for _ in range(self.bpp))
+        if self.rng.random() < 0.5:
+            y = self.rng.randrange(self.height)
+            for x in range(self.width):
+                self.set(x, y, value)
+        else:
+            x = self.rng.randrange(self.width)
+            for y in range(self.height):
+                self.set(x, y, value)
+
+    def pixels(self):
+        # a step of 1 moves a quarter sum by less than any threshold
+        for _ in range(self.rng.randrange(1, 4)):
+            pos = self.rng.randrange(len(self.frame))
+            self.frame[pos] = (self.frame[pos] + self.rng.choice((-1, 1))) & 0xFF
+
+    def noise(self, frame):
+        # +-1 on a byte out of 4, the static frame is kept
+        noisy = bytearray(frame)
+        for pos in range(0, len(noisy), 4):
+            noisy[pos] = min(255, max(0, noisy[pos] + self.rng.choice((-1, 0, 1))))
+        return noisy
+
+    def step(self):
+        self.rng.choice((self.box, self.line, self.pixels, self.pixels))()
+        return bytes(self.frame)
+
+
+def case_exact(codec, args, rng):
+    failures = 0
+    for width, height, bpp in SHAPES:
+        stream = Stream(codec, width, height, bpp)
+        scene = Scene(width, height, bpp, rng)
+        wrong = 0
+        for _ in range(args.frames):
+            frame = scene.step()
+            stream.send(frame)
+            wrong += stream.decoded() != frame
+        print('exact    %2dx%-2d %d bpp: %d of %d frames decoded differently' % (width, height, bpp, wrong,
+                                                                                   args.frames))
+        failures += wrong != 0
+    return failures
+
+
+def case_settled(codec, args, rng):
+    failures = 0
+    for width, height, bpp in SHAPES:
+        stream = Stream(codec, width, height, bpp)
+        scene = Scene(width, height, bpp, rng)
+        key_size = stream.send(scene.step())[0]
+        stale = 0
+        noise_bytes = 0
+        for _ in range(args.frames):
+            frame = scene.step()
+            stream.send(frame)
+            # the change holds still for a frame, the host must have it then
+            stream.send(frame)
+            stale += stream.decoded() != frame
+        for _ in range(args.frames):
+            noise_bytes += stream.send(scene.noise(frame))[0]
+        stream.send(frame)
+        stream.send(frame)
+        stale += stream.decoded() != frame
+        noise = noise_bytes / float(args.frames)
+        print('settled  %2dx%-2d %d bpp: %d of %d settled frames decoded differently, noise %.0f bytes per frame '
+              'for a %d bytes key frame' % (width, height, bpp, stale, args.frames + 1, noise, key_size))
+        failures += stale != 0 or noise >= key_size / 2
+    return failures
+
+
+def case_lz(codec, args, rng):
+    table = (ctypes.c_uint16 * (1 << HASH_BITS))()
+    failures = 0
+    buffers = [b'', b'a', bytes(12), bytes(13), bytes(4096), bytes(range(256)) * 16]
+    for _ in range(args.frames):
+        size = rng.randrange(1, 3 * TILE * TILE * MAX_BPP)
+        alphabet = rng.choice((2, 16, 256))
+        buffers.append(bytes(rng.randrange(alphabet) for _ in range(size)))
+    for data in buffers:
+        room = len(data) + len(data) // 255 + 16
+        out = ctypes.create_string_buffer(room)
+        size = codec.HAL_CdcStream_Compress(data, len(data), out, room, table)
+        back = ctypes.create_string_buffer(len(data) + 1)
+        if size == 0 or codec.HAL_CdcStream_Decompress(out.raw[:size], size, back, len(data)) != len(data) or \
+                back.raw[:len(data)] != data or bytes(viewer.lz_decompress(out.raw[:size], len(data))) != data:
+            failures += 1
+    print('lz       %d buffers, %d failed' % (len(buffers), failures))
+    return failures
+
+
+def case_recovery(codec, args, rng):
+    width, height, bpp = SHAPES[1]
+    stream = Stream(codec, width, height, bpp)
+    scene = Scene(width, height, bpp, rng)
+    failures = 0
+
+    stream.send(scene.step())
+    stream.encoder.keyRequested = True
+    failures += not stream.send(scene.step())[1]
+
+    # a frame which doesn't fit: nothing is sent and the next frame is a key frame
+    scene.box()
+    frame = scene.step()
+    failures += stream.send(frame, HEADER_SIZE + 1)[0] != 0
+    size, key = stream.send(frame)
+    failures += not key or stream.decoded() != frame
+
+    print('recovery %d failed' % failures)
+    return failures
+
+
+def main():
+    global CC
+    parser = argparse.ArgumentParser(description='Round trip the frame stream of the usb cdc display on a host')
+    parser.add_argument('--frames', type=int, default=200, help='frames per shape')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--cc', default=os.environ.get('CC', 'gcc'), help='host C compiler')
+    args = parser.parse_args()
+    CC = args.cc
+
+    workdir = tempfile.mkdtemp(prefix='cdc_stream_')
+    try:
+        exact = build(workdir, 'exact', ['CDC_STREAM_THRESHOLD=0', 'CDC_STREAM_KEY_INTERVAL=0'])
+        default = build(workdir, 'default', ['CDC_STREAM_KEY_INTERVAL=0'])
+        rng = random.Random(args.seed)
+        failures = case_exact(exact, args, rng)
+        failures += case_settled(default, args, rng)
+        failures += case_lz(default, args, rng)
+        failures += case_recovery(default, args, rng)
+    except ValueError as e:
+        print('FAIL: %s' % e)
+        return 1
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    if failures:
+        print('FAIL: %d cases failed' % failures)
+        return 1
+    print('PASS')
+    return 0
+
+
+CC = 'gcc'
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,382 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Show the frames of the usb cdc display (hal_display_usb_cdc.c) and acknowledge them. With DISPLAY_USB_CDC_STREAM
+# the lock sends raw frames until one is acknowledged, then the tiles changed since the previous frame, compressed
+# (hal_display_usb_cdc_stream.h), and sends the next frame once fewer than DISPLAY_USB_CDC_STREAM_WINDOW frames wait
+# for an acknowledgement. Without it the lock only sends raw frames, they are shown as well.
+#
+# A frame lost, cut short or not decoded, and a link silent for --timeout-s, are answered with a key frame request.
+#
+# Reads the virtual com port of the lock (pyserial) or replays a capture of it. Frames are shown with OpenCV when it
+# is installed, and written to a directory as PPM / PGM files with --out.
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+TU_MAGIC = b'\x53\x79\x4c'
+HEADER = struct.Struct('<3sBBBII')
+STREAM_HEADER = struct.Struct('<IIBBBx')
+
+STREAM_VERSION = 1
+FLAG_KEY = 0x01
+TILE_RAW = 0x8000
+LZ_MIN_MATCH = 4
+
+ACK = struct.Struct('<3scIB3x')
+ACK_TYPE = b'A'
+ACK_KEY_FRAME = 0x01
+
+# pixel_format_t of fwk_common.h
+FORMATS = ['RGB', 'RGB565', 'BGR', 'Gray888', 'Gray888X', 'Gray', 'Gray16', 'YUV1P444_RGB', 'YUV1P444_Gray',
+           'UYVY1P422_RGB', 'UYVY1P422_Gray', 'VYUY1P422', 'Depth16', 'Depth8', 'YUV420P']
+BYTES_PER_PIXEL = {'RGB': 3, 'RGB565': 2, 'BGR': 3, 'Gray888': 3, 'Gray888X': 4, 'Gray': 1, 'Gray16': 2,
+                   'YUV1P444_RGB': 3, 'YUV1P444_Gray': 3, 'UYVY1P422_RGB': 2, 'UYVY1P422_Gray': 2, 'VYUY1P422': 2,
+                   'Depth16': 2, 'Depth8': 1}
+
+# Larger frames are taken for a lost sync
+MAX_SIDE = 4096
+
+
+class DecodeError(Exception):
+    pass
+
+
+class LinkTimeout(Exception):
+    pass
+
+
+def lz_decompress(src, size):
+    '''LZ4 block of HAL_CdcStream_Compress, size bytes expected'''
+    out = bytearray()
+    pos = 0
+    end = len(src)
+
+    def length(value):
+        nonlocal pos
+        if value != 15:
+            return value
+        while True:
+            if pos >= end:
+                raise DecodeError('truncated length')
+            byte = src[pos]
+            pos += 1
+            value += byte
+            if byte != 255:
+                return value
+
+    while pos < end:
+        token = src[pos]
+        pos += 1
+        literals = length(token >> 4)
+        if pos + literals > end:
+            raise DecodeError('truncated literals')
+        out += src[pos:pos + literals]
+        pos += literals
+        if pos == end:
+            break
+        if pos + 2 > end:
+            raise DecodeError('truncated offset')
+        offset = src[pos] | (src[pos + 1] << 8)
+        pos += 2
+        if offset == 0 or offset > len(out):
+            raise DecodeError('bad offset')
+        match = length(token & 15) + LZ_MIN_MATCH
+        start = len(out) - offset
+        if match <= offset:
+            out += out[start:start + match]
+        else:
+            for i in range(match):
+                out.append(out[start + i])
+        if len(out) > size:
+            break
+    if len(out) != size:
+        raise DecodeError('tile of %d bytes, %d expected' % (len(out), size))
+    return out
+
+
+def apply_tiles(frame, width, height, bpp, tile, payload):
+    '''Rules of HAL_CdcStream_Decode: the tile map, then each tile sent'''
+    tiles_x = (width + tile - 1) // tile
+    tiles_y = (height + tile - 1) // tile
+    map_size = (tiles_x * tiles_y + 7) // 8
+    if len(payload) < map_size:
+        raise DecodeError('truncated tile map')
+    pitch = width * bpp
+    pos = map_size
+    sent = 0
+    for tile_y in range(tiles_y):
+        tile_height = min(tile, height - tile_y * tile)
+        for tile_x in range(tiles_x):
+            index = tile_y * tiles_x + tile_x
+            if not payload[index // 8] & (1 << (index % 8)):
+                continue
+            row_bytes = min(tile, width - tile_x * tile) * bpp
+            tile_size = row_bytes * tile_height
+            if pos + 2 > len(payload):
+                raise DecodeError('truncated tile')
+            size = payload[pos] | (payload[pos + 1] << 8)
+            pos += 2
+            raw = size & TILE_RAW
+            size &= ~TILE_RAW
+            if pos + size > len(payload):
+                raise DecodeError('truncated tile')
+            data = payload[pos:pos + size]
+            pos += size
+            if raw:
+                if size != tile_size:
+                    raise DecodeError('raw tile of %d bytes, %d expected' % (size, tile_size))
+            else:
+                data = lz_decompress(data, tile_size)
+            dst = tile_y * tile * pitch + tile_x * tile * bpp
+            for y in range(tile_height):
+                frame[dst:dst + row_bytes] = data[y * row_bytes:(y + 1) * row_bytes]
+                dst += pitch
+            sent += 1
+    if pos != len(payload):
+        raise DecodeError('%d bytes left after the tiles' % (len(payload) - pos))
+    return sent
+
+
+class Link:
+    '''Bytes from the lock and acknowledgements to it, recorded with --capture'''
+
+    def __init__(self, args):
+        self.port = None
+        self.capture = open(args.capture, 'wb') if args.capture else None
+        if args.replay:
+            self.src = open(args.replay, 'rb')
+        else:
+            import serial
+            self.port = serial.Serial(args.port, timeout=min(1.0, args.timeout_s))
+            self.src = self.port
+        self.timeout_s = args.timeout_s
+        self.received = 0
+
+    def read(self, size):
+        data = bytearray()
+        last = time.time()
+        while len(data) < size:
+            chunk = self.src.read(size - len(data))
+            if chunk:
+                data += chunk
+                last = time.time()
+            elif self.port is None:
+                raise EOFError
+            elif time.time() - last >= self.timeout_s:
+                # the rest of the frame is not coming, the caller syncs again on the next magic
+                self.keep(data)
+                raise LinkTimeout('%d of %d bytes received' % (len(data), size))
+        self.keep(data)
+        return data
+
+    def keep(self, data):
+        self.received += len(data)
+        if self.capture:
+            self.capture.write(data)
+
+    def sync(self):
+        '''Skip to the next magic, the bytes of a frame cut short are dropped'''
+        window = self.read(len(TU_MAGIC))
+        skipped = 0
+        while window != TU_MAGIC:
+            window = window[1:] + self.read(1)
+            skipped += 1
+        return skipped
+
+    def ack(self, sequence, flags):
+        if self.port is not None:
+            self.port.write(ACK.pack(TU_MAGIC, ACK_TYPE, sequence & 0xFFFFFFFF, flags))
+
+
+class Viewer:
+    def __init__(self, args):
+        self.args = args
+        self.frames = {}  # (format, width, height): frame, one per display device of the lock
+        self.cv2 = None
+        self.np = None
+        if not args.no_show:
+            try:
+                import cv2
+                import numpy
+                self.cv2, self.np = cv2, numpy
+            except ImportError:
+                if not args.out:
+                    print('OpenCV is not installed, write the frames with --out', file=sys.stderr)
+        self.count = 0
+
+    def show(self, fmt, width, height, frame):
+        self.count += 1
+        name = FORMATS[fmt] if fmt < len(FORMATS) else str(fmt)
+        if self.args.out and self.count % self.args.every == 0:
+            self.write(name, width, height, frame)
+        if self.cv2 is None:
+            return
+        np = self.np
+        bpp = len(frame) // (width * height)
+        image = np.frombuffer(bytes(frame), np.uint8)
+        if name in ('Gray16', 'Depth16'):
+            image = image.view('<u2').reshape(height, width)
+            image = (image.astype(np.float32) * (255.0 / max(1, int(image.max())))).astype(np.uint8)
+        elif name == 'RGB565':
+            image = self.cv2.cvtColor(image.reshape(height, width, 2), self.cv2.COLOR_BGR5652BGR)
+        else:
+            image = image.reshape(height, width, bpp) if bpp > 1 else image.reshape(height, width)
+            if name == 'RGB':
+                image = image[:, :, ::-1]
+            elif bpp == 4:
+                image = image[:, :, :3]
+        self.cv2.imshow('%s %dx%d' % (name, width, height), image)
+        if self.cv2.waitKey(1) & 0xFF == 27:
+            raise KeyboardInterrupt
+
+    def write(self, name, width, height, frame):
+        base = os.path.join(self.args.out, '%06d_%s' % (self.count, name))
+        bpp = len(frame) // (width * height)
+        if name in ('BGR', 'RGB', 'Gray888'):
+            rgb = bytearray(frame)
+            if name == 'BGR':
+                rgb[0::3], rgb[2::3] = frame[2::3], frame[0::3]
+            with open(base + '.ppm', 'wb') as f:
+                f.write(b'P6 %d %d 255\n' % (width, height) + rgb)
+        elif name in ('Gray', 'Depth8'):
+            with open(base + '.pgm', 'wb') as f:
+                f.write(b'P5 %d %d 255\n' % (width, height) + frame)
+        elif bpp == 2 and name in ('Gray16', 'Depth16'):
+            big = bytearray(frame)
+            big[0::2], big[1::2] = frame[1::2], frame[0::2]
+            with open(base + '.pgm', 'wb') as f:
+                f.write(b'P5 %d %d 65535\n' % (width, height) + big)
+        else:
+            with open(base + '.bin', 'wb') as f:
+                f.write(frame)
+
+
+def run(args, link, viewer, stats, start):
+    last_sequence = None
+    report = start
+    while True:
+        try:
+            last_sequence = receive(args, link, viewer, stats, last_sequence)
+        except LinkTimeout as e:
+            # a lost acknowledgement or a frame cut short, ask for a key frame to start again
+            if args.verbose:
+                print('link timed out, %s, key frame requested' % e)
+            stats['timeouts'] += 1
+            link.ack(0xFFFFFFFF if last_sequence is None else last_sequence, ACK_KEY_FRAME)
+
+        now = time.time()
+        if now - report >= args.report_s:
+            print_stats(stats, now - start)
+            report = now
+
+
+def receive(args, link, viewer, stats, last_sequence):
+    '''Read, show and acknowledge the next frame, return the sequence of the last stream frame'''
+    stats['skipped'] += link.sync()
+    fmt, src_fmt, version, width, height = HEADER.unpack_from(TU_MAGIC + link.read(HEADER.size - 3))[1:]
+    if not (0 < width <= MAX_SIDE and 0 < height <= MAX_SIDE) or version not in (0, STREAM_VERSION):
+        return last_sequence
+    key = (fmt, width, height)
+
+    if version == 0:
+        bpp = BYTES_PER_PIXEL.get(FORMATS[fmt] if fmt < len(FORMATS) else None)
+        if bpp is None:
+            return last_sequence
+        frame = link.read(width * height * bpp)
+        stats['frames'] += 1
+        stats['bytes'] += HEADER.size + len(frame)
+        stats['raw'] += len(frame)
+        viewer.show(fmt, width, height, frame)
+        # the lock streams once a frame is acknowledged, the raw frames carry no sequence
+        link.ack(0xFFFFFFFF if last_sequence is None else last_sequence, ACK_KEY_FRAME)
+    else:
+        sequence, size, tile, bpp, flags = STREAM_HEADER.unpack(link.read(STREAM_HEADER.size))
+        if size > width * height * (bpp + 1) + HEADER.size:
+            return last_sequence
+        payload = link.read(size)
+        frame = viewer.frames.get(key)
+        ack = 0
+        try:
+            lost = last_sequence is not None and sequence != (last_sequence + 1) & 0xFFFFFFFF
+            if lost and not flags & FLAG_KEY:
+                # the tiles of the frames lost are missing from this one
+                raise DecodeError('frames %d to %d lost' % ((last_sequence + 1) & 0xFFFFFFFF,
+                                                            (sequence - 1) & 0xFFFFFFFF))
+            if flags & FLAG_KEY or frame is None or len(frame) != width * height * bpp:
+                if not flags & FLAG_KEY:
+                    raise DecodeError('no key frame yet')
+                frame = bytearray(width * height * bpp)
+            stats['tiles'] += apply_tiles(frame, width, height, bpp, tile, payload)
+            viewer.frames[key] = frame
+        except DecodeError as e:
+            # the frame is partly applied, start again from a key frame
+            if args.verbose:
+                print('frame %d: %s, key frame requested' % (sequence, e))
+            viewer.frames.pop(key, None)
+            stats['errors'] += 1
+            ack = ACK_KEY_FRAME
+        last_sequence = sequence
+        link.ack(sequence, ack)
+        stats['frames'] += 1
+        stats['keys'] += 1 if flags & FLAG_KEY else 0
+        stats['bytes'] += HEADER.size + STREAM_HEADER.size + size
+        stats['raw'] += width * height * bpp
+        if not ack:
+            viewer.show(fmt, width, height, frame)
+    return last_sequence
+
+
+def print_stats(stats, seconds):
+    print('%d frames, %d key frames, %.1f fps, %.1f KB/s, %.1f KB per frame, %.1fx smaller than raw, '
+          '%d tiles, %d errors, %d timeouts, %d bytes skipped'
+          % (stats['frames'], stats['keys'], stats['frames'] / max(seconds, 1e-3),
+             stats['bytes'] / 1024.0 / max(seconds, 1e-3), stats['bytes'] / 1024.0 / max(1, stats['frames']),
+             stats['raw'] / max(1, stats['bytes']), stats['tiles'], stats['errors'], stats['timeouts'],
+             stats['skipped']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Show and acknowledge the frames of the usb cdc display')
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--port', help='virtual com port of the lock, COM5 or /dev/ttyACM0')
+    source.add_argument('--replay', help='capture to decode, nothing is acknowledged')
+    parser.add_argument('--capture', help='record the bytes received to this file')
+    parser.add_argument('--out', help='write the frames to this directory')
+    parser.add_argument('--every', type=int, default=1, help='write one frame out of this many')
+    parser.add_argument('--no-show', action='store_true', help="don't show the frames")
+    parser.add_argument('--timeout-s', type=float, default=1.0,
+                        help='seconds without data before a key frame is requested')
+    parser.add_argument('--report-s', type=float, default=2.0, help='seconds between two statistics lines')
+    parser.add_argument('-v', '--verbose', action='store_true', help='print the frames lost or not decoded')
+    args = parser.parse_args()
+
+    if args.out:
+        os.makedirs(args.out, exist_ok=True)
+    link = Link(args)
+    viewer = Viewer(args)
+    stats = {'frames': 0, 'keys': 0, 'tiles': 0, 'bytes': 0, 'raw': 0, 'errors': 0, 'timeouts': 0, 'skipped': 0}
+    start = time.time()
+    try:
+        run(args, link, viewer, stats, start)
+    except (EOFError, KeyboardInterrupt):
+        pass
+    print_stats(stats, time.time() - start)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
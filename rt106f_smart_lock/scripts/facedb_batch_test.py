@@ -0,0 +1,598 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Enroll users with BATCH_REGISTRATION_REQ over a loopback uart. The host client writes the chunks to one end of a
+# pseudo terminal, the lock side reads the other end into the receive parser (hal_input_ble_wuart_rx.c) and hands the
+# chunks to HAL_Facedb_AddUsersRemote (hal_sln_facedb.c) the way hal_input_ble_wuart_qn9090.c does. Both are built
+# with the host compiler and loaded with ctypes, FreeRTOS, the log and the flash file system are stubbed, the flash
+# keeps its files in RAM and counts the writes. The registration of OASISLT_registration_by_feature is modelled: a
+# feature equal to a database face is a duplicate.
+#
+# enroll:     users in several chunks, BLE_WUART_PACKET_POOL_COUNT chunks in flight. Every user gets its own id and
+#             nothing is written to flash before the last chunk, which commits the whole batch
+# duplicate:  records with the face of a user already enrolled, and twice the same new face in a batch
+# reregister: new faces for users found by name, and a name no user has
+# noise:      noise on the line between and before the chunks
+#
+# python3 facedb_batch_test.py              run all the cases, exit 1 if one fails
+# python3 facedb_batch_test.py --users 90   enroll more users in the first case, at most 100 in all
+
+import argparse
+import ctypes
+import os
+import random
+import select
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import tty
+import zlib
+
+SCRIPTS_DIR = os.path.dirname(os.path.abspath(__file__))
+HAL_DIR = os.path.join(SCRIPTS_DIR, '..', 'sln_framework', 'hal')
+INPUT_DIR = os.path.join(HAL_DIR, 'input')
+VISION_DIR = os.path.join(HAL_DIR, 'vision')
+
+sys.path.insert(0, SCRIPTS_DIR)
+import wuart_rx_test as rx_test  # noqa: E402
+
+BATCH_REGISTRATION_REQ = 24
+BATCH_REGISTRATION_RES = 25
+BATCH_REREGISTER = 1 << 16
+BATCH_LAST = 1 << 17
+ACK_SUCCESS = 0
+ACK_ERROR = 0xFFFFFFFF
+
+# hal_input_ble_wuart_qn9090.c, hal_event_descriptor_face_rec.h and hal_sln_facedb.h
+POOL_COUNT = 2
+MAX_RECORDS = 8
+NAME_LEN = 32
+MAX_FACE_DB_SIZE = 100
+INVALID_ID = 0xFFFF
+FACE_ITEM_SIZE = 128
+
+# oasislite2D_runtime.h
+REG_OK, REG_DUP = 0, 1
+REG_INVALID = 0xFF
+
+RECORD = struct.Struct('<BBH')
+
+STUBS = {
+    'board_define.h': '''
+#define ENABLE_FACEDB
+#define OASIS_FACE_DB_DIR "faceDB"
+''',
+    'FreeRTOS.h': '''
+#include <stdlib.h>
+#include <string.h>
+#define pvPortMalloc  malloc
+#define vPortFree     free
+#define portMAX_DELAY 0xFFFFFFFFU
+#define pdTRUE        1
+typedef int *SemaphoreHandle_t;
+/* newlib */
+char *itoa(int value, char *str, int base);
+''',
+    # a mutex taken twice would block the lock forever, here the second take fails
+    'semphr.h': '''
+extern int g_StubMutex;
+#define xSemaphoreCreateMutex()  (&g_StubMutex)
+#define xSemaphoreTake(s, ticks) ((*(s) == 0) ? (*(s) = 1) : 0)
+#define xSemaphoreGive(s)        (*(s) = 0)
+''',
+    'fwk_log.h': '''
+#define LOGD(...)
+#define LOGI(...)
+#define LOGE(...)
+''',
+    'hal_flash_dev.h': '''
+#ifndef _HAL_FLASH_DEV_H_
+#define _HAL_FLASH_DEV_H_
+typedef enum _sln_flash_status
+{
+    kStatus_HAL_FlashSuccess,
+    kStatus_HAL_FlashFail,
+    kStatus_HAL_FlashDirExist,
+    kStatus_HAL_FlashFileNotExist,
+} sln_flash_status_t;
+#endif
+''',
+    'fwk_flash.h': '''
+#include <stdbool.h>
+#include "hal_flash_dev.h"
+sln_flash_status_t FWK_Flash_Save(const char *path, void *buf, unsigned int size);
+sln_flash_status_t FWK_Flash_Append(const char *path, void *buf, unsigned int size, bool overwrite);
+sln_flash_status_t FWK_Flash_Read(const char *path, void *buf, unsigned int offset, unsigned int *size);
+sln_flash_status_t FWK_Flash_Rm(const char *path);
+sln_flash_status_t FWK_Flash_Mkdir(const char *path);
+''',
+    'stub_flash.c': r'''
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fwk_flash.h"
+
+#define STUB_FILES 256
+
+typedef struct
+{
+    char path[64];
+    unsigned char *data;
+    unsigned int size;
+} stub_file_t;
+
+static stub_file_t s_Files[STUB_FILES];
+int g_StubMutex;
+unsigned int g_StubFlashWrites;
+
+static stub_file_t *_find(const char *path, int create)
+{
+    stub_file_t *empty = NULL;
+    for (int i = 0; i < STUB_FILES; i++)
+    {
+        if (s_Files[i].path[0] == '\0')
+        {
+            empty = (empty == NULL) ? &s_Files[i] : empty;
+        }
+        else if (!strcmp(s_Files[i].path, path))
+        {
+            return &s_Files[i];
+        }
+    }
+    if (create && (empty != NULL))
+    {
+        strncpy(empty->path, path, sizeof(empty->path) - 1);
+        return empty;
+    }
+    return NULL;
+}
+
+char *itoa(int value, char *str, int base)
+{
+    sprintf(str, "%d", value);
+    return str;
+}
+
+sln_flash_status_t FWK_Flash_Mkdir(const char *path)
+{
+    return kStatus_HAL_FlashSuccess;
+}
+
+sln_flash_status_t FWK_Flash_Append(const char *path, void *buf, unsigned int size, bool overwrite)
+{
+    stub_file_t *file = _find(path, 1);
+    unsigned int start;
+    if (file == NULL)
+    {
+        return kStatus_HAL_FlashFail;
+    }
+    start      = overwrite ? 0 : file->size;
+    file->data = realloc(file->data, start + size);
+    memcpy(file->data + start, buf, size);
+    file->size = start + size;
+    g_StubFlashWrites++;
+    return kStatus_HAL_FlashSuccess;
+}
+
+sln_flash_status_t FWK_Flash_Save(const char *path, void *buf, unsigned int size)
+{
+    return FWK_Flash_Append(path, buf, size, true);
+}
+
+sln_flash_status_t FWK_Flash_Read(const char *path, void *buf, unsigned int offset, unsigned int *size)
+{
+    stub_file_t *file = _find(path, 0);
+    if (file == NULL)
+    {
+        return kStatus_HAL_FlashFileNotExist;
+    }
+    if (offset + *size > file->size)
+    {
+        *size = (offset < file->size) ? file->size - offset : 0;
+    }
+    memcpy(buf, file->data + offset, *size);
+    return kStatus_HAL_FlashSuccess;
+}
+
+sln_flash_status_t FWK_Flash_Rm(const char *path)
+{
+    stub_file_t *file = _find(path, 0);
+    if (file == NULL)
+    {
+        return kStatus_HAL_FlashFileNotExist;
+    }
+    free(file->data);
+    memset(file, 0, sizeof(*file));
+    g_StubFlashWrites++;
+    return kStatus_HAL_FlashSuccess;
+}
+''',
+}
+
+PROBE = r'''
+#include <stddef.h>
+#include <stdio.h>
+#include "hal_input_ble_wuart_rx.h"
+#include "hal_event_descriptor_face_rec.h"
+int main(void)
+{
+    printf("%u %u %u %u %u %u %u\n", (unsigned)sizeof(hal_ble_wuart_packet_buf_t),
+           (unsigned)offsetof(hal_ble_wuart_packet_buf_t, data), (unsigned)sizeof(hal_ble_wuart_rx_t),
+           (unsigned)offsetof(remote_reg_data_t, facedata), (unsigned)sizeof(remote_batch_reg_event_t),
+           (unsigned)sizeof(remote_batch_reg_record_t), (unsigned)sizeof(remote_batch_reg_result_t));
+    return 0;
+}
+'''
+
+
+class BatchEvent(ctypes.Structure):
+    _fields_ = [('isReRegister', ctypes.c_uint32), ('isLast', ctypes.c_uint32), ('count', ctypes.c_uint32),
+                ('dataLen', ctypes.c_uint32), ('regData', ctypes.c_void_p)]
+
+
+class BatchRecord(ctypes.Structure):
+    _fields_ = [('result', ctypes.c_uint8), ('reserved', ctypes.c_uint8), ('id', ctypes.c_uint16)]
+
+
+class BatchResult(ctypes.Structure):
+    _fields_ = [('count', ctypes.c_uint32), ('committed', ctypes.c_uint32), ('records', ctypes.POINTER(BatchRecord))]
+
+
+REGISTER = ctypes.CFUNCTYPE(ctypes.c_uint8, ctypes.c_void_p, ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint16))
+
+
+def build(workdir):
+    '''Build the parser and the database as a shared library, check the ctypes layouts against the compiler's'''
+    stub_dir = os.path.join(workdir, 'stubs')
+    os.mkdir(stub_dir)
+    for name, text in STUBS.items():
+        with open(os.path.join(stub_dir, name), 'w') as f:
+            f.write(text)
+
+    # the codec path gcc warns about is not taken with FACEDB_CODEC_RAW
+    flags = ['-O2', '-Wall', '-Wno-cpp', '-Wno-stringop-overflow', '-Wno-array-bounds', '-I', stub_dir,
+             '-I', INPUT_DIR, '-I', HAL_DIR, '-I', VISION_DIR, '-DBLE_WUART_PACKET_MAX_LEN=%d' % rx_test.PACKET_MAX_LEN]
+    lib = os.path.join(workdir, 'facedb_batch.so')
+    probe = os.path.join(workdir, 'facedb_batch_probe')
+    sources = [os.path.join(INPUT_DIR, 'hal_input_ble_wuart_rx.c'), os.path.join(VISION_DIR, 'hal_sln_facedb.c'),
+               os.path.join(stub_dir, 'stub_flash.c')]
+    subprocess.check_call([CC, '-shared', '-fPIC', '-o', lib] + sources + flags)
+    subprocess.run([CC, '-x', 'c', '-', '-o', probe] + flags, input=PROBE.encode(), check=True)
+    layout = [int(v) for v in subprocess.check_output([probe]).split()]
+    expected = [ctypes.sizeof(rx_test.PacketBuf), rx_test.PacketBuf.data.offset, ctypes.sizeof(rx_test.Rx), NAME_LEN,
+                ctypes.sizeof(BatchEvent), ctypes.sizeof(BatchRecord), ctypes.sizeof(BatchResult)]
+    if layout != expected:
+        raise SystemExit('the structures of the headers changed, %s != %s' % (layout, expected))
+
+    lock = ctypes.CDLL(lib)
+    lock.HAL_BleWuartRx_Init.argtypes = [ctypes.POINTER(rx_test.Rx), rx_test.ACQUIRE, rx_test.RELEASE,
+                                         rx_test.EVENT, ctypes.c_void_p]
+    lock.HAL_BleWuartRx_Feed.restype = ctypes.c_uint32
+    lock.HAL_BleWuartRx_Feed.argtypes = [ctypes.POINTER(rx_test.Rx), ctypes.c_char_p, ctypes.c_uint32,
+                                         ctypes.POINTER(ctypes.POINTER(rx_test.PacketBuf))]
+    lock.HAL_Facedb_Init.argtypes = [ctypes.c_uint16]
+    lock.HAL_Facedb_AddUsersRemote.argtypes = [ctypes.POINTER(BatchEvent), ctypes.c_uint32, REGISTER,
+                                               ctypes.POINTER(BatchResult)]
+    lock.HAL_Facedb_GetIds.argtypes = [ctypes.POINTER(ctypes.c_uint16)]
+    lock.HAL_Facedb_GetFace.argtypes = [ctypes.c_uint16, ctypes.POINTER(ctypes.c_void_p)]
+    lock.HAL_Facedb_GenId.argtypes = [ctypes.POINTER(ctypes.c_uint16)]
+    lock.HAL_Facedb_AddFace.argtypes = [ctypes.c_uint16, ctypes.c_char_p, ctypes.c_void_p, ctypes.c_int]
+    lock.HAL_Facedb_UpdateFace.argtypes = [ctypes.c_uint16, ctypes.c_char_p, ctypes.c_void_p, ctypes.c_int]
+    lock.HAL_Facedb_GetName.restype = ctypes.c_char_p
+    lock.HAL_Facedb_GetName.argtypes = [ctypes.c_uint16]
+    lock.HAL_Facedb_GetSaveStatus.restype = ctypes.c_bool
+    lock.HAL_Facedb_GetSaveStatus.argtypes = [ctypes.c_uint16]
+    return lock
+
+
+class Lock(threading.Thread):
+    '''Lock side of the uart, the rules of the BATCH_REGISTRATION_REQ handling of hal_input_ble_wuart_qn9090.c'''
+
+    def __init__(self, lib, fd):
+        super().__init__(daemon=True)
+        self.lib = lib
+        self.fd = fd
+        self.receiver = rx_test.Receiver(lib, POOL_COUNT)
+        self.register_cb = REGISTER(self.register)
+        self.responses = []  # (packet id, flash writes, all the faces saved) at each response
+        self.errors = []
+        self.running = True
+
+    def flash_writes(self):
+        return ctypes.c_uint.in_dll(self.lib, 'g_StubFlashWrites').value
+
+    def faces(self):
+        ids = (ctypes.c_uint16 * MAX_FACE_DB_SIZE)()
+        self.lib.HAL_Facedb_GetIds(ids)
+        return {ids[i]: self.face(ids[i]) for i in range(self.lib.HAL_Facedb_GetCount())}
+
+    def face(self, face_id):
+        pointer = ctypes.c_void_p()
+        if self.lib.HAL_Facedb_GetFace(face_id, ctypes.byref(pointer)) != 0:
+            return None
+        return ctypes.string_at(pointer.value, FACE_ITEM_SIZE)
+
+    # _oasis_lite_RegisterRemoteFace around OASISLT_registration_by_feature and its database callbacks
+    def register(self, face, name, p_id):
+        if name is None and p_id[0] == INVALID_ID:
+            return REG_INVALID
+        feature = ctypes.string_at(face, FACE_ITEM_SIZE)
+        for face_id, stored in self.faces().items():
+            if stored == feature and (name is not None or face_id != p_id[0]):
+                p_id[0] = face_id
+                return REG_DUP
+        if name is None:
+            # _oasis_lite_UpdateFace
+            if self.lib.HAL_Facedb_UpdateFace(p_id[0], self.lib.HAL_Facedb_GetName(p_id[0]), face, FACE_ITEM_SIZE):
+                return REG_INVALID
+            return REG_OK
+        # _oasis_lite_AddFace
+        new_id = ctypes.c_uint16(INVALID_ID)
+        if self.lib.HAL_Facedb_GenId(ctypes.byref(new_id)) != 0 or new_id.value == INVALID_ID:
+            return REG_INVALID
+        if self.lib.HAL_Facedb_AddFace(new_id, ctypes.string_at(name), face, FACE_ITEM_SIZE) != 0:
+            return REG_INVALID
+        p_id[0] = new_id.value
+        return REG_OK
+
+    def handle(self, packet):
+        header = packet.header
+        if header.pktType != BATCH_REGISTRATION_REQ:
+            self.errors.append('unexpected packet type %d' % header.pktType)
+            return
+        event = BatchEvent(1 if header.reserved & BATCH_REREGISTER else 0, 1 if header.reserved & BATCH_LAST else 0,
+                           header.reserved & 0xFFFF, header.pktLen, ctypes.addressof(packet.data))
+        records = (BatchRecord * MAX_RECORDS)()
+        result = BatchResult(0, 0, records)
+        status = self.lib.HAL_Facedb_AddUsersRemote(ctypes.byref(event), FACE_ITEM_SIZE, self.register_cb,
+                                                    ctypes.byref(result))
+        if ctypes.c_int.in_dll(self.lib, 'g_StubMutex').value:
+            self.errors.append('the database lock is still taken after packet %d' % header.pktId)
+        self.responses.append((header.pktId, self.flash_writes(), self.lib.HAL_Facedb_GetSaveStatus(INVALID_ID)))
+        body = ctypes.string_at(records, result.count * ctypes.sizeof(BatchRecord))
+        os.write(self.fd, rx_test.transfer_unit(BATCH_REGISTRATION_RES, body, header.pktId,
+                                                reserved=ACK_SUCCESS if status == 0 else ACK_ERROR))
+
+    def run(self):
+        out = ctypes.POINTER(rx_test.PacketBuf)()
+        while self.running:
+            if not select.select([self.fd], [], [], 0.05)[0]:
+                continue
+            data = os.read(self.fd, 4096)
+            while data:
+                used = self.lib.HAL_BleWuartRx_Feed(ctypes.byref(self.receiver.rx), data, len(data), ctypes.byref(out))
+                data = data[used:]
+                if out:
+                    # SLN_BLEWUARTPacketRelease once the vision algorithm responded
+                    self.handle(out.contents)
+                    self.receiver.release(None, out)
+
+
+class BatchClient:
+    '''Host side, enrolls records of a name and a face feature with BATCH_REGISTRATION_REQ'''
+
+    def __init__(self, fd, window=POOL_COUNT, timeout=5.0, noise=None):
+        self.fd = fd
+        self.window = window
+        self.timeout = timeout
+        self.noise = noise
+        self.pkt_id = 0
+        self.buffer = b''
+
+    def send(self, chunk, reserved):
+        self.pkt_id += 1
+        body = b''.join(name.encode().ljust(NAME_LEN, b'\0')[:NAME_LEN - 1] + b'\0' + face for name, face in chunk)
+        if self.noise:
+            os.write(self.fd, self.noise())
+        os.write(self.fd, rx_test.transfer_unit(BATCH_REGISTRATION_REQ, body, self.pkt_id,
+                                                reserved=reserved | len(chunk)))
+        return self.pkt_id
+
+    def receive(self):
+        '''Next response as (packet id, ack, body)'''
+        while True:
+            start = self.buffer.find(rx_test.TU_MAGIC)
+            if start >= 0 and len(self.buffer) - start >= rx_test.HEADER_LENGTH:
+                magic, pkt_type, length, pkt_id, crc, reserved = rx_test.HEADER.unpack_from(self.buffer, start)
+                end = start + rx_test.HEADER_LENGTH + length
+                if len(self.buffer) >= end:
+                    body = self.buffer[start + rx_test.HEADER_LENGTH:end]
+                    self.buffer = self.buffer[end:]
+                    if pkt_type != BATCH_REGISTRATION_RES or (length and zlib.crc32(body) != crc):
+                        raise ValueError('bad response to packet %d' % pkt_id)
+                    return pkt_id, reserved, body
+            if not select.select([self.fd], [], [], self.timeout)[0]:
+                raise TimeoutError('no response from the lock')
+            self.buffer += os.read(self.fd, 4096)
+
+    def enroll(self, records, reregister=False):
+        '''Return the (result, id) of every record and whether the lock committed the batch'''
+        chunks = [records[i:i + MAX_RECORDS] for i in range(0, len(records), MAX_RECORDS)]
+        sent = {}
+        results = {}
+        acks = {}
+        next_chunk = 0
+        while len(results) < len(chunks):
+            while next_chunk < len(chunks) and len(sent) - len(results) < self.window:
+                reserved = (BATCH_REREGISTER if reregister else 0) | \
+                    (BATCH_LAST if next_chunk == len(chunks) - 1 else 0)
+                sent[self.send(chunks[next_chunk], reserved)] = next_chunk
+                next_chunk += 1
+            pkt_id, ack, body = self.receive()
+            index = sent[pkt_id]
+            acks[index] = ack
+            results[index] = [RECORD.unpack_from(body, i) for i in range(0, len(body), RECORD.size)]
+            if ack == ACK_ERROR:
+                break
+        flat = []
+        for index in sorted(results):
+            flat += [(result, face_id) for result, _, face_id in results[index]]
+        return flat, acks.get(len(chunks) - 1) == ACK_SUCCESS
+
+
+def faces(rng, count):
+    return [bytes(rng.getrandbits(8) for _ in range(FACE_ITEM_SIZE)) for _ in range(count)]
+
+
+def check(name, failures):
+    print('%-10s %s' % (name, 'ok' if not failures else 'FAILED'))
+    for failure in failures:
+        print('    ' + failure)
+    return 1 if failures else 0
+
+
+def case_enroll(lock, client, args, rng):
+    records = [('user%03d' % i, face) for i, face in enumerate(faces(rng, args.users))]
+    first_response = len(lock.responses)
+    writes = lock.flash_writes()
+    results, committed = client.enroll(records)
+    failures = []
+    if [r for r, _ in results] != [REG_OK] * len(records):
+        failures.append('results %s' % [r for r, _ in results])
+    ids = [i for _, i in results]
+    if len(set(ids)) != len(ids):
+        failures.append('ids %s' % ids)
+    for (name, face), face_id in zip(records, ids):
+        if lock.lib.HAL_Facedb_GetName(face_id) != name.encode() or lock.face(face_id) != face:
+            failures.append('user %s not stored under id %d' % (name, face_id))
+            break
+    responses = lock.responses[first_response:]
+    if any(w != writes for _, w, _ in responses[:-1]):
+        failures.append('flash written before the last chunk %s' % [w - writes for _, w, _ in responses])
+    if not committed or responses[-1][1] == writes or not responses[-1][2]:
+        failures.append('the batch was not committed')
+    print('%d users in %d chunks, %d flash writes for the batch' % (len(records), len(responses),
+                                                                     responses[-1][1] - writes))
+    return check('enroll', failures)
+
+
+def case_duplicate(lock, client, args, rng):
+    stored = lock.faces()
+    known_id, known = next(iter(stored.items()))
+    new = faces(rng, 2)
+    records = [('dup_known', known), ('dup_new0', new[0]), ('dup_new1', new[1]), ('dup_new0b', new[0])]
+    count = lock.lib.HAL_Facedb_GetCount()
+    results, committed = client.enroll(records)
+    failures = []
+    if results[0] != (REG_DUP, known_id):
+        failures.append('the face of user %d gives %s' % (known_id, results[0]))
+    if results[1][0] != REG_OK or results[2][0] != REG_OK:
+        failures.append('new faces give %s' % results[1:3])
+    if results[3] != (REG_DUP, results[1][1]):
+        failures.append('the face enrolled earlier in the batch gives %s' % (results[3],))
+    if lock.lib.HAL_Facedb_GetCount() != count + 2:
+        failures.append('%d users instead of %d' % (lock.lib.HAL_Facedb_GetCount(), count + 2))
+    if not committed:
+        failures.append('the batch was not committed')
+    return check('duplicate', failures)
+
+
+def case_reregister(lock, client, args, rng):
+    targets = ['user%03d' % i for i in range(min(3, args.users))]
+    ids = {}
+    for face_id in lock.faces():
+        ids[lock.lib.HAL_Facedb_GetName(face_id).decode()] = face_id
+    records = [(name, face) for name, face in zip(targets + ['nobody'], faces(rng, len(targets) + 1))]
+    count = lock.lib.HAL_Facedb_GetCount()
+    results, committed = client.enroll(records, reregister=True)
+    failures = []
+    for (name, face), (result, face_id) in zip(records[:-1], results):
+        if result != REG_OK or face_id != ids[name] or lock.face(face_id) != face:
+            failures.append('%s gives %s, the face of id %d is %s' % (name, (result, face_id), ids[name],
+                                                                       'new' if lock.face(ids[name]) == face
+                                                                       else 'old'))
+    if results[-1] != (REG_INVALID, INVALID_ID):
+        failures.append('an unknown name gives %s' % (results[-1],))
+    if lock.lib.HAL_Facedb_GetCount() != count:
+        failures.append('%d users instead of %d' % (lock.lib.HAL_Facedb_GetCount(), count))
+    if not committed:
+        failures.append('the batch was not committed')
+    return check('reregister', failures)
+
+
+def case_noise(lock, client, args, rng):
+    def noise():
+        data = bytes(rng.getrandbits(8) for _ in range(rng.randrange(64)))
+        # a partial magic right before the transfer unit
+        return data + rx_test.TU_MAGIC[:rng.randrange(3)]
+
+    records = [('noise%02d' % i, face) for i, face in enumerate(faces(rng, 2 * MAX_RECORDS + 1))]
+    client.noise = noise
+    try:
+        results, committed = client.enroll(records)
+    finally:
+        client.noise = None
+    failures = []
+    if [r for r, _ in results] != [REG_OK] * len(records) or not committed:
+        failures.append('results %s, committed %s' % ([r for r, _ in results], committed))
+    return check('noise', failures)
+
+
+def main():
+    global CC
+    parser = argparse.ArgumentParser(description='Enroll users over a loopback uart into the face database')
+    parser.add_argument('--users', type=int, default=20, help='users of the first batch')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--cc', default=os.environ.get('CC', 'gcc'), help='host C compiler')
+    args = parser.parse_args()
+    CC = args.cc
+    rx_test.CC = CC
+    if not 3 <= args.users <= MAX_FACE_DB_SIZE - 2 * MAX_RECORDS - 3:
+        parser.error('--users between 3 and %d' % (MAX_FACE_DB_SIZE - 2 * MAX_RECORDS - 3))
+
+    workdir = tempfile.mkdtemp(prefix='facedb_batch_')
+    try:
+        lib = build(workdir)
+        if lib.HAL_Facedb_Init(FACE_ITEM_SIZE) != 0:
+            raise SystemExit('HAL_Facedb_Init failed')
+
+        host_fd, lock_fd = os.openpty()
+        tty.setraw(host_fd)
+        tty.setraw(lock_fd)
+        lock = Lock(lib, lock_fd)
+        lock.start()
+        client = BatchClient(host_fd)
+        rng = random.Random(args.seed)
+        try:
+            failures = case_enroll(lock, client, args, rng)
+            failures += case_duplicate(lock, client, args, rng)
+            failures += case_reregister(lock, client, args, rng)
+            failures += case_noise(lock, client, args, rng)
+        except (TimeoutError, ValueError) as e:
+            print('FAIL: %s' % e)
+            return 1
+        finally:
+            lock.running = False
+            lock.join()
+            os.close(host_fd)
+            os.close(lock_fd)
+        for error in lock.errors:
+            print('lock: %s' % error)
+        failures += len(lock.errors)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    if failures:
+        print('FAIL: %d cases failed' % failures)
+        return 1
+    print('PASS')
+    return 0
+
+
+CC = 'gcc'
+
+if __name__ == '__main__':
+    sys.exit(main())
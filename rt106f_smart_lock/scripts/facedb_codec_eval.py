@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Measure how much the face feature codecs of hal_sln_facedb.c (FACEDB_FEATURE_CODEC) move the match scores.
+# Every recorded face is matched against all the others by cosine similarity, once with the float features and once
+# with the features decoded back from the codec, the way OASIS sees them.
+#
+# The feature sets are either full exports of a lock built with the raw codec (facedb_sync.py format) or files of
+# face items of --item-size bytes back to back, as returned by OASISLT_run_extend.
+
+import argparse
+import math
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import facedb_sync  # noqa: E402
+
+LEVELS = {'int8': 127, 'int4': 7}
+
+
+def load_items(path, item_size):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if len(data) >= 4 and struct.unpack_from('<I', data)[0] == facedb_sync.FACEDB_DELTA_MAGIC:
+        changes = facedb_sync.Changes.load(path)
+        return [r[3][facedb_sync.FACE_NAME_LEN:] for _, r in sorted(changes.live().items())]
+
+    if not item_size or len(data) % item_size:
+        raise ValueError('%s: %d bytes is not a number of %s byte face items' % (path, len(data), item_size))
+    return [data[i:i + item_size] for i in range(0, len(data), item_size)]
+
+
+def features(item, raw_bytes):
+    body = item[raw_bytes:]
+    if len(body) == 0 or len(body) % 4:
+        raise ValueError('face items of %d bytes do not end with a float vector' % len(item))
+    return list(struct.unpack('<%df' % (len(body) // 4), body))
+
+
+def quantize(vector, levels):
+    # same rounding as lroundf and same clamping as _Facedb_Encode
+    scale = max(abs(v) for v in vector) / levels
+    if scale == 0:
+        return [0] * len(vector)
+    out = []
+    for v in vector:
+        x = v / scale
+        q = int(math.floor(abs(x) + 0.5)) * (1 if x >= 0 else -1)
+        out.append(max(-levels, min(levels, q)))
+    return out
+
+
+def cosine(a, b):
+    dot = sum(x * y for x, y in zip(a, b))
+    na = math.sqrt(sum(x * x for x in a))
+    nb = math.sqrt(sum(y * y for y in b))
+    return dot / (na * nb) if na > 0 and nb > 0 else 0.0
+
+
+def encoded_size(item_size, raw_bytes, codec):
+    count = (item_size - raw_bytes) // 4
+    if codec == 'int8':
+        return raw_bytes + 4 + count
+    return raw_bytes + 4 + (count + 1) // 2
+
+
+def evaluate(vectors, codec, threshold):
+    encoded = [quantize(v, LEVELS[codec]) for v in vectors]
+    deviations = []
+    nearest_changed = 0
+    flips = 0
+
+    for i, query in enumerate(vectors):
+        best_ref = best_enc = None
+        for j in range(len(vectors)):
+            if i == j:
+                continue
+            ref = cosine(query, vectors[j])
+            enc = cosine(query, encoded[j])
+            deviations.append(abs(ref - enc))
+            if threshold is not None and (ref >= threshold) != (enc >= threshold):
+                flips += 1
+            if best_ref is None or ref > best_ref[0]:
+                best_ref = (ref, j)
+            if best_enc is None or enc > best_enc[0]:
+                best_enc = (enc, j)
+        if best_ref is not None and best_ref[1] != best_enc[1]:
+            nearest_changed += 1
+
+    deviations.sort()
+    n = len(deviations)
+    return {
+        'pairs': n,
+        'mean': sum(deviations) / n if n else 0.0,
+        'p99': deviations[min(n - 1, int(n * 0.99))] if n else 0.0,
+        'max': deviations[-1] if n else 0.0,
+        'nearest_changed': nearest_changed,
+        'flips': flips,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Evaluate the face feature codecs on recorded feature sets')
+    parser.add_argument('sets', nargs='+', help='full exports or files of face items')
+    parser.add_argument('--item-size', type=int, default=0, help='size of a face item, OASISLT_getFaceItemSize()')
+    parser.add_argument('--raw-bytes', type=int, default=0, help='FACEDB_CODEC_RAW_BYTES')
+    parser.add_argument('--codec', choices=['int8', 'int4', 'all'], default='all')
+    parser.add_argument('--threshold', type=float, help='similarity threshold, counts the match decisions which flip')
+    args = parser.parse_args()
+
+    try:
+        items = []
+        for path in args.sets:
+            items += load_items(path, args.item_size)
+        if len(items) < 2:
+            raise ValueError('at least two faces are needed')
+        item_size = len(items[0])
+        vectors = [features(item, args.raw_bytes) for item in items]
+    except (OSError, ValueError, struct.error) as e:
+        print('error: %s' % e, file=sys.stderr)
+        return 2
+
+    print('%d faces of %d bytes, %d features' % (len(vectors), item_size, len(vectors[0])))
+    for codec in (['int8', 'int4'] if args.codec == 'all' else [args.codec]):
+        size = encoded_size(item_size, args.raw_bytes, codec)
+        r = evaluate(vectors, codec, args.threshold)
+        print('%s: %d bytes per face (%.1fx), score deviation mean %.5f p99 %.5f max %.5f, '
+              'nearest face changed for %d of %d queries'
+              % (codec, size, float(item_size) / size, r['mean'], r['p99'], r['max'], r['nearest_changed'],
+                 len(vectors)), end='')
+        if args.threshold is not None:
+            print(', %d of %d decisions flipped at %.3f' % (r['flips'], r['pairs'], args.threshold), end='')
+        print()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
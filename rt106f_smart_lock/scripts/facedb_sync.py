@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Diff and merge face databases exported by HAL_Facedb_ExportChanges (DB_CHANGES_REQ over the BLE wireless uart).
+# A full export is the answer to a request since revision 0 with all the buckets, a delta is the answer to any other
+# request or the output of the delta command, ready to be sent with DB_APPLY_CHANGES_REQ.
+
+import argparse
+import struct
+import sys
+
+FACEDB_DELTA_MAGIC = 0x44424446
+FACEDB_SUMMARY_BUCKETS = 16
+FACE_NAME_LEN = 32
+
+OP_UPSERT = 1
+OP_DELETE = 2
+
+HEADER = struct.Struct('<IIIHH')
+RECORD = struct.Struct('<HBBII')
+
+# Largest DB_APPLY_CHANGES_REQ body the lock receives, BLE_WUART_PACKET_MAX_LEN
+PACKET_MAX_LEN = 4096
+
+FNV_SEED = 2166136261
+FNV_PRIME = 16777619
+
+
+def fnv(data, h=FNV_SEED):
+    for b in data:
+        h = ((h ^ b) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def hash_entry(entry):
+    name = entry[:FACE_NAME_LEN]
+    end = name.find(b'\0')
+    h = fnv(name if end < 0 else name[:end])
+    h = fnv(entry[FACE_NAME_LEN:], h)
+    return h if h != 0 else 1
+
+
+def entry_name(entry):
+    return entry[:FACE_NAME_LEN].split(b'\0', 1)[0].decode('utf-8', 'replace')
+
+
+class Changes:
+    def __init__(self, from_rev=0, to_rev=0, entry_size=0):
+        self.from_rev = from_rev
+        self.to_rev = to_rev
+        self.entry_size = entry_size
+        # id -> (op, revision, hash, entry)
+        self.records = {}
+
+    @classmethod
+    def load(cls, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+
+        if len(data) < HEADER.size:
+            raise ValueError('%s: too short' % path)
+        magic, from_rev, to_rev, count, entry_size = HEADER.unpack_from(data)
+        if magic != FACEDB_DELTA_MAGIC:
+            raise ValueError('%s: bad magic 0x%08x' % (path, magic))
+
+        changes = cls(from_rev, to_rev, entry_size)
+        offset = HEADER.size
+        for _ in range(count):
+            face_id, op, _, rev, h = RECORD.unpack_from(data, offset)
+            offset += RECORD.size
+            entry = None
+            if op == OP_UPSERT:
+                entry = data[offset:offset + entry_size]
+                offset += entry_size
+                if len(entry) != entry_size or hash_entry(entry) != h:
+                    raise ValueError('%s: corrupted face %d' % (path, face_id))
+            elif op != OP_DELETE:
+                raise ValueError('%s: bad op %d for face %d' % (path, op, face_id))
+            changes.records[face_id] = (op, rev, h, entry)
+
+        if offset != len(data):
+            raise ValueError('%s: %d trailing bytes' % (path, len(data) - offset))
+        return changes
+
+    def live(self):
+        return {i: r for i, r in self.records.items() if r[0] == OP_UPSERT}
+
+    def encode(self, ids=None):
+        ids = sorted(self.records) if ids is None else ids
+        out = bytearray(HEADER.pack(FACEDB_DELTA_MAGIC, self.from_rev, self.to_rev, len(ids), self.entry_size))
+        for face_id in ids:
+            op, rev, h, entry = self.records[face_id]
+            out += RECORD.pack(face_id, op, 0, rev, h)
+            if op == OP_UPSERT:
+                out += entry
+        return bytes(out)
+
+    def save(self, path, max_size=0):
+        ids = sorted(self.records)
+        if not max_size or len(self.encode(ids)) <= max_size:
+            with open(path, 'wb') as f:
+                f.write(self.encode(ids))
+            return [path]
+
+        # one file per DB_APPLY_CHANGES_REQ
+        paths = []
+        chunk = []
+        for face_id in ids + [None]:
+            if face_id is not None and len(self.encode(chunk + [face_id])) <= max_size:
+                chunk.append(face_id)
+                continue
+            if not chunk:
+                raise ValueError('face %d does not fit in %d bytes' % (face_id, max_size))
+            paths.append('%s.%d' % (path, len(paths)))
+            with open(paths[-1], 'wb') as f:
+                f.write(self.encode(chunk))
+            chunk = [] if face_id is None else [face_id]
+        return paths
+
+
+def summary(changes):
+    buckets = [FNV_SEED] * FACEDB_SUMMARY_BUCKETS
+    for face_id, (_, _, h, _) in sorted(changes.live().items()):
+        b = face_id % FACEDB_SUMMARY_BUCKETS
+        buckets[b] = fnv(struct.pack('<HI', face_id, h), buckets[b])
+    return buckets
+
+
+def check_full(changes, path):
+    if changes.from_rev != 0:
+        print('warning: %s is not a full export, from revision %d' % (path, changes.from_rev), file=sys.stderr)
+
+
+def cmd_summary(args):
+    changes = Changes.load(args.export)
+    check_full(changes, args.export)
+    print('revision %d, %d faces' % (changes.to_rev, len(changes.live())))
+    for b, h in enumerate(summary(changes)):
+        print('bucket %2d: 0x%08x' % (b, h))
+    return 0
+
+
+def cmd_diff(args):
+    a = Changes.load(args.a)
+    b = Changes.load(args.b)
+    check_full(a, args.a)
+    check_full(b, args.b)
+    live_a = a.live()
+    live_b = b.live()
+
+    differ = 0
+    for face_id in sorted(set(live_a) | set(live_b)):
+        if face_id not in live_b:
+            print('- %3d %s' % (face_id, entry_name(live_a[face_id][3])))
+        elif face_id not in live_a:
+            print('+ %3d %s' % (face_id, entry_name(live_b[face_id][3])))
+        elif live_a[face_id][2] != live_b[face_id][2]:
+            print('~ %3d %s -> %s' % (face_id, entry_name(live_a[face_id][3]), entry_name(live_b[face_id][3])))
+        else:
+            continue
+        differ += 1
+
+    mask = 0
+    for n, (ha, hb) in enumerate(zip(summary(a), summary(b))):
+        if ha != hb:
+            mask |= 1 << n
+    print('%d faces differ, bucket mask 0x%04x' % (differ, mask))
+    return 1 if differ else 0
+
+
+def cmd_delta(args):
+    old = Changes.load(args.old)
+    new = Changes.load(args.new)
+    check_full(old, args.old)
+    check_full(new, args.new)
+    if old.entry_size != new.entry_size:
+        raise ValueError('entry size %d and %d differ' % (old.entry_size, new.entry_size))
+
+    live_old = old.live()
+    live_new = new.live()
+    delta = Changes(old.to_rev, new.to_rev, new.entry_size)
+    for face_id, record in live_new.items():
+        if face_id not in live_old or live_old[face_id][2] != record[2]:
+            delta.records[face_id] = record
+    for face_id in live_old:
+        if face_id not in live_new:
+            delta.records[face_id] = (OP_DELETE, new.to_rev, 0, None)
+
+    for path in delta.save(args.output, args.max_size):
+        print(path)
+    print('%d changes' % len(delta.records))
+    return 0
+
+
+def cmd_merge(args):
+    base = Changes.load(args.base)
+    check_full(base, args.base)
+    merged = Changes(0, base.to_rev, base.entry_size)
+    merged.records = base.live()
+
+    for path in args.deltas:
+        delta = Changes.load(path)
+        if delta.entry_size != merged.entry_size:
+            raise ValueError('%s: entry size %d, expected %d' % (path, delta.entry_size, merged.entry_size))
+        for face_id, record in delta.records.items():
+            if record[0] == OP_UPSERT:
+                merged.records[face_id] = record
+            else:
+                merged.records.pop(face_id, None)
+        merged.to_rev = max(merged.to_rev, delta.to_rev)
+
+    merged.save(args.output)
+    print('%s: revision %d, %d faces' % (args.output, merged.to_rev, len(merged.records)))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Diff and merge exported face databases')
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    p = sub.add_parser('summary', help='print the anti-entropy summary of a full export')
+    p.add_argument('export')
+    p.set_defaults(func=cmd_summary)
+
+    p = sub.add_parser('diff', help='list the faces which differ between two full exports')
+    p.add_argument('a')
+    p.add_argument('b')
+    p.set_defaults(func=cmd_diff)
+
+    p = sub.add_parser('delta', help='make the changes turning the old full export into the new one')
+    p.add_argument('old')
+    p.add_argument('new')
+    p.add_argument('-o', '--output', required=True)
+    p.add_argument('--max-size', type=int, default=PACKET_MAX_LEN,
+                   help='split the changes in files of at most this size, 0 for a single file')
+    p.set_defaults(func=cmd_delta)
+
+    p = sub.add_parser('merge', help='apply changes to a full export')
+    p.add_argument('base')
+    p.add_argument('deltas', nargs='+')
+    p.add_argument('-o', '--output', required=True)
+    p.set_defaults(func=cmd_merge)
+
+    args = parser.parse_args()
+    try:
+        return args.func(args)
+    except (OSError, ValueError, struct.error) as e:
+        print('error: %s' % e, file=sys.stderr)
+        return 2
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Replay a trace of uses of the device through the sleep policy of the LPM manager (FWK_LPM_POLICY in
+# fwk_lpm_manager.c) and compare it with fixed idle times and modes, to tune the FWK_LPM_POLICY_* figures.
+#
+# A trace has one use per line, "start_s busy_s": the wall clock at the start of the use in seconds, local time, and
+# how long the device stays in use. Lines starting with # are ignored. Without a trace, a synthetic one is generated:
+# uses around the morning and the evening, some of them tried again a few seconds later. With --no-clock, the idle times
+# ended by a wake up from SNVS are only known to be longer than the wait before sleeping, as on a device without clock.
+
+import argparse
+import math
+import random
+import sys
+
+MODES = ('SNVS', 'STANDBY')
+HOURS = 24
+SCALE = 16
+MAX_IDLE_S = 7 * 24 * 3600
+
+
+class Policy:
+    '''Histogram of the idle times of each hour, the rules of _FWK_LpmManager_PolicyDecide and PolicyRecord'''
+
+    def __init__(self, args, modes):
+        self.args = args
+        self.modes = modes
+        self.count = [[0] * len(args.timeouts) for _ in range(HOURS)]
+        self.last_bin_s = [0] * HOURS
+        self.idle_periods = 0
+
+    def long_idle_ms(self, hour):
+        count = self.count[hour][-1] + SCALE
+        return (self.last_bin_s[hour] + self.args.prior_s) * SCALE * 1000 // count
+
+    def bin(self, idle_ms):
+        timeouts = self.args.timeouts
+        b = len(timeouts) - 1
+        while b > 0 and idle_ms < timeouts[b]:
+            b -= 1
+        return b
+
+    def age(self, hour):
+        if sum(self.count[hour]) > self.args.history * SCALE:
+            self.count[hour] = [c // 2 for c in self.count[hour]]
+            self.last_bin_s[hour] //= 2
+
+    def record(self, hour, idle_ms):
+        b = self.bin(idle_ms)
+        self.count[hour][b] += SCALE
+        if b == len(self.args.timeouts) - 1:
+            self.last_bin_s[hour] += int(idle_ms) // 1000
+        self.age(hour)
+
+    def record_censored(self, hour, min_ms):
+        count = self.count[hour]
+        first = self.bin(min_ms)
+        above = sum(count[first:])
+        last_ms = max(min_ms, self.long_idle_ms(hour))
+        if above == 0:
+            self.record(hour, last_ms)
+            return
+        left = SCALE
+        for b in range(first, len(count) - 1):
+            share = SCALE * count[b] // above
+            count[b] += share
+            left -= share
+        count[-1] += left
+        self.last_bin_s[hour] += last_ms * left // SCALE // 1000
+        self.age(hour)
+
+    def decide(self, hour):
+        a = self.args
+        timeouts = a.timeouts
+        bins = len(timeouts)
+        weight = [float(c) for c in self.count[hour]]
+        idle = [(timeouts[b] + timeouts[b + 1]) / 2.0 for b in range(bins - 1)] + [float(self.long_idle_ms(hour))]
+        weight[-1] += SCALE
+        idle[-1] = max(idle[-1], timeouts[-1])
+        total = sum(weight)
+        best = (math.inf, None, 0)
+        for mode in self.modes:
+            wake_mj = a.wake_mj[mode] + a.latency_mj_per_s * a.wake_ms[mode] / 1000.0
+            for t in range(bins):
+                timeout = timeouts[t]
+                cost = 0.0
+                for b in range(bins):
+                    if b < t:
+                        cost += weight[b] * a.idle_mw * idle[b] / 1000.0
+                    else:
+                        sleep_mj = a.sleep_mw[mode] * (idle[b] - timeout) / 1000.0
+                        cost += weight[b] * (a.idle_mw * timeout / 1000.0 + sleep_mj + wake_mj)
+                cost /= total
+                if cost < best[0]:
+                    best = (cost, mode, timeout)
+        self.idle_periods += 1
+        if a.no_clock and a.explore > 0 and best[2] != timeouts[-1] and self.idle_periods % a.explore == 0:
+            best = (best[0], best[1], timeouts[timeouts.index(best[2]) + 1])
+        return best, int(total / SCALE) - 1
+
+
+class Fixed:
+    '''A fixed mode and idle time, the behaviour without the policy'''
+
+    def __init__(self, mode, timeout):
+        self.mode = mode
+        self.timeout = timeout
+
+    def decide(self, hour):
+        return (0.0, self.mode, self.timeout), 0
+
+    def record(self, hour, idle_ms):
+        pass
+
+    def record_censored(self, hour, min_ms):
+        pass
+
+
+def replay(args, trace, strategy, verbose=False):
+    '''Energy over the idle times of the trace, the latency and the wake ups of each mode'''
+    energy_mj = 0.0
+    latency_ms = 0.0
+    wakes = [0] * len(MODES)
+    for (start, busy), (following, _) in zip(trace, trace[1:]):
+        idle_start = start + busy
+        idle_ms = max(0.0, (following - idle_start) * 1000.0)
+        hour = int(idle_start // 3600) % HOURS
+        (cost, mode, timeout), samples = strategy.decide(hour)
+        if verbose:
+            print('  %9.0f s hour %2d, %3d idle times: %-7s after %6d ms, %6.0f mJ expected, idle %.0f s'
+                  % (idle_start, hour, samples, MODES[mode], timeout, cost, idle_ms / 1000.0))
+        if idle_ms < timeout:
+            energy_mj += args.idle_mw * idle_ms / 1000.0
+        else:
+            energy_mj += args.idle_mw * timeout / 1000.0 + args.sleep_mw[mode] * (idle_ms - timeout) / 1000.0
+            energy_mj += args.wake_mj[mode]
+            latency_ms += args.wake_ms[mode]
+            wakes[mode] += 1
+        if args.no_clock and idle_ms >= timeout and MODES[mode] == 'SNVS':
+            strategy.record_censored(hour, timeout)
+        else:
+            strategy.record(hour, min(idle_ms, MAX_IDLE_S * 1000.0))
+    return energy_mj, latency_ms, wakes
+
+
+def synthetic(args, rng):
+    '''Uses around 7h and 19h, a few during the day, a quarter of them tried again a few seconds later'''
+    trace = []
+    for day in range(args.days):
+        base = day * 86400
+        for peak, spread, uses in ((7.5, 0.5, 4), (12.5, 2.0, 1), (19.0, 1.5, 6)):
+            for _ in range(uses):
+                start = base + rng.gauss(peak, spread) * 3600
+                trace.append((start, rng.uniform(2, 8)))
+                while rng.random() < 0.25:
+                    start += rng.uniform(3, 12)
+                    trace.append((start, rng.uniform(2, 8)))
+    trace.sort()
+    return trace
+
+
+def load(path):
+    trace = []
+    with open(path) as f:
+        for line in f:
+            line = line.split('#')[0].split()
+            if line:
+                trace.append((float(line[0]), float(line[1]) if len(line) > 1 else 0.0))
+    trace.sort()
+    return trace
+
+
+def int_list(text):
+    return [int(v) for v in text.strip('{}').split(',')]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Replay a trace of uses through the sleep policy of the LPM manager')
+    parser.add_argument('trace', nargs='?', help='file of "start_s busy_s" lines, a synthetic trace without it')
+    parser.add_argument('--days', type=int, default=28, help='days of the synthetic trace')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--modes', default='0,1', help='modes of the lpm device, 0 SNVS, 1 STANDBY')
+    parser.add_argument('--timeouts', type=int_list, default=[0, 5000, 15000, 30000, 60000, 120000],
+                        help='FWK_LPM_POLICY_TIMEOUTS_MS')
+    parser.add_argument('--idle-mw', type=float, default=1000.0, help='FWK_LPM_POLICY_IDLE_MW')
+    parser.add_argument('--sleep-mw', type=int_list, default=[1, 450], help='FWK_LPM_POLICY_SLEEP_MW')
+    parser.add_argument('--wake-mj', type=int_list, default=[1500, 20], help='FWK_LPM_POLICY_WAKE_MJ')
+    parser.add_argument('--wake-ms', type=int_list, default=[1500, 100], help='FWK_LPM_POLICY_WAKE_MS')
+    parser.add_argument('--latency-mj-per-s', type=float, default=3000.0, help='FWK_LPM_POLICY_LATENCY_MJ_PER_S')
+    parser.add_argument('--history', type=int, default=64, help='FWK_LPM_POLICY_HISTORY')
+    parser.add_argument('--prior-s', type=int, default=3 * 3600, help='FWK_LPM_POLICY_PRIOR_S')
+    parser.add_argument('--explore', type=int, default=8, help='FWK_LPM_POLICY_EXPLORE')
+    parser.add_argument('--no-clock', action='store_true', help='no clock through SNVS, the lpm device has no getClock')
+    parser.add_argument('-v', '--verbose', action='store_true', help='print each decision of the policy')
+    args = parser.parse_args()
+
+    modes = [int(m) for m in args.modes.split(',')]
+    if any(m not in range(len(MODES)) for m in modes) or args.timeouts[0] != 0 or \
+            args.timeouts != sorted(args.timeouts):
+        print('error: modes are 0 or 1, the timeouts increase from 0', file=sys.stderr)
+        return 2
+
+    trace = load(args.trace) if args.trace else synthetic(args, random.Random(args.seed))
+    if len(trace) < 2:
+        print('error: the trace holds less than two uses', file=sys.stderr)
+        return 2
+
+    days = max((trace[-1][0] - trace[0][0]) / 86400.0, 1.0 / 24)
+    print('%d uses over %.1f days' % (len(trace), days))
+    print('  %-24s %10s %12s %s' % ('', 'J per day', 'mean wake', '  wake ups ' + ' / '.join(MODES)))
+
+    strategies = [('policy', Policy(args, modes))]
+    strategies += [('%s after %d ms' % (MODES[m], t), Fixed(m, t)) for m in modes for t in args.timeouts]
+    for name, strategy in strategies:
+        energy, latency, wakes = replay(args, trace, strategy, args.verbose and name == 'policy')
+        print('  %-24s %10.1f %9.0f ms   %s' % (name, energy / 1000.0 / days, latency / (len(trace) - 1),
+                                                ' / '.join(str(w) for w in wakes)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Simulate the bulk transfers of the BLE wireless uart (BULK_START_REQ / BULK_DATA_REQ in
+# hal_input_ble_wuart_qn9090.c) to check the framing and the windowing and to size BLE_WUART_BULK_WINDOW.
+# A host streams a packet in chunks over a link with a rate, a latency, losses and disconnections. The lock side
+# follows the rules of SLN_BLEWUARTBulkStart and SLN_BLEWUARTBulkData: acknowledge every half window, report a gap
+# once, drop the chunks after a gap and resume a transfer started again with the same id.
+#
+# The run with a window of one chunk is the stop-and-wait exchange of the other requests.
+
+import argparse
+import heapq
+import random
+import struct
+import sys
+import zlib
+
+TU_MAGIC = b'\x53\x79\x4c'
+HEADER = struct.Struct('<3sBIIIII')
+BULK_START = struct.Struct('<IIIB3x')
+
+BULK_START_REQ = 32
+BULK_START_RES = 33
+BULK_DATA_REQ = 34
+BULK_DATA_RES = 35
+DB_APPLY_CHANGES_REQ = 30
+
+ACK_ERROR = 0xFFFFFFFF
+NO_GAP = 0xFFFFFFFF
+
+# Largest packet the lock builds, BLE_WUART_PACKET_MAX_LEN
+PACKET_MAX_LEN = 4096
+
+
+def frame(ptype, pkt_id, body=b'', reserved=0):
+    head = struct.pack('<3sBIIII', TU_MAGIC, ptype, len(body), pkt_id, zlib.crc32(body) if body else 0, reserved)
+    return head + struct.pack('<I', zlib.crc32(head)) + body
+
+
+def unframe(data):
+    magic, ptype, length, pkt_id, crc, reserved, tu_crc = HEADER.unpack_from(data)
+    if magic != TU_MAGIC or zlib.crc32(data[:HEADER.size - 4]) != tu_crc:
+        raise ValueError('bad transfer unit')
+    body = data[HEADER.size:HEADER.size + length]
+    if len(body) != length or (length and zlib.crc32(body) != crc):
+        raise ValueError('bad packet body')
+    return ptype, pkt_id, reserved, body
+
+
+class Lock:
+    '''Receiving side, the rules of hal_input_ble_wuart_qn9090.c'''
+
+    def __init__(self, window):
+        self.window = window
+        self.active = False
+        self.transfer_id = None
+        self.data = bytearray()
+        self.total = 0
+        self.crc = 0
+        self.packet_crc = 0
+        self.acked = 0
+        self.gap_at = NO_GAP
+        self.delivered = []
+
+    @property
+    def received(self):
+        return len(self.data)
+
+    def handle(self, packet):
+        ptype, pkt_id, reserved, body = unframe(packet)
+        if ptype == BULK_START_REQ:
+            return self.start(pkt_id, body)
+        if ptype == BULK_DATA_REQ:
+            return self.chunk(pkt_id, reserved, body)
+        return []
+
+    def start(self, transfer_id, body):
+        total, inner_id, crc, inner_type = BULK_START.unpack(body)
+        if not (self.active and self.transfer_id == transfer_id and self.total == total and self.packet_crc == crc):
+            if total > PACKET_MAX_LEN:
+                return [frame(BULK_START_RES, transfer_id, reserved=ACK_ERROR)]
+            self.active = True
+            self.transfer_id = transfer_id
+            self.total = total
+            self.packet_crc = crc
+            self.data = bytearray()
+            self.crc = 0
+        self.acked = self.received
+        self.gap_at = NO_GAP
+        return [frame(BULK_START_RES, transfer_id, struct.pack('<I', self.window), self.received)]
+
+    def chunk(self, transfer_id, offset, body):
+        if not self.active or transfer_id != self.transfer_id:
+            return [frame(BULK_DATA_RES, transfer_id, reserved=ACK_ERROR)]
+        if offset > self.received:
+            if self.gap_at != self.received:
+                self.gap_at = self.received
+                self.acked = self.received
+                return [frame(BULK_DATA_RES, transfer_id, reserved=self.received)]
+            return []
+        skip = self.received - offset
+        count = min(len(body) - skip, self.total - self.received) if len(body) > skip else 0
+        if count <= 0:
+            return []
+        self.data += body[skip:skip + count]
+        self.crc = zlib.crc32(body[skip:skip + count], self.crc)
+        self.gap_at = NO_GAP
+        if self.received < self.total:
+            if self.received - self.acked >= self.window // 2:
+                self.acked = self.received
+                return [frame(BULK_DATA_RES, transfer_id, reserved=self.received)]
+            return []
+        self.active = False
+        self.acked = self.received
+        if self.crc != self.packet_crc:
+            return [frame(BULK_DATA_RES, transfer_id, reserved=ACK_ERROR)]
+        self.delivered.append(bytes(self.data))
+        return [frame(BULK_DATA_RES, transfer_id, reserved=self.received)]
+
+
+class Host:
+    '''Sending side, a go-back-N sender limited by the window of the lock'''
+
+    def __init__(self, transfer_id, payload, chunk, timeout):
+        self.transfer_id = transfer_id
+        self.payload = payload
+        self.chunk_size = chunk
+        self.timeout = timeout
+        self.window = 0
+        self.next = 0
+        self.acked = 0
+        self.started = False
+        self.done = False
+        self.failed = False
+        self.sent_bytes = 0
+        self.last_progress = 0.0
+
+    def start_request(self):
+        body = BULK_START.pack(len(self.payload), 7, zlib.crc32(self.payload), DB_APPLY_CHANGES_REQ)
+        return frame(BULK_START_REQ, self.transfer_id, body)
+
+    def ready(self):
+        '''Chunks which can be sent now'''
+        out = []
+        while self.started and not self.done and self.next < len(self.payload) and \
+                self.next - self.acked < self.window:
+            count = min(self.chunk_size, len(self.payload) - self.next, self.window - (self.next - self.acked))
+            out.append(frame(BULK_DATA_REQ, self.transfer_id, self.payload[self.next:self.next + count], self.next))
+            self.sent_bytes += count
+            self.next += count
+        return out
+
+    def handle(self, packet, now):
+        ptype, pkt_id, reserved, body = unframe(packet)
+        if pkt_id != self.transfer_id:
+            return
+        if reserved == ACK_ERROR:
+            self.failed = True
+            return
+        if ptype == BULK_START_RES:
+            self.window = struct.unpack('<I', body)[0]
+            self.started = True
+            self.acked = self.next = reserved
+        elif ptype == BULK_DATA_RES:
+            if reserved >= len(self.payload):
+                self.done = True
+            elif reserved < self.next:
+                # a gap, or an ack of bytes sent before: send again from the first byte not received
+                if reserved <= self.acked or reserved < self.next - self.window:
+                    self.next = reserved
+            self.acked = max(self.acked, reserved)
+            self.next = max(self.next, self.acked)
+        self.last_progress = now
+
+
+class Channel:
+    '''One direction of the link: packets are serialized at the rate, delayed, sometimes lost'''
+
+    def __init__(self, sim, rate, latency, loss, rng):
+        self.sim = sim
+        self.rate = rate
+        self.latency = latency
+        self.loss = loss
+        self.rng = rng
+        self.busy_until = 0.0
+
+    def send(self, packet, deliver):
+        start = max(self.sim.now, self.busy_until)
+        self.busy_until = start + len(packet) / self.rate
+        if self.rng.random() < self.loss or self.sim.link_down(start):
+            return
+        generation = self.sim.generation
+
+        def arrive():
+            if generation == self.sim.generation:
+                deliver(packet)
+        self.sim.at(self.busy_until + self.latency, arrive)
+
+
+class Sim:
+    def __init__(self, args, window, rng):
+        self.now = 0.0
+        self.events = []
+        self.seq = 0
+        self.generation = 0
+        self.outage = None
+        self.up = Channel(self, args.rate * 1000.0, args.latency_ms / 1000.0, args.loss, rng)
+        self.down = Channel(self, args.rate * 1000.0, args.latency_ms / 1000.0, args.loss, rng)
+        self.lock = Lock(window)
+        payload = bytes(rng.getrandbits(8) for _ in range(args.size))
+        self.host = Host(0x1234, payload, args.chunk, args.timeout_ms / 1000.0)
+
+    def at(self, when, action):
+        self.seq += 1
+        heapq.heappush(self.events, (when, self.seq, action))
+
+    def link_down(self, when):
+        return self.outage is not None and self.outage[0] <= when < self.outage[1]
+
+    def to_lock(self, packet):
+        for answer in self.lock.handle(packet):
+            self.down.send(answer, self.to_host)
+
+    def to_host(self, packet):
+        self.host.handle(packet, self.now)
+        self.pump()
+
+    def pump(self):
+        for packet in self.host.ready():
+            self.up.send(packet, self.to_lock)
+
+    def watchdog(self):
+        # no answer for a while, the host starts the transfer again and resumes where the lock is
+        if self.host.done or self.host.failed:
+            return
+        if self.now - self.host.last_progress >= self.host.timeout and not self.link_down(self.now):
+            self.host.started = False
+            self.host.last_progress = self.now
+            self.up.send(self.host.start_request(), self.to_lock)
+        self.at(self.now + self.host.timeout / 4, self.watchdog)
+
+    def disconnect(self, start, length):
+        def cut():
+            # everything in flight is lost with the connection
+            self.generation += 1
+            self.up.busy_until = self.down.busy_until = self.now
+        self.outage = (start, start + length)
+        self.at(start, cut)
+
+    def run(self, limit=600.0):
+        self.up.send(self.host.start_request(), self.to_lock)
+        self.at(self.host.timeout / 4, self.watchdog)
+        while self.events and not (self.host.done or self.host.failed) and self.now < limit:
+            self.now, _, action = heapq.heappop(self.events)
+            action()
+        return self.now
+
+
+def scenario(name, args, window, disconnect=None):
+    rng = random.Random(args.seed)
+    sim = Sim(args, window, rng)
+    if disconnect is not None:
+        sim.disconnect(*disconnect)
+    elapsed = sim.run()
+    host = sim.host
+    ok = host.done and sim.lock.delivered and sim.lock.delivered[-1] == host.payload
+    print('  %-22s %s  %7.3f s  %7.1f kB/s  %5.1f%% sent again'
+          % (name, 'ok    ' if ok else 'FAILED', elapsed, len(host.payload) / elapsed / 1000.0,
+             100.0 * (host.sent_bytes - len(host.payload)) / len(host.payload)))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Simulate the BLE wireless uart bulk transfers')
+    parser.add_argument('--size', type=int, default=PACKET_MAX_LEN, help='size of the packet carried')
+    parser.add_argument('--chunk', type=int, default=488, help='chunk size, two GATT writes of a 247 bytes MTU')
+    parser.add_argument('--window', type=int, default=2048, help='BLE_WUART_BULK_WINDOW')
+    parser.add_argument('--rate', type=float, default=100.0, help='link rate in kB/s')
+    parser.add_argument('--latency-ms', type=float, default=30.0, help='one way latency, about a connection interval')
+    parser.add_argument('--loss', type=float, default=0.01, help='probability a packet is lost')
+    parser.add_argument('--timeout-ms', type=float, default=500.0, help='time without an answer before resuming')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    if args.size > PACKET_MAX_LEN:
+        print('error: the lock builds packets of at most %d bytes' % PACKET_MAX_LEN, file=sys.stderr)
+        return 2
+
+    print('%d bytes in %d byte chunks, %.0f kB/s, %.0f ms latency, %.1f%% loss'
+          % (args.size, args.chunk, args.rate, args.latency_ms, 100.0 * args.loss))
+    results = [
+        scenario('stop and wait', args, args.chunk),
+        scenario('window %d' % args.window, args, args.window),
+        scenario('window %d, reconnect' % args.window, args, args.window, disconnect=(0.05, 0.5)),
+    ]
+    return 0 if all(results) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
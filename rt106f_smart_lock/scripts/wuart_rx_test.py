@@ -0,0 +1,358 @@
+#!/usr/bin/env python3
+
+'''
+Copyright 2022 NXP.
+
+This software is owned or controlled by NXP and may only be used strictly in accordance with the
+license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+activating and/or otherwise using the software, you are agreeing that you have read, and that you
+agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+applicable license terms, then you may not retain, install, activate or otherwise use the software.
+
+'''
+
+# Feed the receive parser of the BLE wireless uart (hal_input_ble_wuart_rx.c) on a host. The parser is built with the
+# host compiler and loaded with ctypes, byte streams are fed in random slices the way SLN_BLEWUARTRxDrain takes them
+# out of the ring.
+#
+# clean:   packets back to back, every one must come out with its body
+# noise:   noise, partial magics, transfer units with a wrong crc hiding the magic of the next one and packet bodies
+#          with a wrong crc between the packets. Every good packet must come out and every other byte be counted
+# pool:    no packet buffer free, and packets longer than BLE_WUART_PACKET_MAX_LEN, their bodies are skipped
+# ring:    HAL_BleWuartRx_RingLost against a dma writing bursts into the ring, a whole ring written included, with the
+#          half interrupt sometimes counted after the drain
+#
+# python3 wuart_rx_test.py                    run all the cases, exit 1 if one fails
+# python3 wuart_rx_test.py --capture rx.bin   feed a capture of the bytes the lock received and print the counters
+
+import argparse
+import ctypes
+import os
+import random
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import zlib
+
+SCRIPTS_DIR = os.path.dirname(os.path.abspath(__file__))
+INPUT_DIR = os.path.join(SCRIPTS_DIR, '..', 'sln_framework', 'hal', 'input')
+
+TU_MAGIC = b'\x53\x79\x4c'
+HEADER = struct.Struct('<3sBIIII')
+HEADER_LENGTH = HEADER.size + 4
+PACKET_MAX_LEN = 4096
+RING_SIZE = 1024
+
+EVENT_HEADER, EVENT_HEADER_ERROR, EVENT_PACKET_ERROR, EVENT_NO_BUFFER = range(4)
+
+PROBE = r'''
+#include <stddef.h>
+#include <stdio.h>
+#include "hal_input_ble_wuart_rx.h"
+int main(void)
+{
+    printf("%u %u %u\n", (unsigned)sizeof(hal_ble_wuart_packet_buf_t),
+           (unsigned)offsetof(hal_ble_wuart_packet_buf_t, data), (unsigned)sizeof(hal_ble_wuart_rx_t));
+    return 0;
+}
+'''
+
+
+class TransferUnit(ctypes.Structure):
+    _fields_ = [('tuMagic', ctypes.c_uint8 * 3), ('pktType', ctypes.c_uint8), ('pktLen', ctypes.c_uint32),
+                ('pktId', ctypes.c_uint32), ('pktCrc', ctypes.c_uint32), ('tuCrc', ctypes.c_uint32),
+                ('reserved', ctypes.c_uint32)]
+
+
+class PacketBuf(ctypes.Structure):
+    _fields_ = [('header', TransferUnit), ('refCount', ctypes.c_uint8), ('aligned', ctypes.c_uint8 * 3),
+                ('data', ctypes.c_uint8 * PACKET_MAX_LEN)]
+
+
+class Stats(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_uint32) for name in
+                ('bytes', 'packets', 'noiseBytes', 'headerErrors', 'packetErrors', 'noBuffer', 'overruns')]
+
+
+# a callback can only return a plain address
+ACQUIRE = ctypes.CFUNCTYPE(ctypes.c_void_p, ctypes.c_void_p)
+RELEASE = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.POINTER(PacketBuf))
+EVENT = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(TransferUnit))
+
+
+class Rx(ctypes.Structure):
+    _fields_ = [('header', ctypes.c_uint8 * HEADER_LENGTH), ('headerLen', ctypes.c_uint32),
+                ('packet', ctypes.POINTER(PacketBuf)), ('packetLen', ctypes.c_uint32),
+                ('packetCrc', ctypes.c_uint32), ('discardLen', ctypes.c_uint32), ('stage', ctypes.c_uint8),
+                ('stats', Stats), ('acquire', ACQUIRE), ('release', RELEASE), ('event', EVENT),
+                ('param', ctypes.c_void_p)]
+
+
+def build(workdir):
+    '''Build the parser as a shared library, check the ctypes layouts against the compiler's'''
+    flags = ['-O2', '-Wall', '-I', INPUT_DIR, '-DBLE_WUART_PACKET_MAX_LEN=%d' % PACKET_MAX_LEN]
+    lib = os.path.join(workdir, 'wuart_rx.so')
+    probe = os.path.join(workdir, 'wuart_rx_probe')
+    subprocess.check_call([CC, '-shared', '-fPIC', '-o', lib, os.path.join(INPUT_DIR, 'hal_input_ble_wuart_rx.c')] +
+                          flags)
+    subprocess.run([CC, '-x', 'c', '-', '-o', probe] + flags, input=PROBE.encode(), check=True)
+    layout = [int(v) for v in subprocess.check_output([probe]).split()]
+    expected = [ctypes.sizeof(PacketBuf), PacketBuf.data.offset, ctypes.sizeof(Rx)]
+    if layout != expected:
+        raise SystemExit('the structures of hal_input_ble_wuart_rx.h changed, %s != %s' % (layout, expected))
+
+    parser = ctypes.CDLL(lib)
+    parser.HAL_BleWuartRx_Init.argtypes = [ctypes.POINTER(Rx), ACQUIRE, RELEASE, EVENT, ctypes.c_void_p]
+    parser.HAL_BleWuartRx_Reset.argtypes = [ctypes.POINTER(Rx)]
+    parser.HAL_BleWuartRx_Feed.restype = ctypes.c_uint32
+    parser.HAL_BleWuartRx_Feed.argtypes = [ctypes.POINTER(Rx), ctypes.c_char_p, ctypes.c_uint32,
+                                           ctypes.POINTER(ctypes.POINTER(PacketBuf))]
+    parser.HAL_BleWuartRx_RingLost.restype = ctypes.c_int32
+    parser.HAL_BleWuartRx_RingLost.argtypes = [ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_int32]
+    return parser
+
+
+def transfer_unit(pkt_type, body, pkt_id, pkt_crc=None, reserved=0):
+    if pkt_crc is None:
+        pkt_crc = zlib.crc32(body)
+    header = HEADER.pack(TU_MAGIC, pkt_type, len(body), pkt_id, pkt_crc, reserved)
+    return header + struct.pack('<I', zlib.crc32(header)) + body
+
+
+class Receiver:
+    '''The parser with a pool of packet buffers, fed like SLN_BLEWUARTRxDrain feeds it'''
+
+    def __init__(self, parser, pool_count=2):
+        self.parser = parser
+        self.pool = [PacketBuf() for _ in range(pool_count)]
+        self.pool_free = True
+        self.events = [0] * 4
+        self.rx = Rx()
+        # the callbacks must outlive the parser
+        self.callbacks = (ACQUIRE(self.acquire), RELEASE(self.release), EVENT(self.event))
+        parser.HAL_BleWuartRx_Init(ctypes.byref(self.rx), *self.callbacks, None)
+
+    def acquire(self, param):
+        for packet in self.pool:
+            if self.pool_free and packet.refCount == 0:
+                packet.refCount = 1
+                return ctypes.addressof(packet)
+        return None
+
+    def release(self, param, packet):
+        if packet.contents.refCount > 0:
+            packet.contents.refCount -= 1
+
+    def event(self, param, event, header):
+        self.events[event] += 1
+
+    def feed(self, data, rng):
+        '''Feed the bytes in random slices, return the packets received as (type, id, body)'''
+        packets = []
+        out = ctypes.POINTER(PacketBuf)()
+        pos = 0
+        while pos < len(data):
+            count = min(len(data) - pos, rng.choice((1, 7, 64, RING_SIZE // 2, RING_SIZE)))
+            chunk = data[pos:pos + count]
+            while chunk:
+                used = self.parser.HAL_BleWuartRx_Feed(ctypes.byref(self.rx), chunk, len(chunk), ctypes.byref(out))
+                self.rx.stats.bytes += used
+                chunk = chunk[used:]
+                if out:
+                    packet = out.contents
+                    packets.append((packet.header.pktType, packet.header.pktId,
+                                    bytes(packet.data[:packet.header.pktLen])))
+                    self.release(None, out)
+            pos += count
+        return packets
+
+    def in_use(self):
+        return sum(packet.refCount for packet in self.pool)
+
+
+def random_packets(rng, count):
+    packets = []
+    for pkt_id in range(count):
+        size = rng.choice((0, 1, 4, rng.randrange(PACKET_MAX_LEN + 1), PACKET_MAX_LEN))
+        body = bytes(rng.randrange(256) for _ in range(size))
+        # bodies full of magics must not confuse the parser
+        if size >= 3 and rng.random() < 0.3:
+            body = (TU_MAGIC * (size // 3 + 1))[:size]
+        packets.append((rng.randrange(36), pkt_id, body))
+    return packets
+
+
+def noise(rng, next_header):
+    '''Bytes the parser must skip before the next transfer unit'''
+    kind = rng.randrange(5)
+    if kind == 0:
+        return bytes(rng.randrange(256) for _ in range(rng.randrange(1, 40)))
+    if kind == 1:
+        return TU_MAGIC[:rng.randrange(1, 3)]
+    if kind == 2:
+        # a magic and the start of a transfer unit cut short, the unit completes on the next one and fails its crc
+        return TU_MAGIC + bytes(rng.randrange(256) for _ in range(rng.randrange(0, HEADER_LENGTH - 3)))
+    if kind == 3:
+        # a transfer unit with a wrong crc and no body
+        unit = bytearray(transfer_unit(0, b'', 0))
+        unit[rng.randrange(3, HEADER_LENGTH)] ^= 1 << rng.randrange(8)
+        return bytes(unit)
+    # the start of the next transfer unit, sent again from its beginning
+    return next_header[:rng.randrange(1, HEADER_LENGTH)]
+
+
+def case_clean(parser, args, rng):
+    receiver = Receiver(parser)
+    packets = random_packets(rng, args.packets)
+    stream = b''.join(transfer_unit(t, body, pkt_id) for t, pkt_id, body in packets)
+    received = receiver.feed(stream, rng)
+    stats = receiver.rx.stats
+    ok = received == packets and stats.noiseBytes == 0 and stats.headerErrors == 0 and receiver.in_use() == 0
+    print('clean    %d of %d packets received, %d noise bytes' % (len(received), len(packets), stats.noiseBytes))
+    return not ok
+
+
+def case_noise(parser, args, rng):
+    receiver = Receiver(parser)
+    packets = random_packets(rng, args.packets)
+    expected = []
+    stream = bytearray()
+    skipped = 0
+    bad_bodies = 0
+    for pkt_type, pkt_id, body in packets:
+        unit = transfer_unit(pkt_type, body, pkt_id)
+        if rng.random() < 0.5:
+            junk = noise(rng, unit)
+            stream += junk
+            skipped += len(junk)
+        if body and rng.random() < 0.1:
+            # the body is corrupted, the packet is dropped and its bytes are not noise
+            unit = bytearray(unit)
+            unit[HEADER_LENGTH + rng.randrange(len(body))] ^= 0xFF
+            bad_bodies += 1
+        else:
+            expected.append((pkt_type, pkt_id, body))
+        stream += unit
+
+    received = receiver.feed(bytes(stream), rng)
+    stats = receiver.rx.stats
+    ok = received == expected and stats.packetErrors == bad_bodies and stats.bytes == len(stream) and \
+        stats.noiseBytes == skipped and receiver.in_use() == 0 and \
+        receiver.events[EVENT_HEADER_ERROR] == stats.headerErrors and \
+        receiver.events[EVENT_HEADER] == len(expected) + bad_bodies
+    print('noise    %d of %d packets received, %d of %d noise bytes skipped, %d header errors, %d body errors'
+          % (len(received), len(expected), stats.noiseBytes, skipped, stats.headerErrors, stats.packetErrors))
+    return not ok
+
+
+def case_pool(parser, args, rng):
+    receiver = Receiver(parser)
+    failures = 0
+
+    # no buffer free, the body is skipped and the next packet is received once a buffer is back
+    receiver.pool_free = False
+    body = bytes(rng.randrange(256) for _ in range(300))
+    received = receiver.feed(transfer_unit(1, body, 1), rng)
+    receiver.pool_free = True
+    received += receiver.feed(transfer_unit(2, body, 2), rng)
+    failures += received != [(2, 2, body)] or receiver.rx.stats.noBuffer != 1
+
+    # too long for a buffer, skipped as well
+    long_body = bytes(PACKET_MAX_LEN + 1)
+    received = receiver.feed(transfer_unit(3, long_body, 3) + transfer_unit(4, body, 4), rng)
+    failures += received != [(4, 4, body)] or receiver.rx.stats.noBuffer != 2
+
+    # a reset in the middle of a body gives the buffer back
+    receiver.feed(transfer_unit(5, body, 5)[:HEADER_LENGTH + 10], rng)
+    held = receiver.in_use()
+    parser.HAL_BleWuartRx_Reset(ctypes.byref(receiver.rx))
+    failures += held != 1 or receiver.in_use() != 0
+    received = receiver.feed(transfer_unit(6, body, 6), rng)
+    failures += received != [(6, 6, body)]
+
+    print('pool     %d failed, %d packets skipped' % (failures, receiver.rx.stats.noBuffer))
+    return failures
+
+
+def case_ring(parser, args, rng):
+    '''A dma writes bursts into the ring and the task drains it now and then, the way SLN_BLEWUARTRxDrain does. The
+    half interrupt of a crossing made just before a drain is sometimes counted after it'''
+    half = RING_SIZE // 2
+    read_offset = 0
+    half_events = 0
+    late = 0
+    missed = 0
+    false_alarms = 0
+    whole_rings = 0
+    for _ in range(args.packets * 10):
+        written = rng.choice((rng.randrange(RING_SIZE), rng.randrange(RING_SIZE), RING_SIZE,
+                              RING_SIZE + rng.randrange(1, RING_SIZE), 2 * RING_SIZE))
+        # the interrupt of the last drain comes in, then the ones of this burst but the last may be late
+        half_events += late
+        crossings = (read_offset + written) // half - read_offset // half
+        late = 1 if crossings and rng.random() < 0.3 else 0
+        half_events += crossings - late
+        write_offset = (read_offset + written) % RING_SIZE
+
+        lost = parser.HAL_BleWuartRx_RingLost(RING_SIZE, read_offset, write_offset, half_events)
+        # the channel interrupt flag tells the drain of an event still to be counted
+        half_events = -late if lost > 0 else lost
+        read_offset = write_offset
+
+        expected = written >= RING_SIZE
+        whole_rings += written == RING_SIZE
+        missed += expected and lost <= 0
+        false_alarms += not expected and lost > 0
+    print('ring     %d overruns missed, %d false overruns, %d whole rings written between two drains'
+          % (missed, false_alarms, whole_rings))
+    return missed + false_alarms
+
+
+def feed_capture(parser, path, rng):
+    receiver = Receiver(parser, pool_count=1)
+    with open(path, 'rb') as f:
+        received = receiver.feed(f.read(), rng)
+    stats = receiver.rx.stats
+    print('%d bytes, %d packets, %d noise bytes, %d header errors, %d body errors, %d skipped'
+          % (stats.bytes, len(received), stats.noiseBytes, stats.headerErrors, stats.packetErrors, stats.noBuffer))
+    for pkt_type, pkt_id, body in received:
+        print('  type %3d id %8d %5d bytes' % (pkt_type, pkt_id, len(body)))
+    return 0
+
+
+def main():
+    global CC
+    parser = argparse.ArgumentParser(description='Feed the receive parser of the BLE wireless uart on a host')
+    parser.add_argument('--packets', type=int, default=300, help='packets per case')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--capture', help='bytes received by the lock to feed instead of the cases')
+    parser.add_argument('--cc', default=os.environ.get('CC', 'gcc'), help='host C compiler')
+    args = parser.parse_args()
+    CC = args.cc
+
+    workdir = tempfile.mkdtemp(prefix='wuart_rx_')
+    try:
+        rx = build(workdir)
+        rng = random.Random(args.seed)
+        if args.capture:
+            return feed_capture(rx, args.capture, rng)
+        failures = case_clean(rx, args, rng)
+        failures += case_noise(rx, args, rng)
+        failures += case_pool(rx, args, rng)
+        failures += case_ring(rx, args, rng)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    if failures:
+        print('FAIL: %d cases failed' % failures)
+        return 1
+    print('PASS')
+    return 0
+
+
+CC = 'gcc'
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -17,6 +17,8 @@
 #include "fwk_task.h"
 #include "fwk_perf.h"
 #include "fwk_graphics.h"
+#include "fwk_memory.h"
+#include "fwk_lpm_manager.h"
 #include "fwk_camera_manager.h"
 
 typedef struct
@@ -139,6 +141,8 @@ static int _FWK_CameraManager_TaskInit(fwk_task_data_t *pTaskData)
         }
     }
 
+    FWK_LpmManager_ResumeMark(kFWKLpmResume_CameraInit);
+
     for (int i = 0; i < MAXIMUM_CAMERA_DEV; i++)
     {
         camera_dev_t *pDev = pCameraTaskData->devs[i];
@@ -166,9 +170,50 @@ static int _FWK_CameraManager_TaskInit(fwk_task_data_t *pTaskData)
         }
     }
 
+    FWK_LpmManager_ResumeMark(kFWKLpmResume_CameraStarted);
+
     return error;
 }
 
+/* the frame surfaces in their buffer orientation, the plan folds the rotations and picks the device passes */
+static void _FWK_CameraManager_FrameSurface(const frame_msg_payload_t *pFrame, void *pData, gfx_surface_t *pSurface)
+{
+    pSurface->height   = pFrame->height;
+    pSurface->width    = pFrame->width;
+    pSurface->pitch    = pFrame->pitch;
+    pSurface->left     = pFrame->left;
+    pSurface->top      = pFrame->top;
+    pSurface->right    = pFrame->right;
+    pSurface->bottom   = pFrame->bottom;
+    pSurface->swapByte = pFrame->swapByte;
+    pSurface->format   = pFrame->format;
+    pSurface->buf      = pData;
+    pSurface->lock     = NULL;
+}
+
+static int _FWK_CameraManager_Convert(const frame_msg_payload_t *pSrc,
+                                      void *pSrcData,
+                                      flip_mode_t flip,
+                                      const frame_msg_payload_t *pDst,
+                                      void *pDstData,
+                                      gfx_surface_t *pOverlay)
+{
+    gfx_surface_t srcSurface;
+    gfx_surface_t dstSurface;
+    gfx_plan_t plan;
+
+    _FWK_CameraManager_FrameSurface(pSrc, pSrcData, &srcSurface);
+    _FWK_CameraManager_FrameSurface(pDst, pDstData, &dstSurface);
+
+    if (gfx_plan(&plan, &srcSurface, pSrc->rotate, flip, &dstSurface, pDst->rotate, pOverlay) != 0)
+    {
+        LOGE("Cannot plan the conversion of format %d to %d", pSrc->format, pDst->format);
+        return -1;
+    }
+
+    return gfx_plan_run(&plan);
+}
+
 static void _FWK_CameraManager_DisplayResponse(camera_dev_t *pDev,
                                                fwk_message_t *pMsg,
                                                camera_task_data_t *pCameraTaskData)
@@ -187,101 +232,10 @@ static void _FWK_CameraManager_DisplayResponse(camera_dev_t *pDev,
             }
 
             /* send the display response message to display */
-            gfx_surface_t cameraSurface;
-            gfx_surface_t displaySurface;
-            gfx_rotate_config_t cameraToDisplayRotate;
-            flip_mode_t cameraFlip;
-            gfx_rotate_config_t *pRotate = NULL;
-            cw_rotate_degree_t srcRotate = pMsg->payload.frame.rotate;
-            cw_rotate_degree_t dstRotate = pCameraTaskData->displayRequestFrameInfo[i].frame.rotate;
-
-            if ((srcRotate == kCWRotateDegree_90) && (dstRotate == kCWRotateDegree_270))
-            {
-                srcRotate = kCWRotateDegree_0;
-                dstRotate = kCWRotateDegree_0;
-            }
-
-            /* source surface */
-            cameraSurface.pitch    = pMsg->payload.frame.pitch;
-            cameraSurface.format   = pMsg->payload.frame.format;
-            cameraSurface.swapByte = pMsg->payload.frame.swapByte;
-            cameraSurface.lock     = NULL;
-
-            if ((srcRotate == kCWRotateDegree_0) || (srcRotate == kCWRotateDegree_180))
-            {
-                cameraSurface.height = pMsg->payload.frame.height;
-                cameraSurface.width  = pMsg->payload.frame.width;
-                cameraSurface.left   = pMsg->payload.frame.left;
-                cameraSurface.top    = pMsg->payload.frame.top;
-                cameraSurface.right  = pMsg->payload.frame.right;
-                cameraSurface.bottom = pMsg->payload.frame.bottom;
-            }
-            else if ((srcRotate == kCWRotateDegree_90) || (srcRotate == kCWRotateDegree_270))
-            {
-                cameraSurface.height = pMsg->payload.frame.width;
-                cameraSurface.width  = pMsg->payload.frame.height;
-                cameraSurface.left   = pMsg->payload.frame.top;
-                cameraSurface.top    = pMsg->payload.frame.left;
-                cameraSurface.right  = pMsg->payload.frame.bottom;
-                cameraSurface.bottom = pMsg->payload.frame.right;
-            }
-
-            if ((srcRotate != kCWRotateDegree_0))
-            {
-                cameraToDisplayRotate.target = kGFXRotate_SRCSurface;
-                cameraToDisplayRotate.degree = srcRotate;
-                pRotate                      = &cameraToDisplayRotate;
-            }
-
-            /* flip */
-            cameraFlip        = pMsg->payload.frame.flip;
-            cameraSurface.buf = pMsg->payload.data;
-
-            /* dst surface */
-            displaySurface.height = pCameraTaskData->displayRequestFrameInfo[i].frame.height;
-            displaySurface.width  = pCameraTaskData->displayRequestFrameInfo[i].frame.width;
-            displaySurface.left   = pCameraTaskData->displayRequestFrameInfo[i].frame.left;
-            displaySurface.top    = pCameraTaskData->displayRequestFrameInfo[i].frame.top;
-            displaySurface.right  = pCameraTaskData->displayRequestFrameInfo[i].frame.right;
-            displaySurface.bottom = pCameraTaskData->displayRequestFrameInfo[i].frame.bottom;
-
-            /* rotate */
-            if (dstRotate != kCWRotateDegree_0)
-            {
-                if (srcRotate != kCWRotateDegree_0)
-                {
-                    LOGE("Cannot rotate both source and output");
-                    return;
-                }
-
-                cameraToDisplayRotate.target = kGFXRotate_DSTSurface;
-                cameraToDisplayRotate.degree = dstRotate;
-                pRotate                      = &cameraToDisplayRotate;
-
-                if (dstRotate == kCWRotateDegree_90 || dstRotate == kCWRotateDegree_270)
-                {
-                    displaySurface.left   = pCameraTaskData->displayRequestFrameInfo[i].frame.top;
-                    displaySurface.top    = pCameraTaskData->displayRequestFrameInfo[i].frame.left;
-                    displaySurface.right  = pCameraTaskData->displayRequestFrameInfo[i].frame.bottom;
-                    displaySurface.bottom = pCameraTaskData->displayRequestFrameInfo[i].frame.right;
-                    displaySurface.height = pCameraTaskData->displayRequestFrameInfo[i].frame.width;
-                    displaySurface.width  = pCameraTaskData->displayRequestFrameInfo[i].frame.height;
-                }
-            }
-
-            displaySurface.pitch  = pCameraTaskData->displayRequestFrameInfo[i].frame.pitch;
-            displaySurface.format = pCameraTaskData->displayRequestFrameInfo[i].frame.format;
-            displaySurface.buf    = pCameraTaskData->displayRequestFrameInfo[i].data;
-            displaySurface.lock   = NULL;
-
-            if (pCameraTaskData->pOverlaySurface == NULL)
-            {
-                gfx_blit(&cameraSurface, &displaySurface, pRotate, cameraFlip);
-            }
-            else
-            {
-                gfx_compose(&cameraSurface, pCameraTaskData->pOverlaySurface, &displaySurface, pRotate, cameraFlip);
-            }
+            _FWK_CameraManager_Convert(&pMsg->payload.frame, pMsg->payload.data, pMsg->payload.frame.flip,
+                                       &pCameraTaskData->displayRequestFrameInfo[i].frame,
+                                       pCameraTaskData->displayRequestFrameInfo[i].data,
+                                       pCameraTaskData->pOverlaySurface);
 
             fwk_message_t *pDisplayResMsg   = &pCameraTaskData->displayResponseMsg[i];
             pDisplayResMsg->payload.data    = pCameraTaskData->displayRequestFrameInfo[i].data;
@@ -295,6 +249,122 @@ static void _FWK_CameraManager_DisplayResponse(camera_dev_t *pDev,
     }
 }
 
+/*
+ * Narrow the camera frame and the algorithm frame to the region of interest. The camera buffer is offset to the
+ * source of the region and the region is packed at the top of the algorithm buffer, so only those pixels go through
+ * the PXP. pRoi is updated to the aligned region actually converted.
+ * Return -1 if the region cannot be cropped, the whole frame is converted then.
+ */
+static int _FWK_CameraManager_CropToRoi(frame_msg_payload_t *pSrc,
+                                        void **ppSrcData,
+                                        frame_msg_payload_t *pDst,
+                                        cw_rotate_degree_t rotate,
+                                        frame_roi_t *pRoi)
+{
+    int srcBpp     = gfx_bytes_per_pixel(pSrc->format);
+    int dstBpp     = gfx_bytes_per_pixel(pDst->format);
+    int srcWidth   = pSrc->right - pSrc->left + 1;
+    int srcHeight  = pSrc->bottom - pSrc->top + 1;
+    int viewWidth  = srcWidth;
+    int viewHeight = srcHeight;
+    int left, top, right, bottom;
+    int viewLeft, viewTop, viewRight, viewBottom;
+    int x0, y0, x1, y1;
+
+    if ((pRoi->scale != 1) && (pRoi->scale != 2))
+    {
+        return -1;
+    }
+
+    if ((srcBpp == 0) || (dstBpp == 0) || (pSrc->flip != kFlipMode_None))
+    {
+        return -1;
+    }
+
+    /* align the region to the PXP blocks and keep it in the frame */
+    left   = pRoi->left & ~(FWK_CAMERA_ROI_ALIGN - 1);
+    top    = pRoi->top & ~(FWK_CAMERA_ROI_ALIGN - 1);
+    right  = pRoi->right | (FWK_CAMERA_ROI_ALIGN - 1);
+    bottom = pRoi->bottom | (FWK_CAMERA_ROI_ALIGN - 1);
+    left   = (left < 0) ? 0 : left;
+    top    = (top < 0) ? 0 : top;
+    right  = (right >= pDst->width) ? (pDst->width - 1) : right;
+    bottom = (bottom >= pDst->height) ? (pDst->height - 1) : bottom;
+
+    if (((right - left + 1) < FWK_CAMERA_ROI_ALIGN) || ((bottom - top + 1) < FWK_CAMERA_ROI_ALIGN))
+    {
+        return -1;
+    }
+
+    /* the algorithm sees the camera active rect after the rotation */
+    if ((rotate == kCWRotateDegree_90) || (rotate == kCWRotateDegree_270))
+    {
+        viewWidth  = srcHeight;
+        viewHeight = srcWidth;
+    }
+
+    viewLeft   = left * viewWidth / pDst->width;
+    viewRight  = (right + 1) * viewWidth / pDst->width - 1;
+    viewTop    = top * viewHeight / pDst->height;
+    viewBottom = (bottom + 1) * viewHeight / pDst->height - 1;
+
+    /* back to the camera buffer orientation */
+    switch (rotate)
+    {
+        case kCWRotateDegree_90:
+            x0 = viewTop;
+            x1 = viewBottom;
+            y0 = srcHeight - 1 - viewRight;
+            y1 = srcHeight - 1 - viewLeft;
+            break;
+        case kCWRotateDegree_180:
+            x0 = srcWidth - 1 - viewRight;
+            x1 = srcWidth - 1 - viewLeft;
+            y0 = srcHeight - 1 - viewBottom;
+            y1 = srcHeight - 1 - viewTop;
+            break;
+        case kCWRotateDegree_270:
+            x0 = srcWidth - 1 - viewBottom;
+            x1 = srcWidth - 1 - viewTop;
+            y0 = viewLeft;
+            y1 = viewRight;
+            break;
+        default:
+            x0 = viewLeft;
+            x1 = viewRight;
+            y0 = viewTop;
+            y1 = viewBottom;
+            break;
+    }
+
+    /* keep whole macro pixels of the 4:2:2 formats */
+    x0 &= ~1;
+    x1 = ((x1 | 1) < srcWidth) ? (x1 | 1) : x1;
+
+    *ppSrcData   = (uint8_t *)*ppSrcData + (pSrc->top + y0) * pSrc->pitch + (pSrc->left + x0) * srcBpp;
+    pSrc->width  = x1 - x0 + 1;
+    pSrc->height = y1 - y0 + 1;
+    pSrc->left   = 0;
+    pSrc->top    = 0;
+    pSrc->right  = pSrc->width - 1;
+    pSrc->bottom = pSrc->height - 1;
+
+    pDst->width  = (right - left + 1) / pRoi->scale;
+    pDst->height = (bottom - top + 1) / pRoi->scale;
+    pDst->pitch  = pDst->width * dstBpp;
+    pDst->left   = 0;
+    pDst->top    = 0;
+    pDst->right  = pDst->width - 1;
+    pDst->bottom = pDst->height - 1;
+
+    pRoi->left   = left;
+    pRoi->top    = top;
+    pRoi->right  = right;
+    pRoi->bottom = bottom;
+
+    return 0;
+}
+
 static void _FWK_CameraManager_VisionAlgoResponse(camera_dev_t *pDev,
                                                   fwk_message_t *pMsg,
                                                   camera_task_data_t *pCameraTaskData)
@@ -313,88 +383,33 @@ static void _FWK_CameraManager_VisionAlgoResponse(camera_dev_t *pDev,
                 pDev->ops->postProcess(pDev, &(pMsg->payload.data), &(pMsg->payload.frame.format));
             }
 
-            gfx_surface_t cameraSurface;
-            gfx_rotate_config_t cameraToValgoRotate;
-            gfx_rotate_config_t *pRotate = NULL;
-
-            cw_rotate_degree_t srcRotate = pMsg->payload.frame.rotate;
-            cw_rotate_degree_t dstRotate = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.rotate;
-
-            if ((srcRotate == kCWRotateDegree_90) && (dstRotate == kCWRotateDegree_270))
-            {
-                srcRotate = kCWRotateDegree_0;
-                dstRotate = kCWRotateDegree_0;
-            }
-
-            /* source surface */
-            cameraSurface.pitch    = pMsg->payload.frame.pitch;
-            cameraSurface.format   = pMsg->payload.frame.format;
-            cameraSurface.swapByte = pMsg->payload.frame.swapByte;
-            cameraSurface.lock     = NULL;
-
-            if ((srcRotate == kCWRotateDegree_0) || (srcRotate == kCWRotateDegree_180))
-            {
-                cameraSurface.height = pMsg->payload.frame.height;
-                cameraSurface.width  = pMsg->payload.frame.width;
-                cameraSurface.left   = pMsg->payload.frame.left;
-                cameraSurface.top    = pMsg->payload.frame.top;
-                cameraSurface.right  = pMsg->payload.frame.right;
-                cameraSurface.bottom = pMsg->payload.frame.bottom;
-            }
-            else if ((srcRotate == kCWRotateDegree_90) || (srcRotate == kCWRotateDegree_270))
-            {
-                cameraSurface.height = pMsg->payload.frame.width;
-                cameraSurface.width  = pMsg->payload.frame.height;
-                cameraSurface.left   = pMsg->payload.frame.top;
-                cameraSurface.top    = pMsg->payload.frame.left;
-                cameraSurface.right  = pMsg->payload.frame.bottom;
-                cameraSurface.bottom = pMsg->payload.frame.right;
-            }
-
-            if (srcRotate != kCWRotateDegree_0)
-            {
-                cameraToValgoRotate.target = kGFXRotate_SRCSurface;
-                cameraToValgoRotate.degree = pMsg->payload.frame.rotate;
-                pRotate                    = &cameraToValgoRotate;
-            }
-
-            /* flip_mode_t cameraFlip = pMsg->frame.flip; */
-            cameraSurface.buf = pMsg->payload.data;
+            frame_msg_payload_t srcFrame = pMsg->payload.frame;
+            frame_msg_payload_t dstFrame = pCameraTaskData->vAlgoRequestFrameInfo[i].frame;
+            void *srcData                = pMsg->payload.data;
+            frame_roi_t roi              = dstFrame.roi;
 
-            gfx_surface_t algorithmSurface;
+            /* the algorithm frame is the camera frame turned by both rotations */
+            cw_rotate_degree_t rotate =
+                (cw_rotate_degree_t)((srcFrame.rotate + dstFrame.rotate) % (kCWRotateDegree_270 + 1));
 
-            algorithmSurface.height = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.height;
-            algorithmSurface.width  = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.width;
-            algorithmSurface.left   = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.left;
-            algorithmSurface.top    = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.top;
-            algorithmSurface.right  = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.right;
-            algorithmSurface.bottom = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.bottom;
-
-            /* rotate */
-            if (dstRotate != kCWRotateDegree_0)
+            /* convert only the region asked for by the algorithm */
+            if ((roi.scale != 0) && (_FWK_CameraManager_CropToRoi(&srcFrame, &srcData, &dstFrame, rotate, &roi) != 0))
             {
-                if (srcRotate != kCWRotateDegree_0)
-                {
-                    LOGE("Cannot rotate both source and output");
-                    return;
-                }
-
-                cameraToValgoRotate.target = kGFXRotate_DSTSurface;
-                cameraToValgoRotate.degree = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.rotate;
-                pRotate                    = &cameraToValgoRotate;
+                roi.scale = 0;
+                srcFrame  = pMsg->payload.frame;
+                dstFrame  = pCameraTaskData->vAlgoRequestFrameInfo[i].frame;
+                srcData   = pMsg->payload.data;
             }
 
-            algorithmSurface.pitch  = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.pitch;
-            algorithmSurface.format = pCameraTaskData->vAlgoRequestFrameInfo[i].frame.format;
-            algorithmSurface.buf    = pCameraTaskData->vAlgoRequestFrameInfo[i].data;
-            algorithmSurface.lock   = NULL;
-
-            gfx_blit(&cameraSurface, &algorithmSurface, pRotate, kFlipMode_None);
+            _FWK_CameraManager_Convert(&srcFrame, srcData, kFlipMode_None, &dstFrame,
+                                       pCameraTaskData->vAlgoRequestFrameInfo[i].data, NULL);
 
             fwk_message_t *pVAlgoResMsg = &pCameraTaskData->vAlgoResponseMsg[i];
             pVAlgoResMsg->payload.data  = pCameraTaskData->vAlgoRequestFrameInfo[i].data;
             pVAlgoResMsg->payload.devId = pCameraTaskData->vAlgoRequestFrameInfo[i].devId;
 
+            pVAlgoResMsg->payload.frame.roi = roi;
+
 #if FWK_SUPPORT_MULTICORE
             pVAlgoResMsg->multicore.isMulticoreMessage = 1;
             pVAlgoResMsg->multicore.taskId             = kFWKTaskID_VisionAlgo;
@@ -429,6 +444,10 @@ static void _FWK_CameraManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_
             {
                 memcpy((void *)&pCameraTaskData->displayRequestFrameInfo[displayDevId], (void *)&pMsg->payload,
                        sizeof(msg_payload_t));
+
+                /* the display is done scanning the buffer out */
+                FWK_Memory_TakeFromDevice(pMsg->payload.data, pMsg->payload.frame.pitch * pMsg->payload.frame.height,
+                                          kFWKMemAccess_DeviceReads);
             }
         }
         break;
@@ -476,6 +495,13 @@ static void _FWK_CameraManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_
             /* consume the dequeued valid frame */
             if (pMsg->payload.data != NULL)
             {
+                FWK_LpmManager_ResumeMark(kFWKLpmResume_FirstFrame);
+
+                /* postProcess may swap the frame for a converted one, the device gets back the one it filled */
+                void *pFrame       = pMsg->payload.data;
+                uint32_t frameSize = (pDev != NULL) ? pDev->config.pitch * pDev->config.height : 0;
+                FWK_Memory_TakeFromDevice(pFrame, frameSize, kFWKMemAccess_DeviceWrites);
+
                 /* handle the display response */
                 _FWK_CameraManager_DisplayResponse(pDev, pMsg, pCameraTaskData);
 
@@ -485,6 +511,7 @@ static void _FWK_CameraManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_
                 /* enqueue a new camera buffer request */
                 if (pDev != NULL && pDev->ops->enqueue != NULL)
                 {
+                    FWK_Memory_GiveToDevice(pFrame, frameSize, kFWKMemAccess_DeviceWrites);
                     error = pDev->ops->enqueue(pDev, NULL);
 
                     if (error)
@@ -17,6 +17,7 @@
 #include "fwk_task.h"
 #include "fwk_perf.h"
 #include "fwk_graphics.h"
+#include "fwk_memory.h"
 #include "fwk_display_manager.h"
 
 typedef struct
@@ -180,6 +181,9 @@ static void _FWK_DisplayManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data
                 {
                     hal_display_status_t status;
                     LOGI("Frame received for display w/ id #%d", pMsg->payload.devId);
+                    /* the device owns the frame until it requests it again */
+                    FWK_Memory_GiveToDevice(pMsg->payload.data, pDev->cap.pitch * pDev->cap.height,
+                                            kFWKMemAccess_DeviceReads);
                     status = pDev->ops->blit(pDev, pMsg->payload.data, pDev->cap.width, pDev->cap.height);
 
                     if (status == kStatus_HAL_DisplaySuccess)
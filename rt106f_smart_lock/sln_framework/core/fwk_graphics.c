@@ -11,13 +11,49 @@
  * @brief GPU manager framework implementation.
  */
 
+#ifdef FWK_GRAPHICS_HOST
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOGD(fmt, ...)
+#define LOGI(fmt, ...) printf(fmt "\n", ##__VA_ARGS__)
+#define LOGE(fmt, ...) printf("[ERROR] " fmt "\n", ##__VA_ARGS__)
+
+#define FWK_MALLOC malloc
+#define FWK_FREE   free
+
+#define GFX_PLAN_STRIP_SECTION
+
+static unsigned int FWK_CurrentTimeUs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned int)(now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+#else
 #include "fwk_platform.h"
 #include "fwk_log.h"
 #include "fwk_message.h"
+
+/* the strips are read and written by the PXP right after the CPU set them up, keep them in the OCRAM */
+#ifndef GFX_PLAN_STRIP_SECTION
+#define GFX_PLAN_STRIP_SECTION __attribute__((section(".bss.$SRAM_OCRAM_CACHED,\"aw\",%nobits @")))
+#endif /* GFX_PLAN_STRIP_SECTION */
+#endif /* FWK_GRAPHICS_HOST */
+
 #include "fwk_graphics.h"
+#include "fwk_memory.h"
 
 static gfx_dev_t *gGfxDev = NULL;
 
+GFX_PLAN_STRIP_SECTION static uint8_t s_PlanStrip[GFX_PLAN_STRIP_SIZE] __attribute__((aligned(FWK_MEM_CACHE_LINE)));
+#ifndef FWK_GRAPHICS_HOST
+static bool s_PlanStripTracked = false;
+#endif /* FWK_GRAPHICS_HOST */
+
 int gfx_manager_init()
 {
     return 0;
@@ -40,6 +76,10 @@ int gfx_blit(gfx_surface_t *pSrc, gfx_surface_t *pDst, gfx_rotate_config_t *pRot
 {
     int ret = -1;
 
+    /* the surfaces may be rotated, only the start of their buffers is checked */
+    FWK_Memory_CheckCpuAccess(pSrc->buf, 1, "gfx_blit source");
+    FWK_Memory_CheckCpuAccess(pDst->buf, 1, "gfx_blit destination");
+
     if (gGfxDev != NULL && gGfxDev->ops->blit != NULL)
     {
         ret = gGfxDev->ops->blit(gGfxDev, pSrc, pDst, pRotate, flip);
@@ -89,6 +129,9 @@ int gfx_compose(
 {
     int ret = -1;
 
+    FWK_Memory_CheckCpuAccess(pSrc->buf, 1, "gfx_compose source");
+    FWK_Memory_CheckCpuAccess(pDst->buf, 1, "gfx_compose destination");
+
     if (gGfxDev != NULL && gGfxDev->ops->compose != NULL)
     {
         ret = gGfxDev->ops->compose(gGfxDev, pSrc, pOverlay, pDst, pRotate, flip);
@@ -102,3 +145,635 @@ int gfx_dev_register(gfx_dev_t *dev)
     gGfxDev = dev;
     return 0;
 }
+
+int gfx_bytes_per_pixel(pixel_format_t format)
+{
+    switch (format)
+    {
+        case kPixelFormat_Gray:
+        case kPixelFormat_Depth8:
+            return 1;
+        case kPixelFormat_RGB565:
+        case kPixelFormat_Gray16:
+        case kPixelFormat_UYVY1P422_RGB:
+        case kPixelFormat_UYVY1P422_Gray:
+        case kPixelFormat_VYUY1P422:
+        case kPixelFormat_Depth16:
+            return 2;
+        case kPixelFormat_RGB:
+        case kPixelFormat_BGR:
+        case kPixelFormat_Gray888:
+            return 3;
+        case kPixelFormat_Gray888X:
+        case kPixelFormat_YUV1P444_RGB:
+        case kPixelFormat_YUV1P444_Gray:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+/* swap a surface to the orientation of the view, the PXP takes a rotated process surface that way */
+static void _gfx_plan_swap(gfx_surface_t *pSurface)
+{
+    int tmp          = pSurface->height;
+    pSurface->height = pSurface->width;
+    pSurface->width  = tmp;
+    tmp              = pSurface->left;
+    pSurface->left   = pSurface->top;
+    pSurface->top    = tmp;
+    tmp              = pSurface->right;
+    pSurface->right  = pSurface->bottom;
+    pSurface->bottom = tmp;
+}
+
+/* format of the strips, the PXP must write it and read it back without losing the source precision */
+static pixel_format_t _gfx_plan_strip_format(pixel_format_t srcFormat, pixel_format_t dstFormat)
+{
+    switch (dstFormat)
+    {
+        case kPixelFormat_BGR:
+        case kPixelFormat_RGB565:
+        case kPixelFormat_YUV1P444_RGB:
+        case kPixelFormat_YUV1P444_Gray:
+        case kPixelFormat_UYVY1P422_RGB:
+        case kPixelFormat_UYVY1P422_Gray:
+        case kPixelFormat_VYUY1P422:
+            break;
+        default:
+            return kPixelFormat_Invalid;
+    }
+
+    switch (srcFormat)
+    {
+        case kPixelFormat_YUV1P444_Gray:
+        case kPixelFormat_UYVY1P422_Gray:
+            return kPixelFormat_YUV1P444_Gray;
+        case kPixelFormat_YUV1P444_RGB:
+        case kPixelFormat_UYVY1P422_RGB:
+        case kPixelFormat_VYUY1P422:
+            return kPixelFormat_YUV1P444_RGB;
+        case kPixelFormat_RGB565:
+            return kPixelFormat_RGB565;
+        case kPixelFormat_Gray888X:
+            /* the gray converted from Gray16 and Depth16, the PXP cannot write it back */
+            return (dstFormat == kPixelFormat_RGB565) ? kPixelFormat_RGB565 : kPixelFormat_Invalid;
+        default:
+            return kPixelFormat_Invalid;
+    }
+}
+
+int gfx_plan(gfx_plan_t *pPlan,
+             const gfx_surface_t *pSrc,
+             cw_rotate_degree_t srcRotate,
+             flip_mode_t flip,
+             const gfx_surface_t *pDst,
+             cw_rotate_degree_t dstRotate,
+             gfx_surface_t *pOverlay)
+{
+    if ((pPlan == NULL) || (pSrc == NULL) || (pDst == NULL) || (pSrc->buf == NULL) || (pDst->buf == NULL))
+    {
+        return -1;
+    }
+
+    int srcWidth  = pSrc->right - pSrc->left + 1;
+    int srcHeight = pSrc->bottom - pSrc->top + 1;
+    int dstWidth  = pDst->right - pDst->left + 1;
+    int dstHeight = pDst->bottom - pDst->top + 1;
+
+    if ((srcWidth <= 0) || (srcHeight <= 0) || (dstWidth <= 0) || (dstHeight <= 0))
+    {
+        LOGE("Empty conversion rect");
+        return -1;
+    }
+
+    pPlan->src         = *pSrc;
+    pPlan->dst         = *pDst;
+    pPlan->pOverlay    = pOverlay;
+    pPlan->rotate      = (cw_rotate_degree_t)((srcRotate + dstRotate) % (kCWRotateDegree_270 + 1));
+    pPlan->flip        = flip;
+    pPlan->stripFormat = kPixelFormat_Invalid;
+    pPlan->passes      = 1;
+    pPlan->strips      = 1;
+    pPlan->stripLines  = dstHeight;
+
+    if ((pPlan->rotate != kCWRotateDegree_90) && (pPlan->rotate != kCWRotateDegree_270))
+    {
+        return 0;
+    }
+
+    /* rotated by a quarter, the source is scaled if its view does not have the destination size */
+    if ((srcWidth == dstHeight) && (srcHeight == dstWidth))
+    {
+        return 0;
+    }
+
+    /* the strips are columns of the scaled source before the rotation, they become lines of the destination */
+    pixel_format_t stripFormat = _gfx_plan_strip_format(pSrc->format, pDst->format);
+    int stripColumnSize        = dstWidth * gfx_bytes_per_pixel(stripFormat);
+    int stripLines             = 0;
+
+    if (stripColumnSize > 0)
+    {
+        stripLines = (GFX_PLAN_STRIP_SIZE / stripColumnSize) & ~(GFX_PLAN_STRIP_ALIGN - 1);
+    }
+
+    if (stripLines == 0)
+    {
+        /* left to the device in one pass, which may not support this scale with a quarter rotation */
+        LOGD("Conversion %d to %d of %dx%d not planned in strips", pSrc->format, pDst->format, dstWidth, dstHeight);
+        return 0;
+    }
+
+    stripLines         = (stripLines > dstHeight) ? dstHeight : stripLines;
+    pPlan->stripFormat = stripFormat;
+    pPlan->passes      = 2;
+    pPlan->stripLines  = stripLines;
+    pPlan->strips      = (dstHeight + stripLines - 1) / stripLines;
+
+    return 0;
+}
+
+static int _gfx_plan_run_single(const gfx_plan_t *pPlan)
+{
+    gfx_surface_t src          = pPlan->src;
+    gfx_surface_t dst          = pPlan->dst;
+    gfx_rotate_config_t rotate = {kGFXRotate_SRCSurface, pPlan->rotate};
+
+    if ((pPlan->rotate == kCWRotateDegree_90) || (pPlan->rotate == kCWRotateDegree_270))
+    {
+        _gfx_plan_swap(&src);
+    }
+
+    if (pPlan->pOverlay == NULL)
+    {
+        return gfx_blit(&src, &dst, &rotate, pPlan->flip);
+    }
+
+    return gfx_compose(&src, pPlan->pOverlay, &dst, &rotate, pPlan->flip);
+}
+
+/* the strips only write the rect of the destination, clear the rest as a single pass would */
+static void _gfx_plan_clear_margins(const gfx_surface_t *pDst)
+{
+    int bpp    = gfx_bytes_per_pixel(pDst->format);
+    uint8_t *p = (uint8_t *)pDst->buf;
+
+    if ((pDst->left == 0) && (pDst->top == 0) && (pDst->right == pDst->width - 1) &&
+        (pDst->bottom == pDst->height - 1))
+    {
+        return;
+    }
+
+    for (int y = 0; y < pDst->height; y++, p += pDst->pitch)
+    {
+        if ((y < pDst->top) || (y > pDst->bottom))
+        {
+            memset(p, 0, pDst->width * bpp);
+            continue;
+        }
+
+        memset(p, 0, pDst->left * bpp);
+        memset(p + (pDst->right + 1) * bpp, 0, (pDst->width - pDst->right - 1) * bpp);
+    }
+}
+
+static int _gfx_plan_run_strips(const gfx_plan_t *pPlan)
+{
+    int error                  = 0;
+    int srcBpp                 = gfx_bytes_per_pixel(pPlan->src.format);
+    int stripBpp               = gfx_bytes_per_pixel(pPlan->stripFormat);
+    int dstBpp                 = gfx_bytes_per_pixel(pPlan->dst.format);
+    int srcWidth               = pPlan->src.right - pPlan->src.left + 1;
+    int srcHeight              = pPlan->src.bottom - pPlan->src.top + 1;
+    int dstWidth               = pPlan->dst.right - pPlan->dst.left + 1;
+    int dstHeight              = pPlan->dst.bottom - pPlan->dst.top + 1;
+    uint8_t *pSrcBuf           = (uint8_t *)pPlan->src.buf + pPlan->src.top * pPlan->src.pitch;
+    uint8_t *pDstBuf           = (uint8_t *)pPlan->dst.buf + pPlan->dst.top * pPlan->dst.pitch;
+    bool flipColumns           = (pPlan->flip == kFlipMode_Horizontal) || (pPlan->flip == kFlipMode_Both);
+    gfx_rotate_config_t scale  = {kGFXRotate_SRCSurface, kCWRotateDegree_0};
+    gfx_rotate_config_t rotate = {kGFXRotate_SRCSurface, pPlan->rotate};
+
+#ifndef FWK_GRAPHICS_HOST
+    if (!s_PlanStripTracked)
+    {
+        FWK_Memory_Track(kFWKMemRegion_OcramCached, kFWKMemOwner_Graphics, s_PlanStrip, sizeof(s_PlanStrip),
+                         "gfx strip");
+        s_PlanStripTracked = true;
+    }
+#endif /* FWK_GRAPHICS_HOST */
+
+    pSrcBuf += pPlan->src.left * srcBpp;
+    pDstBuf += pPlan->dst.left * dstBpp;
+
+    _gfx_plan_clear_margins(&pPlan->dst);
+
+    /* the scaled source is dstHeight columns of dstWidth lines before the rotation */
+    for (int y0 = 0; y0 < dstHeight; y0 += pPlan->stripLines)
+    {
+        int lines = ((dstHeight - y0) < pPlan->stripLines) ? (dstHeight - y0) : pPlan->stripLines;
+        int c0    = (pPlan->rotate == kCWRotateDegree_90) ? y0 : (dstHeight - y0 - lines);
+        int u0    = flipColumns ? (dstHeight - c0 - lines) : c0;
+
+        /* source columns of the strip, whole macro pixels of the 4:2:2 formats */
+        int x0 = (u0 * srcWidth / dstHeight) & ~1;
+        int x1 = ((u0 + lines) * srcWidth / dstHeight + 1) & ~1;
+        x1     = (x1 > srcWidth) ? srcWidth : x1;
+
+        gfx_surface_t srcStrip = pPlan->src;
+        srcStrip.buf           = pSrcBuf + x0 * srcBpp;
+        srcStrip.width         = x1 - x0;
+        srcStrip.height        = srcHeight;
+        srcStrip.left          = 0;
+        srcStrip.top           = 0;
+        srcStrip.right         = srcStrip.width - 1;
+        srcStrip.bottom        = srcStrip.height - 1;
+        srcStrip.lock          = NULL;
+
+        gfx_surface_t strip;
+        strip.buf      = s_PlanStrip;
+        strip.width    = lines;
+        strip.height   = dstWidth;
+        strip.pitch    = lines * stripBpp;
+        strip.left     = 0;
+        strip.top      = 0;
+        strip.right    = strip.width - 1;
+        strip.bottom   = strip.height - 1;
+        strip.format   = pPlan->stripFormat;
+        strip.swapByte = 0;
+        strip.lock     = NULL;
+
+        /* first pass scales, flips and keeps the source colors */
+        error = gfx_blit(&srcStrip, &strip, &scale, pPlan->flip);
+        if (error != 0)
+        {
+            LOGE("Strip %d scale failed", y0 / pPlan->stripLines);
+            return error;
+        }
+
+        gfx_surface_t dstStrip = pPlan->dst;
+        dstStrip.buf           = pDstBuf + y0 * pPlan->dst.pitch;
+        dstStrip.width         = dstWidth;
+        dstStrip.height        = lines;
+        dstStrip.left          = 0;
+        dstStrip.top           = 0;
+        dstStrip.right         = dstWidth - 1;
+        dstStrip.bottom        = lines - 1;
+        dstStrip.lock          = NULL;
+
+        /* second pass rotates, converts the colors and composes the overlay, without scaling */
+        _gfx_plan_swap(&strip);
+
+        gfx_surface_t *pOverlay = pPlan->pOverlay;
+        gfx_surface_t overlay;
+
+        if (pOverlay != NULL)
+        {
+            int top    = pPlan->dst.top + y0;
+            int bottom = top + lines - 1;
+            int ox0    = (pOverlay->left > pPlan->dst.left) ? pOverlay->left : pPlan->dst.left;
+            int ox1    = (pOverlay->right < pPlan->dst.right) ? pOverlay->right : pPlan->dst.right;
+            int oy0    = (pOverlay->top > top) ? pOverlay->top : top;
+            int oy1    = (pOverlay->bottom < bottom) ? pOverlay->bottom : bottom;
+
+            if ((ox0 > ox1) || (oy0 > oy1))
+            {
+                pOverlay = NULL;
+            }
+            else
+            {
+                overlay        = *pOverlay;
+                overlay.buf    = (uint8_t *)pOverlay->buf + (oy0 - pOverlay->top) * pOverlay->pitch +
+                              (ox0 - pOverlay->left) * gfx_bytes_per_pixel(pOverlay->format);
+                overlay.left   = ox0 - pPlan->dst.left;
+                overlay.right  = ox1 - pPlan->dst.left;
+                overlay.top    = oy0 - top;
+                overlay.bottom = oy1 - top;
+                pOverlay       = &overlay;
+            }
+        }
+
+        if (pOverlay == NULL)
+        {
+            error = gfx_blit(&strip, &dstStrip, &rotate, kFlipMode_None);
+        }
+        else
+        {
+            error = gfx_compose(&strip, pOverlay, &dstStrip, &rotate, kFlipMode_None);
+        }
+
+        if (error != 0)
+        {
+            LOGE("Strip %d rotation failed", y0 / pPlan->stripLines);
+            return error;
+        }
+    }
+
+    return error;
+}
+
+int gfx_plan_run(const gfx_plan_t *pPlan)
+{
+    if (pPlan == NULL)
+    {
+        return -1;
+    }
+
+    if (gGfxDev == NULL)
+    {
+        return gfx_plan_run_reference(pPlan);
+    }
+
+    if (pPlan->passes == 2)
+    {
+        return _gfx_plan_run_strips(pPlan);
+    }
+
+    return _gfx_plan_run_single(pPlan);
+}
+
+static uint8_t _gfx_ref_clamp(int value)
+{
+    return (value < 0) ? 0 : ((value > 255) ? 255 : (uint8_t)value);
+}
+
+/* BT.601 studio range, as the PXP color space converter */
+static void _gfx_ref_yuv_to_rgb(int y, int u, int v, uint8_t *pRgb)
+{
+    int c   = 298 * (y - 16);
+    int d   = u - 128;
+    int e   = v - 128;
+    pRgb[0] = _gfx_ref_clamp((c + 409 * e + 128) >> 8);
+    pRgb[1] = _gfx_ref_clamp((c - 100 * d - 208 * e + 128) >> 8);
+    pRgb[2] = _gfx_ref_clamp((c + 516 * d + 128) >> 8);
+}
+
+static void _gfx_ref_rgb_to_yuv(const uint8_t *pRgb, uint8_t *pYuv)
+{
+    int r   = pRgb[0];
+    int g   = pRgb[1];
+    int b   = pRgb[2];
+    pYuv[0] = _gfx_ref_clamp(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    pYuv[1] = _gfx_ref_clamp(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    pYuv[2] = _gfx_ref_clamp(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+/* read the pixel x, y of a surface as R, G, B */
+static int _gfx_ref_read(const gfx_surface_t *pSurface, int x, int y, uint8_t *pRgb)
+{
+    const uint8_t *p = (const uint8_t *)pSurface->buf + y * pSurface->pitch;
+    uint16_t rgb565;
+
+    switch (pSurface->format)
+    {
+        case kPixelFormat_RGB565:
+            p += x * 2;
+            rgb565  = pSurface->swapByte ? ((p[0] << 8) | p[1]) : ((p[1] << 8) | p[0]);
+            pRgb[0] = ((rgb565 >> 11) & 0x1F) << 3;
+            pRgb[1] = ((rgb565 >> 5) & 0x3F) << 2;
+            pRgb[2] = (rgb565 & 0x1F) << 3;
+            break;
+        case kPixelFormat_RGB:
+            p += x * 3;
+            pRgb[0] = p[0];
+            pRgb[1] = p[1];
+            pRgb[2] = p[2];
+            break;
+        case kPixelFormat_BGR:
+        case kPixelFormat_Gray888:
+            p += x * 3;
+            pRgb[0] = p[2];
+            pRgb[1] = p[1];
+            pRgb[2] = p[0];
+            break;
+        case kPixelFormat_Gray888X:
+            p += x * 4;
+            pRgb[0] = p[2];
+            pRgb[1] = p[1];
+            pRgb[2] = p[0];
+            break;
+        case kPixelFormat_Gray:
+            pRgb[0] = pRgb[1] = pRgb[2] = p[x];
+            break;
+        case kPixelFormat_YUV1P444_RGB:
+        case kPixelFormat_YUV1P444_Gray:
+            p += x * 4;
+            _gfx_ref_yuv_to_rgb(p[2], p[1], p[0], pRgb);
+            break;
+        case kPixelFormat_UYVY1P422_RGB:
+        case kPixelFormat_UYVY1P422_Gray:
+            p += (x & ~1) * 2;
+            _gfx_ref_yuv_to_rgb(p[(x & 1) ? 3 : 1], p[0], p[2], pRgb);
+            break;
+        case kPixelFormat_VYUY1P422:
+            p += (x & ~1) * 2;
+            _gfx_ref_yuv_to_rgb(p[(x & 1) ? 3 : 1], p[2], p[0], pRgb);
+            break;
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
+/* write R, G, B to the pixel x, y of a surface */
+static int _gfx_ref_write(const gfx_surface_t *pSurface, int x, int y, const uint8_t *pRgb)
+{
+    uint8_t *p = (uint8_t *)pSurface->buf + y * pSurface->pitch;
+    uint8_t yuv[3];
+    uint16_t rgb565;
+
+    switch (pSurface->format)
+    {
+        case kPixelFormat_RGB565:
+            p += x * 2;
+            rgb565 = ((pRgb[0] >> 3) << 11) | ((pRgb[1] >> 2) << 5) | (pRgb[2] >> 3);
+            p[0]   = rgb565 & 0xFF;
+            p[1]   = rgb565 >> 8;
+            break;
+        case kPixelFormat_RGB:
+            p += x * 3;
+            p[0] = pRgb[0];
+            p[1] = pRgb[1];
+            p[2] = pRgb[2];
+            break;
+        case kPixelFormat_BGR:
+            p += x * 3;
+            p[0] = pRgb[2];
+            p[1] = pRgb[1];
+            p[2] = pRgb[0];
+            break;
+        case kPixelFormat_YUV1P444_RGB:
+        case kPixelFormat_YUV1P444_Gray:
+            p += x * 4;
+            _gfx_ref_rgb_to_yuv(pRgb, yuv);
+            p[0] = yuv[2];
+            p[1] = yuv[1];
+            p[2] = yuv[0];
+            p[3] = 0;
+            break;
+        case kPixelFormat_UYVY1P422_RGB:
+        case kPixelFormat_UYVY1P422_Gray:
+        case kPixelFormat_VYUY1P422:
+            /* the chroma of a macro pixel is taken from its first pixel */
+            p += (x & ~1) * 2;
+            _gfx_ref_rgb_to_yuv(pRgb, yuv);
+            p[(x & 1) ? 3 : 1] = yuv[0];
+            if ((x & 1) == 0)
+            {
+                p[0] = (pSurface->format == kPixelFormat_VYUY1P422) ? yuv[2] : yuv[1];
+                p[2] = (pSurface->format == kPixelFormat_VYUY1P422) ? yuv[1] : yuv[2];
+            }
+            break;
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
+int gfx_plan_run_reference(const gfx_plan_t *pPlan)
+{
+    if (pPlan == NULL)
+    {
+        return -1;
+    }
+
+    const gfx_surface_t *pSrc     = &pPlan->src;
+    const gfx_surface_t *pDst     = &pPlan->dst;
+    const gfx_surface_t *pOverlay = pPlan->pOverlay;
+    int srcWidth                  = pSrc->right - pSrc->left + 1;
+    int srcHeight                 = pSrc->bottom - pSrc->top + 1;
+    int dstWidth                  = pDst->right - pDst->left + 1;
+    int dstHeight                 = pDst->bottom - pDst->top + 1;
+    bool quarter                  = (pPlan->rotate == kCWRotateDegree_90) || (pPlan->rotate == kCWRotateDegree_270);
+    int viewWidth                 = quarter ? srcHeight : srcWidth;
+    int viewHeight                = quarter ? srcWidth : srcHeight;
+    uint8_t rgb[3];
+
+    _gfx_plan_clear_margins(pDst);
+
+    for (int v = 0; v < dstHeight; v++)
+    {
+        for (int u = 0; u < dstWidth; u++)
+        {
+            /* sample at the pixel centers, a mirrored conversion picks the mirrored pixels */
+            int px = (2 * u + 1) * viewWidth / (2 * dstWidth);
+            int py = (2 * v + 1) * viewHeight / (2 * dstHeight);
+            int x, y;
+
+            /* back to the source orientation */
+            switch (pPlan->rotate)
+            {
+                case kCWRotateDegree_90:
+                    x = py;
+                    y = srcHeight - 1 - px;
+                    break;
+                case kCWRotateDegree_180:
+                    x = srcWidth - 1 - px;
+                    y = srcHeight - 1 - py;
+                    break;
+                case kCWRotateDegree_270:
+                    x = srcWidth - 1 - py;
+                    y = px;
+                    break;
+                default:
+                    x = px;
+                    y = py;
+                    break;
+            }
+
+            if ((pPlan->flip == kFlipMode_Horizontal) || (pPlan->flip == kFlipMode_Both))
+            {
+                x = srcWidth - 1 - x;
+            }
+
+            if ((pPlan->flip == kFlipMode_Vertical) || (pPlan->flip == kFlipMode_Both))
+            {
+                y = srcHeight - 1 - y;
+            }
+
+            if (_gfx_ref_read(pSrc, pSrc->left + x, pSrc->top + y, rgb) != 0)
+            {
+                LOGE("Reference cannot read format %d", pSrc->format);
+                return -1;
+            }
+
+            /* the overlay is keyed on black, as the device composes it */
+            int ox = pDst->left + u;
+            int oy = pDst->top + v;
+            if ((pOverlay != NULL) && (ox >= pOverlay->left) && (ox <= pOverlay->right) && (oy >= pOverlay->top) &&
+                (oy <= pOverlay->bottom))
+            {
+                gfx_surface_t overlay = *pOverlay;
+                uint8_t overlayRgb[3];
+
+                overlay.swapByte = 0;
+                if ((_gfx_ref_read(&overlay, ox - pOverlay->left, oy - pOverlay->top, overlayRgb) == 0) &&
+                    ((overlayRgb[0] | overlayRgb[1] | overlayRgb[2]) != 0))
+                {
+                    memcpy(rgb, overlayRgb, sizeof(rgb));
+                }
+            }
+
+            if (_gfx_ref_write(pDst, ox, oy, rgb) != 0)
+            {
+                LOGE("Reference cannot write format %d", pDst->format);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int gfx_plan_benchmark(const gfx_plan_t *pPlan, int runs)
+{
+    int error          = 0;
+    uint32_t size      = pPlan->dst.pitch * pPlan->dst.height;
+    uint8_t *pExpected = (uint8_t *)FWK_MALLOC(size);
+    unsigned int deviceUs;
+    unsigned int referenceUs;
+    unsigned int start;
+    uint64_t difference = 0;
+
+    if ((pExpected == NULL) || (runs <= 0))
+    {
+        LOGE("Cannot benchmark the plan");
+        FWK_FREE(pExpected);
+        return -1;
+    }
+
+    start = FWK_CurrentTimeUs();
+    for (int i = 0; (i < runs) && (error == 0); i++)
+    {
+        error = gfx_plan_run(pPlan);
+    }
+    deviceUs = FWK_CurrentTimeUs() - start;
+
+    gfx_plan_t reference = *pPlan;
+    reference.dst.buf    = pExpected;
+
+    start = FWK_CurrentTimeUs();
+    for (int i = 0; (i < runs) && (error == 0); i++)
+    {
+        error = gfx_plan_run_reference(&reference);
+    }
+    referenceUs = FWK_CurrentTimeUs() - start;
+
+    if (error == 0)
+    {
+        const uint8_t *pActual = (const uint8_t *)pPlan->dst.buf;
+        for (uint32_t i = 0; i < size; i++)
+        {
+            difference += (pActual[i] > pExpected[i]) ? (pActual[i] - pExpected[i]) : (pExpected[i] - pActual[i]);
+        }
+
+        LOGI("Plan %d strips of %d passes: device %uus, reference %uus per run, mean difference %u.%02u",
+             pPlan->strips, pPlan->passes, deviceUs / runs, referenceUs / runs, (unsigned int)(difference / size),
+             (unsigned int)((difference * 100 / size) % 100));
+    }
+
+    FWK_FREE(pExpected);
+    return error;
+}
@@ -32,14 +32,31 @@ typedef struct
     input_task_data_t inputData;
 } input_task_t;
 
+/* Tasks interested in an event id, the first word of the input payload */
+typedef struct _input_subscription
+{
+    uint32_t eventId;
+    uint32_t taskMask;
+} input_subscription_t;
+
+typedef struct _input_subscriptions
+{
+    input_subscription_t entries[FWK_INPUT_SUBSCRIPTION_MAX];
+    /* tasks with at least one subscription, only those are filtered */
+    uint32_t filteredMask;
+} input_subscriptions_t;
+
 static int _FWK_InputManager_TaskInit(fwk_task_data_t *pTaskData);
 static int _FWK_InputManager_DeviceCallback(const input_dev_t *dev, input_event_t *event, uint8_t fromISR);
 static void _FWK_InputManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_t *pTaskData);
+static void _FWK_InputManager_Broadcast(fwk_message_t *pMsg);
 
 /*
  * input manager task
  */
 static input_task_t s_InputTask;
+static input_subscriptions_t s_InputSubscriptions;
+static fwk_input_stats_t s_InputStats;
 
 #if FWK_SUPPORT_STATIC_ALLOCATION
 FWKDATA static StackType_t s_InputTaskStack[INPUT_MANAGER_TASK_STACK];
@@ -213,54 +230,7 @@ static void _FWK_InputManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_t
 #endif /* FWK_SUPPORT_MULTICORE */
             )
             {
-                uint32_t receiverList = pMsg->payload.input.receiverList;
-
-                for (int i = kFWKTaskID_Camera; i < kFWKTaskID_COUNT; i++)
-                {
-                    if (receiverList & 1 << i)
-                    {
-                        if (FWK_Task_IsRegistered(i) == false)
-                        {
-                            continue;
-                        }
-
-                        fwk_message_t *Msg = (fwk_message_t *)FWK_MALLOC(sizeof(fwk_message_t));
-                        if (Msg != NULL)
-                        {
-                            memset(Msg, 0, sizeof(fwk_message_t));
-                            Msg->freeAfterConsumed = 1;
-                            Msg->id                = kFWKMessageID_InputNotify;
-                            Msg->payload.devId     = pMsg->payload.devId;
-                            if (pMsg->payload.input.copy)
-                            {
-                                Msg->payload.data = FWK_MALLOC(pMsg->payload.size);
-
-                                if (Msg->payload.data != NULL)
-                                {
-                                    memcpy(Msg->payload.data, pMsg->payload.data, pMsg->payload.size);
-                                    Msg->payload.freeAfterConsumed = 1;
-                                }
-                                else
-                                {
-                                    LOGE("Can't allocate memory for msg raw data in kFWKMessageID_InputReceive.");
-                                    FWK_FREE(Msg);
-                                    continue;
-                                }
-                            }
-                            else
-                            {
-                                Msg->payload.data              = pMsg->payload.data;
-                                Msg->payload.freeAfterConsumed = 0;
-                            }
-                            Msg->payload.size = pMsg->payload.size;
-                            FWK_Message_Put(i, &Msg);
-                        }
-                        else
-                        {
-                            LOGE("Can't allocate memory for msg in kFWKMessageID_InputReceive.");
-                        }
-                    }
-                }
+                _FWK_InputManager_Broadcast(pMsg);
             }
 
             if (pMsg->payload.freeAfterConsumed)
@@ -307,6 +277,111 @@ static void _FWK_InputManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_t
     }
 }
 
+static unsigned int _FWK_InputManager_TaskCount(uint32_t taskMask)
+{
+    unsigned int count = 0;
+
+    for (; taskMask != 0; taskMask &= (taskMask - 1))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+/* Receivers of an event, a task that subscribed to event ids only gets those */
+static uint32_t _FWK_InputManager_Receivers(uint32_t receiverList, const void *data, unsigned int size)
+{
+    uint32_t receivers = receiverList;
+    uint32_t eventId;
+
+    if ((data == NULL) || (size < sizeof(uint32_t)) || ((receiverList & s_InputSubscriptions.filteredMask) == 0))
+    {
+        return receivers;
+    }
+
+    memcpy(&eventId, data, sizeof(eventId));
+    receivers &= ~s_InputSubscriptions.filteredMask;
+    for (int i = 0; i < FWK_INPUT_SUBSCRIPTION_MAX; i++)
+    {
+        input_subscription_t *pEntry = &s_InputSubscriptions.entries[i];
+
+        if ((pEntry->taskMask != 0) && (pEntry->eventId == eventId))
+        {
+            receivers |= (receiverList & pEntry->taskMask);
+            break;
+        }
+    }
+
+    return receivers;
+}
+
+/* One message and one copy of the payload shared by all the receivers, the last one to release it frees both */
+static void _FWK_InputManager_Broadcast(fwk_message_t *pMsg)
+{
+    uint32_t receiverList = pMsg->payload.input.receiverList;
+    uint32_t receivers    = 0;
+    unsigned int copySize = 0;
+    unsigned int targets;
+    fwk_message_t *pNotify;
+    int delivered;
+
+    /* a payload freed once the event is handled needs a copy too */
+    if (pMsg->payload.input.copy || pMsg->payload.freeAfterConsumed)
+    {
+        copySize = pMsg->payload.size;
+    }
+
+    for (int i = kFWKTaskID_Camera; i < kFWKTaskID_COUNT; i++)
+    {
+        if ((receiverList & (1 << i)) && FWK_Task_IsRegistered(i))
+        {
+            receivers |= (1 << i);
+        }
+    }
+
+    s_InputStats.events++;
+    receiverList = _FWK_InputManager_Receivers(receivers, pMsg->payload.data, pMsg->payload.size);
+    targets      = _FWK_InputManager_TaskCount(receiverList);
+    s_InputStats.filtered += _FWK_InputManager_TaskCount(receivers) - targets;
+
+    if (targets == 0)
+    {
+        return;
+    }
+
+    pNotify = (fwk_message_t *)FWK_MALLOC(sizeof(fwk_message_t) + copySize);
+    if (pNotify == NULL)
+    {
+        LOGE("Can't allocate memory for msg in kFWKMessageID_InputReceive.");
+        s_InputStats.dropped += targets;
+        return;
+    }
+
+    memset(pNotify, 0, sizeof(fwk_message_t));
+    pNotify->freeAfterConsumed = 1;
+    pNotify->id                = kFWKMessageID_InputNotify;
+    pNotify->payload.devId     = pMsg->payload.devId;
+    pNotify->payload.size      = pMsg->payload.size;
+    pNotify->payload.data      = pMsg->payload.data;
+    if (copySize)
+    {
+        /* the copy lives right after the message, the receivers must not modify or free it */
+        pNotify->payload.data = (void *)(pNotify + 1);
+        memcpy(pNotify->payload.data, pMsg->payload.data, copySize);
+    }
+    s_InputStats.allocations++;
+    s_InputStats.bytesCopied += copySize;
+
+    delivered = FWK_Message_Broadcast(receiverList, pNotify);
+    if (delivered < 0)
+    {
+        delivered = 0;
+    }
+    s_InputStats.deliveries += delivered;
+    s_InputStats.dropped += targets - delivered;
+}
+
 /*
  * input dev callback
  */
@@ -425,6 +500,101 @@ int FWK_InputManager_Deinit()
     return 0;
 }
 
+int FWK_InputManager_Subscribe(fwk_task_id_t taskId, uint32_t eventId)
+{
+    input_subscription_t *pFree = NULL;
+    int error                   = -1;
+
+    if (taskId >= kFWKTaskID_COUNT)
+    {
+        return error;
+    }
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < FWK_INPUT_SUBSCRIPTION_MAX; i++)
+    {
+        input_subscription_t *pEntry = &s_InputSubscriptions.entries[i];
+
+        if ((pEntry->taskMask != 0) && (pEntry->eventId == eventId))
+        {
+            pFree = pEntry;
+            break;
+        }
+
+        if ((pEntry->taskMask == 0) && (pFree == NULL))
+        {
+            pFree = pEntry;
+        }
+    }
+
+    if (pFree != NULL)
+    {
+        pFree->eventId = eventId;
+        pFree->taskMask |= (1 << taskId);
+        s_InputSubscriptions.filteredMask |= (1 << taskId);
+        error = 0;
+    }
+    taskEXIT_CRITICAL();
+
+    if (error)
+    {
+        LOGE("[InputManager]:No room to subscribe task %d to event 0x%x", taskId, eventId);
+    }
+
+    return error;
+}
+
+int FWK_InputManager_Unsubscribe(fwk_task_id_t taskId, uint32_t eventId)
+{
+    uint32_t subscribedMask = 0;
+    int error               = -1;
+
+    if (taskId >= kFWKTaskID_COUNT)
+    {
+        return error;
+    }
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < FWK_INPUT_SUBSCRIPTION_MAX; i++)
+    {
+        input_subscription_t *pEntry = &s_InputSubscriptions.entries[i];
+
+        if ((pEntry->taskMask & (1 << taskId)) && (pEntry->eventId == eventId))
+        {
+            pEntry->taskMask &= ~(1 << taskId);
+            error = 0;
+        }
+        subscribedMask |= pEntry->taskMask;
+    }
+
+    /* a task without subscriptions gets all the events it is sent again */
+    s_InputSubscriptions.filteredMask = subscribedMask;
+    taskEXIT_CRITICAL();
+
+    return error;
+}
+
+int FWK_InputManager_GetStats(fwk_input_stats_t *pStats)
+{
+    if (pStats == NULL)
+    {
+        return -1;
+    }
+
+    taskENTER_CRITICAL();
+    *pStats = s_InputStats;
+    taskEXIT_CRITICAL();
+
+    return 0;
+}
+
+void FWK_InputManager_ResetStats(void)
+{
+    taskENTER_CRITICAL();
+    memset(&s_InputStats, 0, sizeof(s_InputStats));
+    taskEXIT_CRITICAL();
+}
+
 int FWK_InputManager_DeviceRegister(input_dev_t *dev)
 {
     int error = -1;
@@ -11,8 +11,11 @@
  * @brief low power mode manager implementation.
  */
 
+#include <math.h>
+
 #include "fwk_platform.h"
 #include "fwk_log.h"
+#include "fwk_flash.h"
 #include "fwk_message.h"
 #include "fwk_task.h"
 #include "fwk_lpm_manager.h"
@@ -35,8 +38,59 @@ typedef struct
     ListItem_t requestListItem;
 } lpm_request_item_t;
 
+#if FWK_LPM_POLICY
+#define LPM_POLICY_FILE_NAME "cfg/lpm_policy"
+#define LPM_POLICY_VERSION   2
+
+/* the histograms count 1/16 of an idle time, so that halving them keeps a fraction */
+#define LPM_POLICY_SCALE 16
+
+/* longest idle time recorded, longer ones are most likely a wrong wall clock */
+#define LPM_POLICY_MAX_IDLE_S (7 * 24 * 3600)
+
+static const uint32_t s_LpmPolicyTimeoutMs[] = FWK_LPM_POLICY_TIMEOUTS_MS;
+static const float s_LpmPolicySleepMw[kLPMMode_Invalid] = FWK_LPM_POLICY_SLEEP_MW;
+static const float s_LpmPolicyWakeMj[kLPMMode_Invalid]  = FWK_LPM_POLICY_WAKE_MJ;
+static const float s_LpmPolicyWakeMs[kLPMMode_Invalid]  = FWK_LPM_POLICY_WAKE_MS;
+
+#define LPM_POLICY_BINS (sizeof(s_LpmPolicyTimeoutMs) / sizeof(s_LpmPolicyTimeoutMs[0]))
+
+/* saved when the device powers off, the idle period under way ends with the next boot */
+typedef struct _lpm_policy_history
+{
+    uint32_t version;
+    uint32_t count[FWK_LPM_POLICY_HOURS][LPM_POLICY_BINS]; /* idle times in each bin, x LPM_POLICY_SCALE */
+    uint32_t lastBinS[FWK_LPM_POLICY_HOURS];               /* seconds of the idle times in the last bin */
+    int32_t sleepHour;                                     /* hour of the idle period under way, -1 if none */
+    uint32_t sleepClockS;                                  /* wall clock at its start, 0 if unknown */
+    uint32_t sleepIdleMs;                                  /* its length when the device powered off */
+} lpm_policy_history_t;
+
+typedef struct _lpm_policy
+{
+    lpm_policy_history_t history;
+    uint32_t clockS; /* wall clock at clockTick, 0 if not set */
+    TickType_t clockTick;
+    TickType_t idleTick; /* start of the idle period */
+    int idleHour;        /* hour of the idle period, -1 while the device is in use */
+    hal_lpm_mode_t mode; /* mode and idle time picked for the idle period */
+    uint32_t timeoutMs;
+    uint32_t idlePeriods; /* idle periods started since the boot */
+} lpm_policy_t;
+
+static lpm_policy_t s_LpmPolicy = {.history = {.sleepHour = -1}, .idleHour = -1, .mode = kLPMMode_Invalid};
+static TaskHandle_t s_LpmPolicyTask;
+#endif /* FWK_LPM_POLICY */
+
 lpm_manager_t s_LpmManager;
 
+/* steps of the wake up reached so far, bit per fwk_lpm_resume_stage_t */
+static uint32_t s_LpmResumeReached;
+static fwk_lpm_resume_timeline_t s_LpmResumeTimeline;
+static const char *const s_LpmResumeStageName[kFWKLpmResume_Count] = {
+    "camera init", "camera started", "algo model", "face db", "algo ready", "first frame", "first result", "decision",
+};
+
 static int _FWK_LpmManager_Lock()
 {
     if (s_LpmManager.dev == NULL || s_LpmManager.dev->ops->lock == NULL)
@@ -59,6 +113,339 @@ static int _FWK_LpmManager_Unlock()
     return s_LpmManager.dev->ops->unlock(s_LpmManager.dev);
 }
 
+#if FWK_LPM_POLICY
+static int _FWK_LpmManager_PolicyHour(TickType_t tick)
+{
+    uint32_t clockS = s_LpmPolicy.clockS;
+
+    if (clockS == 0)
+    {
+        return 0;
+    }
+
+    clockS += (tick - s_LpmPolicy.clockTick) / configTICK_RATE_HZ;
+    return (clockS / 3600) % FWK_LPM_POLICY_HOURS;
+}
+
+static int _FWK_LpmManager_PolicyBin(uint32_t idleMs)
+{
+    int bin = LPM_POLICY_BINS - 1;
+
+    while ((bin > 0) && (idleMs < s_LpmPolicyTimeoutMs[bin]))
+    {
+        bin--;
+    }
+
+    return bin;
+}
+
+/* Halve the counts of an hour past FWK_LPM_POLICY_HISTORY idle times. Called in a critical section */
+static void _FWK_LpmManager_PolicyAge(int hour)
+{
+    uint32_t *pCount = s_LpmPolicy.history.count[hour];
+    uint32_t total   = 0;
+    int bin;
+
+    for (bin = 0; bin < LPM_POLICY_BINS; bin++)
+    {
+        total += pCount[bin];
+    }
+
+    if (total > FWK_LPM_POLICY_HISTORY * LPM_POLICY_SCALE)
+    {
+        for (bin = 0; bin < LPM_POLICY_BINS; bin++)
+        {
+            pCount[bin] /= 2;
+        }
+        s_LpmPolicy.history.lastBinS[hour] /= 2;
+    }
+}
+
+/* Add an idle time to the histogram of the hour it started in. Called in a critical section */
+static void _FWK_LpmManager_PolicyRecord(int hour, uint32_t idleMs)
+{
+    int bin = _FWK_LpmManager_PolicyBin(idleMs);
+
+    s_LpmPolicy.history.count[hour][bin] += LPM_POLICY_SCALE;
+    if (bin == LPM_POLICY_BINS - 1)
+    {
+        s_LpmPolicy.history.lastBinS[hour] += idleMs / 1000;
+    }
+
+    _FWK_LpmManager_PolicyAge(hour);
+}
+
+/* Idle time of a wake up from a reset without wall clock: the mean of the long idle times of the hour */
+static uint32_t _FWK_LpmManager_PolicyLongIdleMs(int hour)
+{
+    uint32_t count = s_LpmPolicy.history.count[hour][LPM_POLICY_BINS - 1] + LPM_POLICY_SCALE;
+    uint64_t sumS  = (uint64_t)s_LpmPolicy.history.lastBinS[hour] + FWK_LPM_POLICY_PRIOR_S;
+
+    return (uint32_t)(sumS * LPM_POLICY_SCALE * 1000 / count);
+}
+
+/* Add an idle time only known to be at least minMs, the device powered off before its end. It is spread over the bins
+ * from the one of minMs on, in proportion of the idle times already seen there. Called in a critical section */
+static void _FWK_LpmManager_PolicyRecordCensored(int hour, uint32_t minMs)
+{
+    uint32_t *pCount = s_LpmPolicy.history.count[hour];
+    uint32_t above   = 0;
+    uint32_t left    = LPM_POLICY_SCALE;
+    uint32_t share;
+    uint32_t lastMs;
+    int first = _FWK_LpmManager_PolicyBin(minMs);
+
+    for (int bin = first; bin < LPM_POLICY_BINS; bin++)
+    {
+        above += pCount[bin];
+    }
+
+    lastMs = _FWK_LpmManager_PolicyLongIdleMs(hour);
+    if (lastMs < minMs)
+    {
+        lastMs = minMs;
+    }
+
+    if (above == 0)
+    {
+        /* nothing seen past minMs yet, count it as a long idle time */
+        _FWK_LpmManager_PolicyRecord(hour, lastMs);
+        return;
+    }
+
+    for (int bin = first; bin < LPM_POLICY_BINS - 1; bin++)
+    {
+        share = LPM_POLICY_SCALE * pCount[bin] / above;
+        pCount[bin] += share;
+        left -= share;
+    }
+
+    /* the rest goes to the last bin, with the mean idle time of the bin */
+    pCount[LPM_POLICY_BINS - 1] += left;
+    s_LpmPolicy.history.lastBinS[hour] += (uint32_t)((uint64_t)lastMs * left / LPM_POLICY_SCALE / 1000);
+
+    _FWK_LpmManager_PolicyAge(hour);
+}
+
+/* The device is in use: end the idle period, it is one more sample of the histogram of its hour */
+static void _FWK_LpmManager_PolicyActivity(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    uint32_t idleMs;
+    int hour;
+
+    taskENTER_CRITICAL();
+    hour = s_LpmPolicy.idleHour;
+    if (hour >= 0)
+    {
+        idleMs = (now - s_LpmPolicy.idleTick) * portTICK_PERIOD_MS;
+        _FWK_LpmManager_PolicyRecord(hour, idleMs);
+        s_LpmPolicy.idleHour = -1;
+    }
+    taskEXIT_CRITICAL();
+
+    if (hour >= 0)
+    {
+        LOGD("[LpmManager]:policy idle %u ms at hour %d", idleMs, hour);
+    }
+}
+
+/* Pick the mode among the ones of the device and the idle time before sleeping which cost the least over the idle
+ * times seen at this hour: the energy until the next use plus the latency of its wake up */
+static void _FWK_LpmManager_PolicyDecide(lpm_dev_t *pDev, int hour)
+{
+    float weight[LPM_POLICY_BINS];
+    float idleMs[LPM_POLICY_BINS];
+    float total             = 0;
+    float bestCost          = INFINITY;
+    uint32_t modes          = pDev->modes;
+    hal_lpm_mode_t bestMode = s_LpmManager.currentMode;
+    int bestTimeout         = 0;
+    bool explore            = false;
+
+    if ((modes == 0) && (s_LpmManager.currentMode < kLPMMode_Invalid))
+    {
+        modes = 1U << s_LpmManager.currentMode;
+    }
+
+    taskENTER_CRITICAL();
+    for (int bin = 0; bin < LPM_POLICY_BINS; bin++)
+    {
+        weight[bin] = s_LpmPolicy.history.count[hour][bin];
+        idleMs[bin] = (bin < LPM_POLICY_BINS - 1)
+                          ? (s_LpmPolicyTimeoutMs[bin] + s_LpmPolicyTimeoutMs[bin + 1]) / 2.0f
+                          : (float)_FWK_LpmManager_PolicyLongIdleMs(hour);
+    }
+    taskEXIT_CRITICAL();
+
+    /* an hour without history holds a single long idle time, the device sleeps right away in its deepest mode */
+    weight[LPM_POLICY_BINS - 1] += LPM_POLICY_SCALE;
+    idleMs[LPM_POLICY_BINS - 1] = fmaxf(idleMs[LPM_POLICY_BINS - 1], s_LpmPolicyTimeoutMs[LPM_POLICY_BINS - 1]);
+    for (int bin = 0; bin < LPM_POLICY_BINS; bin++)
+    {
+        total += weight[bin];
+    }
+
+    for (int mode = 0; mode < kLPMMode_Invalid; mode++)
+    {
+        if ((modes & (1U << mode)) == 0)
+        {
+            continue;
+        }
+
+        for (int timeout = 0; timeout < LPM_POLICY_BINS; timeout++)
+        {
+            float timeoutMs = s_LpmPolicyTimeoutMs[timeout];
+            float wakeMj = s_LpmPolicyWakeMj[mode] + FWK_LPM_POLICY_LATENCY_MJ_PER_S * s_LpmPolicyWakeMs[mode] / 1000;
+            float cost      = 0;
+
+            /* mW x ms are uJ */
+            for (int bin = 0; bin < LPM_POLICY_BINS; bin++)
+            {
+                if (bin < timeout)
+                {
+                    cost += weight[bin] * FWK_LPM_POLICY_IDLE_MW * idleMs[bin] / 1000;
+                }
+                else
+                {
+                    cost += weight[bin] * (FWK_LPM_POLICY_IDLE_MW * timeoutMs / 1000 +
+                                           s_LpmPolicySleepMw[mode] * (idleMs[bin] - timeoutMs) / 1000 + wakeMj);
+                }
+            }
+            cost /= total;
+
+            if (cost < bestCost)
+            {
+                bestCost      = cost;
+                bestMode    = (hal_lpm_mode_t)mode;
+                bestTimeout = timeout;
+            }
+        }
+    }
+
+    /* Without a clock, an idle time ended by a power off is only known to be longer than the wait before sleeping and
+     * waiting 0 ms teaches nothing. Wait one step longer now and then, so that the shorter idle times are seen too */
+    s_LpmPolicy.idlePeriods++;
+    if ((s_LpmPolicy.clockS == 0) && (FWK_LPM_POLICY_EXPLORE > 0) && (bestTimeout < LPM_POLICY_BINS - 1) &&
+        ((s_LpmPolicy.idlePeriods % FWK_LPM_POLICY_EXPLORE) == 0))
+    {
+        bestTimeout++;
+        explore = true;
+    }
+
+    s_LpmPolicy.mode      = bestMode;
+    s_LpmPolicy.timeoutMs = s_LpmPolicyTimeoutMs[bestTimeout];
+
+    LOGI("[LpmManager]:policy hour %d, %u idle times: mode %d after %u ms%s, %u mJ per idle time", hour,
+         (unsigned int)(total / LPM_POLICY_SCALE) - 1, bestMode, s_LpmPolicy.timeoutMs, explore ? " (explore)" : "",
+         (bestCost < INFINITY) ? (unsigned int)bestCost : 0);
+}
+
+/* No request is pending. Return true once the device has been idle for the time picked for this idle period */
+static bool _FWK_LpmManager_PolicyIdle(lpm_dev_t *pDev)
+{
+    TickType_t now = xTaskGetTickCount();
+    bool start;
+    int hour = 0;
+
+    taskENTER_CRITICAL();
+    start = (s_LpmPolicy.idleHour < 0);
+    if (start)
+    {
+        hour                 = _FWK_LpmManager_PolicyHour(now);
+        s_LpmPolicy.idleHour = hour;
+        s_LpmPolicy.idleTick = now;
+    }
+    taskEXIT_CRITICAL();
+
+    if (start)
+    {
+        _FWK_LpmManager_PolicyDecide(pDev, hour);
+    }
+
+    if ((now - s_LpmPolicy.idleTick) < pdMS_TO_TICKS(s_LpmPolicy.timeoutMs))
+    {
+        return false;
+    }
+
+    if (s_LpmPolicy.mode != kLPMMode_Invalid)
+    {
+        s_LpmManager.currentMode = s_LpmPolicy.mode;
+    }
+
+    return true;
+}
+
+/* The device powers off, save the history and the idle period under way */
+static void _FWK_LpmManager_PolicySave(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    sln_flash_status_t status;
+
+    taskENTER_CRITICAL();
+    s_LpmPolicy.history.sleepHour   = s_LpmPolicy.idleHour;
+    s_LpmPolicy.history.sleepIdleMs = (now - s_LpmPolicy.idleTick) * portTICK_PERIOD_MS;
+    s_LpmPolicy.history.sleepClockS = 0;
+    if (s_LpmPolicy.clockS != 0)
+    {
+        s_LpmPolicy.history.sleepClockS =
+            s_LpmPolicy.clockS + (s_LpmPolicy.idleTick - s_LpmPolicy.clockTick) / configTICK_RATE_HZ;
+    }
+    taskEXIT_CRITICAL();
+
+    status = FWK_Flash_Save(LPM_POLICY_FILE_NAME, &s_LpmPolicy.history, sizeof(s_LpmPolicy.history));
+    if (status != kStatus_HAL_FlashSuccess)
+    {
+        LOGE("[LpmManager]:policy save error %d", status);
+    }
+}
+
+/* Load the history. An idle period which ended with this boot is recorded now as longer than the wait before the power
+ * off if its length can't be known, else once the wall clock is set */
+static void _FWK_LpmManager_PolicyLoad(void)
+{
+    lpm_policy_history_t *pHistory = &s_LpmPolicy.history;
+    uint32_t len                   = sizeof(*pHistory);
+    sln_flash_status_t status;
+
+    status = FWK_Flash_Read(LPM_POLICY_FILE_NAME, pHistory, 0, &len);
+    if ((status != kStatus_HAL_FlashSuccess) || (len != sizeof(*pHistory)) ||
+        (pHistory->version != LPM_POLICY_VERSION) || (pHistory->sleepHour >= FWK_LPM_POLICY_HOURS))
+    {
+        LOGD("[LpmManager]:policy starts without history");
+        memset(pHistory, 0, sizeof(*pHistory));
+        pHistory->version   = LPM_POLICY_VERSION;
+        pHistory->sleepHour = -1;
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    if ((pHistory->sleepHour >= 0) && (pHistory->sleepClockS == 0))
+    {
+        _FWK_LpmManager_PolicyRecordCensored(pHistory->sleepHour, pHistory->sleepIdleMs);
+        pHistory->sleepHour = -1;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/* Save the history before a power off and enter the sleep. The sleep timers run in the timer task, which can't wait
+ * for the flash */
+static void _FWK_LpmManager_PolicyTask(void *param)
+{
+    lpm_dev_t *pDev;
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        _FWK_LpmManager_PolicySave();
+
+        pDev = s_LpmManager.dev;
+        pDev->ops->enterSleep(pDev, s_LpmManager.currentMode);
+    }
+}
+#endif /* FWK_LPM_POLICY */
+
 static int _FWK_LpmManager_PreEnterSleepTimerCallback(lpm_dev_t *dev)
 {
     int ret = kStatus_HAL_LpmSuccess;
@@ -68,7 +455,14 @@ static int _FWK_LpmManager_PreEnterSleepTimerCallback(lpm_dev_t *dev)
     {
         pDev->ops->stopPreEnterTimer(pDev);
         s_LpmManager.enable = kLPMManagerStatus_SleepDisable;
-        ret                 = pDev->ops->enterSleep(pDev, s_LpmManager.currentMode);
+#if FWK_LPM_POLICY
+        if ((s_LpmManager.currentMode == kLPMMode_SNVS) && (s_LpmPolicyTask != NULL))
+        {
+            xTaskNotifyGive(s_LpmPolicyTask);
+            return ret;
+        }
+#endif /* FWK_LPM_POLICY */
+        ret = pDev->ops->enterSleep(pDev, s_LpmManager.currentMode);
     }
     else
     {
@@ -150,10 +544,22 @@ static int FWK_LpmManager_TimerCallback(lpm_dev_t *dev)
         {
             if ((pDev != NULL) && (pDev->ops != NULL) &&(pDev->ops->enterSleep != NULL))
             {
+#if FWK_LPM_POLICY
+                if (!_FWK_LpmManager_PolicyIdle(pDev))
+                {
+                    return ret;
+                }
+#endif /* FWK_LPM_POLICY */
                 pDev->ops->stopTimer(pDev);
                 _FWK_LpmManager_PreEnterSleep(pDev);
             }
         }
+#if FWK_LPM_POLICY
+        else if (pxListItem != pxListEnd)
+        {
+            _FWK_LpmManager_PolicyActivity();
+        }
+#endif /* FWK_LPM_POLICY */
     }
 
     return ret;
@@ -200,6 +606,22 @@ int FWK_LpmManager_Start(int taskPriority)
         }
     }
 
+#if FWK_LPM_POLICY
+    _FWK_LpmManager_PolicyLoad();
+
+    if (pDev != NULL && pDev->ops->getClock != NULL)
+    {
+        FWK_LpmManager_PolicySetClock(pDev->ops->getClock(pDev));
+    }
+
+    if (xTaskCreate(_FWK_LpmManager_PolicyTask, LPM_MANAGER_TASK_NAME, LPM_MANAGER_TASK_STACK, NULL, taskPriority,
+                    &s_LpmPolicyTask) != pdPASS)
+    {
+        LOGE("[LpmManager]:policy task create failed, the history won't be saved");
+        s_LpmPolicyTask = NULL;
+    }
+#endif /* FWK_LPM_POLICY */
+
     if (pDev != NULL && pDev->ops->openTimer != NULL)
     {
         LOGD("[LpmManager] START lpm dev [%d]", pDev->id);
@@ -348,6 +770,10 @@ int FWK_LpmManager_RuntimeGet(hal_lpm_request_t *req)
 
     _FWK_LpmManager_Unlock();
 
+#if FWK_LPM_POLICY
+    _FWK_LpmManager_PolicyActivity();
+#endif /* FWK_LPM_POLICY */
+
     return ret;
 }
 
@@ -446,6 +872,13 @@ int FWK_LpmManager_RuntimeSet(hal_lpm_request_t *req, int8_t count)
 
     _FWK_LpmManager_Unlock();
 
+#if FWK_LPM_POLICY
+    if (count > 0)
+    {
+        _FWK_LpmManager_PolicyActivity();
+    }
+#endif /* FWK_LPM_POLICY */
+
     return ret;
 }
 
@@ -581,5 +1014,127 @@ int FWK_LpmManager_EnableSleepMode(hal_lpm_manager_status_t enable)
 
     _FWK_LpmManager_Unlock();
 
+#if FWK_LPM_POLICY
+    if (!enable)
+    {
+        _FWK_LpmManager_PolicyActivity();
+    }
+#endif /* FWK_LPM_POLICY */
+
     return ret;
 }
+
+static void _FWK_LpmManager_ResumePrint(const fwk_lpm_resume_timeline_t *pTimeline, uint32_t reached)
+{
+    unsigned int prevUs = 0;
+
+    LOGI("[LpmManager]:Resume timeline, us since boot (+us since the previous step)");
+    for (int stage = 0; stage < kFWKLpmResume_Count; stage++)
+    {
+        if (reached & (1U << stage))
+        {
+            LOGI("[LpmManager]:  %-14s %8u (+%u)", s_LpmResumeStageName[stage], pTimeline->markUs[stage],
+                 pTimeline->markUs[stage] - prevUs);
+            prevUs = pTimeline->markUs[stage];
+        }
+        else
+        {
+            LOGI("[LpmManager]:  %-14s not reached", s_LpmResumeStageName[stage]);
+        }
+    }
+}
+
+void FWK_LpmManager_ResumeMark(fwk_lpm_resume_stage_t stage)
+{
+    fwk_lpm_resume_timeline_t timeline;
+    uint32_t reached = 0;
+    bool done        = false;
+
+    if ((stage < 0) || (stage >= kFWKLpmResume_Count))
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    if ((s_LpmResumeReached & (1U << stage)) == 0)
+    {
+        s_LpmResumeTimeline.markUs[stage] = FWK_CurrentTimeUs();
+        s_LpmResumeReached |= (1U << stage);
+        if (stage == kFWKLpmResume_Decision)
+        {
+            timeline = s_LpmResumeTimeline;
+            reached  = s_LpmResumeReached;
+            done     = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    /* steps after the decision, a late frame or result, are missing from the print but kept in the timeline */
+    if (done)
+    {
+        _FWK_LpmManager_ResumePrint(&timeline, reached);
+    }
+}
+
+int FWK_LpmManager_GetResumeTimeline(fwk_lpm_resume_timeline_t *pTimeline)
+{
+    if (pTimeline == NULL)
+    {
+        return kStatus_HAL_LpmError;
+    }
+
+    taskENTER_CRITICAL();
+    *pTimeline = s_LpmResumeTimeline;
+    taskEXIT_CRITICAL();
+
+    return kStatus_HAL_LpmSuccess;
+}
+
+int FWK_LpmManager_PolicySetClock(uint32_t seconds)
+{
+#if FWK_LPM_POLICY
+    TickType_t now = xTaskGetTickCount();
+    uint32_t bootS;
+    uint32_t idleMs;
+    int hour;
+
+    if (seconds == 0)
+    {
+        return kStatus_HAL_LpmError;
+    }
+
+    taskENTER_CRITICAL();
+    s_LpmPolicy.clockS    = seconds;
+    s_LpmPolicy.clockTick = now;
+
+    /* the idle period which ended with this boot, at the time the device started */
+    hour = s_LpmPolicy.history.sleepHour;
+    if (hour >= 0)
+    {
+        bootS = seconds - now / configTICK_RATE_HZ;
+        if ((bootS > s_LpmPolicy.history.sleepClockS) &&
+            (bootS - s_LpmPolicy.history.sleepClockS <= LPM_POLICY_MAX_IDLE_S))
+        {
+            idleMs = (bootS - s_LpmPolicy.history.sleepClockS) * 1000;
+            _FWK_LpmManager_PolicyRecord(hour, idleMs);
+        }
+        else
+        {
+            /* the clock went back or jumped, only the wait before the power off is known */
+            idleMs = s_LpmPolicy.history.sleepIdleMs;
+            _FWK_LpmManager_PolicyRecordCensored(hour, idleMs);
+        }
+        s_LpmPolicy.history.sleepHour = -1;
+    }
+    taskEXIT_CRITICAL();
+
+    if (hour >= 0)
+    {
+        LOGD("[LpmManager]:policy idle %u ms at hour %d, powered off", idleMs, hour);
+    }
+
+    return kStatus_HAL_LpmSuccess;
+#else
+    return kStatus_HAL_LpmError;
+#endif /* FWK_LPM_POLICY */
+}
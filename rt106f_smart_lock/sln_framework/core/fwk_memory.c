@@ -0,0 +1,603 @@
+/*
+ * Copyright 2022 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/*
+ * @brief Framework memory placement implementation. Keeps the arenas of the regions and the table of the recorded
+ * buffers, the table is what the boot report and the placement checks are made from.
+ */
+
+#include "fwk_memory.h"
+
+#ifdef FWK_MEMORY_HOST
+#include <stdio.h>
+#include <string.h>
+
+#define LOGI(fmt, ...) printf(fmt "\n", ##__VA_ARGS__)
+#define LOGE(fmt, ...) printf("[ERROR] " fmt "\n", ##__VA_ARGS__)
+
+/* the host build has no region to map, every region is a plain array and the arena is the whole array */
+#ifndef FWK_MEM_HOST_REGION_SIZE
+#define FWK_MEM_HOST_REGION_SIZE (256 * 1024)
+#endif /* FWK_MEM_HOST_REGION_SIZE */
+
+static uint8_t s_HostRegions[kFWKMemRegion_Count][FWK_MEM_HOST_REGION_SIZE] __attribute__((aligned(FWK_MEM_CACHE_LINE)));
+
+#define FWK_MEM_REGION_BASE(region) ((uintptr_t)s_HostRegions[region])
+#define FWK_MEM_REGION_SIZE(region) FWK_MEM_HOST_REGION_SIZE
+#define FWK_MEM_ENTER_CRITICAL()
+#define FWK_MEM_EXIT_CRITICAL()
+
+#else
+#include "fwk_log.h"
+#include "fwk_platform.h"
+#include "fsl_cache.h"
+
+/* Regions of the memory map of the linker, see the MCU settings of the project */
+#ifndef FWK_MEM_DTCM_BASE
+#define FWK_MEM_DTCM_BASE 0x20000000
+#define FWK_MEM_DTCM_SIZE 0x40000
+#endif /* FWK_MEM_DTCM_BASE */
+
+#ifndef FWK_MEM_OCRAM_CACHED_BASE
+#define FWK_MEM_OCRAM_CACHED_BASE 0x20200000
+#define FWK_MEM_OCRAM_CACHED_SIZE 0x40000
+#endif /* FWK_MEM_OCRAM_CACHED_BASE */
+
+#ifndef FWK_MEM_OCRAM_UNCACHED_BASE
+#define FWK_MEM_OCRAM_UNCACHED_BASE 0x20240000
+#define FWK_MEM_OCRAM_UNCACHED_SIZE 0x3f000
+#endif /* FWK_MEM_OCRAM_UNCACHED_BASE */
+
+#ifndef FWK_MEM_SDRAM_CACHED_BASE
+#define FWK_MEM_SDRAM_CACHED_BASE 0x80000000
+#define FWK_MEM_SDRAM_CACHED_SIZE 0xc00000
+#endif /* FWK_MEM_SDRAM_CACHED_BASE */
+
+#ifndef FWK_MEM_SDRAM_UNCACHED_BASE
+#define FWK_MEM_SDRAM_UNCACHED_BASE 0x80c00000
+#define FWK_MEM_SDRAM_UNCACHED_SIZE 0x400000
+#endif /* FWK_MEM_SDRAM_UNCACHED_BASE */
+
+static const uintptr_t s_RegionBase[kFWKMemRegion_Count] = {
+    FWK_MEM_DTCM_BASE,         FWK_MEM_OCRAM_CACHED_BASE,   FWK_MEM_OCRAM_UNCACHED_BASE,
+    FWK_MEM_SDRAM_CACHED_BASE, FWK_MEM_SDRAM_UNCACHED_BASE,
+};
+
+static const uint32_t s_RegionSize[kFWKMemRegion_Count] = {
+    FWK_MEM_DTCM_SIZE,         FWK_MEM_OCRAM_CACHED_SIZE,   FWK_MEM_OCRAM_UNCACHED_SIZE,
+    FWK_MEM_SDRAM_CACHED_SIZE, FWK_MEM_SDRAM_UNCACHED_SIZE,
+};
+
+#define FWK_MEM_REGION_BASE(region) s_RegionBase[region]
+#define FWK_MEM_REGION_SIZE(region) s_RegionSize[region]
+#define FWK_MEM_ENTER_CRITICAL()    taskENTER_CRITICAL()
+#define FWK_MEM_EXIT_CRITICAL()     taskEXIT_CRITICAL()
+
+/* same sections as the AT_xxx_SECTION_ALIGN macros of board_define.h */
+#define FWK_MEM_SECTION(name) __attribute__((section(".bss.$" name ",\"aw\",%nobits @")))
+
+#if FWK_MEM_ARENA_SIZE_DTCM
+FWK_MEM_SECTION("SRAM_DTC_cm7")
+static uint8_t s_ArenaDTCM[FWK_MEM_ARENA_SIZE_DTCM] __attribute__((aligned(FWK_MEM_CACHE_LINE)));
+#endif /* FWK_MEM_ARENA_SIZE_DTCM */
+
+#if FWK_MEM_ARENA_SIZE_OCRAM_CACHED
+FWK_MEM_SECTION("SRAM_OCRAM_CACHED")
+static uint8_t s_ArenaOcramCached[FWK_MEM_ARENA_SIZE_OCRAM_CACHED] __attribute__((aligned(FWK_MEM_CACHE_LINE)));
+#endif /* FWK_MEM_ARENA_SIZE_OCRAM_CACHED */
+
+#if FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED
+FWK_MEM_SECTION("SRAM_OCRAM_NCACHED")
+static uint8_t s_ArenaOcramUncached[FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED] __attribute__((aligned(FWK_MEM_CACHE_LINE)));
+#endif /* FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED */
+
+#if FWK_MEM_ARENA_SIZE_SDRAM_CACHED
+static uint8_t s_ArenaSdramCached[FWK_MEM_ARENA_SIZE_SDRAM_CACHED] __attribute__((aligned(FWK_MEM_CACHE_LINE)));
+#endif /* FWK_MEM_ARENA_SIZE_SDRAM_CACHED */
+
+#if FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED
+FWK_MEM_SECTION("NCACHE_REGION")
+static uint8_t s_ArenaSdramUncached[FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED] __attribute__((aligned(FWK_MEM_CACHE_LINE)));
+#endif /* FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED */
+
+#endif /* FWK_MEMORY_HOST */
+
+typedef struct _fwk_mem_arena
+{
+    uint8_t *base;
+    uint32_t size;
+    uint32_t used;
+} fwk_mem_arena_t;
+
+typedef struct _fwk_mem_buffer
+{
+    const void *buf;
+    const char *name;
+    uint32_t size;
+    uint8_t owner;
+    uint8_t expected; /* region the owner asked for */
+    uint8_t region;   /* region the buffer is in */
+    uint8_t arena;    /* allocated from the arena, never untracked */
+} fwk_mem_buffer_t;
+
+static const char *s_RegionNames[kFWKMemRegion_Count + 1] = {
+    "DTCM", "OCRAM", "OCRAM nc", "SDRAM", "SDRAM nc", "unknown",
+};
+
+static const char *s_OwnerNames[kFWKMemOwner_Count] = {
+    "camera", "display", "vision", "voice", "graphics", "flash", "input", "app",
+};
+
+static fwk_mem_arena_t s_Arenas[kFWKMemRegion_Count] = {
+#ifdef FWK_MEMORY_HOST
+    {s_HostRegions[kFWKMemRegion_DTCM], FWK_MEM_HOST_REGION_SIZE, 0},
+    {s_HostRegions[kFWKMemRegion_OcramCached], FWK_MEM_HOST_REGION_SIZE, 0},
+    {s_HostRegions[kFWKMemRegion_OcramUncached], FWK_MEM_HOST_REGION_SIZE, 0},
+    {s_HostRegions[kFWKMemRegion_SdramCached], FWK_MEM_HOST_REGION_SIZE, 0},
+    {s_HostRegions[kFWKMemRegion_SdramUncached], FWK_MEM_HOST_REGION_SIZE, 0},
+#else
+#if FWK_MEM_ARENA_SIZE_DTCM
+    {s_ArenaDTCM, FWK_MEM_ARENA_SIZE_DTCM, 0},
+#else
+    {NULL, 0, 0},
+#endif /* FWK_MEM_ARENA_SIZE_DTCM */
+#if FWK_MEM_ARENA_SIZE_OCRAM_CACHED
+    {s_ArenaOcramCached, FWK_MEM_ARENA_SIZE_OCRAM_CACHED, 0},
+#else
+    {NULL, 0, 0},
+#endif /* FWK_MEM_ARENA_SIZE_OCRAM_CACHED */
+#if FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED
+    {s_ArenaOcramUncached, FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED, 0},
+#else
+    {NULL, 0, 0},
+#endif /* FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED */
+#if FWK_MEM_ARENA_SIZE_SDRAM_CACHED
+    {s_ArenaSdramCached, FWK_MEM_ARENA_SIZE_SDRAM_CACHED, 0},
+#else
+    {NULL, 0, 0},
+#endif /* FWK_MEM_ARENA_SIZE_SDRAM_CACHED */
+#if FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED
+    {s_ArenaSdramUncached, FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED, 0},
+#else
+    {NULL, 0, 0},
+#endif /* FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED */
+#endif /* FWK_MEMORY_HOST */
+};
+
+static fwk_mem_buffer_t s_Buffers[FWK_MEM_MAX_BUFFERS];
+static uint32_t s_Budgets[kFWKMemOwner_Count][kFWKMemRegion_Count];
+static int s_BufferOverflow = 0;
+
+#if FWK_MEM_CHECK_OWNERSHIP
+typedef struct _fwk_mem_handoff
+{
+    const void *buf; /* NULL when the CPU owns the buffer */
+    uint32_t size;
+    uint32_t checksum; /* of a buffer the device reads, when it was given */
+    fwk_mem_access_t access;
+} fwk_mem_handoff_t;
+
+static fwk_mem_handoff_t s_Handoffs[FWK_MEM_MAX_HANDOFFS];
+
+static uint32_t _FWK_Memory_Checksum(const void *buf, uint32_t size)
+{
+    const uint8_t *pData = (const uint8_t *)buf;
+    uint32_t sum         = 0;
+
+    for (uint32_t i = 0; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t))
+    {
+        uint32_t word;
+        memcpy(&word, pData + i, sizeof(word));
+        sum = (sum << 1 | sum >> 31) ^ word;
+    }
+
+    for (uint32_t i = size & ~(sizeof(uint32_t) - 1); i < size; i++)
+    {
+        sum = (sum << 1 | sum >> 31) ^ pData[i];
+    }
+
+    return sum;
+}
+#endif /* FWK_MEM_CHECK_OWNERSHIP */
+
+#ifndef FWK_MEMORY_HOST
+static int _FWK_Memory_IsCached(fwk_mem_region_t region)
+{
+    return (region == kFWKMemRegion_OcramCached) || (region == kFWKMemRegion_SdramCached);
+}
+#endif /* FWK_MEMORY_HOST */
+
+/* call with the table locked, a buffer recorded again (device init run twice) replaces its previous record */
+static int _FWK_Memory_Record(fwk_mem_region_t expected,
+                              fwk_mem_region_t region,
+                              fwk_mem_owner_t owner,
+                              const void *buf,
+                              uint32_t size,
+                              const char *name,
+                              int arena)
+{
+    int slot = -1;
+
+    for (int i = 0; i < FWK_MEM_MAX_BUFFERS; i++)
+    {
+        if ((s_Buffers[i].buf == buf) && !s_Buffers[i].arena)
+        {
+            slot = i;
+            break;
+        }
+        else if ((s_Buffers[i].buf == NULL) && (slot < 0))
+        {
+            slot = i;
+        }
+    }
+
+    if (slot >= 0)
+    {
+        s_Buffers[slot].buf      = buf;
+        s_Buffers[slot].name     = name;
+        s_Buffers[slot].size     = size;
+        s_Buffers[slot].owner    = owner;
+        s_Buffers[slot].expected = expected;
+        s_Buffers[slot].region   = region;
+        s_Buffers[slot].arena    = arena;
+        return 0;
+    }
+
+    s_BufferOverflow++;
+    return -1;
+}
+
+const char *FWK_Memory_RegionName(fwk_mem_region_t region)
+{
+    if (region > kFWKMemRegion_Count)
+    {
+        region = kFWKMemRegion_Invalid;
+    }
+    return s_RegionNames[region];
+}
+
+fwk_mem_region_t FWK_Memory_RegionOf(const void *buf)
+{
+    uintptr_t addr = (uintptr_t)buf;
+
+    for (int region = 0; region < kFWKMemRegion_Count; region++)
+    {
+        if ((addr >= FWK_MEM_REGION_BASE(region)) && (addr - FWK_MEM_REGION_BASE(region) < FWK_MEM_REGION_SIZE(region)))
+        {
+            return (fwk_mem_region_t)region;
+        }
+    }
+
+    return kFWKMemRegion_Invalid;
+}
+
+int FWK_Memory_SetBudget(fwk_mem_owner_t owner, fwk_mem_region_t region, uint32_t size)
+{
+    if ((owner >= kFWKMemOwner_Count) || (region >= kFWKMemRegion_Count))
+    {
+        return -1;
+    }
+
+    s_Budgets[owner][region] = size;
+    return 0;
+}
+
+void *FWK_Memory_Alloc(fwk_mem_region_t region, fwk_mem_owner_t owner, uint32_t size, uint32_t align, const char *name)
+{
+    uint8_t *buf = NULL;
+
+    if ((region >= kFWKMemRegion_Count) || (owner >= kFWKMemOwner_Count) || (size == 0) || (align & (align - 1)))
+    {
+        LOGE("Invalid allocation of %s", name);
+        return NULL;
+    }
+
+    if (align == 0)
+    {
+        align = sizeof(uint32_t);
+    }
+
+    FWK_MEM_ENTER_CRITICAL();
+    fwk_mem_arena_t *pArena = &s_Arenas[region];
+    uintptr_t start         = ((uintptr_t)pArena->base + pArena->used + align - 1) & ~(uintptr_t)(align - 1);
+    uint32_t offset         = start - (uintptr_t)pArena->base;
+
+    if ((pArena->base != NULL) && (offset <= pArena->size) && (size <= pArena->size - offset))
+    {
+        buf          = (uint8_t *)start;
+        pArena->used = offset + size;
+        _FWK_Memory_Record(region, region, owner, buf, size, name, 1);
+    }
+    FWK_MEM_EXIT_CRITICAL();
+
+    if (buf == NULL)
+    {
+        LOGE("%s arena has no room for %s of %d bytes, %d of %d used", s_RegionNames[region], name, size,
+             s_Arenas[region].used, s_Arenas[region].size);
+    }
+
+    return buf;
+}
+
+int FWK_Memory_Track(fwk_mem_region_t region, fwk_mem_owner_t owner, const void *buf, uint32_t size, const char *name)
+{
+    if ((buf == NULL) || (region >= kFWKMemRegion_Count) || (owner >= kFWKMemOwner_Count))
+    {
+        return -1;
+    }
+
+    fwk_mem_region_t actual = FWK_Memory_RegionOf(buf);
+
+    FWK_MEM_ENTER_CRITICAL();
+    _FWK_Memory_Record(region, actual, owner, buf, size, name, 0);
+    FWK_MEM_EXIT_CRITICAL();
+
+    if (actual != region)
+    {
+        LOGE("%s of %d bytes is in %s instead of %s", name, size, s_RegionNames[actual], s_RegionNames[region]);
+        return -1;
+    }
+
+    return 0;
+}
+
+void FWK_Memory_Untrack(const void *buf)
+{
+    if (buf == NULL)
+    {
+        return;
+    }
+
+    FWK_MEM_ENTER_CRITICAL();
+    for (int i = 0; i < FWK_MEM_MAX_BUFFERS; i++)
+    {
+        if ((s_Buffers[i].buf == buf) && !s_Buffers[i].arena)
+        {
+            s_Buffers[i].buf = NULL;
+            break;
+        }
+    }
+    FWK_MEM_EXIT_CRITICAL();
+}
+
+void FWK_Memory_CleanCache(const void *buf, uint32_t size)
+{
+#ifndef FWK_MEMORY_HOST
+    if ((size != 0) && _FWK_Memory_IsCached(FWK_Memory_RegionOf(buf)))
+    {
+        DCACHE_CleanByRange((uint32_t)buf, size);
+    }
+#else
+    (void)buf;
+    (void)size;
+#endif /* FWK_MEMORY_HOST */
+}
+
+void FWK_Memory_InvalidateCache(const void *buf, uint32_t size)
+{
+#ifndef FWK_MEMORY_HOST
+    if ((size != 0) && _FWK_Memory_IsCached(FWK_Memory_RegionOf(buf)))
+    {
+        DCACHE_InvalidateByRange((uint32_t)buf, size);
+    }
+#else
+    (void)buf;
+    (void)size;
+#endif /* FWK_MEMORY_HOST */
+}
+
+void FWK_Memory_CleanInvalidateCache(const void *buf, uint32_t size)
+{
+#ifndef FWK_MEMORY_HOST
+    if ((size != 0) && _FWK_Memory_IsCached(FWK_Memory_RegionOf(buf)))
+    {
+        DCACHE_CleanInvalidateByRange((uint32_t)buf, size);
+    }
+#else
+    (void)buf;
+    (void)size;
+#endif /* FWK_MEMORY_HOST */
+}
+
+void FWK_Memory_GiveToDevice(const void *buf, uint32_t size, fwk_mem_access_t access)
+{
+    if (buf == NULL)
+    {
+        return;
+    }
+
+    if (access == kFWKMemAccess_DeviceReads)
+    {
+        FWK_Memory_CleanCache(buf, size);
+    }
+    else
+    {
+        FWK_Memory_CleanInvalidateCache(buf, size);
+    }
+
+#if FWK_MEM_CHECK_OWNERSHIP
+    uint32_t checksum = (access == kFWKMemAccess_DeviceReads) ? _FWK_Memory_Checksum(buf, size) : 0;
+    int given         = 0;
+    int slot          = -1;
+
+    FWK_MEM_ENTER_CRITICAL();
+    for (int i = 0; i < FWK_MEM_MAX_HANDOFFS; i++)
+    {
+        if (s_Handoffs[i].buf == buf)
+        {
+            given = 1;
+            slot  = i;
+            break;
+        }
+        else if ((s_Handoffs[i].buf == NULL) && (slot < 0))
+        {
+            slot = i;
+        }
+    }
+
+    if (slot >= 0)
+    {
+        s_Handoffs[slot].buf      = buf;
+        s_Handoffs[slot].size     = size;
+        s_Handoffs[slot].checksum = checksum;
+        s_Handoffs[slot].access   = access;
+    }
+    FWK_MEM_EXIT_CRITICAL();
+
+    if (given)
+    {
+        LOGE("Buffer %p given to a device twice", buf);
+    }
+    else if (slot < 0)
+    {
+        LOGE("Buffer %p not checked, raise FWK_MEM_MAX_HANDOFFS", buf);
+    }
+#endif /* FWK_MEM_CHECK_OWNERSHIP */
+}
+
+void FWK_Memory_TakeFromDevice(const void *buf, uint32_t size, fwk_mem_access_t access)
+{
+    if (buf == NULL)
+    {
+        return;
+    }
+
+    if (access == kFWKMemAccess_DeviceWrites)
+    {
+        FWK_Memory_InvalidateCache(buf, size);
+    }
+
+#if FWK_MEM_CHECK_OWNERSHIP
+    fwk_mem_handoff_t handoff = {NULL, 0, 0, kFWKMemAccess_DeviceReads};
+
+    FWK_MEM_ENTER_CRITICAL();
+    for (int i = 0; i < FWK_MEM_MAX_HANDOFFS; i++)
+    {
+        if (s_Handoffs[i].buf == buf)
+        {
+            handoff           = s_Handoffs[i];
+            s_Handoffs[i].buf = NULL;
+            break;
+        }
+    }
+    FWK_MEM_EXIT_CRITICAL();
+
+    /* the buffers a device starts with were never given, nothing to check for them */
+    if ((handoff.buf != NULL) && (handoff.access == kFWKMemAccess_DeviceReads) &&
+        (_FWK_Memory_Checksum(buf, handoff.size) != handoff.checksum))
+    {
+        LOGE("Buffer %p written by the CPU while the device was reading it", buf);
+    }
+#endif /* FWK_MEM_CHECK_OWNERSHIP */
+}
+
+int FWK_Memory_CheckCpuAccess(const void *buf, uint32_t size, const char *who)
+{
+    int ret = 0;
+
+#if FWK_MEM_CHECK_OWNERSHIP
+    uintptr_t start = (uintptr_t)buf;
+
+    FWK_MEM_ENTER_CRITICAL();
+    for (int i = 0; i < FWK_MEM_MAX_HANDOFFS; i++)
+    {
+        uintptr_t owned = (uintptr_t)s_Handoffs[i].buf;
+        if ((owned != 0) && (start < owned + s_Handoffs[i].size) && (owned < start + size))
+        {
+            ret = -1;
+            break;
+        }
+    }
+    FWK_MEM_EXIT_CRITICAL();
+
+    if (ret != 0)
+    {
+        LOGE("%s accesses buffer %p while a device owns it", who, buf);
+    }
+#else
+    (void)buf;
+    (void)size;
+    (void)who;
+#endif /* FWK_MEM_CHECK_OWNERSHIP */
+
+    return ret;
+}
+
+void FWK_Memory_Report(void)
+{
+    uint32_t used[kFWKMemOwner_Count][kFWKMemRegion_Count + 1];
+    uint32_t misplaced = 0;
+
+    memset(used, 0, sizeof(used));
+
+    FWK_MEM_ENTER_CRITICAL();
+    for (int i = 0; i < FWK_MEM_MAX_BUFFERS; i++)
+    {
+        if (s_Buffers[i].buf != NULL)
+        {
+            used[s_Buffers[i].owner][s_Buffers[i].region] += s_Buffers[i].size;
+        }
+    }
+    FWK_MEM_EXIT_CRITICAL();
+
+    LOGI("Memory usage:");
+    for (int region = 0; region < kFWKMemRegion_Count; region++)
+    {
+        uint32_t total = 0;
+        for (int owner = 0; owner < kFWKMemOwner_Count; owner++)
+        {
+            total += used[owner][region];
+        }
+        LOGI("  %-8s %7d of %7d bytes, arena %d of %d", s_RegionNames[region], total, FWK_MEM_REGION_SIZE(region),
+             s_Arenas[region].used, s_Arenas[region].size);
+
+        for (int owner = 0; owner < kFWKMemOwner_Count; owner++)
+        {
+            uint32_t budget = s_Budgets[owner][region];
+            if (used[owner][region] == 0 && budget == 0)
+            {
+                continue;
+            }
+
+            if (budget == 0)
+            {
+                LOGI("    %-8s %7d", s_OwnerNames[owner], used[owner][region]);
+            }
+            else if (used[owner][region] <= budget)
+            {
+                LOGI("    %-8s %7d of %7d", s_OwnerNames[owner], used[owner][region], budget);
+            }
+            else
+            {
+                LOGE("    %-8s %7d over budget of %7d", s_OwnerNames[owner], used[owner][region], budget);
+            }
+        }
+    }
+
+    for (int i = 0; i < FWK_MEM_MAX_BUFFERS; i++)
+    {
+        const fwk_mem_buffer_t *pBuffer = &s_Buffers[i];
+        if ((pBuffer->buf != NULL) && (pBuffer->region != pBuffer->expected))
+        {
+            LOGE("  %s of %d bytes for %s is in %s instead of %s", pBuffer->name, pBuffer->size,
+                 s_OwnerNames[pBuffer->owner], s_RegionNames[pBuffer->region], s_RegionNames[pBuffer->expected]);
+            misplaced++;
+        }
+    }
+
+    if (s_BufferOverflow)
+    {
+        LOGE("  %d buffers not accounted, raise FWK_MEM_MAX_BUFFERS", s_BufferOverflow);
+    }
+
+    if (misplaced == 0)
+    {
+        LOGI("  All buffers are in their region");
+    }
+}
@@ -15,7 +15,37 @@
 #include "fwk_log.h"
 #include "fwk_message.h"
 
-static QueueHandle_t s_MessageQueue[kFWKTaskID_COUNT];
+/* One message class per message id, it decides the lane and what happens when the lane is full */
+typedef struct _fwk_message_class
+{
+    uint8_t prio;     /* fwk_message_prio_t */
+    uint8_t policy;   /* fwk_message_drop_policy_t */
+    uint8_t coalesce; /* merge with a queued message of the same id and device */
+} fwk_message_class_t;
+
+typedef struct _fwk_message_lane
+{
+    fwk_message_t *msgs[FWK_MESSAGE_LANE_LENGTH];
+    unsigned int queuedUs[FWK_MESSAGE_LANE_LENGTH];
+    uint8_t head;
+    fwk_message_stats_t stats;
+} fwk_message_lane_t;
+
+typedef struct _fwk_message_queue
+{
+    /* given once per queued message, taken by the owner task before it pops a lane */
+    SemaphoreHandle_t pending;
+    fwk_message_lane_t lanes[kFWKMessagePrio_Count];
+} fwk_message_queue_t;
+
+typedef enum _fwk_message_insert
+{
+    kMessageInsert_Queued, /* added to the lane, the owner task needs to be signaled */
+    kMessageInsert_Merged, /* coalesced or replaced an evicted message, no new signal */
+    kMessageInsert_Full,
+} fwk_message_insert_t;
+
+static fwk_message_queue_t s_MessageQueue[kFWKTaskID_COUNT];
 
 static const char *s_MessageNameStr[kFWKMessageID_Invalid + 1] = {
     "camera_dq", "camera_set", "display_req", "display_res",
@@ -27,6 +57,32 @@ static const char *s_MessageNameStr[kFWKMessageID_Invalid + 1] = {
     /* input task input triggered*/
     "input_recv", "inputNotify", "raw_msg", "invalid"};
 
+/* Requests are kept in a static message per device and the receiver copies the current payload,
+ * so a queued request already carries the latest one. Vision results are read from the latest result
+ * slot, a queued result is superseded by a newer one. Frames are never coalesced as every camera
+ * dequeue message stands for one buffer to give back to the driver. */
+static fwk_message_class_t s_MessageClass[kFWKMessageID_Invalid] = {
+    [kFWKMessageID_CameraDequeue]                  = {kFWKMessagePrio_Frame, kFWKMessageDrop_Newest, 0},
+    [kFWKMessageID_CameraSet]                      = {kFWKMessagePrio_Control, kFWKMessageDrop_Block, 0},
+    [kFWKMessageID_DisplayRequestFrame]            = {kFWKMessagePrio_Frame, kFWKMessageDrop_Newest, 1},
+    [kFWKMessageID_DisplayResponseFrame]           = {kFWKMessagePrio_Frame, kFWKMessageDrop_Newest, 0},
+    [kFWKMessageID_VAlgoRequestFrame]              = {kFWKMessagePrio_Frame, kFWKMessageDrop_Newest, 1},
+    [kFWKMessageID_VAlgoResponseFrame]             = {kFWKMessagePrio_Frame, kFWKMessageDrop_Newest, 0},
+    [kFWKMessageID_VAlgoResultUpdate]              = {kFWKMessagePrio_Result, kFWKMessageDrop_Oldest, 1},
+    [kFWKMessageID_VAlgoASRInputProcess]           = {kFWKMessagePrio_Frame, kFWKMessageDrop_Newest, 0},
+    [kFWKMessageID_VAlgoASRResultUpdate]           = {kFWKMessagePrio_Result, kFWKMessageDrop_Oldest, 0},
+    [kFWKMessageID_DispatcherRequestShowOverlay]   = {kFWKMessagePrio_Result, kFWKMessageDrop_Newest, 1},
+    [kFWKMessageID_InputReceive]                   = {kFWKMessagePrio_Control, kFWKMessageDrop_Block, 0},
+    [kFWKMessageID_InputNotify]                    = {kFWKMessagePrio_Control, kFWKMessageDrop_Block, 0},
+    [kFWKMessageID_InputAudioReceived]             = {kFWKMessagePrio_Frame, kFWKMessageDrop_Newest, 0},
+    [kFWKMessageID_InputFrameworkReceived]         = {kFWKMessagePrio_Control, kFWKMessageDrop_Block, 0},
+    [kFWKMessageID_InputFrameworkGetComponents]    = {kFWKMessagePrio_Control, kFWKMessageDrop_Block, 0},
+    [kFWKMessageID_InputFrameworkGetDeviceConfigs] = {kFWKMessagePrio_Control, kFWKMessageDrop_Block, 0},
+    [kFWKMessageID_LpmPreEnterSleep]               = {kFWKMessagePrio_Control, kFWKMessageDrop_Block, 0},
+    [kFWKMessageID_Raw]                            = {kFWKMessagePrio_Control, kFWKMessageDrop_Block, 0},
+    [kFWKMessageID_AudioDump]                      = {kFWKMessagePrio_Frame, kFWKMessageDrop_Newest, 0},
+};
+
 const char *FWK_Message_Name(fwk_message_id_t id)
 {
     if (id >= 0 && id < kFWKMessageID_Invalid)
@@ -37,156 +93,590 @@ const char *FWK_Message_Name(fwk_message_id_t id)
     return s_MessageNameStr[kFWKMessageID_Invalid - 1];
 }
 
-BaseType_t FWK_Message_RegisterQueue(fwk_task_id_t taskId, QueueHandle_t queueHandle)
+static inline UBaseType_t _FWK_Message_Lock(uint8_t fromISR)
 {
-    BaseType_t ret = pdTRUE;
+    UBaseType_t savedInterruptStatus = 0;
 
-    if (taskId < kFWKTaskID_COUNT)
+    if (fromISR)
     {
-        s_MessageQueue[taskId] = queueHandle;
+        savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
     }
     else
     {
-        ret = pdFALSE;
+        taskENTER_CRITICAL();
     }
 
-    LOGI("[Message]: Queue %d register", taskId);
-    return ret;
+    return savedInterruptStatus;
 }
 
-BaseType_t FWK_Message_PutFromIsr(fwk_task_id_t taskId, fwk_message_t **ppMsg)
+static inline void _FWK_Message_Unlock(uint8_t fromISR, UBaseType_t savedInterruptStatus)
 {
-    BaseType_t ret                     = pdTRUE;
-    BaseType_t higherPriorityTaskWoken = pdFALSE;
-    msg_info_t msg_info                = (*ppMsg)->msgInfo;
+    if (fromISR)
+    {
+        taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+static inline uint8_t _FWK_Message_Slot(fwk_message_lane_t *pLane, uint8_t pos)
+{
+    return (pLane->head + pos) % FWK_MESSAGE_LANE_LENGTH;
+}
+
+/* A queued message can only be dropped if nobody else holds it and it can be freed from here */
+static bool _FWK_Message_IsEvictable(fwk_message_t *pMsg, uint8_t fromISR)
+{
+    /* the same message is also queued to other tasks */
+    if (pMsg->refCount > 1)
+    {
+        return false;
+    }
+
+    /* a one-shot result reports a change of state, a newer result doesn't supersede it */
+    if ((pMsg->id == kFWKMessageID_VAlgoResultUpdate) && pMsg->payload.result.oneShot)
+    {
+        return false;
+    }
 
 #if FWK_SUPPORT_MULTICORE
-    if ((*ppMsg)->multicore.isMulticoreMessage == 1)
+    /* the same message is also queued to the multicore task */
+    if (pMsg->multicore.isMulticoreMessage == 1)
     {
-        /* send the same message to multicore manager */
-        LOGISRV("Task:[%d] put from isr message:[0x%p]:[%d]", kFWKTaskID_Multicore, (*ppMsg), (*ppMsg)->id);
-        if (s_MessageQueue[kFWKTaskID_Multicore] == 0)
-        {
-            LOGISRD("Task:[%d] is invalid", kFWKTaskID_Multicore);
-        }
-        else
+        return false;
+    }
+#endif /* FWK_SUPPORT_MULTICORE */
+
+    return ((pMsg->freeAfterConsumed == 0) || (fromISR == 0));
+}
+
+/* Free a message dropped from a lane, including the payload its receiver would have freed */
+static void _FWK_Message_Drop(fwk_message_t *pMsg)
+{
+    if (pMsg->freeAfterConsumed && pMsg->payload.freeAfterConsumed)
+    {
+        pMsg->payload.freeAfterConsumed = 0;
+        FWK_FREE(pMsg->payload.data);
+    }
+
+    FWK_Message_Release(pMsg);
+}
+
+#if FWK_SUPPORT_MULTICORE
+/* Hand the ownership of the payload to the message, it is freed with the last reference */
+static void _FWK_Message_Share(fwk_message_t *pMsg, unsigned char refCount)
+{
+    pMsg->refCount = refCount;
+    if (pMsg->payload.freeAfterConsumed)
+    {
+        pMsg->payload.freeAfterConsumed = 0;
+        pMsg->multicore.ownsPayload     = 1;
+    }
+}
+
+static void _FWK_Message_Unshare(fwk_message_t *pMsg)
+{
+    pMsg->refCount = 0;
+    if (pMsg->multicore.ownsPayload)
+    {
+        pMsg->multicore.ownsPayload     = 0;
+        pMsg->payload.freeAfterConsumed = 1;
+    }
+}
+#endif /* FWK_SUPPORT_MULTICORE */
+
+/* Drop one reference of a shared message, returns the references left */
+static unsigned char _FWK_Message_Unref(fwk_message_t *pMsg, uint8_t fromISR)
+{
+    unsigned char refCount = 0;
+    UBaseType_t savedInterruptStatus;
+
+    savedInterruptStatus = _FWK_Message_Lock(fromISR);
+    if (pMsg->refCount > 0)
+    {
+        refCount = --pMsg->refCount;
+    }
+    _FWK_Message_Unlock(fromISR, savedInterruptStatus);
+
+    return refCount;
+}
+
+static void _FWK_Message_Free(fwk_message_t *pMsg)
+{
+#if FWK_SUPPORT_MULTICORE
+    if (pMsg->multicore.ownsPayload)
+    {
+        pMsg->multicore.ownsPayload = 0;
+        FWK_FREE(pMsg->payload.data);
+    }
+#endif /* FWK_SUPPORT_MULTICORE */
+
+    pMsg->freeAfterConsumed = 0;
+    FWK_FREE(pMsg);
+}
+
+/* Called in a critical section */
+static fwk_message_insert_t _FWK_Message_LaneInsert(fwk_message_lane_t *pLane,
+                                                    fwk_message_t *pMsg,
+                                                    fwk_message_class_t msgClass,
+                                                    uint8_t fromISR,
+                                                    fwk_message_t **ppReleased)
+{
+    fwk_message_stats_t *pStats = &pLane->stats;
+    uint8_t slot;
+
+    if (msgClass.coalesce && !((pMsg->id == kFWKMessageID_VAlgoResultUpdate) && pMsg->payload.result.oneShot))
+    {
+        for (uint8_t pos = 0; pos < pStats->depth; pos++)
         {
-            ret =
-                xQueueSendToBackFromISR(s_MessageQueue[kFWKTaskID_Multicore], (void *)ppMsg, &higherPriorityTaskWoken);
+            slot                   = _FWK_Message_Slot(pLane, pos);
+            fwk_message_t *pQueued = pLane->msgs[slot];
 
-            if (ret != pdTRUE)
+            if (pQueued == pMsg)
             {
-                LOGISRE("Task:[%d] put from isr message:[0x%p]:[%d] error %d", kFWKTaskID_Multicore, (*ppMsg),
-                        (*ppMsg)->id, (int)ret);
+                pStats->coalesced++;
+                return kMessageInsert_Merged;
             }
-            else
+
+            if ((pQueued->id == pMsg->id) && (pQueued->payload.devId == pMsg->payload.devId) &&
+                _FWK_Message_IsEvictable(pQueued, fromISR))
             {
-                LOGISRV("Task:[%d] put from isr message:[0x%p]:[%d] done", kFWKTaskID_Multicore, (*ppMsg),
-                        (*ppMsg)->id);
+                /* keep the queued position and time, the newest payload wins */
+                *ppReleased       = pQueued;
+                pLane->msgs[slot] = pMsg;
+                pStats->coalesced++;
+                return kMessageInsert_Merged;
             }
         }
     }
-#endif /* FWK_SUPPORT_MULTICORE */
 
-    LOGISRV("Task:[%d] put from isr message:[0x%p]:[%d]", taskId, (*ppMsg), (*ppMsg)->id);
+    if (pStats->depth < FWK_MESSAGE_LANE_LENGTH)
+    {
+        slot                  = _FWK_Message_Slot(pLane, pStats->depth);
+        pLane->msgs[slot]     = pMsg;
+        pLane->queuedUs[slot] = FWK_CurrentTimeUs();
+        pStats->depth++;
+        pStats->put++;
+        if (pStats->depth > pStats->peak)
+        {
+            pStats->peak = pStats->depth;
+        }
+        return kMessageInsert_Queued;
+    }
 
-    if ((msg_info == kMsgInfo_Remote) || (s_MessageQueue[taskId] == 0))
+    if ((msgClass.policy == kFWKMessageDrop_Oldest) && _FWK_Message_IsEvictable(pLane->msgs[pLane->head], fromISR))
     {
-        /* Multicore has already freed the message, return */
-        return ret;
+        *ppReleased = pLane->msgs[pLane->head];
+
+        /* the lane is full, the oldest slot becomes the newest */
+        pLane->msgs[pLane->head]     = pMsg;
+        pLane->queuedUs[pLane->head] = FWK_CurrentTimeUs();
+        pLane->head                  = _FWK_Message_Slot(pLane, 1);
+        pStats->evicted++;
+        pStats->put++;
+        return kMessageInsert_Merged;
     }
 
-    ret = xQueueSendToBackFromISR(s_MessageQueue[taskId], (void *)ppMsg, &higherPriorityTaskWoken);
+    return kMessageInsert_Full;
+}
 
-    if (ret != pdTRUE)
+static BaseType_t _FWK_Message_Enqueue(fwk_task_id_t taskId,
+                                       fwk_message_t *pMsg,
+                                       uint8_t fromISR,
+                                       BaseType_t *pHigherPriorityTaskWoken)
+{
+    fwk_message_queue_t *pQueue  = &s_MessageQueue[taskId];
+    fwk_message_class_t msgClass = {kFWKMessagePrio_Control, kFWKMessageDrop_Newest, 0};
+    fwk_message_lane_t *pLane;
+    fwk_message_t *pReleased = NULL;
+    fwk_message_insert_t insert;
+    UBaseType_t savedInterruptStatus;
+    TickType_t waited = 0;
+
+    /* the app tasks have their own message ids, which overlap the framework ones, they keep a plain fifo */
+    if ((taskId < kFWKTaskID_APPStart) && (pMsg->id >= 0) && (pMsg->id < kFWKMessageID_Invalid))
     {
-        LOGISRE("Task:[%d] put from isr message:[0x%p]:[%d] error %d", taskId, (*ppMsg), (*ppMsg)->id, (int)ret);
+        msgClass = s_MessageClass[pMsg->id];
     }
-    else
+    pLane = &pQueue->lanes[msgClass.prio];
+
+    while (1)
     {
-        LOGISRV("Task:[%d] put from isr message:[0x%p]:[%d] done", taskId, (*ppMsg), (*ppMsg)->id);
+        savedInterruptStatus = _FWK_Message_Lock(fromISR);
+        insert               = _FWK_Message_LaneInsert(pLane, pMsg, msgClass, fromISR, &pReleased);
+        if ((insert == kMessageInsert_Full) &&
+            ((msgClass.policy != kFWKMessageDrop_Block) || fromISR ||
+             (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) || (waited >= pdMS_TO_TICKS(FWK_MESSAGE_BLOCK_MS))))
+        {
+            pLane->stats.dropped++;
+            _FWK_Message_Unlock(fromISR, savedInterruptStatus);
+            break;
+        }
+        _FWK_Message_Unlock(fromISR, savedInterruptStatus);
+
+        if (insert != kMessageInsert_Full)
+        {
+            break;
+        }
+
+        /* give the receiver a tick to drain the lane */
+        vTaskDelay(1);
+        waited++;
     }
 
-#if RT_PLATFORM
-    portYIELD_FROM_ISR(higherPriorityTaskWoken);
-#endif
+    if (insert == kMessageInsert_Queued)
+    {
+        if (fromISR)
+        {
+            xSemaphoreGiveFromISR(pQueue->pending, pHigherPriorityTaskWoken);
+        }
+        else
+        {
+            xSemaphoreGive(pQueue->pending);
+        }
+    }
+
+    if (pReleased != NULL)
+    {
+        _FWK_Message_Drop(pReleased);
+    }
 
+    return (insert == kMessageInsert_Full) ? pdFALSE : pdTRUE;
+}
+
+BaseType_t FWK_Message_RegisterQueue(fwk_task_id_t taskId, QueueHandle_t queueHandle)
+{
+    BaseType_t ret = pdTRUE;
+
+    if (taskId < kFWKTaskID_COUNT)
+    {
+        memset(&s_MessageQueue[taskId], 0, sizeof(fwk_message_queue_t));
+        s_MessageQueue[taskId].pending = queueHandle;
+    }
+    else
+    {
+        ret = pdFALSE;
+    }
+
+    LOGI("[Message]: Queue %d register", taskId);
     return ret;
 }
 
-BaseType_t FWK_Message_Put(fwk_task_id_t taskId, fwk_message_t **ppMsg)
+/* Deliver the message to its task and, for a multicore message, to the multicore task. Both get the same
+ * message object, the last one to release it frees it. The message belongs to the caller again if it
+ * could not be queued anywhere. */
+static BaseType_t _FWK_Message_Dispatch(fwk_task_id_t taskId,
+                                        fwk_message_t *pMsg,
+                                        uint8_t fromISR,
+                                        BaseType_t *pHigherPriorityTaskWoken)
 {
-    BaseType_t ret      = pdTRUE;
-    msg_info_t msg_info = (*ppMsg)->msgInfo;
+    bool toLocal         = (pMsg->msgInfo != kMsgInfo_Remote) && (s_MessageQueue[taskId].pending != 0);
+    bool toRemote        = false;
+    bool shared          = false;
+    BaseType_t localRet  = pdFALSE;
+    BaseType_t remoteRet = pdFALSE;
+    fwk_message_id_t id  = pMsg->id;
 
 #if FWK_SUPPORT_MULTICORE
-    if ((*ppMsg)->multicore.isMulticoreMessage == 1)
+    toRemote = (pMsg->multicore.isMulticoreMessage == 1) && (s_MessageQueue[kFWKTaskID_Multicore].pending != 0);
+    shared   = toRemote && pMsg->freeAfterConsumed;
+
+    if (shared)
+    {
+        /* one reference per queue, set before the first receiver can run */
+        _FWK_Message_Share(pMsg, toLocal ? 2 : 1);
+    }
+    else
+    {
+        pMsg->multicore.ownsPayload = 0;
+    }
+#endif /* FWK_SUPPORT_MULTICORE */
+
+    if (!shared)
     {
-        /* send the same message to multicore manager */
-        LOGV("Task:[%d] put message:[0x%p]:[%d]", kFWKTaskID_Multicore, (*ppMsg), (*ppMsg)->id);
-        if (s_MessageQueue[kFWKTaskID_Multicore] == 0)
+        /* a message put to one queue has one owner, the senders don't have to zero the messages they allocate */
+        pMsg->refCount = 0;
+    }
+
+#if FWK_SUPPORT_MULTICORE
+    if (toRemote)
+    {
+        remoteRet = _FWK_Message_Enqueue(kFWKTaskID_Multicore, pMsg, fromISR, pHigherPriorityTaskWoken);
+    }
+#endif /* FWK_SUPPORT_MULTICORE */
+
+    if (toLocal)
+    {
+        localRet = _FWK_Message_Enqueue(taskId, pMsg, fromISR, pHigherPriorityTaskWoken);
+    }
+
+    if (fromISR)
+    {
+        if ((toRemote && (remoteRet != pdTRUE)) || (toLocal && (localRet != pdTRUE)))
+        {
+            LOGISRE("Task:[%d] put from isr message:[0x%p]:[%d] error %d %d", taskId, pMsg, id, (int)localRet,
+                    (int)remoteRet);
+        }
+    }
+    else
+    {
+        if ((toRemote && (remoteRet != pdTRUE)) || (toLocal && (localRet != pdTRUE)))
         {
-            LOGD("Task:[%d] is invalid", kFWKTaskID_Multicore);
+            LOGE("Task:[%d] put message:[0x%p]:[%d] error %d %d", taskId, pMsg, id, (int)localRet, (int)remoteRet);
         }
         else
         {
-            ret = xQueueSend(s_MessageQueue[kFWKTaskID_Multicore], (void *)ppMsg, (TickType_t)pdMS_TO_TICKS(0));
+            LOGV("Task:[%d] put message:[0x%p]:[%d] done", taskId, pMsg, id);
+        }
+    }
 
-            if (ret != pdTRUE)
-            {
-                LOGE("Task:[%d] put message:[0x%p]:[%d] error %d", kFWKTaskID_Multicore, (*ppMsg), (*ppMsg)->id,
-                     (int)ret);
-            }
-            else
-            {
-                LOGV("Task:[%d] put message:[0x%p]:[%d] done", kFWKTaskID_Multicore, (*ppMsg), (*ppMsg)->id);
-            }
+    if ((localRet != pdTRUE) && (remoteRet != pdTRUE))
+    {
+#if FWK_SUPPORT_MULTICORE
+        if (shared)
+        {
+            _FWK_Message_Unshare(pMsg);
+        }
+#endif /* FWK_SUPPORT_MULTICORE */
+
+        /* Nothing to deliver is not an error, the message was only meant for the other core */
+        return (toLocal || toRemote) ? pdFALSE : pdTRUE;
+    }
+
+#if FWK_SUPPORT_MULTICORE
+    if (shared && toLocal && ((localRet != pdTRUE) || (remoteRet != pdTRUE)))
+    {
+        /* drop the reference of the queue that refused it, the receivers can't run before an isr returns */
+        if (_FWK_Message_Unref(pMsg, fromISR) == 0)
+        {
+            _FWK_Message_Free(pMsg);
         }
     }
 #endif /* FWK_SUPPORT_MULTICORE */
 
+    return pdTRUE;
+}
+
+BaseType_t FWK_Message_PutFromIsr(fwk_task_id_t taskId, fwk_message_t **ppMsg)
+{
+    BaseType_t ret                     = pdTRUE;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    LOGISRV("Task:[%d] put from isr message:[0x%p]:[%d]", taskId, (*ppMsg), (*ppMsg)->id);
+
+    ret = _FWK_Message_Dispatch(taskId, *ppMsg, FROM_ISR_TRUE, &higherPriorityTaskWoken);
+
+#if RT_PLATFORM
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+#endif
+
+    return ret;
+}
+
+BaseType_t FWK_Message_Put(fwk_task_id_t taskId, fwk_message_t **ppMsg)
+{
     LOGV("Task:[%d] put message:[0x%p]:[%d]", taskId, (*ppMsg), (*ppMsg)->id);
 
-    if ((msg_info == kMsgInfo_Remote) || (s_MessageQueue[taskId] == 0))
+    return _FWK_Message_Dispatch(taskId, *ppMsg, FROM_ISR_FALSE, NULL);
+}
+
+int FWK_Message_Broadcast(uint32_t receiverList, fwk_message_t *pMsg)
+{
+    unsigned char receivers = 0;
+    int delivered           = 0;
+
+    if ((pMsg == NULL) || (pMsg->freeAfterConsumed == 0))
     {
-        /* Multicore has already freed the message, return */
-        return ret;
+        return -1;
     }
 
-    ret = xQueueSend(s_MessageQueue[taskId], (void *)ppMsg, (TickType_t)pdMS_TO_TICKS(0));
+    for (int taskId = 0; taskId < kFWKTaskID_COUNT; taskId++)
+    {
+        if ((receiverList & (1 << taskId)) && (s_MessageQueue[taskId].pending != 0))
+        {
+            receivers++;
+        }
+    }
 
-    if (ret != pdTRUE)
+    if (receivers == 0)
     {
-        LOGE("Task:[%d] put message:[0x%p]:[%d] error %d", taskId, (*ppMsg), (*ppMsg)->id, (int)ret);
+        _FWK_Message_Free(pMsg);
+        return 0;
     }
-    else
+
+    /* one reference per queue, set before the first receiver can run */
+    pMsg->refCount = receivers;
+#if FWK_SUPPORT_MULTICORE
+    pMsg->multicore.ownsPayload = 0;
+#endif /* FWK_SUPPORT_MULTICORE */
+
+    for (int taskId = 0; (taskId < kFWKTaskID_COUNT) && (receivers > 0); taskId++)
     {
-        LOGV("Task:[%d] put message:[0x%p]:[%d] done", taskId, (*ppMsg), (*ppMsg)->id);
+        if (((receiverList & (1 << taskId)) == 0) || (s_MessageQueue[taskId].pending == 0))
+        {
+            continue;
+        }
+
+        receivers--;
+        LOGV("Task:[%d] broadcast message:[0x%p]:[%d]", taskId, pMsg, pMsg->id);
+
+        if (_FWK_Message_Enqueue(taskId, pMsg, FROM_ISR_FALSE, NULL) == pdTRUE)
+        {
+            delivered++;
+        }
+        else
+        {
+            LOGE("Task:[%d] broadcast message:[0x%p]:[%d] error", taskId, pMsg, pMsg->id);
+            FWK_Message_Release(pMsg);
+        }
     }
 
-    return ret;
+    return delivered;
+}
+
+void FWK_Message_Release(fwk_message_t *pMsg)
+{
+    if ((pMsg == NULL) || (pMsg->freeAfterConsumed == 0))
+    {
+        return;
+    }
+
+    /* a message shared between several queues is freed by the last of them */
+    if (_FWK_Message_Unref(pMsg, FROM_ISR_FALSE) != 0)
+    {
+        return;
+    }
+
+    _FWK_Message_Free(pMsg);
 }
 
 BaseType_t FWK_Message_Get(fwk_task_id_t taskId, fwk_message_t **ppMsg)
 {
-    BaseType_t ret = pdTRUE;
+    return FWK_Message_GetTimed(taskId, ppMsg, NULL);
+}
+
+BaseType_t FWK_Message_GetTimed(fwk_task_id_t taskId, fwk_message_t **ppMsg, unsigned int *pQueuedUs)
+{
+    BaseType_t ret              = pdTRUE;
+    fwk_message_queue_t *pQueue = &s_MessageQueue[taskId];
+    unsigned int queuedUs       = 0;
     LOGV("Task:[%d] get message", taskId);
 
-    if (s_MessageQueue[taskId] == 0)
+    *ppMsg = NULL;
+
+    if (pQueue->pending == 0)
     {
         return ret;
     }
 
-    ret = xQueueReceive(s_MessageQueue[taskId], (void *)(ppMsg), portMAX_DELAY);
+    ret = xSemaphoreTake(pQueue->pending, portMAX_DELAY);
+
+    if (ret == pdTRUE)
+    {
+        taskENTER_CRITICAL();
+        for (int prio = 0; prio < kFWKMessagePrio_Count; prio++)
+        {
+            fwk_message_lane_t *pLane = &pQueue->lanes[prio];
+
+            if (pLane->stats.depth)
+            {
+                *ppMsg   = pLane->msgs[pLane->head];
+                queuedUs = FWK_CurrentTimeUs() - pLane->queuedUs[pLane->head];
+                if (queuedUs / 1000 > pLane->stats.maxLatencyMs)
+                {
+                    pLane->stats.maxLatencyMs = queuedUs / 1000;
+                }
+                pLane->head = _FWK_Message_Slot(pLane, 1);
+                pLane->stats.depth--;
+                break;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
 
-    if (ret != pdTRUE)
+    if ((ret != pdTRUE) || (*ppMsg == NULL))
     {
         LOGE("Task:[%d] get message error %d", taskId, (int)ret);
+        ret = pdFALSE;
     }
     else
     {
-        LOGV("Task:[%d] get message:[0x%p]:[%d] done", taskId, (*ppMsg), (*ppMsg)->id);
+        LOGV("Task:[%d] get message:[0x%p]:[%d] done %dus", taskId, (*ppMsg), (*ppMsg)->id, queuedUs);
+    }
+
+    if (pQueuedUs != NULL)
+    {
+        *pQueuedUs = queuedUs;
     }
 
     return ret;
 }
+
+UBaseType_t FWK_Message_Pending(fwk_task_id_t taskId)
+{
+    if ((taskId >= kFWKTaskID_COUNT) || (s_MessageQueue[taskId].pending == 0))
+    {
+        return 0;
+    }
+
+    return uxSemaphoreGetCount(s_MessageQueue[taskId].pending);
+}
+
+bool FWK_Message_IsRegistered(fwk_task_id_t taskId)
+{
+    return ((taskId < kFWKTaskID_COUNT) && (s_MessageQueue[taskId].pending != 0));
+}
+
+int FWK_Message_SetPolicy(fwk_message_id_t id, fwk_message_prio_t prio, fwk_message_drop_policy_t policy, bool coalesce)
+{
+    if ((id < 0) || (id >= kFWKMessageID_Invalid) || (prio >= kFWKMessagePrio_Count) ||
+        (policy > kFWKMessageDrop_Block))
+    {
+        return -1;
+    }
+
+    taskENTER_CRITICAL();
+    s_MessageClass[id].prio     = prio;
+    s_MessageClass[id].policy   = policy;
+    s_MessageClass[id].coalesce = coalesce;
+    taskEXIT_CRITICAL();
+
+    return 0;
+}
+
+int FWK_Message_GetStats(fwk_task_id_t taskId, fwk_message_prio_t prio, fwk_message_stats_t *pStats)
+{
+    if ((taskId >= kFWKTaskID_COUNT) || (prio >= kFWKMessagePrio_Count) || (pStats == NULL) ||
+        (s_MessageQueue[taskId].pending == 0))
+    {
+        return -1;
+    }
+
+    taskENTER_CRITICAL();
+    memcpy(pStats, &s_MessageQueue[taskId].lanes[prio].stats, sizeof(fwk_message_stats_t));
+    taskEXIT_CRITICAL();
+
+    return 0;
+}
+
+void FWK_Message_ResetStats(void)
+{
+    for (int taskId = 0; taskId < kFWKTaskID_COUNT; taskId++)
+    {
+        for (int prio = 0; prio < kFWKMessagePrio_Count; prio++)
+        {
+            fwk_message_stats_t *pStats = &s_MessageQueue[taskId].lanes[prio].stats;
+
+            taskENTER_CRITICAL();
+            pStats->put          = 0;
+            pStats->coalesced    = 0;
+            pStats->evicted      = 0;
+            pStats->dropped      = 0;
+            pStats->maxLatencyMs = 0;
+            pStats->peak         = pStats->depth;
+            taskEXIT_CRITICAL();
+        }
+    }
+}
@@ -32,6 +32,13 @@ typedef struct _multicore_task
     multicore_task_data_t multicoreData;
 } multicore_task_t;
 
+/* Kept between messages, a message is serialized in it once and sent from there */
+typedef struct _multicore_staging
+{
+    uint8_t *buffer;
+    uint32_t size;
+} multicore_staging_t;
+
 /*
  * multicore manager task
  */
@@ -45,6 +52,9 @@ static void *s_MulticoreTaskStack         = NULL;
 static void *s_MulticoreTaskTCBBReference = NULL;
 #endif /* FWK_SUPPORT_STATIC_ALLOCATION */
 
+static multicore_staging_t s_MulticoreStaging;
+static fwk_multicore_stats_t s_MulticoreStats;
+
 static int _FWK_MulticoreManager_RecomposeMessage(fwk_message_t *pMsg, void *data, uint32_t dataSize)
 {
     int ret = 0;
@@ -127,6 +137,10 @@ static int _FWK_MulticoreManager_DeviceCallback(const multicore_dev_t *dev, mult
                 memcpy(pMsg, event.data, sizeof(fwk_message_t));
                 pMsg->freeAfterConsumed = 1;
 
+                /* the header is copied here and the payload, if any, once more when recomposed */
+                s_MulticoreStats.received++;
+                s_MulticoreStats.bytesCopied += event.size;
+
                 /* if the receiver is not register, drop the message */
                 if (FWK_Task_IsRegistered(pMsg->multicore.taskId) == false)
                 {
@@ -137,6 +151,8 @@ static int _FWK_MulticoreManager_DeviceCallback(const multicore_dev_t *dev, mult
                 {
                     pMsg->multicore.isMulticoreMessage  = 0;
                     pMsg->multicore.wasMulticoreMessage = 1;
+                    pMsg->multicore.ownsPayload         = 0;
+                    pMsg->refCount                      = 0;
                     pMsg->msgInfo                       = kMsgInfo_Local;
                     if (event.size > sizeof(fwk_message_t))
                     {
@@ -212,6 +228,51 @@ static int _FWK_MulticoreManager_TaskInit(fwk_task_data_t *pTaskData)
     return error;
 }
 
+/* Serialize the message and its payload for the other core, the staging buffer only grows */
+static uint8_t *_FWK_MulticoreManager_Stage(fwk_message_t *pMsg, uint32_t payloadSize)
+{
+    uint32_t totalSize = payloadSize + sizeof(fwk_message_t);
+
+    if (s_MulticoreStaging.size < totalSize)
+    {
+        if (s_MulticoreStaging.buffer != NULL)
+        {
+            FWK_FREE(s_MulticoreStaging.buffer);
+        }
+
+        s_MulticoreStaging.buffer = FWK_MALLOC(totalSize);
+        s_MulticoreStaging.size   = (s_MulticoreStaging.buffer != NULL) ? totalSize : 0;
+        if (s_MulticoreStaging.buffer == NULL)
+        {
+            LOGE("Failed to allocate memory for the staging buffer.");
+            return NULL;
+        }
+    }
+
+    memcpy(s_MulticoreStaging.buffer, pMsg, sizeof(fwk_message_t));
+    if (payloadSize)
+    {
+        memcpy(s_MulticoreStaging.buffer + sizeof(fwk_message_t), pMsg->payload.data, payloadSize);
+    }
+    s_MulticoreStats.copies++;
+    s_MulticoreStats.bytesCopied += totalSize;
+
+    return s_MulticoreStaging.buffer;
+}
+
+static void _FWK_MulticoreManager_Send(multicore_dev_t *pDev, void *data, uint32_t size)
+{
+    if (pDev->ops->send(pDev, data, size) == kStatus_HAL_MulticoreSuccess)
+    {
+        s_MulticoreStats.sent++;
+        s_MulticoreStats.bytesSent += size;
+    }
+    else
+    {
+        s_MulticoreStats.sendErrors++;
+    }
+}
+
 static void _FWK_MulticoreManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_t *pTaskData)
 {
     if ((pMsg == NULL) || (pTaskData == NULL))
@@ -220,48 +281,36 @@ static void _FWK_MulticoreManager_MessageHandle(fwk_message_t *pMsg, fwk_task_da
     }
 
     multicore_task_data_t *pMulticoreTaskData = (multicore_task_data_t *)pTaskData;
+    multicore_dev_t *pDev                     = pMulticoreTaskData->dev;
     LOGI("MulticoreManage MsgHandler receive msg with id %d for task: %d", pMsg->id, pMsg->multicore.taskId);
+
+    if ((pDev == NULL) || (pDev->ops->send == NULL))
+    {
+        return;
+    }
+
+    /* The message is shared with the local receiver, the payload stays valid until both released it.
+     * It is copied once, straight into the staging buffer the device sends from. */
     switch (pMsg->id)
     {
         case kFWKMessageID_InputReceive:
-        {
-            uint32_t totalSize = pMsg->payload.size + sizeof(fwk_message_t);
-            uint8_t *tmpBuffer = FWK_MALLOC(totalSize);
-            if (tmpBuffer != NULL)
-            {
-                /* Make a deep Copy */
-                memcpy(tmpBuffer, pMsg, sizeof(fwk_message_t));
-                memcpy(tmpBuffer + sizeof(fwk_message_t), pMsg->payload.data, pMsg->payload.size);
-                pMulticoreTaskData->dev->ops->send(pMulticoreTaskData->dev, tmpBuffer, totalSize);
-                FWK_FREE(tmpBuffer);
-            }
-            else
-            {
-                LOGE("Failed to allocate memory for tmpBuffer.");
-            }
-        }
-        break;
         case kFWKMessageID_VAlgoResultUpdate:
         case kFWKMessageID_VAlgoASRResultUpdate:
         case kFWKMessageID_InputNotify:
         {
-            if ((pMulticoreTaskData->dev) && (pMulticoreTaskData->dev->ops->send != NULL))
+            uint8_t *stagedMsg = _FWK_MulticoreManager_Stage(pMsg, pMsg->payload.size);
+            if (stagedMsg != NULL)
             {
-                uint32_t totalSize = pMsg->payload.size + sizeof(fwk_message_t);
-                uint8_t *tmpBuffer = FWK_MALLOC(totalSize);
-                if (tmpBuffer != NULL)
-                {
-                    /* Make a deep Copy */
-                    memcpy(tmpBuffer, pMsg, sizeof(fwk_message_t));
-                    memcpy(tmpBuffer + sizeof(fwk_message_t), pMsg->payload.data, pMsg->payload.size);
-                    ((fwk_message_t *)tmpBuffer)->msgInfo = kMsgInfo_Local;
-                    pMulticoreTaskData->dev->ops->send(pMulticoreTaskData->dev, tmpBuffer, totalSize);
-                    FWK_FREE(tmpBuffer);
-                }
-                else
+                fwk_message_t *pStagedMsg = (fwk_message_t *)stagedMsg;
+
+                /* the copy on the other core owns its own payload */
+                pStagedMsg->refCount              = 0;
+                pStagedMsg->multicore.ownsPayload = 0;
+                if (pMsg->id != kFWKMessageID_InputReceive)
                 {
-                    LOGE("Failed to allocate memory for tmpBuffer.");
+                    pStagedMsg->msgInfo = kMsgInfo_Local;
                 }
+                _FWK_MulticoreManager_Send(pDev, stagedMsg, pMsg->payload.size + sizeof(fwk_message_t));
             }
         }
         break;
@@ -271,10 +320,8 @@ static void _FWK_MulticoreManager_MessageHandle(fwk_message_t *pMsg, fwk_task_da
         case kFWKMessageID_VAlgoResponseFrame:
         case kFWKMessageID_AudioDump:
         {
-            if ((pMulticoreTaskData->dev) && (pMulticoreTaskData->dev->ops->send != NULL))
-            {
-                pMulticoreTaskData->dev->ops->send(pMulticoreTaskData->dev, pMsg, sizeof(fwk_message_t));
-            }
+            /* the frame buffers are shared memory, only the message itself goes through */
+            _FWK_MulticoreManager_Send(pDev, pMsg, sizeof(fwk_message_t));
         }
         break;
         default:
@@ -317,6 +364,23 @@ int FWK_MulticoreManager_Deinit()
     return 0;
 }
 
+int FWK_MulticoreManager_GetStats(fwk_multicore_stats_t *pStats)
+{
+    if (pStats == NULL)
+    {
+        return -1;
+    }
+
+    memcpy(pStats, &s_MulticoreStats, sizeof(fwk_multicore_stats_t));
+
+    return 0;
+}
+
+void FWK_MulticoreManager_ResetStats(void)
+{
+    memset(&s_MulticoreStats, 0, sizeof(fwk_multicore_stats_t));
+}
+
 int FWK_MulticoreManager_DeviceRegister(multicore_dev_t *dev)
 {
     int error = -1;
@@ -17,6 +17,7 @@
 #include "fwk_task.h"
 #include "fwk_graphics.h"
 #include "fwk_output_manager.h"
+#include "fwk_vision_algo_manager.h"
 
 #include "hal_event_descriptor_common.h"
 
@@ -26,6 +27,7 @@ typedef struct
     output_dev_t *devs[MAXIMUM_OUTPUT_DEV]; /* registered output devices */
     List_t outEventReceiverList;            /* registered output event receiver */
     int uiReceiverCount;
+    fwk_message_t overlayMsg;               /* overlay update sent to the camera manager, queued once */
 } output_task_data_t;
 
 typedef struct
@@ -217,6 +219,7 @@ static void _FWK_OutputManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_
     pxListItem                    = listGET_HEAD_ENTRY(pReceiverList);
     pxListEnd                     = listGET_END_MARKER(pReceiverList);
     output_event_receiver_t *pRec = NULL;
+    void *pResult                 = pMsg->payload.data;
 
     switch (pMsg->id)
     {
@@ -230,6 +233,16 @@ static void _FWK_OutputManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_
                 break;
             }
 
+            if ((pMsg->id == kFWKMessageID_VAlgoResultUpdate) && pMsg->payload.result.latest)
+            {
+                pResult = FWK_VisionAlgoManager_GetLatestResult(pMsg->payload.devId, NULL);
+                if (pResult == NULL)
+                {
+                    /* the result was already handled with a previous message */
+                    break;
+                }
+            }
+
             while (pxListItem != pxListEnd)
             {
                 pRec = (output_event_receiver_t *)listGET_LIST_ITEM_OWNER(pxListItem);
@@ -250,8 +263,7 @@ static void _FWK_OutputManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_
                     }
                     else if (pMsg->id == kFWKMessageID_VAlgoResultUpdate)
                     {
-                        error =
-                            pRec->handler->inferenceComplete(pRec->pDev, kOutputAlgoSource_Vision, pMsg->payload.data);
+                        error = pRec->handler->inferenceComplete(pRec->pDev, kOutputAlgoSource_Vision, pResult);
                         if ((error == kStatus_HAL_OutputSuccess) && (pRec->pDev->attr.type == kOutputDevType_UI))
                         {
                             updateOverlayUI = 1;
@@ -266,19 +278,10 @@ static void _FWK_OutputManager_MessageHandle(fwk_message_t *pMsg, fwk_task_data_
                     if (updateOverlayUI)
                     {
                         /* only support one UI receiver currently */
-                        fwk_message_t *pMsg = (fwk_message_t *)FWK_MALLOC(sizeof(fwk_message_t));
-                        if (pMsg != NULL)
-                        {
-                            memset(pMsg, 0, sizeof(fwk_message_t));
-                            pMsg->id                       = kFWKMessageID_DispatcherRequestShowOverlay;
-                            pMsg->freeAfterConsumed        = 1;
-                            pMsg->payload.overlay.pSurface = pRec->pDev->attr.pSurface;
-                            FWK_Message_Put(kFWKTaskID_Camera, &pMsg);
-                        }
-                        else
-                        {
-                            LOGE("Can't allocate memory for pMsg.");
-                        }
+                        fwk_message_t *pOverlayMsg            = &pOutputTaskData->overlayMsg;
+                        pOverlayMsg->id                       = kFWKMessageID_DispatcherRequestShowOverlay;
+                        pOverlayMsg->payload.overlay.pSurface = pRec->pDev->attr.pSurface;
+                        FWK_Message_Put(kFWKTaskID_Camera, &pOverlayMsg);
                     }
 
                     if (error)
@@ -16,14 +16,97 @@
 #include "fwk_message.h"
 #include "fwk_task.h"
 
-#define mainQUEUE_LENGTH (10)
+typedef struct _fwk_task_runtime
+{
+    fwk_task_stats_t stats;
+    uint64_t busyUs;    /* time spent in the handlers since the stats were reset */
+    uint64_t elapsedUs; /* time since the stats were reset, up to lastUs */
+    unsigned int lastUs;
+} fwk_task_runtime_t;
 
 static TaskHandle_t s_TaskList[kFWKTaskID_COUNT];
+static fwk_task_runtime_t s_TaskRuntime[kFWKTaskID_COUNT];
+static const unsigned int s_HistBoundsUs[FWK_TASK_HIST_BUCKETS - 1] = FWK_TASK_HIST_BOUNDS_US;
+
+static void _fwk_task_hist_add(uint32_t *hist, unsigned int us)
+{
+    int bucket = 0;
+
+    while ((bucket < FWK_TASK_HIST_BUCKETS - 1) && (us >= s_HistBoundsUs[bucket]))
+    {
+        bucket++;
+    }
+
+    hist[bucket]++;
+}
+
+/* Handle one message, returns the time spent in the handler */
+static unsigned int _fwk_task_handle_message(fwk_task_t *slnTask)
+{
+    fwk_message_t *pMsg          = NULL;
+    fwk_task_runtime_t *pRunTime = &s_TaskRuntime[slnTask->taskId];
+    unsigned int queuedUs        = 0;
+    fwk_message_id_t msgId       = kFWKMessageID_Invalid;
+    unsigned int startUs;
+    unsigned int handlerUs;
+
+    LOGV("Task:[%p]:[%d]:[%p] Waiting to receive message", slnTask, slnTask->taskId, slnTask->data->queueHandle);
+
+    BaseType_t ret = FWK_Message_GetTimed(slnTask->taskId, &pMsg, &queuedUs);
+
+    startUs = FWK_CurrentTimeUs();
+
+    if (ret == pdTRUE)
+    {
+        LOGV("Task:[%p]:[%d]:[%p] Received message:[%p]", slnTask, slnTask->taskId, slnTask->data->queueHandle,
+             pMsg);
+        msgId = pMsg->id;
+        slnTask->msgHandle(pMsg, slnTask->data);
+    }
+    else
+    {
+        LOGE("Task:[%p]:[%d]:[%p] Received error message:[%d]", slnTask, slnTask->taskId,
+             slnTask->data->queueHandle, (int)ret);
+    }
+
+    /* a message shared with the multicore task is freed by the last of them */
+    FWK_Message_Release(pMsg);
+
+    handlerUs = FWK_CurrentTimeUs() - startUs;
+
+    if (ret == pdTRUE)
+    {
+        taskENTER_CRITICAL();
+        pRunTime->stats.messages++;
+        pRunTime->busyUs += handlerUs;
+        pRunTime->elapsedUs += FWK_CurrentTimeUs() - pRunTime->lastUs;
+        pRunTime->lastUs = FWK_CurrentTimeUs();
+        if (handlerUs > pRunTime->stats.maxHandlerUs)
+        {
+            pRunTime->stats.maxHandlerUs = handlerUs;
+        }
+        if (slnTask->budgetUs && (handlerUs > slnTask->budgetUs))
+        {
+            pRunTime->stats.budgetOverruns++;
+        }
+        _fwk_task_hist_add(pRunTime->stats.waitHist, queuedUs);
+        _fwk_task_hist_add(pRunTime->stats.handlerHist, handlerUs);
+        taskEXIT_CRITICAL();
+
+        if (slnTask->budgetUs && (handlerUs > slnTask->budgetUs))
+        {
+            LOGV("Task:[%p]:[%d] message:[%d] took %dus, budget %dus", slnTask, slnTask->taskId, msgId, handlerUs,
+                 slnTask->budgetUs);
+        }
+    }
+
+    return handlerUs;
+}
 
 static void _fwk_task_proc(void *pvParameters)
 {
-    fwk_message_t *pMsg;
-    fwk_task_t *slnTask = (fwk_task_t *)pvParameters;
+    fwk_task_t *slnTask  = (fwk_task_t *)pvParameters;
+    fwk_task_mode_t mode = slnTask->mode;
 
     LOGD("Task:[%p]:[%d]:[%p] Started", slnTask, slnTask->taskId, slnTask->data->queueHandle);
 
@@ -37,61 +120,54 @@ static void _fwk_task_proc(void *pvParameters)
         }
     }
 
-    while (1)
+    if (slnTask->data == NULL)
     {
-        LOGV("Task:[%p]:[%d]:[%p] Waiting to receive message", slnTask, slnTask->taskId, slnTask->data->queueHandle);
+        LOGE("Task data is empty");
+        while (1)
+            ;
+    }
 
-        if (slnTask->data == NULL)
-        {
-            LOGE("Task data is empty");
-            while (1)
-                ;
-        }
-        BaseType_t ret = xQueueReceive(slnTask->data->queueHandle, (void *)&pMsg, portMAX_DELAY);
+    if (mode == kFWKTaskMode_Default)
+    {
+        mode = FWK_SUPPORT_TASK_FIXED_DELAY ? kFWKTaskMode_FixedDelay : kFWKTaskMode_EventDriven;
+    }
+
+    s_TaskRuntime[slnTask->taskId].lastUs = FWK_CurrentTimeUs();
 
-        if (ret == pdTRUE)
+    while (1)
+    {
+        if (mode == kFWKTaskMode_FixedDelay)
         {
-            LOGV("Task:[%p]:[%d]:[%p] Received message:[%p]", slnTask, slnTask->taskId, slnTask->data->queueHandle,
-                 pMsg);
-            slnTask->msgHandle(pMsg, slnTask->data);
+            _fwk_task_handle_message(slnTask);
+            s_TaskRuntime[slnTask->taskId].stats.batches++;
+
+            if (slnTask->delayMs > 0)
+            {
+                vTaskDelay(pdMS_TO_TICKS(slnTask->delayMs));
+            }
         }
         else
         {
-            LOGE("Task:[%p]:[%d]:[%p] Received error message:[%d]", slnTask, slnTask->taskId,
-                 slnTask->data->queueHandle, (int)ret);
-        }
+            unsigned int batchUs = 0;
+            int batchLength      = 0;
 
-        /* Multicore task shouldn't free the message */
-        if (pMsg && (pMsg->freeAfterConsumed))
-        {
-#if FWK_SUPPORT_MULTICORE
-            /* Don't free if the message is multicore and the task is the multicore task */
-            if ((pMsg->multicore.isMulticoreMessage == 0) || (kFWKTaskID_Multicore != slnTask->taskId))
-#endif /* FWK_SUPPORT_MULTICORE */
+            /* block until there is a message, then keep handling while the queue has more */
+            do
             {
-                pMsg->freeAfterConsumed = 0;
-                FWK_FREE(pMsg);
-            }
+                batchUs += _fwk_task_handle_message(slnTask);
+                batchLength++;
+            } while ((batchLength < FWK_TASK_BATCH_LENGTH) &&
+                     ((slnTask->budgetUs == 0) || (batchUs < slnTask->budgetUs * FWK_TASK_BATCH_LENGTH)) &&
+                     FWK_Message_Pending(slnTask->taskId));
 
-            /* free the multicore message if it is only for remote */
-            if ((kFWKTaskID_Multicore == slnTask->taskId) && (pMsg->multicore.isMulticoreMessage == 1) && (pMsg->msgInfo == kMsgInfo_Remote))
+            s_TaskRuntime[slnTask->taskId].stats.batches++;
+
+            /* more work left, let the tasks of the same priority run before the next batch */
+            if (FWK_Message_Pending(slnTask->taskId))
             {
-                /* free the payload */
-                if (pMsg->payload.freeAfterConsumed)
-                {
-                    pMsg->payload.freeAfterConsumed = 0;
-                    FWK_FREE(pMsg->payload.data);
-                }
-               // LOGD("I FREE %d %p", pMsg->id, pMsg);
-                pMsg->freeAfterConsumed = 0;
-                FWK_FREE(pMsg);
+                taskYIELD();
             }
         }
-
-        if (slnTask->delayMs > 0)
-        {
-            vTaskDelay(pdMS_TO_TICKS(slnTask->delayMs));
-        }
     }
 }
 static uint32_t _fwk_task_get_prio(TaskHandle_t task)
@@ -140,6 +216,30 @@ bool FWK_Task_IsRegistered(fwk_task_id_t taskId)
     return s_TaskList[taskId] != NULL ? true : false;
 }
 
+int FWK_Task_GetPriority(fwk_task_id_t taskId, int *taskPriority)
+{
+    if ((taskPriority == NULL) || (s_TaskList[taskId] == NULL))
+    {
+        return -1;
+    }
+
+    *taskPriority = configMAX_PRIORITIES - 1 - (int)_fwk_task_get_prio(s_TaskList[taskId]);
+
+    return 0;
+}
+
+int FWK_Task_SetPriority(fwk_task_id_t taskId, int taskPriority)
+{
+    if ((s_TaskList[taskId] == NULL) || (taskPriority < 0) || (taskPriority > configMAX_PRIORITIES - 1))
+    {
+        return -1;
+    }
+
+    vTaskPrioritySet(s_TaskList[taskId], configMAX_PRIORITIES - 1 - taskPriority);
+
+    return 0;
+}
+
 void FWK_Task_Start(fwk_task_t *pTask, const char *taskName, int taskStackSize, int taskPriority)
 {
     if (pTask == NULL)
@@ -154,8 +254,8 @@ void FWK_Task_Start(fwk_task_t *pTask, const char *taskName, int taskStackSize,
         while (1)
             ;
     }
-    unsigned payloadSize     = sizeof(fwk_message_t *);
-    pTask->data->queueHandle = xQueueCreate(mainQUEUE_LENGTH, payloadSize);
+    /* the messages are kept in the priority lanes of the message queue, the task only waits on their count */
+    pTask->data->queueHandle = xSemaphoreCreateCounting(FWK_MESSAGE_QUEUE_LENGTH, 0);
 
     LOGD("Task:[%p]:[%d]:[%p]:[%s] Start", pTask, pTask->taskId, pTask->data->queueHandle, taskName);
 
@@ -200,3 +300,39 @@ void FWK_Task_Start(fwk_task_t *pTask, const char *taskName, int taskStackSize,
         }
     }
 }
+
+int FWK_Task_GetStats(fwk_task_id_t taskId, fwk_task_stats_t *pStats)
+{
+    fwk_task_runtime_t *pRunTime;
+
+    if ((taskId >= kFWKTaskID_COUNT) || (pStats == NULL) || (s_TaskList[taskId] == NULL))
+    {
+        return -1;
+    }
+
+    pRunTime = &s_TaskRuntime[taskId];
+
+    taskENTER_CRITICAL();
+    pRunTime->elapsedUs += FWK_CurrentTimeUs() - pRunTime->lastUs;
+    pRunTime->lastUs = FWK_CurrentTimeUs();
+    memcpy(pStats, &pRunTime->stats, sizeof(fwk_task_stats_t));
+    pStats->utilization = pRunTime->elapsedUs ? (uint32_t)((pRunTime->busyUs * 100) / pRunTime->elapsedUs) : 0;
+    taskEXIT_CRITICAL();
+
+    return 0;
+}
+
+void FWK_Task_ResetStats(void)
+{
+    for (int taskId = 0; taskId < kFWKTaskID_COUNT; taskId++)
+    {
+        fwk_task_runtime_t *pRunTime = &s_TaskRuntime[taskId];
+
+        taskENTER_CRITICAL();
+        memset(&pRunTime->stats, 0, sizeof(fwk_task_stats_t));
+        pRunTime->busyUs    = 0;
+        pRunTime->elapsedUs = 0;
+        pRunTime->lastUs    = FWK_CurrentTimeUs();
+        taskEXIT_CRITICAL();
+    }
+}
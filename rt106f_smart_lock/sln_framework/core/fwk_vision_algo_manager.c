@@ -16,8 +16,27 @@
 #include "fwk_message.h"
 #include "fwk_task.h"
 #include "fwk_perf.h"
+#include "fwk_lpm_manager.h"
 #include "fwk_vision_algo_manager.h"
 
+#define VISION_ALGO_RESULT_SLOTS 3
+#define VISION_ALGO_RESULT_FRESH 0x80
+#define VISION_ALGO_RESULT_EVENT 0x40
+
+/* Latest results of a device, triple buffered between the device and the output manager */
+typedef struct
+{
+    uint8_t *data;                                   /* VISION_ALGO_RESULT_SLOTS results of size bytes */
+    unsigned int size;                               /* size of the first result copied */
+    unsigned int sequence[VISION_ALGO_RESULT_SLOTS]; /* sequence of the result in each slot */
+    unsigned int published;                          /* sequence of the last result copied */
+    uint8_t write;                                   /* slot written by the device */
+    uint8_t read;                                    /* slot read by the output manager */
+    uint8_t latest;                                  /* last slot written, flagged fresh until it is read and
+                                                        flagged event for a one-shot result */
+    fwk_message_t msg;                               /* queued once until the output manager handles it */
+} vision_algo_result_slots_t;
+
 typedef struct
 {
     fwk_task_data_t commonData;
@@ -26,7 +45,11 @@ typedef struct
     /* vision algorithm request frame message */
     fwk_message_t VAlgoReqMsgs[MAXIMUM_VISION_ALGO_DEV * kVAlgoFrameID_Count];
     int frameReady[MAXIMUM_VISION_ALGO_DEV * kVAlgoFrameID_Count];
-
+    /* vision algorithm results */
+    vision_algo_result_slots_t results[MAXIMUM_VISION_ALGO_DEV];
+    vision_algo_result_stats_t resultStats;
+    /* priority the task runs at once the devices are initialized */
+    int taskPriority;
 } vision_algo_task_data_t;
 
 typedef struct
@@ -48,6 +71,65 @@ static void *s_VisionAlgoTaskStack        = NULL;
 static void *s_VisionAlgoTaskTCBReference = NULL;
 #endif
 
+/*
+ * copy a result to the free slot and make it the latest one, unless the latest one is a one-shot result not read yet
+ */
+static bool _FWK_VisionAlgoManager_PublishResult(int devId, valgo_event_t *pEvent)
+{
+    vision_algo_result_slots_t *pSlots = &s_VisionAlgoTask.algoData.results[devId];
+    uint8_t unread                     = VISION_ALGO_RESULT_FRESH | VISION_ALGO_RESULT_EVENT;
+    uint8_t previous;
+
+    /* the slots are sized by the first result, a device always reports the same result structure */
+    if (pSlots->data == NULL)
+    {
+        pSlots->data = FWK_MALLOC(VISION_ALGO_RESULT_SLOTS * pEvent->size);
+        if (pSlots->data == NULL)
+        {
+            return false;
+        }
+        pSlots->size   = pEvent->size;
+        pSlots->write  = 0;
+        pSlots->read   = 1;
+        pSlots->latest = 2;
+    }
+
+    if (pEvent->size > pSlots->size)
+    {
+        return false;
+    }
+
+    /* only the reader clears the flags, the held result can't be replaced after the check */
+    if ((__atomic_load_n(&pSlots->latest, __ATOMIC_ACQUIRE) & unread) == unread)
+    {
+        if (pEvent->stateChange)
+        {
+            /* queued on the heap behind the held one */
+            return false;
+        }
+
+        s_VisionAlgoTask.algoData.resultStats.skipped++;
+        return true;
+    }
+
+    memcpy(&pSlots->data[pSlots->write * pSlots->size], pEvent->data, pEvent->size);
+    pSlots->sequence[pSlots->write] = ++pSlots->published;
+
+    previous = __atomic_exchange_n(&pSlots->latest,
+                                   pSlots->write | VISION_ALGO_RESULT_FRESH |
+                                       (pEvent->stateChange ? VISION_ALGO_RESULT_EVENT : 0),
+                                   __ATOMIC_ACQ_REL);
+    pSlots->write = previous & ~unread;
+
+    s_VisionAlgoTask.algoData.resultStats.published++;
+    if (previous & VISION_ALGO_RESULT_FRESH)
+    {
+        s_VisionAlgoTask.algoData.resultStats.skipped++;
+    }
+
+    return true;
+}
+
 /*
  * vision algorithm dev callback
  */
@@ -61,6 +143,10 @@ static int _FWK_VisionAlgoManager_DeviceCallback(int devId, valgo_event_t event,
         {
             taskID = kFWKTaskID_Output;
             msgID  = kFWKMessageID_VAlgoResultUpdate;
+            if (!fromISR)
+            {
+                FWK_LpmManager_ResumeMark(kFWKLpmResume_FirstResult);
+            }
         }
         break;
         case kVAlgoEvent_VisionLedPwmControl:
@@ -94,6 +180,7 @@ static int _FWK_VisionAlgoManager_DeviceCallback(int devId, valgo_event_t event,
                         LOGI("Send vision algo dev[%d] frame[%d] request", devId, frame_index);
                         fwk_message_t *pMsg;
                         pMsg = &s_VisionAlgoTask.algoData.VAlgoReqMsgs[devId * kVAlgoFrameID_Count + frame_index];
+                        pMsg->payload.frame.roi = pDev->data.frames[frame_index].roi;
                         if (event.eventInfo < kEventInfo_Invalid)
                         {
                             pMsg->msgInfo = event.eventInfo;
@@ -121,6 +208,34 @@ static int _FWK_VisionAlgoManager_DeviceCallback(int devId, valgo_event_t event,
         return 0;
     }
 
+    if ((event.eventId == kVAlgoEvent_VisionResultUpdate) && (event.copy != 0))
+    {
+        bool toRemote = false;
+#if FWK_SUPPORT_MULTICORE
+        /* the other core gets a copy of the payload, the slots are local */
+        toRemote = (event.eventInfo != kEventInfo_Local) && (event.eventInfo < kEventInfo_Invalid) &&
+                   FWK_Message_IsRegistered(kFWKTaskID_Multicore);
+#endif /* FWK_SUPPORT_MULTICORE */
+
+        if ((toRemote == false) && _FWK_VisionAlgoManager_PublishResult(devId, &event))
+        {
+            fwk_message_t *pMsg = &s_VisionAlgoTask.algoData.results[devId].msg;
+
+            if (fromISR)
+            {
+                FWK_Message_PutFromIsr(taskID, &pMsg);
+            }
+            else
+            {
+                FWK_Message_Put(taskID, &pMsg);
+            }
+
+            return 0;
+        }
+
+        s_VisionAlgoTask.algoData.resultStats.allocated++;
+    }
+
     switch (event.eventId)
     {
         case kVAlgoEvent_VisionResultUpdate:
@@ -137,6 +252,10 @@ static int _FWK_VisionAlgoManager_DeviceCallback(int devId, valgo_event_t event,
                 pMsg->id                = msgID;
                 pMsg->payload.devId     = devId;
                 pMsg->payload.size      = event.size;
+                if (event.eventId == kVAlgoEvent_VisionResultUpdate)
+                {
+                    pMsg->payload.result.oneShot = event.stateChange;
+                }
 
                 if (event.eventInfo < kEventInfo_Invalid)
                 {
@@ -246,6 +365,7 @@ static int _FWK_VisionAlgoManager_TaskInit(fwk_task_data_t *pTaskData)
                     pMsg->payload.frame.format    = pDev->data.frames[frame_index].format;
                     pMsg->payload.frame.srcFormat = pDev->data.frames[frame_index].srcFormat;
                     pMsg->payload.data            = pDev->data.frames[frame_index].data;
+                    pMsg->payload.frame.roi       = pDev->data.frames[frame_index].roi;
 
                     /* will request the frame only the device is configured as auto start */
                     if (pDev->data.autoStart)
@@ -261,6 +381,13 @@ static int _FWK_VisionAlgoManager_TaskInit(fwk_task_data_t *pTaskData)
         }
     }
 
+    FWK_LpmManager_ResumeMark(kFWKLpmResume_AlgoReady);
+
+#if FWK_SUPPORT_FAST_RESUME
+    /* back to the priority of the recognition, below the display and the UI */
+    FWK_Task_SetPriority(kFWKTaskID_VisionAlgo, pAlgoTaskData->taskPriority);
+#endif /* FWK_SUPPORT_FAST_RESUME */
+
     return error;
 }
 
@@ -282,6 +409,10 @@ static void _FWK_VisionAlgoManager_MessageHandle(fwk_message_t *pMsg, fwk_task_d
             {
                 int allFramesReady                             = 1;
                 pAlgoTaskData->frameReady[pMsg->payload.devId] = 1;
+
+                /* let the device know which part of the frame was converted */
+                pDev->data.frames[pMsg->payload.devId % kVAlgoFrameID_Count].delivered = pMsg->payload.frame.roi;
+
                 for (int frame_index = 0; frame_index < kVAlgoFrameID_Count; frame_index++)
                 {
                     if ((pDev->data.frames[frame_index].is_supported) &&
@@ -314,8 +445,9 @@ static void _FWK_VisionAlgoManager_MessageHandle(fwk_message_t *pMsg, fwk_task_d
                             fwk_message_t *pVAlgoReqMsg;
                             pVAlgoReqMsg =
                                 &pAlgoTaskData->VAlgoReqMsgs[valgo_dev_id * kVAlgoFrameID_Count + frame_index];
-                            pVAlgoReqMsg->id            = kFWKMessageID_VAlgoRequestFrame;
-                            pVAlgoReqMsg->payload.devId = valgo_dev_id * kVAlgoFrameID_Count + frame_index;
+                            pVAlgoReqMsg->id                = kFWKMessageID_VAlgoRequestFrame;
+                            pVAlgoReqMsg->payload.devId     = valgo_dev_id * kVAlgoFrameID_Count + frame_index;
+                            pVAlgoReqMsg->payload.frame.roi = pDev->data.frames[frame_index].roi;
 #if FWK_SUPPORT_MULTICORE
                             pVAlgoReqMsg->multicore.isMulticoreMessage = 1;
                             pVAlgoReqMsg->multicore.taskId             = kFWKTaskID_Camera;
@@ -422,6 +554,18 @@ int FWK_VisionAlgoManager_Start(int taskPriority)
     s_VisionAlgoTask.task.delayMs    = 1;
     s_VisionAlgoTask.task.taskStack  = s_VisionAlgoTaskStack;
     s_VisionAlgoTask.task.taskBuffer = s_VisionAlgoTaskTCBReference;
+
+    s_VisionAlgoTask.algoData.taskPriority = taskPriority;
+#if FWK_SUPPORT_FAST_RESUME
+    /* The models and the face database take longer to load than the sensors to start, load them while the camera task
+     * waits on the sensors. The task starts right below the camera task, the camera still goes first */
+    int cameraPriority;
+    if ((FWK_Task_GetPriority(kFWKTaskID_Camera, &cameraPriority) == 0) && (cameraPriority + 1 < taskPriority))
+    {
+        taskPriority = cameraPriority + 1;
+    }
+#endif /* FWK_SUPPORT_FAST_RESUME */
+
     FWK_Task_Start((fwk_task_t *)&s_VisionAlgoTask.task, VISION_ALGO_MANAGER_TASK_NAME, VISION_ALGO_MANAGER_TASK_STACK,
                    taskPriority);
 
@@ -444,9 +588,60 @@ int FWK_VisionAlgoManager_DeviceRegister(vision_algo_dev_t *dev)
         {
             dev->id                           = i;
             s_VisionAlgoTask.algoData.devs[i] = dev;
+
+            vision_algo_result_slots_t *pSlots = &s_VisionAlgoTask.algoData.results[i];
+            memset(pSlots, 0, sizeof(vision_algo_result_slots_t));
+            pSlots->msg.id                    = kFWKMessageID_VAlgoResultUpdate;
+            pSlots->msg.payload.devId         = i;
+            pSlots->msg.payload.result.latest = 1;
             return 0;
         }
     }
 
     return error;
 }
+
+void *FWK_VisionAlgoManager_GetLatestResult(int devId, unsigned int *pSequence)
+{
+    vision_algo_result_slots_t *pSlots;
+    uint8_t previous;
+
+    if ((devId < 0) || (devId >= MAXIMUM_VISION_ALGO_DEV))
+    {
+        return NULL;
+    }
+
+    pSlots = &s_VisionAlgoTask.algoData.results[devId];
+    if ((pSlots->data == NULL) ||
+        ((__atomic_load_n(&pSlots->latest, __ATOMIC_ACQUIRE) & VISION_ALGO_RESULT_FRESH) == 0))
+    {
+        return NULL;
+    }
+
+    previous     = __atomic_exchange_n(&pSlots->latest, pSlots->read, __ATOMIC_ACQ_REL);
+    pSlots->read = previous & ~(VISION_ALGO_RESULT_FRESH | VISION_ALGO_RESULT_EVENT);
+
+    if (pSequence != NULL)
+    {
+        *pSequence = pSlots->sequence[pSlots->read];
+    }
+
+    return &pSlots->data[pSlots->read * pSlots->size];
+}
+
+int FWK_VisionAlgoManager_GetResultStats(vision_algo_result_stats_t *pStats)
+{
+    if (pStats == NULL)
+    {
+        return -1;
+    }
+
+    memcpy(pStats, &s_VisionAlgoTask.algoData.resultStats, sizeof(vision_algo_result_stats_t));
+
+    return 0;
+}
+
+void FWK_VisionAlgoManager_ResetResultStats(void)
+{
+    memset(&s_VisionAlgoTask.algoData.resultStats, 0, sizeof(vision_algo_result_stats_t));
+}
@@ -14,6 +14,7 @@
 #ifdef ENABLE_CSI_SHARED_DUAL_CAMERA
 #include <FreeRTOS.h>
 #include <task.h>
+#include <semphr.h>
 #include <stdlib.h>
 #include <time.h>
 
@@ -26,9 +27,12 @@
 
 #include "fwk_log.h"
 #include "fwk_camera_manager.h"
+#include "fwk_memory.h"
+#include "fwk_platform.h"
 
 #include "hal_camera_dev.h"
 #include "hal_event_descriptor_common.h"
+#include "app_config.h"
 
 #define CAMERA_NAME             "CSI_DUAL_GC0308"
 /* the default pixel format will be set to GRAY which is IR camera sensor */
@@ -40,6 +44,11 @@
 
 #define CAMERA_RGB_CONTROL_FLAGS (kCAMERA_HrefActiveHigh | kCAMERA_DataLatchOnRisingEdge)
 
+#define CAMERA_SWITCH_TASK_NAME     "csi_dual_switch"
+#define CAMERA_SWITCH_TASK_STACK    512
+#define CAMERA_SWITCH_TASK_PRIORITY (configMAX_PRIORITIES - 1)
+#define CAMERA_FPS_WINDOW_US        1000000
+
 typedef enum _csi_shared_dual_camera_id
 {
     CAMERA_RGB = 0,
@@ -47,8 +56,49 @@ typedef enum _csi_shared_dual_camera_id
     CAMERA_NUM,
 } csi_shared_dual_camera_id;
 
+/* Sensor writes of a switch, staged by the frame done interrupt and issued by the switch task */
+typedef struct _csi_shared_dual_switch
+{
+    camera_device_handle_t *stop;
+    camera_device_handle_t *start;
+} csi_shared_dual_switch_t;
+
+typedef struct _csi_shared_dual_frame
+{
+    uint8_t *buffer;
+    csi_shared_dual_camera_id camera;
+} csi_shared_dual_frame_t;
+
+/* Interleaves the two sensors on the CSI, driven by the frame done interrupt */
+typedef struct _csi_shared_dual_scheduler
+{
+    uint8_t ratio[2][CAMERA_NUM]; /* frames in a row per camera, without then with a face */
+    uint8_t face;                 /* the vision algorithm is processing a face */
+    uint8_t current;              /* camera the CSI receives from */
+    uint8_t runLeft;              /* frames left before the next switch */
+    uint8_t discardLeft;          /* frames to drop after the last switch */
+    volatile uint8_t switching;   /* the staged switch is not issued yet */
+    csi_shared_dual_switch_t staged;
+    csi_shared_dual_frame_t ready[CAMERA_DEV_BUFFER_COUNT];
+    uint8_t readyHead;
+    uint8_t readyCount;
+    uint32_t windowStartUs;
+    uint32_t windowFrames[CAMERA_NUM];
+    TaskHandle_t switchTask;
+    SemaphoreHandle_t sensorLock; /* serializes the I2C accesses to the sensors */
+    csi_shared_dual_stats_t stats;
+} csi_shared_dual_scheduler_t;
+
+#if ENABLE_CACHED_FRAME_BUFFERS
+#define CAMERA_FRAME_BUFFER_REGION kFWKMemRegion_SdramCached
+AT_CACHEABLE_SECTION_ALIGN_SDRAM(
+    static uint8_t frameBuffer[CAMERA_DEV_BUFFER_COUNT][CAMERA_HEIGHT][CAMERA_WIDTH * CAMERA_BYTE_PER_PIXEL],
+    FWK_MEM_CACHE_LINE);
+#else
+#define CAMERA_FRAME_BUFFER_REGION kFWKMemRegion_SdramUncached
 AT_NONCACHEABLE_SECTION_ALIGN(
     static uint8_t frameBuffer[CAMERA_DEV_BUFFER_COUNT][CAMERA_HEIGHT][CAMERA_WIDTH * CAMERA_BYTE_PER_PIXEL], 32);
+#endif /* ENABLE_CACHED_FRAME_BUFFERS */
 
 static uint8_t *s_pCurrentFrameBuffer = NULL;
 
@@ -116,43 +166,135 @@ static camera_device_handle_t cameraDevice[CAMERA_NUM] = {
 },
 };
 
-static uint8_t s_CurrentRunningCamera = CAMERA_NUM;
-static uint8_t s_CurrentFrameValid    = 0;
-static uint8_t s_CurRGBExposureMode   = CAMERA_EXPOSURE_MODE_AUTO_LEVEL0;
+static uint8_t s_CurRGBExposureMode = CAMERA_EXPOSURE_MODE_AUTO_LEVEL0;
+
+static csi_shared_dual_scheduler_t s_Scheduler = {
+    .ratio =
+        {
+            {CAMERA_CSI_SHARED_DUAL_IDLE_RGB_FRAMES, CAMERA_CSI_SHARED_DUAL_IDLE_IR_FRAMES},
+            {CAMERA_CSI_SHARED_DUAL_FACE_RGB_FRAMES, CAMERA_CSI_SHARED_DUAL_FACE_IR_FRAMES},
+        },
+    .current = CAMERA_RGB,
+};
 
 static void _camera_init_interface(void)
 {
 
 }
 
-static void camera_shared_dual_switch(csi_shared_dual_camera_id cameraId)
+static void _camera_switch_task(void *param)
 {
-    if (cameraId == CAMERA_RGB)
+    csi_shared_dual_scheduler_t *pSched = &s_Scheduler;
+
+    while (1)
     {
-        CAMERA_DEVICE_Stop(&cameraDevice[CAMERA_IR]);
-        CAMERA_DEVICE_Start(&cameraDevice[CAMERA_RGB]);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /* the staged writes are not changed until switching is cleared */
+        xSemaphoreTake(pSched->sensorLock, portMAX_DELAY);
+        CAMERA_DEVICE_Stop(pSched->staged.stop);
+        CAMERA_DEVICE_Start(pSched->staged.start);
+        xSemaphoreGive(pSched->sensorLock);
+
+        /* the frame in progress mixes both sensors */
+        taskENTER_CRITICAL();
+        pSched->discardLeft = CAMERA_CSI_SHARED_DUAL_DISCARD_FRAMES;
+        pSched->switching   = 0;
+        taskEXIT_CRITICAL();
     }
-    else if (cameraId == CAMERA_IR)
+}
+
+/* called from the frame done interrupt */
+static void _camera_schedule_next(csi_shared_dual_scheduler_t *pSched, BaseType_t *pHigherPriorityTaskWoken)
+{
+    const uint8_t *ratio = pSched->ratio[pSched->face];
+    uint8_t next         = (pSched->current == CAMERA_RGB) ? CAMERA_IR : CAMERA_RGB;
+
+    if (ratio[next] == 0)
     {
-        CAMERA_DEVICE_Stop(&cameraDevice[CAMERA_RGB]);
-        CAMERA_DEVICE_Start(&cameraDevice[CAMERA_IR]);
+        next = pSched->current;
     }
-    else
+
+    pSched->runLeft = ratio[next];
+    if (next == pSched->current)
     {
-        CAMERA_DEVICE_Stop(&cameraDevice[CAMERA_RGB]);
-        CAMERA_DEVICE_Stop(&cameraDevice[CAMERA_IR]);
+        return;
     }
+
+    pSched->staged.stop  = &cameraDevice[pSched->current];
+    pSched->staged.start = &cameraDevice[next];
+    pSched->current      = next;
+    pSched->switching    = 1;
+    pSched->stats.switches++;
+    vTaskNotifyGiveFromISR(pSched->switchTask, pHigherPriorityTaskWoken);
+}
+
+/* called from the frame done interrupt, returns true if the frame is delivered */
+static bool _camera_frame_done(csi_shared_dual_scheduler_t *pSched,
+                               uint8_t *buffer,
+                               BaseType_t *pHigherPriorityTaskWoken)
+{
+    uint8_t camera = pSched->current;
+    uint32_t now   = FWK_CurrentTimeUs();
+
+    if ((now - pSched->windowStartUs) >= CAMERA_FPS_WINDOW_US)
+    {
+        for (int i = 0; i < CAMERA_NUM; i++)
+        {
+            pSched->stats.fps[i]    = (pSched->windowFrames[i] * 1000000.0f) / (now - pSched->windowStartUs);
+            pSched->windowFrames[i] = 0;
+        }
+        pSched->windowStartUs = now;
+    }
+
+    if (pSched->switching || pSched->discardLeft || (pSched->readyCount == CAMERA_DEV_BUFFER_COUNT))
+    {
+        if (pSched->discardLeft)
+        {
+            pSched->discardLeft--;
+        }
+        pSched->stats.discarded[camera]++;
+        CAMERA_RECEIVER_SubmitEmptyBuffer(&cameraReceiver, (uint32_t)buffer);
+        return false;
+    }
+
+    uint8_t slot                    = (pSched->readyHead + pSched->readyCount) % CAMERA_DEV_BUFFER_COUNT;
+    csi_shared_dual_frame_t *pFrame = &pSched->ready[slot];
+    pFrame->buffer                  = buffer;
+    pFrame->camera                  = (csi_shared_dual_camera_id)camera;
+    pSched->readyCount++;
+    pSched->stats.frames[camera]++;
+    pSched->windowFrames[camera]++;
+
+    if (pSched->runLeft > 0)
+    {
+        pSched->runLeft--;
+    }
+
+    if (pSched->runLeft == 0)
+    {
+        _camera_schedule_next(pSched, pHigherPriorityTaskWoken);
+    }
+
+    return true;
 }
 
 static void camera_receiver_callback(camera_receiver_handle_t *handle, status_t status, void *userData)
 {
-    camera_dev_t *dev = (camera_dev_t *)userData;
+    camera_dev_t *dev                  = (camera_dev_t *)userData;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    uint8_t *buffer                    = NULL;
 
-    if (dev->cap.callback != NULL)
+    while (kStatus_Success == CAMERA_RECEIVER_GetFullBuffer(&cameraReceiver, (uint32_t *)&buffer))
     {
-        uint8_t fromISR = __get_IPSR();
-        dev->cap.callback(dev, kCameraEvent_SendFrame, dev->cap.param, fromISR);
+        if (_camera_frame_done(&s_Scheduler, buffer, &higherPriorityTaskWoken) && (dev->cap.callback != NULL))
+        {
+            uint8_t fromISR = __get_IPSR();
+            dev->cap.callback(dev, kCameraEvent_SendFrame, dev->cap.param, fromISR);
+        }
     }
+
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
 }
 
 static hal_camera_status_t HAL_CameraDev_CsiSharedDualGC0308_Init(camera_dev_t *dev, int width, int height, camera_dev_callback_t callback, void *param)
@@ -167,6 +309,9 @@ static hal_camera_status_t HAL_CameraDev_CsiSharedDualGC0308_Init(camera_dev_t *
     dev->cap.callback  = callback;
     dev->cap.param     = param;
 
+    FWK_Memory_Track(CAMERA_FRAME_BUFFER_REGION, kFWKMemOwner_Camera, frameBuffer, sizeof(frameBuffer),
+                     "csi frame buffers");
+
     // init csi receiver
     memset(&cameraConfig, 0, sizeof(cameraConfig));
     cameraConfig.pixelFormat                = kVIDEO_PixelFormatYUYV;
@@ -181,6 +326,15 @@ static hal_camera_status_t HAL_CameraDev_CsiSharedDualGC0308_Init(camera_dev_t *
 
     _camera_init_interface();
 
+    s_Scheduler.sensorLock = xSemaphoreCreateMutex();
+    if ((s_Scheduler.sensorLock == NULL) ||
+        (xTaskCreate(_camera_switch_task, CAMERA_SWITCH_TASK_NAME, CAMERA_SWITCH_TASK_STACK, NULL,
+                     CAMERA_SWITCH_TASK_PRIORITY, &s_Scheduler.switchTask) != pdPASS))
+    {
+        LOGE("Failed to create the camera switch task");
+        return kStatus_HAL_CameraError;
+    }
+
     NVIC_SetPriority(CSI_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY - 1);
     CAMERA_RECEIVER_Init(&cameraReceiver, &cameraConfig, camera_receiver_callback, dev);
 
@@ -195,8 +349,15 @@ static hal_camera_status_t HAL_CameraDev_CsiSharedDualGC0308_Init(camera_dev_t *
     CAMERA_DEVICE_Control(&cameraDevice[CAMERA_RGB], kCAMERA_DeviceMonoMode, CAMERA_MONO_MODE_DISABLED);
     CAMERA_DEVICE_Start(&cameraDevice[CAMERA_RGB]);
 
-    s_CurrentRunningCamera = CAMERA_RGB;
+    s_Scheduler.current       = CAMERA_RGB;
+    s_Scheduler.runLeft       = s_Scheduler.ratio[0][CAMERA_RGB];
+    s_Scheduler.discardLeft   = CAMERA_CSI_SHARED_DUAL_DISCARD_FRAMES;
+    s_Scheduler.windowStartUs = FWK_CurrentTimeUs();
 
+#if ENABLE_CACHED_FRAME_BUFFERS
+    /* the buffers go to the CSI without the camera manager, drop the lines left by the startup zeroing */
+    FWK_Memory_CleanInvalidateCache(frameBuffer, sizeof(frameBuffer));
+#endif /* ENABLE_CACHED_FRAME_BUFFERS */
     for (int i = 0; i < CAMERA_DEV_BUFFER_COUNT; i++)
     {
         CAMERA_RECEIVER_SubmitEmptyBuffer(&cameraReceiver, (uint32_t)frameBuffer[i]);
@@ -241,31 +402,28 @@ static hal_camera_status_t HAL_CameraDev_CsiSharedDualGC0308_Dequeue(const camer
 {
     LOGI("++HAL_CameraDev_CsiSharedDualGC0308_Dequeue");
 
-    hal_camera_status_t ret = kStatus_HAL_CameraSuccess;
+    hal_camera_status_t ret       = kStatus_HAL_CameraSuccess;
+    csi_shared_dual_frame_t frame = {NULL, CAMERA_NUM};
 
-    while (kStatus_Success != CAMERA_RECEIVER_GetFullBuffer(&cameraReceiver, (uint32_t *)&s_pCurrentFrameBuffer))
+    /* the frames are sorted by the frame done interrupt, only the delivered ones are signaled */
+    taskENTER_CRITICAL();
+    if (s_Scheduler.readyCount > 0)
     {
+        frame                 = s_Scheduler.ready[s_Scheduler.readyHead];
+        s_Scheduler.readyHead = (s_Scheduler.readyHead + 1) % CAMERA_DEV_BUFFER_COUNT;
+        s_Scheduler.readyCount--;
     }
+    taskEXIT_CRITICAL();
 
-    if (s_CurrentRunningCamera == CAMERA_RGB && s_CurrentFrameValid == 1)
-    {
-        *data   = s_pCurrentFrameBuffer;
-        *format = kPixelFormat_UYVY1P422_RGB;
-        camera_shared_dual_switch(CAMERA_IR);
-        s_CurrentFrameValid = 0;
-        s_CurrentRunningCamera = CAMERA_IR;
-    }
-    else if (s_CurrentRunningCamera == CAMERA_IR && s_CurrentFrameValid == 1)
+    s_pCurrentFrameBuffer = frame.buffer;
+    *data                 = frame.buffer;
+    if (frame.buffer == NULL)
     {
-        *data   = s_pCurrentFrameBuffer;
-        *format = kPixelFormat_UYVY1P422_Gray;
-        camera_shared_dual_switch(CAMERA_RGB);
-        s_CurrentFrameValid = 0;
-        s_CurrentRunningCamera = CAMERA_RGB;
+        ret = kStatus_HAL_CameraNonBlocking;
     }
-    else if (s_CurrentFrameValid != 1)
+    else
     {
-        s_CurrentFrameValid = 1;
+        *format = (frame.camera == CAMERA_RGB) ? kPixelFormat_UYVY1P422_RGB : kPixelFormat_UYVY1P422_Gray;
     }
 
     LOGI("--HAL_CameraDev_CsiSharedDualGC0308_Dequeue");
@@ -335,7 +493,11 @@ static hal_camera_status_t HAL_CameraDev_CsiSharedDualGC0308_InputNotify(const c
 		{
 			event_common_t* pevent = (event_common_t *)data;
 			csi_shared_dual_camera_id cur_camera_id = (eventBase.eventId == kEventID_ControlRGBCamExposure)?CAMERA_RGB:CAMERA_IR;
-//			if (cur_camera_id == s_CurrentRunningCamera)
+
+			/* the algorithm adjusts the exposure while it processes a face and resets it when done */
+			s_Scheduler.face = pevent->brightnessControl.enable ? 1 : 0;
+
+			xSemaphoreTake(s_Scheduler.sensorLock, portMAX_DELAY);
 			{
 
 				if (pevent->brightnessControl.enable)
@@ -350,6 +512,7 @@ static hal_camera_status_t HAL_CameraDev_CsiSharedDualGC0308_InputNotify(const c
 					CAMERA_DEVICE_Control(&cameraDevice[cur_camera_id], kCAMERA_DeviceExposureMode, CAMERA_EXPOSURE_MODE_AUTO);
 				}
 			}
+			xSemaphoreGive(s_Scheduler.sensorLock);
 		}
 		break;
         default:
@@ -389,4 +552,30 @@ int HAL_CameraDev_CsiSharedDualGC0308_Register(camera_dev_static_config_t *confi
     error = FWK_CameraManager_DeviceRegister(&s_CameraDev_CsiSharedDualGC0308);
     return error;
 }
+
+int HAL_CameraDev_CsiSharedDualGC0308_SetRatio(bool face, uint8_t rgbFrames, uint8_t irFrames)
+{
+    if ((rgbFrames == 0) && (irFrames == 0))
+    {
+        return -1;
+    }
+
+    /* used from the next switch decision */
+    taskENTER_CRITICAL();
+    s_Scheduler.ratio[face ? 1 : 0][CAMERA_RGB] = rgbFrames;
+    s_Scheduler.ratio[face ? 1 : 0][CAMERA_IR]  = irFrames;
+    taskEXIT_CRITICAL();
+
+    return 0;
+}
+
+void HAL_CameraDev_CsiSharedDualGC0308_GetStats(csi_shared_dual_stats_t *pStats)
+{
+    if (pStats != NULL)
+    {
+        taskENTER_CRITICAL();
+        memcpy(pStats, &s_Scheduler.stats, sizeof(csi_shared_dual_stats_t));
+        taskEXIT_CRITICAL();
+    }
+}
 #endif
@@ -21,6 +21,7 @@
 
 #include "fwk_log.h"
 #include "fwk_display_manager.h"
+#include "fwk_memory.h"
 #include "hal_display_dev.h"
 #include "hal_event_descriptor_common.h"
 #include "./icons/nxp_logo_240x86.h"
@@ -58,9 +59,17 @@ status_t board_elcdif_rk024hh298_spi_send(uint8_t *txBuff, uint8_t txSize);
 }
 #endif /* __cplusplus */
 
+#if ENABLE_CACHED_FRAME_BUFFERS
+#define DISPLAY_FRAME_BUFFER_REGION kFWKMemRegion_SdramCached
+AT_CACHEABLE_SECTION_ALIGN_SDRAM(
+    static uint8_t s_FrameBuffers[DISPLAY_FRAME_BUFFER_COUNT][DISPLAY_HEIGHT][DISPLAY_WIDTH * DISPLAY_BYTES_PER_PIXEL],
+    FWK_MEM_CACHE_LINE);
+#else
+#define DISPLAY_FRAME_BUFFER_REGION kFWKMemRegion_SdramUncached
 AT_NONCACHEABLE_SECTION_ALIGN(
     static uint8_t s_FrameBuffers[DISPLAY_FRAME_BUFFER_COUNT][DISPLAY_HEIGHT][DISPLAY_WIDTH * DISPLAY_BYTES_PER_PIXEL],
     32);
+#endif /* ENABLE_CACHED_FRAME_BUFFERS */
 static uint8_t *s_pCurrentFrameBuffer = NULL;
 static bool s_NewBufferSet            = 0;
 static int8_t s_LCDFramesNum          = 0;
@@ -89,6 +98,10 @@ static void _ELCDIF_Init(void)
 {
     memcpy((void *)&s_FrameBuffers[0] + DISPLAY_WIDTH * ((DISPLAY_HEIGHT - NXP_LOGO_H) / 2) * DISPLAY_BYTES_PER_PIXEL,
            nxp_logo_240x86, sizeof(nxp_logo_240x86));
+#if ENABLE_CACHED_FRAME_BUFFERS
+    /* the LCDIF scans the first buffer out without the display manager */
+    FWK_Memory_CleanCache(s_FrameBuffers, sizeof(s_FrameBuffers));
+#endif /* ENABLE_CACHED_FRAME_BUFFERS */
 
     const elcdif_rgb_mode_config_t config = {
         .panelWidth    = DISPLAY_WIDTH,
@@ -124,6 +137,9 @@ hal_display_status_t HAL_DisplayDev_LcdifRk024hh2_Init(
     dev->cap.frameBuffer = (void *)&s_FrameBuffers[1];
     dev->cap.callback    = callback;
 
+    FWK_Memory_Track(DISPLAY_FRAME_BUFFER_REGION, kFWKMemOwner_Display, s_FrameBuffers, sizeof(s_FrameBuffers),
+                     "lcdif frame buffers");
+
     BOARD_InitElcdifRk024hh298Resource();
 
     board_pull_elcdif_rk024hh298_reset_pin(1);
@@ -15,6 +15,7 @@
 #ifdef ENABLE_DISPLAY_DEV_UsbCdc2D
 #include <FreeRTOS.h>
 #include "event_groups.h"
+#include "timers.h"
 #include "usb_device_config.h"
 #include "usb.h"
 #include "usb_device.h"
@@ -29,6 +30,7 @@
 
 #include "composite.h"
 #include "virtual_com.h"
+#include "hal_display_usb_cdc_stream.h"
 /*******************************************************************************
  * Definitions
  ******************************************************************************/
@@ -61,6 +63,28 @@
 
 #define MAX_SEND_SIZE (32768U)
 
+/* Send the tiles changed since the previous frame, compressed, and request the next frame once the host acknowledged
+ * enough of them (scripts/cdc_stream_viewer.py). Raw frames are sent until the host acknowledges one, so a host which
+ * doesn't acknowledge keeps reading raw frames. 0 only sends the raw frames */
+#ifndef DISPLAY_USB_CDC_STREAM
+#define DISPLAY_USB_CDC_STREAM 1
+#endif /* DISPLAY_USB_CDC_STREAM */
+
+/* Frames sent and not acknowledged yet */
+#ifndef DISPLAY_USB_CDC_STREAM_WINDOW
+#define DISPLAY_USB_CDC_STREAM_WINDOW 2
+#endif /* DISPLAY_USB_CDC_STREAM_WINDOW */
+
+/* The acknowledgements of a full window are taken for lost this long after the last frame was sent. The window opens
+ * again and the next frames are key frames */
+#ifndef DISPLAY_USB_CDC_STREAM_ACK_TIMEOUT_MS
+#define DISPLAY_USB_CDC_STREAM_ACK_TIMEOUT_MS 500
+#endif /* DISPLAY_USB_CDC_STREAM_ACK_TIMEOUT_MS */
+
+#define DISPLAY_RAW_HEADER_SIZE 14
+
+#define DISPLAY_STREAM_MAX_DEV 2
+
 /* Line coding of cdc device */
 USB_DMA_INIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE)
 static uint8_t s_lineCoding[LINE_CODING_SIZE] = {
@@ -90,7 +114,9 @@ static usb_cdc_acm_info_t s_usbCdcAcmInfo = {
 };
 /* Data buffer for receiving and sending*/
 USB_DMA_NONINIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) static uint8_t s_currRecvBuf[DATA_BUFF_SIZE];
-USB_DMA_NONINIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) static uint8_t s_htUnit[14];
+#if !DISPLAY_USB_CDC_STREAM
+USB_DMA_NONINIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) static uint8_t s_htUnit[DISPLAY_RAW_HEADER_SIZE];
+#endif /* DISPLAY_USB_CDC_STREAM */
 
 //extern usb_device_endpoint_struct_t g_cdcVcomDicEndpoints[];
 //extern usb_device_endpoint_struct_t g_cdcVcomCicEndpoints[];
@@ -127,6 +153,188 @@ AT_NONCACHEABLE_SECTION_ALIGN(
 static volatile bool s_HasFinished = true;
 static display_dev_t *s_pDisplayDevUSBCDC;
 
+#if DISPLAY_USB_CDC_STREAM
+typedef struct _display_usb_cdc_stream
+{
+    cdc_stream_encoder_t encoders[DISPLAY_STREAM_MAX_DEV];
+    uint32_t sequence;          /* of the next frame */
+    volatile uint32_t acked;    /* frames before this one are acknowledged by the host */
+    volatile bool hostAcks;     /* the host acknowledged a frame since it opened the port, else raw frames are sent */
+    volatile bool sending;      /* s_StreamBuffer is on its way */
+    int8_t sendingId;           /* device of the stream frame on its way, -1 for a raw frame */
+    uint8_t *pSend;             /* rest of s_StreamBuffer to send */
+    volatile uint32_t sendLeft;
+    volatile uint8_t pending;   /* devices waiting for their next frame request, bit per id */
+    TimerHandle_t ackTimer;
+} display_usb_cdc_stream_t;
+
+static display_usb_cdc_stream_t s_CdcStream;
+
+static cdc_stream_tile_t s_StreamTiles[DISPLAY_STREAM_MAX_DEV]
+                                      [CDC_STREAM_TILES(DISPLAY_MAX_FRAME_WIDTH, DISPLAY_MAX_FRAME_HEIGHT)];
+
+AT_NONCACHEABLE_SECTION_ALIGN(static uint8_t s_StreamBuffer[CDC_STREAM_MAX_SIZE(DISPLAY_MAX_FRAME_WIDTH,
+                                                                                DISPLAY_MAX_FRAME_HEIGHT,
+                                                                                DISPLAY_MAX_FRAME_BYTES_PER_PIXEL)],
+                              64);
+
+/* Request the next frame of the devices waiting for one, once the previous frame is sent and the host keeps up */
+static void HAL_DisplayDev_UsbCdc_StreamKick(uint8_t fromISR)
+{
+    uint8_t pending = 0;
+
+    /* the usb interrupt kicks too, a device must be requested by one of them only */
+    if (!fromISR)
+    {
+        taskENTER_CRITICAL();
+    }
+    if (!s_CdcStream.sending && (s_UsbDeviceCDC.startTransactions != 0) &&
+        (!s_CdcStream.hostAcks || (s_CdcStream.sequence - s_CdcStream.acked < DISPLAY_USB_CDC_STREAM_WINDOW)))
+    {
+        pending             = s_CdcStream.pending;
+        s_CdcStream.pending = 0;
+    }
+    if (!fromISR)
+    {
+        taskEXIT_CRITICAL();
+    }
+
+    for (int i = 0; i < s_DisplayDevCount; i++)
+    {
+        if ((pending & (1U << i)) && (s_pDisplayDevUSBCDC != NULL) && (s_pDisplayDevUSBCDC[i].cap.callback != NULL))
+        {
+            s_pDisplayDevUSBCDC[i].cap.callback(&s_pDisplayDevUSBCDC[i], kDisplayEvent_RequestFrame,
+                                                s_pDisplayDevUSBCDC[i].cap.frameBuffer, fromISR);
+        }
+    }
+}
+
+static usb_status_t HAL_DisplayDev_UsbCdc_StreamSendNext(void)
+{
+    uint32_t size      = MIN(s_CdcStream.sendLeft, MAX_SEND_SIZE);
+    usb_status_t error = USB_DeviceCdcAcmSend(s_UsbDeviceCDC.cdcAcmHandle, s_UsbDeviceCDC.bulkInEndpoint,
+                                              s_CdcStream.pSend, size);
+
+    if (error == kStatus_USB_Success)
+    {
+        s_CdcStream.pSend += size;
+        s_CdcStream.sendLeft -= size;
+    }
+
+    return error;
+}
+
+/* A chunk of the frame is sent, called from the usb interrupt */
+static void HAL_DisplayDev_UsbCdc_StreamSent(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (s_CdcStream.sendLeft != 0)
+    {
+        if (HAL_DisplayDev_UsbCdc_StreamSendNext() == kStatus_USB_Success)
+        {
+            return;
+        }
+
+        /* the host drops a frame cut short, so its sequence is used again. Its encoder counts the tiles as sent and
+         * starts over from a key frame */
+        if (s_CdcStream.sendingId >= 0)
+        {
+            s_CdcStream.sequence--;
+            s_CdcStream.encoders[s_CdcStream.sendingId].keyRequested = true;
+        }
+        s_CdcStream.sendLeft = 0;
+    }
+
+    s_CdcStream.sending = false;
+    if (s_CdcStream.ackTimer != NULL)
+    {
+        xTimerResetFromISR(s_CdcStream.ackTimer, &woken);
+    }
+    HAL_DisplayDev_UsbCdc_StreamKick(true);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* No acknowledgement came for a full window, called from the timer task */
+static void HAL_DisplayDev_UsbCdc_StreamAckTimeout(TimerHandle_t timer)
+{
+    bool expired = false;
+
+    taskENTER_CRITICAL();
+    if (!s_CdcStream.sending && s_CdcStream.hostAcks &&
+        (s_CdcStream.sequence - s_CdcStream.acked >= DISPLAY_USB_CDC_STREAM_WINDOW))
+    {
+        /* the host may have missed any of them */
+        s_CdcStream.acked = s_CdcStream.sequence;
+        for (int i = 0; i < DISPLAY_STREAM_MAX_DEV; i++)
+        {
+            s_CdcStream.encoders[i].keyRequested = true;
+        }
+        expired = true;
+    }
+    taskEXIT_CRITICAL();
+
+    if (expired)
+    {
+        LOGD("USB cdc stream acknowledgements timed out, sending a key frame");
+        HAL_DisplayDev_UsbCdc_StreamKick(false);
+    }
+}
+
+/* Acknowledgements of the host, called from the usb interrupt */
+static void HAL_DisplayDev_UsbCdc_StreamReceived(const uint8_t *pData, uint32_t size)
+{
+    uint32_t sequence;
+    uint8_t flags;
+
+    for (; size >= CDC_STREAM_ACK_SIZE; pData += CDC_STREAM_ACK_SIZE, size -= CDC_STREAM_ACK_SIZE)
+    {
+        if (HAL_CdcStream_ParseAck(pData, size, &sequence, &flags) != 0)
+        {
+            break;
+        }
+
+        if (!s_CdcStream.hostAcks)
+        {
+            /* the host decodes the stream, it starts from a key frame. The raw frames have no sequence */
+            s_CdcStream.hostAcks = true;
+            s_CdcStream.acked    = s_CdcStream.sequence;
+            flags |= CDC_STREAM_ACK_KEY_FRAME;
+        }
+        /* frames are acknowledged in order, ignore an acknowledgement older than the last one */
+        else if ((sequence + 1 - s_CdcStream.acked != 0) &&
+                 (sequence + 1 - s_CdcStream.acked <= s_CdcStream.sequence - s_CdcStream.acked))
+        {
+            s_CdcStream.acked = sequence + 1;
+        }
+
+        if (flags & CDC_STREAM_ACK_KEY_FRAME)
+        {
+            for (int i = 0; i < DISPLAY_STREAM_MAX_DEV; i++)
+            {
+                s_CdcStream.encoders[i].keyRequested = true;
+            }
+        }
+    }
+
+    HAL_DisplayDev_UsbCdc_StreamKick(true);
+}
+
+/* The host opened or closed the port, it gets raw frames until it acknowledges one */
+static void HAL_DisplayDev_UsbCdc_StreamReset(void)
+{
+    s_CdcStream.acked    = s_CdcStream.sequence;
+    s_CdcStream.hostAcks = false;
+    s_CdcStream.sending  = false;
+    s_CdcStream.sendLeft = 0;
+    s_CdcStream.pending  = 0;
+    for (int i = 0; i < DISPLAY_STREAM_MAX_DEV; i++)
+    {
+        s_CdcStream.encoders[i].keyRequested = true;
+    }
+}
+#endif /* DISPLAY_USB_CDC_STREAM */
+
 static usb_status_t USB_DeviceCdcVcomCallback(class_handle_t handle, uint32_t event, void *param)
 {
     uint32_t len;
@@ -160,7 +368,11 @@ static usb_status_t USB_DeviceCdcVcomCallback(class_handle_t handle, uint32_t ev
             {
                 if ((epCbParam->buffer != NULL) || ((epCbParam->buffer == NULL) && (epCbParam->length == 0)))
                 {
+#if DISPLAY_USB_CDC_STREAM
+                    HAL_DisplayDev_UsbCdc_StreamSent();
+#else
                     s_HasFinished = true;
+#endif /* DISPLAY_USB_CDC_STREAM */
                 }
             }
             else
@@ -174,12 +386,23 @@ static usb_status_t USB_DeviceCdcVcomCallback(class_handle_t handle, uint32_t ev
             {
                 s_UsbDeviceCDC.recvSize = epCbParam->length;
 
+#if DISPLAY_USB_CDC_STREAM
+                if ((s_UsbDeviceCDC.recvSize != 0) && (s_UsbDeviceCDC.recvSize != USB_UNINITIALIZED_VAL_32))
+                {
+                    HAL_DisplayDev_UsbCdc_StreamReceived(s_UsbDeviceCDC.currRecvBuf, s_UsbDeviceCDC.recvSize);
+                }
+
+                /* Schedule buffer for next receive event */
+                error = USB_DeviceCdcAcmRecv(handle, s_UsbDeviceCDC.bulkOutEndpoint, s_UsbDeviceCDC.currRecvBuf,
+                                             s_UsbDeviceCDC.bulkOutEndpointMaxPacketSize);
+#else
                 if (!s_UsbDeviceCDC.recvSize)
                 {
                     /* Schedule buffer for next receive event */
                     error = USB_DeviceCdcAcmRecv(handle, s_UsbDeviceCDC.bulkOutEndpoint, s_UsbDeviceCDC.currRecvBuf,
                                                  s_UsbDeviceCDC.bulkOutEndpointMaxPacketSize);
                 }
+#endif /* DISPLAY_USB_CDC_STREAM */
             }
         }
         break;
@@ -322,6 +545,9 @@ static usb_status_t USB_DeviceCdcVcomCallback(class_handle_t handle, uint32_t ev
                 /* DTE_ACTIVATED */
                 if (1 == s_UsbDeviceCDC.attach)
                 {
+#if DISPLAY_USB_CDC_STREAM
+                    HAL_DisplayDev_UsbCdc_StreamReset();
+#endif /* DISPLAY_USB_CDC_STREAM */
                     s_UsbDeviceCDC.startTransactions = 1;
                     for (int i = 0; i < s_DisplayDevCount; i++)
                     {
@@ -340,6 +566,9 @@ static usb_status_t USB_DeviceCdcVcomCallback(class_handle_t handle, uint32_t ev
                 {
                     s_HasFinished                    = true;
                     s_UsbDeviceCDC.startTransactions = 0;
+#if DISPLAY_USB_CDC_STREAM
+                    HAL_DisplayDev_UsbCdc_StreamReset();
+#endif /* DISPLAY_USB_CDC_STREAM */
                 }
             }
         }
@@ -611,6 +840,7 @@ static const uint8_t TU_MAGIC[] = {0x53, 0x79, 0x4c};
  * Code
  ******************************************************************************/
 
+#if !DISPLAY_USB_CDC_STREAM
 static usb_status_t HAL_DisplayDev_UsbCdc_SendBlocking(void *data, uint32_t size)
 {
     usb_status_t error = kStatus_USB_Error;
@@ -632,6 +862,7 @@ static usb_status_t HAL_DisplayDev_UsbCdc_SendBlocking(void *data, uint32_t size
 
     return error;
 }
+#endif /* DISPLAY_USB_CDC_STREAM */
 
 static hal_display_status_t HAL_DisplayDev_UsbCdc_Init(
     display_dev_t *dev, int width, int height, display_dev_callback_t callback, void *param)
@@ -649,6 +880,32 @@ static hal_display_status_t HAL_DisplayDev_UsbCdc_Init(
         ret = kStatus_HAL_DisplayError;
     }
 
+#if DISPLAY_USB_CDC_STREAM
+    int bytesPerPixel = dev->cap.pitch / dev->cap.width;
+
+    if ((dev->id >= DISPLAY_STREAM_MAX_DEV) ||
+        (CDC_STREAM_TILES(width, height) > ARRAY_SIZE(s_StreamTiles[0])) ||
+        (CDC_STREAM_MAX_SIZE(width, height, bytesPerPixel) > sizeof(s_StreamBuffer)) ||
+        (HAL_CdcStream_EncoderInit(&s_CdcStream.encoders[dev->id], dev->cap.format, dev->cap.srcFormat, width, height,
+                                   dev->cap.pitch, bytesPerPixel, s_StreamTiles[dev->id]) != 0) ||
+        (DISPLAY_RAW_HEADER_SIZE + height * dev->cap.pitch > sizeof(s_StreamBuffer)))
+    {
+        LOGE("USB cdc display %d can't be streamed", dev->id);
+        ret = kStatus_HAL_DisplayError;
+    }
+
+    if (s_CdcStream.ackTimer == NULL)
+    {
+        s_CdcStream.ackTimer = xTimerCreate("CdcStreamAck", pdMS_TO_TICKS(DISPLAY_USB_CDC_STREAM_ACK_TIMEOUT_MS),
+                                            pdFALSE, NULL, HAL_DisplayDev_UsbCdc_StreamAckTimeout);
+        if (s_CdcStream.ackTimer == NULL)
+        {
+            LOGE("USB cdc display stream timer can't be created");
+            ret = kStatus_HAL_DisplayError;
+        }
+    }
+#endif /* DISPLAY_USB_CDC_STREAM */
+
     return ret;
 }
 
@@ -670,8 +927,113 @@ static hal_display_status_t HAL_DisplayDev_UsbCdc_Start(const display_dev_t *dev
     return ret;
 }
 
+#if DISPLAY_USB_CDC_STREAM
+/* A host which doesn't acknowledge reads the raw frames, the header then the pixels */
+static uint32_t HAL_DisplayDev_UsbCdc_StreamRawFrame(const display_dev_t *dev, const uint8_t *frame)
+{
+    uint32_t size = dev->cap.height * dev->cap.pitch;
+
+    memcpy(s_StreamBuffer, TU_MAGIC, sizeof(TU_MAGIC));
+    s_StreamBuffer[3] = dev->cap.format;
+    s_StreamBuffer[4] = dev->cap.srcFormat;
+    s_StreamBuffer[5] = 0;
+    memcpy(s_StreamBuffer + 6, &dev->cap.width, 4);
+    memcpy(s_StreamBuffer + 10, &dev->cap.height, 4);
+    memcpy(s_StreamBuffer + DISPLAY_RAW_HEADER_SIZE, frame, size);
+
+    return DISPLAY_RAW_HEADER_SIZE + size;
+}
+
+/* Encode the frame and start sending it, the rest goes out from the usb interrupt. The next frame of the device is
+ * requested once this one is sent and fewer than DISPLAY_USB_CDC_STREAM_WINDOW frames wait for an acknowledgement */
+static hal_display_status_t HAL_DisplayDev_UsbCdc_StreamBlit(const display_dev_t *dev, void *frame)
+{
+    usb_status_t error = kStatus_USB_Error;
+    uint32_t size;
+    bool stream;
+    bool ready;
+    bool key = false;
+
+    taskENTER_CRITICAL();
+    stream = s_CdcStream.hostAcks;
+    ready  = !s_CdcStream.sending &&
+            (!stream || (s_CdcStream.sequence - s_CdcStream.acked < DISPLAY_USB_CDC_STREAM_WINDOW));
+    s_CdcStream.pending |= 1U << dev->id;
+    if (ready)
+    {
+        s_CdcStream.sending = true;
+    }
+    taskEXIT_CRITICAL();
+
+    if (!ready)
+    {
+        /* the frame is dropped, the link or the host is behind */
+        return kStatus_HAL_DisplayNonBlocking;
+    }
+
+    if (stream)
+    {
+        size = HAL_CdcStream_Encode(&s_CdcStream.encoders[dev->id], frame, s_CdcStream.sequence, s_StreamBuffer,
+                                    sizeof(s_StreamBuffer), &key);
+    }
+    else
+    {
+        size = HAL_DisplayDev_UsbCdc_StreamRawFrame(dev, frame);
+    }
+
+    taskENTER_CRITICAL();
+    if (key)
+    {
+        /* the host asks again if the key frame doesn't get through */
+        s_CdcStream.encoders[dev->id].keyRequested = false;
+    }
+    if (size != 0)
+    {
+        s_CdcStream.sendingId = stream ? dev->id : -1;
+        s_CdcStream.pSend     = s_StreamBuffer;
+        s_CdcStream.sendLeft  = size;
+        error                 = HAL_DisplayDev_UsbCdc_StreamSendNext();
+    }
+    if (error == kStatus_USB_Success)
+    {
+        if (stream)
+        {
+            s_CdcStream.sequence++;
+        }
+    }
+    else
+    {
+        s_CdcStream.sendLeft = 0;
+        s_CdcStream.sending  = false;
+        if (stream && (size != 0))
+        {
+            /* the encoder counts the tiles of the frame as sent */
+            s_CdcStream.encoders[dev->id].keyRequested = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if (error != kStatus_USB_Success)
+    {
+        LOGE("Failed to stream display %d, size %u error %d", dev->id, size, error);
+        HAL_DisplayDev_UsbCdc_StreamKick(false);
+    }
+
+    return kStatus_HAL_DisplayNonBlocking;
+}
+#endif /* DISPLAY_USB_CDC_STREAM */
+
 static hal_display_status_t HAL_DisplayDev_UsbCdc_Blit(const display_dev_t *dev, void *frame, int width, int height)
 {
+#if DISPLAY_USB_CDC_STREAM
+    LOGD("+++HAL_DisplayDev_UsbCdc_Blit dev name %s.", dev->name);
+    if (s_UsbDeviceCDC.startTransactions == 0)
+    {
+        return kStatus_HAL_DisplayTxBusy;
+    }
+
+    return HAL_DisplayDev_UsbCdc_StreamBlit(dev, frame);
+#else
     hal_display_status_t ret = kStatus_HAL_DisplaySuccess;
     usb_status_t error       = kStatus_USB_Error;
     uint32_t size            = (dev->cap.height * dev->cap.pitch);
@@ -689,7 +1051,7 @@ static hal_display_status_t HAL_DisplayDev_UsbCdc_Blit(const display_dev_t *dev,
     memcpy(s_htUnit + 6, &dev->cap.width, 4);
     memcpy(s_htUnit + 10, &dev->cap.height, 4);
 
-    error = HAL_DisplayDev_UsbCdc_SendBlocking(s_htUnit, 14);
+    error = HAL_DisplayDev_UsbCdc_SendBlocking(s_htUnit, DISPLAY_RAW_HEADER_SIZE);
     if (error != kStatus_USB_Success)
     {
         LOGE("Failed to send header usbcdc %d", dev->id);
@@ -718,6 +1080,7 @@ static hal_display_status_t HAL_DisplayDev_UsbCdc_Blit(const display_dev_t *dev,
     }
     LOGD("----HAL_DisplayDev_UsbCdc_Blit.");
     return ret;
+#endif /* DISPLAY_USB_CDC_STREAM */
 }
 
 int HAL_DisplayDev_UsbCdc3D_Register()
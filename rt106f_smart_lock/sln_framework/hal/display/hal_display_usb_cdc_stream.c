@@ -0,0 +1,580 @@
+/*
+ * Copyright 2022 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/*
+ * @brief frame stream of the display over usb cdc implementation.
+ */
+
+#include <string.h>
+
+#include "hal_display_usb_cdc_stream.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+/* LZ4 block format: a match is 4 bytes at least, the last 5 bytes are literals and the last match starts 12 bytes
+ * before the end at the latest */
+#define CDC_STREAM_LZ_MIN_MATCH     4
+#define CDC_STREAM_LZ_LAST_LITERALS 5
+#define CDC_STREAM_LZ_MATCH_LIMIT   12
+#define CDC_STREAM_LZ_MAX_OFFSET    65535
+
+#define CDC_STREAM_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+#define CDC_STREAM_FNV_OFFSET 2166136261U
+#define CDC_STREAM_FNV_PRIME  16777619U
+
+static const uint8_t s_CdcStreamMagic[] = {0x53, 0x79, 0x4c};
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+static void _CdcStream_Put16(uint8_t *p, uint16_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void _CdcStream_Put32(uint8_t *p, uint32_t value)
+{
+    _CdcStream_Put16(p, value & 0xFFFF);
+    _CdcStream_Put16(p + 2, value >> 16);
+}
+
+static uint16_t _CdcStream_Get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t _CdcStream_Get32(const uint8_t *p)
+{
+    return _CdcStream_Get16(p) | ((uint32_t)_CdcStream_Get16(p + 2) << 16);
+}
+
+static uint32_t _CdcStream_Read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint8_t *_CdcStream_PutLength(uint8_t *pOut, uint32_t length)
+{
+    while (length >= 255)
+    {
+        *pOut++ = 255;
+        length -= 255;
+    }
+    *pOut++ = length;
+
+    return pOut;
+}
+
+/* Worst case size of a sequence of literals and a match, the offset included */
+static uint32_t _CdcStream_SequenceSize(uint32_t literals, uint32_t matchLength)
+{
+    return 1 + (literals / 255 + 1) + literals + 2 + (matchLength / 255 + 1);
+}
+
+uint32_t HAL_CdcStream_Compress(const uint8_t *pSrc, uint32_t size, uint8_t *pDst, uint32_t dstSize, uint16_t *pHash)
+{
+    const uint8_t *pIn     = pSrc;
+    const uint8_t *pAnchor = pSrc;
+    const uint8_t *pEnd    = pSrc + size;
+    uint8_t *pOut          = pDst;
+    uint8_t *pOutEnd       = pDst + dstSize;
+    uint32_t literals;
+    uint8_t *pToken;
+
+    memset(pHash, 0, sizeof(uint16_t) << CDC_STREAM_HASH_BITS);
+
+    if (size > CDC_STREAM_LZ_MATCH_LIMIT)
+    {
+        const uint8_t *pSearchEnd = pEnd - CDC_STREAM_LZ_MATCH_LIMIT;
+        const uint8_t *pMatchEnd  = pEnd - CDC_STREAM_LZ_LAST_LITERALS;
+
+        while (pIn < pSearchEnd)
+        {
+            uint32_t sequence = _CdcStream_Read32(pIn);
+            uint32_t hash     = (sequence * 2654435761U) >> (32 - CDC_STREAM_HASH_BITS);
+            const uint8_t *pRef = pSrc + pHash[hash];
+            const uint8_t *pScan;
+            uint32_t matchLength;
+
+            pHash[hash] = pIn - pSrc;
+            if ((pRef >= pIn) || (pIn - pRef > CDC_STREAM_LZ_MAX_OFFSET) || (_CdcStream_Read32(pRef) != sequence))
+            {
+                pIn++;
+                continue;
+            }
+
+            pScan = pIn + CDC_STREAM_LZ_MIN_MATCH;
+            while ((pScan < pMatchEnd) && (*pScan == pRef[pScan - pIn]))
+            {
+                pScan++;
+            }
+
+            literals    = pIn - pAnchor;
+            matchLength = (pScan - pIn) - CDC_STREAM_LZ_MIN_MATCH;
+            if (pOut + _CdcStream_SequenceSize(literals, matchLength) > pOutEnd)
+            {
+                return 0;
+            }
+
+            pToken = pOut++;
+            *pToken = CDC_STREAM_MIN(literals, 15) << 4;
+            if (literals >= 15)
+            {
+                pOut = _CdcStream_PutLength(pOut, literals - 15);
+            }
+            memcpy(pOut, pAnchor, literals);
+            pOut += literals;
+
+            _CdcStream_Put16(pOut, pIn - pRef);
+            pOut += 2;
+
+            *pToken |= CDC_STREAM_MIN(matchLength, 15);
+            if (matchLength >= 15)
+            {
+                pOut = _CdcStream_PutLength(pOut, matchLength - 15);
+            }
+
+            pIn = pAnchor = pScan;
+        }
+    }
+
+    /* the last sequence has literals only */
+    literals = pEnd - pAnchor;
+    if (pOut + 1 + (literals / 255 + 1) + literals > pOutEnd)
+    {
+        return 0;
+    }
+
+    pToken  = pOut++;
+    *pToken = CDC_STREAM_MIN(literals, 15) << 4;
+    if (literals >= 15)
+    {
+        pOut = _CdcStream_PutLength(pOut, literals - 15);
+    }
+    memcpy(pOut, pAnchor, literals);
+    pOut += literals;
+
+    return pOut - pDst;
+}
+
+static int _CdcStream_GetLength(const uint8_t **ppIn, const uint8_t *pEnd, uint32_t *pLength)
+{
+    uint8_t byte;
+
+    do
+    {
+        if (*ppIn >= pEnd)
+        {
+            return -1;
+        }
+        byte = *(*ppIn)++;
+        *pLength += byte;
+    } while (byte == 255);
+
+    return 0;
+}
+
+int32_t HAL_CdcStream_Decompress(const uint8_t *pSrc, uint32_t size, uint8_t *pDst, uint32_t dstSize)
+{
+    const uint8_t *pIn  = pSrc;
+    const uint8_t *pEnd = pSrc + size;
+    uint8_t *pOut       = pDst;
+    uint8_t *pOutEnd    = pDst + dstSize;
+
+    while (pIn < pEnd)
+    {
+        uint8_t token   = *pIn++;
+        uint32_t length = token >> 4;
+        uint32_t offset;
+        const uint8_t *pMatch;
+
+        if ((length == 15) && (_CdcStream_GetLength(&pIn, pEnd, &length) != 0))
+        {
+            return -1;
+        }
+        if ((length > (uint32_t)(pEnd - pIn)) || (length > (uint32_t)(pOutEnd - pOut)))
+        {
+            return -1;
+        }
+        memcpy(pOut, pIn, length);
+        pIn += length;
+        pOut += length;
+
+        if (pIn == pEnd)
+        {
+            break;
+        }
+
+        if (pEnd - pIn < 2)
+        {
+            return -1;
+        }
+        offset = _CdcStream_Get16(pIn);
+        pIn += 2;
+        if ((offset == 0) || (offset > (uint32_t)(pOut - pDst)))
+        {
+            return -1;
+        }
+
+        length = token & 15;
+        if ((length == 15) && (_CdcStream_GetLength(&pIn, pEnd, &length) != 0))
+        {
+            return -1;
+        }
+        length += CDC_STREAM_LZ_MIN_MATCH;
+        if (length > (uint32_t)(pOutEnd - pOut))
+        {
+            return -1;
+        }
+
+        /* the match may overlap the bytes it writes */
+        pMatch = pOut - offset;
+        while (length--)
+        {
+            *pOut++ = *pMatch++;
+        }
+    }
+
+    return pOut - pDst;
+}
+
+int HAL_CdcStream_EncoderInit(cdc_stream_encoder_t *pEncoder,
+                              uint8_t format,
+                              uint8_t srcFormat,
+                              int width,
+                              int height,
+                              int pitch,
+                              int bytesPerPixel,
+                              cdc_stream_tile_t *pTiles)
+{
+    if ((pEncoder == NULL) || (pTiles == NULL) || (width <= 0) || (height <= 0) || (bytesPerPixel <= 0) ||
+        (bytesPerPixel > CDC_STREAM_MAX_BPP) || (pitch < width * bytesPerPixel) || (CDC_STREAM_TILE > 16))
+    {
+        return -1;
+    }
+
+    memset(pEncoder, 0, sizeof(*pEncoder));
+    pEncoder->format        = format;
+    pEncoder->srcFormat     = srcFormat;
+    pEncoder->width         = width;
+    pEncoder->height        = height;
+    pEncoder->pitch         = pitch;
+    pEncoder->bytesPerPixel = bytesPerPixel;
+    pEncoder->tilesX        = (width + CDC_STREAM_TILE - 1) / CDC_STREAM_TILE;
+    pEncoder->tilesY        = (height + CDC_STREAM_TILE - 1) / CDC_STREAM_TILE;
+    pEncoder->pTiles        = pTiles;
+    pEncoder->keyRequested  = true;
+
+    return 0;
+}
+
+/* Copy a tile out of the frame, hash it and sum the bytes of its quarters. Return true if it differs from the tile
+ * last sent and either one of the sums moved by more than the threshold or the tile is the same as in the previous
+ * frame */
+static bool _CdcStream_TileChanged(cdc_stream_encoder_t *pEncoder,
+                                   const uint8_t *pFrame,
+                                   int tileX,
+                                   int tileY,
+                                   int tileWidth,
+                                   int tileHeight,
+                                   bool key)
+{
+    const int half        = CDC_STREAM_TILE / 2;
+    const int rowBytes    = tileWidth * pEncoder->bytesPerPixel;
+    const int leftBytes   = CDC_STREAM_MIN(tileWidth, half) * pEncoder->bytesPerPixel;
+    uint32_t sums[CDC_STREAM_TILE_PARTS] = {0};
+    uint32_t bytes[CDC_STREAM_TILE_PARTS];
+    cdc_stream_tile_t *pState = &pEncoder->pTiles[tileY * pEncoder->tilesX + tileX];
+    const uint8_t *pSrc       = pFrame + (tileY * CDC_STREAM_TILE) * pEncoder->pitch +
+                          (tileX * CDC_STREAM_TILE) * pEncoder->bytesPerPixel;
+    uint8_t *pTile = pEncoder->tile;
+    uint32_t hash  = CDC_STREAM_FNV_OFFSET;
+    bool changed   = (CDC_STREAM_THRESHOLD == 0);
+    bool settled;
+
+    for (int y = 0; y < tileHeight; y++)
+    {
+        uint32_t *pSums = &sums[(y < half) ? 0 : 2];
+
+        memcpy(pTile, pSrc, rowBytes);
+        for (int x = 0; x < rowBytes; x++)
+        {
+            hash = (hash ^ pTile[x]) * CDC_STREAM_FNV_PRIME;
+            pSums[(x < leftBytes) ? 0 : 1] += pTile[x];
+        }
+
+        pTile += rowBytes;
+        pSrc += pEncoder->pitch;
+    }
+
+    bytes[0] = bytes[1] = CDC_STREAM_MIN(tileHeight, half);
+    bytes[2] = bytes[3] = tileHeight - bytes[0];
+    bytes[0] *= leftBytes;
+    bytes[2] *= leftBytes;
+    bytes[1] *= rowBytes - leftBytes;
+    bytes[3] *= rowBytes - leftBytes;
+
+    for (int part = 0; part < CDC_STREAM_TILE_PARTS; part++)
+    {
+        uint32_t diff = (sums[part] > pState->sums[part]) ? (sums[part] - pState->sums[part])
+                                                          : (pState->sums[part] - sums[part]);
+        if (diff > CDC_STREAM_THRESHOLD * bytes[part])
+        {
+            changed = true;
+        }
+    }
+
+    /* a change below the threshold is sent once the tile holds still, the noise doesn't */
+    settled          = (hash == pState->lastHash);
+    pState->lastHash = hash;
+    changed          = (hash != pState->sentHash) && (changed || settled);
+
+    /* the host keeps the tile as last sent, so the hash and the sums too */
+    if (changed || key)
+    {
+        pState->sentHash = hash;
+        for (int part = 0; part < CDC_STREAM_TILE_PARTS; part++)
+        {
+            pState->sums[part] = sums[part];
+        }
+    }
+
+    return changed;
+}
+
+uint32_t HAL_CdcStream_Encode(cdc_stream_encoder_t *pEncoder,
+                              const uint8_t *pFrame,
+                              uint32_t sequence,
+                              uint8_t *pOut,
+                              uint32_t outSize,
+                              bool *pKey)
+{
+    const int tiles = pEncoder->tilesX * pEncoder->tilesY;
+    uint32_t mapSize = (tiles + 7) / 8;
+    uint8_t *pMap    = pOut + CDC_STREAM_HEADER_SIZE;
+    uint8_t *pData   = pMap + mapSize;
+    uint8_t *pEnd    = pOut + outSize;
+    bool key;
+
+    if ((CDC_STREAM_KEY_INTERVAL != 0) && (pEncoder->sinceKey + 1 >= CDC_STREAM_KEY_INTERVAL))
+    {
+        pEncoder->keyRequested = true;
+    }
+    /* latched once, a request coming during the encoding is served by the next frame */
+    key   = pEncoder->keyRequested;
+    *pKey = false;
+
+    if (pData > pEnd)
+    {
+        pEncoder->keyRequested = true;
+        return 0;
+    }
+    memset(pMap, 0, mapSize);
+
+    for (int tileY = 0; tileY < pEncoder->tilesY; tileY++)
+    {
+        int tileHeight = CDC_STREAM_MIN(CDC_STREAM_TILE, pEncoder->height - tileY * CDC_STREAM_TILE);
+
+        for (int tileX = 0; tileX < pEncoder->tilesX; tileX++)
+        {
+            int tileWidth     = CDC_STREAM_MIN(CDC_STREAM_TILE, pEncoder->width - tileX * CDC_STREAM_TILE);
+            uint32_t tileSize = tileWidth * tileHeight * pEncoder->bytesPerPixel;
+            int tile          = tileY * pEncoder->tilesX + tileX;
+            uint32_t size;
+
+            if (!_CdcStream_TileChanged(pEncoder, pFrame, tileX, tileY, tileWidth, tileHeight, key) && !key)
+            {
+                continue;
+            }
+
+            if (pData + 2 + tileSize > pEnd)
+            {
+                /* the host now has tiles older than their hashes, start over */
+                pEncoder->keyRequested = true;
+                return 0;
+            }
+
+            pMap[tile / 8] |= 1U << (tile % 8);
+            size = HAL_CdcStream_Compress(pEncoder->tile, tileSize, pData + 2, tileSize - 1, pEncoder->hash);
+            if (size == 0)
+            {
+                memcpy(pData + 2, pEncoder->tile, tileSize);
+                _CdcStream_Put16(pData, CDC_STREAM_TILE_RAW | tileSize);
+                pData += 2 + tileSize;
+            }
+            else
+            {
+                _CdcStream_Put16(pData, size);
+                pData += 2 + size;
+            }
+        }
+    }
+
+    memcpy(pOut, s_CdcStreamMagic, sizeof(s_CdcStreamMagic));
+    pOut[3] = pEncoder->format;
+    pOut[4] = pEncoder->srcFormat;
+    pOut[5] = CDC_STREAM_VERSION;
+    _CdcStream_Put32(pOut + 6, pEncoder->width);
+    _CdcStream_Put32(pOut + 10, pEncoder->height);
+    _CdcStream_Put32(pOut + 14, sequence);
+    _CdcStream_Put32(pOut + 18, pData - pMap);
+    pOut[22] = CDC_STREAM_TILE;
+    pOut[23] = pEncoder->bytesPerPixel;
+    pOut[24] = key ? CDC_STREAM_FLAG_KEY : 0;
+    pOut[25] = 0;
+
+    pEncoder->sinceKey = key ? 0 : (pEncoder->sinceKey + 1);
+    *pKey              = key;
+
+    return pData - pOut;
+}
+
+int HAL_CdcStream_ParseHeader(const uint8_t *pMsg, uint32_t size, cdc_stream_frame_info_t *pInfo)
+{
+    if ((size < 14) || (memcmp(pMsg, s_CdcStreamMagic, sizeof(s_CdcStreamMagic)) != 0))
+    {
+        return -1;
+    }
+
+    memset(pInfo, 0, sizeof(*pInfo));
+    pInfo->format    = pMsg[3];
+    pInfo->srcFormat = pMsg[4];
+    pInfo->version   = pMsg[5];
+    pInfo->width     = _CdcStream_Get32(pMsg + 6);
+    pInfo->height    = _CdcStream_Get32(pMsg + 10);
+
+    if (pInfo->version == CDC_STREAM_VERSION)
+    {
+        if (size < CDC_STREAM_HEADER_SIZE)
+        {
+            return -1;
+        }
+        pInfo->sequence      = _CdcStream_Get32(pMsg + 14);
+        pInfo->payloadSize   = _CdcStream_Get32(pMsg + 18);
+        pInfo->tileSize      = pMsg[22];
+        pInfo->bytesPerPixel = pMsg[23];
+        pInfo->flags         = pMsg[24];
+    }
+
+    return 0;
+}
+
+int HAL_CdcStream_Decode(const cdc_stream_frame_info_t *pInfo, const uint8_t *pPayload, uint8_t *pFrame, int pitch)
+{
+    const int tileSide = pInfo->tileSize;
+    const int bpp      = pInfo->bytesPerPixel;
+    int tilesX;
+    int tilesY;
+    uint32_t mapSize;
+    const uint8_t *pData;
+    const uint8_t *pEnd = pPayload + pInfo->payloadSize;
+    uint8_t tile[CDC_STREAM_TILE * CDC_STREAM_TILE * CDC_STREAM_MAX_BPP];
+
+    if ((pInfo->version != CDC_STREAM_VERSION) || (tileSide == 0) || (tileSide > CDC_STREAM_TILE) || (bpp == 0) ||
+        (bpp > CDC_STREAM_MAX_BPP))
+    {
+        return -1;
+    }
+
+    tilesX  = (pInfo->width + tileSide - 1) / tileSide;
+    tilesY  = (pInfo->height + tileSide - 1) / tileSide;
+    mapSize = (tilesX * tilesY + 7) / 8;
+    if (pInfo->payloadSize < mapSize)
+    {
+        return -1;
+    }
+    pData = pPayload + mapSize;
+
+    for (int tileY = 0; tileY < tilesY; tileY++)
+    {
+        int tileHeight = CDC_STREAM_MIN(tileSide, (int)pInfo->height - tileY * tileSide);
+
+        for (int tileX = 0; tileX < tilesX; tileX++)
+        {
+            int tileWidth     = CDC_STREAM_MIN(tileSide, (int)pInfo->width - tileX * tileSide);
+            int rowBytes      = tileWidth * bpp;
+            uint32_t tileSize = rowBytes * tileHeight;
+            int index         = tileY * tilesX + tileX;
+            const uint8_t *pTile;
+            uint8_t *pDst;
+            uint16_t size;
+
+            if ((pPayload[index / 8] & (1U << (index % 8))) == 0)
+            {
+                continue;
+            }
+
+            if (pEnd - pData < 2)
+            {
+                return -1;
+            }
+            size = _CdcStream_Get16(pData);
+            pData += 2;
+
+            if (size & CDC_STREAM_TILE_RAW)
+            {
+                size &= ~CDC_STREAM_TILE_RAW;
+                if ((size != tileSize) || (pEnd - pData < size))
+                {
+                    return -1;
+                }
+                pTile = pData;
+            }
+            else
+            {
+                if ((pEnd - pData < size) ||
+                    (HAL_CdcStream_Decompress(pData, size, tile, sizeof(tile)) != (int32_t)tileSize))
+                {
+                    return -1;
+                }
+                pTile = tile;
+            }
+            pData += size;
+
+            pDst = pFrame + (tileY * tileSide) * pitch + (tileX * tileSide) * bpp;
+            for (int y = 0; y < tileHeight; y++)
+            {
+                memcpy(pDst, pTile, rowBytes);
+                pTile += rowBytes;
+                pDst += pitch;
+            }
+        }
+    }
+
+    return (pData == pEnd) ? 0 : -1;
+}
+
+void HAL_CdcStream_MakeAck(uint8_t *pAck, uint32_t sequence, uint8_t flags)
+{
+    memset(pAck, 0, CDC_STREAM_ACK_SIZE);
+    memcpy(pAck, s_CdcStreamMagic, sizeof(s_CdcStreamMagic));
+    pAck[3] = CDC_STREAM_ACK_TYPE;
+    _CdcStream_Put32(pAck + 4, sequence);
+    pAck[8] = flags;
+}
+
+int HAL_CdcStream_ParseAck(const uint8_t *pAck, uint32_t size, uint32_t *pSequence, uint8_t *pFlags)
+{
+    if ((size < CDC_STREAM_ACK_SIZE) || (memcmp(pAck, s_CdcStreamMagic, sizeof(s_CdcStreamMagic)) != 0) ||
+        (pAck[3] != CDC_STREAM_ACK_TYPE))
+    {
+        return -1;
+    }
+
+    *pSequence = _CdcStream_Get32(pAck + 4);
+    *pFlags    = pAck[8];
+
+    return 0;
+}
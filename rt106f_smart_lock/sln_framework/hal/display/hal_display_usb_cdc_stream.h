@@ -0,0 +1,190 @@
+/*
+ * Copyright 2022 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/*
+ * @brief frame stream of the display over usb cdc: the tiles changed since the previous frame, compressed.
+ *
+ * A frame message starts with the header of the raw frames, its version byte tells a stream frame:
+ *
+ *   0  magic 0x53 0x79 0x4c         14 sequence, u32               26 tile map, a bit per tile in raster order
+ *   3  format                       18 payload size, u32              from bit 0 of the first byte, set if sent
+ *   4  source format                22 tile size, in pixels           then each tile sent: u16 size, bit 15 set
+ *   5  version, 0 raw 1 stream      23 bytes per pixel                if the tile is stored as is, and the tile
+ *   6  width, u32                   24 flags, CDC_STREAM_FLAG_*       compressed in the LZ4 block format, its
+ *   10 height, u32                  25 reserved                       rows one after the other
+ *
+ * The host acknowledges each frame with CDC_STREAM_ACK_SIZE bytes: the magic, 'A', the sequence and the
+ * CDC_STREAM_ACK_* flags. Values are little endian. The codec only depends on the C library, it builds on a host as is.
+ */
+
+#ifndef _HAL_DISPLAY_USB_CDC_STREAM_H_
+#define _HAL_DISPLAY_USB_CDC_STREAM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Tile side in pixels, up to 16 */
+#ifndef CDC_STREAM_TILE
+#define CDC_STREAM_TILE 16
+#endif /* CDC_STREAM_TILE */
+
+/* A tile which differs from the one last sent is sent when the mean of the bytes of one of its quarters moved by
+ * more than this, or when it didn't change since the previous frame. The sensor noise stays off the link and a small
+ * change is sent once it settles. 0 sends every tile which differs */
+#ifndef CDC_STREAM_THRESHOLD
+#define CDC_STREAM_THRESHOLD 2
+#endif /* CDC_STREAM_THRESHOLD */
+
+/* Frames between two key frames, which send every tile. 0 sends them only when the host asks */
+#ifndef CDC_STREAM_KEY_INTERVAL
+#define CDC_STREAM_KEY_INTERVAL 60
+#endif /* CDC_STREAM_KEY_INTERVAL */
+
+#define CDC_STREAM_VERSION     1
+#define CDC_STREAM_HEADER_SIZE 26
+#define CDC_STREAM_MAX_BPP     3
+#define CDC_STREAM_HASH_BITS   10
+#define CDC_STREAM_TILE_PARTS  4
+
+#define CDC_STREAM_FLAG_KEY  0x01 /* every tile is sent */
+#define CDC_STREAM_TILE_RAW  0x8000
+
+#define CDC_STREAM_ACK_SIZE      12
+#define CDC_STREAM_ACK_TYPE      'A'
+#define CDC_STREAM_ACK_KEY_FRAME 0x01 /* the host lost track, it asks for a key frame */
+
+#define CDC_STREAM_TILES(width, height) \
+    ((((width) + CDC_STREAM_TILE - 1) / CDC_STREAM_TILE) * (((height) + CDC_STREAM_TILE - 1) / CDC_STREAM_TILE))
+
+
+/* Largest message of a frame, a key frame whose tiles don't compress */
+#define CDC_STREAM_MAX_SIZE(width, height, bytesPerPixel)                                                        \
+    (CDC_STREAM_HEADER_SIZE + (CDC_STREAM_TILES(width, height) + 7) / 8 + CDC_STREAM_TILES(width, height) * 2 + \
+     (width) * (height) * (bytesPerPixel))
+
+/* What the encoder knows of a tile */
+typedef struct _cdc_stream_tile
+{
+    uint32_t sentHash;                    /* FNV-1a of the tile as the host has it */
+    uint32_t lastHash;                    /* FNV-1a of the tile in the previous frame */
+    uint16_t sums[CDC_STREAM_TILE_PARTS]; /* sums of the bytes of its quarters, as the host has it */
+} cdc_stream_tile_t;
+
+typedef struct _cdc_stream_encoder
+{
+    uint8_t format;
+    uint8_t srcFormat;
+    int width;
+    int height;
+    int pitch;
+    int bytesPerPixel;
+    int tilesX;
+    int tilesY;
+    cdc_stream_tile_t *pTiles; /* each tile, in raster order */
+    uint32_t sinceKey;         /* frames since the last key frame */
+    /* set by the usb interrupt too, cleared by the caller of HAL_CdcStream_Encode */
+    volatile bool keyRequested;
+    uint8_t tile[CDC_STREAM_TILE * CDC_STREAM_TILE * CDC_STREAM_MAX_BPP];
+    uint16_t hash[1 << CDC_STREAM_HASH_BITS];
+} cdc_stream_encoder_t;
+
+typedef struct _cdc_stream_frame_info
+{
+    uint8_t format;
+    uint8_t srcFormat;
+    uint8_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t sequence;
+    uint32_t payloadSize;
+    uint8_t tileSize;
+    uint8_t bytesPerPixel;
+    uint8_t flags;
+} cdc_stream_frame_info_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Compress a buffer in the LZ4 block format
+ * @param pSrc The data
+ * @param size Its size, up to 64 KB
+ * @param pDst The output
+ * @param dstSize Room in the output
+ * @param pHash Scratch of 1 << CDC_STREAM_HASH_BITS entries
+ * @return uint32_t Size of the compressed data, 0 if it doesn't fit in dstSize
+ */
+uint32_t HAL_CdcStream_Compress(const uint8_t *pSrc, uint32_t size, uint8_t *pDst, uint32_t dstSize, uint16_t *pHash);
+
+/**
+ * @brief Decompress a block of the LZ4 block format
+ * @return int32_t Size of the data, -1 if the block is corrupt or doesn't fit in dstSize
+ */
+int32_t HAL_CdcStream_Decompress(const uint8_t *pSrc, uint32_t size, uint8_t *pDst, uint32_t dstSize);
+
+/**
+ * @brief Init an encoder, its first frame is a key frame
+ * @param pTiles CDC_STREAM_TILES(width, height) entries kept by the encoder
+ * @return int Return 0 if successful
+ */
+int HAL_CdcStream_EncoderInit(cdc_stream_encoder_t *pEncoder,
+                              uint8_t format,
+                              uint8_t srcFormat,
+                              int width,
+                              int height,
+                              int pitch,
+                              int bytesPerPixel,
+                              cdc_stream_tile_t *pTiles);
+
+/**
+ * @brief Encode the message of a frame, with the tiles changed since they were last sent
+ * @param pFrame The frame, pitch bytes per row
+ * @param sequence Sequence number of the message
+ * @param pOut The message
+ * @param outSize Room for the message, CDC_STREAM_MAX_SIZE is always enough
+ * @param pKey Set if the message is a key frame. The caller then clears keyRequested, with the interrupts which
+ * request key frames masked, as a request made during the encoding is not served by the message
+ * @return uint32_t Size of the message, 0 if it doesn't fit. The encoder then sends a key frame next
+ */
+uint32_t HAL_CdcStream_Encode(cdc_stream_encoder_t *pEncoder,
+                              const uint8_t *pFrame,
+                              uint32_t sequence,
+                              uint8_t *pOut,
+                              uint32_t outSize,
+                              bool *pKey);
+
+/**
+ * @brief Parse the header of a frame message
+ * @return int Return 0 if pMsg starts with a frame header, check its version
+ */
+int HAL_CdcStream_ParseHeader(const uint8_t *pMsg, uint32_t size, cdc_stream_frame_info_t *pInfo);
+
+/**
+ * @brief Apply the tiles of a stream frame to the previous frame
+ * @param pPayload The payloadSize bytes after the header
+ * @param pFrame The previous frame, updated
+ * @param pitch Bytes per row of pFrame
+ * @return int Return 0 if successful. Else the frame is partly updated, ask for a key frame
+ */
+int HAL_CdcStream_Decode(const cdc_stream_frame_info_t *pInfo, const uint8_t *pPayload, uint8_t *pFrame, int pitch);
+
+void HAL_CdcStream_MakeAck(uint8_t *pAck, uint32_t sequence, uint8_t flags);
+
+/**
+ * @brief Parse an acknowledgement of the host
+ * @return int Return 0 if pAck holds one
+ */
+int HAL_CdcStream_ParseAck(const uint8_t *pAck, uint32_t size, uint32_t *pSequence, uint8_t *pFlags);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* _HAL_DISPLAY_USB_CDC_STREAM_H_ */
@@ -33,6 +33,7 @@
 #include "fwk_log.h"
 #include "fwk_message.h"
 #include "fwk_display_manager.h"
+#include "fwk_memory.h"
 #include "hal_display_dev.h"
 
 #if ((defined FSL_FEATURE_SOC_USBPHY_COUNT) && (FSL_FEATURE_SOC_USBPHY_COUNT > 0U))
@@ -715,6 +716,9 @@ static hal_display_status_t HAL_DisplayDev_UsbUvc_Init(
     dev->cap.frameBuffer     = (void *)s_usbBuffer[0];
     dev->cap.callback        = callback;
 
+    FWK_Memory_Track(kFWKMemRegion_SdramUncached, kFWKMemOwner_Display, s_usbBuffer, sizeof(s_usbBuffer),
+                     "uvc frame buffers");
+
     s_DisplayFull  = xSemaphoreCreateCounting(1, 0);
     s_DisplayEmpty = xSemaphoreCreateCounting(1, 1);
 
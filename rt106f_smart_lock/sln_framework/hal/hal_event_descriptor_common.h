@@ -191,6 +191,8 @@ typedef enum _recording_state_t
     kRecordingState_Start = 0,
     kRecordingState_Stop,
     kRecordingState_Info,
+    kRecordingState_Arm,     /* record into the pre-event clip buffer until kRecordingState_Trigger */
+    kRecordingState_Trigger, /* recognition event, keep the post-event frames and stop */
     kRecordingState_Invalid
 } recording_state_t;
 
@@ -199,6 +201,8 @@ typedef struct _recording_info_t
     recording_state_t state;
     unsigned int start;
     unsigned int size;
+    unsigned int frames;
+    unsigned int skipped;
 } recording_info_t;
 
 typedef struct _event_recording_t
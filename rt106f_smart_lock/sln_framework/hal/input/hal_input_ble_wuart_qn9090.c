@@ -20,6 +20,8 @@
 #include "board.h"
 #include "fsl_lpuart_freertos.h"
 #include "fsl_lpuart.h"
+#include "fsl_dmamux.h"
+#include "fsl_edma.h"
 
 #include "fwk_log.h"
 #include "fwk_message.h"
@@ -30,6 +32,7 @@
 #include "hal_event_descriptor_face_rec.h"
 #include "hal_input_dev.h"
 #include "hal_smart_lock_config.h"
+#include "hal_input_ble_wuart_rx.h"
 
 /*******************************************************************************
  * Defines
@@ -41,11 +44,59 @@
 
 #define BLE_WUART_QUEUE_LENGTH 5
 
-#define BLE_WUART_HEADER_LENGTH 24
 #define BLE_WUART_READY         "BLE-READY_"
 #define BLE_WUART_CONNECTED     "BLE-CONNECTED_"
 
-#define BLE_WUART_MINI_TRANS_UINT 24
+/* Received bytes land in a ring written by a looping dma channel, the task is woken up by the idle line
+ * interrupt at the end of every burst and by the dma at every half of the ring */
+#define BLE_WUART_RX_DMA         DMA0
+#define BLE_WUART_RX_DMAMUX      DMAMUX
+#define BLE_WUART_RX_DMA_CHANNEL 2
+#define BLE_WUART_RX_DMA_SOURCE  kDmaRequestMuxLPUART5Rx
+#define BLE_WUART_RX_DMA_IRQn    DMA2_DMA18_IRQn
+
+/* Power of two */
+#ifndef BLE_WUART_RX_RING_SIZE
+#define BLE_WUART_RX_RING_SIZE 1024
+#endif /* BLE_WUART_RX_RING_SIZE */
+
+/* Packets are received in place into a fixed pool and handed to the consumers by reference */
+#ifndef BLE_WUART_PACKET_POOL_COUNT
+#define BLE_WUART_PACKET_POOL_COUNT 2
+#endif /* BLE_WUART_PACKET_POOL_COUNT */
+
+/* Header reserved word of a batch registration chunk. A chunk is received while the previous one is enrolled, the
+ * host keeps at most BLE_WUART_PACKET_POOL_COUNT chunks unanswered */
+#define BLE_WUART_BATCH_COUNT(reserved) ((reserved)&0xFFFF)
+#define BLE_WUART_BATCH_REREGISTER      (1 << 16)
+#define BLE_WUART_BATCH_LAST            (1 << 17)
+
+/* The link starts at the default rate. The module offers its highest rate in the reserved word of the READY and
+ * CONNECTED status, the lower of the two rates is asked for with a control packet and used once the module accepts */
+#define BLE_WUART_DEFAULT_BAUDRATE 115200
+
+#ifndef BLE_WUART_BRIDGE_BAUDRATE
+#define BLE_WUART_BRIDGE_BAUDRATE 1000000
+#endif /* BLE_WUART_BRIDGE_BAUDRATE */
+
+/* Ask for RTS/CTS, the LPUART5 RTS and CTS pins must be routed to the module */
+#ifndef BLE_WUART_FLOW_CONTROL
+#define BLE_WUART_FLOW_CONTROL 0
+#endif /* BLE_WUART_FLOW_CONTROL */
+
+/* Bad transfer units in a row at a negotiated rate before the link falls back to the default rate */
+#define BLE_WUART_LINK_MAX_ERRORS 3
+
+#define BLE_WUART_LINK_FLOW_CONTROL (1UL << 31)
+#define BLE_WUART_LINK_BAUD(link)   ((link)&0x7FFFFFFFUL)
+
+/* Bulk transfers carry a packet in chunks the host streams without waiting for an answer. The host keeps at most a
+ * window of bytes unacknowledged, the lock acknowledges the bytes received in order every half window */
+#ifndef BLE_WUART_BULK_WINDOW
+#define BLE_WUART_BULK_WINDOW 2048
+#endif /* BLE_WUART_BULK_WINDOW */
+
+#define BLE_WUART_BULK_NO_GAP UINT32_MAX
 
 typedef enum _hal_ble_connection_status_t
 {
@@ -54,23 +105,6 @@ typedef enum _hal_ble_connection_status_t
     kHALBLEConnectionStatus_Invalid,
 } _hal_ble_connection_status_t;
 
-typedef enum _hal_ble_wuart_status_t
-{
-    kHALBLEWUARTStatus_Success,
-    kHALBLEWUARTStatus_TUMagicError,
-    kHALBLEWUARTStatus_TUCRC32Error,
-    kHALBLEWUARTStatus_PacketCRC32Error,
-    kHALBLEWUARTStatus_PacketValid,
-    kHALBLEWUARTStatus_PacketError,
-    kHALBLEWUARTStatus_PacketShort,
-} hal_ble_wuart_status_t;
-
-typedef enum _hal_ble_wuart_packet_t
-{
-    kHALBLEWUARTPacket_Header,
-    kHALBLEWUARTPacket_Data,
-} hal_ble_wuart_packet_t;
-
 typedef struct _hal_ble_wuart_response_t
 {
     union
@@ -79,17 +113,6 @@ typedef struct _hal_ble_wuart_response_t
     };
 } hal_ble_wuart_response_t;
 
-typedef struct _hal_header_transfer_unit_t
-{
-    uint8_t tuMagic[3];
-    uint8_t pktType;
-    uint32_t pktLen;
-    uint32_t pktId;
-    uint32_t pktCrc;
-    uint32_t tuCrc;
-    uint32_t reserved;
-} hal_header_transfer_unit_t;
-
 typedef enum _hal_transfer_packet_type_t
 {
     AUTHENTICATION_REQ = 0,
@@ -116,6 +139,19 @@ typedef enum _hal_transfer_packet_type_t
     GET_APP_TYPE_RES,
     GET_ALGO_VERSION_REQ,
     GET_ALGO_VERSION_RES,
+    BATCH_REGISTRATION_REQ,
+    BATCH_REGISTRATION_RES,
+    DB_SUMMARY_REQ,
+    DB_SUMMARY_RES,
+    DB_CHANGES_REQ,
+    DB_CHANGES_RES,
+    DB_APPLY_CHANGES_REQ,
+    DB_APPLY_CHANGES_RES,
+    BULK_START_REQ,
+    BULK_START_RES,
+    BULK_DATA_REQ,
+    BULK_DATA_RES,
+    BRIDGE_CONTROL    = 0xfe,
     FIRMWARE_RESPONSE = 0xff,
 } hal_ble_transfer_packet_type_t;
 
@@ -128,14 +164,35 @@ typedef enum _hal_wuart_ack_reserved_t
     BLE_WUART_ACK_ERROR     = -1, // 0xffffffffff
 } hal_wuart_ack_reserved_t;
 
+/* Body of BULK_START_REQ, the packet id of the header is the transfer id */
+typedef struct _hal_ble_wuart_bulk_start_t
+{
+    uint32_t pktLen;  /* header of the packet carried */
+    uint32_t pktId;
+    uint32_t pktCrc;
+    uint8_t pktType;
+    uint8_t reserved[3];
+} hal_ble_wuart_bulk_start_t;
+
+typedef struct _hal_ble_wuart_bulk_t
+{
+    /* packet carried, built in place and handled like a received packet once complete */
+    hal_ble_wuart_packet_buf_t packet;
+    uint32_t transferId;
+    uint32_t received; /* bytes received in order */
+    uint32_t acked;    /* bytes acknowledged to the host */
+    uint32_t gapAt;    /* offset a gap was reported at, chunks after a gap are dropped until the host goes back */
+    uint32_t crc;
+    uint8_t active;
+} hal_ble_wuart_bulk_t;
+
 typedef struct _hal_ble_wuart_transfer_t
 {
-    uint8_t *nibbleBuf;
-    uint8_t *packetBuf;
-    int nibbleLen;
-    int packetLen;
-    int readOffset;
-    uint8_t stage;
+    uint8_t *ringBuf;
+    uint32_t readOffset;
+    /* ring halves written by the dma and not yet accounted for by a drain */
+    volatile int32_t halfEvents;
+    hal_ble_wuart_rx_t rx;
 } hal_ble_wuart_transfer_t;
 
 /*******************************************************************************
@@ -146,6 +203,7 @@ typedef struct _hal_ble_wuart_transfer_t
 extern "C" {
 #endif /* __cplusplus */
 void BOARD_InitBleQn9090Resource(uint32_t *uartRootClk);
+void BOARD_InitEDMA();
 #if defined(__cplusplus)
 }
 #endif /* __cplusplus */
@@ -163,17 +221,38 @@ static hal_output_status_t HAL_OutputDev_BleWuartQn9090_InferComplete(const outp
 static hal_output_status_t HAL_OutputDev_BleWuartQn9090_InputNotify(const output_dev_t *dev, void *param);
 static hal_ble_wuart_status_t SLN_BLEWUARTSendPacket(
     uint8_t *data, uint32_t len, uint8_t type, uint32_t pktId, uint32_t result);
+static hal_ble_wuart_status_t SLN_BLEWUARTParseData(hal_ble_wuart_packet_buf_t *pPacket);
 
 static lpuart_rtos_handle_t s_LpuartRTOSHandle;
 static lpuart_handle_t s_LpuartHandle;
-static uint8_t s_LpuartRingBuffer[512];
+/* only used by the driver until the dma takes the receiver over */
+static uint8_t s_LpuartRingBuffer[32];
+
+AT_NONCACHEABLE_SECTION_ALIGN_DTC(static edma_handle_t s_BLEWUARTRxDmaHandle, 4);
+AT_NONCACHEABLE_SECTION_ALIGN_DTC(static uint8_t s_BLEWUARTRxRing[BLE_WUART_RX_RING_SIZE], 4);
+static hal_ble_wuart_packet_buf_t s_BLEWUARTPacketPool[BLE_WUART_PACKET_POOL_COUNT];
+/* packet holding the remote registration data until the vision algorithm responds */
+static hal_ble_wuart_packet_buf_t *s_BLEWUARTRegPacket;
+/* batch registration chunks waiting for the vision algorithm, handed over one at a time in order */
+static hal_ble_wuart_packet_buf_t *s_BLEWUARTBatchPackets[BLE_WUART_PACKET_POOL_COUNT];
+static event_face_rec_t s_BLEWUARTBatchEvents[BLE_WUART_PACKET_POOL_COUNT];
+static input_event_t s_BLEWUARTBatchInputEvent;
+static uint8_t s_BLEWUARTBatchHead;
+static uint8_t s_BLEWUARTBatchCount;
+static hal_ble_wuart_packet_buf_t *s_BLEWUARTImportPacket;
+static event_face_rec_t s_BLEWUARTImportEvent;
+static hal_ble_wuart_bulk_t s_BLEWUARTBulk;
+static TaskHandle_t s_BLEWUARTTaskHandle;
+
+static uint32_t s_BLEWUARTSrcClk;
+/* baud rate and flow control of the link, and the bad transfer units received in a row at that rate */
+static uint32_t s_BLEWUARTLink = BLE_WUART_DEFAULT_BAUDRATE;
+static uint8_t s_BLEWUARTLinkErrors;
 
 static uint8_t s_QN9090IsConnected    = kHALBLEConnectionStatus_Invalid;
 static uint8_t s_QN9090MacAddress[18] = {0}; // ble mac address xx:xx:xx:xx:xx:xx
 
-static uint8_t s_BLEWUARTNibbleBuffer[BLE_WUART_MINI_TRANS_UINT];
 static hal_ble_wuart_transfer_t s_BLEWUARTTransfer;
-static hal_header_transfer_unit_t s_HeaderTransferUnit = {0};
 static event_face_rec_t s_BLEWUARTEvent;
 static input_event_t s_InputEvent;
 
@@ -209,9 +288,63 @@ static output_dev_t s_OutputDev_BLEWUARTQN9090 = {
 
 static hal_lpm_request_t s_LpmReq = {.dev = &s_InputDev_BLEWUARTQN9090, .name = "s_InputDev_BLEWUARTQN9090"};
 
-static uint32_t table[0x100];
 static uint32_t s_pckID;
 
+static hal_ble_wuart_packet_buf_t *SLN_BLEWUARTPacketAcquire(void)
+{
+    hal_ble_wuart_packet_buf_t *pPacket = NULL;
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < BLE_WUART_PACKET_POOL_COUNT; i++)
+    {
+        if (s_BLEWUARTPacketPool[i].refCount == 0)
+        {
+            pPacket           = &s_BLEWUARTPacketPool[i];
+            pPacket->refCount = 1;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return pPacket;
+}
+
+static void SLN_BLEWUARTPacketRetain(hal_ble_wuart_packet_buf_t *pPacket)
+{
+    taskENTER_CRITICAL();
+    pPacket->refCount++;
+    taskEXIT_CRITICAL();
+}
+
+static void SLN_BLEWUARTPacketRelease(hal_ble_wuart_packet_buf_t *pPacket)
+{
+    if (pPacket == NULL)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    if (pPacket->refCount > 0)
+    {
+        pPacket->refCount--;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/* Hand the oldest batch registration chunk over to the vision algorithm */
+static void SLN_BLEWUARTBatchDispatch(void)
+{
+    uint32_t receiverList = 1 << kFWKTaskID_VisionAlgo;
+    uint8_t fromISR       = __get_IPSR();
+
+    s_BLEWUARTBatchInputEvent.eventId                  = kInputEventID_Recv;
+    s_BLEWUARTBatchInputEvent.size                     = sizeof(event_face_rec_t);
+    s_BLEWUARTBatchInputEvent.u.inputData.data         = &s_BLEWUARTBatchEvents[s_BLEWUARTBatchHead];
+    s_BLEWUARTBatchInputEvent.u.inputData.copy         = 0;
+    s_BLEWUARTBatchInputEvent.u.inputData.receiverList = receiverList;
+    s_InputDev_BLEWUARTQN9090.cap.callback(&s_InputDev_BLEWUARTQN9090, &s_BLEWUARTBatchInputEvent, fromISR);
+}
+
 static int HAL_InputDev_BleWuartQn9090_Respond(uint32_t eventId,
                                                void *response,
                                                event_status_t status,
@@ -298,14 +431,56 @@ static int HAL_InputDev_BleWuartQn9090_Respond(uint32_t eventId,
                 SLN_BLEWUARTSendPacket(NULL, 0, REGISTRATION_RES, s_pckID, BLE_WUART_ACK_ERROR);
             }
 
-            vPortFree(s_BLEWUARTEvent.remoteReg.regData);
+            SLN_BLEWUARTPacketRelease(s_BLEWUARTRegPacket);
 
+            s_BLEWUARTRegPacket                    = NULL;
             s_BLEWUARTEvent.remoteReg.regData      = NULL;
             s_BLEWUARTEvent.remoteReg.dataLen      = 0;
             s_BLEWUARTEvent.remoteReg.isReRegister = -1;
         }
         break;
 
+        case kEventFaceRecID_AddUsersRemote:
+        {
+            remote_batch_reg_result_t *res      = response;
+            hal_ble_wuart_packet_buf_t *pPacket = s_BLEWUARTBatchPackets[s_BLEWUARTBatchHead];
+            uint8_t dispatch;
+
+            /* one status per record, the ack tells if the chunk was enrolled and, for the last one, committed */
+            SLN_BLEWUARTSendPacket((uint8_t *)res->records, res->count * sizeof(remote_batch_reg_record_t),
+                                   BATCH_REGISTRATION_RES, pPacket->header.pktId,
+                                   (status == kEventStatus_Ok) ? BLE_WUART_ACK_SUCCESS : BLE_WUART_ACK_ERROR);
+            SLN_BLEWUARTPacketRelease(pPacket);
+
+            taskENTER_CRITICAL();
+            s_BLEWUARTBatchPackets[s_BLEWUARTBatchHead] = NULL;
+            s_BLEWUARTBatchHead                         = (s_BLEWUARTBatchHead + 1) % BLE_WUART_PACKET_POOL_COUNT;
+            s_BLEWUARTBatchCount--;
+            dispatch = (s_BLEWUARTBatchCount > 0);
+            taskEXIT_CRITICAL();
+
+            /* the next chunk was received while this one was enrolled */
+            if (dispatch)
+            {
+                SLN_BLEWUARTBatchDispatch();
+            }
+        }
+        break;
+
+        case kEventFaceRecID_ImportUsersRemote:
+        {
+            /* the revision of the database after the changes are applied */
+            SLN_BLEWUARTSendPacket((uint8_t *)response, sizeof(uint32_t), DB_APPLY_CHANGES_RES,
+                                   s_BLEWUARTImportPacket->header.pktId,
+                                   (status == kEventStatus_Ok) ? BLE_WUART_ACK_SUCCESS : BLE_WUART_ACK_ERROR);
+            SLN_BLEWUARTPacketRelease(s_BLEWUARTImportPacket);
+
+            s_BLEWUARTImportPacket             = NULL;
+            s_BLEWUARTImportEvent.wuart.data   = NULL;
+            s_BLEWUARTImportEvent.wuart.length = 0;
+        }
+        break;
+
         default:
             break;
     }
@@ -313,45 +488,58 @@ static int HAL_InputDev_BleWuartQn9090_Respond(uint32_t eventId,
     return 0;
 }
 
-static uint32_t crc32_for_byte(uint32_t r)
+/* Move the link to another rate once the bytes sent have left the shifter */
+static void SLN_BLEWUARTSetLink(uint32_t link)
 {
-    for (int j = 0; j < 8; ++j)
+    while ((LPUART_GetStatusFlags(BLE_UART_BASE) & kLPUART_TransmissionCompleteFlag) == 0)
     {
-        r = (r & 1 ? 0 : (uint32_t)0xEDB88320L) ^ r >> 1;
     }
 
-    return r ^ (uint32_t)0xFF000000L;
-}
-
-static void crc32(const void *data, size_t numBytes, uint32_t *crc)
-{
-    memset(table, 0x00, sizeof(table));
-
-    if (!*table)
+    if (LPUART_SetBaudRate(BLE_UART_BASE, BLE_WUART_LINK_BAUD(link), s_BLEWUARTSrcClk) != kStatus_Success)
     {
-        for (size_t i = 0; i < 0x100; ++i)
-        {
-            table[i] = crc32_for_byte(i);
-        }
+        LOGE("[BleWirelessUartTask]: Baud rate %d not supported.", BLE_WUART_LINK_BAUD(link));
+        return;
     }
 
-    for (size_t i = 0; i < numBytes; ++i)
+    if (link & BLE_WUART_LINK_FLOW_CONTROL)
     {
-        *crc = table[(uint8_t)*crc ^ ((uint8_t *)data)[i]] ^ *crc >> 8;
+        BLE_UART_BASE->MODIR |= LPUART_MODIR_TXCTSE_MASK | LPUART_MODIR_RXRTSE_MASK;
     }
+    else
+    {
+        BLE_UART_BASE->MODIR &= ~(LPUART_MODIR_TXCTSE_MASK | LPUART_MODIR_RXRTSE_MASK);
+    }
+
+    s_BLEWUARTLink       = link;
+    s_BLEWUARTLinkErrors = 0;
+    LOGD("[BleWirelessUartTask]: Link at %d bps%s.", BLE_WUART_LINK_BAUD(link),
+         (link & BLE_WUART_LINK_FLOW_CONTROL) ? " with RTS/CTS" : "");
 }
 
-static void LOGD_HEX(uint8_t *data, int len)
+/* Ask the module for the highest rate both sides support, the link stays at the current rate until it accepts */
+static void SLN_BLEWUARTRequestLink(uint32_t offer)
 {
-    for (int i = 0; i < len; i++)
+    uint32_t link = MIN(BLE_WUART_BRIDGE_BAUDRATE, BLE_WUART_LINK_BAUD(offer));
+
+    if ((link <= BLE_WUART_DEFAULT_BAUDRATE) || (s_BLEWUARTLink != BLE_WUART_DEFAULT_BAUDRATE))
     {
-        LOGD("0x%2x ", data[i]);
+        return;
     }
+
+    if (BLE_WUART_FLOW_CONTROL && (offer & BLE_WUART_LINK_FLOW_CONTROL))
+    {
+        link |= BLE_WUART_LINK_FLOW_CONTROL;
+    }
+
+    SLN_BLEWUARTSendPacket((uint8_t *)&link, sizeof(link), BRIDGE_CONTROL, 0, 0);
 }
 
 /* Press QN_WAKEUP to request ble sync current connected status*/
 static void SLN_BLEWUARTPressWakePin()
 {
+    /* the module answers at the default rate */
+    SLN_BLEWUARTSetLink(BLE_WUART_DEFAULT_BAUDRATE);
+
     GPIO_PinWrite(BOARD_BLE_QN9090_QN_WAKEUP_GPIO, BOARD_BLE_QN9090_QN_WAKEUP_PIN, 1);
     vTaskDelay(pdMS_TO_TICKS(500));
     GPIO_PinWrite(BOARD_BLE_QN9090_QN_WAKEUP_GPIO, BOARD_BLE_QN9090_QN_WAKEUP_PIN, 0);
@@ -394,7 +582,7 @@ static void SLN_BLEWUARTCreateHeader(
     if (len > 0)
     {
         /* packet crc */
-        crc32(data, len, &crc_res);
+        HAL_BleWuartRx_Crc32(data, len, &crc_res);
         *((uint32_t *)(htUnit + 12)) = crc_res;
     }
     else
@@ -407,7 +595,7 @@ static void SLN_BLEWUARTCreateHeader(
 
     /* transfer unit crc */
     crc_res = 0;
-    crc32(htUnit, BLE_WUART_HEADER_LENGTH - 4, &crc_res);
+    HAL_BleWuartRx_Crc32(htUnit, BLE_WUART_HEADER_LENGTH - 4, &crc_res);
     *((uint32_t *)(htUnit + 20)) = crc_res;
 }
 
@@ -430,54 +618,126 @@ static hal_ble_wuart_status_t SLN_BLEWUARTSendPacket(
     return status;
 }
 
-static hal_ble_wuart_status_t SLN_BLEWUARTParseHeader(uint8_t *headerBuf, hal_header_transfer_unit_t *pHtUnit)
+/* Start a bulk transfer, or resume it from the bytes received in order if the host asks again for the same one */
+static void SLN_BLEWUARTBulkStart(hal_header_transfer_unit_t *pHtUnit, uint8_t *dataBuf)
 {
-    hal_ble_wuart_status_t status = kHALBLEWUARTStatus_Success;
-    uint32_t crc_res              = 0;
+    hal_ble_wuart_bulk_t *pBulk = &s_BLEWUARTBulk;
+    hal_ble_wuart_bulk_start_t start;
+    uint32_t window = BLE_WUART_BULK_WINDOW;
 
-    /* transfer magic */
-    if (memcmp(headerBuf, TU_MAGIC, sizeof(TU_MAGIC)) != 0)
+    if (pHtUnit->pktLen != sizeof(start))
     {
-        return kHALBLEWUARTStatus_TUMagicError;
+        SLN_BLEWUARTSendPacket(NULL, 0, BULK_START_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+        return;
     }
-    memcpy(pHtUnit->tuMagic, headerBuf, 3);
+    memcpy(&start, dataBuf, sizeof(start));
 
-    /* packet type */
-    pHtUnit->pktType = headerBuf[3];
+    if (pBulk->active && (pBulk->transferId == pHtUnit->pktId) && (pBulk->packet.header.pktLen == start.pktLen) &&
+        (pBulk->packet.header.pktCrc == start.pktCrc))
+    {
+        LOGD("[BleWirelessUartTask]: Bulk transfer %d resumed at %d.", pBulk->transferId, pBulk->received);
+    }
+    else
+    {
+        /* the packet of the previous transfer is still used by a consumer */
+        if ((!pBulk->active && (pBulk->packet.refCount > 0)) || (start.pktLen > BLE_WUART_PACKET_MAX_LEN) ||
+            (start.pktType == BULK_START_REQ) || (start.pktType == BULK_DATA_REQ))
+        {
+            LOGE("[BleWirelessUartTask]: Bulk transfer %d of %d bytes refused.", pHtUnit->pktId, start.pktLen);
+            SLN_BLEWUARTSendPacket(NULL, 0, BULK_START_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+            return;
+        }
 
-    /* packet length */
-    pHtUnit->pktLen = *((uint32_t *)(headerBuf + 4));
+        /* a transfer left unfinished can only be resumed until another one starts */
+        memcpy(pBulk->packet.header.tuMagic, TU_MAGIC, sizeof(TU_MAGIC));
+        pBulk->packet.header.pktType  = start.pktType;
+        pBulk->packet.header.pktLen   = start.pktLen;
+        pBulk->packet.header.pktId    = start.pktId;
+        pBulk->packet.header.pktCrc   = start.pktCrc;
+        pBulk->packet.header.reserved = 0;
+        pBulk->packet.refCount        = 1;
+        pBulk->transferId             = pHtUnit->pktId;
+        pBulk->received               = 0;
+        pBulk->crc                    = 0;
+        pBulk->active                 = 1;
+    }
 
-    /* packet id */
-    pHtUnit->pktId = *((uint32_t *)(headerBuf + 8));
+    pBulk->acked = pBulk->received;
+    pBulk->gapAt = BLE_WUART_BULK_NO_GAP;
+    SLN_BLEWUARTSendPacket((uint8_t *)&window, sizeof(window), BULK_START_RES, pBulk->transferId, pBulk->received);
+}
 
-    /* packet crc */
-    pHtUnit->pktCrc = *((uint32_t *)(headerBuf + 12));
+/* Append a chunk received in order, chunks sent again after a gap may overlap the bytes already received */
+static void SLN_BLEWUARTBulkData(hal_header_transfer_unit_t *pHtUnit, uint8_t *dataBuf)
+{
+    hal_ble_wuart_bulk_t *pBulk = &s_BLEWUARTBulk;
+    uint32_t offset             = pHtUnit->reserved;
+    uint32_t skip;
+    uint32_t count;
 
-    /* packet reserved */
-    pHtUnit->reserved = *((uint32_t *)(headerBuf + 16));
+    if (!pBulk->active || (pBulk->transferId != pHtUnit->pktId))
+    {
+        SLN_BLEWUARTSendPacket(NULL, 0, BULK_DATA_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+        return;
+    }
 
-    /* transfer unit crc */
-    pHtUnit->tuCrc = *((uint32_t *)(headerBuf + 20));
-    crc32(headerBuf, BLE_WUART_HEADER_LENGTH - 4, &crc_res);
-    if (crc_res != pHtUnit->tuCrc)
+    if (offset > pBulk->received)
     {
-        return kHALBLEWUARTStatus_TUCRC32Error;
+        /* a chunk was lost, ask once for the bytes after the last one received in order */
+        if (pBulk->gapAt != pBulk->received)
+        {
+            pBulk->gapAt = pBulk->received;
+            pBulk->acked = pBulk->received;
+            SLN_BLEWUARTSendPacket(NULL, 0, BULK_DATA_RES, pBulk->transferId, pBulk->received);
+        }
+        return;
     }
 
-    return status;
-}
+    skip  = pBulk->received - offset;
+    count = (pHtUnit->pktLen > skip) ? MIN(pHtUnit->pktLen - skip, pBulk->packet.header.pktLen - pBulk->received) : 0;
+    if (count == 0)
+    {
+        return;
+    }
 
-static hal_ble_wuart_status_t SLN_BLEWUARTParseData(uint8_t *dataBuf, hal_header_transfer_unit_t *pHtUnit)
-{
-    hal_ble_wuart_status_t status = kHALBLEWUARTStatus_Success;
-    uint32_t crc_res              = 0;
-    crc32(dataBuf, pHtUnit->pktLen, &crc_res);
-    if (crc_res != pHtUnit->pktCrc)
+    memcpy(&pBulk->packet.data[pBulk->received], dataBuf + skip, count);
+    HAL_BleWuartRx_Crc32(dataBuf + skip, count, &pBulk->crc);
+    pBulk->received += count;
+    pBulk->gapAt = BLE_WUART_BULK_NO_GAP;
+
+    if (pBulk->received < pBulk->packet.header.pktLen)
     {
-        return kHALBLEWUARTStatus_PacketCRC32Error;
+        if ((pBulk->received - pBulk->acked) >= (BLE_WUART_BULK_WINDOW / 2))
+        {
+            pBulk->acked = pBulk->received;
+            SLN_BLEWUARTSendPacket(NULL, 0, BULK_DATA_RES, pBulk->transferId, pBulk->received);
+        }
+        return;
     }
 
+    /* the packet carried is answered on its own, the last ack only tells the transfer is over */
+    pBulk->active = 0;
+    pBulk->acked  = pBulk->received;
+    if (pBulk->crc != pBulk->packet.header.pktCrc)
+    {
+        LOGE("[BleWirelessUartTask]: Bulk transfer %d failed the packet crc.", pBulk->transferId);
+        SLN_BLEWUARTSendPacket(NULL, 0, BULK_DATA_RES, pBulk->transferId, BLE_WUART_ACK_ERROR);
+        SLN_BLEWUARTPacketRelease(&pBulk->packet);
+        return;
+    }
+
+    SLN_BLEWUARTSendPacket(NULL, 0, BULK_DATA_RES, pBulk->transferId, pBulk->received);
+    SLN_BLEWUARTParseData(&pBulk->packet);
+    SLN_BLEWUARTPacketRelease(&pBulk->packet);
+}
+
+/* The packet crc was checked while it was received */
+static hal_ble_wuart_status_t SLN_BLEWUARTParseData(hal_ble_wuart_packet_buf_t *pPacket)
+{
+    hal_ble_wuart_status_t status       = kHALBLEWUARTStatus_Success;
+    uint8_t *dataBuf                    = pPacket->data;
+    hal_header_transfer_unit_t *pHtUnit = &pPacket->header;
+
     s_pckID = pHtUnit->pktId;
     /* handle all kinds of packet type */
     switch (pHtUnit->pktType)
@@ -491,9 +751,9 @@ static hal_ble_wuart_status_t SLN_BLEWUARTParseData(uint8_t *dataBuf, hal_header
             }
             else
             {
-                uint8_t *pPassword = pvPortMalloc(pHtUnit->pktLen);
-                HAL_OutputDev_SmartLockConfig_GetPassword(pPassword);
-                if (memcmp(dataBuf, pPassword, pHtUnit->pktLen) == 0)
+                uint8_t password[sizeof(((smart_lock_config_t *)0)->password)];
+                HAL_OutputDev_SmartLockConfig_GetPassword(password);
+                if (memcmp(dataBuf, password, pHtUnit->pktLen) == 0)
                 {
                     SLN_BLEWUARTSendPacket(NULL, 0, AUTHENTICATION_RES, pHtUnit->pktId, BLE_WUART_ACK_SUCCESS);
                 }
@@ -501,8 +761,6 @@ static hal_ble_wuart_status_t SLN_BLEWUARTParseData(uint8_t *dataBuf, hal_header
                 {
                     SLN_BLEWUARTSendPacket(NULL, 0, AUTHENTICATION_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
                 }
-
-                vPortFree(pPassword);
             }
         }
         break;
@@ -532,6 +790,13 @@ static hal_ble_wuart_status_t SLN_BLEWUARTParseData(uint8_t *dataBuf, hal_header
         {
             uint32_t receiverList = 1 << kFWKTaskID_VisionAlgo;
 
+            if (s_BLEWUARTRegPacket != NULL)
+            {
+                LOGE("[ERROR]: BleWirelessUartTask REGISTRATION_REQ while a registration is in progress.\r\n");
+                SLN_BLEWUARTSendPacket(NULL, 0, REGISTRATION_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+                break;
+            }
+
             s_BLEWUARTEvent.eventBase.eventId = kEventFaceRecID_AddUserRemote;
             s_BLEWUARTEvent.eventBase.respond = HAL_InputDev_BleWuartQn9090_Respond;
 
@@ -544,32 +809,154 @@ static hal_ble_wuart_status_t SLN_BLEWUARTParseData(uint8_t *dataBuf, hal_header
                 s_BLEWUARTEvent.remoteReg.isReRegister = 1;
             }
 
+            /* the registration data is read in place, the packet is released when the vision algorithm responds */
             s_BLEWUARTEvent.remoteReg.dataLen = pHtUnit->pktLen;
-            s_BLEWUARTEvent.remoteReg.regData = pvPortMalloc(pHtUnit->pktLen);
+            s_BLEWUARTEvent.remoteReg.regData = (remote_reg_data_t *)dataBuf;
 
-            if (s_BLEWUARTEvent.remoteReg.regData != NULL)
+            uint8_t fromISR = __get_IPSR();
+            if (s_InputDev_BLEWUARTQN9090.cap.callback != NULL)
             {
-                memcpy(s_BLEWUARTEvent.remoteReg.regData, dataBuf, pHtUnit->pktLen);
+                s_BLEWUARTRegPacket = pPacket;
+                SLN_BLEWUARTPacketRetain(pPacket);
 
-                uint8_t fromISR = __get_IPSR();
-                if (s_InputDev_BLEWUARTQN9090.cap.callback != NULL)
-                {
-                    /* Build input_event */
-                    s_InputEvent.eventId                  = kInputEventID_Recv;
-                    s_InputEvent.size                     = sizeof(event_face_rec_t);
-                    s_InputEvent.u.inputData.data         = &s_BLEWUARTEvent;
-                    s_InputEvent.u.inputData.copy         = 0;
-                    s_InputEvent.u.inputData.receiverList = receiverList;
-                    s_InputDev_BLEWUARTQN9090.cap.callback(&s_InputDev_BLEWUARTQN9090, &s_InputEvent, fromISR);
-                }
+                /* Build input_event */
+                s_InputEvent.eventId                  = kInputEventID_Recv;
+                s_InputEvent.size                     = sizeof(event_face_rec_t);
+                s_InputEvent.u.inputData.data         = &s_BLEWUARTEvent;
+                s_InputEvent.u.inputData.copy         = 0;
+                s_InputEvent.u.inputData.receiverList = receiverList;
+                s_InputDev_BLEWUARTQN9090.cap.callback(&s_InputDev_BLEWUARTQN9090, &s_InputEvent, fromISR);
+            }
+        }
+        break;
+
+        case BATCH_REGISTRATION_REQ:
+        {
+            event_face_rec_t *pEvent;
+            uint8_t dispatch;
+            uint8_t slot;
+
+            if ((s_InputDev_BLEWUARTQN9090.cap.callback == NULL) ||
+                (s_BLEWUARTBatchCount == BLE_WUART_PACKET_POOL_COUNT))
+            {
+                LOGE("[ERROR]: BleWirelessUartTask BATCH_REGISTRATION_REQ can't be queued.\r\n");
+                SLN_BLEWUARTSendPacket(NULL, 0, BATCH_REGISTRATION_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+                break;
+            }
+
+            taskENTER_CRITICAL();
+            slot = (s_BLEWUARTBatchHead + s_BLEWUARTBatchCount) % BLE_WUART_PACKET_POOL_COUNT;
+            taskEXIT_CRITICAL();
+
+            /* the records are read in place, the packet is released when the vision algorithm responds */
+            pEvent                              = &s_BLEWUARTBatchEvents[slot];
+            pEvent->eventBase.eventId           = kEventFaceRecID_AddUsersRemote;
+            pEvent->eventBase.respond           = HAL_InputDev_BleWuartQn9090_Respond;
+            pEvent->remoteBatchReg.isReRegister = (pHtUnit->reserved & BLE_WUART_BATCH_REREGISTER) ? 1 : 0;
+            pEvent->remoteBatchReg.isLast       = (pHtUnit->reserved & BLE_WUART_BATCH_LAST) ? 1 : 0;
+            pEvent->remoteBatchReg.count        = BLE_WUART_BATCH_COUNT(pHtUnit->reserved);
+            pEvent->remoteBatchReg.dataLen      = pHtUnit->pktLen;
+            pEvent->remoteBatchReg.regData      = (remote_reg_data_t *)dataBuf;
+            s_BLEWUARTBatchPackets[slot]        = pPacket;
+            SLN_BLEWUARTPacketRetain(pPacket);
+
+            taskENTER_CRITICAL();
+            dispatch = (s_BLEWUARTBatchCount == 0);
+            s_BLEWUARTBatchCount++;
+            taskEXIT_CRITICAL();
+
+            if (dispatch)
+            {
+                SLN_BLEWUARTBatchDispatch();
+            }
+        }
+        break;
+
+        case DB_SUMMARY_REQ:
+        {
+            facedb_summary_t summary;
+
+            if (HAL_Facedb_GetSummary(&summary) == kFaceDBStatus_Success)
+            {
+                SLN_BLEWUARTSendPacket((uint8_t *)&summary, sizeof(facedb_summary_t), DB_SUMMARY_RES, pHtUnit->pktId,
+                                       BLE_WUART_ACK_SUCCESS);
+            }
+            else
+            {
+                SLN_BLEWUARTSendPacket(NULL, 0, DB_SUMMARY_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+            }
+        }
+        break;
+
+        case DB_CHANGES_REQ:
+        {
+            /* revision the host is in sync with and the summary buckets which differ */
+            uint32_t sinceRevision;
+            uint32_t bucketMask;
+            uint32_t size    = 0;
+            uint8_t *changes = NULL;
+
+            if (pHtUnit->pktLen != 2 * sizeof(uint32_t))
+            {
+                SLN_BLEWUARTSendPacket(NULL, 0, DB_CHANGES_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+                break;
+            }
+
+            memcpy(&sinceRevision, dataBuf, sizeof(uint32_t));
+            memcpy(&bucketMask, dataBuf + sizeof(uint32_t), sizeof(uint32_t));
+            if (HAL_Facedb_ExportChanges(sinceRevision, bucketMask, NULL, &size) == kFaceDBStatus_Success)
+            {
+                changes = FWK_MALLOC(size);
+            }
+
+            if ((changes != NULL) &&
+                (HAL_Facedb_ExportChanges(sinceRevision, bucketMask, changes, &size) == kFaceDBStatus_Success))
+            {
+                SLN_BLEWUARTSendPacket(changes, size, DB_CHANGES_RES, pHtUnit->pktId, BLE_WUART_ACK_SUCCESS);
             }
             else
             {
-                LOGE("[ERROR]: BleWirelessUartTask REGISTRATION_REQ malloc buffer error.\r\n");
+                LOGE("[ERROR]: BleWirelessUartTask DB_CHANGES_REQ failed to export %d bytes.\r\n", size);
+                SLN_BLEWUARTSendPacket(NULL, 0, DB_CHANGES_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+            }
+
+            if (changes != NULL)
+            {
+                FWK_FREE(changes);
             }
         }
         break;
 
+        case DB_APPLY_CHANGES_REQ:
+        {
+            uint32_t receiverList = 1 << kFWKTaskID_VisionAlgo;
+
+            if ((s_InputDev_BLEWUARTQN9090.cap.callback == NULL) || (s_BLEWUARTImportPacket != NULL))
+            {
+                LOGE("[ERROR]: BleWirelessUartTask DB_APPLY_CHANGES_REQ while changes are applied.\r\n");
+                SLN_BLEWUARTSendPacket(NULL, 0, DB_APPLY_CHANGES_RES, pHtUnit->pktId, BLE_WUART_ACK_ERROR);
+                break;
+            }
+
+            /* the changes are read in place, the packet is released when the vision algorithm responds */
+            s_BLEWUARTImportEvent.eventBase.eventId = kEventFaceRecID_ImportUsersRemote;
+            s_BLEWUARTImportEvent.eventBase.respond = HAL_InputDev_BleWuartQn9090_Respond;
+            s_BLEWUARTImportEvent.wuart.length      = pHtUnit->pktLen;
+            s_BLEWUARTImportEvent.wuart.data        = dataBuf;
+            s_BLEWUARTImportPacket                  = pPacket;
+            SLN_BLEWUARTPacketRetain(pPacket);
+
+            uint8_t fromISR = __get_IPSR();
+            /* Build input_event */
+            s_InputEvent.eventId                  = kInputEventID_Recv;
+            s_InputEvent.size                     = sizeof(event_face_rec_t);
+            s_InputEvent.u.inputData.data         = &s_BLEWUARTImportEvent;
+            s_InputEvent.u.inputData.copy         = 0;
+            s_InputEvent.u.inputData.receiverList = receiverList;
+            s_InputDev_BLEWUARTQN9090.cap.callback(&s_InputDev_BLEWUARTQN9090, &s_InputEvent, fromISR);
+        }
+        break;
+
         case DELETE_USER_REQ:
         {
             uint32_t receiverList = (1 << kFWKTaskID_VisionAlgo) | (1 << kFWKTaskID_Output);
@@ -732,9 +1119,41 @@ static hal_ble_wuart_status_t SLN_BLEWUARTParseData(uint8_t *dataBuf, hal_header
         }
         break;
 
+        case BULK_START_REQ:
+        {
+            SLN_BLEWUARTBulkStart(pHtUnit, dataBuf);
+        }
+        break;
+
+        case BULK_DATA_REQ:
+        {
+            SLN_BLEWUARTBulkData(pHtUnit, dataBuf);
+        }
+        break;
+
+        /* answer of the module to a link request, the reserved word is the link accepted */
+        case BRIDGE_CONTROL:
+        {
+            if (pHtUnit->reserved != 0)
+            {
+                SLN_BLEWUARTSetLink(pHtUnit->reserved);
+            }
+            else
+            {
+                LOGD("[BleWirelessUartTask]: BLE QN9090 kept the link at %d bps.", BLE_WUART_LINK_BAUD(s_BLEWUARTLink));
+            }
+        }
+        break;
+
         /* reserved for sync connection with qn9090 ble firmware. */
         case FIRMWARE_RESPONSE:
         {
+            /* a module in bridge mode offers a higher rate with its status */
+            if (pHtUnit->reserved != 0)
+            {
+                SLN_BLEWUARTRequestLink(pHtUnit->reserved);
+            }
+
             if (memcmp(dataBuf, BLE_WUART_READY, sizeof(BLE_WUART_READY) - 1) == 0)
             {
                 if (s_QN9090IsConnected == kHALBLEConnectionStatus_ScanningNG)
@@ -812,80 +1231,205 @@ static hal_ble_wuart_status_t SLN_BLEWUARTParseData(uint8_t *dataBuf, hal_header
     return status;
 }
 
-static void SLN_BLEWUARTMsgHandle(void *param)
+static hal_ble_wuart_packet_buf_t *SLN_BLEWUARTRxAcquire(void *param)
 {
-    LOGD("[BleWirelessUartTask] start.");
-
-    hal_ble_wuart_status_t status = kHALBLEWUARTStatus_PacketValid;
+    return SLN_BLEWUARTPacketAcquire();
+}
 
-    size_t n = 0;
+static void SLN_BLEWUARTRxRelease(void *param, hal_ble_wuart_packet_buf_t *pPacket)
+{
+    SLN_BLEWUARTPacketRelease(pPacket);
+}
 
+static void SLN_BLEWUARTRxEvent(void *param, hal_ble_wuart_rx_event_t event, const hal_header_transfer_unit_t *pHtUnit)
+{
     hal_ble_wuart_transfer_t *transfer = param;
 
-    /* press wakeup pin sync ble latest connection status. */
-    SLN_BLEWUARTPressWakePin();
-
-    LPUART_RTOS_Receive(&s_LpuartRTOSHandle, transfer->nibbleBuf, BLE_WUART_HEADER_LENGTH, &n);
-
-    while (1)
+    switch (event)
     {
-        switch (transfer->stage)
-        {
-            case kHALBLEWUARTPacket_Header:
-            {
-                status = SLN_BLEWUARTParseHeader(transfer->nibbleBuf, &s_HeaderTransferUnit);
-                LOGD("HEADER_PACKET: ");
-
-                if (status == kHALBLEWUARTStatus_Success)
-                {
-                    transfer->readOffset = 0;
-                    transfer->stage      = kHALBLEWUARTPacket_Data;
-                    transfer->packetBuf  = pvPortMalloc(s_HeaderTransferUnit.pktLen);
-                    if (transfer->packetBuf == NULL)
-                    {
-                    }
-
-                    transfer->packetLen = s_HeaderTransferUnit.pktLen;
-                    LPUART_RTOS_Receive(&s_LpuartRTOSHandle, transfer->packetBuf, transfer->packetLen, &n);
-                    LOGD("HEADER PACKET PARSE SUCCESSFUL[%d].", transfer->packetLen);
-                }
-                else
-                {
-                    LPUART_RTOS_Receive(&s_LpuartRTOSHandle, transfer->nibbleBuf, BLE_WUART_HEADER_LENGTH, &n);
-                    LOGD("HEADER PACKET PARSE FAILED[%d].", transfer->packetLen);
-                    LOGD_HEX(transfer->nibbleBuf, BLE_WUART_HEADER_LENGTH);
-                }
-            }
+        case kHALBLEWUARTRxEvent_Header:
+            LOGD("HEADER PACKET PARSE SUCCESSFUL[%d].", pHtUnit->pktLen);
+            s_BLEWUARTLinkErrors = 0;
             break;
 
-            case kHALBLEWUARTPacket_Data:
+        case kHALBLEWUARTRxEvent_HeaderError:
+            LOGD("HEADER PACKET PARSE FAILED.");
+            /* the module restarted at the default rate, resync the status with it */
+            if ((s_BLEWUARTLink != BLE_WUART_DEFAULT_BAUDRATE) &&
+                (++s_BLEWUARTLinkErrors >= BLE_WUART_LINK_MAX_ERRORS))
             {
-                status = SLN_BLEWUARTParseData(transfer->packetBuf, &s_HeaderTransferUnit);
-                LOGD("DATA_PACKET: ");
+                LOGE("[BleWirelessUartTask]: Link at %d bps lost.", BLE_WUART_LINK_BAUD(s_BLEWUARTLink));
+                HAL_BleWuartRx_Reset(&transfer->rx);
+                SLN_BLEWUARTPressWakePin();
+            }
+            break;
 
-                if (status == kHALBLEWUARTStatus_Success)
-                {
-                    LOGD("DATA PACKET PARSE SUCCESSFUL[%d].", transfer->packetLen);
-                }
-                else
-                {
-                    LOGD("DATA PACKET PARSE FAILED[%d].", transfer->packetLen);
-                    LOGD_HEX(transfer->packetBuf, s_HeaderTransferUnit.pktLen);
-                }
+        case kHALBLEWUARTRxEvent_PacketError:
+            LOGD("DATA PACKET PARSE FAILED[%d].", pHtUnit->pktLen);
+            break;
 
-                vPortFree(transfer->packetBuf);
-                memset(&s_HeaderTransferUnit, 0x00, sizeof(s_HeaderTransferUnit));
-                memset(transfer->nibbleBuf, 0x0, transfer->nibbleLen);
-                transfer->stage = kHALBLEWUARTPacket_Header;
+        case kHALBLEWUARTRxEvent_NoBuffer:
+            LOGE("[BleWirelessUartTask]: No buffer for the packet %d of %d bytes.", pHtUnit->pktId, pHtUnit->pktLen);
+            break;
 
-                /* prepare next count of data need received, it will block task.*/
-                LPUART_RTOS_Receive(&s_LpuartRTOSHandle, transfer->nibbleBuf, BLE_WUART_HEADER_LENGTH, &n);
-            }
+        default:
             break;
+    }
+}
 
-            default:
-                break;
+/* Parse and handle everything the dma wrote since the last call */
+static void SLN_BLEWUARTRxDrain(hal_ble_wuart_transfer_t *transfer)
+{
+    hal_ble_wuart_packet_buf_t *pPacket;
+    int32_t lost;
+    int32_t pending;
+    uint32_t remaining;
+    uint32_t writeOffset;
+    uint32_t count;
+
+    /* the current major loop count tells how far the dma is in the ring. The half events of the move to it are taken
+     * off, an event the interrupt has not counted yet is taken off ahead and evens out when it is. After an overrun
+     * the interrupt flag of the channel tells such an event */
+    taskENTER_CRITICAL();
+    remaining   = BLE_WUART_RX_DMA->TCD[BLE_WUART_RX_DMA_CHANNEL].CITER_ELINKNO & DMA_CITER_ELINKNO_CITER_MASK;
+    writeOffset = (BLE_WUART_RX_RING_SIZE - remaining) & (BLE_WUART_RX_RING_SIZE - 1);
+    pending     = (BLE_WUART_RX_DMA->INT >> BLE_WUART_RX_DMA_CHANNEL) & 1U;
+
+    lost = HAL_BleWuartRx_RingLost(BLE_WUART_RX_RING_SIZE, transfer->readOffset, writeOffset, transfer->halfEvents);
+    transfer->halfEvents = (lost > 0) ? -pending : lost;
+    taskEXIT_CRITICAL();
+
+    /* another driver initializing the eDMA clears all the channel requests */
+    if ((BLE_WUART_RX_DMA->ERQ & (1U << BLE_WUART_RX_DMA_CHANNEL)) == 0)
+    {
+        EDMA_StartTransfer(&s_BLEWUARTRxDmaHandle);
+        lost = 1;
+    }
+
+    /* the dma went around the ring since the last drain, a whole ring included, the bytes left are not the ones
+     * expected */
+    if (lost > 0)
+    {
+        transfer->rx.stats.overruns++;
+        LOGE("[BleWirelessUartTask]: Receive ring overrun %d.", transfer->rx.stats.overruns);
+        HAL_BleWuartRx_Reset(&transfer->rx);
+        transfer->readOffset = writeOffset;
+        return;
+    }
+
+    while (transfer->readOffset != writeOffset)
+    {
+        if (writeOffset > transfer->readOffset)
+        {
+            count = writeOffset - transfer->readOffset;
         }
+        else
+        {
+            count = BLE_WUART_RX_RING_SIZE - transfer->readOffset;
+        }
+
+        count = HAL_BleWuartRx_Feed(&transfer->rx, &transfer->ringBuf[transfer->readOffset], count, &pPacket);
+        transfer->rx.stats.bytes += count;
+        transfer->readOffset = (transfer->readOffset + count) & (BLE_WUART_RX_RING_SIZE - 1);
+
+        if (pPacket != NULL)
+        {
+            LOGD("DATA PACKET PARSE SUCCESSFUL[%d].", pPacket->header.pktLen);
+            SLN_BLEWUARTParseData(pPacket);
+            SLN_BLEWUARTPacketRelease(pPacket);
+        }
+    }
+}
+
+static void SLN_BLEWUARTRxDmaCallback(edma_handle_t *handle, void *param, bool transferDone, uint32_t tcds)
+{
+    hal_ble_wuart_transfer_t *transfer = param;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    transfer->halfEvents++;
+    if (transferDone)
+    {
+        /* the channel keeps running over the ring */
+        EDMA_ClearChannelStatusFlags(BLE_WUART_RX_DMA, BLE_WUART_RX_DMA_CHANNEL, kEDMA_DoneFlag);
+    }
+
+    vTaskNotifyGiveFromISR(s_BLEWUARTTaskHandle, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+/* The transactional driver keeps the transmit side, the receiver is moved to a dma channel looping over the ring */
+static void SLN_BLEWUARTRxStart(hal_ble_wuart_transfer_t *transfer)
+{
+    edma_transfer_config_t transferConfig;
+
+    LPUART_TransferStopRingBuffer(BLE_UART_BASE, &s_LpuartHandle);
+
+    /* initializing the eDMA again would stop the channels of the audio devices */
+    if ((BLE_WUART_RX_DMA->CR & DMA_CR_EMLM_MASK) == 0)
+    {
+        BOARD_InitEDMA();
+    }
+
+    DMAMUX_SetSource(BLE_WUART_RX_DMAMUX, BLE_WUART_RX_DMA_CHANNEL, BLE_WUART_RX_DMA_SOURCE);
+    DMAMUX_EnableChannel(BLE_WUART_RX_DMAMUX, BLE_WUART_RX_DMA_CHANNEL);
+    NVIC_SetPriority(BLE_WUART_RX_DMA_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY - 1);
+
+    EDMA_CreateHandle(&s_BLEWUARTRxDmaHandle, BLE_WUART_RX_DMA, BLE_WUART_RX_DMA_CHANNEL);
+    EDMA_SetCallback(&s_BLEWUARTRxDmaHandle, SLN_BLEWUARTRxDmaCallback, transfer);
+
+    EDMA_PrepareTransfer(&transferConfig, (void *)LPUART_GetDataRegisterAddress(BLE_UART_BASE), sizeof(uint8_t),
+                         transfer->ringBuf, sizeof(uint8_t), sizeof(uint8_t), BLE_WUART_RX_RING_SIZE,
+                         kEDMA_PeripheralToMemory);
+    EDMA_SetTransferConfig(BLE_WUART_RX_DMA, BLE_WUART_RX_DMA_CHANNEL, &transferConfig, NULL);
+
+    /* rewind to the start of the ring after the major loop and keep the request enabled */
+    BLE_WUART_RX_DMA->TCD[BLE_WUART_RX_DMA_CHANNEL].DLAST_SGA = (uint32_t)(-(int32_t)BLE_WUART_RX_RING_SIZE);
+    BLE_WUART_RX_DMA->TCD[BLE_WUART_RX_DMA_CHANNEL].CSR &= ~(uint16_t)DMA_CSR_DREQ_MASK;
+    EDMA_EnableChannelInterrupts(BLE_WUART_RX_DMA, BLE_WUART_RX_DMA_CHANNEL,
+                                 kEDMA_HalfInterruptEnable | kEDMA_MajorInterruptEnable);
+    EDMA_StartTransfer(&s_BLEWUARTRxDmaHandle);
+
+    /* idle line after two idle characters following a stop bit ends a burst */
+    LPUART_EnableRx(BLE_UART_BASE, false);
+    BLE_UART_BASE->CTRL =
+        (BLE_UART_BASE->CTRL & ~LPUART_CTRL_IDLECFG_MASK) | LPUART_CTRL_ILT_MASK | LPUART_CTRL_IDLECFG(1);
+    LPUART_EnableRxDMA(BLE_UART_BASE, true);
+    LPUART_EnableInterrupts(BLE_UART_BASE, kLPUART_IdleLineInterruptEnable);
+    LPUART_EnableRx(BLE_UART_BASE, true);
+}
+
+void BLE_UART_IRQHandler(void)
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    if ((LPUART_GetStatusFlags(BLE_UART_BASE) & kLPUART_IdleLineFlag) && (s_BLEWUARTTaskHandle != NULL))
+    {
+        /* cleared before the transactional driver sees it, it would stop the idle line interrupt */
+        LPUART_ClearStatusFlags(BLE_UART_BASE, kLPUART_IdleLineFlag);
+        vTaskNotifyGiveFromISR(s_BLEWUARTTaskHandle, &higherPriorityTaskWoken);
+    }
+
+    LPUART_TransferHandleIRQ(BLE_UART_BASE, &s_LpuartHandle);
+
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    SDK_ISR_EXIT_BARRIER;
+}
+
+static void SLN_BLEWUARTMsgHandle(void *param)
+{
+    LOGD("[BleWirelessUartTask] start.");
+
+    hal_ble_wuart_transfer_t *transfer = param;
+
+    SLN_BLEWUARTRxStart(transfer);
+
+    /* press wakeup pin sync ble latest connection status. */
+    SLN_BLEWUARTPressWakePin();
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        SLN_BLEWUARTRxDrain(transfer);
     }
 }
 
@@ -897,7 +1441,7 @@ static hal_input_status_t HAL_InputDev_BleWuartQn9090_Init(input_dev_t *dev, inp
 
     lpuart_rtos_config_t config = {
         .base        = BLE_UART_BASE,
-        .baudrate    = 115200,
+        .baudrate    = BLE_WUART_DEFAULT_BAUDRATE,
         .parity      = kLPUART_ParityDisabled,
         .stopbits    = kLPUART_OneStopBit,
         .buffer      = s_LpuartRingBuffer,
@@ -911,6 +1455,7 @@ static hal_input_status_t HAL_InputDev_BleWuartQn9090_Init(input_dev_t *dev, inp
     };
 
     BOARD_InitBleQn9090Resource(&config.srcclk);
+    s_BLEWUARTSrcClk = config.srcclk;
 
     NVIC_SetPriority(BLE_UART_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY - 1);
     NVIC_EnableIRQ(BLE_UART_IRQn);
@@ -935,17 +1480,15 @@ static hal_input_status_t HAL_InputDev_BleWuartQn9090_Start(const input_dev_t *d
 {
     hal_input_status_t status = kStatus_HAL_InputSuccess;
 
-    s_BLEWUARTTransfer.nibbleBuf  = s_BLEWUARTNibbleBuffer;
-    s_BLEWUARTTransfer.nibbleLen  = sizeof(s_BLEWUARTNibbleBuffer);
-    s_BLEWUARTTransfer.packetBuf  = NULL;
-    s_BLEWUARTTransfer.packetLen  = 0;
-    s_BLEWUARTTransfer.readOffset = 0;
-    s_BLEWUARTTransfer.stage      = kHALBLEWUARTPacket_Header;
+    memset(&s_BLEWUARTTransfer, 0, sizeof(s_BLEWUARTTransfer));
+    s_BLEWUARTTransfer.ringBuf = s_BLEWUARTRxRing;
+    HAL_BleWuartRx_Init(&s_BLEWUARTTransfer.rx, SLN_BLEWUARTRxAcquire, SLN_BLEWUARTRxRelease, SLN_BLEWUARTRxEvent,
+                        &s_BLEWUARTTransfer);
 
     s_BLEWUARTEvent.eventBase.respond = NULL;
 
     if (xTaskCreate(SLN_BLEWUARTMsgHandle, BLE_WUART_TASK_NAME, BLE_WUART_TASK_STACK, &s_BLEWUARTTransfer,
-                    BLE_WUART_TASK_PRIORITY, NULL) != pdPASS)
+                    BLE_WUART_TASK_PRIORITY, &s_BLEWUARTTaskHandle) != pdPASS)
     {
         LOGE("[BleWirelessUart] Task creation failed!.");
         while (1)
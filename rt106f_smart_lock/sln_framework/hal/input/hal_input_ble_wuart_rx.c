@@ -0,0 +1,295 @@
+/*
+ * Copyright 2022 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/*
+ * @brief receive parser of the qn9090 ble wireless uart implementation.
+ */
+
+#include <string.h>
+
+#include "hal_input_ble_wuart_rx.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+#define BLE_WUART_RX_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+static const uint8_t s_BleWuartRxMagic[] = {0x53, 0x79, 0x4c};
+
+static uint32_t s_BleWuartRxCrcTable[0x100];
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+static uint32_t _BleWuartRx_Crc32ForByte(uint32_t r)
+{
+    for (int j = 0; j < 8; ++j)
+    {
+        r = (r & 1 ? 0 : (uint32_t)0xEDB88320L) ^ r >> 1;
+    }
+
+    return r ^ (uint32_t)0xFF000000L;
+}
+
+/* The crc can be computed over several calls, the table is built once */
+void HAL_BleWuartRx_Crc32(const void *data, size_t numBytes, uint32_t *crc)
+{
+    if (!*s_BleWuartRxCrcTable)
+    {
+        for (size_t i = 0; i < 0x100; ++i)
+        {
+            s_BleWuartRxCrcTable[i] = _BleWuartRx_Crc32ForByte(i);
+        }
+    }
+
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        *crc = s_BleWuartRxCrcTable[(uint8_t)*crc ^ ((const uint8_t *)data)[i]] ^ *crc >> 8;
+    }
+}
+
+hal_ble_wuart_status_t HAL_BleWuartRx_ParseHeader(const uint8_t *headerBuf, hal_header_transfer_unit_t *pHtUnit)
+{
+    uint32_t crc_res = 0;
+
+    /* transfer magic */
+    if (memcmp(headerBuf, s_BleWuartRxMagic, sizeof(s_BleWuartRxMagic)) != 0)
+    {
+        return kHALBLEWUARTStatus_TUMagicError;
+    }
+    memcpy(pHtUnit->tuMagic, headerBuf, 3);
+
+    /* packet type */
+    pHtUnit->pktType = headerBuf[3];
+
+    /* packet length, id, crc, reserved and transfer unit crc */
+    memcpy(&pHtUnit->pktLen, headerBuf + 4, 4);
+    memcpy(&pHtUnit->pktId, headerBuf + 8, 4);
+    memcpy(&pHtUnit->pktCrc, headerBuf + 12, 4);
+    memcpy(&pHtUnit->reserved, headerBuf + 16, 4);
+    memcpy(&pHtUnit->tuCrc, headerBuf + 20, 4);
+
+    HAL_BleWuartRx_Crc32(headerBuf, BLE_WUART_HEADER_LENGTH - 4, &crc_res);
+    if (crc_res != pHtUnit->tuCrc)
+    {
+        return kHALBLEWUARTStatus_TUCRC32Error;
+    }
+
+    return kHALBLEWUARTStatus_Success;
+}
+
+void HAL_BleWuartRx_Init(hal_ble_wuart_rx_t *pRx,
+                         hal_ble_wuart_packet_buf_t *(*acquire)(void *param),
+                         void (*release)(void *param, hal_ble_wuart_packet_buf_t *pPacket),
+                         void (*event)(void *param, hal_ble_wuart_rx_event_t event,
+                                       const hal_header_transfer_unit_t *pHtUnit),
+                         void *param)
+{
+    memset(pRx, 0, sizeof(*pRx));
+    pRx->stage   = kHALBLEWUARTPacket_Header;
+    pRx->acquire = acquire;
+    pRx->release = release;
+    pRx->event   = event;
+    pRx->param   = param;
+}
+
+static void _BleWuartRx_Event(hal_ble_wuart_rx_t *pRx,
+                              hal_ble_wuart_rx_event_t event,
+                              const hal_header_transfer_unit_t *pHtUnit)
+{
+    if (pRx->event != NULL)
+    {
+        pRx->event(pRx->param, event, pHtUnit);
+    }
+}
+
+/* Start looking for the next transfer unit, keeping the bytes of the current one that may start it */
+static void _BleWuartRx_Resync(hal_ble_wuart_rx_t *pRx)
+{
+    uint32_t offset;
+
+    for (offset = 1; offset < pRx->headerLen; offset++)
+    {
+        uint32_t count = BLE_WUART_RX_MIN(sizeof(s_BleWuartRxMagic), pRx->headerLen - offset);
+
+        if (memcmp(&pRx->header[offset], s_BleWuartRxMagic, count) == 0)
+        {
+            break;
+        }
+    }
+
+    pRx->stats.noiseBytes += offset;
+    pRx->headerLen -= offset;
+    memmove(pRx->header, &pRx->header[offset], pRx->headerLen);
+}
+
+void HAL_BleWuartRx_Reset(hal_ble_wuart_rx_t *pRx)
+{
+    if (pRx->packet != NULL)
+    {
+        pRx->release(pRx->param, pRx->packet);
+    }
+    pRx->packet     = NULL;
+    pRx->headerLen  = 0;
+    pRx->packetLen  = 0;
+    pRx->discardLen = 0;
+    pRx->stage      = kHALBLEWUARTPacket_Header;
+}
+
+static hal_ble_wuart_packet_buf_t *_BleWuartRx_PacketDone(hal_ble_wuart_rx_t *pRx)
+{
+    hal_ble_wuart_packet_buf_t *pPacket = pRx->packet;
+
+    pRx->packet = NULL;
+    pRx->stage  = kHALBLEWUARTPacket_Header;
+
+    if (pRx->packetCrc != pPacket->header.pktCrc)
+    {
+        pRx->stats.packetErrors++;
+        _BleWuartRx_Event(pRx, kHALBLEWUARTRxEvent_PacketError, &pPacket->header);
+        pRx->release(pRx->param, pPacket);
+        return NULL;
+    }
+
+    pRx->stats.packets++;
+    return pPacket;
+}
+
+static hal_ble_wuart_packet_buf_t *_BleWuartRx_HeaderDone(hal_ble_wuart_rx_t *pRx)
+{
+    hal_header_transfer_unit_t htUnit;
+
+    if (HAL_BleWuartRx_ParseHeader(pRx->header, &htUnit) != kHALBLEWUARTStatus_Success)
+    {
+        pRx->stats.headerErrors++;
+        /* the owner may reset the parser, the bytes kept are dropped then */
+        _BleWuartRx_Resync(pRx);
+        _BleWuartRx_Event(pRx, kHALBLEWUARTRxEvent_HeaderError, NULL);
+        return NULL;
+    }
+
+    _BleWuartRx_Event(pRx, kHALBLEWUARTRxEvent_Header, &htUnit);
+    pRx->headerLen = 0;
+    pRx->packet    = NULL;
+    if (htUnit.pktLen <= BLE_WUART_PACKET_MAX_LEN)
+    {
+        pRx->packet = pRx->acquire(pRx->param);
+    }
+
+    if (pRx->packet == NULL)
+    {
+        pRx->stats.noBuffer++;
+        _BleWuartRx_Event(pRx, kHALBLEWUARTRxEvent_NoBuffer, &htUnit);
+        pRx->discardLen = htUnit.pktLen;
+        pRx->stage      = (htUnit.pktLen > 0) ? kHALBLEWUARTPacket_Discard : kHALBLEWUARTPacket_Header;
+        return NULL;
+    }
+
+    pRx->packet->header = htUnit;
+    pRx->packetLen      = 0;
+    pRx->packetCrc      = 0;
+    pRx->stage          = kHALBLEWUARTPacket_Data;
+
+    if (htUnit.pktLen == 0)
+    {
+        return _BleWuartRx_PacketDone(pRx);
+    }
+
+    return NULL;
+}
+
+uint32_t HAL_BleWuartRx_Feed(hal_ble_wuart_rx_t *pRx,
+                             const uint8_t *data,
+                             uint32_t len,
+                             hal_ble_wuart_packet_buf_t **ppPacket)
+{
+    uint32_t used = 0;
+    uint32_t count;
+
+    *ppPacket = NULL;
+
+    while ((used < len) && (*ppPacket == NULL))
+    {
+        switch (pRx->stage)
+        {
+            case kHALBLEWUARTPacket_Header:
+            {
+                uint8_t byte = data[used++];
+
+                /* the magic bytes are all different, a mismatch can only restart on the first one */
+                if ((pRx->headerLen < sizeof(s_BleWuartRxMagic)) && (byte != s_BleWuartRxMagic[pRx->headerLen]))
+                {
+                    pRx->stats.noiseBytes += pRx->headerLen;
+                    pRx->headerLen = 0;
+                    if (byte != s_BleWuartRxMagic[0])
+                    {
+                        pRx->stats.noiseBytes++;
+                        break;
+                    }
+                }
+
+                pRx->header[pRx->headerLen++] = byte;
+                if (pRx->headerLen == BLE_WUART_HEADER_LENGTH)
+                {
+                    *ppPacket = _BleWuartRx_HeaderDone(pRx);
+                }
+            }
+            break;
+
+            case kHALBLEWUARTPacket_Data:
+            {
+                hal_ble_wuart_packet_buf_t *pPacket = pRx->packet;
+
+                count = BLE_WUART_RX_MIN(len - used, pPacket->header.pktLen - pRx->packetLen);
+                memcpy(&pPacket->data[pRx->packetLen], &data[used], count);
+                HAL_BleWuartRx_Crc32(&data[used], count, &pRx->packetCrc);
+                pRx->packetLen += count;
+                used += count;
+
+                if (pRx->packetLen == pPacket->header.pktLen)
+                {
+                    *ppPacket = _BleWuartRx_PacketDone(pRx);
+                }
+            }
+            break;
+
+            case kHALBLEWUARTPacket_Discard:
+            {
+                count = BLE_WUART_RX_MIN(len - used, pRx->discardLen);
+                pRx->discardLen -= count;
+                used += count;
+
+                if (pRx->discardLen == 0)
+                {
+                    pRx->stage = kHALBLEWUARTPacket_Header;
+                }
+            }
+            break;
+
+            default:
+                HAL_BleWuartRx_Reset(pRx);
+                break;
+        }
+    }
+
+    return used;
+}
+
+int32_t HAL_BleWuartRx_RingLost(uint32_t ringSize, uint32_t readOffset, uint32_t writeOffset, int32_t halfEvents)
+{
+    const uint32_t half = ringSize / 2;
+    /* the bytes the dma wrote since the last read, unless it went around the ring */
+    uint32_t written = (writeOffset - readOffset) & (ringSize - 1);
+    /* the halves it completed writing them, the ring was read up to where the dma was */
+    int32_t crossed = (int32_t)((readOffset + written) / half - readOffset / half);
+
+    /* a whole ring written brings the dma back to the offset it was read at, two halves more than the move */
+    return halfEvents - crossed;
+}
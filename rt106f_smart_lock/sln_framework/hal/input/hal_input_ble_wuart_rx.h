@@ -0,0 +1,171 @@
+/*
+ * Copyright 2022 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/*
+ * @brief receive parser of the qn9090 ble wireless uart: transfer units and packet bodies out of a byte stream.
+ *
+ * A transfer unit is BLE_WUART_HEADER_LENGTH bytes, little endian:
+ *
+ *   0  magic 0x53 0x79 0x4c      8  packet id, u32            16 reserved, u32
+ *   3  packet type               12 packet crc, u32           20 crc of the bytes 0 to 19, u32
+ *   4  packet length, u32
+ *
+ * followed by the packet body. The parser skips the noise before a magic, resyncs on the next magic inside a transfer
+ * unit with a wrong crc and receives the body into a buffer of the caller. It only depends on the C library, it
+ * builds on a host as is.
+ */
+
+#ifndef _HAL_INPUT_BLE_WUART_RX_H_
+#define _HAL_INPUT_BLE_WUART_RX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLE_WUART_HEADER_LENGTH 24
+
+/* Largest packet body, a remote registration carries a face feature and a name */
+#ifndef BLE_WUART_PACKET_MAX_LEN
+#define BLE_WUART_PACKET_MAX_LEN 4096
+#endif /* BLE_WUART_PACKET_MAX_LEN */
+
+typedef enum _hal_ble_wuart_status_t
+{
+    kHALBLEWUARTStatus_Success,
+    kHALBLEWUARTStatus_TUMagicError,
+    kHALBLEWUARTStatus_TUCRC32Error,
+    kHALBLEWUARTStatus_PacketCRC32Error,
+    kHALBLEWUARTStatus_PacketValid,
+    kHALBLEWUARTStatus_PacketError,
+    kHALBLEWUARTStatus_PacketShort,
+} hal_ble_wuart_status_t;
+
+typedef enum _hal_ble_wuart_packet_t
+{
+    kHALBLEWUARTPacket_Header,  /* looking for the magic and collecting the transfer unit */
+    kHALBLEWUARTPacket_Data,    /* copying the packet body and computing its crc */
+    kHALBLEWUARTPacket_Discard, /* skipping a packet body there is no buffer for */
+} hal_ble_wuart_packet_t;
+
+/* What the parser tells its owner about */
+typedef enum _hal_ble_wuart_rx_event_t
+{
+    kHALBLEWUARTRxEvent_Header,      /* valid transfer unit */
+    kHALBLEWUARTRxEvent_HeaderError, /* transfer unit with a wrong crc, the parser resyncs */
+    kHALBLEWUARTRxEvent_PacketError, /* packet body with a wrong crc, the packet is dropped */
+    kHALBLEWUARTRxEvent_NoBuffer,    /* no buffer or the packet is too long, its body is skipped */
+} hal_ble_wuart_rx_event_t;
+
+typedef struct _hal_header_transfer_unit_t
+{
+    uint8_t tuMagic[3];
+    uint8_t pktType;
+    uint32_t pktLen;
+    uint32_t pktId;
+    uint32_t pktCrc;
+    uint32_t tuCrc;
+    uint32_t reserved;
+} hal_header_transfer_unit_t;
+
+typedef struct _hal_ble_wuart_packet_buf_t
+{
+    hal_header_transfer_unit_t header;
+    /* the receive task and the consumers holding the packet */
+    uint8_t refCount;
+    uint8_t data[BLE_WUART_PACKET_MAX_LEN] __attribute__((aligned(4)));
+} hal_ble_wuart_packet_buf_t;
+
+typedef struct _hal_ble_wuart_rx_stats_t
+{
+    uint32_t bytes;        /* bytes taken from the ring */
+    uint32_t packets;      /* packets with a valid crc */
+    uint32_t noiseBytes;   /* bytes skipped while looking for the magic */
+    uint32_t headerErrors; /* transfer units with a wrong crc */
+    uint32_t packetErrors; /* packet bodies with a wrong crc */
+    uint32_t noBuffer;     /* packets skipped as the pool was empty or the packet too long */
+    uint32_t overruns;     /* the dma wrapped the ring before it was read */
+} hal_ble_wuart_rx_stats_t;
+
+typedef struct _hal_ble_wuart_rx_t
+{
+    uint8_t header[BLE_WUART_HEADER_LENGTH] __attribute__((aligned(4)));
+    uint32_t headerLen;
+    hal_ble_wuart_packet_buf_t *packet;
+    uint32_t packetLen;
+    uint32_t packetCrc;
+    uint32_t discardLen;
+    uint8_t stage;
+    hal_ble_wuart_rx_stats_t stats;
+    /* packet buffers of the owner, acquire returns NULL when there is none */
+    hal_ble_wuart_packet_buf_t *(*acquire)(void *param);
+    void (*release)(void *param, hal_ble_wuart_packet_buf_t *pPacket);
+    /* optional */
+    void (*event)(void *param, hal_ble_wuart_rx_event_t event, const hal_header_transfer_unit_t *pHtUnit);
+    void *param;
+} hal_ble_wuart_rx_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Update a crc32 with more data, start from 0
+ */
+void HAL_BleWuartRx_Crc32(const void *data, size_t numBytes, uint32_t *crc);
+
+/**
+ * @brief Parse a transfer unit and check its crc
+ * @param headerBuf BLE_WUART_HEADER_LENGTH bytes
+ */
+hal_ble_wuart_status_t HAL_BleWuartRx_ParseHeader(const uint8_t *headerBuf, hal_header_transfer_unit_t *pHtUnit);
+
+/**
+ * @brief Init a parser, it looks for a transfer unit
+ * @param acquire Returns a free packet buffer, NULL if there is none
+ * @param release Gives back a buffer acquire returned
+ * @param event Called on each transfer unit and on the errors, can be NULL
+ */
+void HAL_BleWuartRx_Init(hal_ble_wuart_rx_t *pRx,
+                         hal_ble_wuart_packet_buf_t *(*acquire)(void *param),
+                         void (*release)(void *param, hal_ble_wuart_packet_buf_t *pPacket),
+                         void (*event)(void *param, hal_ble_wuart_rx_event_t event,
+                                       const hal_header_transfer_unit_t *pHtUnit),
+                         void *param);
+
+/**
+ * @brief Drop the packet being received, the parser looks for a new transfer unit
+ */
+void HAL_BleWuartRx_Reset(hal_ble_wuart_rx_t *pRx);
+
+/**
+ * @brief Parse received bytes, it stops after a complete packet
+ * @param ppPacket Set to the packet with a valid crc, NULL if none is complete. The caller releases it
+ * @return uint32_t The bytes used
+ */
+uint32_t HAL_BleWuartRx_Feed(hal_ble_wuart_rx_t *pRx,
+                             const uint8_t *data,
+                             uint32_t len,
+                             hal_ble_wuart_packet_buf_t **ppPacket);
+
+/**
+ * @brief Tell if a dma looping over a ring wrote more than the ring since it was last read
+ * @param ringSize Power of two, the dma counts a half event at each half of the ring
+ * @param readOffset Offset the ring was read up to, where the dma was at the last read
+ * @param writeOffset Offset the dma is at
+ * @param halfEvents Half events counted since the last read
+ * @return int32_t The half events counted that the move from readOffset to writeOffset doesn't explain, above 0 if
+ * bytes were lost. Below 0 when the events of the move are still to come, they are then counted at the next read
+ */
+int32_t HAL_BleWuartRx_RingLost(uint32_t ringSize, uint32_t readOffset, uint32_t writeOffset, int32_t halfEvents);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* _HAL_INPUT_BLE_WUART_RX_H_ */
@@ -21,6 +21,7 @@
 #include "fwk_platform.h"
 #include "fwk_log.h"
 #include "fwk_graphics.h"
+#include "fwk_memory.h"
 
 #define PXP_DEV PXP
 
@@ -54,17 +55,6 @@ typedef struct _gfx_pxp_handle
 static gfx_pxp_handle_t s_GfxPxpHandle;
 static gfx_surface_t s_SurfGray888x;
 
-// dynamic allocate temporary buffer once, not free until program ends
-static char *ptmp_buffer   = NULL;
-static int tmp_buffer_size = 0;
-
-static int HAL_GfxDev_Pxp_ComposeSurfaceAdaptForScaleAndPsRotate(const gfx_surface_t *pSrc,
-                                                                 const gfx_surface_t *pDst,
-                                                                 gfx_surface_t *pSrc_adapt);
-static int HAL_GfxDev_Pxp_BlitSurfaceAdaptForScaleAndObRotate(const gfx_surface_t *pSrc,
-                                                              const gfx_surface_t *pDst,
-                                                              gfx_surface_t *pSrc_adapt);
-
 void PXP_IRQHandler(void)
 {
     if (s_GfxPxpHandle.semaphore != NULL)
@@ -140,6 +130,31 @@ static int _HAL_GfxDev_Pxp_Unlock()
     return error;
 }
 
+static uint32_t _HAL_GfxDev_Pxp_SurfaceSize(const gfx_surface_t *pSurface)
+{
+    /* the width and height of a rotated surface are swapped, cover the longest side */
+    int lines = (pSurface->height > pSurface->width) ? pSurface->height : pSurface->width;
+    return lines * pSurface->pitch;
+}
+
+/* the PXP reads and writes the memory behind the data cache, the surfaces can be in a cached region */
+static void _HAL_GfxDev_Pxp_SyncCache(const gfx_surface_t *pSrc,
+                                      const gfx_surface_t *pOverlay,
+                                      const gfx_surface_t *pDst,
+                                      bool done)
+{
+    if (!done)
+    {
+        FWK_Memory_CleanCache(pSrc->buf, _HAL_GfxDev_Pxp_SurfaceSize(pSrc));
+        if (pOverlay != NULL)
+        {
+            FWK_Memory_CleanCache(pOverlay->buf, _HAL_GfxDev_Pxp_SurfaceSize(pOverlay));
+        }
+    }
+
+    FWK_Memory_CleanInvalidateCache(pDst->buf, _HAL_GfxDev_Pxp_SurfaceSize(pDst));
+}
+
 int HAL_GfxDev_Pxp_Init(const gfx_dev_t *dev, void *param)
 {
     int error = 0;
@@ -471,6 +486,7 @@ static int HAL_GfxDev_Pxp_BuildGray888XFromGray16(gfx_surface_t *pSrc, gfx_surfa
         /* need to re-allocate the buffer */
         if (s_SurfGray888x.buf != NULL)
         {
+            FWK_Memory_Untrack(s_SurfGray888x.buf);
             FWK_FREE(s_SurfGray888x.buf);
         }
 
@@ -486,6 +502,8 @@ static int HAL_GfxDev_Pxp_BuildGray888XFromGray16(gfx_surface_t *pSrc, gfx_surfa
             error = -1;
             return error;
         }
+        FWK_Memory_Track(kFWKMemRegion_SdramCached, kFWKMemOwner_Graphics, s_SurfGray888x.buf,
+                         s_SurfGray888x.height * s_SurfGray888x.pitch, "pxp gray888x surface");
     }
 
     s_SurfGray888x.left   = pSrc->left;
@@ -558,6 +576,7 @@ static int HAL_GfxDev_Pxp_BuildGray888XFromDepth16(gfx_surface_t *pSrc, gfx_surf
         /* need to re-allocate the buffer */
         if (s_SurfGray888x.buf != NULL)
         {
+            FWK_Memory_Untrack(s_SurfGray888x.buf);
             FWK_FREE(s_SurfGray888x.buf);
         }
 
@@ -573,6 +592,8 @@ static int HAL_GfxDev_Pxp_BuildGray888XFromDepth16(gfx_surface_t *pSrc, gfx_surf
             error = -1;
             return error;
         }
+        FWK_Memory_Track(kFWKMemRegion_SdramCached, kFWKMemOwner_Graphics, s_SurfGray888x.buf,
+                         s_SurfGray888x.height * s_SurfGray888x.pitch, "pxp gray888x surface");
     }
 
     s_SurfGray888x.left   = pSrc->left;
@@ -630,49 +651,71 @@ static int HAL_GfxDev_Pxp_YUYV1P422ToYUV420P(gfx_surface_t *pSrc, gfx_surface_t
     return 0;
 }
 
-static int HAL_GfxDev_Pxp_BlitSurfaceAdaptForScaleAndObRotate(const gfx_surface_t *pSrc,
-                                                              const gfx_surface_t *pDst,
-                                                              gfx_surface_t *pSrc_adapt)
+static void HAL_GfxDev_Pxp_SwapSurface(gfx_surface_t *pSurface)
 {
-    int error = 0;
+    int tmp          = pSurface->height;
+    pSurface->height = pSurface->width;
+    pSurface->width  = tmp;
+    tmp              = pSurface->left;
+    pSurface->left   = pSurface->top;
+    pSurface->top    = tmp;
+    tmp              = pSurface->right;
+    pSurface->right  = pSurface->bottom;
+    pSurface->bottom = tmp;
+}
 
-    if (ptmp_buffer == NULL)
+/* the PXP can not scale and rotate by 90/270 at the same time, the plan scales and rotates strips of the source
+ * through its OCRAM strip buffer, each strip pass either scales or rotates */
+static int HAL_GfxDev_Pxp_ScaleAndRotateInStrips(gfx_surface_t *pSrc,
+                                                 gfx_surface_t *pOverlay,
+                                                 gfx_surface_t *pDst,
+                                                 gfx_rotate_config_t *pRotate,
+                                                 flip_mode_t flip)
+{
+    int error               = 0;
+    gfx_surface_t src       = *pSrc;
+    gfx_surface_t dst       = *pDst;
+    gfx_surface_t *pPlanSrc = &src;
+    gfx_plan_t plan;
+
+    /* the plan takes both surfaces in their buffer orientation */
+    if (pRotate->target == kGFXRotate_SRCSurface)
     {
-        tmp_buffer_size = pDst->pitch * pDst->width;
-        ptmp_buffer     = FWK_MALLOC(tmp_buffer_size);
+        HAL_GfxDev_Pxp_SwapSurface(&src);
     }
     else
     {
-        if (tmp_buffer_size < (pDst->pitch * pDst->width))
-        {
-            FWK_FREE(ptmp_buffer);
-            tmp_buffer_size = pDst->pitch * pDst->width;
-            ptmp_buffer     = FWK_MALLOC(tmp_buffer_size);
-        }
+        HAL_GfxDev_Pxp_SwapSurface(&dst);
     }
-    if (ptmp_buffer == NULL)
+
+    if (src.format == kPixelFormat_Gray16)
     {
-        LOGE("Cannot allocate memory for temporary buffer");
+        error = HAL_GfxDev_Pxp_BuildGray888XFromGray16(&src, &pPlanSrc);
+    }
+    else if (src.format == kPixelFormat_Depth16)
+    {
+        error = HAL_GfxDev_Pxp_BuildGray888XFromDepth16(&src, &pPlanSrc);
+    }
+
+    if (error)
+    {
+        LOGE("Failed to build GRAY888X surface");
+        return error;
+    }
+
+    error = gfx_plan(&plan, pPlanSrc, pRotate->degree, flip, &dst, kCWRotateDegree_0, pOverlay);
+    if (error)
+    {
+        return error;
+    }
+
+    if (plan.passes != 2)
+    {
+        LOGE("PXP:scale + rotate of format %d to %d is unsupported", pPlanSrc->format, dst.format);
         return -1;
     }
 
-    pSrc_adapt->height   = pDst->height;
-    pSrc_adapt->width    = pDst->width;
-    pSrc_adapt->left     = pDst->left;
-    pSrc_adapt->top      = pDst->top;
-    pSrc_adapt->right    = pDst->right;
-    pSrc_adapt->bottom   = pDst->bottom;
-    pSrc_adapt->pitch    = pDst->pitch * pDst->width / pDst->height;
-    pSrc_adapt->format   = pDst->format;
-    pSrc_adapt->swapByte = 0;
-    pSrc_adapt->buf      = ptmp_buffer;
-    pSrc_adapt->lock     = NULL;
-
-    gfx_rotate_config_t rotate;
-    rotate.target = kGFXRotate_SRCSurface;
-    rotate.degree = kCWRotateDegree_0;
-    error         = gfx_blit(pSrc, pSrc_adapt, &rotate, kFlipMode_None);
-    return error;
+    return gfx_plan_run(&plan);
 }
 
 /*
@@ -727,21 +770,10 @@ int HAL_GfxDev_Pxp_Blit(
     {
         if ((pRotate->target == kGFXRotate_DSTSurface) || (flip != kFlipMode_None))
         {
-            // LOGE("PXP:scale + dst rotate with overlay is currently unsupported!!");
             // hotfix for silicon bug: PXP can not do OB rotate and scale at the same time
             // which would cause several vertical garbage lines on the left
-            // split to two steps for this case: first scale and then rotate
-
-            // first scale
-            gfx_surface_t src_adjust;
-            error = HAL_GfxDev_Pxp_BlitSurfaceAdaptForScaleAndObRotate(pSrc, pDst, &src_adjust);
-            if (error != 0)
-            {
-                LOGE("HAL_GfxDev_Pxp_BlitSurfaceAdaptForScaleAndObRotate failed");
-                return -1;
-            }
-            // then rotate
-            pSrc = &src_adjust;
+            // split to two steps for this case, scale and then rotate strip by strip
+            return HAL_GfxDev_Pxp_ScaleAndRotateInStrips(pSrc, NULL, pDst, pRotate, flip);
         }
 
         if (pRotate->target == kGFXRotate_SRCSurface)
@@ -871,11 +903,15 @@ int HAL_GfxDev_Pxp_Blit(
         PXP_EnableCsc1(PXP_DEV, false);
     }
 
+    _HAL_GfxDev_Pxp_SyncCache(pSrc, NULL, pDst, false);
+
     // start the pxp operation
     PXP_Start(PXP_DEV);
 
     xSemaphoreTake(s_GfxPxpHandle.semaphore, portMAX_DELAY);
 
+    _HAL_GfxDev_Pxp_SyncCache(pSrc, NULL, pDst, true);
+
     _HAL_GfxDev_Pxp_Unlock();
 
     return error;
@@ -1083,11 +1119,15 @@ static int HAL_GfxDev_Pxp_ComposeInternal(const gfx_dev_t *dev,
         xSemaphoreTake(pOverlay->lock, portMAX_DELAY);
     }
 
+    _HAL_GfxDev_Pxp_SyncCache(pSrc, pOverlay, pDst, false);
+
     // start the pxp operation
     PXP_Start(PXP_DEV);
 
     xSemaphoreTake(s_GfxPxpHandle.semaphore, portMAX_DELAY);
 
+    _HAL_GfxDev_Pxp_SyncCache(pSrc, pOverlay, pDst, true);
+
     // unlock overlay surface to avoid conflict with ui drawing on overlay surface
     if (pOverlay->lock)
     {
@@ -1099,71 +1139,6 @@ static int HAL_GfxDev_Pxp_ComposeInternal(const gfx_dev_t *dev,
     return error;
 }
 
-static int HAL_GfxDev_Pxp_ComposeSurfaceAdaptForScaleAndPsRotate(const gfx_surface_t *pSrc,
-                                                                 const gfx_surface_t *pDst,
-                                                                 gfx_surface_t *pSrc_adapt)
-{
-    int error = 0;
-    if (ptmp_buffer == NULL)
-    {
-        tmp_buffer_size = pDst->pitch * pDst->height;
-        ptmp_buffer     = FWK_MALLOC(tmp_buffer_size);
-    }
-    else
-    {
-        if (tmp_buffer_size < (pDst->pitch * pDst->height))
-        {
-            FWK_FREE(ptmp_buffer);
-            tmp_buffer_size = pDst->pitch * pDst->height;
-            ptmp_buffer     = FWK_MALLOC(tmp_buffer_size);
-        }
-    }
-    if (ptmp_buffer == NULL)
-    {
-        LOGE("Cannot allocate memory for temporary buffer");
-        return -1;
-    }
-    // scale
-    gfx_surface_t src_surface;
-    src_surface.height   = pSrc->width;
-    src_surface.width    = pSrc->height;
-    src_surface.left     = pSrc->top;
-    src_surface.top      = pSrc->left;
-    src_surface.right    = pSrc->bottom;
-    src_surface.bottom   = pSrc->right;
-    src_surface.pitch    = pSrc->pitch;
-    src_surface.format   = pSrc->format;
-    src_surface.swapByte = pSrc->swapByte;
-    src_surface.buf      = pSrc->buf;
-    src_surface.lock     = NULL;
-
-    pSrc_adapt->height   = pDst->width;
-    pSrc_adapt->width    = pDst->height;
-    pSrc_adapt->left     = pDst->top;
-    pSrc_adapt->top      = pDst->left;
-    pSrc_adapt->right    = pDst->bottom;
-    pSrc_adapt->bottom   = pDst->right;
-    pSrc_adapt->pitch    = pDst->pitch * pDst->height / pDst->width;
-    pSrc_adapt->format   = pDst->format;
-    pSrc_adapt->swapByte = 0;
-    pSrc_adapt->buf      = ptmp_buffer;
-    pSrc_adapt->lock     = NULL;
-
-    gfx_rotate_config_t rotate;
-    rotate.target = kGFXRotate_SRCSurface;
-    rotate.degree = kCWRotateDegree_0;
-    error         = gfx_blit(&src_surface, pSrc_adapt, &rotate, kFlipMode_None);
-
-    // prepare for rotate
-    pSrc_adapt->height = pDst->height;
-    pSrc_adapt->width  = pDst->width;
-    pSrc_adapt->left   = pDst->left;
-    pSrc_adapt->top    = pDst->top;
-    pSrc_adapt->right  = pDst->right;
-    pSrc_adapt->bottom = pDst->bottom;
-
-    return error;
-}
 __attribute__((weak)) int HAL_GfxDev_Pxp_DrawText(const gfx_dev_t *dev,
         gfx_surface_t *pOverlay,
         const int x,
@@ -1189,44 +1164,12 @@ int HAL_GfxDev_Pxp_Compose(const gfx_dev_t *dev,
 
     // hotfix for silicon bug: PXP can not do PS/OutputBuffer rotate and scale at the same time
     // which would cause several vertical garbage lines on the left
-    // split to two steps for this case: first scale and then rotate
+    // split to two steps for this case, scale and then rotate strip by strip
     if ((((pSrc->bottom - pSrc->top + 1) != (pDst->bottom - pDst->top + 1)) ||
          ((pSrc->right - pSrc->left + 1) != (pDst->right - pDst->left + 1))) &&
         ((pRotate->degree == kCWRotateDegree_90) || (pRotate->degree == kCWRotateDegree_270)))
     {
-        gfx_surface_t src_adjust;
-
-        memcpy(&src_adjust, pSrc, sizeof(gfx_surface_t));
-
-        if ((pRotate->target == kGFXRotate_DSTSurface) || (flip != kFlipMode_None))
-        {
-            // LOGE("PXP:scale + dst rotate with overlay is currently unsupported");
-            // hotfix for silicon bug: PXP can not do OB rotate and scale at the same time
-            // which would cause several vertical garbage lines on the left
-            // split to two steps for this case: first scale and then rotate
-
-            // first scale
-            error = HAL_GfxDev_Pxp_BlitSurfaceAdaptForScaleAndObRotate(pSrc, pDst, &src_adjust);
-            if (error != 0)
-            {
-                LOGE("HAL_GfxDev_Pxp_BlitSurfaceAdaptForScaleAndObRotate failed");
-                return -1;
-            }
-            // then rotate
-            pSrc = &src_adjust;
-        }
-
-        if (pRotate->target == kGFXRotate_SRCSurface)
-        {
-            error = HAL_GfxDev_Pxp_ComposeSurfaceAdaptForScaleAndPsRotate(pSrc, pDst, &src_adjust);
-            if (error != 0)
-            {
-                LOGE("HAL_GfxDev_Pxp_ComposeSurfaceAdaptForScaleAndPsRotate failed");
-                return -1;
-            }
-
-            pSrc = &src_adjust;
-        }
+        return HAL_GfxDev_Pxp_ScaleAndRotateInStrips(pSrc, pOverlay, pDst, pRotate, flip);
     }
 
     /* handle the GRAY16 source surface as the PXP didn't support this format */
@@ -334,6 +334,33 @@ hal_lpm_status_t HAL_LpmDev_Unlock(const lpm_dev_t *dev)
     return kStatus_HAL_LpmSuccess;
 }
 
+/* The SNVS secure real time counter runs at 32768 Hz from the SNVS domain, which stays powered in SNVS mode */
+uint32_t HAL_LpmDev_GetClock(const lpm_dev_t *dev)
+{
+    uint32_t msb;
+    uint32_t lsb;
+
+    if ((SNVS->LPCR & SNVS_LPCR_SRTC_ENV_MASK) == 0)
+    {
+        /* first power up of the SNVS domain, start at 1 s as 0 means no clock */
+        SNVS->LPSRTCMR = 0;
+        SNVS->LPSRTCLR = 1U << 15;
+        SNVS->LPCR |= SNVS_LPCR_SRTC_ENV_MASK;
+        while ((SNVS->LPCR & SNVS_LPCR_SRTC_ENV_MASK) == 0)
+        {
+        }
+    }
+
+    /* the two halves aren't latched together, read again if the high one changed in between */
+    do
+    {
+        msb = SNVS->LPSRTCMR & SNVS_LPSRTCMR_SRTC_MASK;
+        lsb = SNVS->LPSRTCLR;
+    } while (msb != (SNVS->LPSRTCMR & SNVS_LPSRTCMR_SRTC_MASK));
+
+    return (msb << 17) | (lsb >> 15);
+}
+
 static lpm_dev_operator_t s_LpmDevOperators = {
     .init              = HAL_LpmDev_Init,
     .deinit            = HAL_LpmDev_Deinit,
@@ -344,11 +371,13 @@ static lpm_dev_operator_t s_LpmDevOperators = {
     .enterSleep        = HAL_LpmDev_EnterSleep,
     .lock              = HAL_LpmDev_Lock,
     .unlock            = HAL_LpmDev_Unlock,
+    .getClock          = HAL_LpmDev_GetClock,
 };
 
 static lpm_dev_t s_LpmDev = {
-    .id  = 0,
-    .ops = &s_LpmDevOperators,
+    .id    = 0,
+    .ops   = &s_LpmDevOperators,
+    .modes = (1U << kLPMMode_SNVS),
 };
 
 int HAL_LpmDev_SNVS_Register()
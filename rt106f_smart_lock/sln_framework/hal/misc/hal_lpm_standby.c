@@ -281,8 +281,9 @@ static lpm_dev_operator_t s_LpmDevOperators = {
 };
 
 static lpm_dev_t s_LpmDev = {
-    .id  = 0,
-    .ops = &s_LpmDevOperators,
+    .id    = 0,
+    .ops   = &s_LpmDevOperators,
+    .modes = (1U << kLPMMode_STANDBY),
 };
 
 int HAL_LpmDev_Standby_Register()
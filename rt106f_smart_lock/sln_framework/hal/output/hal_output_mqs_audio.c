@@ -631,6 +631,8 @@ static hal_output_status_t HAL_OutputDev_MqsAudio_Start(const output_dev_t *dev)
         s_MqsAudioTask.task.data       = (fwk_task_data_t *)&(s_MqsAudioTask.data);
         s_MqsAudioTask.task.taskId     = MQS_AUDIO_TASK_ID;
         s_MqsAudioTask.task.delayMs    = 1;
+        /* keep the legacy pacing of the playback task */
+        s_MqsAudioTask.task.mode       = kFWKTaskMode_FixedDelay;
         s_MqsAudioTask.task.taskStack  = s_MqsAudioTaskStack;
         s_MqsAudioTask.task.taskBuffer = s_MqsAudioTaskTcbReference;
         s_MqsAudioTask.data.dev        = dev;
@@ -41,6 +41,9 @@ typedef enum _event_face_rec_id
 
     kEventFaceRecID_OasisDebugOption,
 
+    kEventFaceRecID_AddUsersRemote,
+    kEventFaceRecID_ImportUsersRemote,
+
     kEventFaceRecID_COUNT
 } event_face_rec_id_t;
 
@@ -106,6 +109,38 @@ typedef struct _remote_reg_event_t
     remote_reg_data_t *regData;
 } remote_reg_event_t;
 
+/* Records carried by one chunk of a remote batch registration */
+#ifndef REMOTE_BATCH_REG_MAX_RECORDS
+#define REMOTE_BATCH_REG_MAX_RECORDS 8
+#endif /* REMOTE_BATCH_REG_MAX_RECORDS */
+
+typedef struct _remote_batch_reg_event_t
+{
+    uint32_t isReRegister;
+    /* last chunk of the batch, the enrolled faces are committed to flash after it */
+    uint32_t isLast;
+    uint32_t count;
+    uint32_t dataLen;
+    /* count records of a name followed by a face feature */
+    remote_reg_data_t *regData;
+} remote_batch_reg_event_t;
+
+typedef struct _remote_batch_reg_record_t
+{
+    uint8_t result;
+    uint8_t reserved;
+    /* id of the enrolled face, or of the face it duplicates */
+    uint16_t id;
+} remote_batch_reg_record_t;
+
+typedef struct _remote_batch_reg_result_t
+{
+    uint32_t count;
+    /* the faces enrolled so far in the batch are saved in flash */
+    uint32_t committed;
+    remote_batch_reg_record_t *records;
+} remote_batch_reg_result_t;
+
 typedef struct _faceRecThreshold_event
 {
     unsigned int min;
@@ -135,6 +170,7 @@ typedef struct _event_face_rec
         del_face_event_t delFace;
         update_user_event_t updateFace;
         remote_reg_event_t remoteReg;
+        remote_batch_reg_event_t remoteBatchReg;
         wuart_event_t wuart;
         faceRecThreshold_event_t faceRecThreshold;
         oasis_state_event_t oasisState;
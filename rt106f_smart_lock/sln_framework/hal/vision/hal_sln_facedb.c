@@ -20,8 +20,10 @@
 #include "fwk_log.h"
 #include "fwk_flash.h"
 #include "hal_sln_facedb.h"
+#include "hal_event_descriptor_face_rec.h"
 #include "hal_flash_dev.h"
 #include "stdio.h"
+#include <math.h>
 
 #if defined(AUTOSAVE) & (AUTOSAVE == 1)
 #warning "A screen flicker might be observed when registering faces if autosave is enabled."
@@ -35,7 +37,7 @@
 
 #define FACEDB_SLOT_EMPTY 0x0
 
-#define RESERVED_DATA 0x6
+#define RESERVED_DATA 0x5
 
 #define METADATA_FILE_NAME \
     OASIS_FACE_DB_DIR      \
@@ -46,6 +48,24 @@
     OASIS_FACE_DB_DIR      \
     "/"
 
+#define CHANGELOG_FILE_NAME \
+    OASIS_FACE_DB_DIR       \
+    "/"                     \
+    "Changelog"
+
+#define CHANGELOG_VERSION 0x0001
+
+#define SNAPSHOT_FILE_NAME \
+    OASIS_FACE_DB_DIR      \
+    "/"                    \
+    "Snapshot"
+
+#define FACEDB_SNAPSHOT_MAGIC (0x53424446U) /* "FDBS" */
+
+/* FNV-1a */
+#define FACEDB_HASH_SEED  (2166136261U)
+#define FACEDB_HASH_PRIME (16777619U)
+
 typedef enum _face_mapping_bitwise
 {
     kFaceMappingBitWise_Saved,
@@ -66,6 +86,8 @@ typedef struct _facedb_metadata
     uint32_t modelVersion;
     uint16_t numberFaces;
     uint16_t faceEntrySize;
+    /* FACEDB_CODEC_xxx the faces are stored with, 0 (raw) for the databases made before the codecs */
+    uint8_t codec;
     /* RESERVED DATA for future updates */
     uint8_t reservedData[RESERVED_DATA];
     uint8_t faceMapping[MAX_FACE_DB_SIZE];
@@ -78,13 +100,58 @@ typedef struct _facedb_entry
     unsigned char face[];
 } facedb_entry_t;
 
+typedef struct _facedb_change
+{
+    /* revision of the last add, update or delete of the slot, 0 if the slot never changed */
+    uint32_t revision;
+    /* content hash of the face entry, 0 once the face is deleted */
+    uint32_t hash;
+} facedb_change_t;
+
+typedef struct _facedb_changelog
+{
+    uint32_t version;
+    uint32_t revision;
+    facedb_change_t changes[MAX_FACE_DB_SIZE];
+} facedb_changelog_t;
+
+/* Header of the snapshot file, followed by the entries of the slots stored in the order of their ids */
+typedef struct _facedb_snapshot
+{
+    uint32_t magic;
+    /* FNV-1a of the entries then of this header with hash set to 0 */
+    uint32_t hash;
+    uint16_t faceEntrySize;
+    uint16_t numberFaces;
+    uint8_t stored[MAX_FACE_DB_SIZE];
+} facedb_snapshot_t;
+
+typedef enum _facedb_snapshot_state
+{
+    kFacedbSnapshot_Unknown, /* a snapshot left in flash may be out of date */
+    kFacedbSnapshot_None,    /* no snapshot in flash */
+    kFacedbSnapshot_Current, /* the snapshot in flash holds the saved faces */
+} facedb_snapshot_state_t;
+
 /* Database buffer */
 static uint16_t s_FaceEntrySize;
+static uint16_t s_FaceFeatureSize;
+/* Codec of the faces in s_FaceDB, raw if the face items don't end with a float vector */
+static uint8_t s_FaceDBCodec = FACEDB_CODEC_RAW;
+/* Faces decoded for the recognition, from HAL_Facedb_GetIdsAndFaces to HAL_Facedb_ReleaseFaces */
+static uint8_t *s_FaceDBDecoded = NULL;
+static uint16_t s_FaceDBDecodedCount;
+/* Face decoded by HAL_Facedb_GetFace, valid until the next call */
+static uint8_t *s_FaceDBDecodedFace = NULL;
 static uint32_t s_FaceDBSize;
 static uint8_t *s_FaceDB              = NULL;
 static SemaphoreHandle_t s_FaceDBLock = NULL;
+/* Faces are kept in RAM until HAL_Facedb_SaveFace even with AUTOSAVE */
+static bool s_FaceDBSaveDeferred = false;
 
 static facedb_metadata_t s_OasisMetadata;
+static facedb_changelog_t s_FaceDBChangelog;
+static facedb_snapshot_state_t s_FaceDBSnapshotState = kFacedbSnapshot_Unknown;
 const facedb_ops_t g_facedb_ops = {
     .init            = HAL_Facedb_Init,
     .saveFace        = HAL_Facedb_SaveFace,
@@ -107,6 +174,7 @@ const facedb_ops_t g_facedb_ops = {
  * Prototypes
  ******************************************************************************/
 
+static bool _Facedb_AutoSave();
 static int _Facedb_Lock();
 static void _Facedb_Unlock();
 static void _Facedb_SetMetaDataDefault();
@@ -117,10 +185,23 @@ static sln_flash_status_t _Facedb_UpdateMetadata();
 static sln_flash_status_t _Facedb_SaveFace(uint16_t id);
 static sln_flash_status_t _Facedb_DeleteFace(uint16_t id);
 static sln_flash_status_t _Facedb_DeleteAllFaces();
+static void _Facedb_LogChange(uint16_t id);
+static void _Facedb_ReadChangelog();
+static void _Facedb_SyncChangelog();
+static facedb_status_t _Facedb_CheckChanges(const uint8_t *buf, uint32_t size);
+static sln_flash_status_t _Facedb_DeleteImportedFace(uint16_t id);
+static sln_flash_status_t _Facedb_LoadSnapshot();
+static void _Facedb_DropSnapshot();
 
 /*******************************************************************************
  * Code
  ******************************************************************************/
+/* internal function to tell if a face is saved to flash as soon as it is added or updated */
+static bool _Facedb_AutoSave()
+{
+    return (AUTOSAVE && !s_FaceDBSaveDeferred);
+}
+
 // internal function to take the database lock
 static int _Facedb_Lock()
 {
@@ -147,6 +228,7 @@ static void _Facedb_SetMetaDataDefault()
     s_OasisMetadata.modelVersion   = MODEL_VERSION;
     s_OasisMetadata.numberFaces    = 0;
     s_OasisMetadata.faceEntrySize  = 0;
+    s_OasisMetadata.codec          = s_FaceDBCodec;
     memset(s_OasisMetadata.faceMapping, FACEDB_SLOT_EMPTY, MAX_FACE_DB_SIZE * sizeof(uint8_t));
 }
 
@@ -155,6 +237,222 @@ static void _Facedb_SetFaceDataDefault()
     memset(s_FaceDB, 0, s_FaceDBSize);
 }
 
+/* The quantized codecs need a float vector after the raw bytes of the face item */
+static bool _Facedb_HasFloatFeatures(uint16_t featureSize)
+{
+    return ((featureSize > FACEDB_CODEC_RAW_BYTES) && (((featureSize - FACEDB_CODEC_RAW_BYTES) % sizeof(float)) == 0));
+}
+
+static uint32_t _Facedb_FeatureCount()
+{
+    return (s_FaceFeatureSize - FACEDB_CODEC_RAW_BYTES) / sizeof(float);
+}
+
+/* Size of an encoded face feature: the raw bytes, the scale and the quantized values */
+static uint16_t _Facedb_EncodedSize()
+{
+    switch (s_FaceDBCodec)
+    {
+        case FACEDB_CODEC_INT8:
+            return FACEDB_CODEC_RAW_BYTES + sizeof(float) + _Facedb_FeatureCount();
+        case FACEDB_CODEC_INT4:
+            return FACEDB_CODEC_RAW_BYTES + sizeof(float) + (_Facedb_FeatureCount() + 1) / 2;
+        default:
+            return s_FaceFeatureSize;
+    }
+}
+
+static int8_t _Facedb_QuantizedValue(const uint8_t *values, uint32_t i)
+{
+    if (s_FaceDBCodec == FACEDB_CODEC_INT4)
+    {
+        /* two's complement nibbles, the even value in the low nibble */
+        return (int8_t)(((values[i / 2] >> ((i & 1) * 4)) & 0xF) << 4) >> 4;
+    }
+
+    return (int8_t)values[i];
+}
+
+/* Features are copied byte per byte, neither the face items nor the encoded entries are float aligned */
+static void _Facedb_Encode(uint8_t *encoded, const uint8_t *face, int size)
+{
+    const int32_t levels = (s_FaceDBCodec == FACEDB_CODEC_INT4) ? 7 : 127;
+    const uint8_t *features;
+    uint8_t *values;
+    float maxAbs = 0;
+    float scale;
+
+    if (s_FaceDBCodec == FACEDB_CODEC_RAW)
+    {
+        memcpy(encoded, face, size);
+        return;
+    }
+
+    features = face + FACEDB_CODEC_RAW_BYTES;
+    values   = encoded + FACEDB_CODEC_RAW_BYTES + sizeof(float);
+    for (uint32_t i = 0; i < _Facedb_FeatureCount(); i++)
+    {
+        float value;
+        memcpy(&value, features + i * sizeof(float), sizeof(float));
+        maxAbs = fmaxf(maxAbs, fabsf(value));
+    }
+
+    /* one scale per face, the largest magnitude maps to the largest level */
+    scale = maxAbs / levels;
+    memcpy(encoded, face, FACEDB_CODEC_RAW_BYTES);
+    memcpy(encoded + FACEDB_CODEC_RAW_BYTES, &scale, sizeof(float));
+    memset(values, 0, _Facedb_EncodedSize() - FACEDB_CODEC_RAW_BYTES - sizeof(float));
+
+    for (uint32_t i = 0; (scale > 0) && (i < _Facedb_FeatureCount()); i++)
+    {
+        float value;
+        int32_t level;
+
+        memcpy(&value, features + i * sizeof(float), sizeof(float));
+        level = (int32_t)lroundf(value / scale);
+        level = (level > levels) ? levels : ((level < -levels) ? -levels : level);
+
+        if (s_FaceDBCodec == FACEDB_CODEC_INT4)
+        {
+            values[i / 2] |= (uint8_t)((level & 0xF) << ((i & 1) * 4));
+        }
+        else
+        {
+            values[i] = (uint8_t)(int8_t)level;
+        }
+    }
+}
+
+static void _Facedb_Decode(uint8_t *face, const uint8_t *encoded)
+{
+    float scale;
+
+    if (s_FaceDBCodec == FACEDB_CODEC_RAW)
+    {
+        memcpy(face, encoded, s_FaceFeatureSize);
+        return;
+    }
+
+    memcpy(face, encoded, FACEDB_CODEC_RAW_BYTES);
+    memcpy(&scale, encoded + FACEDB_CODEC_RAW_BYTES, sizeof(float));
+    for (uint32_t i = 0; i < _Facedb_FeatureCount(); i++)
+    {
+        float value = scale * _Facedb_QuantizedValue(encoded + FACEDB_CODEC_RAW_BYTES + sizeof(float), i);
+        memcpy(face + FACEDB_CODEC_RAW_BYTES + i * sizeof(float), &value, sizeof(float));
+    }
+}
+
+/* The quantized codecs encode whole face items only */
+static bool _Facedb_CheckFaceSize(int size)
+{
+    if (s_FaceDBCodec == FACEDB_CODEC_RAW)
+    {
+        return ((size > 0) && (size <= s_FaceFeatureSize));
+    }
+
+    return (size == s_FaceFeatureSize);
+}
+
+/* Make room to decode count faces for the recognition. The buffer only lives while the recognition reads the faces,
+ * the encoded faces are all the database keeps in RAM in between */
+static facedb_status_t _Facedb_ReserveDecoded(uint16_t count)
+{
+    if (count > s_FaceDBDecodedCount)
+    {
+        vPortFree(s_FaceDBDecoded);
+        s_FaceDBDecoded      = pvPortMalloc(count * s_FaceFeatureSize);
+        s_FaceDBDecodedCount = count;
+
+        if (s_FaceDBDecoded == NULL)
+        {
+            LOGE("FaceDb: Failed to allocate the buffer to decode %d faces", count);
+            s_FaceDBDecodedCount = 0;
+            return kFaceDBStatus_NotEnoughMemory;
+        }
+    }
+
+    return kFaceDBStatus_Success;
+}
+
+static uint32_t _Facedb_HashBytes(uint32_t hash, const void *data, uint32_t len)
+{
+    const uint8_t *pData = (const uint8_t *)data;
+
+    while (len--)
+    {
+        hash = (hash ^ *pData++) * FACEDB_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+/* Hash of the name up to its terminator and of the face, never 0 */
+static uint32_t _Facedb_HashEntry(const facedb_entry_t *faceEntry)
+{
+    uint32_t hash = FACEDB_HASH_SEED;
+
+    hash = _Facedb_HashBytes(hash, faceEntry->name, strnlen(faceEntry->name, FACE_NAME_MAX_LEN + 1));
+    hash = _Facedb_HashBytes(hash, faceEntry->face, s_FaceEntrySize - sizeof(facedb_entry_t));
+
+    return (hash == 0) ? 1 : hash;
+}
+
+/* Record the current content of a slot under a new revision, a slot not in use is a tombstone */
+static void _Facedb_LogChange(uint16_t id)
+{
+    facedb_change_t *change = &s_FaceDBChangelog.changes[id];
+
+    change->revision = ++s_FaceDBChangelog.revision;
+    if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Used)) == FACE_IN_USE)
+    {
+        change->hash = _Facedb_HashEntry((facedb_entry_t *)(FACE_ENTRY(id)));
+    }
+    else
+    {
+        change->hash = 0;
+    }
+}
+
+static void _Facedb_ReadChangelog()
+{
+    uint32_t len              = sizeof(facedb_changelog_t);
+    sln_flash_status_t status = FWK_Flash_Read(CHANGELOG_FILE_NAME, &s_FaceDBChangelog, 0, &len);
+
+    if ((status != kStatus_HAL_FlashSuccess) || (len != sizeof(facedb_changelog_t)) ||
+        (s_FaceDBChangelog.version != CHANGELOG_VERSION))
+    {
+        LOGI("FaceDB: No changelog, it is rebuilt from the faces in use.");
+        memset(&s_FaceDBChangelog, 0, sizeof(facedb_changelog_t));
+        s_FaceDBChangelog.version = CHANGELOG_VERSION;
+    }
+}
+
+/* The changelog is saved with the metadata, log the faces it missed once the database is loaded */
+static void _Facedb_SyncChangelog()
+{
+    uint32_t revision = s_FaceDBChangelog.revision;
+
+    for (uint16_t id = 0; id < MAX_FACE_DB_SIZE; id++)
+    {
+        uint32_t hash = 0;
+
+        if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Used)) == FACE_IN_USE)
+        {
+            hash = _Facedb_HashEntry((facedb_entry_t *)(FACE_ENTRY(id)));
+        }
+
+        if (s_FaceDBChangelog.changes[id].hash != hash)
+        {
+            _Facedb_LogChange(id);
+        }
+    }
+
+    if (revision != s_FaceDBChangelog.revision)
+    {
+        FWK_Flash_Save(CHANGELOG_FILE_NAME, &s_FaceDBChangelog, sizeof(facedb_changelog_t));
+    }
+}
+
 static void _Facedb_GeneratePathFromIndex(uint16_t id, char *path)
 {
     if (path != NULL)
@@ -191,6 +489,12 @@ static sln_flash_status_t _Facedb_UpdateMetadata()
         status = FWK_Flash_Save(METADATA_FILE_NAME, &oasisMetadata, sizeof(facedb_metadata_t));
     } while (status != kStatus_HAL_FlashSuccess);
 
+    /* a changelog older than the metadata is caught up when it is loaded */
+    if (FWK_Flash_Save(CHANGELOG_FILE_NAME, &s_FaceDBChangelog, sizeof(facedb_changelog_t)) != kStatus_HAL_FlashSuccess)
+    {
+        LOGE("FaceDB: Failed to save the changelog.");
+    }
+
     LOGI("FaceDB: Metadata updated.");
 
     return status;
@@ -275,10 +579,113 @@ static sln_flash_status_t _Facedb_Load()
     return status;
 }
 
+/* Load the faces from the snapshot, it must store exactly the faces the metadata says are saved */
+static sln_flash_status_t _Facedb_LoadSnapshot()
+{
+#if FACEDB_SNAPSHOT
+    facedb_snapshot_t snapshot;
+    uint32_t len              = sizeof(facedb_snapshot_t);
+    uint16_t count            = 0;
+    uint16_t index            = 0;
+    uint32_t hash             = 0;
+    uint32_t snapshotHash     = 1;
+    uint8_t *pStored          = NULL;
+    sln_flash_status_t status = FWK_Flash_Read(SNAPSHOT_FILE_NAME, &snapshot, 0, &len);
+
+    if ((status != kStatus_HAL_FlashSuccess) || (len != sizeof(facedb_snapshot_t)) ||
+        (snapshot.magic != FACEDB_SNAPSHOT_MAGIC) || (snapshot.faceEntrySize != s_FaceEntrySize))
+    {
+        return kStatus_HAL_FlashFail;
+    }
+
+    for (uint16_t id = 0; id < MAX_FACE_DB_SIZE; id++)
+    {
+        uint8_t mapping = s_OasisMetadata.faceMapping[id];
+
+        /* an update not saved on the last run goes back to the face file of the older version */
+        if (((mapping & (1 << kFaceMappingBitWise_Updated)) == FACE_UPDATED) ||
+            (snapshot.stored[id] != (((mapping & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED) ? 1 : 0)))
+        {
+            return kStatus_HAL_FlashFail;
+        }
+        count += snapshot.stored[id];
+    }
+
+    if (count != snapshot.numberFaces)
+    {
+        return kStatus_HAL_FlashFail;
+    }
+
+    /* read the entries at the end of the buffer, then move each one down to its slot */
+    pStored = FACE_ENTRY(MAX_FACE_DB_SIZE - count);
+    len     = count * s_FaceEntrySize;
+    if (len > 0)
+    {
+        status = FWK_Flash_Read(SNAPSHOT_FILE_NAME, pStored, sizeof(facedb_snapshot_t), &len);
+    }
+    if ((status == kStatus_HAL_FlashSuccess) && (len == count * s_FaceEntrySize))
+    {
+        hash          = _Facedb_HashBytes(FACEDB_HASH_SEED, pStored, len);
+        snapshotHash  = snapshot.hash;
+        snapshot.hash = 0;
+        hash          = _Facedb_HashBytes(hash, &snapshot, sizeof(facedb_snapshot_t));
+    }
+
+    if ((status != kStatus_HAL_FlashSuccess) || (hash != snapshotHash))
+    {
+        LOGE("FaceDB: Snapshot corrupted, loading the faces one by one.");
+        _Facedb_SetFaceDataDefault();
+        return kStatus_HAL_FlashFail;
+    }
+
+    /* the entry k is read at slot MAX_FACE_DB_SIZE - count + k, never below the slot of its id */
+    for (uint16_t id = 0; id < MAX_FACE_DB_SIZE; id++)
+    {
+        if (snapshot.stored[id])
+        {
+            memmove(FACE_ENTRY(id), pStored + index * s_FaceEntrySize, s_FaceEntrySize);
+            s_OasisMetadata.faceMapping[id] = FACE_SAVED | FACE_IN_USE;
+            index++;
+        }
+        else
+        {
+            memset(FACE_ENTRY(id), 0, s_FaceEntrySize);
+        }
+    }
+    s_OasisMetadata.numberFaces = count;
+
+    return kStatus_HAL_FlashSuccess;
+#else
+    return kStatus_HAL_FlashFail;
+#endif /* FACEDB_SNAPSHOT */
+}
+
+/* Remove the snapshot before a face file changes, a snapshot in flash is never older than the faces */
+static void _Facedb_DropSnapshot()
+{
+#if FACEDB_SNAPSHOT
+    if (s_FaceDBSnapshotState != kFacedbSnapshot_None)
+    {
+        sln_flash_status_t status = FWK_Flash_Rm(SNAPSHOT_FILE_NAME);
+        if ((status == kStatus_HAL_FlashSuccess) || (status == kStatus_HAL_FlashFileNotExist))
+        {
+            s_FaceDBSnapshotState = kFacedbSnapshot_None;
+        }
+        else
+        {
+            LOGE("FaceDB: Failed to remove the snapshot \"%d\".", status);
+        }
+    }
+#endif /* FACEDB_SNAPSHOT */
+}
+
 static facedb_status_t _Facedb_Init()
 {
     sln_flash_status_t status = FWK_Flash_Mkdir(OASIS_FACE_DB_DIR);
     facedb_status_t ret       = kFaceDBStatus_Success;
+
+    _Facedb_ReadChangelog();
+
     if (status == kStatus_HAL_FlashDirExist)
     {
         /* Already exists assume everything is ok don't over engineer for now */
@@ -286,11 +693,12 @@ static facedb_status_t _Facedb_Init()
         status       = FWK_Flash_Read(METADATA_FILE_NAME, &s_OasisMetadata, 0, &len);
         if (status == kStatus_HAL_FlashSuccess)
         {
-            if ((s_OasisMetadata.featureVersion != FEATURE_VERSION) || (s_OasisMetadata.modelVersion != MODEL_VERSION))
+            if ((s_OasisMetadata.featureVersion != FEATURE_VERSION) ||
+                (s_OasisMetadata.modelVersion != MODEL_VERSION) || (s_OasisMetadata.codec != s_FaceDBCodec))
             {
                 LOGE(
-                    "FaceDB: Oasis_Version found in flash different from current version. Features might be "
-                    "different.");
+                    "FaceDB: Oasis_Version or feature codec found in flash different from current version. Features "
+                    "might be different.");
                 /* TODO: Implement a recovery strategy */
                 _Facedb_DeleteAllFaces();
                 _Facedb_SetMetaDataDefault();
@@ -309,7 +717,17 @@ static facedb_status_t _Facedb_Init()
                 }
                 else
                 {
-                    status = _Facedb_Load();
+                    status = _Facedb_LoadSnapshot();
+                    if (status == kStatus_HAL_FlashSuccess)
+                    {
+                        LOGI("FaceDB: Faces loaded from the snapshot.");
+                        s_FaceDBSnapshotState = kFacedbSnapshot_Current;
+                    }
+                    else
+                    {
+                        status = _Facedb_Load();
+                    }
+
                     if (status == kStatus_HAL_FlashSuccess)
                     {
                         ret = kFaceDBStatus_Success;
@@ -342,6 +760,12 @@ static facedb_status_t _Facedb_Init()
     }
 
     s_OasisMetadata.faceEntrySize = s_FaceEntrySize;
+
+    if (ret == kFaceDBStatus_Success)
+    {
+        _Facedb_SyncChangelog();
+    }
+
     return ret;
 }
 
@@ -352,6 +776,7 @@ static sln_flash_status_t _Facedb_SaveFace(uint16_t id)
     /* Save in a file */
     char path[20];
     _Facedb_GeneratePathFromIndex(id, path);
+    _Facedb_DropSnapshot();
 
     status = FWK_Flash_Save(path, (FACE_ENTRY(id)), s_FaceEntrySize);
     if (status == kStatus_HAL_FlashSuccess)
@@ -374,6 +799,7 @@ static sln_flash_status_t _Facedb_DeleteFaceFromFlash(uint16_t id)
 
     LOGD("FaceDB: delete file from flash id %d", id);
     _Facedb_GeneratePathFromIndex(id, path);
+    _Facedb_DropSnapshot();
     status = FWK_Flash_Rm(path);
     if (status == kStatus_HAL_FlashSuccess || status == kStatus_HAL_FlashFileNotExist)
     {
@@ -398,6 +824,7 @@ static sln_flash_status_t _Facedb_DeleteAllFaces()
             memset((FACE_ENTRY(id)), 0, s_FaceEntrySize);
             s_OasisMetadata.faceMapping[id] &= ~(1 << kFaceMappingBitWise_Used);
             s_OasisMetadata.numberFaces--;
+            _Facedb_LogChange(id);
 
             if (((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED) ||
                 (s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Updated)) == FACE_UPDATED)
@@ -445,6 +872,7 @@ static sln_flash_status_t _Facedb_DeleteFace(uint16_t id)
         memset((FACE_ENTRY(id)), 0, s_FaceEntrySize);
         s_OasisMetadata.faceMapping[id] &= ~(1 << kFaceMappingBitWise_Used);
         s_OasisMetadata.numberFaces--;
+        _Facedb_LogChange(id);
 
         /* Delete from flash */
         if (((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED) ||
@@ -496,15 +924,29 @@ facedb_status_t HAL_Facedb_Init(uint16_t featureSize)
         }
         else
         {
-            s_FaceDBSize = (featureSize + sizeof(facedb_entry_t)) * MAX_FACE_DB_SIZE;
-            s_FaceDB     = pvPortMalloc(s_FaceDBSize);
+            s_FaceFeatureSize = featureSize;
+            s_FaceDBCodec     = FACEDB_FEATURE_CODEC;
+            if ((s_FaceDBCodec != FACEDB_CODEC_RAW) && !_Facedb_HasFloatFeatures(featureSize))
+            {
+                LOGE("FaceDb: Face items of %d bytes don't end with a float vector, not encoded", featureSize);
+                s_FaceDBCodec = FACEDB_CODEC_RAW;
+            }
 
-            if (NULL == s_FaceDB)
+            s_FaceEntrySize = _Facedb_EncodedSize() + sizeof(facedb_entry_t);
+            s_FaceDBSize    = s_FaceEntrySize * MAX_FACE_DB_SIZE;
+            s_FaceDB        = pvPortMalloc(s_FaceDBSize);
+            if ((NULL != s_FaceDB) && (s_FaceDBCodec != FACEDB_CODEC_RAW))
+            {
+                s_FaceDBDecodedFace = pvPortMalloc(featureSize);
+            }
+
+            if ((NULL == s_FaceDB) || ((s_FaceDBCodec != FACEDB_CODEC_RAW) && (NULL == s_FaceDBDecodedFace)))
             {
                 LOGE("FaceDb: Failed to allocate face DB buffer");
-                status = kFaceDBStatus_NotEnoughMemory;
+                vPortFree(s_FaceDB);
+                s_FaceDB = NULL;
+                status   = kFaceDBStatus_NotEnoughMemory;
             }
-            s_FaceEntrySize = featureSize + sizeof(facedb_entry_t);
         }
     }
 
@@ -584,6 +1026,8 @@ facedb_status_t HAL_Facedb_SaveFace(void)
         status = _Facedb_UpdateMetadata();
     }
 
+    _Facedb_Unlock();
+
     if (status != kStatus_HAL_FlashSuccess)
     {
         ret = kFaceDBStatus_Failed;
@@ -592,71 +1036,256 @@ facedb_status_t HAL_Facedb_SaveFace(void)
     return ret;
 }
 
-facedb_status_t HAL_Facedb_AddFace(uint16_t id, char *name, void *face, int size)
+facedb_status_t HAL_Facedb_SaveSnapshot(void)
 {
-    facedb_status_t ret = kFaceDBStatus_Success;
+#if FACEDB_SNAPSHOT
+    sln_flash_status_t status = kStatus_HAL_FlashSuccess;
+    facedb_status_t ret       = kFaceDBStatus_Success;
+    facedb_snapshot_t snapshot;
+    uint32_t hash = FACEDB_HASH_SEED;
 
     if ((s_FaceDB == NULL) || (s_FaceDBLock == NULL))
     {
         ret = kFaceDBStatus_NotInit;
     }
-    else if ((size >= s_FaceEntrySize) || (id >= MAX_FACE_DB_SIZE) || (face == NULL))
-    {
-        ret = kFaceDBStatus_WrongParam;
-    }
     else
     {
         ret = _Facedb_Lock();
     }
 
-    if (ret == kFaceDBStatus_Success)
+    if ((ret != kFaceDBStatus_Success) || (s_FaceDBSnapshotState == kFacedbSnapshot_Current))
     {
-        if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Used)) == FACE_NOT_USED)
+        if (ret == kFaceDBStatus_Success)
         {
-            /* Update RAM face */
-            facedb_entry_t *faceEntry = (facedb_entry_t *)(FACE_ENTRY(id));
-            if (name != NULL)
-            {
-                strcpy(faceEntry->name, name);
-            }
-            else
-            {
-                sprintf(faceEntry->name, "user_%03d", id);
-                faceEntry->name[FACE_NAME_MAX_LEN - 1] = 0;
-            }
-
-            memcpy(faceEntry->face, face, size);
-
-            s_OasisMetadata.faceMapping[id] = FACE_IN_USE;
-            s_OasisMetadata.numberFaces++;
-
-            LOGD("FaceDb: Added face to RAM successfully :%d %s.", id, faceEntry->name);
+            _Facedb_Unlock();
+        }
+        return ret;
+    }
 
-#if AUTOSAVE
-            /* Save to Flash */
-            sln_flash_status_t status = kStatus_HAL_FlashSuccess;
-            status                    = _Facedb_SaveFace(id);
-            if (status == kStatus_HAL_FlashSuccess)
-            {
-                LOGD("FaceDb: Added face to flash successfully :%d %s.", id, faceEntry->name);
+    memset(&snapshot, 0, sizeof(facedb_snapshot_t));
+    snapshot.magic         = FACEDB_SNAPSHOT_MAGIC;
+    snapshot.faceEntrySize = s_FaceEntrySize;
+    for (uint16_t id = 0; id < MAX_FACE_DB_SIZE; id++)
+    {
+        if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Updated)) == FACE_UPDATED)
+        {
+            /* the face in RAM is not the one in flash */
+            LOGE("FaceDb: Update of face \"%d\" not saved, no snapshot.", id);
+            ret = kFaceDBStatus_Failed;
+            break;
+        }
 
-                /* Update Flash metadata */
-                _Facedb_UpdateMetadata();
+        if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED)
+        {
+            snapshot.stored[id] = 1;
+            snapshot.numberFaces++;
+            hash = _Facedb_HashBytes(hash, FACE_ENTRY(id), s_FaceEntrySize);
+        }
+    }
 
-                ret = kFaceDBStatus_Success;
-            }
-            else
+    if (ret == kFaceDBStatus_Success)
+    {
+        snapshot.hash = _Facedb_HashBytes(hash, &snapshot, sizeof(facedb_snapshot_t));
+        status        = FWK_Flash_Append(SNAPSHOT_FILE_NAME, &snapshot, sizeof(facedb_snapshot_t), true);
+        for (uint16_t id = 0; (id < MAX_FACE_DB_SIZE) && (status == kStatus_HAL_FlashSuccess); id++)
+        {
+            if (snapshot.stored[id])
             {
-                LOGE("FaceDb: Failed to save face into flash.");
-                ret = kFaceDBStatus_Failed;
+                status = FWK_Flash_Append(SNAPSHOT_FILE_NAME, FACE_ENTRY(id), s_FaceEntrySize, false);
             }
-#endif /* AUTOSAVE */
+        }
+
+        if (status == kStatus_HAL_FlashSuccess)
+        {
+            LOGI("FaceDb: Snapshot of %d faces saved.", snapshot.numberFaces);
+            s_FaceDBSnapshotState = kFacedbSnapshot_Current;
         }
         else
         {
-            LOGE("FaceDb: Face slot for ID %d already in use.", id);
+            LOGE("FaceDb: Failed to save the snapshot \"%d\".", status);
+            s_FaceDBSnapshotState = kFacedbSnapshot_Unknown;
+            _Facedb_DropSnapshot();
+            ret = kFaceDBStatus_Failed;
         }
-        _Facedb_Unlock();
+    }
+
+    _Facedb_Unlock();
+
+    return ret;
+#else
+    return kFaceDBStatus_Success;
+#endif /* FACEDB_SNAPSHOT */
+}
+
+facedb_status_t HAL_Facedb_DeferSave(bool defer)
+{
+    facedb_status_t ret = kFaceDBStatus_Success;
+
+    if ((s_FaceDB == NULL) || (s_FaceDBLock == NULL))
+    {
+        ret = kFaceDBStatus_NotInit;
+    }
+    else
+    {
+        ret = _Facedb_Lock();
+    }
+
+    if (ret == kFaceDBStatus_Success)
+    {
+        s_FaceDBSaveDeferred = defer;
+        _Facedb_Unlock();
+    }
+
+    return ret;
+}
+
+/* The names of the batch are resolved in a single pass over the database, the faces stay in RAM and the whole batch is
+ * written to flash at once after its last chunk */
+facedb_status_t HAL_Facedb_AddUsersRemote(remote_batch_reg_event_t *pBatch,
+                                          uint32_t faceItemSize,
+                                          facedb_register_cb_t registerFace,
+                                          remote_batch_reg_result_t *pRes)
+{
+    uint16_t recordIds[REMOTE_BATCH_REG_MAX_RECORDS];
+    uint16_t faceIds[MAX_FACE_DB_SIZE];
+    uint32_t recordSize = sizeof(remote_reg_data_t) + faceItemSize;
+    facedb_status_t ret = kFaceDBStatus_Success;
+
+    pRes->count     = 0;
+    pRes->committed = false;
+
+    if ((pBatch->regData == NULL) || (pBatch->count > REMOTE_BATCH_REG_MAX_RECORDS) ||
+        (pBatch->dataLen != pBatch->count * recordSize) || (registerFace == NULL))
+    {
+        return kFaceDBStatus_WrongParam;
+    }
+
+    for (uint32_t i = 0; i < pBatch->count; i++)
+    {
+        remote_reg_data_t *pData = (remote_reg_data_t *)((uint8_t *)pBatch->regData + i * recordSize);
+
+        pData->name[FACE_NAME_MAX_LEN] = '\0';
+        recordIds[i]                   = INVALID_ID;
+    }
+
+    /* find the ids of the users to register again, every database name is compared to all the records */
+    if (pBatch->isReRegister && (HAL_Facedb_GetIds(faceIds) == kFaceDBStatus_Success))
+    {
+        int count = HAL_Facedb_GetCount();
+
+        for (int j = 0; j < count; j++)
+        {
+            char *name = HAL_Facedb_GetName(faceIds[j]);
+
+            for (uint32_t i = 0; (name != NULL) && (i < pBatch->count); i++)
+            {
+                remote_reg_data_t *pData = (remote_reg_data_t *)((uint8_t *)pBatch->regData + i * recordSize);
+
+                if ((recordIds[i] == INVALID_ID) && !strcmp(pData->name, name))
+                {
+                    recordIds[i] = faceIds[j];
+                }
+            }
+        }
+    }
+
+    HAL_Facedb_DeferSave(true);
+
+    for (uint32_t i = 0; i < pBatch->count; i++)
+    {
+        remote_reg_data_t *pData = (remote_reg_data_t *)((uint8_t *)pBatch->regData + i * recordSize);
+        uint16_t id              = recordIds[i];
+
+        /* the faces enrolled by the previous records are in the database already, a duplicate in the batch is
+         * caught as well */
+        pRes->records[i].reserved = 0;
+        pRes->records[i].result   = registerFace(pData->facedata, pBatch->isReRegister ? NULL : pData->name, &id);
+        pRes->records[i].id       = id;
+    }
+
+    HAL_Facedb_DeferSave(false);
+    pRes->count = pBatch->count;
+
+    if (pBatch->isLast)
+    {
+        /* one flash commit for all the faces enrolled by the batch */
+        ret = HAL_Facedb_SaveFace();
+        if (ret == kFaceDBStatus_Success)
+        {
+            pRes->committed = true;
+        }
+    }
+
+    return ret;
+}
+
+facedb_status_t HAL_Facedb_AddFace(uint16_t id, char *name, void *face, int size)
+{
+    facedb_status_t ret = kFaceDBStatus_Success;
+
+    if ((s_FaceDB == NULL) || (s_FaceDBLock == NULL))
+    {
+        ret = kFaceDBStatus_NotInit;
+    }
+    else if (!_Facedb_CheckFaceSize(size) || (id >= MAX_FACE_DB_SIZE) || (face == NULL))
+    {
+        ret = kFaceDBStatus_WrongParam;
+    }
+    else
+    {
+        ret = _Facedb_Lock();
+    }
+
+    if (ret == kFaceDBStatus_Success)
+    {
+        if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Used)) == FACE_NOT_USED)
+        {
+            /* Update RAM face */
+            facedb_entry_t *faceEntry = (facedb_entry_t *)(FACE_ENTRY(id));
+            if (name != NULL)
+            {
+                strcpy(faceEntry->name, name);
+            }
+            else
+            {
+                sprintf(faceEntry->name, "user_%03d", id);
+                faceEntry->name[FACE_NAME_MAX_LEN - 1] = 0;
+            }
+
+            _Facedb_Encode(faceEntry->face, face, size);
+
+            s_OasisMetadata.faceMapping[id] = FACE_IN_USE;
+            s_OasisMetadata.numberFaces++;
+            _Facedb_LogChange(id);
+
+            LOGD("FaceDb: Added face to RAM successfully :%d %s.", id, faceEntry->name);
+
+            if (_Facedb_AutoSave())
+            {
+                /* Save to Flash */
+                sln_flash_status_t status = kStatus_HAL_FlashSuccess;
+                status                    = _Facedb_SaveFace(id);
+                if (status == kStatus_HAL_FlashSuccess)
+                {
+                    LOGD("FaceDb: Added face to flash successfully :%d %s.", id, faceEntry->name);
+
+                    /* Update Flash metadata */
+                    _Facedb_UpdateMetadata();
+
+                    ret = kFaceDBStatus_Success;
+                }
+                else
+                {
+                    LOGE("FaceDb: Failed to save face into flash.");
+                    ret = kFaceDBStatus_Failed;
+                }
+            }
+        }
+        else
+        {
+            LOGE("FaceDb: Face slot for ID %d already in use.", id);
+        }
+        _Facedb_Unlock();
     }
     return ret;
 }
@@ -784,13 +1413,28 @@ facedb_status_t HAL_Facedb_GetIdsAndFaces(uint16_t *face_ids, void **pFace)
 
     if (ret == kFaceDBStatus_Success)
     {
-        for (uint16_t id = 0; id < MAX_FACE_DB_SIZE; id++)
+        if (s_FaceDBCodec != FACEDB_CODEC_RAW)
+        {
+            ret = _Facedb_ReserveDecoded(s_OasisMetadata.numberFaces);
+        }
+
+        for (uint16_t id = 0; (ret == kFaceDBStatus_Success) && (id < MAX_FACE_DB_SIZE); id++)
         {
             facedb_entry_t *faceEntry = (facedb_entry_t *)(FACE_ENTRY(id));
             if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Used)) == FACE_IN_USE)
             {
-                face_ids[index]  = id;
-                *(pFace + index) = &faceEntry->face;
+                face_ids[index] = id;
+                if (s_FaceDBCodec == FACEDB_CODEC_RAW)
+                {
+                    *(pFace + index) = &faceEntry->face;
+                }
+                else
+                {
+                    /* the recognition reads float features */
+                    uint8_t *decoded = s_FaceDBDecoded + index * s_FaceFeatureSize;
+                    _Facedb_Decode(decoded, faceEntry->face);
+                    *(pFace + index) = decoded;
+                }
                 index++;
             }
         }
@@ -800,6 +1444,34 @@ facedb_status_t HAL_Facedb_GetIdsAndFaces(uint16_t *face_ids, void **pFace)
     return ret;
 }
 
+facedb_status_t HAL_Facedb_ReleaseFaces(void)
+{
+    facedb_status_t ret = kFaceDBStatus_Success;
+
+    if ((s_FaceDB == NULL) || (s_FaceDBLock == NULL))
+    {
+        ret = kFaceDBStatus_NotInit;
+    }
+    else
+    {
+        ret = _Facedb_Lock();
+    }
+
+    if ((ret == kFaceDBStatus_Success) && (s_FaceDBDecoded != NULL))
+    {
+        vPortFree(s_FaceDBDecoded);
+        s_FaceDBDecoded      = NULL;
+        s_FaceDBDecodedCount = 0;
+    }
+
+    if (ret == kFaceDBStatus_Success)
+    {
+        _Facedb_Unlock();
+    }
+
+    return ret;
+}
+
 /* get the face item pointer with the specified face id from the database */
 facedb_status_t HAL_Facedb_GetFace(uint16_t id, void **pFace)
 {
@@ -829,6 +1501,12 @@ facedb_status_t HAL_Facedb_GetFace(uint16_t id, void **pFace)
         {
             facedb_entry_t *faceEntry = (facedb_entry_t *)(FACE_ENTRY(id));
             *pFace                    = &(faceEntry->face);
+            if (s_FaceDBCodec != FACEDB_CODEC_RAW)
+            {
+                /* valid until the next call */
+                _Facedb_Decode(s_FaceDBDecodedFace, faceEntry->face);
+                *pFace = s_FaceDBDecodedFace;
+            }
         }
         else
         {
@@ -940,22 +1618,23 @@ facedb_status_t HAL_Facedb_UpdateName(uint16_t id, char *name)
             facedb_entry_t *faceEntry = (facedb_entry_t *)(FACE_ENTRY(id));
             uint8_t nameSize = (FACE_NAME_MAX_LEN < strlen(name)) ? (FACE_NAME_MAX_LEN + 1) : (strlen(name) + 1);
             memcpy(faceEntry->name, name, nameSize);
-#if AUTOSAVE
-            sln_flash_status_t status = kStatus_HAL_FlashSuccess;
-
-            /* Save to Flash */
-            status = _Facedb_SaveFace(id);
-            if (status == kStatus_HAL_FlashSuccess)
+            _Facedb_LogChange(id);
+            if (_Facedb_AutoSave())
             {
-                LOGD("FaceDb: Added Flash success :%d %s \r\n", id, name);
+                sln_flash_status_t status = kStatus_HAL_FlashSuccess;
+
+                /* Save to Flash */
+                status = _Facedb_SaveFace(id);
+                if (status == kStatus_HAL_FlashSuccess)
+                {
+                    LOGD("FaceDb: Added Flash success :%d %s \r\n", id, name);
+                }
             }
-#else
-            if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED)
+            else if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED)
             {
                 s_OasisMetadata.faceMapping[id] &= ~FACE_SAVED;
                 s_OasisMetadata.faceMapping[id] |= FACE_UPDATED;
             }
-#endif /* AUTOSAVE */
         }
         else
         {
@@ -977,7 +1656,7 @@ facedb_status_t HAL_Facedb_UpdateFace(uint16_t id, char *name, void *face, int s
     {
         ret = kFaceDBStatus_NotInit;
     }
-    else if ((size >= s_FaceEntrySize) || (id >= MAX_FACE_DB_SIZE) || (face == NULL) || (name == NULL))
+    else if (!_Facedb_CheckFaceSize(size) || (id >= MAX_FACE_DB_SIZE) || (face == NULL) || (name == NULL))
     {
         ret = kFaceDBStatus_WrongParam;
     }
@@ -993,25 +1672,26 @@ facedb_status_t HAL_Facedb_UpdateFace(uint16_t id, char *name, void *face, int s
             /* Update RAM face */
             facedb_entry_t *faceEntry = (facedb_entry_t *)(FACE_ENTRY(id));
             strcpy(faceEntry->name, name);
-            memcpy(&(faceEntry->face), face, size);
+            _Facedb_Encode(faceEntry->face, face, size);
+            _Facedb_LogChange(id);
 
             LOGD("FaceDb: Successfully saved face to RAM:%d %s \r\n", id, name);
-#if AUTOSAVE
-            sln_flash_status_t status = kStatus_HAL_FlashSuccess;
-
-            /* Save to Flash */
-            status = _Facedb_SaveFace(id);
-            if (status == kStatus_HAL_FlashSuccess)
+            if (_Facedb_AutoSave())
             {
-                LOGD("FaceDb: Successfully saved face to Flash:%d %s \r\n", id, name);
+                sln_flash_status_t status = kStatus_HAL_FlashSuccess;
+
+                /* Save to Flash */
+                status = _Facedb_SaveFace(id);
+                if (status == kStatus_HAL_FlashSuccess)
+                {
+                    LOGD("FaceDb: Successfully saved face to Flash:%d %s \r\n", id, name);
+                }
             }
-#else
-            if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED)
+            else if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED)
             {
                 s_OasisMetadata.faceMapping[id] &= ~FACE_SAVED;
                 s_OasisMetadata.faceMapping[id] |= FACE_UPDATED;
             }
-#endif /* AUTOSAVE */
         }
         else
         {
@@ -1104,4 +1784,342 @@ facedb_status_t HAL_Facedb_GetIdWithName(char *name, uint16_t *pId)
     return _Facedb_GetIdFromName(name, pId);
 }
 
+uint32_t HAL_Facedb_GetRevision(void)
+{
+    return s_FaceDBChangelog.revision;
+}
+
+facedb_status_t HAL_Facedb_GetSummary(facedb_summary_t *pSummary)
+{
+    facedb_status_t ret = kFaceDBStatus_Success;
+
+    if ((s_FaceDB == NULL) || (s_FaceDBLock == NULL))
+    {
+        ret = kFaceDBStatus_NotInit;
+    }
+    else if (pSummary == NULL)
+    {
+        ret = kFaceDBStatus_WrongParam;
+    }
+    else
+    {
+        ret = _Facedb_Lock();
+    }
+
+    if (ret == kFaceDBStatus_Success)
+    {
+        pSummary->revision = s_FaceDBChangelog.revision;
+        for (uint8_t bucket = 0; bucket < FACEDB_SUMMARY_BUCKETS; bucket++)
+        {
+            pSummary->buckets[bucket] = FACEDB_HASH_SEED;
+        }
+
+        /* Deleted faces are left out, a database that never had them holds the same faces */
+        for (uint16_t id = 0; id < MAX_FACE_DB_SIZE; id++)
+        {
+            if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Used)) == FACE_IN_USE)
+            {
+                uint32_t *bucket = &pSummary->buckets[id % FACEDB_SUMMARY_BUCKETS];
+
+                *bucket = _Facedb_HashBytes(*bucket, &id, sizeof(id));
+                *bucket = _Facedb_HashBytes(*bucket, &s_FaceDBChangelog.changes[id].hash, sizeof(uint32_t));
+            }
+        }
+        _Facedb_Unlock();
+    }
+
+    return ret;
+}
+
+facedb_status_t HAL_Facedb_ExportChanges(uint32_t sinceRevision, uint32_t bucketMask, uint8_t *buf, uint32_t *pSize)
+{
+    facedb_status_t ret = kFaceDBStatus_Success;
+
+    if ((s_FaceDB == NULL) || (s_FaceDBLock == NULL))
+    {
+        ret = kFaceDBStatus_NotInit;
+    }
+    else if (pSize == NULL)
+    {
+        ret = kFaceDBStatus_WrongParam;
+    }
+    else
+    {
+        ret = _Facedb_Lock();
+    }
+
+    if (ret == kFaceDBStatus_Success)
+    {
+        facedb_delta_header_t header = {
+            .magic        = FACEDB_DELTA_MAGIC,
+            .fromRevision = sinceRevision,
+            .toRevision   = s_FaceDBChangelog.revision,
+            .count        = 0,
+            .entrySize    = s_FaceEntrySize,
+        };
+        uint32_t size = sizeof(facedb_delta_header_t);
+
+        for (uint16_t id = 0; id < MAX_FACE_DB_SIZE; id++)
+        {
+            facedb_change_t *change = &s_FaceDBChangelog.changes[id];
+
+            if (((bucketMask & (1U << (id % FACEDB_SUMMARY_BUCKETS))) == 0) || (change->revision <= sinceRevision))
+            {
+                continue;
+            }
+
+            facedb_delta_record_t record = {
+                .id       = id,
+                .reserved = 0,
+                .revision = change->revision,
+                .hash     = 0,
+            };
+            uint32_t recordSize = sizeof(facedb_delta_record_t);
+
+            if ((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Used)) == FACE_IN_USE)
+            {
+                record.op   = kFaceDBDeltaOp_Upsert;
+                record.hash = change->hash;
+                recordSize += s_FaceEntrySize;
+            }
+            else
+            {
+                record.op = kFaceDBDeltaOp_Delete;
+            }
+
+            if ((buf != NULL) && (size + recordSize <= *pSize))
+            {
+                memcpy(buf + size, &record, sizeof(facedb_delta_record_t));
+                if (record.op == kFaceDBDeltaOp_Upsert)
+                {
+                    memcpy(buf + size + sizeof(facedb_delta_record_t), FACE_ENTRY(id), s_FaceEntrySize);
+                }
+            }
+            size += recordSize;
+            header.count++;
+        }
+
+        if (buf != NULL)
+        {
+            if (size > *pSize)
+            {
+                ret = kFaceDBStatus_NotEnoughMemory;
+            }
+            else
+            {
+                memcpy(buf, &header, sizeof(facedb_delta_header_t));
+            }
+        }
+        *pSize = size;
+        _Facedb_Unlock();
+    }
+
+    return ret;
+}
+
+/* internal function to check every record of the changes before any of them is applied */
+static facedb_status_t _Facedb_CheckChanges(const uint8_t *buf, uint32_t size)
+{
+    facedb_delta_header_t header;
+    uint32_t offset = sizeof(facedb_delta_header_t);
+
+    if (size < sizeof(facedb_delta_header_t))
+    {
+        return kFaceDBStatus_WrongParam;
+    }
+
+    memcpy(&header, buf, sizeof(facedb_delta_header_t));
+    if ((header.magic != FACEDB_DELTA_MAGIC) || (header.entrySize != s_FaceEntrySize))
+    {
+        LOGE("FaceDb: Changes are not for this database, entry size %d.", header.entrySize);
+        return kFaceDBStatus_VersionMismatch;
+    }
+
+    for (uint16_t i = 0; i < header.count; i++)
+    {
+        facedb_delta_record_t record;
+
+        if (offset + sizeof(facedb_delta_record_t) > size)
+        {
+            return kFaceDBStatus_WrongParam;
+        }
+
+        memcpy(&record, buf + offset, sizeof(facedb_delta_record_t));
+        offset += sizeof(facedb_delta_record_t);
+        if (record.id >= MAX_FACE_DB_SIZE)
+        {
+            return kFaceDBStatus_WrongID;
+        }
+
+        if (record.op == kFaceDBDeltaOp_Upsert)
+        {
+            if ((offset + s_FaceEntrySize > size) || (memchr(buf + offset, '\0', FACE_NAME_MAX_LEN + 1) == NULL) ||
+                (_Facedb_HashEntry((const facedb_entry_t *)(buf + offset)) != record.hash))
+            {
+                LOGE("FaceDb: Corrupted change for id %d.", record.id);
+                return kFaceDBStatus_WrongParam;
+            }
+            offset += s_FaceEntrySize;
+        }
+        else if (record.op != kFaceDBDeltaOp_Delete)
+        {
+            return kFaceDBStatus_WrongParam;
+        }
+    }
+
+    return (offset == size) ? kFaceDBStatus_Success : kFaceDBStatus_WrongParam;
+}
+
+/* internal function to delete an imported face, it is only dropped from RAM once its file is gone so a failure
+ * leaves both as they were. The metadata is left to the caller, to be written once for all the deletes. */
+static sln_flash_status_t _Facedb_DeleteImportedFace(uint16_t id)
+{
+    sln_flash_status_t status = kStatus_HAL_FlashSuccess;
+
+    if (((s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED) ||
+        (s_OasisMetadata.faceMapping[id] & (1 << kFaceMappingBitWise_Updated)) == FACE_UPDATED)
+    {
+        status = _Facedb_DeleteFaceFromFlash(id);
+        if ((status != kStatus_HAL_FlashSuccess) && (status != kStatus_HAL_FlashFileNotExist))
+        {
+            LOGE("FaceDB: Failed to delete face from id: %d.", id);
+            return kStatus_HAL_FlashFail;
+        }
+    }
+
+    memset((FACE_ENTRY(id)), 0, s_FaceEntrySize);
+    s_OasisMetadata.faceMapping[id] &= ~(1 << kFaceMappingBitWise_Used);
+    s_OasisMetadata.numberFaces--;
+    _Facedb_LogChange(id);
+
+    return kStatus_HAL_FlashSuccess;
+}
+
+facedb_status_t HAL_Facedb_ImportChanges(const uint8_t *buf, uint32_t size)
+{
+    facedb_status_t ret = kFaceDBStatus_Success;
+    uint16_t upserted   = 0;
+    uint16_t deleted    = 0;
+    uint16_t conflicts  = 0;
+
+    if ((s_FaceDB == NULL) || (s_FaceDBLock == NULL))
+    {
+        ret = kFaceDBStatus_NotInit;
+    }
+    else if (buf == NULL)
+    {
+        ret = kFaceDBStatus_WrongParam;
+    }
+    else
+    {
+        ret = _Facedb_CheckChanges(buf, size);
+    }
+
+    if (ret == kFaceDBStatus_Success)
+    {
+        ret = _Facedb_Lock();
+    }
+
+    if (ret == kFaceDBStatus_Success)
+    {
+        facedb_delta_header_t header;
+        uint32_t offset = sizeof(facedb_delta_header_t);
+
+        memcpy(&header, buf, sizeof(facedb_delta_header_t));
+        while (offset < size)
+        {
+            facedb_delta_record_t record;
+            facedb_change_t *change;
+            uint8_t *mapping;
+            bool inUse;
+
+            memcpy(&record, buf + offset, sizeof(facedb_delta_record_t));
+            offset += sizeof(facedb_delta_record_t);
+            mapping = &s_OasisMetadata.faceMapping[record.id];
+            change  = &s_FaceDBChangelog.changes[record.id];
+            inUse   = ((*mapping & (1 << kFaceMappingBitWise_Used)) == FACE_IN_USE);
+
+            if (((record.op == kFaceDBDeltaOp_Upsert) && inUse && (change->hash == record.hash)) ||
+                ((record.op == kFaceDBDeltaOp_Delete) && !inUse))
+            {
+                /* already there */
+                if (record.op == kFaceDBDeltaOp_Upsert)
+                {
+                    offset += s_FaceEntrySize;
+                }
+                continue;
+            }
+
+            /* The face changed here after the revision the changes were made from, and not before the change of the
+             * other database, keep the local face */
+            if ((change->revision > header.fromRevision) && (change->revision >= record.revision))
+            {
+                LOGE("FaceDb: Change of id %d at revision %d conflicts with local revision %d, skipped.", record.id,
+                     record.revision, change->revision);
+                conflicts++;
+                if (record.op == kFaceDBDeltaOp_Upsert)
+                {
+                    offset += s_FaceEntrySize;
+                }
+                continue;
+            }
+
+            /* the applied change is logged after the one of the other database, revisions keep their order */
+            if (s_FaceDBChangelog.revision < record.revision)
+            {
+                s_FaceDBChangelog.revision = record.revision;
+            }
+
+            if (record.op == kFaceDBDeltaOp_Upsert)
+            {
+                memcpy(FACE_ENTRY(record.id), buf + offset, s_FaceEntrySize);
+                if (!inUse)
+                {
+                    *mapping = FACE_IN_USE;
+                    s_OasisMetadata.numberFaces++;
+                }
+                else if ((*mapping & (1 << kFaceMappingBitWise_Saved)) == FACE_SAVED)
+                {
+                    *mapping &= ~FACE_SAVED;
+                    *mapping |= FACE_UPDATED;
+                }
+                _Facedb_LogChange(record.id);
+                upserted++;
+                offset += s_FaceEntrySize;
+            }
+            else if (_Facedb_DeleteImportedFace(record.id) == kStatus_HAL_FlashSuccess)
+            {
+                deleted++;
+            }
+            else
+            {
+                ret = kFaceDBStatus_Failed;
+            }
+        }
+
+        /* A single metadata write for all the deletes, including the ones done before a failed one */
+        if ((deleted > 0) && (_Facedb_UpdateMetadata() != kStatus_HAL_FlashSuccess))
+        {
+            ret = kFaceDBStatus_Failed;
+        }
+        _Facedb_Unlock();
+
+        LOGI("FaceDb: Applied %d changes, %d conflicts, revision %d.", upserted + deleted, conflicts,
+             s_FaceDBChangelog.revision);
+    }
+
+    /* Added and updated faces are written by a single save, even when another change failed */
+    if ((upserted > 0) && _Facedb_AutoSave() && (HAL_Facedb_SaveFace() != kFaceDBStatus_Success))
+    {
+        ret = kFaceDBStatus_Failed;
+    }
+
+    if ((ret == kFaceDBStatus_Success) && (conflicts > 0))
+    {
+        ret = kFaceDBStatus_Conflict;
+    }
+
+    return ret;
+}
+
 #endif /* ENABLE_FACEDB */
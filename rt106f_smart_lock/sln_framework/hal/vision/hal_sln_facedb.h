@@ -18,6 +18,7 @@
 #define _HAL_SLN_FACE_DB_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /*******************************************************************************
  * Definitions
@@ -30,6 +31,32 @@
 #define AUTOSAVE 1
 #endif
 
+/* Encoding of the face features in RAM and in flash. The face items are opaque to the database, the int8 and int4
+ * codecs keep FACEDB_CODEC_RAW_BYTES bytes of each item as they are and store the rest, a float vector, as a scale
+ * and one quantized value per float. Check the match deviation with scripts/facedb_codec_eval.py before enabling. */
+#define FACEDB_CODEC_RAW  0
+#define FACEDB_CODEC_INT8 1
+#define FACEDB_CODEC_INT4 2
+
+#ifndef FACEDB_FEATURE_CODEC
+#define FACEDB_FEATURE_CODEC FACEDB_CODEC_RAW
+#endif
+
+#ifndef FACEDB_CODEC_RAW_BYTES
+#define FACEDB_CODEC_RAW_BYTES 0
+#endif
+
+/* Keep a copy of the saved faces in a single file, loaded at boot instead of one file per face. It takes as much flash
+ * as the faces themselves and is written by HAL_Facedb_SaveSnapshot, before going to sleep */
+#ifndef FACEDB_SNAPSHOT
+#define FACEDB_SNAPSHOT 1
+#endif
+
+/* Buckets of the database summary, face id modulo the bucket count */
+#define FACEDB_SUMMARY_BUCKETS (16U)
+
+#define FACEDB_DELTA_MAGIC (0x44424446U) /* "FDBD" */
+
 typedef enum _facedb_status
 {
     kFaceDBStatus_Success,
@@ -41,8 +68,46 @@ typedef enum _facedb_status
     kFaceDBStatus_WrongID,
     kFaceDBStatus_WrongParam,
     kFaceDBStatus_Failed,
+    kFaceDBStatus_Conflict,
 } facedb_status_t;
 
+typedef enum _facedb_delta_op
+{
+    kFaceDBDeltaOp_Upsert = 1,
+    kFaceDBDeltaOp_Delete,
+} facedb_delta_op_t;
+
+/* Changes of the database since a revision. The header is followed by count records, an upsert record is followed
+ * by entrySize bytes of face entry, a name of FACE_NAME_MAX_LEN + 1 bytes and the face feature. Little endian. */
+typedef struct __attribute__((packed)) _facedb_delta_header
+{
+    uint32_t magic;
+    /* changes made after this revision */
+    uint32_t fromRevision;
+    /* revision of the database when it was exported */
+    uint32_t toRevision;
+    uint16_t count;
+    uint16_t entrySize;
+} facedb_delta_header_t;
+
+typedef struct __attribute__((packed)) _facedb_delta_record
+{
+    uint16_t id;
+    uint8_t op;
+    uint8_t reserved;
+    /* revision of the change in the exporting database */
+    uint32_t revision;
+    /* content hash of the face entry, 0 for a deleted face */
+    uint32_t hash;
+} facedb_delta_record_t;
+
+/* Anti-entropy summary, two databases holding the same faces have the same bucket hashes */
+typedef struct _facedb_summary
+{
+    uint32_t revision;
+    uint32_t buckets[FACEDB_SUMMARY_BUCKETS];
+} facedb_summary_t;
+
 typedef struct _facedb_ops
 {
     facedb_status_t (*init)(uint16_t featureSize);
@@ -63,6 +128,13 @@ typedef struct _facedb_ops
 } facedb_ops_t;
 
 extern const facedb_ops_t g_facedb_ops;
+
+struct _remote_batch_reg_event_t;
+struct _remote_batch_reg_result_t;
+
+/* Register a face item under a new name, or register it again for *pId if name is NULL. *pId is INVALID_ID when no
+ * face has the name of a record to register again. Returns the registration result of the algorithm. */
+typedef uint8_t (*facedb_register_cb_t)(void *face, char *name, uint16_t *pId);
 /*******************************************************************************
  * API
  ******************************************************************************/
@@ -83,6 +155,35 @@ facedb_status_t HAL_Facedb_Init(uint16_t featureSize);
  */
 facedb_status_t HAL_Facedb_SaveFace(void);
 
+/*!
+ * @brief Keep the added and updated faces in RAM even if autosave is enabled, so a batch of faces is written to flash
+ * by a single HAL_Facedb_SaveFace.
+ * @param defer - true to stop saving the faces as they are added, false to go back to autosave
+ * @return kFaceDBStatus_Success if the operation was successfull.
+ */
+facedb_status_t HAL_Facedb_DeferSave(bool defer);
+
+/*!
+ * @brief Enroll the records of one chunk of a remote batch registration, the faces of the whole batch are saved after
+ * its last chunk
+ * @param pBatch - chunk of the batch, count records of a name followed by a face item
+ * @param faceItemSize - size of the face items of the records
+ * @param registerFace - registers the face of a record
+ * @param pRes - result of every record, records must hold REMOTE_BATCH_REG_MAX_RECORDS
+ * @return kFaceDBStatus_Success if the operation was successfull.
+ */
+facedb_status_t HAL_Facedb_AddUsersRemote(struct _remote_batch_reg_event_t *pBatch,
+                                          uint32_t faceItemSize,
+                                          facedb_register_cb_t registerFace,
+                                          struct _remote_batch_reg_result_t *pRes);
+
+/*!
+ * @brief Write the snapshot of the saved faces if it is out of date, nothing to do if FACEDB_SNAPSHOT is 0.
+ * The faces not saved yet are left out, call it after HAL_Facedb_SaveFace.
+ * @return kFaceDBStatus_Success if the snapshot matches the faces in flash.
+ */
+facedb_status_t HAL_Facedb_SaveSnapshot(void);
+
 /*!
  * @brief Add a face into RAM database. If autosave is enable also save to flash.
  * @returns a status
@@ -106,7 +207,8 @@ facedb_status_t HAL_Facedb_DelFaceWithID(uint16_t id);
 facedb_status_t HAL_Facedb_DelFaceWithName(char *name);
 
 /*!
- * @brief get the list with all the ids and faces from the database
+ * @brief get the list with all the ids and faces from the database. With an encoded database the faces are decoded
+ * into a buffer which stays allocated until HAL_Facedb_ReleaseFaces
  * @para face_ids, pointer to an array;
  * @param pFace, pointer to an array;
  * @returns a status
@@ -114,6 +216,12 @@ facedb_status_t HAL_Facedb_DelFaceWithName(char *name);
 
 facedb_status_t HAL_Facedb_GetIdsAndFaces(uint16_t *face_ids, void **pFace);
 
+/*!
+ * @brief free the faces decoded by HAL_Facedb_GetIdsAndFaces, once the recognition doesn't read them anymore
+ * @returns a status
+ */
+facedb_status_t HAL_Facedb_ReleaseFaces(void);
+
 /*!
  * @brief get the face attribute from an id
  * @param id the id of the face;
@@ -171,6 +279,41 @@ facedb_status_t HAL_Facedb_UpdateFace(uint16_t id, char *name, void *face, int s
 
 facedb_status_t HAL_Facedb_GetIdWithName(char *name, uint16_t *pId);
 
+/*!
+ * @brief Get the revision of the database, incremented by every add, update and delete of a face
+ * @returns the revision, 0 for a database that never changed
+ */
+uint32_t HAL_Facedb_GetRevision(void);
+
+/*!
+ * @brief Get the revision and the bucket hashes of the database. Only the buckets with a different hash need to be
+ * exported to bring another database in sync.
+ * @param pSummary - summary of the database
+ * @returns a status
+ */
+facedb_status_t HAL_Facedb_GetSummary(facedb_summary_t *pSummary);
+
+/*!
+ * @brief Export the faces added, updated or deleted after a revision
+ * @param sinceRevision - revision the other database is in sync with, 0 to export all the faces
+ * @param bucketMask - summary buckets to export, bit n for bucket n
+ * @param buf - buffer for the changes, NULL to only get the size
+ * @param pSize - size of buf on input, size of the changes on output
+ * @returns a status, kFaceDBStatus_NotEnoughMemory if buf is too small
+ */
+facedb_status_t HAL_Facedb_ExportChanges(uint32_t sinceRevision, uint32_t bucketMask, uint8_t *buf, uint32_t *pSize);
+
+/*!
+ * @brief Apply changes exported by another database. Faces with the same content hash are left untouched, the
+ * applied changes get revisions above the ones of the other database so they are exported in turn. A face changed
+ * here after the fromRevision of the changes, at a revision not below the one of its record, is a conflict and is
+ * kept. Nothing is applied if the changes are malformed, the changes applied before a failure are saved.
+ * @param buf - changes made by HAL_Facedb_ExportChanges
+ * @param size - size of the changes
+ * @returns a status, kFaceDBStatus_Conflict if all but the conflicting changes were applied
+ */
+facedb_status_t HAL_Facedb_ImportChanges(const uint8_t *buf, uint32_t size);
+
 #if defined(__cplusplus)
 }
 #endif
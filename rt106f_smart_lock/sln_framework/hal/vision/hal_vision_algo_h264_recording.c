@@ -11,15 +11,29 @@
 
 /*
  * @brief H.264 recording vision algorithm HAL driver implementation.
+ *
+ * The vision algorithm task only hands the converted YUV420P frame over to a low priority encode task and swaps in a
+ * free frame buffer. When the encoder is behind no new frame is requested from the camera until a buffer is released,
+ * so recording never delays the recognition frames. The encoded frames are kept in a circular clip buffer which holds
+ * the last seconds before a recognition event (kRecordingState_Arm/kRecordingState_Trigger).
  */
 
 #include "board_define.h"
 #ifdef ENABLE_VISIONALGO_DEV_H264Recording
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+
 #include "fwk_log.h"
 #include "fwk_sln_platform.h"
 #include "fwk_vision_algo_manager.h"
 #include "fwk_perf.h"
 #include "fwk_timer.h"
+#ifdef ENABLE_FLASH_DEV_Littlefs
+#include "fwk_flash.h"
+#endif /* ENABLE_FLASH_DEV_Littlefs */
 
 #include "openh264_enc.h"
 #include "hal_event_descriptor_common.h"
@@ -33,6 +47,32 @@
 /* the maximum recording duration in ms*/
 #define RECORDING_MAX_DURATION 60000
 
+/* frames kept before and after a recognition event when the recording is armed */
+#define H264_RECORDING_PRE_EVENT_DURATION  5000
+#define H264_RECORDING_POST_EVENT_DURATION 5000
+
+/* restart the encoder when no IDR frame was produced for this long, a clip can only start on an IDR frame */
+#define H264_RECORDING_IDR_INTERVAL 2000
+
+/* YUV420P frame buffers shared by the camera and the encoder, one is always owned by the camera */
+#define H264_RECORDING_FRAME_POOL 3
+
+/* maximum number of encoded frames tracked in the clip buffer */
+#define H264_RECORDING_CLIP_ENTRIES 1024
+
+#define H264_RECORDING_TASK_NAME     "h264_encode"
+#define H264_RECORDING_TASK_STACK    (8 * 1024)
+#define H264_RECORDING_TASK_PRIORITY 1
+#define H264_RECORDING_QUEUE_LENGTH  (H264_RECORDING_FRAME_POOL + 4)
+
+#ifdef ENABLE_FLASH_DEV_Littlefs
+/* triggered clips are exported to the file system in chunks, the oldest export is overwritten */
+#define H264_RECORDING_EXPORT_LITTLEFS   1
+#define H264_RECORDING_EXPORT_CHUNK_SIZE 4096
+#define H264_RECORDING_EXPORT_MAX_CLIPS  4
+#define H264_RECORDING_EXPORT_PATH       "clip%d.264"
+#endif /* ENABLE_FLASH_DEV_Littlefs */
+
 /* H264 CLIP REGION START ADDRESS, need to align with the definition in the MCUXpresso MCU Setting */
 extern void __base_BOARD_SDRAM_H264_CLIP(void);
 extern void __top_BOARD_SDRAM_H264_CLIP(void);
@@ -45,6 +85,14 @@ extern void __top_BOARD_SDRAM_H264_CLIP(void);
 #define H264_CLIP_REGION_TOTAL_SIZE \
     (((unsigned int)__top_BOARD_SDRAM_H264_CLIP) - ((unsigned int)__base_BOARD_SDRAM_H264_CLIP))
 
+#define H264_CLIP_ENTRY_FLAG_IDR (1 << 0)
+
+#define H264_NAL_TYPE_IDR      5
+#define H264_NAL_TYPE_SPS      7
+#define H264_NAL_SCAN_LENGTH   64
+#define H264_NAL_TYPE(header)  ((header)&0x1F)
+#define H264_RECORDING_TIME_MS (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
 typedef enum _h264_recording_state
 {
     kH264RecordingState_Start = 0,
@@ -53,10 +101,67 @@ typedef enum _h264_recording_state
     kH264RecordingState_Invalid
 } h264_recording_state_t;
 
+typedef enum _h264_recording_mode
+{
+    kH264RecordingMode_Continuous = 0, /* record until stop or the recording duration expires */
+    kH264RecordingMode_PreEvent,       /* keep the last frames until a trigger, then record the post-event window */
+} h264_recording_mode_t;
+
+typedef enum _h264_recording_cmd_id
+{
+    kH264RecordingCmd_Start = 0,
+    kH264RecordingCmd_Frame,
+    kH264RecordingCmd_Stop,
+} h264_recording_cmd_id_t;
+
+typedef struct _h264_recording_cmd
+{
+    h264_recording_cmd_id_t id;
+    uint8_t *frame;
+    uint32_t timestamp;
+} h264_recording_cmd_t;
+
+typedef struct _h264_clip_entry
+{
+    uint32_t offset;
+    uint32_t size;
+    uint32_t timestamp;
+    uint32_t flags;
+} h264_clip_entry_t;
+
+/* encoded frames stored back to back in the clip region, the oldest frames are evicted when full */
+typedef struct _h264_clip_ring
+{
+    uint8_t *base;
+    uint32_t capacity;
+    uint32_t writeOffset;
+    uint32_t usedBytes;
+
+    h264_clip_entry_t entries[H264_RECORDING_CLIP_ENTRIES];
+    uint32_t head;
+    uint32_t count;
+    h264_clip_entry_t *pCurrent;
+    bool overflow;
+
+    bool idrSeen;
+    uint32_t lastIdrTimestamp;
+} h264_clip_ring_t;
+
+typedef struct _h264_recording_stats
+{
+    uint32_t framesEncoded;   /* frames encoded into the clip buffer */
+    uint32_t framesSkipped;   /* stale frames dropped because a newer frame was queued */
+    uint32_t framesThrottled; /* camera requests deferred because the encoder had no free buffer */
+    uint32_t framesEvicted;   /* frames overwritten by newer frames in the clip buffer */
+    uint32_t encoderRestarts; /* encoder restarts to get an IDR frame */
+    uint32_t encodeTimeAvg;   /* average encode time of one frame in ms */
+} h264_recording_stats_t;
+
 typedef struct _h264_recording_param
 {
     h264_recording_state_t state;
     unsigned int encoderState;
+    h264_recording_mode_t mode;
 
     unsigned int inputWidth;
     unsigned int inputHeight;
@@ -71,9 +176,25 @@ typedef struct _h264_recording_param
     vision_algo_dev_t *dev;
 
     vision_algo_result_t result;
+
+    /* encode pipeline */
+    QueueHandle_t cmdQueue;
+    uint8_t *freeFrames[H264_RECORDING_FRAME_POOL];
+    uint32_t freeFrameCount;
+    volatile bool framePending; /* the camera buffer was handed to the encoder and no free one was available */
+    bool encoderRunning;
+
+    volatile bool triggered;
+    uint32_t triggerTimestamp;
+
+    h264_recording_stats_t stats;
+#if H264_RECORDING_EXPORT_LITTLEFS
+    uint32_t exportIndex;
+#endif /* H264_RECORDING_EXPORT_LITTLEFS */
 } h264_recording_param_t;
 
 static h264_recording_param_t s_H264RecordingParam;
+static h264_clip_ring_t s_H264ClipRing;
 
 static void _Recording_RequestFrame(const vision_algo_dev_t *dev)
 {
@@ -124,20 +245,214 @@ static void _Recording_NotifyStop(void)
     s_H264RecordingParam.dev->cap.callback(s_H264RecordingParam.dev->id, valgo_event, fromISR);
 }
 
-static void _Recording_SaveFrame(const void *pFrame, unsigned int size)
+static bool _Recording_IsKeyFrame(const uint8_t *pData, unsigned int size)
 {
-    if (s_H264RecordingParam.info.size + size < H264_CLIP_REGION_TOTAL_SIZE)
+    unsigned int limit = (size < H264_NAL_SCAN_LENGTH) ? size : H264_NAL_SCAN_LENGTH;
+
+    for (unsigned int i = 0; i + 3 < limit; i++)
     {
-        unsigned char *pStart = (unsigned char *)s_H264RecordingParam.info.start + s_H264RecordingParam.info.size;
-        memcpy(pStart, pFrame, size);
-        s_H264RecordingParam.info.size += size;
-        LOGI("Recording:[Frame]:[0x%08x-%d:%d]", pStart, size, s_H264RecordingParam.info.size);
+        if ((pData[i] == 0) && (pData[i + 1] == 0) && (pData[i + 2] == 1))
+        {
+            uint8_t nalType = H264_NAL_TYPE(pData[i + 3]);
+            if ((nalType == H264_NAL_TYPE_IDR) || (nalType == H264_NAL_TYPE_SPS))
+            {
+                return true;
+            }
+        }
     }
-    else
+
+    return false;
+}
+
+static void _ClipRing_Reset(h264_clip_ring_t *pRing)
+{
+    pRing->base        = (uint8_t *)H264_CLIP_REGION_START;
+    pRing->capacity    = H264_CLIP_REGION_TOTAL_SIZE;
+    pRing->writeOffset = 0;
+    pRing->usedBytes   = 0;
+    pRing->head        = 0;
+    pRing->count       = 0;
+    pRing->pCurrent    = NULL;
+    pRing->overflow    = false;
+    pRing->idrSeen     = false;
+}
+
+static h264_clip_entry_t *_ClipRing_Entry(h264_clip_ring_t *pRing, uint32_t age)
+{
+    /* age 0 is the oldest entry */
+    return &pRing->entries[(pRing->head + H264_RECORDING_CLIP_ENTRIES - pRing->count + age) %
+                           H264_RECORDING_CLIP_ENTRIES];
+}
+
+static void _ClipRing_EvictOldest(h264_clip_ring_t *pRing)
+{
+    h264_clip_entry_t *pOldest = _ClipRing_Entry(pRing, 0);
+
+    pRing->usedBytes -= pOldest->size;
+    pRing->count--;
+    s_H264RecordingParam.stats.framesEvicted++;
+}
+
+static void _ClipRing_BeginFrame(h264_clip_ring_t *pRing, uint32_t timestamp)
+{
+    if (pRing->count == H264_RECORDING_CLIP_ENTRIES)
     {
-        LOGD("Recording:[STOP]:out of space");
-        _Recording_NotifyStop();
+        _ClipRing_EvictOldest(pRing);
     }
+
+    h264_clip_entry_t *pEntry = &pRing->entries[pRing->head];
+    pEntry->offset            = pRing->writeOffset;
+    pEntry->size              = 0;
+    pEntry->timestamp         = timestamp;
+    pEntry->flags             = 0;
+
+    pRing->head     = (pRing->head + 1) % H264_RECORDING_CLIP_ENTRIES;
+    pRing->count    = pRing->count + 1;
+    pRing->pCurrent = pEntry;
+    pRing->overflow = false;
+}
+
+static void _ClipRing_Write(h264_clip_ring_t *pRing, const uint8_t *pData, unsigned int size)
+{
+    h264_clip_entry_t *pEntry = pRing->pCurrent;
+
+    if ((pEntry == NULL) || pRing->overflow)
+    {
+        return;
+    }
+
+    if (pEntry->size + size > pRing->capacity)
+    {
+        /* a single frame does not fit in the clip region */
+        pRing->overflow = true;
+        return;
+    }
+
+    if (_Recording_IsKeyFrame(pData, size))
+    {
+        pEntry->flags |= H264_CLIP_ENTRY_FLAG_IDR;
+    }
+
+    /* evicting every older frame always frees enough space, the current frame is the newest entry */
+    while (pRing->capacity - pRing->usedBytes < size)
+    {
+        _ClipRing_EvictOldest(pRing);
+    }
+
+    unsigned int first = pRing->capacity - pRing->writeOffset;
+    if (first > size)
+    {
+        first = size;
+    }
+    memcpy(pRing->base + pRing->writeOffset, pData, first);
+    memcpy(pRing->base, pData + first, size - first);
+
+    pRing->writeOffset = (pRing->writeOffset + size) % pRing->capacity;
+    pRing->usedBytes += size;
+    pEntry->size += size;
+}
+
+static bool _ClipRing_EndFrame(h264_clip_ring_t *pRing)
+{
+    h264_clip_entry_t *pEntry = pRing->pCurrent;
+
+    if (pEntry == NULL)
+    {
+        return false;
+    }
+
+    pRing->pCurrent = NULL;
+
+    if (pRing->overflow || (pEntry->size == 0))
+    {
+        /* drop the partial frame */
+        pRing->writeOffset = pEntry->offset;
+        pRing->usedBytes -= pEntry->size;
+        pRing->head  = (pRing->head + H264_RECORDING_CLIP_ENTRIES - 1) % H264_RECORDING_CLIP_ENTRIES;
+        pRing->count = pRing->count - 1;
+        return false;
+    }
+
+    if (pEntry->flags & H264_CLIP_ENTRY_FLAG_IDR)
+    {
+        pRing->idrSeen          = true;
+        pRing->lastIdrTimestamp = pEntry->timestamp;
+    }
+
+    return true;
+}
+
+static void _ClipRing_Reverse(uint8_t *pData, uint32_t size)
+{
+    uint8_t *pHead = pData;
+    uint8_t *pTail = pData + size - 1;
+
+    while (pHead < pTail)
+    {
+        uint8_t tmp = *pHead;
+        *pHead++    = *pTail;
+        *pTail--    = tmp;
+    }
+}
+
+/*
+ * Select the clip and make it contiguous in the clip region.
+ * Triggered clips start at the last IDR frame before the pre-event window, others at the oldest IDR frame.
+ */
+static void _ClipRing_Finalize(h264_clip_ring_t *pRing, uint8_t **ppClip, uint32_t *pClipSize)
+{
+    int32_t startAge     = -1;
+    uint32_t windowStart = 0;
+    uint32_t clipSize    = 0;
+
+    if (s_H264RecordingParam.triggered)
+    {
+        windowStart = s_H264RecordingParam.triggerTimestamp - H264_RECORDING_PRE_EVENT_DURATION;
+    }
+
+    for (uint32_t age = 0; age < pRing->count; age++)
+    {
+        h264_clip_entry_t *pEntry = _ClipRing_Entry(pRing, age);
+        if (pEntry->flags & H264_CLIP_ENTRY_FLAG_IDR)
+        {
+            if ((startAge < 0) ||
+                (s_H264RecordingParam.triggered && ((int32_t)(pEntry->timestamp - windowStart) <= 0)))
+            {
+                startAge = age;
+            }
+        }
+    }
+
+    *ppClip    = pRing->base;
+    *pClipSize = 0;
+
+    if (startAge < 0)
+    {
+        return;
+    }
+
+    for (uint32_t age = startAge; age < pRing->count; age++)
+    {
+        clipSize += _ClipRing_Entry(pRing, age)->size;
+    }
+
+    uint32_t clipOffset = _ClipRing_Entry(pRing, startAge)->offset;
+    if (clipOffset + clipSize > pRing->capacity)
+    {
+        /* the clip wraps, rotate the region in place so it starts at the region base */
+        _ClipRing_Reverse(pRing->base, clipOffset);
+        _ClipRing_Reverse(pRing->base + clipOffset, pRing->capacity - clipOffset);
+        _ClipRing_Reverse(pRing->base, pRing->capacity);
+        clipOffset = 0;
+    }
+
+    *ppClip    = pRing->base + clipOffset;
+    *pClipSize = clipSize;
+}
+
+static void _Recording_SaveFrame(const void *pFrame, unsigned int size)
+{
+    _ClipRing_Write(&s_H264ClipRing, (const uint8_t *)pFrame, size);
 }
 
 static void _Recording_TimerCallback(void *arg)
@@ -146,18 +461,80 @@ static void _Recording_TimerCallback(void *arg)
     _Recording_NotifyStop();
 }
 
-static hal_valgo_status_t _Recording_Record(const vision_algo_dev_t *dev)
+static void _Recording_ReleaseFrame(uint8_t *pFrame)
+{
+    bool requestFrame = false;
+
+    taskENTER_CRITICAL();
+    if (s_H264RecordingParam.framePending)
+    {
+        /* the camera is waiting for a buffer */
+        s_H264RecordingParam.framePending                         = false;
+        s_H264RecordingParam.dev->data.frames[kVAlgoFrameID_RGB].data = pFrame;
+        requestFrame = (s_H264RecordingParam.state != kH264RecordingState_Stop);
+    }
+    else
+    {
+        s_H264RecordingParam.freeFrames[s_H264RecordingParam.freeFrameCount++] = pFrame;
+    }
+    taskEXIT_CRITICAL();
+
+    if (requestFrame)
+    {
+        _Recording_RequestFrame(s_H264RecordingParam.dev);
+    }
+}
+
+static openh264_enc_error_t _Recording_EncoderInit(void)
+{
+    return OpenH264_EncodeInit(s_H264RecordingParam.inputWidth, s_H264RecordingParam.inputHeight,
+                               H264_RECORDING_MAX_FRAME_RATE, H264_RECORDING_TARGET_BITRATE);
+}
+
+static void _Recording_EncoderStart(void)
+{
+    openh264_enc_error_t encError = _Recording_EncoderInit();
+    if (encError)
+    {
+        LOGE("ERROR:OpenH264_EncodeInit [%d]", encError);
+        _Recording_NotifyStop();
+        return;
+    }
+
+    _ClipRing_Reset(&s_H264ClipRing);
+    memset(&s_H264RecordingParam.stats, 0, sizeof(s_H264RecordingParam.stats));
+    s_H264RecordingParam.encoderRunning = true;
+}
+
+static void _Recording_EncodeFrame(uint8_t *pFrame, uint32_t timestamp)
 {
-    hal_valgo_status_t ret        = kStatus_HAL_ValgoSuccess;
     openh264_enc_error_t encError = OPENH264_ENC_ERROR_OK;
     unsigned int encodedSize;
+    h264_clip_ring_t *pRing = &s_H264ClipRing;
+
+    if (pRing->idrSeen && ((timestamp - pRing->lastIdrTimestamp) > H264_RECORDING_IDR_INTERVAL))
+    {
+        /* the next frame of a new encoder session is an IDR frame */
+        OpenH264_EncodeExit();
+        encError = _Recording_EncoderInit();
+        if (encError)
+        {
+            LOGE("ERROR:OpenH264_EncodeInit [%d]", encError);
+            s_H264RecordingParam.encoderRunning = false;
+            _Recording_NotifyStop();
+            return;
+        }
+        pRing->idrSeen = false;
+        s_H264RecordingParam.stats.encoderRestarts++;
+    }
+
+    uint32_t encodeStart = H264_RECORDING_TIME_MS;
+    _ClipRing_BeginFrame(pRing, timestamp);
 
-    encError = OpenH264_EncodeFrame((unsigned char *)dev->data.frames[kVAlgoFrameID_RGB].data);
+    encError = OpenH264_EncodeFrame(pFrame);
     if (encError)
     {
         LOGE("ERROR:OpenH264_EncodeFrame [%d]", encError);
-        ret = kStatus_HAL_ValgoError;
-        return ret;
     }
     else
     {
@@ -165,10 +542,197 @@ static hal_valgo_status_t _Recording_Record(const vision_algo_dev_t *dev)
         if (encError)
         {
             LOGE("ERROR:OpenH264_EncodeSave [%d]", encError);
-            ret = kStatus_HAL_ValgoInitError;
         }
     }
 
+    if (_ClipRing_EndFrame(pRing) && (encError == OPENH264_ENC_ERROR_OK))
+    {
+        h264_recording_stats_t *pStats = &s_H264RecordingParam.stats;
+        uint32_t encodeTime            = H264_RECORDING_TIME_MS - encodeStart;
+
+        pStats->encodeTimeAvg = (pStats->framesEncoded == 0) ? encodeTime : (pStats->encodeTimeAvg * 7 + encodeTime) / 8;
+        pStats->framesEncoded++;
+        LOGI("Recording:[Frame]:[%d:%d]", pStats->framesEncoded, pRing->usedBytes);
+    }
+}
+
+#if H264_RECORDING_EXPORT_LITTLEFS
+static void _Recording_ExportClip(uint8_t *pClip, uint32_t clipSize)
+{
+    char path[16];
+    sln_flash_status_t status = kStatus_HAL_FlashSuccess;
+
+    snprintf(path, sizeof(path), H264_RECORDING_EXPORT_PATH, (int)s_H264RecordingParam.exportIndex);
+    s_H264RecordingParam.exportIndex = (s_H264RecordingParam.exportIndex + 1) % H264_RECORDING_EXPORT_MAX_CLIPS;
+
+    for (uint32_t offset = 0; offset < clipSize; offset += H264_RECORDING_EXPORT_CHUNK_SIZE)
+    {
+        uint32_t chunk = clipSize - offset;
+        if (chunk > H264_RECORDING_EXPORT_CHUNK_SIZE)
+        {
+            chunk = H264_RECORDING_EXPORT_CHUNK_SIZE;
+        }
+
+        /* one chunk per file system operation to keep the flash lock short */
+        status = FWK_Flash_Append(path, pClip + offset, chunk, (offset == 0));
+        if (status != kStatus_HAL_FlashSuccess)
+        {
+            LOGE("Recording:[Export]:failed to write %s at %d [%d]", path, offset, status);
+            FWK_Flash_Rm(path);
+            return;
+        }
+        taskYIELD();
+    }
+
+    LOGD("Recording:[Export]:%s %d bytes", path, clipSize);
+}
+#endif /* H264_RECORDING_EXPORT_LITTLEFS */
+
+static void _Recording_EncoderStop(void)
+{
+    uint8_t *pClip;
+    uint32_t clipSize;
+    vision_algo_result_t *result   = &s_H264RecordingParam.result;
+    h264_recording_stats_t *pStats = &s_H264RecordingParam.stats;
+
+    if (s_H264RecordingParam.encoderRunning)
+    {
+        OpenH264_EncodeExit();
+        s_H264RecordingParam.encoderRunning = false;
+    }
+
+    _ClipRing_Finalize(&s_H264ClipRing, &pClip, &clipSize);
+    s_H264RecordingParam.info.start = (unsigned int)pClip;
+    s_H264RecordingParam.info.size  = clipSize;
+
+    LOGD("Recording:[STOP]:clip 0x%08x-%d encoded:%d skipped:%d throttled:%d evicted:%d restarts:%d avg:%dms", pClip,
+         clipSize, pStats->framesEncoded, pStats->framesSkipped, pStats->framesThrottled, pStats->framesEvicted,
+         pStats->encoderRestarts, pStats->encodeTimeAvg);
+
+    /* Notify the recording result */
+    result->h264Recording.recordedDataSize    = clipSize;
+    result->h264Recording.recordedDataAddress = pClip;
+    result->h264Recording.state               = kRecordingState_Stop;
+
+    _Recording_NotifyResult(s_H264RecordingParam.dev, result);
+
+#if H264_RECORDING_EXPORT_LITTLEFS
+    if (s_H264RecordingParam.triggered && (clipSize > 0))
+    {
+        _Recording_ExportClip(pClip, clipSize);
+    }
+#endif /* H264_RECORDING_EXPORT_LITTLEFS */
+}
+
+static void _Recording_EncodeTask(void *param)
+{
+    h264_recording_cmd_t cmd;
+    h264_recording_cmd_t nextCmd;
+
+    while (1)
+    {
+        if (xQueueReceive(s_H264RecordingParam.cmdQueue, &cmd, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+
+        switch (cmd.id)
+        {
+            case kH264RecordingCmd_Start:
+            {
+                _Recording_EncoderStart();
+            }
+            break;
+
+            case kH264RecordingCmd_Frame:
+            {
+                if (!s_H264RecordingParam.encoderRunning)
+                {
+                    /* recording stopped with frames still queued */
+                }
+                else if ((xQueuePeek(s_H264RecordingParam.cmdQueue, &nextCmd, 0) == pdTRUE) &&
+                         (nextCmd.id == kH264RecordingCmd_Frame))
+                {
+                    /* the encoder is behind, only encode the newest frame to bound the latency */
+                    s_H264RecordingParam.stats.framesSkipped++;
+                }
+                else
+                {
+                    _Recording_EncodeFrame(cmd.frame, cmd.timestamp);
+                }
+
+                _Recording_ReleaseFrame(cmd.frame);
+            }
+            break;
+
+            case kH264RecordingCmd_Stop:
+            {
+                _Recording_EncoderStop();
+            }
+            break;
+
+            default:
+                break;
+        }
+    }
+}
+
+static hal_valgo_status_t _Recording_PostCmd(h264_recording_cmd_id_t id, uint8_t *pFrame)
+{
+    h264_recording_cmd_t cmd = {.id = id, .frame = pFrame, .timestamp = H264_RECORDING_TIME_MS};
+
+    if (xQueueSend(s_H264RecordingParam.cmdQueue, &cmd, 0) != pdPASS)
+    {
+        LOGE("Recording:failed to queue command %d", id);
+        return kStatus_HAL_ValgoError;
+    }
+
+    return kStatus_HAL_ValgoSuccess;
+}
+
+static hal_valgo_status_t _Recording_Record(const vision_algo_dev_t *dev)
+{
+    hal_valgo_status_t ret = kStatus_HAL_ValgoSuccess;
+    uint8_t *pFrame        = (uint8_t *)dev->data.frames[kVAlgoFrameID_RGB].data;
+    uint8_t *pNextFrame    = NULL;
+
+    taskENTER_CRITICAL();
+    if (s_H264RecordingParam.freeFrameCount > 0)
+    {
+        pNextFrame = s_H264RecordingParam.freeFrames[--s_H264RecordingParam.freeFrameCount];
+    }
+    else
+    {
+        s_H264RecordingParam.framePending = true;
+    }
+    taskEXIT_CRITICAL();
+
+    if (_Recording_PostCmd(kH264RecordingCmd_Frame, pFrame) != kStatus_HAL_ValgoSuccess)
+    {
+        /* keep the frame buffer and drop the frame */
+        taskENTER_CRITICAL();
+        if (pNextFrame != NULL)
+        {
+            s_H264RecordingParam.freeFrames[s_H264RecordingParam.freeFrameCount++] = pNextFrame;
+        }
+        s_H264RecordingParam.framePending = false;
+        taskEXIT_CRITICAL();
+
+        s_H264RecordingParam.stats.framesSkipped++;
+        return ret;
+    }
+
+    if (pNextFrame != NULL)
+    {
+        s_H264RecordingParam.dev->data.frames[kVAlgoFrameID_RGB].data = pNextFrame;
+    }
+    else
+    {
+        /* the encode task requests the next frame when it releases a buffer */
+        s_H264RecordingParam.stats.framesThrottled++;
+        ret = kStatus_HAL_ValgoStop;
+    }
+
     fwk_fps(kFWKFPSType_VAlgo, dev->id);
 
     return ret;
@@ -176,19 +740,16 @@ static hal_valgo_status_t _Recording_Record(const vision_algo_dev_t *dev)
 
 static hal_valgo_status_t _Recording_Start(const vision_algo_dev_t *dev)
 {
-    openh264_enc_error_t encError = OPENH264_ENC_ERROR_OK;
-    hal_valgo_status_t ret        = kStatus_HAL_ValgoSuccess;
+    hal_valgo_status_t ret = kStatus_HAL_ValgoSuccess;
 
-    encError = OpenH264_EncodeInit(s_H264RecordingParam.inputWidth, s_H264RecordingParam.inputHeight,
-                                   H264_RECORDING_MAX_FRAME_RATE, H264_RECORDING_TARGET_BITRATE);
-    if (encError)
+    ret = _Recording_PostCmd(kH264RecordingCmd_Start, NULL);
+    if (ret != kStatus_HAL_ValgoSuccess)
     {
-        LOGE("ERROR:OpenH264_EncodeInit [%d]", encError);
-        ret = kStatus_HAL_ValgoInitError;
-        return ret;
+        return kStatus_HAL_ValgoInitError;
     }
 
-    if (FWK_Timer_Start("RecTimer", s_H264RecordingParam.recordDuration, 0, _Recording_TimerCallback,
+    if ((s_H264RecordingParam.mode == kH264RecordingMode_Continuous) &&
+        FWK_Timer_Start("RecTimer", s_H264RecordingParam.recordDuration, 0, _Recording_TimerCallback,
                         &s_H264RecordingParam, &s_H264RecordingParam.pRecTimer))
     {
         LOGE("Failed to start \"RecTimer\" timer.");
@@ -218,23 +779,36 @@ static hal_valgo_status_t _Recording_Stop(const vision_algo_dev_t *dev)
     hal_valgo_status_t ret = kStatus_HAL_ValgoStop;
     if (s_H264RecordingParam.encoderState != kH264RecordingState_Stop)
     {
-        vision_algo_result_t *result = &s_H264RecordingParam.result;
         if (s_H264RecordingParam.pRecTimer)
         {
             FWK_Timer_Stop(&s_H264RecordingParam.pRecTimer);
         }
         s_H264RecordingParam.encoderState = kH264RecordingState_Stop;
 
-        /* Notify the recording result */
-        result->h264Recording.recordedDataSize    = s_H264RecordingParam.info.size;
-        result->h264Recording.recordedDataAddress = (uint8_t *)s_H264RecordingParam.info.start;
-        result->h264Recording.state               = kRecordingState_Stop;
+        /* the encode task reports the clip once the queued frames are encoded */
+        _Recording_PostCmd(kH264RecordingCmd_Stop, NULL);
+    }
+    return ret;
+}
 
-        _Recording_NotifyResult(dev, &(s_H264RecordingParam.result));
+static void _Recording_Trigger(void)
+{
+    if ((s_H264RecordingParam.mode != kH264RecordingMode_PreEvent) || s_H264RecordingParam.triggered ||
+        (s_H264RecordingParam.state == kH264RecordingState_Stop))
+    {
+        return;
+    }
 
-        OpenH264_EncodeExit();
+    s_H264RecordingParam.triggerTimestamp = H264_RECORDING_TIME_MS;
+    s_H264RecordingParam.triggered        = true;
+    LOGD("Recording:[Trigger]:%d", s_H264RecordingParam.triggerTimestamp);
+
+    if (FWK_Timer_Start("RecTimer", H264_RECORDING_POST_EVENT_DURATION, 0, _Recording_TimerCallback,
+                        &s_H264RecordingParam, &s_H264RecordingParam.pRecTimer))
+    {
+        LOGE("Failed to start \"RecTimer\" timer.");
+        _Recording_NotifyStop();
     }
-    return ret;
 }
 
 static hal_valgo_status_t HAL_VisionAlgoDev_H264Recording_Init(vision_algo_dev_t *dev,
@@ -275,6 +849,36 @@ static hal_valgo_status_t HAL_VisionAlgoDev_H264Recording_Init(vision_algo_dev_t
     {
         LOGE("Unable to allocate memory for kVAlgoFrameID_RGB.");
         ret = kStatus_HAL_ValgoMallocError;
+        return ret;
+    }
+
+    /* the remaining buffers of the pool are owned by the encoder until a frame is handed over */
+    s_H264RecordingParam.freeFrameCount = 0;
+    for (int i = 1; i < H264_RECORDING_FRAME_POOL; i++)
+    {
+        uint8_t *pFrame = pvPortMalloc(h264_yuv420p_frame_aligned_size);
+        if (pFrame == NULL)
+        {
+            LOGE("Unable to allocate memory for H264 frame pool.");
+            ret = kStatus_HAL_ValgoMallocError;
+            return ret;
+        }
+        s_H264RecordingParam.freeFrames[s_H264RecordingParam.freeFrameCount++] = pFrame;
+    }
+
+    s_H264RecordingParam.cmdQueue = xQueueCreate(H264_RECORDING_QUEUE_LENGTH, sizeof(h264_recording_cmd_t));
+    if (s_H264RecordingParam.cmdQueue == NULL)
+    {
+        LOGE("Unable to create H264 encode queue.");
+        ret = kStatus_HAL_ValgoMallocError;
+        return ret;
+    }
+
+    if (xTaskCreate(_Recording_EncodeTask, H264_RECORDING_TASK_NAME, H264_RECORDING_TASK_STACK, NULL,
+                    H264_RECORDING_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        LOGE("Unable to create H264 encode task.");
+        ret = kStatus_HAL_ValgoInitError;
     }
 
     return ret;
@@ -328,21 +932,41 @@ static hal_valgo_status_t HAL_VisionAlgoDev_H264Recording_InputNotify(const visi
     {
         LOGD("Recording:[State]:%d", pEventRecording->state);
 
-        if (pEventRecording->state == kRecordingState_Start)
+        if ((pEventRecording->state == kRecordingState_Start) || (pEventRecording->state == kRecordingState_Arm))
         {
             if (s_H264RecordingParam.state == kH264RecordingState_Stop)
             {
+                bool framePending;
+
                 /* Start the recording */
-                s_H264RecordingParam.state = kH264RecordingState_Start;
-                _Recording_RequestFrame(receiver);
+                s_H264RecordingParam.mode      = (pEventRecording->state == kRecordingState_Arm)
+                                                     ? kH264RecordingMode_PreEvent
+                                                     : kH264RecordingMode_Continuous;
+                s_H264RecordingParam.triggered = false;
+                s_H264RecordingParam.state     = kH264RecordingState_Start;
+
+                taskENTER_CRITICAL();
+                framePending = s_H264RecordingParam.framePending;
+                taskEXIT_CRITICAL();
+
+                /* a pending camera buffer is still being encoded, it is requested once released */
+                if (!framePending)
+                {
+                    _Recording_RequestFrame(receiver);
+                }
             }
         }
+        else if (pEventRecording->state == kRecordingState_Trigger)
+        {
+            _Recording_Trigger();
+        }
         else if (pEventRecording->state == kRecordingState_Stop)
         {
             if (s_H264RecordingParam.state != kH264RecordingState_Stop)
             {
-                /* Stop the recording */
+                /* Stop the recording, without waiting for the next frame which may not be requested */
                 s_H264RecordingParam.state = kH264RecordingState_Stop;
+                _Recording_Stop(receiver);
             }
         }
     }
@@ -350,7 +974,13 @@ static hal_valgo_status_t HAL_VisionAlgoDev_H264Recording_InputNotify(const visi
     {
         if (pEventRecording->eventBase.respond != NULL)
         {
-            s_H264RecordingParam.info.state = s_H264RecordingParam.state;
+            s_H264RecordingParam.info.state   = s_H264RecordingParam.state;
+            s_H264RecordingParam.info.frames  = s_H264RecordingParam.stats.framesEncoded;
+            s_H264RecordingParam.info.skipped = s_H264RecordingParam.stats.framesSkipped;
+            if (s_H264RecordingParam.state != kH264RecordingState_Stop)
+            {
+                s_H264RecordingParam.info.size = s_H264ClipRing.usedBytes;
+            }
             pEventRecording->eventBase.respond(kEventID_RecordingInfo, &s_H264RecordingParam.info, kEventStatus_Ok,
                                                true);
         }
@@ -24,6 +24,7 @@
 #include "fwk_vision_algo_manager.h"
 #include "fwk_profiler.h"
 #include "fwk_lpm_manager.h"
+#include "fwk_memory.h"
 #include "fwk_timer.h"
 
 #include "hal_lpm_dev.h"
@@ -55,6 +56,17 @@
 #define ENTER_SLEEP_TIMER   30000
 #define QUALITY_CHECK_TIMER 1500
 
+/* Follow a detected face in a region of interest instead of converting and scanning the whole frames. It changes the
+ * size of the OASIS frames after OASISLT_init, which the library is not known to accept, keep it off until the loop
+ * has run against the 2D sim camera */
+#ifndef OASIS_ROI_TRACKING
+#define OASIS_ROI_TRACKING 0
+#endif /* OASIS_ROI_TRACKING */
+/* Margin kept around the predicted face box on each side, in percent of the box size */
+#define OASIS_ROI_MARGIN_PERCENT 50
+/* Downscale of the whole frame thumbnail used to find a face lost by the region */
+#define OASIS_ROI_THUMBNAIL_SCALE 2
+
 typedef struct _oasis_lite_param
 {
     OASISLTInitPara_t config;
@@ -83,10 +95,21 @@ typedef struct _oasis_lite_param
     uint8_t timerTimeoutQualityCheck;
     oasis_lite_quality_check_result_t qualityCheck;
     vision_algo_dev_t *dev;
+    /* state and outcome of the last result notified, a result changing them is a one-shot result */
+    oasis_lite_state_t notifiedState;
+    uint32_t notifiedResult;
     oasis_lite_mode_t mode; // 0:smart-lock   1:ffi
 #if HEADLESS_ENABLE
     uint8_t headless_reg_status;
 #endif
+#if OASIS_ROI_TRACKING
+    frame_roi_t roi;      /* region held by the frames being processed, scale 0 for the whole frames */
+    int faceCenter[2];    /* center of the last face found, in full frame coordinates */
+    uint8_t faceTracked;  /* a face was found in the previous frames */
+#endif /* OASIS_ROI_TRACKING */
+#ifdef ENABLE_VISIONALGO_DEV_H264Recording
+    uint8_t recordingArmed; /* an H.264 recording waits for a recognition to keep its clip */
+#endif /* ENABLE_VISIONALGO_DEV_H264Recording */
 } oasis_lite_param_t;
 
 /*******************************************************************************
@@ -151,10 +174,41 @@ static void _oasis_lite_dev_notify_result(const vision_algo_dev_t *dev, vision_a
     if (dev != NULL && result != NULL && dev->cap.callback != NULL)
     {
         uint8_t fromISR = __get_IPSR();
+
+        /* a recognition, registration or deregistration outcome must reach the output devices */
+        if ((result->oasisLite.state != s_OasisLite.notifiedState) ||
+            (result->oasisLite.result != s_OasisLite.notifiedResult))
+        {
+            s_OasisLite.notifiedState  = result->oasisLite.state;
+            s_OasisLite.notifiedResult = result->oasisLite.result;
+            valgo_event.stateChange    = 1;
+        }
         dev->cap.callback(dev->id, valgo_event, fromISR);
     }
 }
 
+#ifdef ENABLE_VISIONALGO_DEV_H264Recording
+static void _oasis_lite_dev_recording_trigger(const vision_algo_dev_t *dev)
+{
+    /* Let an armed H.264 recording keep the frames around the recognition */
+    event_recording_t eventRecording;
+    eventRecording.eventBase.eventId = kEventID_RecordingState;
+    eventRecording.state             = kRecordingState_Trigger;
+
+    /* Build Valgo event */
+    valgo_event_t valgo_event = {.eventId = kVAlgoEvent_VisionRecordControl,
+                                 .data    = &eventRecording,
+                                 .size    = sizeof(event_recording_t),
+                                 .copy    = 1};
+
+    if (dev != NULL && dev->cap.callback != NULL)
+    {
+        uint8_t fromISR = __get_IPSR();
+        dev->cap.callback(dev->id, valgo_event, fromISR);
+    }
+}
+#endif /* ENABLE_VISIONALGO_DEV_H264Recording */
+
 static void _oasis_lite_dev_led_pwm_control(const vision_algo_dev_t *dev, event_common_t *event)
 {
     /* Build Valgo event */
@@ -181,6 +235,118 @@ static void _oasis_lite_dev_camera_exposure_control(const vision_algo_dev_t *dev
     }
 }
 
+#if OASIS_ROI_TRACKING
+/* Point the OASIS frames at the region converted by the camera manager, packed at the top of the buffers */
+static bool _oasis_lite_roi_prepare(oasis_lite_param_t *pParam)
+{
+    vision_frame_t *pRgbFrame = &pParam->dev->data.frames[kVAlgoFrameID_RGB];
+    vision_frame_t *pIrFrame  = &pParam->dev->data.frames[kVAlgoFrameID_IR];
+    frame_roi_t *pRoi         = &pRgbFrame->delivered;
+
+    /* the RGB and IR faces are only matched when both frames hold the same region */
+    if (memcmp(&pRgbFrame->delivered, &pIrFrame->delivered, sizeof(frame_roi_t)) != 0)
+    {
+        return false;
+    }
+
+    pParam->roi = *pRoi;
+    if (pRoi->scale != 0)
+    {
+        short width  = (pRoi->right - pRoi->left + 1) / pRoi->scale;
+        short height = (pRoi->bottom - pRoi->top + 1) / pRoi->scale;
+
+        pParam->frames[OASISLT_INT_FRAME_IDX_RGB].width  = width;
+        pParam->frames[OASISLT_INT_FRAME_IDX_RGB].height = height;
+        pParam->frames[OASISLT_INT_FRAME_IDX_IR].width   = width;
+        pParam->frames[OASISLT_INT_FRAME_IDX_IR].height  = height;
+    }
+    else
+    {
+        pParam->frames[OASISLT_INT_FRAME_IDX_RGB].width  = OASIS_RGB_FRAME_WIDTH;
+        pParam->frames[OASISLT_INT_FRAME_IDX_RGB].height = OASIS_RGB_FRAME_HEIGHT;
+        pParam->frames[OASISLT_INT_FRAME_IDX_IR].width   = OASIS_IR_FRAME_WIDTH;
+        pParam->frames[OASISLT_INT_FRAME_IDX_IR].height  = OASIS_IR_FRAME_HEIGHT;
+    }
+
+    return true;
+}
+
+/* Move a face found in the region back to full frame coordinates, only the rect and the 5 landmarks are used */
+static void _oasis_lite_roi_to_frame(const frame_roi_t *pRoi, FaceBox_t *pFaceBox)
+{
+    if (pRoi->scale == 0)
+    {
+        return;
+    }
+
+    for (int i = 0; i < 4; i += 2)
+    {
+        pFaceBox->rect[i]     = pFaceBox->rect[i] * pRoi->scale + pRoi->left;
+        pFaceBox->rect[i + 1] = pFaceBox->rect[i + 1] * pRoi->scale + pRoi->top;
+    }
+
+    for (int i = OASISLT_LM_LEFT_EYE_X; i < OASISLT_LM_LEFT_EYE_Y; i++)
+    {
+        pFaceBox->fld[i] = pFaceBox->fld[i] * pRoi->scale + pRoi->left;
+    }
+
+    for (int i = OASISLT_LM_LEFT_EYE_Y; i < OASISLT_LM_IDX_NUM; i++)
+    {
+        pFaceBox->fld[i] = pFaceBox->fld[i] * pRoi->scale + pRoi->top;
+    }
+}
+
+/* Ask for the region around the predicted face position with the next frames */
+static void _oasis_lite_roi_update(oasis_lite_param_t *pParam, bool running)
+{
+    oasis_lite_result_t *pResult = &pParam->result.oasisLite;
+    frame_roi_t roi              = {0};
+
+    if (running && (pParam->run_flag == OASIS_DET_REC) && (pResult->face_count != 0))
+    {
+        int *rect    = pResult->face_box.rect;
+        int centerX  = (rect[0] + rect[2]) / 2;
+        int centerY  = (rect[1] + rect[3]) / 2;
+        int halfW    = (rect[2] - rect[0] + 1) * (100 + 2 * OASIS_ROI_MARGIN_PERCENT) / 200;
+        int halfH    = (rect[3] - rect[1] + 1) * (100 + 2 * OASIS_ROI_MARGIN_PERCENT) / 200;
+        int predictX = centerX;
+        int predictY = centerY;
+
+        /* assume the face keeps moving as it did since the previous frame */
+        if (pParam->faceTracked)
+        {
+            predictX += centerX - pParam->faceCenter[0];
+            predictY += centerY - pParam->faceCenter[1];
+        }
+
+        pParam->faceCenter[0] = centerX;
+        pParam->faceCenter[1] = centerY;
+        pParam->faceTracked   = 1;
+
+        roi.left   = predictX - halfW;
+        roi.top    = predictY - halfH;
+        roi.right  = predictX + halfW;
+        roi.bottom = predictY + halfH;
+        roi.scale  = 1;
+    }
+    else if (running && (pParam->run_flag == OASIS_DET_REC) && (pParam->roi.scale == 1))
+    {
+        /* the face left the region, look for it again in a thumbnail of the whole frame */
+        pParam->faceTracked = 0;
+        roi.right           = OASIS_RGB_FRAME_WIDTH - 1;
+        roi.bottom          = OASIS_RGB_FRAME_HEIGHT - 1;
+        roi.scale           = OASIS_ROI_THUMBNAIL_SCALE;
+    }
+    else
+    {
+        pParam->faceTracked = 0;
+    }
+
+    pParam->dev->data.frames[kVAlgoFrameID_RGB].roi = roi;
+    pParam->dev->data.frames[kVAlgoFrameID_IR].roi  = roi;
+}
+#endif /* OASIS_ROI_TRACKING */
+
 static void _oasis_lite_EvtCb(ImageFrame_t *frames[], OASISLTEvt_t evt, OASISLTCbPara_t *para, void *userData)
 {
     OASIS_LOGI("  OASIS_EVT:[%d]", evt);
@@ -209,10 +375,13 @@ static void _oasis_lite_EvtCb(ImageFrame_t *frames[], OASISLTEvt_t evt, OASISLTC
             }
             else
             {
-                OASIS_LOGD("[OASIS]DET:[Left: %d, Top: %d, Right: %d, Bottom: %d].", para->faceBoxRGB->rect[0],
-                           para->faceBoxRGB->rect[1], para->faceBoxRGB->rect[2], para->faceBoxRGB->rect[3]);
                 result->face_count = 1;
                 result->face_box   = (*(para->faceBoxRGB));
+#if OASIS_ROI_TRACKING
+                _oasis_lite_roi_to_frame(&pOasisLite->roi, &result->face_box);
+#endif /* OASIS_ROI_TRACKING */
+                OASIS_LOGD("[OASIS]DET:[Left: %d, Top: %d, Right: %d, Bottom: %d].", result->face_box.rect[0],
+                           result->face_box.rect[1], result->face_box.rect[2], result->face_box.rect[3]);
             }
         }
         break;
@@ -343,6 +512,14 @@ static void _oasis_lite_EvtCb(ImageFrame_t *frames[], OASISLTEvt_t evt, OASISLTC
                 result->face_id         = -1;
                 OASIS_LOGI("[OASIS]INVALID_FACE.");
             }
+
+#ifdef ENABLE_VISIONALGO_DEV_H264Recording
+            if (result->face_recognized && s_OasisLite.recordingArmed)
+            {
+                s_OasisLite.recordingArmed = 0;
+                _oasis_lite_dev_recording_trigger(s_OasisLite.dev);
+            }
+#endif /* ENABLE_VISIONALGO_DEV_H264Recording */
         }
         break;
 
@@ -432,7 +609,12 @@ static int _oasis_lite_GetFaces(uint16_t *faceIds, void **pFaces, uint32_t *face
         return ret;
     }
 
-    HAL_Facedb_GetIdsAndFaces(faceIds, pFaces);
+    /* encoded faces are decoded into a buffer which may not be allocated */
+    if (HAL_Facedb_GetIdsAndFaces(faceIds, pFaces) != kFaceDBStatus_Success)
+    {
+        *faceNum = 0;
+        ret      = -1;
+    }
 
     OASIS_LOGI("--_oasis_lite_GetFaces [%d]", dbCount);
     return ret;
@@ -591,6 +773,9 @@ static void _oasis_stop()
     s_OasisLite.run_flag    = OASIS_RUN_FLAG_STOP;
     memset(&s_OasisLite.result, 0, sizeof(s_OasisLite.result));
     s_OasisLite.result.id = kVisionAlgoID_OasisLite;
+#if OASIS_ROI_TRACKING
+    _oasis_lite_roi_update(&s_OasisLite, false);
+#endif /* OASIS_ROI_TRACKING */
     _oasis_lite_dev_notify_result(s_OasisLite.dev, &(s_OasisLite.result));
 }
 
@@ -904,6 +1089,7 @@ static void _process_inference_result(oasis_lite_param_t *pParam)
                     (pResult->rec_result == kOASISLiteRecognitionResult_Timeout))
                 {
                     lockOasis = true;
+                    FWK_LpmManager_ResumeMark(kFWKLpmResume_Decision);
                 }
                 else
                 {
@@ -1137,6 +1323,21 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Init(vision_algo_dev_t *de
         return ret;
     }
 
+    FWK_LpmManager_ResumeMark(kFWKLpmResume_AlgoModel);
+
+    FWK_Memory_Track(kFWKMemRegion_DTCM, kFWKMemOwner_VisionAlgo, s_DTCOPBuf, DTC_OPTIMIZE_BUFFER_SIZE, "oasis fast mem");
+#if OASIS_STATIC_MEM_BUFFER
+    FWK_Memory_Track(kFWKMemRegion_OcramCached, kFWKMemOwner_VisionAlgo, s_OasisLite.config.memPool,
+                     s_OasisLite.config.size, "oasis mem pool");
+#else
+    FWK_Memory_Track(kFWKMemRegion_SdramCached, kFWKMemOwner_VisionAlgo, s_OasisLite.config.memPool,
+                     s_OasisLite.config.size, "oasis mem pool");
+#endif
+    FWK_Memory_Track(kFWKMemRegion_SdramCached, kFWKMemOwner_VisionAlgo, dev->data.frames[kVAlgoFrameID_RGB].data,
+                     oasis_lite_rgb_frame_aligned_size, "oasis rgb frame");
+    FWK_Memory_Track(kFWKMemRegion_SdramCached, kFWKMemOwner_VisionAlgo, dev->data.frames[kVAlgoFrameID_IR].data,
+                     oasis_lite_ir_frame_aligned_size, "oasis ir frame");
+
     /* Initialize the database */
     facedb_status_t facedb_status = HAL_Facedb_Init(OASISLT_getFaceItemSize());
     if (kFaceDBStatus_Success != facedb_status)
@@ -1146,6 +1347,8 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Init(vision_algo_dev_t *de
         return ret;
     }
 
+    FWK_LpmManager_ResumeMark(kFWKLpmResume_FaceDb);
+
     _oasis_start_recognition(&s_OasisLite);
 
     OASIS_LOGD("[OASIS]:Init ok");
@@ -1163,6 +1366,11 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Deinit(vision_algo_dev_t *
     if (status == kFaceDBStatus_Success)
     {
         LOGD("Successfully saved users to flash.");
+        /* load the faces from a single file at the next wake up */
+        if (HAL_Facedb_SaveSnapshot() != kFaceDBStatus_Success)
+        {
+            LOGE("Failed to save the face database snapshot.");
+        }
         /* Try to do a cleanup 400 ms to erase sectors ~ 10 sectors erased */
         FWK_Flash_Cleanup(400);
     }
@@ -1188,7 +1396,12 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Run(const vision_algo_dev_
     }
 #endif
 
-    if (s_OasisLite.run_flag != OASIS_RUN_FLAG_NUM && s_OasisLite.run_flag != OASIS_RUN_FLAG_STOP)
+    bool framesReady = true;
+#if OASIS_ROI_TRACKING
+    framesReady = _oasis_lite_roi_prepare(&s_OasisLite);
+#endif /* OASIS_ROI_TRACKING */
+
+    if (framesReady && s_OasisLite.run_flag != OASIS_RUN_FLAG_NUM && s_OasisLite.run_flag != OASIS_RUN_FLAG_STOP)
     {
         // clear the result
         memset(&s_OasisLite.result, 0, sizeof(s_OasisLite.result));
@@ -1214,8 +1427,22 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Run(const vision_algo_dev_
         s_OasisLite.frames[OASISLT_INT_FRAME_IDX_3D].data = s_RAW16_540_640_DEPTH_FRAME;
 #endif
 
-        int oasis_ret =
-            OASISLT_run_extend(s_OasisLite.pframes, s_OasisLite.run_flag, s_OasisLite.config.minFace, &s_OasisLite);
+        OASISRunFlag_t runFlag = s_OasisLite.run_flag;
+        int minFace            = s_OasisLite.config.minFace;
+
+#if OASIS_ROI_TRACKING
+        /* a thumbnail is only searched for the face, the recognition waits for the full resolution region */
+        if (s_OasisLite.roi.scale > 1)
+        {
+            runFlag = OASIS_DET_ONLY;
+            minFace = minFace / s_OasisLite.roi.scale;
+        }
+#endif /* OASIS_ROI_TRACKING */
+
+        int oasis_ret = OASISLT_run_extend(s_OasisLite.pframes, runFlag, minFace, &s_OasisLite);
+
+        /* the faces decoded for the recognition aren't read past the run */
+        HAL_Facedb_ReleaseFaces();
 
         if (oasis_ret)
         {
@@ -1238,7 +1465,18 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Run(const vision_algo_dev_
 
         /* Take decision regarding the inference results */
         _process_inference_result(&s_OasisLite);
+
+#if OASIS_ROI_TRACKING
+        _oasis_lite_roi_update(&s_OasisLite, true);
+#endif /* OASIS_ROI_TRACKING */
+    }
+#if OASIS_ROI_TRACKING
+    else if (s_OasisLite.run_flag != OASIS_RUN_FLAG_STOP)
+    {
+        /* nothing was run on these frames, go back to whole frames */
+        _oasis_lite_roi_update(&s_OasisLite, false);
     }
+#endif /* OASIS_ROI_TRACKING */
 
     if (s_OasisLite.run_flag == OASIS_RUN_FLAG_STOP)
     {
@@ -1248,6 +1486,26 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Run(const vision_algo_dev_
     return ret;
 }
 
+/* Register the face of a remote record for HAL_Facedb_AddUsersRemote, under its name or again for its id */
+static uint8_t _oasis_lite_RegisterRemoteFace(void *face, char *name, uint16_t *pId)
+{
+    uint8_t result = OASIS_REG_RESULT_INVALID;
+
+    if ((name != NULL) || (*pId != INVALID_FACE_ID))
+    {
+        s_UserNameReference = name;
+        result              = OASISLT_registration_by_feature(face, NULL, 0, pId, NULL);
+        s_UserNameReference = NULL;
+    }
+
+    if (result == OASIS_REG_RESULT_DUP)
+    {
+        LOGD("Duplicate face registration:%d", *pId);
+    }
+
+    return result;
+}
+
 static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_InputNotify(const vision_algo_dev_t *receiver, void *data)
 {
     hal_valgo_status_t ret = kStatus_HAL_ValgoSuccess;
@@ -1374,6 +1632,37 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_InputNotify(const vision_a
             }
         }
         break;
+        case kEventFaceRecID_AddUsersRemote:
+        {
+            event_face_rec_t event = *(event_face_rec_t *)data;
+            remote_batch_reg_record_t records[REMOTE_BATCH_REG_MAX_RECORDS];
+            remote_batch_reg_result_t res = {0, false, records};
+            event_status_t status         = kEventStatus_Ok;
+
+            if (HAL_Facedb_AddUsersRemote(&event.remoteBatchReg, OASISLT_getFaceItemSize(),
+                                          _oasis_lite_RegisterRemoteFace, &res) != kFaceDBStatus_Success)
+            {
+                status = kEventStatus_Error;
+            }
+            _oasis_lite_dev_response(eventBase, &res, status, true);
+        }
+        break;
+        case kEventFaceRecID_ImportUsersRemote:
+        {
+            event_face_rec_t event = *(event_face_rec_t *)data;
+            event_status_t status  = kEventStatus_Ok;
+            uint32_t revision;
+
+            /* changes exported by another lock, the recognition reads the faces straight from the database */
+            if (HAL_Facedb_ImportChanges(event.wuart.data, event.wuart.length) != kFaceDBStatus_Success)
+            {
+                status = kEventStatus_Error;
+            }
+
+            revision = HAL_Facedb_GetRevision();
+            _oasis_lite_dev_response(eventBase, &revision, status, true);
+        }
+        break;
         case kEventFaceRecID_SaveUserList:
         {
             event_face_rec_t event = *(event_face_rec_t *)data;
@@ -1521,6 +1810,18 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_InputNotify(const vision_a
             LOGD("OASIS:[Recording]:%d [RunFlag]:%d->%d", eventRecording.state, s_OasisLite.prevRunFlag,
                  s_OasisLite.run_flag);
 
+#ifdef ENABLE_VISIONALGO_DEV_H264Recording
+            /* only a recording armed for a pre-event clip is triggered by the recognitions */
+            if (eventRecording.state == kRecordingState_Arm)
+            {
+                s_OasisLite.recordingArmed = 1;
+            }
+            else if ((eventRecording.state == kRecordingState_Start) || (eventRecording.state == kRecordingState_Stop))
+            {
+                s_OasisLite.recordingArmed = 0;
+            }
+#endif /* ENABLE_VISIONALGO_DEV_H264Recording */
+
             if (eventRecording.state == kRecordingState_Start)
             {
                 _set_blocker_bit(kOasisBlockingList_Record);
@@ -1619,6 +1920,9 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_InputNotify(const vision_a
             break;
     }
 
+    /* the registrations by feature search the decoded faces for duplicates */
+    HAL_Facedb_ReleaseFaces();
+
     OASIS_LOGI("--HAL_VisionAlgoDev_OasisLite_InputNotify");
     return ret;
 }
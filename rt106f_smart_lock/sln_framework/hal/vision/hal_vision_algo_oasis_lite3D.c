@@ -24,6 +24,7 @@
 #include "fwk_vision_algo_manager.h"
 #include "fwk_profiler.h"
 #include "fwk_lpm_manager.h"
+#include "fwk_memory.h"
 #include "fwk_timer.h"
 #include "hal_lpm_dev.h"
 #include "hal_event_descriptor_face_rec.h"
@@ -90,6 +91,9 @@ typedef struct _oasis_lite_param
     uint8_t timerTimeoutQualityCheck;
     oasis_lite_quality_check_result_t qualityCheck;
     vision_algo_dev_t *dev;
+    /* state and outcome of the last result notified, a result changing them is a one-shot result */
+    oasis_lite_state_t notifiedState;
+    uint32_t notifiedResult;
     oasis_lite_mode_t mode; // 0:smart-lock   1:ffi
 #if HEADLESS_ENABLE
     uint8_t headless_reg_status;
@@ -170,6 +174,15 @@ static void _oasis_lite_dev_notify_result(const vision_algo_dev_t *dev, vision_a
     if (dev != NULL && result != NULL && dev->cap.callback != NULL)
     {
         uint8_t fromISR = __get_IPSR();
+
+        /* a recognition, registration or deregistration outcome must reach the output devices */
+        if ((result->oasisLite.state != s_OasisLite.notifiedState) ||
+            (result->oasisLite.result != s_OasisLite.notifiedResult))
+        {
+            s_OasisLite.notifiedState  = result->oasisLite.state;
+            s_OasisLite.notifiedResult = result->oasisLite.result;
+            valgo_event.stateChange    = 1;
+        }
         dev->cap.callback(dev->id, valgo_event, fromISR);
     }
 }
@@ -463,7 +476,12 @@ static int _oasis_lite_GetFaces(uint16_t *faceIds, void **pFaces, uint32_t *face
         return ret;
     }
 
-    HAL_Facedb_GetIdsAndFaces(faceIds, pFaces);
+    /* encoded faces are decoded into a buffer which may not be allocated */
+    if (HAL_Facedb_GetIdsAndFaces(faceIds, pFaces) != kFaceDBStatus_Success)
+    {
+        *faceNum = 0;
+        ret      = -1;
+    }
 
     OASIS_LOGI("--_oasis_lite_GetFaces [%d]", dbCount);
     return ret;
@@ -912,6 +930,7 @@ static void _process_inference_result(oasis_lite_param_t *pParam)
                     (pResult->rec_result == kOASISLiteRecognitionResult_Timeout))
                 {
                     lock_oasis = true;
+                    FWK_LpmManager_ResumeMark(kFWKLpmResume_Decision);
                 }
             }
         }
@@ -1128,6 +1147,21 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Init(vision_algo_dev_t *de
         return ret;
     }
 
+    FWK_LpmManager_ResumeMark(kFWKLpmResume_AlgoModel);
+
+    FWK_Memory_Track(kFWKMemRegion_DTCM, kFWKMemOwner_VisionAlgo, s_DTCOPBuf, DTC_OPTIMIZE_BUFFER_SIZE, "oasis fast mem");
+#if OASIS_STATIC_MEM_BUFFER
+    FWK_Memory_Track(kFWKMemRegion_OcramCached, kFWKMemOwner_VisionAlgo, s_OasisLite.config.memPool,
+                     s_OasisLite.config.size, "oasis mem pool");
+#else
+    FWK_Memory_Track(kFWKMemRegion_SdramCached, kFWKMemOwner_VisionAlgo, s_OasisLite.config.memPool,
+                     s_OasisLite.config.size, "oasis mem pool");
+#endif
+    FWK_Memory_Track(kFWKMemRegion_SdramCached, kFWKMemOwner_VisionAlgo, dev->data.frames[kVAlgoFrameID_IR].data,
+                     oasis_lite_rgb_frame_aligned_size, "oasis ir frame");
+    FWK_Memory_Track(kFWKMemRegion_SdramCached, kFWKMemOwner_VisionAlgo, dev->data.frames[kVAlgoFrameID_Depth].data,
+                     oasis_lite_depth_frame_aligned_size, "oasis depth frame");
+
     /* Initialize the database */
     facedb_status_t facedb_status = HAL_Facedb_Init(OASISLT_getFaceItemSize());
     if (kFaceDBStatus_Success != facedb_status)
@@ -1137,6 +1171,8 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Init(vision_algo_dev_t *de
         return ret;
     }
 
+    FWK_LpmManager_ResumeMark(kFWKLpmResume_FaceDb);
+
     _oasis_start_recognition(&s_OasisLite);
 
     OASIS_LOGD("[OASIS]:Init ok");
@@ -1154,6 +1190,11 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Deinit(vision_algo_dev_t *
     if (status == kFaceDBStatus_Success)
     {
         LOGD("Successfully saved users to flash.");
+        /* load the faces from a single file at the next wake up */
+        if (HAL_Facedb_SaveSnapshot() != kFaceDBStatus_Success)
+        {
+            LOGE("Failed to save the face database snapshot.");
+        }
         /* Try to do a cleanup 400 ms to erase sectors ~ 10 sectors erased */
         FWK_Flash_Cleanup(400);
     }
@@ -1208,6 +1249,9 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Run(const vision_algo_dev_
         int oasis_ret =
             OASISLT_run_extend(s_OasisLite.pframes, s_OasisLite.run_flag, s_OasisLite.config.minFace, &s_OasisLite);
 
+        /* the faces decoded for the recognition aren't read past the run */
+        HAL_Facedb_ReleaseFaces();
+
         if (oasis_ret)
         {
             LOGE("OASISLT_run_extend %d", oasis_ret);
@@ -1240,6 +1284,26 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_Run(const vision_algo_dev_
     return ret;
 }
 
+/* Register the face of a remote record for HAL_Facedb_AddUsersRemote, under its name or again for its id */
+static uint8_t _oasis_lite_RegisterRemoteFace(void *face, char *name, uint16_t *pId)
+{
+    uint8_t result = OASIS_REG_RESULT_INVALID;
+
+    if ((name != NULL) || (*pId != INVALID_FACE_ID))
+    {
+        s_UserNameReference = name;
+        result              = OASISLT_registration_by_feature(face, NULL, 0, pId, NULL);
+        s_UserNameReference = NULL;
+    }
+
+    if (result == OASIS_REG_RESULT_DUP)
+    {
+        LOGD("Duplicate face registration:%d", *pId);
+    }
+
+    return result;
+}
+
 static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_InputNotify(const vision_algo_dev_t *receiver, void *data)
 {
     hal_valgo_status_t ret = kStatus_HAL_ValgoSuccess;
@@ -1367,6 +1431,37 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_InputNotify(const vision_a
             }
         }
         break;
+        case kEventFaceRecID_AddUsersRemote:
+        {
+            event_face_rec_t event = *(event_face_rec_t *)data;
+            remote_batch_reg_record_t records[REMOTE_BATCH_REG_MAX_RECORDS];
+            remote_batch_reg_result_t res = {0, false, records};
+            event_status_t status         = kEventStatus_Ok;
+
+            if (HAL_Facedb_AddUsersRemote(&event.remoteBatchReg, OASISLT_getFaceItemSize(),
+                                          _oasis_lite_RegisterRemoteFace, &res) != kFaceDBStatus_Success)
+            {
+                status = kEventStatus_Error;
+            }
+            _oasis_lite_dev_response(eventBase, &res, status, true);
+        }
+        break;
+        case kEventFaceRecID_ImportUsersRemote:
+        {
+            event_face_rec_t event = *(event_face_rec_t *)data;
+            event_status_t status  = kEventStatus_Ok;
+            uint32_t revision;
+
+            /* changes exported by another lock, the recognition reads the faces straight from the database */
+            if (HAL_Facedb_ImportChanges(event.wuart.data, event.wuart.length) != kFaceDBStatus_Success)
+            {
+                status = kEventStatus_Error;
+            }
+
+            revision = HAL_Facedb_GetRevision();
+            _oasis_lite_dev_response(eventBase, &revision, status, true);
+        }
+        break;
         case kEventFaceRecID_SaveUserList:
         {
             event_face_rec_t event = *(event_face_rec_t *)data;
@@ -1612,6 +1707,9 @@ static hal_valgo_status_t HAL_VisionAlgoDev_OasisLite_InputNotify(const vision_a
             break;
     }
 
+    /* the registrations by feature search the decoded faces for duplicates */
+    HAL_Facedb_ReleaseFaces();
+
     LOGI("--HAL_VisionAlgoDev_OasisLite_InputNotify");
     return ret;
 }
@@ -87,6 +87,8 @@ typedef struct _lpm_dev_operator
     hal_lpm_status_t (*enterSleep)(const lpm_dev_t *dev, hal_lpm_mode_t mode);
     hal_lpm_status_t (*lock)(const lpm_dev_t *dev);
     hal_lpm_status_t (*unlock)(const lpm_dev_t *dev);
+    /* optional, seconds of a clock which keeps counting through the sleep modes, 0 if it can't be read */
+    uint32_t (*getClock)(const lpm_dev_t *dev);
 } lpm_dev_operator_t;
 
 /*! @brief Attributes of a lpm device */
@@ -96,6 +98,8 @@ struct _lpm_dev
     int id;
     /* operations */
     const lpm_dev_operator_t *ops;
+    /* modes enterSleep handles, bit per hal_lpm_mode_t, the sleep policy picks one of them */
+    uint32_t modes;
     /* timer */
     TimerHandle_t timer;
     /* pre-enter sleep timer */
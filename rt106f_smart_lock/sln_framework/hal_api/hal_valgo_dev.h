@@ -84,6 +84,8 @@ typedef struct _valgo_event
     unsigned int size;
     /* If copy is set to 1, the framework will forward a copy of the data. */
     unsigned char copy;
+    /* If stateChange is set to 1, the result is a one-shot event, newer results never replace it before it is read. */
+    unsigned char stateChange;
 } valgo_event_t;
 
 /*!
@@ -143,6 +145,12 @@ typedef struct _vision_frame
     /* the source pixel format of the requested frame */
     pixel_format_t srcFormat;
     void *data;
+
+    /* region asked for with the next frame request. A region with a scale is converted to the top of data,
+     * packed at (right - left + 1) / scale pixels per line, instead of the whole frame */
+    frame_roi_t roi;
+    /* region actually held by data when run is called, scale 0 for the whole frame */
+    frame_roi_t delivered;
 } vision_frame_t;
 
 typedef struct
@@ -16,6 +16,11 @@
 
 #include "hal_camera_dev.h"
 
+/*! @brief Alignment in pixels of the region of interest converted for a vision algorithm */
+#ifndef FWK_CAMERA_ROI_ALIGN
+#define FWK_CAMERA_ROI_ALIGN 16
+#endif /* FWK_CAMERA_ROI_ALIGN */
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -175,6 +175,17 @@ typedef enum _valgo_frame_id
     kVAlgoFrameID_Count
 } valgo_frame_id_t;
 
+/*! @brief Region of a frame an algorithm asks for, in the coordinates of its full frame */
+typedef struct _frame_roi
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+    /* downscale of the region, 0 converts the whole frame to the active rect as usual */
+    int scale;
+} frame_roi_t;
+
 typedef enum _hal_device_state
 {
     kState_HAL_Created = 0,
@@ -223,6 +234,9 @@ typedef enum _event_info
 #define MULTICORE_MANAGER_TASK_NAME  "multicore_manager"
 #define MULTICORE_MANAGER_TASK_STACK 1024
 
+#define LPM_MANAGER_TASK_NAME  "lpm_manager"
+#define LPM_MANAGER_TASK_STACK 1024
+
 /*
  * Recomend frame task priority
  *
@@ -310,4 +324,15 @@ typedef struct _framework_request
 #define FWK_SUPPORT_ASYNC_CAMERA_INIT 1
 #endif /* FWK_SUPPORT_ASYNC_CAMERA_INIT */
 
+/* The vision algo task loads its models and the face database right below the priority of the camera task, in the
+ * gaps of the sensor init, instead of after the display and the UI tasks. It drops to its own priority once done */
+#ifndef FWK_SUPPORT_FAST_RESUME
+#define FWK_SUPPORT_FAST_RESUME 1
+#endif /* FWK_SUPPORT_FAST_RESUME */
+
+/* Framework tasks sleep delayMs after every message instead of draining their queue */
+#ifndef FWK_SUPPORT_TASK_FIXED_DELAY
+#define FWK_SUPPORT_TASK_FIXED_DELAY 0
+#endif /* FWK_SUPPORT_TASK_FIXED_DELAY */
+
 #endif /*_FWK_COMMON_H_*/
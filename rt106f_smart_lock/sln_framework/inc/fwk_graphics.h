@@ -16,6 +16,29 @@
 
 #include "hal_graphics_dev.h"
 
+/*! @brief Bytes of the buffer a two pass conversion goes through. The conversion is cut in strips which fit in it, so
+ * the buffer stays in the OCRAM instead of a full intermediate frame in the SDRAM */
+#ifndef GFX_PLAN_STRIP_SIZE
+#define GFX_PLAN_STRIP_SIZE (32 * 1024)
+#endif /* GFX_PLAN_STRIP_SIZE */
+
+/*! @brief Lines of a strip are a multiple of the PXP block */
+#define GFX_PLAN_STRIP_ALIGN 8
+
+/*! @brief Conversion of a source frame to a destination frame, built by gfx_plan and run by gfx_plan_run */
+typedef struct _gfx_plan
+{
+    gfx_surface_t src;          /* source in its buffer orientation */
+    gfx_surface_t dst;          /* destination in its buffer orientation */
+    gfx_surface_t *pOverlay;    /* overlay composed on the destination, NULL for none */
+    cw_rotate_degree_t rotate;  /* the source and destination rotations folded in one */
+    flip_mode_t flip;           /* flip of the source, done before the rotation as the PXP does */
+    pixel_format_t stripFormat; /* format of the strips of a two pass conversion */
+    int passes;                 /* device passes per strip, 2 when the scale and the rotation are split */
+    int strips;                 /* strips of a two pass conversion, 1 for a single pass */
+    int stripLines;             /* destination lines per strip */
+} gfx_plan_t;
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -29,6 +52,51 @@ int gfx_drawPicture(gfx_surface_t *pOverlay, int x, int y, int w, int h, int alp
 int gfx_drawText(gfx_surface_t *pOverlay, int x, int y, int textColor, int bgColor, int type, const char *pText);
 int gfx_compose(
     gfx_surface_t *pSrc, gfx_surface_t *pOverlay, gfx_surface_t *pDst, gfx_rotate_config_t *pRotate, flip_mode_t flip);
+int gfx_bytes_per_pixel(pixel_format_t format);
+
+/**
+ * @brief Plan the conversion of a frame. The rotations are folded in one and the crop, flip, scale, color conversion
+ * and overlay are done in a single device pass. The PXP cannot scale and rotate by 90 or 270 degrees at the same
+ * time, that case is split in a scale pass and a rotation pass run strip by strip through a small OCRAM buffer.
+ * @param pPlan The plan built
+ * @param pSrc Source frame in its buffer orientation, its rect is the part converted
+ * @param srcRotate Rotation of the source to the view
+ * @param flip Flip of the source
+ * @param pDst Destination frame in its buffer orientation, its rect is the part written
+ * @param dstRotate Rotation of the view to the destination
+ * @param pOverlay Overlay composed on the destination, NULL for none
+ * @return int Return 0 if the conversion can be planned
+ */
+int gfx_plan(gfx_plan_t *pPlan,
+             const gfx_surface_t *pSrc,
+             cw_rotate_degree_t srcRotate,
+             flip_mode_t flip,
+             const gfx_surface_t *pDst,
+             cw_rotate_degree_t dstRotate,
+             gfx_surface_t *pOverlay);
+
+/**
+ * @brief Run a plan on the graphics device
+ * @param pPlan The plan
+ * @return int Return 0 if the destination was written
+ */
+int gfx_plan_run(const gfx_plan_t *pPlan);
+
+/**
+ * @brief Run a plan on the CPU. Nearest pixel scaling, it is the reference the device output is compared with and it
+ * builds on a host with FWK_GRAPHICS_HOST.
+ * @param pPlan The plan
+ * @return int Return 0 if the destination was written
+ */
+int gfx_plan_run_reference(const gfx_plan_t *pPlan);
+
+/**
+ * @brief Time a plan on the device and on the CPU and log how far the device output is from the reference
+ * @param pPlan The plan
+ * @param runs Runs of each
+ * @return int Return 0 if both ran
+ */
+int gfx_plan_benchmark(const gfx_plan_t *pPlan, int runs);
 
 #if defined(__cplusplus)
 }
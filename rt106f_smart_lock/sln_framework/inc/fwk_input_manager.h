@@ -20,6 +20,22 @@
 extern "C" {
 #endif
 
+/*! @brief Event ids tasks can subscribe to */
+#ifndef FWK_INPUT_SUBSCRIPTION_MAX
+#define FWK_INPUT_SUBSCRIPTION_MAX 32
+#endif /* FWK_INPUT_SUBSCRIPTION_MAX */
+
+/*! @brief Cost of the input event fan-out */
+typedef struct _fwk_input_stats
+{
+    uint32_t events;      /* input events fanned out */
+    uint32_t deliveries;  /* notify messages queued, one shared message per event */
+    uint32_t filtered;    /* receivers skipped as they did not subscribe to the event id */
+    uint32_t dropped;     /* receivers the notify could not be queued to */
+    uint32_t allocations; /* messages allocated */
+    uint32_t bytesCopied; /* payload bytes copied */
+} fwk_input_stats_t;
+
 /**
  * @brief Init internal structures for input manager.
  * @return int Return 0 if the init process was successful
@@ -39,6 +55,35 @@ int FWK_InputManager_DeviceRegister(input_dev_t *dev);
  */
 int FWK_InputManager_Start(int taskPriority);
 
+/**
+ * @brief Only deliver the given input event id to a task. A task without subscriptions keeps getting all the events
+ * it is a receiver of. The event id is the first word of the event payload, like event_base_t.eventId.
+ * @param taskId Id of the receiver task
+ * @param eventId Id of the event
+ * @return int Return 0 if the subscription was added
+ */
+int FWK_InputManager_Subscribe(fwk_task_id_t taskId, uint32_t eventId);
+
+/**
+ * @brief Remove a subscription added with FWK_InputManager_Subscribe
+ * @param taskId Id of the receiver task
+ * @param eventId Id of the event
+ * @return int Return 0 if the task was subscribed to the event
+ */
+int FWK_InputManager_Unsubscribe(fwk_task_id_t taskId, uint32_t eventId);
+
+/**
+ * @brief Get the fan-out counters of the input manager
+ * @param pStats Counters of the input manager
+ * @return int Return 0 if the counters were copied
+ */
+int FWK_InputManager_GetStats(fwk_input_stats_t *pStats);
+
+/**
+ * @brief Clear the fan-out counters of the input manager
+ */
+void FWK_InputManager_ResetStats(void);
+
 /**
  * @brief Denit internal structures for input manager.
  * @return int Return 0 if the deinit process was successful
@@ -45,82 +45,135 @@ extern "C" {
 #define DEBUG_CONSOLE_UNLOCK()
 #endif
 
+/* Log levels usable by the preprocessor, same values as log_level_t */
+#define FWK_LOG_LEVEL_NONE    0
+#define FWK_LOG_LEVEL_ERROR   1
+#define FWK_LOG_LEVEL_DEBUG   2
+#define FWK_LOG_LEVEL_INFO    3
+#define FWK_LOG_LEVEL_VERBOSE 4
+
+/* Compile time log level, the macros of the more verbose levels expand to nothing.
+ * The runtime level set with FWK_Config_SetLogLevel can only reduce it further. */
+#ifndef FWK_LOG_MIN_LEVEL
+#define FWK_LOG_MIN_LEVEL FWK_LOG_LEVEL_VERBOSE
+#endif /* FWK_LOG_MIN_LEVEL */
+
+/* Store the debug, info and verbose messages as binary records formatted by the logging task.
+ * Messages with %s or floating point conversions are still formatted by the caller. */
+#ifndef FWK_LOG_DEFERRED
+#define FWK_LOG_DEFERRED 1
+#endif /* FWK_LOG_DEFERRED */
+
+#if FWK_LOG_DEFERRED
+#define FWK_LOG_PRINT(deferred, print, fmt, args...) \
+    if (deferred(fmt, ##args) == pdFALSE)            \
+    {                                                \
+        print(fmt, ##args);                          \
+    }
+
+#define FWK_LOG_PRINT_ISR(deferred, fmt, args...) \
+    if (deferred(fmt, ##args) == pdFALSE)         \
+    {                                             \
+        PRINTF(fmt, ##args);                      \
+        PRINTF("\r\n");                           \
+    }
+#else
+#define FWK_LOG_PRINT(deferred, print, fmt, args...) print(fmt, ##args)
+
+#define FWK_LOG_PRINT_ISR(deferred, fmt, args...) \
+    {                                             \
+        PRINTF(fmt, ##args);                      \
+        PRINTF("\r\n");                           \
+    }
+#endif /* FWK_LOG_DEFERRED */
+
 #ifndef LOGISRV
-#define LOGISRV(fmt, args...)                              \
-    {                                                      \
-        if (FWK_Config_GetLogLevel() >= kLOGLevel_Verbose) \
-        {                                                  \
-            {                                              \
-                PRINTF(fmt, ##args);                       \
-                PRINTF("\r\n");                            \
-            }                                              \
-        }                                                  \
+#if FWK_LOG_MIN_LEVEL >= FWK_LOG_LEVEL_VERBOSE
+#define LOGISRV(fmt, args...)                                           \
+    {                                                                   \
+        if (FWK_Config_GetLogLevel() >= kLOGLevel_Verbose)              \
+        {                                                               \
+            FWK_LOG_PRINT_ISR(xLoggingPrintfDeferredInfo, fmt, ##args); \
+        }                                                               \
     }
+#else
+#define LOGISRV(...)
+#endif
 #endif /* LOGISRV */
 
 #ifndef LOGV
-#define LOGV(fmt, args...)                                 \
-    {                                                      \
-        if (FWK_Config_GetLogLevel() >= kLOGLevel_Verbose) \
-        {                                                  \
-            {                                              \
-                vLoggingPrintfInfo(fmt, ##args);           \
-            }                                              \
-        }                                                  \
+#if FWK_LOG_MIN_LEVEL >= FWK_LOG_LEVEL_VERBOSE
+#define LOGV(fmt, args...)                                                              \
+    {                                                                                   \
+        if (FWK_Config_GetLogLevel() >= kLOGLevel_Verbose)                              \
+        {                                                                               \
+            FWK_LOG_PRINT(xLoggingPrintfDeferredInfo, vLoggingPrintfInfo, fmt, ##args); \
+        }                                                                               \
     }
+#else
+#define LOGV(...)
+#endif
 #endif
 
 #ifndef LOGISRD
-#define LOGISRD(fmt, args...)                            \
-    {                                                    \
-        if (FWK_Config_GetLogLevel() >= kLOGLevel_Debug) \
-        {                                                \
-            {                                            \
-                PRINTF(fmt, ##args);                     \
-                PRINTF("\r\n");                          \
-            }                                            \
-        }                                                \
+#if FWK_LOG_MIN_LEVEL >= FWK_LOG_LEVEL_DEBUG
+#define LOGISRD(fmt, args...)                                            \
+    {                                                                    \
+        if (FWK_Config_GetLogLevel() >= kLOGLevel_Debug)                 \
+        {                                                                \
+            FWK_LOG_PRINT_ISR(xLoggingPrintfDeferredDebug, fmt, ##args); \
+        }                                                                \
     }
+#else
+#define LOGISRD(...)
+#endif
 #endif /* LOGISRD */
 
 #ifndef LOGD
-#define LOGD(fmt, args...)                               \
-    {                                                    \
-        if (FWK_Config_GetLogLevel() >= kLOGLevel_Debug) \
-        {                                                \
-            {                                            \
-                vLoggingPrintfDebug(fmt, ##args);        \
-            }                                            \
-        }                                                \
+#if FWK_LOG_MIN_LEVEL >= FWK_LOG_LEVEL_DEBUG
+#define LOGD(fmt, args...)                                                                \
+    {                                                                                     \
+        if (FWK_Config_GetLogLevel() >= kLOGLevel_Debug)                                  \
+        {                                                                                 \
+            FWK_LOG_PRINT(xLoggingPrintfDeferredDebug, vLoggingPrintfDebug, fmt, ##args); \
+        }                                                                                 \
     }
+#else
+#define LOGD(...)
+#endif
 #endif
 
 #ifndef LOGISRI
-#define LOGISRI(fmt, args...)                           \
-    {                                                   \
-        if (FWK_Config_GetLogLevel() >= kLOGLevel_Info) \
-        {                                               \
-            {                                           \
-                PRINTF(fmt, ##args);                    \
-                PRINTF("\r\n");                         \
-            }                                           \
-        }                                               \
+#if FWK_LOG_MIN_LEVEL >= FWK_LOG_LEVEL_INFO
+#define LOGISRI(fmt, args...)                                           \
+    {                                                                   \
+        if (FWK_Config_GetLogLevel() >= kLOGLevel_Info)                 \
+        {                                                               \
+            FWK_LOG_PRINT_ISR(xLoggingPrintfDeferredInfo, fmt, ##args); \
+        }                                                               \
     }
+#else
+#define LOGISRI(...)
+#endif
 #endif /* LOGISRI */
 
 #ifndef LOGI
-#define LOGI(fmt, args...)                              \
-    {                                                   \
-        if (FWK_Config_GetLogLevel() >= kLOGLevel_Info) \
-        {                                               \
-            {                                           \
-                vLoggingPrintfInfo(fmt, ##args);        \
-            }                                           \
-        }                                               \
+#if FWK_LOG_MIN_LEVEL >= FWK_LOG_LEVEL_INFO
+#define LOGI(fmt, args...)                                                              \
+    {                                                                                   \
+        if (FWK_Config_GetLogLevel() >= kLOGLevel_Info)                                 \
+        {                                                                               \
+            FWK_LOG_PRINT(xLoggingPrintfDeferredInfo, vLoggingPrintfInfo, fmt, ##args); \
+        }                                                                               \
     }
+#else
+#define LOGI(...)
+#endif
 #endif
 
+/* Errors are rare and formatted right away so they are not lost on a crash */
 #ifndef LOGISRE
+#if FWK_LOG_MIN_LEVEL >= FWK_LOG_LEVEL_ERROR
 #define LOGISRE(fmt, args...)                                                       \
     {                                                                               \
         if (FWK_Config_GetLogLevel() >= kLOGLevel_Error)                            \
@@ -134,9 +187,13 @@ extern "C" {
             }                                                                       \
         }                                                                           \
     }
+#else
+#define LOGISRE(...)
+#endif
 #endif /* LOGISRI */
 
 #ifndef LOGE
+#if FWK_LOG_MIN_LEVEL >= FWK_LOG_LEVEL_ERROR
 #define LOGE(fmt, args...)                                                                       \
     {                                                                                            \
         if (FWK_Config_GetLogLevel() >= kLOGLevel_Error)                                         \
@@ -149,6 +206,9 @@ extern "C" {
             }                                                                                    \
         }                                                                                        \
     }
+#else
+#define LOGE(...)
+#endif
 #endif
 
 #else
@@ -16,6 +16,81 @@
 
 #include "hal_lpm_dev.h"
 
+/* Sleep policy: keep for each hour of the day a histogram of the idle times between two uses of the device, and pick
+ * the sleep mode and the idle time before sleeping which cost the least: the energy spent plus the wake up latency
+ * seen by the user. 0 to sleep as soon as no request is pending, in the mode set with FWK_LpmManager_SetSleepMode */
+#ifndef FWK_LPM_POLICY
+#define FWK_LPM_POLICY 1
+#endif /* FWK_LPM_POLICY */
+
+/* Idle times tried before sleeping, in ms, increasing from 0. They are the bounds of the histogram bins too */
+#ifndef FWK_LPM_POLICY_TIMEOUTS_MS
+#define FWK_LPM_POLICY_TIMEOUTS_MS {0, 5000, 15000, 30000, 60000, 120000}
+#endif /* FWK_LPM_POLICY_TIMEOUTS_MS */
+
+/* Power drawn while idle but awake, in mW */
+#ifndef FWK_LPM_POLICY_IDLE_MW
+#define FWK_LPM_POLICY_IDLE_MW 1000
+#endif /* FWK_LPM_POLICY_IDLE_MW */
+
+/* Power drawn in each mode, energy and latency of a wake up from each mode, in the order of hal_lpm_mode_t. Rough
+ * figures of the board, the SNVS wake up is a cold boot up to the first recognition */
+#ifndef FWK_LPM_POLICY_SLEEP_MW
+#define FWK_LPM_POLICY_SLEEP_MW {1, 450}
+#endif /* FWK_LPM_POLICY_SLEEP_MW */
+
+#ifndef FWK_LPM_POLICY_WAKE_MJ
+#define FWK_LPM_POLICY_WAKE_MJ {1500, 20}
+#endif /* FWK_LPM_POLICY_WAKE_MJ */
+
+#ifndef FWK_LPM_POLICY_WAKE_MS
+#define FWK_LPM_POLICY_WAKE_MS {1500, 100}
+#endif /* FWK_LPM_POLICY_WAKE_MS */
+
+/* Energy a second of wake up latency is worth, in mJ. Higher favours the light modes and the long idle times */
+#ifndef FWK_LPM_POLICY_LATENCY_MJ_PER_S
+#define FWK_LPM_POLICY_LATENCY_MJ_PER_S 3000
+#endif /* FWK_LPM_POLICY_LATENCY_MJ_PER_S */
+
+/* Idle times kept in the histogram of an hour, the older half is forgotten past this count */
+#ifndef FWK_LPM_POLICY_HISTORY
+#define FWK_LPM_POLICY_HISTORY 64
+#endif /* FWK_LPM_POLICY_HISTORY */
+
+/* Idle time of an hour without history, and of a wake up from a reset when no wall clock is set, in s */
+#ifndef FWK_LPM_POLICY_PRIOR_S
+#define FWK_LPM_POLICY_PRIOR_S (3 * 3600)
+#endif /* FWK_LPM_POLICY_PRIOR_S */
+
+/* Without a clock, every this many idle periods wait one step longer than picked before sleeping, 0 to never */
+#ifndef FWK_LPM_POLICY_EXPLORE
+#define FWK_LPM_POLICY_EXPLORE 8
+#endif /* FWK_LPM_POLICY_EXPLORE */
+
+#define FWK_LPM_POLICY_HOURS 24
+
+/**
+ * @brief Steps from the wake up to the first decision, in the order they are expected. The managers and the devices
+ * mark them as they reach them, only the first mark of each step after the boot is kept
+ */
+typedef enum _fwk_lpm_resume_stage
+{
+    kFWKLpmResume_CameraInit = 0, /* camera devices initialized */
+    kFWKLpmResume_CameraStarted,  /* camera devices streaming */
+    kFWKLpmResume_AlgoModel,      /* vision algorithm models loaded */
+    kFWKLpmResume_FaceDb,         /* face database loaded */
+    kFWKLpmResume_AlgoReady,      /* vision algo devices initialized, frames requested */
+    kFWKLpmResume_FirstFrame,     /* first camera frame dequeued */
+    kFWKLpmResume_FirstResult,    /* first result of the vision algorithm */
+    kFWKLpmResume_Decision,       /* first recognition success or timeout */
+    kFWKLpmResume_Count
+} fwk_lpm_resume_stage_t;
+
+typedef struct _fwk_lpm_resume_timeline
+{
+    unsigned int markUs[kFWKLpmResume_Count]; /* FWK_CurrentTimeUs() of each step, 0 if not reached yet */
+} fwk_lpm_resume_timeline_t;
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -28,7 +103,7 @@ int FWK_LpmManager_Init();
 
 /**
  * @brief call init/start for all registered camera devices
- * @param taskPriority unused
+ * @param taskPriority priority of the task saving the sleep policy history before a power off
  * @return int Return 0 if the starting process was successul
  */
 int FWK_LpmManager_Start(int taskPriority);
@@ -63,6 +138,28 @@ int FWK_LpmManager_SetSleepMode(hal_lpm_mode_t sleepMode);
  */
 int FWK_LpmManager_EnableSleepMode(hal_lpm_manager_status_t enable);
 
+/**
+ * @brief Mark a step of the resume timeline, the timeline is printed once the decision is marked
+ * @param stage step reached, marks of a step already reached are ignored
+ */
+void FWK_LpmManager_ResumeMark(fwk_lpm_resume_stage_t stage);
+
+/**
+ * @brief Get the resume timeline of the current boot
+ * @param pTimeline filled with the time of the steps reached so far
+ * @return int Return 0 if successful
+ */
+int FWK_LpmManager_GetResumeTimeline(fwk_lpm_resume_timeline_t *pTimeline);
+
+/**
+ * @brief Set the wall clock the sleep policy sorts the idle times by hour with. Without it the policy keeps a single
+ * histogram for the whole day. The idle time spent powered off before this boot is recorded when the clock is set.
+ * The manager sets it at start from the getClock operator of the lpm device, if any
+ * @param seconds seconds since 1970-01-01 00:00:00 local time
+ * @return int Return 0 if successful
+ */
+int FWK_LpmManager_PolicySetClock(uint32_t seconds);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2022 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/*
+ * @brief Framework memory placement declaration. Large buffers are allocated from or recorded against named memory
+ * regions, so their tier, their share of each region and the budget of each subsystem can be checked at boot.
+ */
+
+#ifndef _FWK_MEMORY_H_
+#define _FWK_MEMORY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Build with FWK_MEMORY_HOST to back the regions with plain arrays, the cache maintenance is then a no-op */
+
+/*! @brief Memory regions of the board, from the fastest to the slowest */
+typedef enum _fwk_mem_region
+{
+    kFWKMemRegion_DTCM = 0,      /* tightly coupled, never cached */
+    kFWKMemRegion_OcramCached,   /* on chip RAM behind the data cache */
+    kFWKMemRegion_OcramUncached, /* on chip RAM for DMA descriptors and small DMA buffers */
+    kFWKMemRegion_SdramCached,   /* SDRAM behind the data cache, holds the FreeRTOS heap */
+    kFWKMemRegion_SdramUncached, /* SDRAM for the camera and display frame buffers */
+    kFWKMemRegion_Count,
+    kFWKMemRegion_Invalid = kFWKMemRegion_Count,
+} fwk_mem_region_t;
+
+/*! @brief Subsystems the memory is accounted to */
+typedef enum _fwk_mem_owner
+{
+    kFWKMemOwner_Camera = 0,
+    kFWKMemOwner_Display,
+    kFWKMemOwner_VisionAlgo,
+    kFWKMemOwner_VoiceAlgo,
+    kFWKMemOwner_Graphics,
+    kFWKMemOwner_Flash,
+    kFWKMemOwner_Input,
+    kFWKMemOwner_App,
+    kFWKMemOwner_Count,
+} fwk_mem_owner_t;
+
+/*! @brief Arena of each region, carved from the region at link time. 0 disables the arena of the region */
+#ifndef FWK_MEM_ARENA_SIZE_DTCM
+#define FWK_MEM_ARENA_SIZE_DTCM 0
+#endif /* FWK_MEM_ARENA_SIZE_DTCM */
+
+#ifndef FWK_MEM_ARENA_SIZE_OCRAM_CACHED
+#define FWK_MEM_ARENA_SIZE_OCRAM_CACHED 0
+#endif /* FWK_MEM_ARENA_SIZE_OCRAM_CACHED */
+
+#ifndef FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED
+#define FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED 0
+#endif /* FWK_MEM_ARENA_SIZE_OCRAM_UNCACHED */
+
+#ifndef FWK_MEM_ARENA_SIZE_SDRAM_CACHED
+#define FWK_MEM_ARENA_SIZE_SDRAM_CACHED 0
+#endif /* FWK_MEM_ARENA_SIZE_SDRAM_CACHED */
+
+#ifndef FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED
+#define FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED 0
+#endif /* FWK_MEM_ARENA_SIZE_SDRAM_UNCACHED */
+
+/*! @brief Buffers which can be recorded at the same time */
+#ifndef FWK_MEM_MAX_BUFFERS
+#define FWK_MEM_MAX_BUFFERS 48
+#endif /* FWK_MEM_MAX_BUFFERS */
+
+/*! @brief Delay after the start of the framework before the usage is reported, the devices are initialized by then */
+#ifndef FWK_MEM_REPORT_DELAY_MS
+#define FWK_MEM_REPORT_DELAY_MS 5000
+#endif /* FWK_MEM_REPORT_DELAY_MS */
+
+/*! @brief Cache line size, buffers shared with a DMA in a cached region are aligned to it */
+#define FWK_MEM_CACHE_LINE 32
+
+/*! @brief Check the buffers handed to the devices, a CPU access while a device owns a buffer is reported. The check
+ * sums every buffer a device reads, keep it for debug builds */
+#ifndef FWK_MEM_CHECK_OWNERSHIP
+#define FWK_MEM_CHECK_OWNERSHIP 0
+#endif /* FWK_MEM_CHECK_OWNERSHIP */
+
+/*! @brief Buffers which can be owned by a device at the same time when the ownership is checked */
+#ifndef FWK_MEM_MAX_HANDOFFS
+#define FWK_MEM_MAX_HANDOFFS 16
+#endif /* FWK_MEM_MAX_HANDOFFS */
+
+/*! @brief What a device does with a buffer it is given */
+typedef enum _fwk_mem_access
+{
+    kFWKMemAccess_DeviceReads = 0, /* the display scans the buffer out */
+    kFWKMemAccess_DeviceWrites,    /* the camera fills the buffer */
+} fwk_mem_access_t;
+
+/**
+ * @brief Set the budget of a subsystem in a region. The budgets are only checked, they never fail an allocation.
+ * @param owner Subsystem the budget is for
+ * @param region Region the budget is for
+ * @param size Bytes the subsystem is expected to use in the region, 0 for no budget
+ * @return int Return 0 if the budget was set
+ */
+int FWK_Memory_SetBudget(fwk_mem_owner_t owner, fwk_mem_region_t region, uint32_t size);
+
+/**
+ * @brief Allocate a buffer from the arena of a region. Arenas are meant for buffers which live as long as the
+ * application, the memory is never given back.
+ * @param region Region to allocate from
+ * @param owner Subsystem the buffer is accounted to
+ * @param size Size of the buffer
+ * @param align Alignment of the buffer, a power of 2. Use FWK_MEM_CACHE_LINE for a DMA buffer in a cached region
+ * @param name Name shown in the report, the string must stay valid
+ * @return void* The buffer, NULL if the arena is too small
+ */
+void *FWK_Memory_Alloc(fwk_mem_region_t region, fwk_mem_owner_t owner, uint32_t size, uint32_t align, const char *name);
+
+/**
+ * @brief Record a buffer placed by a section macro or allocated from the heap, so it is accounted and its placement
+ * is checked. A buffer outside the expected region is reported as an error.
+ * @param region Region the buffer is expected in
+ * @param owner Subsystem the buffer is accounted to
+ * @param buf The buffer
+ * @param size Size of the buffer
+ * @param name Name shown in the report, the string must stay valid
+ * @return int Return 0 if the buffer is in the expected region
+ */
+int FWK_Memory_Track(fwk_mem_region_t region, fwk_mem_owner_t owner, const void *buf, uint32_t size, const char *name);
+
+/**
+ * @brief Stop accounting a buffer recorded with FWK_Memory_Track, before it is freed
+ * @param buf The buffer
+ */
+void FWK_Memory_Untrack(const void *buf);
+
+/**
+ * @brief Find the region holding an address
+ * @param buf The address
+ * @return fwk_mem_region_t The region, kFWKMemRegion_Invalid for an address outside the known regions
+ */
+fwk_mem_region_t FWK_Memory_RegionOf(const void *buf);
+
+/**
+ * @brief Write the cached lines of a buffer back to memory before a DMA reads it. Nothing is done for a buffer in a
+ * region which is not cached.
+ * @param buf The buffer
+ * @param size Size of the buffer
+ */
+void FWK_Memory_CleanCache(const void *buf, uint32_t size);
+
+/**
+ * @brief Drop the cached lines of a buffer after a DMA wrote it. Nothing is done for a buffer in a region which is not
+ * cached. The lines shared with a neighbour buffer are lost, align the DMA buffers to FWK_MEM_CACHE_LINE.
+ * @param buf The buffer
+ * @param size Size of the buffer
+ */
+void FWK_Memory_InvalidateCache(const void *buf, uint32_t size);
+
+/**
+ * @brief Write back and drop the cached lines of a buffer. Safe on a range larger than the buffer, the lines of the
+ * neighbour buffers are written back before they are dropped.
+ * @param buf The buffer
+ * @param size Size of the buffer
+ */
+void FWK_Memory_CleanInvalidateCache(const void *buf, uint32_t size);
+
+/**
+ * @brief Hand a buffer to a device. The CPU writes are made visible to the device and, for a buffer the device
+ * writes, the cached lines are dropped so no eviction can overwrite the device data. The CPU must not access the
+ * buffer until it is taken back.
+ * @param buf The buffer
+ * @param size Size of the buffer
+ * @param access What the device does with the buffer
+ */
+void FWK_Memory_GiveToDevice(const void *buf, uint32_t size, fwk_mem_access_t access);
+
+/**
+ * @brief Take a buffer back from a device. For a buffer the device wrote, the lines the CPU may have fetched in the
+ * meantime are dropped so the CPU reads what the device wrote.
+ * @param buf The buffer
+ * @param size Size of the buffer
+ * @param access What the device did with the buffer
+ */
+void FWK_Memory_TakeFromDevice(const void *buf, uint32_t size, fwk_mem_access_t access);
+
+/**
+ * @brief Check the CPU can access a buffer, does nothing unless FWK_MEM_CHECK_OWNERSHIP is set
+ * @param buf The buffer
+ * @param size Size of the buffer
+ * @param who Name of the code accessing the buffer, for the report
+ * @return int Return 0 if no device owns a part of the buffer
+ */
+int FWK_Memory_CheckCpuAccess(const void *buf, uint32_t size, const char *who);
+
+/**
+ * @brief Log the usage of every region and every subsystem against its budget, and the misplaced buffers
+ */
+void FWK_Memory_Report(void);
+
+/**
+ * @brief Name of a region
+ * @param region The region
+ * @return const char* Name of the region
+ */
+const char *FWK_Memory_RegionName(fwk_mem_region_t region);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* _FWK_MEMORY_H_ */
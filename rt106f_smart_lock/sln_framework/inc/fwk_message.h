@@ -63,6 +63,47 @@ typedef enum _fwk_message_id
 
 } fwk_message_id_t;
 
+/*! @brief Messages queued per lane of a task */
+#ifndef FWK_MESSAGE_LANE_LENGTH
+#define FWK_MESSAGE_LANE_LENGTH 10
+#endif /* FWK_MESSAGE_LANE_LENGTH */
+
+/*! @brief Longest a task waits for room in a lane with the block policy */
+#ifndef FWK_MESSAGE_BLOCK_MS
+#define FWK_MESSAGE_BLOCK_MS 20
+#endif /* FWK_MESSAGE_BLOCK_MS */
+
+/*! @brief Priority lanes of a task queue, a task always drains the higher lanes first */
+typedef enum _fwk_message_prio
+{
+    kFWKMessagePrio_Control = 0, /* input, lpm and configuration messages */
+    kFWKMessagePrio_Result,      /* algorithm results and overlays */
+    kFWKMessagePrio_Frame,       /* frame and audio traffic */
+    kFWKMessagePrio_Count
+} fwk_message_prio_t;
+
+#define FWK_MESSAGE_QUEUE_LENGTH (FWK_MESSAGE_LANE_LENGTH * kFWKMessagePrio_Count)
+
+/*! @brief What to do when a message finds its lane full */
+typedef enum _fwk_message_drop_policy
+{
+    kFWKMessageDrop_Newest = 0, /* reject the incoming message */
+    kFWKMessageDrop_Oldest,     /* evict the oldest message of the lane */
+    kFWKMessageDrop_Block,      /* wait up to FWK_MESSAGE_BLOCK_MS for room, then reject */
+} fwk_message_drop_policy_t;
+
+/*! @brief Statistics of a task queue lane */
+typedef struct _fwk_message_stats
+{
+    uint32_t put;          /* messages queued */
+    uint32_t coalesced;    /* messages merged into a queued one of the same type and device */
+    uint32_t evicted;      /* queued messages dropped for a newer one */
+    uint32_t dropped;      /* incoming messages rejected */
+    uint32_t maxLatencyMs; /* longest time a message waited in the lane */
+    uint8_t depth;         /* messages currently queued */
+    uint8_t peak;          /* deepest the lane has been */
+} fwk_message_stats_t;
+
 /*! @brief Structure of a frame request message */
 typedef struct
 {
@@ -84,6 +125,8 @@ typedef struct
     pixel_format_t format;
     /* the source pixel format of the requested frame */
     pixel_format_t srcFormat;
+    /* region requested by a vision algorithm, region delivered in the response */
+    frame_roi_t roi;
 } frame_msg_payload_t;
 
 /*! @brief Structure of a graphics message */
@@ -92,6 +135,15 @@ typedef struct
     gfx_surface_t *pSurface;
 } overlay_msg_payload_t;
 
+/*! @brief Structure of a vision result message */
+typedef struct
+{
+    /* the result is read with FWK_VisionAlgoManager_GetLatestResult instead of data */
+    unsigned char latest;
+    /* one-shot result in data, never merged with nor dropped for a newer result */
+    unsigned char oneShot;
+} result_msg_payload_t;
+
 /*! @brief Structure of an input message */
 typedef struct
 {
@@ -113,6 +165,8 @@ typedef struct _multicore_info
     unsigned char wasMulticoreMessage;
     /* Manager to which the message needs to be send on the other core*/
     fwk_task_id_t taskId;
+    /* The payload belongs to the message while it is shared, receivers must not free it */
+    unsigned char ownsPayload;
 } multicore_info_t;
 
 typedef struct
@@ -126,6 +180,7 @@ typedef struct
         frame_msg_payload_t frame;
         input_msg_payload_t input;
         overlay_msg_payload_t overlay;
+        result_msg_payload_t result;
         framework_request_t frameworkRequest;
     };
 } msg_payload_t;
@@ -135,6 +190,8 @@ typedef struct
 {
     fwk_message_id_t id;
     unsigned char freeAfterConsumed;
+    /* Queues still holding a shared message, the last one to release it frees it */
+    unsigned char refCount;
 #if FWK_SUPPORT_MULTICORE
     multicore_info_t multicore;
 #endif /* FWK_SUPPORT_MULTICORE */
@@ -152,7 +209,7 @@ int FWK_Message_Init();
 /**
  * @brief Register a message queue and assigned it to a taskid
  * @param taskId Id of the task that owns the queue
- * @param queueHandle Queue Handle of the queue that will be linked with the task
+ * @param queueHandle Counting semaphore of FWK_MESSAGE_QUEUE_LENGTH the task waits on, given once per queued message
  * @return BaseType_t pdTRUE if the registration was done
  */
 BaseType_t FWK_Message_RegisterQueue(fwk_task_id_t taskId, QueueHandle_t queueHandle);
@@ -165,6 +222,22 @@ BaseType_t FWK_Message_RegisterQueue(fwk_task_id_t taskId, QueueHandle_t queueHa
  */
 BaseType_t FWK_Message_Put(fwk_task_id_t taskId, fwk_message_t **ppMsg);
 
+/**
+ * @brief Deliver the same message to several tasks. The message is not copied, every receiver gets a reference and
+ * must treat the message and its payload as read-only, the last one to release it frees it. Task context only.
+ * @param receiverList Bit mask of the receiver task ids, tasks without a queue are skipped
+ * @param pMsg Pointer to a message allocated with FWK_MALLOC and freeAfterConsumed set, it belongs to the receivers
+ * once the function returns unless -1 is returned
+ * @return int Number of tasks the message was delivered to, -1 if the message can't be shared
+ */
+int FWK_Message_Broadcast(uint32_t receiverList, fwk_message_t *pMsg);
+
+/**
+ * @brief Release a message after it was handled. A message delivered to several tasks is freed by the last one.
+ * @param pMsg Pointer to a message structure
+ */
+void FWK_Message_Release(fwk_message_t *pMsg);
+
 /**
  * @brief Fetch the message from the task queue
  * @param taskId Id of the task that owns the queue
@@ -173,6 +246,29 @@ BaseType_t FWK_Message_Put(fwk_task_id_t taskId, fwk_message_t **ppMsg);
  */
 BaseType_t FWK_Message_Get(fwk_task_id_t taskId, fwk_message_t **ppMsg);
 
+/**
+ * @brief Fetch the message from the task queue and tell how long it was queued
+ * @param taskId Id of the task that owns the queue
+ * @param ppMsg Double pointer to a message structure
+ * @param pQueuedUs Time the message spent in the queue, can be NULL
+ * @return BaseType_t pdTRUE if a message was fetched
+ */
+BaseType_t FWK_Message_GetTimed(fwk_task_id_t taskId, fwk_message_t **ppMsg, unsigned int *pQueuedUs);
+
+/**
+ * @brief Get the number of messages waiting in the task queue
+ * @param taskId Id of the task that owns the queue
+ * @return UBaseType_t Messages queued in all the lanes
+ */
+UBaseType_t FWK_Message_Pending(fwk_task_id_t taskId);
+
+/**
+ * @brief Tell if a task registered its message queue
+ * @param taskId Id of the task that owns the queue
+ * @return bool true if messages can be put to the task
+ */
+bool FWK_Message_IsRegistered(fwk_task_id_t taskId);
+
 /**
  * @brief Add the message into the task queue from and irq context
  * @param taskId Id of the task that owns the queue
@@ -183,6 +279,30 @@ BaseType_t FWK_Message_PutFromIsr(fwk_task_id_t taskId, fwk_message_t **ppMsg);
 
 const char *FWK_Message_Name(fwk_message_id_t id);
 
+/**
+ * @brief Change how a message type is queued to the framework tasks, the app tasks keep a fifo
+ * @param id Id of the message
+ * @param prio Lane the message is queued in
+ * @param policy What to do when the lane is full
+ * @param coalesce Merge the message with a queued one of the same type and device
+ * @return int Return 0 if the policy was changed
+ */
+int FWK_Message_SetPolicy(fwk_message_id_t id, fwk_message_prio_t prio, fwk_message_drop_policy_t policy, bool coalesce);
+
+/**
+ * @brief Get the statistics of a task queue lane
+ * @param taskId Id of the task that owns the queue
+ * @param prio Lane of the queue
+ * @param pStats Statistics of the lane
+ * @return int Return 0 if the task has a queue
+ */
+int FWK_Message_GetStats(fwk_task_id_t taskId, fwk_message_prio_t prio, fwk_message_stats_t *pStats);
+
+/**
+ * @brief Clear the counters of all the task queues
+ */
+void FWK_Message_ResetStats(void);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -16,6 +16,17 @@
 
 #include "hal_multicore_dev.h"
 
+/*! @brief Cross-core traffic counters, divide by the frames processed to get the cost per frame */
+typedef struct _fwk_multicore_stats
+{
+    uint32_t sent;        /* messages sent to the other core */
+    uint32_t received;    /* messages received from the other core */
+    uint32_t copies;      /* messages serialized with their payload */
+    uint32_t sendErrors;  /* messages the device could not send */
+    uint64_t bytesCopied; /* bytes copied to serialize and deserialize the messages */
+    uint64_t bytesSent;   /* bytes handed to the device */
+} fwk_multicore_stats_t;
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -43,6 +54,18 @@ int FWK_MulticoreManager_Start(int taskPriority);
 
 int FWK_MulticoreManager_Deinit();
 
+/**
+ * @brief Get the cross-core traffic counters
+ * @param pStats Pointer to the counters
+ * @return int Return 0 if the counters were copied
+ */
+int FWK_MulticoreManager_GetStats(fwk_multicore_stats_t *pStats);
+
+/**
+ * @brief Clear the cross-core traffic counters
+ */
+void FWK_MulticoreManager_ResetStats(void);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -21,6 +21,34 @@
 extern "C" {
 #endif
 
+/*! @brief Messages handled in a row before the task yields to the tasks of the same priority */
+#ifndef FWK_TASK_BATCH_LENGTH
+#define FWK_TASK_BATCH_LENGTH 8
+#endif /* FWK_TASK_BATCH_LENGTH */
+
+/*! @brief Upper bounds in us of the time histogram buckets, the last bucket has no bound */
+#define FWK_TASK_HIST_BOUNDS_US {100, 500, 1000, 5000, 10000, 50000, 100000}
+#define FWK_TASK_HIST_BUCKETS 8
+
+typedef enum _fwk_task_mode
+{
+    kFWKTaskMode_Default = 0, /* FixedDelay with FWK_SUPPORT_TASK_FIXED_DELAY, EventDriven otherwise */
+    kFWKTaskMode_EventDriven, /* drain the queue in batches, only block when it is empty */
+    kFWKTaskMode_FixedDelay,  /* sleep delayMs after every message */
+} fwk_task_mode_t;
+
+/*! @brief Runtime statistics of a framework task */
+typedef struct _fwk_task_stats
+{
+    uint32_t messages;                           /* messages handled */
+    uint32_t batches;                            /* batches of messages handled between two waits */
+    uint32_t budgetOverruns;                     /* handlers running longer than budgetUs */
+    uint32_t maxHandlerUs;                       /* longest handler */
+    uint32_t utilization;                        /* time spent in the handlers in percent */
+    uint32_t waitHist[FWK_TASK_HIST_BUCKETS];    /* time the messages spent queued */
+    uint32_t handlerHist[FWK_TASK_HIST_BUCKETS]; /* time spent handling a message */
+} fwk_task_stats_t;
+
 typedef struct
 {
     QueueHandle_t queueHandle;
@@ -35,12 +63,20 @@ typedef struct
     StaticTask_t *taskBuffer;
     void (*msgHandle)(fwk_message_t *, fwk_task_data_t *);
     int (*taskInit)(fwk_task_data_t *);
+    fwk_task_mode_t mode;
+    /* time a message handler is expected to take, 0 for no budget */
+    uint32_t budgetUs;
 } fwk_task_t;
 
 void FWK_Task_Start(fwk_task_t *pTask, const char *taskName, int taskStackSize, int taskPriority);
 int FWK_Task_GetInfo(fwk_task_id_t taskId, char **name, uint32_t *priority);
 int FWK_Task_GetCount(uint8_t *count);
 bool FWK_Task_IsRegistered(fwk_task_id_t taskId);
+/* priorities in the numbering of FWK_Task_Start, smaller is higher */
+int FWK_Task_GetPriority(fwk_task_id_t taskId, int *taskPriority);
+int FWK_Task_SetPriority(fwk_task_id_t taskId, int taskPriority);
+int FWK_Task_GetStats(fwk_task_id_t taskId, fwk_task_stats_t *pStats);
+void FWK_Task_ResetStats(void);
 
 #if defined(__cplusplus)
 }
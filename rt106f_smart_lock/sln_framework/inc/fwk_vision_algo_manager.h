@@ -16,6 +16,14 @@
 
 #include "hal_valgo_dev.h"
 
+/*! @brief Result path counters, divide by the frames processed to get the cost per frame */
+typedef struct _vision_algo_result_stats
+{
+    uint32_t published; /* results copied to the result slots */
+    uint32_t skipped;   /* results replaced by a newer one, or dropped behind a one-shot one, before they were read */
+    uint32_t allocated; /* results that did not use the slots and were copied to the heap */
+} vision_algo_result_stats_t;
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -46,6 +54,29 @@ int FWK_VisionAlgoManager_Start(int taskPriority);
  */
 int FWK_VisionAlgoManager_Deinit();
 
+/**
+ * @brief Get the latest result copied by a vision algorithm device. The results are triple buffered per device,
+ * the device never waits for the reader and a result replaced before it was read is skipped. A one-shot result is
+ * kept until it is read, the results published meanwhile are skipped.
+ * Only the output manager reads the results.
+ * @param devId Id of the vision algorithm device
+ * @param pSequence Sequence number of the result, can be NULL
+ * @return void* Result valid until the next call for the same device, NULL if no newer result was published
+ */
+void *FWK_VisionAlgoManager_GetLatestResult(int devId, unsigned int *pSequence);
+
+/**
+ * @brief Get the result path counters
+ * @param pStats Pointer to the counters
+ * @return int Return 0 if the counters were copied
+ */
+int FWK_VisionAlgoManager_GetResultStats(vision_algo_result_stats_t *pStats);
+
+/**
+ * @brief Clear the result path counters
+ */
+void FWK_VisionAlgoManager_ResetResultStats(void);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -178,6 +178,11 @@ standard names. */
  * and a time stamp. */
 #define configLOGGING_INCLUDE_TIME_AND_TASK_NAME 1
 
+/* Number of binary log records waiting for the logging task, 0 disables the
+ * deferred logging. The logging task drains them every DRAIN_MS at most. */
+#define configLOGGING_DEFERRED_LENGTH   128
+#define configLOGGING_DEFERRED_DRAIN_MS 10
+
 #define configINCLUDE_FREERTOS_TASK_C_ADDITIONS_H 1
 
 #endif /* FREERTOS_CONFIG_H */
@@ -14,6 +14,8 @@
 #ifndef APP_CONFIG_H_
 #define APP_CONFIG_H_
 
+#include <stdbool.h>
+
 #include "board_define.h"
 #include "fwk_common.h"
 #include "hal_camera_dev.h"
@@ -97,7 +99,27 @@ int HAL_CameraDev_FlexioGc0308_Register(camera_dev_static_config_t *config);
 #define CAMERA_CSI_SHARED_DUAL_FLIP                kFlipMode_None
 #define CAMERA_CSI_SHARED_DUAL_SWAPBYTE            1
 
+/* RGB and IR frames received in a row before switching the sensor, 0 stops the stream.
+ * The idle ratio is used until the vision algorithm reports a face, the face ratio after. */
+#define CAMERA_CSI_SHARED_DUAL_IDLE_RGB_FRAMES 1
+#define CAMERA_CSI_SHARED_DUAL_IDLE_IR_FRAMES  1
+#define CAMERA_CSI_SHARED_DUAL_FACE_RGB_FRAMES 1
+#define CAMERA_CSI_SHARED_DUAL_FACE_IR_FRAMES  1
+/* Frames dropped after a switch, the first one mixes both sensors */
+#define CAMERA_CSI_SHARED_DUAL_DISCARD_FRAMES 1
+
+/*! @brief Shared dual camera counters, RGB stream first */
+typedef struct _csi_shared_dual_stats
+{
+    uint32_t frames[2];    /* frames delivered per stream */
+    uint32_t discarded[2]; /* frames dropped after a switch to the stream */
+    uint32_t switches;     /* sensor switches issued */
+    float fps[2];          /* frames delivered per stream in the last second */
+} csi_shared_dual_stats_t;
+
 int HAL_CameraDev_CsiSharedDualGC0308_Register(camera_dev_static_config_t *config);
+int HAL_CameraDev_CsiSharedDualGC0308_SetRatio(bool face, uint8_t rgbFrames, uint8_t irFrames);
+void HAL_CameraDev_CsiSharedDualGC0308_GetStats(csi_shared_dual_stats_t *pStats);
 #endif
 
 
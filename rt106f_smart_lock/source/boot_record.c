@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+#include <string.h>
+
+#include "board.h"
+#include "fwk_log.h"
+
+#include "boot_record.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+#define BOOT_LOG_LINE_SIZE  (256)
+#define BOOT_RECORD_PATH(p) (((p) == kBootPath_Cached) ? "cached" : (((p) == kBootPath_Ica) ? "ica" : "fallback"))
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static const char *s_bootStageNames[kBootStage_Count] = {
+    "main", "hardware init", "scheduler", "update check", "decision", "jump",
+};
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+static uint32_t BOOT_Crc32(const void *data, uint32_t len)
+{
+    const uint8_t *pdata = (const uint8_t *)data;
+    uint32_t crc         = 0xFFFFFFFF;
+
+    while (len--)
+    {
+        crc ^= *pdata++;
+        for (uint32_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (BOOT_CRC32_POLY & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+const boot_record_t *BOOT_Record_Get(void)
+{
+    const boot_record_t *record = (const boot_record_t *)BOOT_RECORD_ADDR;
+
+    if ((record->magic != BOOT_RECORD_MAGIC) || (record->version != BOOT_RECORD_VERSION) ||
+        (record->crc != BOOT_Crc32(record, offsetof(boot_record_t, crc))))
+    {
+        return NULL;
+    }
+
+    return record;
+}
+
+void BOOT_Record_Print(void)
+{
+    const boot_record_t *record = BOOT_Record_Get();
+    char line[BOOT_LOG_LINE_SIZE];
+    uint32_t lineLength = 0;
+
+    if (record == NULL)
+    {
+        LOGD("[BOOT] No boot record");
+        return;
+    }
+
+    /* The cycle counter keeps running across the jump */
+    uint32_t sinceJumpUs = (DWT->CYCCNT - record->jumpCycles) / (SystemCoreClock / 1000000U);
+
+    LOGD("[BOOT] #%d %s path, image %d at 0x%x", record->bootCount, BOOT_RECORD_PATH(record->path), record->imgType,
+         record->appAddr);
+    for (uint32_t stage = 0; stage < kBootStage_Count; stage++)
+    {
+        LOGD("[BOOT] %-14s %8dus", s_bootStageNames[stage], record->stageUs[stage]);
+    }
+    LOGD("[BOOT] %-14s %8dus", "app", record->stageUs[kBootStage_Jump] + sinceJumpUs);
+
+    if (record->logLength >= BOOT_RECORD_LOG_SIZE)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < record->logLength; i++)
+    {
+        char c = record->log[i];
+
+        if ((c == '\r') || (c == '\n') || (lineLength == (BOOT_LOG_LINE_SIZE - 1)))
+        {
+            if (lineLength)
+            {
+                line[lineLength] = '\0';
+                LOGD("[BOOT] %s", line);
+                lineLength = 0;
+            }
+            continue;
+        }
+
+        line[lineLength++] = c;
+    }
+
+    if (record->logDropped)
+    {
+        LOGD("[BOOT] %d log bytes dropped", record->logDropped);
+    }
+}
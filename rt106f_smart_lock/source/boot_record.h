@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021 NXP.
+ * This software is owned or controlled by NXP and may only be used strictly in accordance with the
+ * license terms that accompany it. By expressly accepting such terms or by downloading, installing,
+ * activating and/or otherwise using the software, you are agreeing that you have read, and that you
+ * agree to comply with and are bound by, such license terms. If you do not agree to be bound by the
+ * applicable license terms, then you may not retain, install, activate or otherwise use the software.
+ */
+
+/**
+ * @file boot_record.h
+ * @brief Boot record left by the bootloader
+ */
+
+#ifndef _BOOT_RECORD_H_
+#define _BOOT_RECORD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "boot_record_layout.h"
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Get the record left by the bootloader for this boot.
+ *
+ * @returns the boot record, NULL if the bootloader did not leave a valid one
+ */
+const boot_record_t *BOOT_Record_Get(void);
+
+/**
+ * @brief Print the boot time breakdown and the deferred bootloader log.
+ */
+void BOOT_Record_Print(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* _BOOT_RECORD_H_ */
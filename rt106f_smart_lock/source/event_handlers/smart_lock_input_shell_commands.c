@@ -21,6 +21,9 @@
 #include "fwk_input_manager.h"
 #include "fwk_common.h"
 #include "fwk_log.h"
+#include "fwk_message.h"
+#include "fwk_task.h"
+#include "fwk_vision_algo_manager.h"
 #include "hal_event_descriptor_face_rec.h"
 #include "hal_input_dev.h"
 #include "hal_lpm_dev.h"
@@ -61,6 +64,14 @@ static shell_status_t _VerboseCommand(shell_handle_t shellContextHandle, int32_t
 static shell_status_t _RtInfoCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv);
 static shell_status_t _OasisCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv);
 static shell_status_t _FaceRecThresholdCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv);
+static shell_status_t _MessageQueueCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv);
+static shell_status_t _TaskStatsCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv);
+#ifdef ENABLE_CSI_SHARED_DUAL_CAMERA
+static shell_status_t _CameraScheduleCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv);
+#endif /* ENABLE_CSI_SHARED_DUAL_CAMERA */
+#ifdef ENABLE_VISIONALGO_DEV_H264Recording
+static shell_status_t _RecordCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv);
+#endif /* ENABLE_VISIONALGO_DEV_H264Recording */
 
 static int _FrameworkEventsHandler(framework_events_t eventId,
                                    framework_response_t *response,
@@ -179,6 +190,36 @@ static SHELL_COMMAND_DEFINE(facerec_threshold,
                             _FaceRecThresholdCommand,
                             SHELL_IGNORE_PARAMETER_COUNT);
 
+static SHELL_COMMAND_DEFINE(msgq,
+                            (char *)"\r\n\"msgq\": show the depth and drop statistics of the framework task queues\r\n"
+                            "\"msgq reset\": clear the statistics.\r\n",
+                            _MessageQueueCommand,
+                            SHELL_IGNORE_PARAMETER_COUNT);
+
+static SHELL_COMMAND_DEFINE(taskstat,
+                            (char *)"\r\n\"taskstat\": show the utilization and time histograms of the framework tasks\r\n"
+                            "\"taskstat reset\": clear the statistics.\r\n",
+                            _TaskStatsCommand,
+                            SHELL_IGNORE_PARAMETER_COUNT);
+
+#ifdef ENABLE_CSI_SHARED_DUAL_CAMERA
+static SHELL_COMMAND_DEFINE(camsched,
+                            (char *)"\r\n\"camsched\": show the frame rate and discarded frames of the RGB and IR streams\r\n"
+                            "\"camsched idle|face <rgb> <ir>\": set the RGB and IR frames in a row without or with a face.\r\n",
+                            _CameraScheduleCommand,
+                            SHELL_IGNORE_PARAMETER_COUNT);
+#endif /* ENABLE_CSI_SHARED_DUAL_CAMERA */
+
+#ifdef ENABLE_VISIONALGO_DEV_H264Recording
+static SHELL_COMMAND_DEFINE(record,
+                            (char *)"\r\n\"record <start|stop>\": start/stop a continuous H.264 recording\r\n"
+                            "\"record arm\": record the seconds before the next recognition into a clip.\r\n"
+                            "\"record info\": get the state of the recording.\r\n",
+                            _RecordCommand,
+                            SHELL_IGNORE_PARAMETER_COUNT);
+static event_recording_t s_RecordingEvent;
+#endif /* ENABLE_VISIONALGO_DEV_H264Recording */
+
 static event_common_t s_CommonEvent;
 static event_face_rec_t s_FaceRecEvent;
 static input_event_t s_InputEvent;
@@ -219,6 +260,14 @@ void APP_InputDev_Shell_RegisterShellCommands(shell_handle_t shellContextHandle,
 //    SHELL_RegisterCommand(shellContextHandle, SHELL_COMMAND(rtinfo));
     SHELL_RegisterCommand(shellContextHandle, SHELL_COMMAND(oasis));
     SHELL_RegisterCommand(shellContextHandle, SHELL_COMMAND(facerec_threshold));
+    SHELL_RegisterCommand(shellContextHandle, SHELL_COMMAND(msgq));
+    SHELL_RegisterCommand(shellContextHandle, SHELL_COMMAND(taskstat));
+#ifdef ENABLE_CSI_SHARED_DUAL_CAMERA
+    SHELL_RegisterCommand(shellContextHandle, SHELL_COMMAND(camsched));
+#endif /* ENABLE_CSI_SHARED_DUAL_CAMERA */
+#ifdef ENABLE_VISIONALGO_DEV_H264Recording
+    SHELL_RegisterCommand(shellContextHandle, SHELL_COMMAND(record));
+#endif /* ENABLE_VISIONALGO_DEV_H264Recording */
 }
 
 #define PRINT_DEVICE_CONFIG_TABLE_ENTRY(DEV_ID, DEV_NAME, CONFIG_NAME, CONFIG_CUR_VAL, CONFIG_EXPECTED_VALS,        \
@@ -751,8 +800,9 @@ static int _HalEventsHandler(uint32_t event_id, void *response, event_status_t s
             recording_info_t recordedInfo = *(recording_info_t *)response;
             if (status == kEventStatus_Ok)
             {
-                SHELL_Printf(s_ShellHandle, "\r\nH.264 clip start:0x%x size:0x%x state:%d", recordedInfo.start,
-                             recordedInfo.size, recordedInfo.state);
+                SHELL_Printf(s_ShellHandle, "\r\nH.264 clip start:0x%x size:0x%x state:%d frames:%d skipped:%d",
+                             recordedInfo.start, recordedInfo.size, recordedInfo.state, recordedInfo.frames,
+                             recordedInfo.skipped);
             }
             else
             {
@@ -1888,3 +1938,226 @@ static shell_status_t _FaceRecThresholdCommand(shell_handle_t shellContextHandle
 
     return kStatus_SHELL_Success;
 }
+
+static shell_status_t _MessageQueueCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv)
+{
+    static const char *laneName[kFWKMessagePrio_Count] = {"control", "result", "frame"};
+    fwk_message_stats_t stats;
+    vision_algo_result_stats_t resultStats;
+    fwk_input_stats_t inputStats;
+    uint32_t priority;
+    char *name;
+
+    if (argc > 2)
+    {
+        SHELL_Printf(shellContextHandle, "Invalid # of parameters supplied\r\n");
+        return kStatus_SHELL_Error;
+    }
+
+    if (argc == 2)
+    {
+        if (strcmp((char *)argv[1], "reset"))
+        {
+            SHELL_Printf(shellContextHandle, "Wrong command\r\n");
+            return kStatus_SHELL_Error;
+        }
+
+        FWK_Message_ResetStats();
+        FWK_VisionAlgoManager_ResetResultStats();
+        FWK_InputManager_ResetStats();
+        return kStatus_SHELL_Success;
+    }
+
+    SHELL_Printf(shellContextHandle, "%-12s %-8s %5s %5s %8s %9s %8s %8s %8s\r\n", "task", "lane", "depth", "peak",
+                 "put", "coalesced", "evicted", "dropped", "latency");
+    for (int taskId = 0; taskId < kFWKTaskID_COUNT; taskId++)
+    {
+        if (FWK_Task_GetInfo((fwk_task_id_t)taskId, &name, &priority) != 0)
+        {
+            continue;
+        }
+
+        for (int prio = 0; prio < kFWKMessagePrio_Count; prio++)
+        {
+            if (FWK_Message_GetStats((fwk_task_id_t)taskId, (fwk_message_prio_t)prio, &stats) != 0)
+            {
+                continue;
+            }
+
+            SHELL_Printf(shellContextHandle, "%-12s %-8s %5d %5d %8d %9d %8d %8d %6dms\r\n", name, laneName[prio],
+                         stats.depth, stats.peak, stats.put, stats.coalesced, stats.evicted, stats.dropped,
+                         stats.maxLatencyMs);
+        }
+    }
+
+    if (FWK_VisionAlgoManager_GetResultStats(&resultStats) == 0)
+    {
+        SHELL_Printf(shellContextHandle, "vision results: %d published, %d skipped, %d allocated\r\n",
+                     resultStats.published, resultStats.skipped, resultStats.allocated);
+    }
+
+    if (FWK_InputManager_GetStats(&inputStats) == 0)
+    {
+        SHELL_Printf(shellContextHandle,
+                     "input events: %d, %d delivered, %d filtered, %d dropped, %d allocated, %d bytes copied\r\n",
+                     inputStats.events, inputStats.deliveries, inputStats.filtered, inputStats.dropped,
+                     inputStats.allocations, inputStats.bytesCopied);
+    }
+
+    return kStatus_SHELL_Success;
+}
+
+static void _TaskStatsPrintHist(shell_handle_t shellContextHandle, const char *title, uint32_t *hist)
+{
+    SHELL_Printf(shellContextHandle, "  %-8s", title);
+    for (int bucket = 0; bucket < FWK_TASK_HIST_BUCKETS; bucket++)
+    {
+        SHELL_Printf(shellContextHandle, " %7d", hist[bucket]);
+    }
+    SHELL_Printf(shellContextHandle, "\r\n");
+}
+
+static shell_status_t _TaskStatsCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv)
+{
+    static const unsigned int histBoundsUs[FWK_TASK_HIST_BUCKETS - 1] = FWK_TASK_HIST_BOUNDS_US;
+    fwk_task_stats_t stats;
+    uint32_t priority;
+    char *name;
+
+    if (argc > 2)
+    {
+        SHELL_Printf(shellContextHandle, "Invalid # of parameters supplied\r\n");
+        return kStatus_SHELL_Error;
+    }
+
+    if (argc == 2)
+    {
+        if (strcmp((char *)argv[1], "reset"))
+        {
+            SHELL_Printf(shellContextHandle, "Wrong command\r\n");
+            return kStatus_SHELL_Error;
+        }
+
+        FWK_Task_ResetStats();
+        return kStatus_SHELL_Success;
+    }
+
+    for (int taskId = 0; taskId < kFWKTaskID_COUNT; taskId++)
+    {
+        if ((FWK_Task_GetInfo((fwk_task_id_t)taskId, &name, &priority) != 0) ||
+            (FWK_Task_GetStats((fwk_task_id_t)taskId, &stats) != 0))
+        {
+            continue;
+        }
+
+        SHELL_Printf(shellContextHandle, "%s: %d%% busy, %d messages in %d batches, max %dus, %d over budget\r\n",
+                     name, stats.utilization, stats.messages, stats.batches, stats.maxHandlerUs,
+                     stats.budgetOverruns);
+
+        SHELL_Printf(shellContextHandle, "  %-8s", "<us");
+        for (int bucket = 0; bucket < FWK_TASK_HIST_BUCKETS - 1; bucket++)
+        {
+            SHELL_Printf(shellContextHandle, " %7d", histBoundsUs[bucket]);
+        }
+        SHELL_Printf(shellContextHandle, " %7s\r\n", "more");
+
+        _TaskStatsPrintHist(shellContextHandle, "queued", stats.waitHist);
+        _TaskStatsPrintHist(shellContextHandle, "handler", stats.handlerHist);
+    }
+
+    return kStatus_SHELL_Success;
+}
+
+#ifdef ENABLE_CSI_SHARED_DUAL_CAMERA
+static shell_status_t _CameraScheduleCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv)
+{
+    static const char *streamName[2] = {"rgb", "ir"};
+    csi_shared_dual_stats_t stats;
+
+    if (argc == 4)
+    {
+        if (strcmp((char *)argv[1], "idle") && strcmp((char *)argv[1], "face"))
+        {
+            SHELL_Printf(shellContextHandle, "Wrong command\r\n");
+            return kStatus_SHELL_Error;
+        }
+
+        if (HAL_CameraDev_CsiSharedDualGC0308_SetRatio(!strcmp((char *)argv[1], "face"), atoi(argv[2]),
+                                                       atoi(argv[3])) != 0)
+        {
+            SHELL_Printf(shellContextHandle, "At least one stream must be enabled\r\n");
+            return kStatus_SHELL_Error;
+        }
+
+        return kStatus_SHELL_Success;
+    }
+
+    if (argc != 1)
+    {
+        SHELL_Printf(shellContextHandle, "Invalid # of parameters supplied\r\n");
+        return kStatus_SHELL_Error;
+    }
+
+    HAL_CameraDev_CsiSharedDualGC0308_GetStats(&stats);
+    SHELL_Printf(shellContextHandle, "%-6s %6s %10s %10s\r\n", "stream", "fps", "frames", "discarded");
+    for (int i = 0; i < 2; i++)
+    {
+        int fps10 = (int)(stats.fps[i] * 10);
+        SHELL_Printf(shellContextHandle, "%-6s %4d.%d %10d %10d\r\n", streamName[i], fps10 / 10, fps10 % 10,
+                     stats.frames[i], stats.discarded[i]);
+    }
+    SHELL_Printf(shellContextHandle, "switches: %d\r\n", stats.switches);
+
+    return kStatus_SHELL_Success;
+}
+#endif /* ENABLE_CSI_SHARED_DUAL_CAMERA */
+
+#ifdef ENABLE_VISIONALGO_DEV_H264Recording
+static shell_status_t _RecordCommand(shell_handle_t shellContextHandle, int32_t argc, char **argv)
+{
+    if (argc != 2)
+    {
+        SHELL_Printf(shellContextHandle, "Invalid # of parameters supplied\r\n");
+        return kStatus_SHELL_Error;
+    }
+
+    memset(&s_RecordingEvent, 0, sizeof(s_RecordingEvent));
+    s_RecordingEvent.eventBase.eventId = kEventID_RecordingState;
+
+    if (!strcmp((char *)argv[1], "start"))
+    {
+        s_RecordingEvent.state = kRecordingState_Start;
+    }
+    else if (!strcmp((char *)argv[1], "stop"))
+    {
+        s_RecordingEvent.state = kRecordingState_Stop;
+    }
+    else if (!strcmp((char *)argv[1], "arm"))
+    {
+        /* the face recognition sends kRecordingState_Trigger on the next recognition */
+        s_RecordingEvent.state = kRecordingState_Arm;
+    }
+    else if (!strcmp((char *)argv[1], "info"))
+    {
+        s_RecordingEvent.eventBase.eventId = kEventID_RecordingInfo;
+    }
+    else
+    {
+        SHELL_Printf(shellContextHandle, "Wrong command\r\n");
+        return kStatus_SHELL_Error;
+    }
+    s_RecordingEvent.eventBase.respond = _HalEventsHandler;
+
+    if (s_InputCallback != NULL)
+    {
+        uint8_t fromISR                       = __get_IPSR();
+        s_InputEvent.u.inputData.data         = &s_RecordingEvent;
+        s_InputEvent.u.inputData.receiverList = (1 << kFWKTaskID_VisionAlgo);
+        s_InputEvent.size                     = sizeof(s_RecordingEvent);
+        s_InputEvent.eventId                  = kInputEventID_Recv;
+        s_InputCallback(s_SourceShell, &s_InputEvent, fromISR);
+    }
+
+    return kStatus_SHELL_Success;
+}
+#endif /* ENABLE_VISIONALGO_DEV_H264Recording */
@@ -16,6 +16,7 @@
 #include "lfs.h"
 
 #include "sln_encrypt.h"
+#include "fwk_memory.h"
 
 #if defined(FSL_SDK_ENABLE_DRIVER_CACHE_CONTROL) && FSL_SDK_ENABLE_DRIVER_CACHE_CONTROL
 #include "fsl_cache.h"
@@ -569,6 +570,15 @@ sln_flash_fs_status_t SLN_FLASH_LITTLEFS_Init(uint8_t erase)
         else
         {
             SLN_Encrypt_Init_Slot(&s_flashLittlefsEncCtx);
+
+            FWK_Memory_Track(kFWKMemRegion_SdramUncached, kFWKMemOwner_Flash, s_CacheBuffer, LFS_CACHE_SIZE,
+                             "lfs cache");
+            FWK_Memory_Track(kFWKMemRegion_SdramUncached, kFWKMemOwner_Flash, s_ReadBuffer, LFS_CACHE_SIZE,
+                             "lfs read buffer");
+            FWK_Memory_Track(kFWKMemRegion_SdramUncached, kFWKMemOwner_Flash, s_WriteBuffer, LFS_CACHE_SIZE,
+                             "lfs write buffer");
+            FWK_Memory_Track(kFWKMemRegion_SdramUncached, kFWKMemOwner_Flash, s_LookaheadBuffer,
+                             LFS_LOOKAHEAD_BUF_SIZE, "lfs lookahead buffer");
         }
     }
 
@@ -15,6 +15,8 @@
 #include <FreeRTOS.h>
 #include <task.h>
 
+#include "board_define.h"
+
 #include "fwk_log.h"
 #include "fwk_message.h"
 #include "fwk_display_manager.h"
@@ -22,6 +24,9 @@
 #include "fwk_input_manager.h"
 #include "fwk_output_manager.h"
 #include "fwk_vision_algo_manager.h"
+#include "fwk_memory.h"
+#include "fwk_timer.h"
+#include "boot_record.h"
 
 /*Smaller the number, higher priority it is, for UVC mode to work normally, please make sure
  * DISPLAY task and INPUT task has same priority*/
@@ -125,6 +130,29 @@ int APP_InitFramework(void)
 
 }
 
+void APP_SetMemoryBudgets(void)
+{
+    /* what the default configuration places in each region, a buffer added or moved shows in the boot report */
+    FWK_Memory_SetBudget(kFWKMemOwner_VisionAlgo, kFWKMemRegion_DTCM, 128 * 1024);
+    FWK_Memory_SetBudget(kFWKMemOwner_VisionAlgo, kFWKMemRegion_SdramCached, 4 * 1024 * 1024);
+    FWK_Memory_SetBudget(kFWKMemOwner_Graphics, kFWKMemRegion_SdramCached, 640 * 480 * 4);
+    FWK_Memory_SetBudget(kFWKMemOwner_Graphics, kFWKMemRegion_OcramCached, GFX_PLAN_STRIP_SIZE);
+#if ENABLE_CACHED_FRAME_BUFFERS
+    FWK_Memory_SetBudget(kFWKMemOwner_Camera, kFWKMemRegion_SdramCached, 4 * 640 * 480 * 2);
+    FWK_Memory_SetBudget(kFWKMemOwner_Display, kFWKMemRegion_SdramCached, 2 * 240 * 320 * 2);
+    FWK_Memory_SetBudget(kFWKMemOwner_Display, kFWKMemRegion_SdramUncached, 2 * 240 * 320 * 2);
+#else
+    FWK_Memory_SetBudget(kFWKMemOwner_Camera, kFWKMemRegion_SdramUncached, 4 * 640 * 480 * 2);
+    FWK_Memory_SetBudget(kFWKMemOwner_Display, kFWKMemRegion_SdramUncached, 4 * 240 * 320 * 2);
+#endif /* ENABLE_CACHED_FRAME_BUFFERS */
+    FWK_Memory_SetBudget(kFWKMemOwner_Flash, kFWKMemRegion_SdramUncached, 4 * 1024);
+}
+
+static void APP_MemoryReport(void *arg)
+{
+    FWK_Memory_Report();
+}
+
 int APP_StartFramework(void)
 {
     int ret = 0;
@@ -164,6 +192,13 @@ int APP_StartFramework(void)
         return ret;
     }
 
+    /* the devices place their buffers while the managers initialize them, report once they are all up */
+    static fwk_timer_t *s_pMemoryReportTimer = NULL;
+    if (FWK_Timer_Start("MemoryReport", FWK_MEM_REPORT_DELAY_MS, 0, APP_MemoryReport, NULL, &s_pMemoryReportTimer) != 0)
+    {
+        LOGE("Failed to start the memory report timer");
+    }
+
     return ret;
 }
 
@@ -176,10 +211,15 @@ int main(void)
     APP_BoardInit();
 #if LOG_ENABLE
     xLoggingTaskInitialize(LOGGING_TASK_STACK_SIZE, LOGGING_TASK_PRIORITY, LOGGING_QUEUE_LENGTH);
+
+    /* the bootloader log and boot time breakdown are printed by the application */
+    BOOT_Record_Print();
 #endif
     /* init the framework*/
     APP_InitFramework();
 
+    APP_SetMemoryBudgets();
+
     /* register the hal devices*/
     APP_RegisterHalDevices();
 
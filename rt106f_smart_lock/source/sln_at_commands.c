@@ -68,6 +68,8 @@ static uint32_t s_eventIDList4PowerOff[] =
 
 		kEventFaceRecID_AddUser,
 		kEventFaceRecID_AddUserRemote,
+		kEventFaceRecID_AddUsersRemote,
+		kEventFaceRecID_ImportUsersRemote,
 		kEventFaceRecID_DelUser,
 		kEventFaceRecID_DelUserAll,
 		kEventFaceRecID_RenameUser,
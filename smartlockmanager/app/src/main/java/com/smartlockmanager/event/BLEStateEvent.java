@@ -126,6 +126,33 @@ public class BLEStateEvent {
         }
     }
 
+    /*
+     * BATCH_REGISTRATION_RES
+     */
+    public static class BatchRegistrationRes extends BaseEvent {
+        public static final int RECORD_SIZE = 4;
+
+        public int mBatchRegistrationResult = 1;
+        /* per record registration result: 0 ok, 1 duplicate, other values failed */
+        public int[] mRecordResults;
+        /* per record id of the enrolled face, or of the face it duplicates */
+        public int[] mRecordIds;
+
+        public BatchRegistrationRes(int batchRegistrationResult, byte[] batchRegistrationData) {
+            super();
+            int count = batchRegistrationData.length / RECORD_SIZE;
+
+            this.mBatchRegistrationResult = batchRegistrationResult;
+            this.mRecordResults = new int[count];
+            this.mRecordIds = new int[count];
+            for (int i = 0; i < count; i++) {
+                this.mRecordResults[i] = batchRegistrationData[i * RECORD_SIZE] & 0xff;
+                this.mRecordIds[i] = (batchRegistrationData[i * RECORD_SIZE + 2] & 0xff) |
+                        ((batchRegistrationData[i * RECORD_SIZE + 3] & 0xff) << 8);
+            }
+        }
+    }
+
     /*
      * DELETE_USER_RES
      */
@@ -106,10 +106,17 @@ public enum BLEService {
     public final byte GET_APP_TYPE_RES = 21;
     public final byte GET_ALGO_VERSION_REQ = 22;
     public final byte GET_ALGO_VERSION_RES = 23;
+    public final byte BATCH_REGISTRATION_REQ = 24;
+    public final byte BATCH_REGISTRATION_RES = 25;
 
     public final byte INVALID_PACKET = -2;
     public static final int REGISTRATION_RESULT_DUPLICATE = 1;
 
+    /* batch registration chunk, the header reserved word carries the record count and these flags */
+    public static final int BATCH_REGISTRATION_MAX_RECORDS = 8;
+    private static final int BATCH_REGISTRATION_REREGISTER = (1 << 16);
+    private static final int BATCH_REGISTRATION_LAST = (1 << 17);
+
     private final int packetLength[] = {
             6,      // AUTHENTICATION_REQ_PKT_LEN
             0,      // AUTHENTICATION_RES_PKT_LEN
@@ -135,6 +142,8 @@ public enum BLEService {
             0,      // GET_APP_TYPE_RES
             0,      // GET_ALGO_VERSION_REQ
             0,      // GET_ALGO_VERSION_RES
+            0,      // BATCH_REGISTRATION_REQ
+            0,      // BATCH_REGISTRATION_RES
     };
 
     private static final byte PACKET_HEADER_LEN = 24;
@@ -1738,6 +1747,58 @@ private void bluetoothReleaseResource(){
         return ret;
     }
 
+    /*
+     * send one chunk of a batch registration Req, at most BATCH_REGISTRATION_MAX_RECORDS users per chunk.
+     * The lock keeps the enrolled faces in RAM and saves them all to flash after the chunk sent with last set,
+     * the next chunk is sent once BatchRegistrationRes is received.
+     */
+    public boolean sendBatchRegistrationReq(List<String> faceNames, List<byte[]> faceFeatures, boolean reRegister,
+                                            boolean last) {
+        Log.d(TAG, "+sendBatchRegistrationReq");
+        byte pkt_type = BATCH_REGISTRATION_REQ;
+        int name_size = 32;
+        int count = faceNames.size();
+
+        if ((count == 0) || (count > BATCH_REGISTRATION_MAX_RECORDS) || (count != faceFeatures.size())) {
+            Log.e(TAG, "-sendBatchRegistrationReq:invalid record count:" + count);
+            return false;
+        }
+
+        int record_size = name_size + faceFeatures.get(0).length;
+        int pkt_len = record_size * count;
+        byte[] pkt_data = new byte[pkt_len];
+
+        for (int i = 0; i < count; i++) {
+            byte[] faceName_bytes = faceNames.get(i).getBytes();
+            byte[] faceFeature = faceFeatures.get(i);
+            int faceName_len = Math.min(faceName_bytes.length, name_size - 1);
+
+            if (faceFeature.length != (record_size - name_size)) {
+                Log.e(TAG, "-sendBatchRegistrationReq:invalid face feature:" + i);
+                return false;
+            }
+
+            // the rest of the name is already zero
+            System.arraycopy(faceName_bytes, 0, pkt_data, i * record_size, faceName_len);
+            System.arraycopy(faceFeature, 0, pkt_data, i * record_size + name_size, faceFeature.length);
+        }
+
+        headerReserved = count;
+        if (reRegister) {
+            headerReserved |= BATCH_REGISTRATION_REREGISTER;
+        }
+        if (last) {
+            headerReserved |= BATCH_REGISTRATION_LAST;
+        }
+
+        // send the pkt
+        boolean ret = sendPacket(pkt_data, pkt_len, pkt_type);
+        headerReserved = 0;
+
+        Log.d(TAG, "-sendBatchRegistrationReq:" + ret);
+        return ret;
+    }
+
     /* send delete user Req */
     public boolean sendDeleteUserReq(int faceId){
         byte pkt_type = DELETE_USER_REQ;
@@ -1911,6 +1972,14 @@ private void bluetoothReleaseResource(){
             case GET_ALGO_VERSION_RES:
                 EventBus.getDefault().post(new BLEStateEvent.GetAlgoVersionRes(result));
                 break;
+            case BATCH_REGISTRATION_RES:
+                if (result == INVALID_PACKET) {
+                    EventBus.getDefault().post(new BLEStateEvent.BatchRegistrationRes(result, new byte[0]));
+                } else {
+                    EventBus.getDefault().post(new BLEStateEvent.BatchRegistrationRes(
+                            result, Arrays.copyOfRange(packetData.toByteArray(), PACKET_HEADER_LEN, packetData.toByteArray().length)));
+                }
+                break;
             default:
                 break;
         }